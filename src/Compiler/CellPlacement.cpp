@@ -0,0 +1,141 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/CellPlacement.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Compiler/Checkpoint.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+void CellPlacement::Reset(size_t cells, double width, double height) {
+  m_width = width;
+  m_height = height;
+  m_x.assign(cells, (float)(width / 2));
+  m_y.assign(cells, (float)(height / 2));
+  m_fixed.assign(cells, 0);
+}
+
+double CellPlacement::Hpwl(const Netlist& netlist,
+                           unsigned int threads) const {
+  if (Size() != netlist.CellCount()) return 0;
+  // Partial sums per fixed size chunk, the total does not depend on the
+  // number of threads
+  const size_t grain = 4096;
+  const size_t nets = netlist.NetCount();
+  std::vector<double> partial((nets + grain - 1) / grain, 0.0);
+  TaskScheduler::Instance()->ParallelFor(
+      0, nets, grain,
+      [&](size_t begin, size_t end) {
+        double sum = 0;
+        for (size_t net = begin; net < end; net++) {
+          Netlist::IdSpan pins = netlist.NetPins((Netlist::NetId)net);
+          if (pins.size() < 2) continue;
+          Netlist::PinId driver = netlist.NetDriver((Netlist::NetId)net);
+          if (driver != Netlist::kNone &&
+              IsConstant(netlist.CellType(netlist.PinCell(driver)))) {
+            continue;
+          }
+          float xmin = m_width, xmax = 0, ymin = m_height, ymax = 0;
+          for (Netlist::PinId pin : pins) {
+            Netlist::CellId cell = netlist.PinCell(pin);
+            xmin = std::min(xmin, m_x[cell]);
+            xmax = std::max(xmax, m_x[cell]);
+            ymin = std::min(ymin, m_y[cell]);
+            ymax = std::max(ymax, m_y[cell]);
+          }
+          sum += (double)(xmax - xmin) + (double)(ymax - ymin);
+        }
+        partial[begin / grain] = sum;
+      },
+      threads);
+  double total = 0;
+  for (double sum : partial) total += sum;
+  return total;
+}
+
+bool CellPlacement::Save(CheckpointWriter& writer) const {
+  if (Empty()) return true;
+  const double die[2] = {m_width, m_height};
+  return writer.WriteArray("placement.die", die, 2) &&
+         writer.WriteArray("placement.x", m_x.data(), m_x.size()) &&
+         writer.WriteArray("placement.y", m_y.data(), m_y.size()) &&
+         writer.WriteArray("placement.fixed", m_fixed.data(), m_fixed.size());
+}
+
+bool CellPlacement::Load(const MappedCheckpoint& checkpoint,
+                         std::string& error) {
+  Clear();
+  if (!checkpoint.Has("placement.die")) return true;
+  size_t count = 0;
+  const double* die = checkpoint.Array<double>("placement.die", count);
+  size_t cells = 0;
+  const float* x = checkpoint.Array<float>("placement.x", cells);
+  size_t ys = 0, fixed = 0;
+  const float* y = checkpoint.Array<float>("placement.y", ys);
+  const uint8_t* flags = checkpoint.Array<uint8_t>("placement.fixed", fixed);
+  if (count != 2 || ys != cells || fixed != cells) {
+    error = "invalid placement in checkpoint";
+    return false;
+  }
+  // Small next to the netlist and modified by every placer, copied
+  m_width = die[0];
+  m_height = die[1];
+  m_x.assign(x, x + cells);
+  m_y.assign(y, y + cells);
+  m_fixed.assign(flags, flags + cells);
+  return true;
+}
+
+// uint64 cell count, width and height as doubles, then the arrays
+std::string CellPlacement::Serialize() const {
+  const uint64_t cells = Size();
+  std::string data;
+  data.reserve(24 + cells * 9);
+  data.append((const char*)&cells, sizeof(cells));
+  data.append((const char*)&m_width, sizeof(m_width));
+  data.append((const char*)&m_height, sizeof(m_height));
+  data.append((const char*)m_x.data(), cells * sizeof(float));
+  data.append((const char*)m_y.data(), cells * sizeof(float));
+  data.append((const char*)m_fixed.data(), cells);
+  return data;
+}
+
+bool CellPlacement::Deserialize(std::string_view data) {
+  uint64_t cells = 0;
+  if (data.size() < 24) return false;
+  memcpy(&cells, data.data(), sizeof(cells));
+  if (data.size() != 24 + cells * 9) return false;
+  const char* cursor = data.data() + 8;
+  memcpy(&m_width, cursor, sizeof(m_width));
+  memcpy(&m_height, cursor + 8, sizeof(m_height));
+  cursor += 16;
+  m_x.resize(cells);
+  m_y.resize(cells);
+  m_fixed.resize(cells);
+  memcpy(m_x.data(), cursor, cells * sizeof(float));
+  memcpy(m_y.data(), cursor + cells * sizeof(float), cells * sizeof(float));
+  memcpy(m_fixed.data(), cursor + cells * 2 * sizeof(float), cells);
+  return true;
+}
@@ -0,0 +1,99 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Compiler/Netlist.h"
+
+#ifndef CELL_PLACEMENT_H
+#define CELL_PLACEMENT_H
+
+namespace FOEDAG {
+
+class CheckpointWriter;
+class MappedCheckpoint;
+
+// Location of every cell of a Netlist, indexed by CellId, on a die of
+// Width() x Height() sites. Coordinates are cell centers. Fixed cells are
+// not moved by the placers; top level ports are fixed on the die boundary.
+class CellPlacement {
+ public:
+  // Cells the placers handle apart: ports sit on the boundary, constant
+  // drivers are not placed at all and their nets are not wires
+  static bool IsPort(std::string_view cellType) {
+    return cellType == "$input" || cellType == "$output" ||
+           cellType == "$inout";
+  }
+  static bool IsConstant(std::string_view cellType) {
+    return cellType == "$const0" || cellType == "$const1";
+  }
+
+  // All the cells at the center of the die, none fixed
+  void Reset(size_t cells, double width, double height);
+  void Clear() { Reset(0, 0, 0); }
+
+  size_t Size() const { return m_x.size(); }
+  bool Empty() const { return m_x.empty(); }
+  double Width() const { return m_width; }
+  double Height() const { return m_height; }
+
+  float X(Netlist::CellId cell) const { return m_x[cell]; }
+  float Y(Netlist::CellId cell) const { return m_y[cell]; }
+  void Set(Netlist::CellId cell, float x, float y) {
+    m_x[cell] = x;
+    m_y[cell] = y;
+  }
+  bool Fixed(Netlist::CellId cell) const { return m_fixed[cell]; }
+  void SetFixed(Netlist::CellId cell, bool fixed) { m_fixed[cell] = fixed; }
+
+  // The coordinate arrays, for the placement engines
+  float* XData() { return m_x.data(); }
+  float* YData() { return m_y.data(); }
+  const float* XData() const { return m_x.data(); }
+  const float* YData() const { return m_y.data(); }
+
+  // Half perimeter wirelength of the nets, constant nets excluded.
+  // threads == 0 uses the whole TaskScheduler.
+  double Hpwl(const Netlist& netlist, unsigned int threads = 0) const;
+
+  // Checkpoint sections placement.*, nothing when empty
+  bool Save(CheckpointWriter& writer) const;
+  // Clears the placement when the checkpoint has none
+  bool Load(const MappedCheckpoint& checkpoint, std::string& error);
+
+  // Binary image for the stage results
+  std::string Serialize() const;
+  bool Deserialize(std::string_view data);
+
+ private:
+  double m_width = 0;
+  double m_height = 0;
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<uint8_t> m_fixed;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,207 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+#include "Compiler/Checkpoint.h"
+
+using namespace FOEDAG;
+
+static const char kMagic[8] = {'F', 'O', 'E', 'D', 'A', 'G', 'C', 'K'};
+static const size_t kHeaderSize = 24;
+
+CheckpointWriter::~CheckpointWriter() {
+  if (m_out.is_open()) {
+    m_out.close();
+    std::error_code ec;
+    std::filesystem::remove(m_tmpPath, ec);
+  }
+}
+
+bool CheckpointWriter::Fail(const std::string& error) {
+  if (m_error.empty()) m_error = error;
+  return false;
+}
+
+bool CheckpointWriter::Open(const std::string& path) {
+  m_path = path;
+  m_tmpPath.clear();
+  m_entries.clear();
+  m_error.clear();
+  // A temporary file of its own, created exclusively: writers of the same
+  // path never share one, and a file or link planted under the name is not
+  // followed
+  static std::atomic<uint64_t> counter{0};
+  std::random_device random;
+  for (int attempt = 0; attempt < 16 && m_tmpPath.empty(); attempt++) {
+    std::string tmp = path + "." + std::to_string(getpid()) + "_" +
+                      std::to_string(counter++) + "_" +
+                      std::to_string(random()) + ".tmp";
+#ifdef _WIN32
+    std::error_code ec;
+    if (std::filesystem::exists(tmp, ec)) continue;
+#else
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+      if (errno == EEXIST) continue;
+      return Fail("cannot create " + tmp + ": " + strerror(errno));
+    }
+    close(fd);
+#endif
+    m_tmpPath = tmp;
+  }
+  if (m_tmpPath.empty()) return Fail("cannot create a temporary " + path);
+  m_out.open(m_tmpPath, std::ios::binary | std::ios::trunc);
+  if (!m_out) {
+    std::error_code ec;
+    std::filesystem::remove(m_tmpPath, ec);
+    return Fail("cannot write " + m_tmpPath);
+  }
+  // Patched by Close()
+  char header[kHeaderSize] = {0};
+  m_out.write(header, kHeaderSize);
+  m_position = kHeaderSize;
+  return true;
+}
+
+bool CheckpointWriter::BeginSection(const std::string& name) {
+  if (!m_out.is_open() || m_inSection) return Fail("checkpoint not open");
+  if (name.size() >= kNameSize) return Fail("section name too long: " + name);
+  static const char padding[kAlignment] = {0};
+  size_t pad = (kAlignment - m_position % kAlignment) % kAlignment;
+  m_out.write(padding, pad);
+  m_position += pad;
+  m_entries.push_back(Entry{name, m_position, 0});
+  m_inSection = true;
+  return true;
+}
+
+bool CheckpointWriter::Append(const void* data, size_t size) {
+  if (!m_inSection) return Fail("no open section");
+  m_out.write((const char*)data, size);
+  m_position += size;
+  m_entries.back().m_size += size;
+  return (bool)m_out || Fail("write error on " + m_tmpPath);
+}
+
+bool CheckpointWriter::EndSection() {
+  if (!m_inSection) return Fail("no open section");
+  m_inSection = false;
+  return true;
+}
+
+bool CheckpointWriter::WriteSection(const std::string& name, const void* data,
+                                    size_t size) {
+  return BeginSection(name) && Append(data, size) && EndSection();
+}
+
+bool CheckpointWriter::Close() {
+  if (!m_out.is_open() || m_inSection) return Fail("checkpoint not open");
+  uint64_t tableOffset = m_position;
+  for (auto& entry : m_entries) {
+    char name[kNameSize] = {0};
+    memcpy(name, entry.m_name.data(), entry.m_name.size());
+    m_out.write(name, kNameSize);
+    m_out.write((const char*)&entry.m_offset, sizeof(entry.m_offset));
+    m_out.write((const char*)&entry.m_size, sizeof(entry.m_size));
+  }
+  uint32_t version = kVersion;
+  uint32_t count = (uint32_t)m_entries.size();
+  m_out.seekp(0);
+  m_out.write(kMagic, sizeof(kMagic));
+  m_out.write((const char*)&version, sizeof(version));
+  m_out.write((const char*)&count, sizeof(count));
+  m_out.write((const char*)&tableOffset, sizeof(tableOffset));
+  m_out.close();
+  if (!m_out) return Fail("write error on " + m_tmpPath);
+  std::error_code ec;
+  std::filesystem::rename(m_tmpPath, m_path, ec);
+  if (ec) return Fail("cannot rename " + m_tmpPath + ": " + ec.message());
+  return true;
+}
+
+std::shared_ptr<const MappedCheckpoint> MappedCheckpoint::Open(
+    const std::string& path, std::string& error) {
+  std::shared_ptr<MappedCheckpoint> checkpoint(new MappedCheckpoint);
+  if (!checkpoint->m_file.Open(path, error)) return nullptr;
+
+  const char* data = checkpoint->m_file.Data();
+  const size_t size = checkpoint->m_file.Size();
+  uint32_t version = 0;
+  uint32_t count = 0;
+  uint64_t tableOffset = 0;
+  if (size < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    error = path + " is not a checkpoint";
+    return nullptr;
+  }
+  memcpy(&version, data + 8, sizeof(version));
+  memcpy(&count, data + 12, sizeof(count));
+  memcpy(&tableOffset, data + 16, sizeof(tableOffset));
+  if (version != CheckpointWriter::kVersion) {
+    error = path + ": unsupported checkpoint version " +
+            std::to_string(version);
+    return nullptr;
+  }
+  const size_t entrySize = CheckpointWriter::kNameSize + 16;
+  if (tableOffset > size || (size - tableOffset) / entrySize < count) {
+    error = path + " is truncated";
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const char* entry = data + tableOffset + i * entrySize;
+    std::string name(entry, strnlen(entry, CheckpointWriter::kNameSize));
+    uint64_t offset = 0;
+    uint64_t sectionSize = 0;
+    memcpy(&offset, entry + CheckpointWriter::kNameSize, sizeof(offset));
+    memcpy(&sectionSize, entry + CheckpointWriter::kNameSize + 8,
+           sizeof(sectionSize));
+    if (offset > tableOffset || sectionSize > tableOffset - offset) {
+      error = path + ": corrupted section " + name;
+      return nullptr;
+    }
+    checkpoint->m_sections[name] =
+        std::string_view(data + offset, (size_t)sectionSize);
+  }
+  return checkpoint;
+}
+
+std::string_view MappedCheckpoint::Section(const std::string& name) const {
+  auto found = m_sections.find(name);
+  return (found == m_sections.end()) ? std::string_view() : found->second;
+}
+
+std::vector<std::string> MappedCheckpoint::SectionNames() const {
+  std::vector<std::string> names;
+  for (auto& section : m_sections) names.push_back(section.first);
+  return names;
+}
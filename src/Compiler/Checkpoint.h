@@ -0,0 +1,123 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Compiler/MappedFile.h"
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+namespace FOEDAG {
+
+// Binary checkpoint file, a header, a sequence of named sections and a
+// section table at the end:
+//   header:  "FOEDAGCK", uint32 version, uint32 section count,
+//            uint64 table offset
+//   section: raw payload, starting on a kAlignment boundary
+//   table:   per section, a 32 bytes zero padded name, uint64 offset and
+//            uint64 size
+// Integers are in host byte order, a file from a host of the other order
+// fails the version check. Sections hold flat arrays, so readers use them
+// in place, straight from the mapped file.
+class CheckpointWriter {
+ public:
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kNameSize = 32;
+
+  CheckpointWriter() = default;
+  ~CheckpointWriter();
+
+  // Writes to a temporary file of a unique name next to path, renamed
+  // over path by Close()
+  bool Open(const std::string& path);
+  // Streaming form: BeginSection, any number of Append, EndSection
+  bool BeginSection(const std::string& name);
+  bool Append(const void* data, size_t size);
+  bool EndSection();
+  bool WriteSection(const std::string& name, const void* data, size_t size);
+  template <typename T>
+  bool WriteArray(const std::string& name, const T* data, size_t count) {
+    return WriteSection(name, data, count * sizeof(T));
+  }
+  bool Close();
+
+  const std::string& Error() const { return m_error; }
+
+ private:
+  bool Fail(const std::string& error);
+
+  struct Entry {
+    std::string m_name;
+    uint64_t m_offset = 0;
+    uint64_t m_size = 0;
+  };
+  std::ofstream m_out;
+  std::string m_path;
+  std::string m_tmpPath;
+  std::vector<Entry> m_entries;
+  uint64_t m_position = 0;
+  bool m_inSection = false;
+  std::string m_error;
+};
+
+// Read-only view of a checkpoint. The file is mapped, sections are handed
+// out as pointers into the mapping; the pages are shared with every other
+// reader of the file. Keep the object alive as long as sections are used.
+class MappedCheckpoint {
+ public:
+  MappedCheckpoint(const MappedCheckpoint&) = delete;
+  MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+  static std::shared_ptr<const MappedCheckpoint> Open(const std::string& path,
+                                                      std::string& error);
+
+  bool Has(const std::string& name) const {
+    return m_sections.find(name) != m_sections.end();
+  }
+  // Empty view when the section does not exist
+  std::string_view Section(const std::string& name) const;
+  template <typename T>
+  const T* Array(const std::string& name, size_t& count) const {
+    std::string_view section = Section(name);
+    count = section.size() / sizeof(T);
+    return (const T*)section.data();
+  }
+  std::vector<std::string> SectionNames() const;
+  size_t FileSize() const { return m_file.Size(); }
+
+ private:
+  MappedCheckpoint() = default;
+
+  MappedFile m_file;
+  std::map<std::string, std::string_view> m_sections;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,204 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+#include "Compiler/Netlist.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+std::string CheckpointPath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(Checkpoint, SectionsAreAlignedAndMapped) {
+  std::string path = CheckpointPath("foedag_sections.ckpt");
+  CheckpointWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  ASSERT_TRUE(writer.WriteSection("text", "abc", 3));
+  ASSERT_TRUE(writer.BeginSection("numbers"));
+  for (uint64_t i = 0; i < 100; i++) writer.Append(&i, sizeof(i));
+  ASSERT_TRUE(writer.EndSection());
+  ASSERT_TRUE(writer.Close()) << writer.Error();
+
+  std::string error;
+  auto checkpoint = MappedCheckpoint::Open(path, error);
+  ASSERT_NE(checkpoint, nullptr) << error;
+  EXPECT_EQ(checkpoint->Section("text"), "abc");
+  EXPECT_FALSE(checkpoint->Has("missing"));
+  size_t count = 0;
+  const uint64_t* numbers = checkpoint->Array<uint64_t>("numbers", count);
+  ASSERT_EQ(count, 100u);
+  EXPECT_EQ((uintptr_t)numbers % CheckpointWriter::kAlignment, 0u);
+  EXPECT_EQ(numbers[42], 42u);
+  checkpoint.reset();
+
+  // Truncated file
+  std::filesystem::resize_file(path, 30);
+  EXPECT_EQ(MappedCheckpoint::Open(path, error), nullptr);
+  std::filesystem::remove(path);
+}
+
+// Writers of the same path each have a temporary file, and a link planted
+// where one used to be is left alone
+TEST(Checkpoint, WritersOfOnePathDoNotShareTheirFile) {
+  std::string path = CheckpointPath("foedag_concurrent.ckpt");
+  std::string victim = CheckpointPath("foedag_concurrent.victim");
+  std::ofstream(victim) << "keep";
+  std::error_code ec;
+  std::filesystem::remove(path + ".tmp", ec);
+  std::filesystem::create_symlink(victim, path + ".tmp", ec);
+  CheckpointWriter first, second;
+  ASSERT_TRUE(first.Open(path));
+  ASSERT_TRUE(second.Open(path));
+  ASSERT_TRUE(first.WriteSection("text", "first", 5));
+  ASSERT_TRUE(second.WriteSection("text", "second", 6));
+  ASSERT_TRUE(first.Close()) << first.Error();
+  std::string error;
+  auto checkpoint = MappedCheckpoint::Open(path, error);
+  ASSERT_NE(checkpoint, nullptr) << error;
+  EXPECT_EQ(checkpoint->Section("text"), "first");
+  ASSERT_TRUE(second.Close()) << second.Error();
+  // Still the complete first file for the reader that mapped it
+  EXPECT_EQ(checkpoint->Section("text"), "first");
+  EXPECT_EQ(MappedCheckpoint::Open(path, error)->Section("text"), "second");
+  std::string content;
+  std::ifstream(victim) >> content;
+  EXPECT_EQ(content, "keep");
+  checkpoint.reset();
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".tmp", ec);
+  std::filesystem::remove(victim);
+}
+
+TEST(Checkpoint, NetlistRoundTrip) {
+  Netlist netlist;
+  Netlist::CellId inv = netlist.AddCell("u1", "INV");
+  Netlist::PinId a = netlist.AddPin(inv, "A", Netlist::Input);
+  Netlist::PinId y = netlist.AddPin(inv, "Y", Netlist::Output);
+  Netlist::NetId in = netlist.AddNet("in");
+  Netlist::NetId out = netlist.AddNet("out");
+  netlist.Connect(a, in);
+  netlist.Connect(y, out);
+  netlist.Finalize();
+
+  std::string path = CheckpointPath("foedag_netlist.ckpt");
+  CheckpointWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  ASSERT_TRUE(netlist.Save(writer));
+  ASSERT_TRUE(writer.Close()) << writer.Error();
+
+  std::string error;
+  Netlist loaded;
+  ASSERT_TRUE(loaded.Load(MappedCheckpoint::Open(path, error), error))
+      << error;
+  EXPECT_EQ(loaded.CellCount(), 1u);
+  EXPECT_EQ(loaded.CellName(inv), "u1");
+  EXPECT_EQ(loaded.CellType(inv), "INV");
+  EXPECT_EQ(loaded.PinName(y), "Y");
+  EXPECT_EQ(loaded.NetDriver(out), y);
+  EXPECT_EQ(loaded.FindNet("in"), in);
+  // Zero-copy, nothing but the name index on the heap
+  EXPECT_LT(loaded.MemoryBytes(), netlist.MemoryBytes());
+
+  // Modifications copy, and reuse the interned strings
+  Netlist::CellId buf = loaded.AddCell("u2", "INV");
+  loaded.AddPin(buf, "A", Netlist::Input);
+  EXPECT_EQ(loaded.CellTypeId(buf), loaded.CellTypeId(inv));
+  EXPECT_EQ(loaded.CellName(buf), "u2");
+  EXPECT_EQ(loaded.CellName(inv), "u1");
+  std::filesystem::remove(path);
+}
+
+// The arrays of an inverter from "in" to "out", written one by one so that
+// they can be damaged
+struct NetlistArrays {
+  std::vector<uint32_t> cellName{0}, cellType{1}, cellPins{0, 2};
+  std::vector<uint32_t> pinCell{0, 0}, pinNet{0, 1}, pinName{2, 3};
+  std::vector<uint8_t> pinDirection{Netlist::Input, Netlist::Output};
+  std::vector<uint32_t> netName{4, 5}, netPins{0, 1, 2}, netPinList{0, 1};
+  std::vector<uint64_t> offsets{0, 3, 7, 9, 11, 14, 18};
+
+  bool Load(const std::string& path) const {
+    CheckpointWriter writer;
+    auto write = [&writer](const std::string& name, const auto& array) {
+      return writer.WriteArray(name, array.data(), array.size());
+    };
+    const char data[] = "u1\0INV\0A\0Y\0in\0out";
+    std::vector<uint32_t> interned{1, 2, 3};
+    EXPECT_TRUE(writer.Open(path));
+    EXPECT_TRUE(writer.WriteSection("netlist.strings.data", data,
+                                    sizeof(data)) &&
+                write("netlist.strings.offsets", offsets) &&
+                write("netlist.strings.interned", interned) &&
+                write("netlist.cell.name", cellName) &&
+                write("netlist.cell.type", cellType) &&
+                write("netlist.cell.pins", cellPins) &&
+                write("netlist.pin.cell", pinCell) &&
+                write("netlist.pin.net", pinNet) &&
+                write("netlist.pin.name", pinName) &&
+                write("netlist.pin.direction", pinDirection) &&
+                write("netlist.net.name", netName) &&
+                write("netlist.net.pins", netPins) &&
+                write("netlist.net.pin_list", netPinList));
+    EXPECT_TRUE(writer.Close()) << writer.Error();
+    std::string error;
+    Netlist netlist;
+    return netlist.Load(MappedCheckpoint::Open(path, error), error);
+  }
+};
+
+TEST(Checkpoint, NetlistRejectsIndicesOutOfItsArrays) {
+  std::string path = CheckpointPath("foedag_damaged.ckpt");
+  ASSERT_TRUE(NetlistArrays().Load(path));
+  std::vector<std::function<void(NetlistArrays&)>> damages = {
+      [](NetlistArrays& a) { a.offsets[0] = 1; },
+      [](NetlistArrays& a) { a.cellName[0] = 6; },
+      [](NetlistArrays& a) { a.cellType[0] = 6; },
+      [](NetlistArrays& a) { a.pinName[1] = 6; },
+      [](NetlistArrays& a) { a.netName[1] = 6; },
+      [](NetlistArrays& a) { a.cellPins = {1, 2}; },
+      [](NetlistArrays& a) { a.netPins = {0, 2, 1}; },
+      [](NetlistArrays& a) { a.netPinList[1] = 2; },
+      [](NetlistArrays& a) { a.pinCell[1] = 1; },
+      [](NetlistArrays& a) { a.pinNet[0] = 2; },
+      [](NetlistArrays& a) { a.pinDirection[0] = 3; }};
+  for (size_t i = 0; i < damages.size(); i++) {
+    NetlistArrays arrays;
+    damages[i](arrays);
+    EXPECT_FALSE(arrays.Load(path)) << "damage " << i;
+  }
+  // Unconnected pins are fine
+  NetlistArrays unconnected;
+  unconnected.pinNet[0] = Netlist::kNone;
+  unconnected.netPins = {0, 0, 1};
+  unconnected.netPinList = {1};
+  EXPECT_TRUE(unconnected.Load(path));
+  std::filesystem::remove(path);
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -24,17 +24,135 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #else
 #include <unistd.h>
 #endif
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <thread>
 
 #include "Compiler/Compiler.h"
+#include "Compiler/Checkpoint.h"
+#include "Compiler/DetailedPlacer.h"
+#include "Compiler/GlobalPlacer.h"
+#include "Compiler/JobServer.h"
+#include "Compiler/Legalizer.h"
+#include "Compiler/NetlistReader.h"
+#include "Compiler/Router.h"
+#include "Compiler/StageProcess.h"
 #include "Compiler/TclInterpreterHandler.h"
+#include "Compiler/TimingPaths.h"
 #include "Compiler/WorkerThread.h"
 
 using namespace FOEDAG;
 
-Compiler::~Compiler() {}
+// Tcl names of the stages and languages, indexed by Action and Language
+static const char* kStageNames[] = {
+    "",        "synthesis", "global_placement", "detailed_placement",
+    "routing", "sta",       "bitstream"};
+static const char* kLanguageNames[] = {
+    "VHDL_1987",          "VHDL_1993",          "VHDL_2008",
+    "VERILOG_1995",       "VERILOG_2001",       "SYSTEMVERILOG_2005",
+    "SYSTEMVERILOG_2009", "SYSTEMVERILOG_2012", "SYSTEMVERILOG_2017",
+    "BLIF",               "EBLIF",              "VERILOG_NETLIST"};
+
+Compiler::Action Compiler::StageFromName(const std::string& name) {
+  for (int stage = Synthesis; stage <= Bitream; stage++) {
+    if (name == kStageNames[stage]) return (Action)stage;
+  }
+  return NoAction;
+}
+
+// Refuses a command touching the design while a compilation runs in the
+// background, true when it did
+static bool Compiling(Compiler* compiler, Tcl_Interp* interp) {
+  if (!compiler->CompilingElsewhere()) return false;
+  Tcl_AppendResult(interp, "ERROR: ", Compiler::kCompilingError, nullptr);
+  return true;
+}
+
+// -max_paths <k> and -nworst <n> of the timing path commands, the other
+// arguments in rest
+static bool PathOptions(int argc, const char* argv[],
+                        TimingPaths::Options& options,
+                        std::vector<std::string>& rest) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg != "-max_paths" && arg != "-nworst") {
+      rest.push_back(arg);
+      continue;
+    }
+    if (i + 1 == argc) return false;
+    char* end = nullptr;
+    const long value = std::strtol(argv[++i], &end, 10);
+    if (*end != 0 || value <= 0) return false;
+    if (arg == "-max_paths") {
+      options.m_maxPaths = (size_t)value;
+    } else {
+      options.m_pathsPerEndpoint = (size_t)value;
+    }
+  }
+  return true;
+}
+
+// Non negative integer argument of a command, leaves the error in the
+// interpreter result otherwise
+static bool GetCount(Tcl_Interp* interp, const char* arg, uint64_t& value) {
+  Tcl_Obj* obj = Tcl_NewStringObj(arg, -1);
+  Tcl_IncrRefCount(obj);
+  Tcl_WideInt wide = 0;
+  const bool valid = Tcl_GetWideIntFromObj(interp, obj, &wide) == TCL_OK;
+  Tcl_DecrRefCount(obj);
+  if (!valid) return false;
+  if (wide < 0) {
+    Tcl_AppendResult(interp, "expected a non negative integer but got \"",
+                     arg, "\"", nullptr);
+    return false;
+  }
+  value = (uint64_t)wide;
+  return true;
+}
+
+// Size argument in MB, small enough to convert to bytes
+static bool GetMegabytes(Tcl_Interp* interp, const char* arg,
+                         uint64_t& value) {
+  if (!GetCount(interp, arg, value)) return false;
+  if (value > (UINT64_MAX >> 20)) {
+    Tcl_AppendResult(interp, "size of ", arg, "MB out of range", nullptr);
+    return false;
+  }
+  return true;
+}
+
+// Language of a netlist from its file extension, false for other sources
+static bool NetlistLanguage(const std::string& path,
+                            Design::Language& language) {
+  NetlistReader::Format format;
+  if (!NetlistReader::FormatFromPath(path, format)) return false;
+  if (format == NetlistReader::Verilog) {
+    language = Design::VERILOG_NETLIST;
+  } else {
+    language = (std::filesystem::path(path).extension() == ".eblif")
+                   ? Design::EBLIF
+                   : Design::BLIF;
+  }
+  return true;
+}
+
+Compiler::~Compiler() {
+  if (m_backgroundJob.Valid() && !m_backgroundJob.Ready()) {
+    Stop();
+    m_backgroundJob.Wait();
+  }
+  if (m_consoleSubscriber) {
+    EventBus::Instance()->Dispatch();
+    EventBus::Instance()->Unsubscribe(m_consoleSubscriber);
+  }
+}
 
 static std::string TclInterpCloneScript() {
   std::string script = R"(
@@ -101,11 +219,652 @@ tcl_interp_clone
 }
 
 bool Compiler::RegisterCommands(TclInterpreter* interp, bool batchMode) {
+  SubscribeConsole();
+  // The first interpreter is the one of the main event loop
+  if (m_notifierThread == nullptr) m_notifierThread = Tcl_GetCurrentThread();
+  auto stage_cache = [](void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    StageCache& cache = compiler->Cache();
+    std::string sub = (argc > 1) ? argv[1] : "";
+    std::ostringstream result;
+    if (sub == "dir" && argc == 3) {
+      cache.SetDirectory(argv[2]);
+    } else if (sub == "dir" && argc == 2) {
+      result << cache.Directory().string();
+    } else if (sub == "query" && argc == 3) {
+      result << (cache.Contains(argv[2]) ? 1 : 0);
+    } else if (sub == "query" && argc == 2) {
+      for (auto& entry : cache.Entries()) {
+        result << "{" << entry.m_key << " " << entry.m_size << "} ";
+      }
+    } else if (sub == "size" && argc == 2) {
+      result << cache.Size();
+    } else if (sub == "size_limit" && argc == 3) {
+      uint64_t megabytes = 0;
+      if (!GetMegabytes(interp, argv[2], megabytes)) return TCL_ERROR;
+      cache.SetSizeLimit(megabytes << 20);
+    } else if (sub == "size_limit" && argc == 2) {
+      result << (cache.SizeLimit() >> 20);
+    } else if (sub == "prune" && argc <= 3) {
+      uint64_t limit = cache.SizeLimit();
+      if (argc == 3) {
+        if (!GetMegabytes(interp, argv[2], limit)) return TCL_ERROR;
+        limit <<= 20;
+      }
+      result << cache.Prune(limit);
+    } else if (sub == "clear" && argc == 2) {
+      result << cache.Clear();
+    } else {
+      Tcl_AppendResult(interp,
+                       "usage: stage_cache dir ?<path>? | query ?<key>? | "
+                       "size | size_limit ?<MB>? | prune ?<MB>? | clear",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    Tcl_AppendResult(interp, result.str().c_str(), nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("stage_cache", stage_cache, this, 0);
+
+  // arch_cache dir ?<path>?: where the routing graphs of the devices are
+  // cached, an empty path keeps them in memory only
+  // arch_cache stats: {shared loaded built} graph counts of the process,
+  // then {loaded computed} lookahead counts
+  auto arch_cache = [](void* clientData, Tcl_Interp* interp, int argc,
+                       const char* argv[]) -> int {
+    RoutingGraphCache* cache = RoutingGraphCache::Instance();
+    std::string sub = (argc > 1) ? argv[1] : "";
+    std::ostringstream result;
+    if (sub == "dir" && argc == 3) {
+      cache->SetDirectory(argv[2]);
+    } else if (sub == "dir" && argc == 2) {
+      result << cache->Directory();
+    } else if (sub == "stats" && argc == 2) {
+      RoutingGraphCache::Stats stats = cache->GetStats();
+      result << stats.m_shared << " " << stats.m_loaded << " "
+             << stats.m_built << " " << stats.m_lookaheadsLoaded << " "
+             << stats.m_lookaheadsComputed;
+    } else {
+      Tcl_AppendResult(interp, "usage: arch_cache dir ?<path>? | stats",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    Tcl_AppendResult(interp, result.str().c_str(), nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("arch_cache", arch_cache, this, 0);
+
+  auto write_checkpoint = [](void* clientData, Tcl_Interp* interp, int argc,
+                             const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (argc != 2) {
+      Tcl_AppendResult(interp, "usage: write_checkpoint <file>", nullptr);
+      return TCL_ERROR;
+    }
+    std::string error;
+    if (!compiler->WriteCheckpoint(argv[1], error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("write_checkpoint", write_checkpoint, this, 0);
+
+  auto read_checkpoint = [](void* clientData, Tcl_Interp* interp, int argc,
+                            const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (argc != 2) {
+      Tcl_AppendResult(interp, "usage: read_checkpoint <file>", nullptr);
+      return TCL_ERROR;
+    }
+    std::string error;
+    if (!compiler->ReadCheckpoint(argv[1], error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("read_checkpoint", read_checkpoint, this, 0);
+
+  // read_netlist ?-top <module>? <file>...: adds post-synthesis netlists to
+  // the design and reads them right away. Files without a .blif, .eblif,
+  // .vg or .vm extension are taken as structural Verilog.
+  auto read_netlist = [](void* clientData, Tcl_Interp* interp, int argc,
+                         const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+      if (std::string(argv[i]) == "-top" && i + 1 < argc) {
+        compiler->GetDesign()->TopLevel(argv[++i]);
+      } else {
+        files.push_back(argv[i]);
+      }
+    }
+    if (files.empty()) {
+      Tcl_AppendResult(interp, "usage: read_netlist ?-top <module>? <file>...",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    for (auto& file : files) {
+      Design::Language language = Design::VERILOG_NETLIST;
+      NetlistLanguage(file, language);
+      compiler->GetDesign()->AddFile(language, file);
+    }
+    std::string error;
+    compiler->GetDesign()->GetPlacement().Clear();
+    compiler->GetDesign()->GetRouting().Clear();
+    if (!compiler->ReadNetlist(error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("read_netlist", read_netlist, this, 0);
+
+  // stage_progress: {stage phase percent eta_seconds} of every stage that
+  // reported progress, eta is -1 when unknown
+  auto stage_progress = [](void* clientData, Tcl_Interp* interp, int argc,
+                           const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    EventBus::Instance()->Dispatch();
+    std::ostringstream result;
+    std::lock_guard<std::mutex> lock(compiler->m_progressMutex);
+    for (auto& progress : compiler->m_progress) {
+      result << "{{" << compiler->m_flow.StageName(progress.first) << "} {"
+             << progress.second.m_phase << "} " << progress.second.m_percent
+             << " " << progress.second.m_eta << "} ";
+    }
+    Tcl_AppendResult(interp, result.str().c_str(), nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("stage_progress", stage_progress, this, 0);
+
+  // route_iterations: {iteration rerouted_nets overused_nodes wirelength
+  // expanded_nodes seconds} of every iteration of the last routing
+  auto route_iterations = [](void* clientData, Tcl_Interp* interp, int argc,
+                             const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    std::ostringstream result;
+    for (auto& iteration :
+         compiler->GetDesign()->GetRouting().Iterations()) {
+      result << "{" << iteration.m_iteration << " " << iteration.m_rerouted
+             << " " << iteration.m_overused << " " << iteration.m_wirelength
+             << " " << iteration.m_expanded << " " << iteration.m_seconds
+             << "} ";
+    }
+    Tcl_AppendResult(interp, result.str().c_str(), nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("route_iterations", route_iterations, this, 0);
+
+  // report_timing_summary ?-return_string?: worst and total negative slack
+  // and failing endpoints of a timing analysis of the design, with the
+  // routed net delays once routed
+  auto report_timing_summary = [](void* clientData, Tcl_Interp* interp,
+                                  int argc, const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (Compiling(compiler, interp)) return TCL_ERROR;
+    bool returnString = argc == 2 && std::string(argv[1]) == "-return_string";
+    if (argc > 2 || (argc == 2 && !returnString)) {
+      Tcl_AppendResult(interp, "usage: report_timing_summary ?-return_string?",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    if (compiler->CompilerState() < State::Placed) {
+      Tcl_AppendResult(interp, "ERROR: Design needs to be in placed state",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    std::string error;
+    if (!compiler->AnalyzeTiming(
+            compiler->CompilerState() >= State::Routed, error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    const TimingAnalyzer& timing = compiler->GetDesign()->GetTiming();
+    const TimingAnalyzer::Summary& summary = timing.GetSummary();
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+    report << "Timing summary, clock period " << summary.m_clockPeriod
+           << "ns, " << (summary.m_routedDelays ? "routed" : "estimated")
+           << " net delays\n";
+    report << "  WNS(ns)      " << summary.m_wns << "\n";
+    report << "  TNS(ns)      " << summary.m_tns << "\n";
+    report << "  Failing      " << summary.m_failingEndpoints << " of "
+           << summary.m_endpoints << " endpoints\n";
+    if (summary.m_criticalPath > 0) {
+      report << "  Fmax(MHz)    " << 1000 / summary.m_criticalPath << "\n";
+    }
+    for (size_t c = 0; timing.CornerCount() > 1 && c < timing.CornerCount();
+         c++) {
+      const TimingAnalyzer::Summary& corner = timing.CornerSummary(c);
+      report << "  Corner       " << timing.GetCorner(c).m_name << ": WNS "
+             << corner.m_wns << ", TNS " << corner.m_tns << ", "
+             << corner.m_failingEndpoints << " failing, clock period "
+             << corner.m_clockPeriod << "ns\n";
+    }
+    report << "  Graph        " << timing.LevelCount() << " levels, "
+           << timing.ArcCount() << " arcs, " << timing.LoopArcs()
+           << " cut by loops\n";
+    report << "  Analysis     " << summary.m_seconds * 1000 << "ms\n";
+    if (returnString) {
+      Tcl_AppendResult(interp, report.str().c_str(), nullptr);
+    } else {
+      compiler->m_out << report.str() << std::flush;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("report_timing_summary", report_timing_summary, this,
+                      0);
+
+  // move_cell <cell> <x> <y>: moves a placed cell, for what-if timing
+  // queries with update_timing. Its routes are not updated, the nets of a
+  // moved cell are timed from the distance between their cells.
+  auto move_cell = [](void* clientData, Tcl_Interp* interp, int argc,
+                      const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (Compiling(compiler, interp)) return TCL_ERROR;
+    double x = 0, y = 0;
+    if (argc != 4 || Tcl_GetDouble(interp, argv[2], &x) != TCL_OK ||
+        Tcl_GetDouble(interp, argv[3], &y) != TCL_OK) {
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp, "usage: move_cell <cell> <x> <y>", nullptr);
+      return TCL_ERROR;
+    }
+    if (compiler->CompilerState() < State::Placed) {
+      Tcl_AppendResult(interp, "ERROR: Design needs to be in placed state",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    Netlist& netlist = compiler->GetDesign()->GetNetlist();
+    CellPlacement& placement = compiler->GetDesign()->GetPlacement();
+    const Netlist::CellId cell = netlist.FindCell(argv[1]);
+    if (cell == Netlist::kNone || placement.Size() != netlist.CellCount()) {
+      Tcl_AppendResult(interp, "ERROR: Unknown cell ", argv[1], nullptr);
+      return TCL_ERROR;
+    }
+    if (x < 0 || y < 0 || x >= placement.Width() ||
+        y >= placement.Height()) {
+      Tcl_AppendResult(interp, "ERROR: ", argv[2], " ", argv[3],
+                       " is outside of the die", nullptr);
+      return TCL_ERROR;
+    }
+    placement.Set(cell, (float)x, (float)y);
+    compiler->m_movedCells.push_back(cell);
+    // The stages from detailed placement on no longer match the placement
+    compiler->m_flow.Invalidate(Action::Detailed);
+    return TCL_OK;
+  };
+  interp->registerCmd("move_cell", move_cell, this, 0);
+
+  // update_timing ?-incremental?: times the design again after cells
+  // moved, only the cones of their nets when incremental
+  auto update_timing = [](void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (Compiling(compiler, interp)) return TCL_ERROR;
+    bool incremental = argc == 2 && std::string(argv[1]) == "-incremental";
+    if (argc > 2 || (argc == 2 && !incremental)) {
+      Tcl_AppendResult(interp, "usage: update_timing ?-incremental?",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    if (compiler->CompilerState() < State::Placed) {
+      Tcl_AppendResult(interp, "ERROR: Design needs to be in placed state",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    std::string error;
+    if (!compiler->UpdateTiming(incremental, error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    const TimingAnalyzer::Summary& summary =
+        compiler->GetDesign()->GetTiming().GetSummary();
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(3) << "Timing updated ("
+            << (summary.m_incremental ? "incremental" : "full") << "): WNS "
+            << summary.m_wns << "ns, TNS " << summary.m_tns << "ns, "
+            << summary.m_updatedPins << " pin times in "
+            << summary.m_seconds * 1000 << "ms";
+    compiler->m_out << message.str() << std::endl;
+    return TCL_OK;
+  };
+  interp->registerCmd("update_timing", update_timing, this, 0);
+
+  // report_timing ?-max_paths <k>? ?-nworst <n>? ?-file <path>?
+  // ?-return_string?: the k worst paths of the design, at most n per
+  // endpoint, with the delay and arrival time at each of their pins
+  auto report_timing = [](void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (Compiling(compiler, interp)) return TCL_ERROR;
+    TimingPaths::Options options;
+    std::vector<std::string> rest;
+    std::string file;
+    bool returnString = false;
+    bool valid = PathOptions(argc, argv, options, rest);
+    for (size_t i = 0; valid && i < rest.size(); i++) {
+      if (rest[i] == "-file" && i + 1 < rest.size()) {
+        file = rest[++i];
+      } else if (rest[i] == "-return_string") {
+        returnString = true;
+      } else {
+        valid = false;
+      }
+    }
+    if (!valid) {
+      Tcl_AppendResult(interp,
+                       "usage: report_timing ?-max_paths <k>? ?-nworst <n>? "
+                       "?-file <path>? ?-return_string?",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    TimingPaths paths;
+    std::string error;
+    if (!compiler->EnumeratePaths(options, paths, error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    std::ostringstream header;
+    header << std::fixed << std::setprecision(3) << "Timing report, "
+           << paths.Size() << " paths, found in " << paths.Seconds() * 1000
+           << "ms\n\n";
+    const Netlist& netlist = compiler->GetDesign()->GetNetlist();
+    if (!file.empty()) {
+      std::ofstream out(file);
+      out << header.str();
+      paths.Report(out, netlist, compiler->GetDesign()->GetTiming());
+      if (!out) {
+        Tcl_AppendResult(interp, "ERROR: Cannot write ", file.c_str(),
+                         nullptr);
+        return TCL_ERROR;
+      }
+    } else if (returnString) {
+      std::ostringstream out;
+      out << header.str();
+      paths.Report(out, netlist, compiler->GetDesign()->GetTiming());
+      Tcl_AppendResult(interp, out.str().c_str(), nullptr);
+    } else {
+      compiler->m_out << header.str();
+      paths.Report(compiler->m_out, netlist,
+                   compiler->GetDesign()->GetTiming());
+      compiler->m_out << std::flush;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("report_timing", report_timing, this, 0);
+
+  // create_corner <name> ?-cell_derate <x>? ?-wire_derate <x>?
+  // ?-clock_period <ns>?: adds a corner to the timing analysis, or
+  // changes it. The cell and net delays are scaled by the derates, the
+  // clock period is the one of the sta stage when not given. Corners are
+  // STA stage options corner.<name>, they follow the design to workers.
+  auto create_corner = [](void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    double cellDerate = 1, wireDerate = 1, clockPeriod = 0;
+    bool valid = argc >= 2 && argc % 2 == 0 && argv[1][0] != '-' &&
+                 std::string(argv[1]).find_first_of(" \t") ==
+                     std::string::npos;
+    for (int i = 2; valid && i < argc; i += 2) {
+      const std::string option = argv[i];
+      double* value = (option == "-cell_derate")    ? &cellDerate
+                      : (option == "-wire_derate")  ? &wireDerate
+                      : (option == "-clock_period") ? &clockPeriod
+                                                    : nullptr;
+      valid = value && Tcl_GetDouble(interp, argv[i + 1], value) == TCL_OK;
+    }
+    if (!valid || cellDerate <= 0 || wireDerate <= 0 || clockPeriod < 0) {
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp,
+                       "usage: create_corner <name> ?-cell_derate <x>? "
+                       "?-wire_derate <x>? ?-clock_period <ns>?",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    std::ostringstream value;
+    value << cellDerate << " " << wireDerate << " " << clockPeriod;
+    compiler->SetStageOption(Action::STA, std::string("corner.") + argv[1],
+                             value.str());
+    return TCL_OK;
+  };
+  interp->registerCmd("create_corner", create_corner, this, 0);
+
+  // get_timing_paths ?-max_paths <k>? ?-nworst <n>? ?-list?: the paths of
+  // report_timing as a collection, walked with foreach_in_collection and
+  // read with get_path_property. Its string, and the result with -list, is
+  // a list of {slack <ns> startpoint <pin> endpoint <pin> arrival <ns>
+  // required <ns> corner <name> pins {<pin>...}}, pins as <cell>/<pin>.
+  auto get_timing_paths = [](void* clientData, Tcl_Interp* interp, int argc,
+                             const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (Compiling(compiler, interp)) return TCL_ERROR;
+    TimingPaths::Options options;
+    std::vector<std::string> rest;
+    bool list = false;
+    bool valid = PathOptions(argc, argv, options, rest);
+    for (size_t i = 0; valid && i < rest.size(); i++) {
+      list = rest[i] == "-list";
+      valid = list;
+    }
+    if (!valid) {
+      Tcl_AppendResult(interp,
+                       "usage: get_timing_paths ?-max_paths <k>? "
+                       "?-nworst <n>? ?-list?",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    TimingPaths paths;
+    std::string error;
+    if (!compiler->EnumeratePaths(options, paths, error)) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    TimingConstraints* constraints = compiler->m_sdc.Constraints(interp);
+    if (constraints == nullptr) return TCL_ERROR;
+    const TimingAnalyzer& timing = compiler->GetDesign()->GetTiming();
+    std::vector<SdcCommands::TimingPath> collected(paths.Size());
+    for (size_t p = 0; p < paths.Size(); p++) {
+      const TimingPaths::Path& path = paths.GetPath(p);
+      Netlist::IdSpan pins = paths.Pins(p);
+      SdcCommands::TimingPath& entry = collected[p];
+      entry.m_slack = path.m_slack;
+      entry.m_arrival = path.m_arrival;
+      entry.m_required = path.m_required;
+      entry.m_corner = timing.GetCorner(path.m_corner).m_name;
+      entry.m_pins.assign(pins.begin(), pins.end());
+    }
+    Tcl_Obj* result =
+        SdcCommands::NewPathCollection(*constraints, std::move(collected));
+    if (list) {
+      Tcl_IncrRefCount(result);
+      Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetString(result), -1));
+      Tcl_DecrRefCount(result);
+      return TCL_OK;
+    }
+    Tcl_SetObjResult(interp, result);
+    return TCL_OK;
+  };
+  interp->registerCmd("get_timing_paths", get_timing_paths, this, 0);
+
+  // SDC: create_clock, set_false_path, get_ports...
+  m_sdc.Register(interp);
+
+  auto set_top_level = [](void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (argc != 2) {
+      Tcl_AppendResult(interp, "usage: set_top_level <module>", nullptr);
+      return TCL_ERROR;
+    }
+    compiler->GetDesign()->TopLevel(argv[1]);
+    return TCL_OK;
+  };
+  interp->registerCmd("set_top_level", set_top_level, this, 0);
+
+  // set_device ?-file <device.xml>? <name>: a device of device.xml, the
+  // one of the current directory by default
+  // set_device -spec {<name> <resource> <count>...}: a device given by its
+  // resource counts (lut, ff, bram, io)
+  auto set_device = [](void* clientData, Tcl_Interp* interp, int argc,
+                       const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    DeviceModel& device = compiler->GetDesign()->GetDevice();
+    std::string error;
+    bool ok = false;
+    if (argc == 3 && std::string(argv[1]) == "-spec") {
+      ok = device.FromSpec(argv[2], error);
+    } else if (argc == 2 && argv[1][0] != '-') {
+      ok = device.Load("device.xml", argv[1], error);
+    } else if (argc == 4 && std::string(argv[1]) == "-file") {
+      ok = device.Load(argv[2], argv[3], error);
+    } else {
+      Tcl_AppendResult(interp,
+                       "usage: set_device ?-file <device.xml>? <name> | "
+                       "-spec {<name> <resource> <count>...}",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    if (!ok) {
+      Tcl_AppendResult(interp, ("ERROR: " + error).c_str(), nullptr);
+      return TCL_ERROR;
+    }
+    return TCL_OK;
+  };
+  interp->registerCmd("set_device", set_device, this, 0);
+
+  auto add_design_file = [](void* clientData, Tcl_Interp* interp, int argc,
+                            const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    Design::Language language = Design::VERILOG_2001;
+    if (argc > 1) NetlistLanguage(argv[1], language);
+    bool known = (argc == 2);
+    for (int i = 0; argc == 3 && i <= Design::VERILOG_NETLIST; i++) {
+      if (std::string(argv[2]) == kLanguageNames[i]) {
+        language = (Design::Language)i;
+        known = true;
+      }
+    }
+    if (!known) {
+      Tcl_AppendResult(interp,
+                       "usage: add_design_file <file> ?<language>?, "
+                       "language is VHDL_1987...SYSTEMVERILOG_2017, BLIF, "
+                       "EBLIF or VERILOG_NETLIST",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    compiler->GetDesign()->AddFile(language, argv[1]);
+    return TCL_OK;
+  };
+  interp->registerCmd("add_design_file", add_design_file, this, 0);
+
+  auto add_constraint_file = [](void* clientData, Tcl_Interp* interp,
+                                int argc, const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (argc != 2) {
+      Tcl_AppendResult(interp, "usage: add_constraint_file <file>", nullptr);
+      return TCL_ERROR;
+    }
+    compiler->GetDesign()->AddConstraintFile(argv[1]);
+    return TCL_OK;
+  };
+  interp->registerCmd("add_constraint_file", add_constraint_file, this, 0);
+
+  auto set_stage_option = [](void* clientData, Tcl_Interp* interp, int argc,
+                             const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    Action stage = (argc == 4) ? StageFromName(argv[1]) : NoAction;
+    if (stage == NoAction) {
+      Tcl_AppendResult(interp, "usage: set_stage_option <stage> <key> <value>",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    compiler->SetStageOption(stage, argv[2], argv[3]);
+    return TCL_OK;
+  };
+  interp->registerCmd("set_stage_option", set_stage_option, this, 0);
+
+  // run_stage <stage>: runs the stage and its stale upstream stages before
+  // returning, 1 on success
+  auto run_stage = [](void* clientData, Tcl_Interp* interp, int argc,
+                      const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    Action stage = (argc == 2) ? StageFromName(argv[1]) : NoAction;
+    if (stage == NoAction) {
+      Tcl_AppendResult(interp,
+                       "usage: run_stage synthesis | global_placement | "
+                       "detailed_placement | routing | sta | bitstream",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    Tcl_AppendResult(interp, compiler->Compile(stage) ? "1" : "0", nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("run_stage", run_stage, this, 0);
+
+  // stage_execution ?in_process | worker? ?-memory <MB>? ?-cpu <seconds>?
+  //                 ?-executable <path>?
+  auto stage_execution = [](void* clientData, Tcl_Interp* interp, int argc,
+                            const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    for (int i = 1; i < argc; i++) {
+      std::string option = argv[i];
+      if (option == "in_process") {
+        compiler->m_outOfProcess = false;
+      } else if (option == "worker" && StageProcess::Supported()) {
+        compiler->m_outOfProcess = true;
+      } else if (option == "-memory" && i + 1 < argc) {
+        if (!GetCount(interp, argv[++i],
+                      compiler->m_processLimits.m_memoryMB)) {
+          return TCL_ERROR;
+        }
+      } else if (option == "-cpu" && i + 1 < argc) {
+        if (!GetCount(interp, argv[++i],
+                      compiler->m_processLimits.m_cpuSeconds)) {
+          return TCL_ERROR;
+        }
+      } else if (option == "-executable" && i + 1 < argc) {
+        compiler->m_workerExecutable = argv[++i];
+      } else {
+        Tcl_AppendResult(interp,
+                         "usage: stage_execution ?in_process | worker? "
+                         "?-memory <MB>? ?-cpu <seconds>? "
+                         "?-executable <path>?",
+                         nullptr);
+        return TCL_ERROR;
+      }
+    }
+    Tcl_AppendResult(interp,
+                     compiler->m_outOfProcess ? "worker" : "in_process",
+                     nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("stage_execution", stage_execution, this, 0);
+
+  // remote_worker ?<host>:<port> | unix:<path> | ""?
+  auto remote_worker = [](void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) -> int {
+    Compiler* compiler = (Compiler*)clientData;
+    if (argc > 2 || (argc == 2 && !JobChannel::Supported())) {
+      Tcl_AppendResult(interp,
+                       "usage: remote_worker ?<host>:<port> | unix:<path>?, "
+                       "an empty address runs locally",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    if (argc == 2) compiler->SetRemoteWorker(argv[1]);
+    Tcl_AppendResult(interp, compiler->RemoteWorker().c_str(), nullptr);
+    return TCL_OK;
+  };
+  interp->registerCmd("remote_worker", remote_worker, this, 0);
+
   if (batchMode) {
     auto synthesize = [](void* clientData, Tcl_Interp* interp, int argc,
                          const char* argv[]) -> int {
       Compiler* compiler = (Compiler*)clientData;
-      compiler->Synthesize();
+      compiler->Compile(Action::Synthesis);
       return 0;
     };
     interp->registerCmd("synthesize", synthesize, this, 0);
@@ -114,14 +873,48 @@ bool Compiler::RegisterCommands(TclInterpreter* interp, bool batchMode) {
     auto globalplacement = [](void* clientData, Tcl_Interp* interp, int argc,
                               const char* argv[]) -> int {
       Compiler* compiler = (Compiler*)clientData;
-      compiler->GlobalPlacement();
+      compiler->Compile(Action::Global);
       return 0;
     };
     interp->registerCmd("global_placement", globalplacement, this, 0);
     interp->registerCmd("globp", globalplacement, this, 0);
 
+    auto placement = [](void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      compiler->Compile(Action::Detailed);
+      return 0;
+    };
+    interp->registerCmd("detailed_placement", placement, this, 0);
+    interp->registerCmd("place", placement, this, 0);
+
+    auto route = [](void* clientData, Tcl_Interp* interp, int argc,
+                    const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      compiler->Compile(Action::Routing);
+      return 0;
+    };
+    interp->registerCmd("route", route, this, 0);
+
+    auto sta = [](void* clientData, Tcl_Interp* interp, int argc,
+                  const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      compiler->Compile(Action::STA);
+      return 0;
+    };
+    interp->registerCmd("sta", sta, this, 0);
+
+    auto bitstream = [](void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      compiler->Compile(Action::Bitream);
+      return 0;
+    };
+    interp->registerCmd("bitstream", bitstream, this, 0);
+
     auto stop = [](void* clientData, Tcl_Interp* interp, int argc,
                    const char* argv[]) -> int {
+      // Only cancels, the stages notice it at their next poll
       for (auto th : ThreadPool::threads) {
         th->stop();
       }
@@ -153,8 +946,49 @@ bool Compiler::RegisterCommands(TclInterpreter* interp, bool batchMode) {
     interp->registerCmd("global_placement", globalplacement, this, 0);
     interp->registerCmd("globp", globalplacement, this, 0);
 
+    auto placement = [](void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      WorkerThread* wthread =
+          new WorkerThread("place_th", Action::Detailed, compiler);
+      wthread->start();
+      return 0;
+    };
+    interp->registerCmd("detailed_placement", placement, this, 0);
+    interp->registerCmd("place", placement, this, 0);
+
+    auto route = [](void* clientData, Tcl_Interp* interp, int argc,
+                    const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      WorkerThread* wthread =
+          new WorkerThread("route_th", Action::Routing, compiler);
+      wthread->start();
+      return 0;
+    };
+    interp->registerCmd("route", route, this, 0);
+
+    auto sta = [](void* clientData, Tcl_Interp* interp, int argc,
+                  const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      WorkerThread* wthread = new WorkerThread("sta_th", Action::STA, compiler);
+      wthread->start();
+      return 0;
+    };
+    interp->registerCmd("sta", sta, this, 0);
+
+    auto bitstream = [](void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) -> int {
+      Compiler* compiler = (Compiler*)clientData;
+      WorkerThread* wthread =
+          new WorkerThread("bitstream_th", Action::Bitream, compiler);
+      wthread->start();
+      return 0;
+    };
+    interp->registerCmd("bitstream", bitstream, this, 0);
+
     auto stop = [](void* clientData, Tcl_Interp* interp, int argc,
                    const char* argv[]) -> int {
+      // Only cancels, the stages notice it at their next poll
       for (auto th : ThreadPool::threads) {
         th->stop();
       }
@@ -207,13 +1041,202 @@ bool Compiler::RegisterCommands(TclInterpreter* interp, bool batchMode) {
   return true;
 }
 
+void Compiler::BuildFlowGraph() {
+  m_flow.AddStage(
+      Action::Synthesis, "Synthesis", {},
+      [this]() {
+        FlowGraph::Fingerprint fp = FlowGraph::Hash(m_design->TopLevel());
+        for (auto& file : m_design->FileList()) {
+          fp = FlowGraph::Hash((FlowGraph::Fingerprint)file.first, fp);
+          fp = m_flow.HashFile(file.second, fp);
+        }
+        return FlowGraph::Hash(HashOptions(Action::Synthesis), fp);
+      },
+      [this]() { return RunStage(Action::Synthesis); });
+  m_flow.AddStage(
+      Action::Global, "Global Placement", {Action::Synthesis},
+      [this]() { return HashConstraints(Action::Global); },
+      [this]() { return RunStage(Action::Global); });
+  m_flow.AddStage(
+      Action::Detailed, "Detailed Placement", {Action::Global},
+      [this]() { return HashConstraints(Action::Detailed); },
+      [this]() { return RunStage(Action::Detailed); });
+  m_flow.AddStage(
+      Action::Routing, "Routing", {Action::Detailed},
+      [this]() { return HashConstraints(Action::Routing); },
+      [this]() { return RunStage(Action::Routing); });
+  m_flow.AddStage(
+      Action::STA, "Timing Analysis", {Action::Routing},
+      [this]() { return HashConstraints(Action::STA); },
+      [this]() { return RunStage(Action::STA); });
+  m_flow.AddStage(
+      Action::Bitream, "Bitstream Generation", {Action::Routing},
+      [this]() { return HashOptions(Action::Bitream); },
+      [this]() { return RunStage(Action::Bitream); });
+
+  for (Action stage : {Action::Synthesis, Action::Global, Action::Detailed,
+                       Action::Routing, Action::STA, Action::Bitream}) {
+    m_flow.SetStageResults(
+        stage, [this, stage]() { return SaveStageResult(stage); },
+        [this, stage](const std::string& payload) {
+          return RestoreStageResult(stage, payload);
+        });
+  }
+  m_flow.SetCache(&m_cache);
+}
+
+std::string Compiler::SaveStageResult(Action stage) {
+  std::ostringstream payload;
+  payload << "stage " << stage << std::endl;
+  payload << "state " << m_state << std::endl;
+  // Binary sections, "<name> <size>" then the bytes: the placement of the
+  // stages from global placement on, the routes of the stages from routing
+  // on
+  CellPlacement& placement = m_design->GetPlacement();
+  if (stage >= Action::Global && !placement.Empty()) {
+    std::string data = placement.Serialize();
+    payload << "placement " << data.size() << std::endl << data;
+  }
+  auto& routing = m_design->GetRouting();
+  if (stage >= Action::Routing && !routing.Empty()) {
+    std::string data = routing.Serialize();
+    payload << "routing " << data.size() << std::endl << data;
+  }
+  return payload.str();
+}
+
+bool Compiler::RestoreStageResult(Action stage, const std::string& payload) {
+  m_design->GetTiming().Clear();
+  std::istringstream in(payload);
+  std::string key;
+  int savedStage = NoAction;
+  int savedState = None;
+  in >> key >> savedStage >> key >> savedState;
+  if (!in || savedStage != stage) return false;
+  // Routes of an earlier placement do not apply
+  if (stage < Action::Routing) m_design->GetRouting().Clear();
+  size_t size = 0;
+  while (in >> key >> size) {
+    in.ignore(1);
+    const size_t offset = (size_t)in.tellg();
+    if (offset + size > payload.size()) return false;
+    std::string_view data = std::string_view(payload).substr(offset, size);
+    if (key == "placement") {
+      if (!m_design->GetPlacement().Deserialize(data)) return false;
+    } else if (key == "routing") {
+      if (!m_design->GetRouting().Deserialize(data)) return false;
+    }
+    in.seekg(offset + size);
+  }
+  // Stopped before the end: not a section header
+  if (!in.eof()) return false;
+  m_state = (State)savedState;
+  return true;
+}
+
+double Compiler::StageOption(Action stage, const std::string& key,
+                             double defaultValue) const {
+  auto options = m_stageOptions.find(stage);
+  if (options == m_stageOptions.end()) return defaultValue;
+  auto option = options->second.find(key);
+  if (option == options->second.end()) return defaultValue;
+  char* end = nullptr;
+  double value = std::strtod(option->second.c_str(), &end);
+  if (end == option->second.c_str()) return defaultValue;
+  return value;
+}
+
+FlowGraph::Fingerprint Compiler::HashOptions(Action stage) {
+  FlowGraph::Fingerprint fp = FlowGraph::kHashSeed;
+  for (auto& option : m_stageOptions[stage]) {
+    fp = FlowGraph::Hash(option.first, fp);
+    fp = FlowGraph::Hash(option.second, fp);
+  }
+  return fp;
+}
+
+// Constraints and the device only feed the stages after synthesis, so that
+// editing them never invalidates the synthesized netlist
+FlowGraph::Fingerprint Compiler::HashConstraints(Action stage) {
+  FlowGraph::Fingerprint fp = HashOptions(stage);
+  fp = FlowGraph::Hash(m_design->GetDevice().Spec(), fp);
+  for (auto& file : m_design->ConstraintFileList()) {
+    fp = m_flow.HashFile(file, fp);
+  }
+  return fp;
+}
+
+void Compiler::ReportMetric(Action stage, const std::string& metric,
+                            double value) {
+  m_metrics[metric] = value;
+  if (m_metricHandler) m_metricHandler(stage, metric, value);
+}
+
+void Compiler::Publish(CompilerEvent::Type type, Action stage,
+                       const char* name, double value) {
+  CompilerEvent event;
+  event.m_type = type;
+  event.m_source = m_eventSource;
+  event.m_stage = stage;
+  event.m_value = value;
+  event.SetName(name);
+  EventBus::Instance()->Publish(event);
+}
+
+// Renders this compiler's events on its output stream and keeps the latest
+// progress of each stage for stage_progress. Runs on the dispatching thread.
+void Compiler::SubscribeConsole() {
+  if (m_consoleSubscriber) return;
+  m_consoleSubscriber =
+      EventBus::Instance()->Subscribe([this](const CompilerEvent& event) {
+        if (event.m_source != m_eventSource) return;
+        std::lock_guard<std::mutex> lock(m_progressMutex);
+        StageProgress& progress = m_progress[event.m_stage];
+        switch (event.m_type) {
+          case CompilerEvent::Phase:
+            progress.m_phase = event.m_name;
+            progress.m_percent = 0;
+            progress.m_eta = -1;
+            break;
+          case CompilerEvent::Eta:
+            progress.m_eta = event.m_value;
+            break;
+          case CompilerEvent::Counter:
+            m_out << event.m_name << ": " << event.m_value << std::endl;
+            break;
+          case CompilerEvent::Progress:
+            progress.m_percent = event.m_value;
+            m_out << std::setw(2) << event.m_value << "%";
+            if (progress.m_eta >= 0) {
+              m_out << " (" << (int)progress.m_eta << "s left)";
+            }
+            m_out << std::endl;
+            break;
+        }
+      });
+}
+
 bool Compiler::Compile(Action action) {
-  m_stop = false;
+  // Nested compiles, of batch, run on the thread of the outer one
+  const std::thread::id outer = m_compileThread.exchange(
+      std::this_thread::get_id());
+  struct Restore {
+    std::atomic<std::thread::id>& m_thread;
+    std::thread::id m_outer;
+    ~Restore() { m_thread = m_outer; }
+  } restore{m_compileThread, outer};
   switch (action) {
     case Action::Synthesis:
-      return Synthesize();
     case Action::Global:
-      return GlobalPlacement();
+    case Action::Detailed:
+    case Action::Routing:
+    case Action::STA:
+    case Action::Bitream:
+      if (!m_remoteWorker.empty() && !m_flow.UpToDate(action) &&
+          !RunRemote(action)) {
+        return false;
+      }
+      return m_flow.Run(action, m_out);
     case Action::Batch:
       return RunBatch();
     default:
@@ -222,39 +1245,491 @@ bool Compiler::Compile(Action action) {
   return false;
 }
 
+// Sections: design.meta (text: top level, sources, state), netlist.*,
+// placement.*, routing.* and one stage.<id> per completed stage
+// ("<fingerprint>\n<stage result>")
+bool Compiler::WriteCheckpoint(const std::string& path, std::string& error) {
+  auto start = std::chrono::steady_clock::now();
+  // Stages run by a worker leave only their results here, the placement
+  // would be saved without the netlist it is indexed by
+  if (m_state >= State::Synthesized && !EnsureNetlist()) {
+    error = "cannot read the netlist of " + m_design->Name();
+    return false;
+  }
+  Netlist& netlist = m_design->GetNetlist();
+  if (!netlist.Finalized()) netlist.Finalize();
+
+  std::ostringstream meta;
+  meta << "name " << m_design->Name() << "\n";
+  meta << "top " << m_design->TopLevel() << "\n";
+  if (!m_design->GetDevice().Spec().empty()) {
+    meta << "device " << m_design->GetDevice().Spec() << "\n";
+  }
+  meta << "state " << m_state << "\n";
+  for (auto& file : m_design->FileList()) {
+    meta << "file " << file.first << " " << file.second << "\n";
+  }
+  for (auto& file : m_design->ConstraintFileList()) {
+    meta << "constraint " << file << "\n";
+  }
+
+  CheckpointWriter writer;
+  bool ok = writer.Open(path) &&
+            writer.WriteSection("design.meta", meta.str().data(),
+                                meta.str().size()) &&
+            netlist.Save(writer) && m_design->GetPlacement().Save(writer) &&
+            m_design->GetRouting().Save(writer);
+  for (int stage = Action::Synthesis; ok && stage <= Action::Bitream;
+       stage++) {
+    FlowGraph::Fingerprint fp = m_flow.LastFingerprint(stage);
+    if (fp == 0) continue;
+    std::string section =
+        std::to_string(fp) + "\n" + SaveStageResult((Action)stage);
+    ok = writer.WriteSection("stage." + std::to_string(stage),
+                             section.data(), section.size());
+  }
+  if (!ok || !writer.Close()) {
+    error = writer.Error().empty() ? "cannot write " + path : writer.Error();
+    return false;
+  }
+  m_out << "Checkpoint " << path << " written in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count()
+        << "ms" << std::endl;
+  return true;
+}
+
+bool Compiler::ReadCheckpoint(const std::string& path, std::string& error) {
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<const MappedCheckpoint> checkpoint =
+      MappedCheckpoint::Open(path, error);
+  if (!checkpoint) return false;
+  if (!checkpoint->Has("design.meta")) {
+    error = path + " has no design";
+    return false;
+  }
+  m_design->GetTiming().Clear();
+  if (!m_design->GetNetlist().Load(checkpoint, error) ||
+      !m_design->GetPlacement().Load(*checkpoint, error) ||
+      !m_design->GetRouting().Load(*checkpoint, error)) {
+    return false;
+  }
+
+  // The sources come back too, they are part of the stage fingerprints
+  std::istringstream meta(std::string(checkpoint->Section("design.meta")));
+  std::string line;
+  int state = None;
+  m_design->FileList().clear();
+  m_design->ConstraintFileList().clear();
+  m_design->GetDevice().Clear();
+  while (std::getline(meta, line)) {
+    size_t space = line.find(' ');
+    std::string key = line.substr(0, space);
+    std::string value =
+        (space == std::string::npos) ? "" : line.substr(space + 1);
+    if (key == "top") {
+      m_design->TopLevel(value);
+    } else if (key == "device") {
+      if (!m_design->GetDevice().FromSpec(value, error)) return false;
+    } else if (key == "state") {
+      state = std::atoi(value.c_str());
+      if (state < None || state > BistreamGenerated) {
+        error = path + ": unknown design state " + value;
+        return false;
+      }
+    } else if (key == "file") {
+      // <language> <path>
+      char* end = nullptr;
+      long language = std::strtol(value.c_str(), &end, 10);
+      if (end == value.c_str() || *end != ' ' ||
+          !Design::IsLanguage((int)language)) {
+        error = path + ": invalid design file " + value;
+        return false;
+      }
+      m_design->AddFile((Design::Language)language,
+                        value.substr(end + 1 - value.c_str()));
+    } else if (key == "constraint") {
+      m_design->AddConstraintFile(value);
+    }
+  }
+
+  for (int stage = Action::Synthesis; stage <= Action::Bitream; stage++) {
+    std::string_view section =
+        checkpoint->Section("stage." + std::to_string(stage));
+    size_t newline = section.find('\n');
+    if (newline == std::string_view::npos) continue;
+    const std::string digits(section.substr(0, newline));
+    char* end = nullptr;
+    errno = 0;
+    FlowGraph::Fingerprint fp = std::strtoull(digits.c_str(), &end, 10);
+    if (digits.empty() || *end != 0 || errno == ERANGE) {
+      error = path + ": stage." + std::to_string(stage) +
+              " has no valid fingerprint";
+      return false;
+    }
+    if (RestoreStageResult((Action)stage,
+                           std::string(section.substr(newline + 1)))) {
+      m_flow.MarkDone(stage, fp);
+    }
+  }
+  m_state = (State)state;
+  Netlist& netlist = m_design->GetNetlist();
+  m_out << "Checkpoint " << path << " loaded in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count()
+        << "ms: " << netlist.CellCount() << " cells, " << netlist.NetCount()
+        << " nets" << std::endl;
+  return true;
+}
+
+void Compiler::EnsureCache() {
+  if (m_cache.Enabled()) return;
+  std::filesystem::path directory = StageCache::UserDirectory();
+  if (directory.empty()) {
+    m_out << "WARNING: no cache directory of the user, worker results are "
+             "lost"
+          << std::endl;
+    return;
+  }
+  directory /= "stage";
+  m_out << "Worker results go through the stage cache, using "
+        << directory.string() << std::endl;
+  m_cache.SetDirectory(directory.string());
+}
+
+// Ships the design, the options and the stage results known locally to the
+// remote worker, which runs the stale stages up to action. The results it
+// sends back land in the cache, from where the local flow restores them.
+bool Compiler::RunRemote(Action action) {
+  EnsureCache();
+  RemoteJob job;
+  std::string error;
+  job.m_secret = WorkerSecret(false, error);
+  if (job.m_secret.empty()) {
+    m_out << "ERROR: " << error << std::endl;
+    return false;
+  }
+  job.m_name = m_design->Name();
+  job.m_top = m_design->TopLevel();
+  job.m_device = m_design->GetDevice().Spec();
+  job.m_action = action;
+  auto readFile = [](const std::string& path, int language) {
+    RemoteJob::File file;
+    file.m_language = language;
+    file.m_path = std::filesystem::absolute(path).string();
+    std::ifstream stream(path, std::ios::binary);
+    file.m_content.assign(std::istreambuf_iterator<char>(stream),
+                          std::istreambuf_iterator<char>());
+    return file;
+  };
+  for (auto& file : m_design->FileList()) {
+    job.m_designFiles.push_back(readFile(file.second, file.first));
+  }
+  for (auto& file : m_design->ConstraintFileList()) {
+    job.m_constraintFiles.push_back(readFile(file, 0));
+  }
+  for (auto& options : m_stageOptions) {
+    job.m_options[options.first] = options.second;
+  }
+  for (int stage = Action::Synthesis; stage <= Action::Bitream; stage++) {
+    std::string key = StageCache::Key(m_flow.ComputeFingerprint(stage));
+    std::string payload;
+    if (m_cache.Load(key, payload)) job.m_results[key] = payload;
+  }
+
+  if (!RunRemoteJob(
+          m_remoteWorker, job, m_out, m_cache,
+          [this](int stage, const std::string& metric, double value) {
+            ReportMetric((Action)stage, metric, value);
+          },
+          m_cancel, error)) {
+    m_out << "ERROR: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Compiler::RunStage(Action stage) {
+  // The timing is the one of the placement and the routes of the design
+  if (stage != Action::STA && stage != Action::Bitream) {
+    m_design->GetTiming().Clear();
+  }
+  if (m_outOfProcess) return RunStageProcess(stage);
+  switch (stage) {
+    case Action::Synthesis:
+      return Synthesize();
+    case Action::Global:
+      return GlobalPlacement();
+    case Action::Detailed:
+      return Placement();
+    case Action::Routing:
+      return Route();
+    case Action::STA:
+      return TimingAnalysis();
+    case Action::Bitream:
+      return GenerateBitstream();
+    default:
+      break;
+  }
+  return false;
+}
+
+// The worker recreates the design from a generated script, runs the stage
+// and stores its result in the stage cache, where it is picked up from.
+// Upstream results reach the worker the same way.
+bool Compiler::RunStageProcess(Action stage) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  EnsureCache();
+  std::string executable = m_workerExecutable;
+  if (executable.empty() && Tcl_GetNameOfExecutable()) {
+    executable = Tcl_GetNameOfExecutable();
+  }
+
+  // Every value is quoted as a list element, whatever braces or brackets
+  // a path or an option holds
+  std::ostringstream script;
+  auto command = [&script](std::initializer_list<std::string> words) {
+    std::vector<const char*> argv;
+    for (const std::string& word : words) argv.push_back(word.c_str());
+    char* merged = Tcl_Merge((int)argv.size(), argv.data());
+    script << merged << "\n";
+    Tcl_Free(merged);
+  };
+  command({"stage_cache", "dir", m_cache.Directory().string()});
+  command({"arch_cache", "dir", RoutingGraphCache::Instance()->Directory()});
+  command({"set_top_level", m_design->TopLevel()});
+  if (!m_design->GetDevice().Spec().empty()) {
+    command({"set_device", "-spec", m_design->GetDevice().Spec()});
+  }
+  for (auto& file : m_design->FileList()) {
+    command({"add_design_file", file.second, kLanguageNames[file.first]});
+  }
+  for (auto& file : m_design->ConstraintFileList()) {
+    command({"add_constraint_file", file});
+  }
+  for (auto& options : m_stageOptions) {
+    for (auto& option : options.second) {
+      command({"set_stage_option", kStageNames[options.first], option.first,
+               option.second});
+    }
+  }
+  script << "exit [expr {[run_stage " << kStageNames[stage]
+         << "] ? 0 : 1}]\n";
+
+  // The worker executes the script: it is created exclusively, in a
+  // directory of the user, so that no one else can plant or swap it
+  std::string scriptPath;
+  const fs::path user = StageCache::UserDirectory();
+  const fs::path directory = user / "scripts";
+  if (!user.empty()) fs::create_directories(directory, ec);
+  if (user.empty() || ec) {
+    m_out << "ERROR: " << m_flow.StageName(stage)
+          << ": no directory of the user for the worker script" << std::endl;
+    return false;
+  }
+#ifndef _WIN32
+  scriptPath = (directory / "stage_XXXXXX.tcl").string();
+  int fd = mkstemps(&scriptPath[0], 4);
+  const std::string content = script.str();
+  bool written = fd >= 0 && write(fd, content.data(), content.size()) ==
+                                (ssize_t)content.size();
+  if (fd >= 0) close(fd);
+  if (!written) {
+    m_out << "ERROR: " << m_flow.StageName(stage) << ": cannot write "
+          << scriptPath << ": " << strerror(errno) << std::endl;
+    if (fd >= 0) fs::remove(scriptPath, ec);
+    return false;
+  }
+#endif
+
+  StageProcess process(m_out, m_processLimits);
+  bool success =
+      process.Start(executable, {"--noqt", "--script", scriptPath});
+  if (success) {
+    process.Stream(m_cancel, m_notifierThread);
+    success = process.Wait();
+  }
+  fs::remove(scriptPath, ec);
+  if (!success) {
+    m_out << "ERROR: " << m_flow.StageName(stage) << ": " << process.Error()
+          << std::endl;
+    return false;
+  }
+  std::string payload;
+  if (!m_cache.Load(StageCache::Key(m_flow.ComputeFingerprint(stage)),
+                    payload) ||
+      !RestoreStageResult(stage, payload)) {
+    m_out << "ERROR: " << m_flow.StageName(stage)
+          << ": no result from the worker" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Compiler::ReadNetlist(std::string& error) {
+  m_design->GetTiming().Clear();
+  NetlistReader::Options options;
+  options.m_top = m_design->TopLevel();
+  options.m_cancel = m_cancel;
+  NetlistReader reader(options);
+  for (auto& file : m_design->FileList()) {
+    if (!Design::IsNetlist(file.first)) continue;
+    reader.AddFile(file.second, file.first == Design::VERILOG_NETLIST
+                                    ? NetlistReader::Verilog
+                                    : NetlistReader::Blif);
+  }
+  Netlist& netlist = m_design->GetNetlist();
+  if (!reader.Read(netlist)) {
+    error = reader.Error();
+    return false;
+  }
+  for (auto& warning : reader.Warnings()) {
+    m_out << "WARNING: " << warning << std::endl;
+  }
+  const NetlistReader::Stats& stats = reader.GetStats();
+  std::ostringstream message;
+  message << std::fixed << std::setprecision(1) << "Netlist read: "
+          << netlist.CellCount() << " cells, " << netlist.NetCount()
+          << " nets from " << stats.m_bytes / 1e6 << "MB in "
+          << stats.m_files << " file(s), " << stats.m_chunks
+          << " chunk(s), parse " << stats.m_parseSeconds * 1000
+          << "ms, elaborate " << stats.m_elaborateSeconds * 1000 << "ms";
+  m_out << message.str() << std::endl;
+  return true;
+}
+
 bool Compiler::Synthesize() {
   m_out << "Synthesizing design: " << m_design->Name() << "..." << std::endl;
-  auto currentPath = std::filesystem::current_path();
-  auto it = std::filesystem::directory_iterator{currentPath};
+  Publish(CompilerEvent::Phase, Action::Synthesis, "Synthesis", 0);
+  Publish(CompilerEvent::Counter, Action::Synthesis, "Design files",
+          (double)m_design->FileList().size());
+  // A new netlist, the placement and routes of the previous one do not
+  // apply
+  m_design->GetPlacement().Clear();
+  m_design->GetRouting().Clear();
+  bool netlistSources = false;
+  for (auto& file : m_design->FileList()) {
+    if (Design::IsNetlist(file.first)) netlistSources = true;
+  }
+  if (netlistSources) {
+    // The design comes synthesized already, reading it is the whole stage
+    for (auto& file : m_design->FileList()) {
+      if (Design::IsNetlist(file.first)) continue;
+      m_out << "WARNING: " << file.second
+            << " ignored, the design is given as a netlist" << std::endl;
+    }
+    std::string error;
+    if (!ReadNetlist(error)) {
+      m_out << "ERROR: " << error << std::endl;
+      return false;
+    }
+    Netlist& netlist = m_design->GetNetlist();
+    Publish(CompilerEvent::Counter, Action::Synthesis, "Cells",
+            (double)netlist.CellCount());
+    Publish(CompilerEvent::Counter, Action::Synthesis, "Nets",
+            (double)netlist.NetCount());
+    Publish(CompilerEvent::Progress, Action::Synthesis, "Synthesis", 100);
+    EventBus::Instance()->Dispatch();
+    m_state = State::Synthesized;
+    m_out << "Design " << m_design->Name() << " is synthesized!" << std::endl;
+    return true;
+  }
+  auto start = std::chrono::steady_clock::now();
   for (int i = 0; i < 100; i = i + 10) {
-    m_out << std::setw(2) << i << "%";
-    if (it != std::filesystem::end(it)) {
-      m_out << " File: " << (*it).path().filename().c_str() << " just for test";
-      it++;
+    if (i > 0) {
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      Publish(CompilerEvent::Eta, Action::Synthesis, "Synthesis",
+              elapsed.count() * (100 - i) / i);
     }
-    m_out << std::endl;
+    Publish(CompilerEvent::Progress, Action::Synthesis, "Synthesis", i);
     std::chrono::milliseconds dura(1000);
     std::this_thread::sleep_for(dura);
-    if (m_stop) return false;
+    if (m_cancel.Cancelled()) return false;
   }
+  EventBus::Instance()->Dispatch();
   m_state = State::Synthesized;
   m_out << "Design " << m_design->Name() << " is synthesized!" << std::endl;
   return true;
 }
 
+bool Compiler::EnsureNetlist() {
+  if (m_design->GetNetlist().CellCount() > 0) return true;
+  bool netlistSources = false;
+  for (auto& file : m_design->FileList()) {
+    if (Design::IsNetlist(file.first)) netlistSources = true;
+  }
+  if (!netlistSources) return true;
+  std::string error;
+  if (!ReadNetlist(error)) {
+    m_out << "ERROR: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
 bool Compiler::GlobalPlacement() {
-  if (m_state != State::Synthesized) {
+  if (m_state < State::Synthesized) {
     m_out << "ERROR: Design needs to be in synthesized state" << std::endl;
     return false;
   }
   m_out << "Global Placement for design: " << m_design->Name() << "..."
         << std::endl;
-  for (int i = 0; i < 100; i = i + 10) {
-    m_out << i << "%" << std::endl;
-    std::chrono::milliseconds dura(1000);
-    std::this_thread::sleep_for(dura);
-    if (m_stop) return false;
+  Publish(CompilerEvent::Phase, Action::Global, "Global Placement", 0);
+  if (!EnsureNetlist()) return false;
+  m_design->GetRouting().Clear();
+  Netlist& netlist = m_design->GetNetlist();
+  CellPlacement& placement = m_design->GetPlacement();
+  if (netlist.CellCount() == 0) {
+    m_out << "WARNING: empty netlist, nothing to place" << std::endl;
+    placement.Clear();
+    Publish(CompilerEvent::Progress, Action::Global, "Global Placement", 100);
+  } else {
+    GlobalPlacer::Options options;
+    options.m_cancel = m_cancel;
+    options.m_threads = (unsigned int)StageOption(Action::Global, "threads", 0);
+    options.m_targetDensity =
+        StageOption(Action::Global, "target_density", options.m_targetDensity);
+    options.m_targetOverflow = StageOption(Action::Global, "target_overflow",
+                                           options.m_targetOverflow);
+    auto start = std::chrono::steady_clock::now();
+    options.m_progress = [this, start](double percent) {
+      if (percent > 0) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        Publish(CompilerEvent::Eta, Action::Global, "Global Placement",
+                elapsed.count() * (100 - percent) / percent);
+      }
+      Publish(CompilerEvent::Progress, Action::Global, "Global Placement",
+              percent);
+    };
+    // Starts from scratch, a previous placement may be of another netlist.
+    // The die is the device, when there is one.
+    const DeviceModel& device = m_design->GetDevice();
+    if (device.Empty()) {
+      placement.Clear();
+    } else {
+      placement.Reset(netlist.CellCount(), device.Columns(), device.Rows());
+    }
+    GlobalPlacer placer(options);
+    if (!placer.Place(netlist, placement)) return false;
+    const GlobalPlacer::Stats& stats = placer.GetStats();
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(3) << "Placed "
+            << stats.m_movable << " cells (" << stats.m_fixed
+            << " fixed) on " << stats.m_bins << "x" << stats.m_bins
+            << " bins in " << stats.m_iterations << " iterations, HPWL "
+            << std::setprecision(0) << stats.m_hpwl << ", overflow "
+            << std::setprecision(3) << stats.m_overflow << ", "
+            << std::setprecision(1) << stats.m_seconds * 1000 << "ms";
+    m_out << message.str() << std::endl;
+    ReportMetric(Action::Global, "hpwl", stats.m_hpwl);
+    ReportMetric(Action::Global, "overflow", stats.m_overflow);
   }
+  EventBus::Instance()->Dispatch();
   m_state = State::GloballyPlaced;
   m_out << "Design " << m_design->Name() << " is globally placed!" << std::endl;
   return true;
@@ -276,10 +1751,475 @@ bool Compiler::RunBatch() {
   return true;
 }
 
-bool Compiler::Placement() { return true; }
+bool Compiler::Legalize(const DeviceModel& device) {
+  Publish(CompilerEvent::Phase, Action::Detailed, "Legalization", 0);
+  Legalizer::Options options;
+  options.m_cancel = m_cancel;
+  options.m_threads =
+      (unsigned int)StageOption(Action::Detailed, "threads", 0);
+  auto mode = m_stageOptions[Action::Detailed].find("legalizer");
+  if (mode != m_stageOptions[Action::Detailed].end()) {
+    if (mode->second == "tetris") {
+      options.m_mode = Legalizer::Tetris;
+    } else if (mode->second != "abacus") {
+      m_out << "ERROR: unknown legalizer " << mode->second
+            << ", expected abacus or tetris" << std::endl;
+      return false;
+    }
+  }
+  Legalizer legalizer(options);
+  if (!legalizer.Place(m_design->GetNetlist(), device,
+                       m_design->GetPlacement())) {
+    if (!legalizer.Error().empty()) {
+      m_out << "ERROR: " << legalizer.Error() << std::endl;
+    }
+    return false;
+  }
+  const Legalizer::Stats& stats = legalizer.GetStats();
+  std::ostringstream message;
+  message << std::fixed << std::setprecision(2) << "Legalized "
+          << stats.m_cells << " cells (" << stats.m_moved
+          << " moved), displacement average " << stats.m_averageDisplacement
+          << " max " << stats.m_maxDisplacement << " sites, HPWL "
+          << std::setprecision(0) << stats.m_initialHpwl << " -> "
+          << stats.m_hpwl << ", " << std::setprecision(1)
+          << stats.m_seconds * 1000 << "ms";
+  m_out << message.str() << std::endl;
+  ReportMetric(Action::Detailed, "average_displacement",
+               stats.m_averageDisplacement);
+  ReportMetric(Action::Detailed, "max_displacement",
+               stats.m_maxDisplacement);
+  return true;
+}
+
+bool Compiler::Placement() {
+  if (m_state < State::GloballyPlaced) {
+    m_out << "ERROR: Design needs to be in globally placed state"
+          << std::endl;
+    return false;
+  }
+  m_out << "Detailed Placement for design: " << m_design->Name() << "..."
+        << std::endl;
+  Publish(CompilerEvent::Phase, Action::Detailed, "Detailed Placement", 0);
+  if (!EnsureNetlist()) return false;
+  m_design->GetRouting().Clear();
+  Netlist& netlist = m_design->GetNetlist();
+  CellPlacement& placement = m_design->GetPlacement();
+  if (netlist.CellCount() == 0) {
+    m_out << "WARNING: empty netlist, nothing to place" << std::endl;
+    Publish(CompilerEvent::Progress, Action::Detailed, "Detailed Placement",
+            100);
+  } else {
+    // Without a device, a generic grid of sites covering the die
+    const DeviceModel* device = &m_design->GetDevice();
+    DeviceModel generic;
+    if (device->Empty()) {
+      generic.BuildGeneric(
+          (uint32_t)std::floor(placement.Width() + 1e-6),
+          (uint32_t)std::floor(placement.Height() + 1e-6));
+      device = &generic;
+    }
+    if (!Legalize(*device)) return false;
+    Publish(CompilerEvent::Phase, Action::Detailed, "Detailed Placement", 0);
+
+    DetailedPlacer::Options options;
+    options.m_device = device;
+    options.m_cancel = m_cancel;
+    options.m_threads =
+        (unsigned int)StageOption(Action::Detailed, "threads", 0);
+    options.m_passes =
+        (int)StageOption(Action::Detailed, "passes", options.m_passes);
+    options.m_seed =
+        (uint64_t)StageOption(Action::Detailed, "seed", options.m_seed);
+    auto start = std::chrono::steady_clock::now();
+    options.m_progress = [this, start](double percent) {
+      if (percent > 0) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        Publish(CompilerEvent::Eta, Action::Detailed, "Detailed Placement",
+                elapsed.count() * (100 - percent) / percent);
+      }
+      Publish(CompilerEvent::Progress, Action::Detailed, "Detailed Placement",
+              percent);
+    };
+    DetailedPlacer placer(options);
+    if (!placer.Place(netlist, placement)) {
+      if (!placer.Error().empty()) {
+        m_out << "ERROR: " << placer.Error() << std::endl;
+      }
+      return false;
+    }
+    const DetailedPlacer::Stats& stats = placer.GetStats();
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(0) << "Refined "
+            << stats.m_movable << " cells (" << stats.m_snapped
+            << " snapped to sites) in " << stats.m_passes << " passes, "
+            << stats.m_matched << " matched, " << stats.m_swapped
+            << " swapped, HPWL " << stats.m_initialHpwl << " -> "
+            << stats.m_hpwl << ", " << std::setprecision(1)
+            << stats.m_seconds * 1000 << "ms";
+    m_out << message.str() << std::endl;
+    ReportMetric(Action::Detailed, "hpwl", stats.m_hpwl);
+  }
+  EventBus::Instance()->Dispatch();
+  m_state = State::Placed;
+  m_out << "Design " << m_design->Name() << " is placed!" << std::endl;
+  return true;
+}
+
+bool Compiler::Route() {
+  if (m_state < State::Placed) {
+    m_out << "ERROR: Design needs to be in placed state" << std::endl;
+    return false;
+  }
+  m_out << "Routing for design: " << m_design->Name() << "..." << std::endl;
+  Publish(CompilerEvent::Phase, Action::Routing, "Routing", 0);
+  if (!EnsureNetlist()) return false;
+  Netlist& netlist = m_design->GetNetlist();
+  CellPlacement& placement = m_design->GetPlacement();
+  auto& routing = m_design->GetRouting();
+  routing.Clear();
+  if (netlist.CellCount() == 0) {
+    m_out << "WARNING: empty netlist, nothing to route" << std::endl;
+    Publish(CompilerEvent::Progress, Action::Routing, "Routing", 100);
+  } else {
+    DeviceModel generic;
+    const DeviceModel* device = &RoutingDevice(generic);
+    const uint32_t channelWidth = (uint32_t)StageOption(
+        Action::Routing, "channel_width", RoutingGraph::kDefaultChannelWidth);
+    auto start = std::chrono::steady_clock::now();
+    RoutingGraphCache* cache = RoutingGraphCache::Instance();
+    const RoutingGraphCache::Stats before = cache->GetStats();
+    std::string error;
+    std::shared_ptr<const RoutingGraph> graph =
+        cache->Get(*device, channelWidth, error);
+    if (!graph) {
+      m_out << "ERROR: " << error << std::endl;
+      return false;
+    }
+    const RoutingGraphCache::Stats after = cache->GetStats();
+    const char* origin = after.m_built != before.m_built     ? "built"
+                         : after.m_loaded != before.m_loaded ? "mapped"
+                                                             : "shared";
+    m_out << "Routing graph: " << graph->Columns() << "x" << graph->Rows()
+          << " tiles, " << channelWidth << " tracks ("
+          << graph->Tracks(RoutingGraph::L1) << " L1, "
+          << graph->Tracks(RoutingGraph::L4) << " L4), "
+          << graph->NodeCount() << " nodes, " << graph->EdgeCount()
+          << " edges, " << origin << " in "
+          << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count()
+          << "ms" << std::endl;
+
+    Router::Options options;
+    options.m_cancel = m_cancel;
+    options.m_threads =
+        (unsigned int)StageOption(Action::Routing, "threads", 0);
+    if (StageOption(Action::Routing, "lookahead", 1) != 0) {
+      start = std::chrono::steady_clock::now();
+      const uint64_t computed = cache->GetStats().m_lookaheadsComputed;
+      options.m_lookahead =
+          cache->GetLookahead(*device, *graph, options.m_threads);
+      m_out << "Router lookahead: "
+            << (cache->GetStats().m_lookaheadsComputed != computed
+                    ? "computed"
+                    : "reused")
+            << " in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << "ms" << std::endl;
+    }
+    options.m_maxIterations = (int)StageOption(
+        Action::Routing, "max_iterations", options.m_maxIterations);
+    options.m_astarFactor =
+        StageOption(Action::Routing, "astar_factor", options.m_astarFactor);
+    options.m_iteration = [this](const auto& iteration) {
+      std::ostringstream message;
+      message << std::fixed << std::setprecision(1) << "Iteration "
+              << iteration.m_iteration << ": " << iteration.m_rerouted
+              << " nets routed, " << iteration.m_overused
+              << " overused nodes, wirelength " << iteration.m_wirelength
+              << ", " << iteration.m_expanded << " nodes expanded, "
+              << iteration.m_seconds * 1000 << "ms";
+      m_out << message.str() << std::endl;
+      Publish(CompilerEvent::Counter, Action::Routing, "Overused nodes",
+              (double)iteration.m_overused);
+    };
+    // Connections as critical as their slack on the placement estimate,
+    // instead of their length, then on the delays of the routes every
+    // timing_update iterations
+    const bool timingDriven =
+        StageOption(Action::Routing, "timing_driven", 1) != 0;
+    if (timingDriven) {
+      if (!AnalyzeTiming(false, error)) {
+        m_out << "ERROR: " << error << std::endl;
+        return false;
+      }
+      const TimingAnalyzer::Summary& summary =
+          m_design->GetTiming().GetSummary();
+      std::ostringstream message;
+      message << std::fixed << std::setprecision(3)
+              << "Placement timing estimate: WNS " << summary.m_wns
+              << "ns, TNS " << summary.m_tns << "ns";
+      m_out << message.str() << std::endl;
+      options.m_criticality = m_design->GetTiming().Criticalities();
+      // Most connections of a failing design are near the worst slack:
+      // capped below the length criticalities so that congestion still
+      // settles within the iterations
+      options.m_maxCriticality =
+          (float)StageOption(Action::Routing, "max_criticality", 0.5);
+      options.m_timingInterval = (int)StageOption(
+          Action::Routing, "timing_update", options.m_timingInterval);
+      options.m_timingUpdate = [this, &placement, &graph](
+                                   const FOEDAG::Routing& routes,
+                                   std::vector<float>& criticality) {
+        TimingAnalyzer& timing = m_design->GetTiming();
+        timing.SetRoutedDelays(placement, *graph, routes);
+        timing.Update(TimingOptions());
+        criticality = timing.Criticalities();
+      };
+    }
+    Router router(options);
+    if (!router.Route(netlist, placement, *graph, routing)) {
+      if (!router.Error().empty()) {
+        m_out << "ERROR: " << router.Error() << std::endl;
+      }
+      return false;
+    }
+    const Router::Stats& stats = router.GetStats();
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(1) << "Routed "
+            << stats.m_nets << " nets (" << stats.m_connections
+            << " connections, " << stats.m_regions << " regions) in "
+            << stats.m_iterations << " iterations, wirelength "
+            << stats.m_wirelength << ", " << stats.m_seconds * 1000 << "ms";
+    m_out << message.str() << std::endl;
+    ReportMetric(Action::Routing, "wirelength", (double)stats.m_wirelength);
+    ReportMetric(Action::Routing, "route_iterations", stats.m_iterations);
+    // The analysis times the final routes, not the ones of the last update
+    if (timingDriven && !AnalyzeTiming(true, error)) {
+      m_out << "ERROR: " << error << std::endl;
+      return false;
+    }
+    Publish(CompilerEvent::Progress, Action::Routing, "Routing", 100);
+  }
+  EventBus::Instance()->Dispatch();
+  m_state = State::Routed;
+  m_out << "Design " << m_design->Name() << " is routed!" << std::endl;
+  return true;
+}
+
+const DeviceModel& Compiler::RoutingDevice(DeviceModel& generic) {
+  if (!m_design->GetDevice().Empty()) return m_design->GetDevice();
+  CellPlacement& placement = m_design->GetPlacement();
+  generic.BuildGeneric((uint32_t)std::floor(placement.Width() + 1e-6),
+                       (uint32_t)std::floor(placement.Height() + 1e-6));
+  return generic;
+}
+
+bool Compiler::AnalyzeTiming(bool routed, std::string& error) {
+  if (!EnsureNetlist()) {
+    error = "no netlist";
+    return false;
+  }
+  Netlist& netlist = m_design->GetNetlist();
+  CellPlacement& placement = m_design->GetPlacement();
+  auto& routing = m_design->GetRouting();
+  TimingAnalyzer& timing = m_design->GetTiming();
+  TimingConstraints* constraints = Constraints(error);
+  if (constraints == nullptr) return false;
+  // Constraints out of the graph again only when they changed
+  if (!timing.Built(netlist) ||
+      m_timedConstraints != constraints->Revision()) {
+    timing.Build(netlist);
+    std::vector<std::pair<Netlist::PinId, float>> delays;
+    std::vector<Netlist::PinId> falseFrom, falseTo;
+    constraints->TimingPins(delays, falseFrom, falseTo);
+    timing.Constrain(delays, falseFrom, falseTo);
+    constraints->FalsePathPairs(m_falsePaths);
+    m_timedConstraints = constraints->Revision();
+    // Stored constraints the analysis does not apply are not silent
+    size_t ignored[TimingConstraints::MulticyclePath + 1];
+    constraints->IgnoredExceptions(ignored);
+    std::string list;
+    const char* commands[] = {"set_false_path (-through or clocks)",
+                              "set_max_delay", "set_multicycle_path"};
+    for (int type = TimingConstraints::FalsePath;
+         type <= TimingConstraints::MulticyclePath; type++) {
+      if (ignored[type] == 0) continue;
+      list += (list.empty() ? "" : ", ") + std::to_string(ignored[type]) +
+              " " + commands[type];
+    }
+    if (!list.empty()) {
+      m_out << "WARNING: timing analysis ignores " << list << std::endl;
+    }
+    if (!m_falsePaths.empty()) {
+      m_out << "WARNING: " << m_falsePaths.size()
+            << " set_false_path -from -to only apply to report_timing and "
+               "get_timing_paths, endpoint slacks still count them"
+            << std::endl;
+    }
+  }
+  timing.SetCorners(TimingCorners());
+  if (routed && !routing.Empty()) {
+    DeviceModel generic;
+    std::shared_ptr<const RoutingGraph> graph =
+        RoutingGraphCache::Instance()->Get(RoutingDevice(generic),
+                                           routing.ChannelWidth(), error);
+    if (!graph) return false;
+    timing.SetRoutedDelays(placement, *graph, routing);
+  } else {
+    timing.SetPlacedDelays(placement);
+  }
+  timing.Update(TimingOptions());
+  m_movedCells.clear();
+  return true;
+}
+
+bool Compiler::UpdateTiming(bool incremental, std::string& error) {
+  TimingAnalyzer& timing = m_design->GetTiming();
+  Netlist& netlist = m_design->GetNetlist();
+  const TimingConstraints& constraints = m_design->GetConstraints();
+  if (!incremental || !timing.Built(netlist) ||
+      !constraints.Bound(netlist) ||
+      m_timedConstraints != constraints.Revision()) {
+    return AnalyzeTiming(m_state >= State::Routed, error);
+  }
+  std::vector<Netlist::NetId> nets;
+  for (Netlist::CellId cell : m_movedCells) {
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      if (netlist.PinNet(pin) != Netlist::kNone) {
+        nets.push_back(netlist.PinNet(pin));
+      }
+    }
+  }
+  std::sort(nets.begin(), nets.end());
+  nets.erase(std::unique(nets.begin(), nets.end()), nets.end());
+  // Along the routes when the analysis to update had them
+  std::shared_ptr<const RoutingGraph> graph;
+  auto& routing = m_design->GetRouting();
+  if (timing.GetSummary().m_routedDelays) {
+    DeviceModel generic;
+    graph = RoutingGraphCache::Instance()->Get(RoutingDevice(generic),
+                                               routing.ChannelWidth(), error);
+    if (!graph) return false;
+  }
+  // New corners time everything again
+  timing.SetCorners(TimingCorners());
+  timing.SetNetDelays(nets, m_design->GetPlacement(), graph.get(),
+                      graph ? &routing : nullptr);
+  timing.UpdateIncremental(TimingOptions());
+  m_movedCells.clear();
+  return true;
+}
+
+bool Compiler::EnumeratePaths(TimingPaths::Options options,
+                              TimingPaths& paths, std::string& error) {
+  if (m_state < State::Placed) {
+    error = "Design needs to be in placed state";
+    return false;
+  }
+  if (!UpdateTiming(true, error)) return false;
+  options.m_threads = TimingOptions().m_threads;
+  options.m_falsePaths = &m_falsePaths;
+  paths.Enumerate(m_design->GetTiming(), options);
+  return true;
+}
+
+// Stage options corner.<name> of the STA stage, "<cell derate> <wire
+// derate> <clock period>" each
+std::vector<TimingAnalyzer::Corner> Compiler::TimingCorners() const {
+  std::vector<TimingAnalyzer::Corner> corners;
+  auto options = m_stageOptions.find(Action::STA);
+  if (options == m_stageOptions.end()) return corners;
+  const std::string prefix = "corner.";
+  for (auto& option : options->second) {
+    if (option.first.compare(0, prefix.size(), prefix) != 0) continue;
+    TimingAnalyzer::Corner corner;
+    corner.m_name = option.first.substr(prefix.size());
+    std::istringstream(option.second) >> corner.m_cellDerate >>
+        corner.m_wireDerate >> corner.m_clockPeriod;
+    corners.push_back(corner);
+  }
+  return corners;
+}
 
-bool Compiler::Route() { return true; }
+TimingAnalyzer::Options Compiler::TimingOptions() {
+  TimingAnalyzer::Options options;
+  options.m_clockPeriod =
+      StageOption(Action::STA, "clock_period", options.m_clockPeriod);
+  // The fastest SDC clock first
+  const TimingConstraints& constraints = m_design->GetConstraints();
+  if (constraints.Bound(m_design->GetNetlist())) {
+    options.m_clockPeriod = constraints.ClockPeriod(options.m_clockPeriod);
+  }
+  options.m_threads = (unsigned int)StageOption(Action::STA, "threads", 0);
+  return options;
+}
 
-bool Compiler::TimingAnalysis() { return true; }
+TimingConstraints* Compiler::Constraints(std::string& error) {
+  if (!EnsureNetlist()) {
+    error = "no netlist";
+    return nullptr;
+  }
+  Netlist& netlist = m_design->GetNetlist();
+  TimingConstraints& constraints = m_design->GetConstraints();
+  if (constraints.Bound(netlist)) return &constraints;
+  // Bound first, the commands of the files find it so
+  constraints.Bind(netlist);
+  for (const std::string& file : m_design->ConstraintFileList()) {
+    std::string extension = std::filesystem::path(file).extension().string();
+    for (char& c : extension) c = (char)std::tolower((unsigned char)c);
+    if (extension != ".sdc") continue;
+    if (!m_sdc.ReadFile(file, error)) {
+      constraints.Unbind();
+      return nullptr;
+    }
+  }
+  return &constraints;
+}
 
-bool Compiler::GenerateBitstream() { return true; }
+bool Compiler::TimingAnalysis() {
+  if (m_state < State::Routed) {
+    m_out << "ERROR: Design needs to be in routed state" << std::endl;
+    return false;
+  }
+  m_out << "Timing analysis for design: " << m_design->Name() << "..."
+        << std::endl;
+  Publish(CompilerEvent::Phase, Action::STA, "Timing Analysis", 0);
+  std::string error;
+  if (!AnalyzeTiming(true, error)) {
+    m_out << "ERROR: " << error << std::endl;
+    return false;
+  }
+  const TimingAnalyzer& timing = m_design->GetTiming();
+  const TimingAnalyzer::Summary& summary = timing.GetSummary();
+  std::ostringstream message;
+  message << std::fixed << std::setprecision(3) << "WNS " << summary.m_wns
+          << "ns, TNS " << summary.m_tns << "ns, "
+          << summary.m_failingEndpoints << " of " << summary.m_endpoints
+          << " endpoints failing, " << timing.LevelCount() << " levels, "
+          << summary.m_seconds * 1000 << "ms";
+  for (size_t c = 0; timing.CornerCount() > 1 && c < timing.CornerCount();
+       c++) {
+    const TimingAnalyzer::Summary& corner = timing.CornerSummary(c);
+    message << "\n  Corner " << timing.GetCorner(c).m_name << ": WNS "
+            << corner.m_wns << "ns, TNS " << corner.m_tns << "ns";
+  }
+  m_out << message.str() << std::endl;
+  ReportMetric(Action::STA, "wns", summary.m_wns);
+  ReportMetric(Action::STA, "tns", summary.m_tns);
+  Publish(CompilerEvent::Progress, Action::STA, "Timing Analysis", 100);
+  EventBus::Instance()->Dispatch();
+  m_state = State::TimingAnalyzed;
+  m_out << "Design " << m_design->Name() << " timing is analyzed!"
+        << std::endl;
+  return true;
+}
+
+bool Compiler::GenerateBitstream() {
+  m_state = State::BistreamGenerated;
+  return true;
+}
@@ -19,14 +19,25 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "Command/Command.h"
 #include "Command/CommandStack.h"
 #include "Compiler/Design.h"
+#include "Compiler/EventBus.h"
+#include "Compiler/FlowGraph.h"
+#include "Compiler/SdcCommands.h"
+#include "Compiler/StageCache.h"
+#include "Compiler/StageProcess.h"
+#include "Compiler/TaskScheduler.h"
+#include "Compiler/TimingPaths.h"
 #include "Main/CommandLine.h"
 #include "Tcl/TclInterpreter.h"
 
@@ -58,18 +69,48 @@ class Compiler {
     BistreamGenerated
   };
 
+  static constexpr const char* kCompilingError =
+      "a compilation is running, wait for it or stop it first";
+
   Compiler(TclInterpreter* interp, Design* design, std::ostream& out,
            TclInterpreterHandler* tclInterpreterHandler = nullptr)
       : m_interp(interp),
         m_design(design),
         m_out(out),
-        m_tclInterpreterHandler(tclInterpreterHandler) {}
+        m_tclInterpreterHandler(tclInterpreterHandler),
+        m_eventSource(EventBus::Instance()->NewSource()),
+        m_sdc([this](std::string& error) -> TimingConstraints* {
+          if (CompilingElsewhere()) {
+            error = kCompilingError;
+            return nullptr;
+          }
+          return Constraints(error);
+        }, out) {
+    BuildFlowGraph();
+  }
 
   ~Compiler();
   void BatchScript(const std::string& script) { m_batchScript = script; }
   State CompilerState() { return m_state; }
   bool Compile(Action action);
-  void Stop() { m_stop = true; }
+  // True while a Compile() runs on another thread than the caller's, the
+  // design must not be queried nor edited then
+  bool CompilingElsewhere() const {
+    const std::thread::id thread = m_compileThread;
+    return thread != std::thread::id() &&
+           thread != std::this_thread::get_id();
+  }
+  void Stop() { m_cancel.Cancel(); }
+  // Polled by the stages, share a token to cancel several compilers at once
+  CancellationToken& Cancellation() { return m_cancel; }
+  void SetCancellationToken(const CancellationToken& token) {
+    m_cancel = token;
+  }
+  // Last Compile() started on a thread of its own, which holds the
+  // compiler: the destructor stops it and waits for it
+  JobHandle<bool>& BackgroundJob() { return m_backgroundJob; }
+  // Source id of the progress events this compiler publishes on the EventBus
+  uint32_t EventSource() const { return m_eventSource; }
   TclInterpreter* TclInterp() { return m_interp; }
   Design* GetDesign() { return m_design; }
   bool RegisterCommands(TclInterpreter* interp, bool batchMode);
@@ -84,15 +125,118 @@ class Compiler {
 
   std::string& getResult() { return m_result; }
 
+  // Options of a stage, part of the stage fingerprint
+  void SetStageOption(Action stage, const std::string& key,
+                      const std::string& value) {
+    m_stageOptions[stage][key] = value;
+  }
+  // Stage from its Tcl name (synthesis, global_placement...), NoAction if
+  // unknown
+  static Action StageFromName(const std::string& name);
+  // Numeric value of a stage option, defaultValue when unset or not a number
+  double StageOption(Action stage, const std::string& key,
+                     double defaultValue) const;
+  FlowGraph& Flow() { return m_flow; }
+  // Saves the netlist and the results of the completed stages; reading the
+  // checkpoint back maps it and marks those stages done
+  bool WriteCheckpoint(const std::string& path, std::string& error);
+  bool ReadCheckpoint(const std::string& path, std::string& error);
+  // Reads the netlist sources of the design (BLIF, EBLIF, structural
+  // Verilog) into its Netlist
+  bool ReadNetlist(std::string& error);
+  // Runs the stages on a JobServer instead of locally, empty for local
+  void SetRemoteWorker(const std::string& address) {
+    m_remoteWorker = address;
+  }
+  const std::string& RemoteWorker() const { return m_remoteWorker; }
+  StageCache& Cache() { return m_cache; }
+
+  // Quality of results reported by the stages (hpwl, wns...), forwarded
+  // to the metric handler with the stage reporting them as soon as they
+  // are known. Several stages report some metrics, hpwl for instance.
+  typedef std::function<void(Action, const std::string&, double)>
+      MetricHandler;
+  void SetMetricHandler(MetricHandler handler) { m_metricHandler = handler; }
+  void ReportMetric(Action stage, const std::string& metric, double value);
+  const std::map<std::string, double>& Metrics() const { return m_metrics; }
+
  private:
+  void BuildFlowGraph();
+  FlowGraph::Fingerprint HashOptions(Action stage);
+  FlowGraph::Fingerprint HashConstraints(Action stage);
+  std::string SaveStageResult(Action stage);
+  bool RestoreStageResult(Action stage, const std::string& payload);
+  void Publish(CompilerEvent::Type type, Action stage, const char* name,
+               double value);
+  void SubscribeConsole();
+  // Dispatches to the stage implementations, in a worker process if enabled
+  bool RunStage(Action stage);
+  bool RunStageProcess(Action stage);
+  bool RunRemote(Action action);
+  void EnsureCache();
+  // The netlist does not travel with the stage results: a worker, or a flow
+  // restored from the cache, reads it again from the sources when needed
+  bool EnsureNetlist();
+  // First step of detailed placement, snaps the global placement to sites
+  bool Legalize(const DeviceModel& device);
+  // Device of the routing graph: the target device, or a generic one the
+  // size of the die of the generic placement, built in generic
+  const DeviceModel& RoutingDevice(DeviceModel& generic);
+  // Analyzes the timing of the placed design, with the net delays of its
+  // routes when routed is set and the design has some
+  bool AnalyzeTiming(bool routed, std::string& error);
+  // Re-times the nets of the cells moved since the last analysis only
+  // when incremental, a full AnalyzeTiming() otherwise or when there is
+  // none to start from
+  bool UpdateTiming(bool incremental, std::string& error);
+  TimingAnalyzer::Options TimingOptions();
+  // Constraints of the netlist, bound to it and the .sdc constraint files
+  // of the design read on first use
+  TimingConstraints* Constraints(std::string& error);
+  // Corners of the sta stage options, none for the nominal one only
+  std::vector<TimingAnalyzer::Corner> TimingCorners() const;
+  // Worst paths of the placed design, timed again first when needed
+  bool EnumeratePaths(TimingPaths::Options options, TimingPaths& paths,
+                      std::string& error);
+
+
   TclInterpreter* m_interp = nullptr;
   Design* m_design = nullptr;
-  bool m_stop = false;
+  CancellationToken m_cancel;
+  JobHandle<bool> m_backgroundJob;
+  std::atomic<std::thread::id> m_compileThread{std::thread::id()};
   State m_state = None;
   std::ostream& m_out;
   std::string m_batchScript;
   std::string m_result;
   TclInterpreterHandler* m_tclInterpreterHandler;
+  FlowGraph m_flow;
+  StageCache m_cache;
+  std::map<Action, std::map<std::string, std::string>> m_stageOptions;
+  std::map<std::string, double> m_metrics;
+  MetricHandler m_metricHandler;
+  bool m_outOfProcess = false;
+  StageProcess::Limits m_processLimits;
+  std::string m_workerExecutable;
+  std::string m_remoteWorker;
+  Tcl_ThreadId m_notifierThread = nullptr;
+  uint32_t m_eventSource = 0;
+  int m_consoleSubscriber = 0;
+  struct StageProgress {
+    std::string m_phase;
+    double m_percent = 0;
+    double m_eta = -1;
+  };
+  std::mutex m_progressMutex;
+  std::map<int, StageProgress> m_progress;
+  // Moved by move_cell since the last timing analysis
+  std::vector<Netlist::CellId> m_movedCells;
+  SdcCommands m_sdc;
+  // Revision of the constraints the timing graph has
+  uint64_t m_timedConstraints = 0;
+  // Pin sets of the false paths between a -from and a -to list of those
+  // constraints, skipped by the path commands
+  std::vector<TimingPaths::PinSets> m_falsePaths;
 };
 
 }  // namespace FOEDAG
@@ -0,0 +1,280 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/DelayCalculator.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define DELAY_SSE2 1
+// GCC and clang build the AVX2 kernel whatever the target, and only call
+// it on CPUs that have AVX2
+#if defined(__GNUC__) || defined(__AVX2__)
+#define DELAY_AVX2 1
+#endif
+#endif
+
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+using namespace FOEDAG;
+
+namespace {
+constexpr uint32_t kRow = (uint32_t)DelayCalculator::kMaxPoints;
+
+#ifdef DELAY_SSE2
+// Same operations, same order as DelayCalculator::Lookup()
+template <typename Table>
+void EvaluateSse2(const Table& table, const float* slews,
+                  const float* loads, float* values, size_t count) {
+  alignas(16) int32_t row[4], column[4];
+  alignas(16) float x0[4], sx[4], y0[4], sy[4], v00[4], v01[4], v10[4],
+      v11[4];
+  for (size_t n = 0; n < count; n += 4) {
+    const __m128 slew = _mm_loadu_ps(slews + n);
+    const __m128 load = _mm_loadu_ps(loads + n);
+    // Index of the interval: the inner axis points at or below the value
+    __m128i i = _mm_setzero_si128();
+    for (uint32_t k = 1; k + 1 < table.m_slews; k++) {
+      const __m128 point = _mm_set1_ps(table.m_slew[k]);
+      i = _mm_sub_epi32(i, _mm_castps_si128(_mm_cmple_ps(point, slew)));
+    }
+    __m128i j = _mm_setzero_si128();
+    for (uint32_t k = 1; k + 1 < table.m_loads; k++) {
+      const __m128 point = _mm_set1_ps(table.m_load[k]);
+      j = _mm_sub_epi32(j, _mm_castps_si128(_mm_cmple_ps(point, load)));
+    }
+    _mm_store_si128((__m128i*)row, i);
+    _mm_store_si128((__m128i*)column, j);
+    for (int lane = 0; lane < 4; lane++) {
+      const int32_t r = row[lane], c = column[lane];
+      const float* value = table.m_value + r * kRow + c;
+      x0[lane] = table.m_slew[r];
+      sx[lane] = table.m_slewScale[r];
+      y0[lane] = table.m_load[c];
+      sy[lane] = table.m_loadScale[c];
+      v00[lane] = value[0];
+      v01[lane] = value[1];
+      v10[lane] = value[kRow];
+      v11[lane] = value[kRow + 1];
+    }
+    const __m128 tx = _mm_mul_ps(_mm_sub_ps(slew, _mm_load_ps(x0)),
+                                 _mm_load_ps(sx));
+    const __m128 ty = _mm_mul_ps(_mm_sub_ps(load, _mm_load_ps(y0)),
+                                 _mm_load_ps(sy));
+    const __m128 a = _mm_load_ps(v00), b = _mm_load_ps(v01);
+    const __m128 low =
+        _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(v10), a), tx));
+    const __m128 high =
+        _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(v11), b), tx));
+    _mm_storeu_ps(values + n,
+                  _mm_add_ps(low, _mm_mul_ps(_mm_sub_ps(high, low), ty)));
+  }
+}
+#endif
+
+#ifdef DELAY_AVX2
+template <typename Table>
+AVX2_TARGET void EvaluateAvx2(const Table& table, const float* slews,
+                              const float* loads, float* values,
+                              size_t count) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i row = _mm256_set1_epi32((int)kRow);
+  for (size_t n = 0; n < count; n += 8) {
+    const __m256 slew = _mm256_loadu_ps(slews + n);
+    const __m256 load = _mm256_loadu_ps(loads + n);
+    __m256i i = _mm256_setzero_si256();
+    for (uint32_t k = 1; k + 1 < table.m_slews; k++) {
+      const __m256 point = _mm256_set1_ps(table.m_slew[k]);
+      i = _mm256_sub_epi32(
+          i, _mm256_castps_si256(_mm256_cmp_ps(point, slew, _CMP_LE_OQ)));
+    }
+    __m256i j = _mm256_setzero_si256();
+    for (uint32_t k = 1; k + 1 < table.m_loads; k++) {
+      const __m256 point = _mm256_set1_ps(table.m_load[k]);
+      j = _mm256_sub_epi32(
+          j, _mm256_castps_si256(_mm256_cmp_ps(point, load, _CMP_LE_OQ)));
+    }
+    const __m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(i, row), j);
+    const __m256i below = _mm256_add_epi32(cell, row);
+    const __m256 tx = _mm256_mul_ps(
+        _mm256_sub_ps(slew, _mm256_i32gather_ps(table.m_slew, i, 4)),
+        _mm256_i32gather_ps(table.m_slewScale, i, 4));
+    const __m256 ty = _mm256_mul_ps(
+        _mm256_sub_ps(load, _mm256_i32gather_ps(table.m_load, j, 4)),
+        _mm256_i32gather_ps(table.m_loadScale, j, 4));
+    const __m256 a = _mm256_i32gather_ps(table.m_value, cell, 4);
+    const __m256 b =
+        _mm256_i32gather_ps(table.m_value, _mm256_add_epi32(cell, one), 4);
+    const __m256 c = _mm256_i32gather_ps(table.m_value, below, 4);
+    const __m256 d =
+        _mm256_i32gather_ps(table.m_value, _mm256_add_epi32(below, one), 4);
+    const __m256 low = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(c, a), tx));
+    const __m256 high =
+        _mm256_add_ps(b, _mm256_mul_ps(_mm256_sub_ps(d, b), tx));
+    _mm256_storeu_ps(
+        values + n,
+        _mm256_add_ps(low, _mm256_mul_ps(_mm256_sub_ps(high, low), ty)));
+  }
+}
+#endif
+
+// Pads a one point axis to two points a step of 1 apart: the scale of 0
+// keeps the value of the point wherever the lookup falls
+bool FillAxis(const std::vector<float>& points, const char* name,
+              float* axis, float* scale, uint32_t& size,
+              std::string& error) {
+  if (points.empty() || points.size() > DelayCalculator::kMaxPoints) {
+    error = std::string("the ") + name + " axis needs 1 to " +
+            std::to_string(DelayCalculator::kMaxPoints) + " points";
+    return false;
+  }
+  for (size_t k = 1; k < points.size(); k++) {
+    if (!(points[k] > points[k - 1])) {
+      error = std::string("the ") + name + " axis is not increasing";
+      return false;
+    }
+  }
+  size = (uint32_t)std::max<size_t>(points.size(), 2);
+  for (uint32_t k = 0; k < size; k++) {
+    axis[k] = k < points.size() ? points[k] : points[0] + k;
+  }
+  for (uint32_t k = 0; k + 1 < size; k++) {
+    scale[k] = points.size() == 1 ? 0 : 1 / (axis[k + 1] - axis[k]);
+  }
+  return true;
+}
+}  // namespace
+
+bool DelayCalculator::AddTable(const std::vector<float>& slews,
+                               const std::vector<float>& loads,
+                               const std::vector<float>& values,
+                               TableId& table, std::string& error) {
+  Table added;
+  if (!FillAxis(slews, "slew", added.m_slew, added.m_slewScale,
+                added.m_slews, error) ||
+      !FillAxis(loads, "load", added.m_load, added.m_loadScale,
+                added.m_loads, error)) {
+    return false;
+  }
+  if (values.size() != slews.size() * loads.size()) {
+    error = "the table has " + std::to_string(values.size()) +
+            " values for " + std::to_string(slews.size()) + "x" +
+            std::to_string(loads.size()) + " points";
+    return false;
+  }
+  for (uint32_t i = 0; i < added.m_slews; i++) {
+    for (uint32_t j = 0; j < added.m_loads; j++) {
+      const size_t from = std::min<size_t>(i, slews.size() - 1) *
+                              loads.size() +
+                          std::min<size_t>(j, loads.size() - 1);
+      added.m_value[i * kRow + j] = values[from];
+    }
+  }
+  table = (TableId)m_tables.size();
+  m_tables.push_back(added);
+  return true;
+}
+
+float DelayCalculator::Lookup(TableId id, float slew, float load) const {
+  const Table& table = m_tables[id];
+  uint32_t i = 0, j = 0;
+  for (uint32_t k = 1; k + 1 < table.m_slews; k++) {
+    i += table.m_slew[k] <= slew;
+  }
+  for (uint32_t k = 1; k + 1 < table.m_loads; k++) {
+    j += table.m_load[k] <= load;
+  }
+  const float tx = (slew - table.m_slew[i]) * table.m_slewScale[i];
+  const float ty = (load - table.m_load[j]) * table.m_loadScale[j];
+  const float* value = table.m_value + i * kRow + j;
+  const float low = value[0] + (value[kRow] - value[0]) * tx;
+  const float high = value[1] + (value[kRow + 1] - value[1]) * tx;
+  return low + (high - low) * ty;
+}
+
+void DelayCalculator::Evaluate(TableId id, const float* slews,
+                               const float* loads, float* values,
+                               size_t count, Isa isa) const {
+  const Table& table = m_tables[id];
+  size_t vectorized = 0;
+#ifdef DELAY_AVX2
+  if (isa == Avx2) {
+    vectorized = count & ~(size_t)7;
+    EvaluateAvx2(table, slews, loads, values, vectorized);
+  }
+#endif
+#ifdef DELAY_SSE2
+  if (isa == Sse2) {
+    vectorized = count & ~(size_t)3;
+    EvaluateSse2(table, slews, loads, values, vectorized);
+  }
+#endif
+  for (size_t n = vectorized; n < count; n++) {
+    values[n] = Lookup(id, slews[n], loads[n]);
+  }
+}
+
+bool DelayCalculator::Supported(Isa isa) {
+  switch (isa) {
+    case Scalar:
+      return true;
+    case Sse2:
+#ifdef DELAY_SSE2
+      return true;
+#else
+      return false;
+#endif
+    case Avx2:
+#if defined(DELAY_AVX2) && defined(__GNUC__)
+      return __builtin_cpu_supports("avx2");
+#elif defined(DELAY_AVX2)
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+DelayCalculator::Isa DelayCalculator::BestIsa() {
+  static const Isa best = Supported(Avx2)   ? Avx2
+                          : Supported(Sse2) ? Sse2
+                                            : Scalar;
+  return best;
+}
+
+const char* DelayCalculator::IsaName(Isa isa) {
+  switch (isa) {
+    case Scalar:
+      return "scalar";
+    case Sse2:
+      return "SSE2";
+    case Avx2:
+      return "AVX2";
+  }
+  return "";
+}
@@ -0,0 +1,88 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef DELAY_CALCULATOR_H
+#define DELAY_CALCULATOR_H
+
+namespace FOEDAG {
+
+// Non linear delay model (NLDM) tables: a cell delay or output slew by
+// input slew and output load, interpolated bilinearly between the closest
+// points of the axes and extrapolated linearly past their ends.
+//
+// Each table is padded to kMaxPoints per axis, aligned for vector loads
+// and keeps the reciprocal of every axis step. Evaluate() interpolates a
+// batch of lookups into one table eight at a time with AVX2, when the CPU
+// has it, four at a time with SSE2 otherwise. Every instruction set
+// rounds the same operations in the same order as Lookup(), the scalar
+// reference, so the delays do not depend on the machine.
+class DelayCalculator {
+ public:
+  typedef uint32_t TableId;
+  enum Isa { Scalar, Sse2, Avx2 };
+
+  static constexpr size_t kMaxPoints = 8;
+
+  // values by slew then load, slews.size() * loads.size() of them. The
+  // axes are increasing, with 1 to kMaxPoints points each.
+  bool AddTable(const std::vector<float>& slews,
+                const std::vector<float>& loads,
+                const std::vector<float>& values, TableId& table,
+                std::string& error);
+  size_t TableCount() const { return m_tables.size(); }
+  void Clear() { m_tables.clear(); }
+
+  float Lookup(TableId table, float slew, float load) const;
+  // values[i] = Lookup(table, slews[i], loads[i])
+  void Evaluate(TableId table, const float* slews, const float* loads,
+                float* values, size_t count) const {
+    Evaluate(table, slews, loads, values, count, BestIsa());
+  }
+  // With isa, which must be Supported()
+  void Evaluate(TableId table, const float* slews, const float* loads,
+                float* values, size_t count, Isa isa) const;
+
+  static bool Supported(Isa isa);
+  static Isa BestIsa();
+  static const char* IsaName(Isa isa);
+
+ private:
+  struct alignas(32) Table {
+    float m_slew[kMaxPoints] = {};
+    float m_slewScale[kMaxPoints] = {};
+    float m_load[kMaxPoints] = {};
+    float m_loadScale[kMaxPoints] = {};
+    float m_value[kMaxPoints * kMaxPoints] = {};
+    uint32_t m_slews = 0;
+    uint32_t m_loads = 0;
+  };
+
+  std::vector<Table> m_tables;
+};
+
+}  // namespace FOEDAG
+
+#endif
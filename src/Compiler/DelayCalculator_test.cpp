@@ -0,0 +1,115 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DelayCalculator.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(DelayCalculator, InterpolatesBetweenThePoints) {
+  DelayCalculator calculator;
+  DelayCalculator::TableId table = 0;
+  std::string error;
+  // slew + load, which bilinear interpolation reproduces exactly
+  ASSERT_TRUE(calculator.AddTable({0, 1, 2}, {0, 2}, {0, 2, 1, 3, 2, 4},
+                                  table, error))
+      << error;
+  EXPECT_EQ(calculator.Lookup(table, 1, 2), 3);
+  EXPECT_EQ(calculator.Lookup(table, 0.5f, 1), 1.5f);
+  EXPECT_EQ(calculator.Lookup(table, 1.5f, 0.5f), 2);
+  // Linear past the ends of the axes
+  EXPECT_EQ(calculator.Lookup(table, 4, 4), 8);
+  EXPECT_EQ(calculator.Lookup(table, -1, -2), -3);
+
+  ASSERT_TRUE(calculator.AddTable({0.1f}, {1, 3}, {1, 2}, table, error));
+  EXPECT_EQ(calculator.TableCount(), 2u);
+  EXPECT_EQ(calculator.Lookup(table, 5, 2), 1.5f);
+}
+
+TEST(DelayCalculator, RejectsBadTables) {
+  DelayCalculator calculator;
+  DelayCalculator::TableId table = 0;
+  std::string error;
+  EXPECT_FALSE(calculator.AddTable({1, 1}, {1}, {0, 0}, table, error));
+  EXPECT_EQ(error, "the slew axis is not increasing");
+  EXPECT_FALSE(calculator.AddTable({1}, {}, {}, table, error));
+  EXPECT_FALSE(calculator.AddTable({1, 2}, {1}, {0}, table, error));
+  EXPECT_EQ(error, "the table has 1 values for 2x1 points");
+  std::vector<float> axis(DelayCalculator::kMaxPoints + 1);
+  for (size_t i = 0; i < axis.size(); i++) axis[i] = (float)i;
+  EXPECT_FALSE(calculator.AddTable(axis, {1}, axis, table, error));
+  EXPECT_EQ(calculator.TableCount(), 0u);
+}
+
+TEST(DelayCalculator, VectorsMatchTheScalarReferenceBitForBit) {
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> step(0.01f, 1);
+  std::vector<float> slews(DelayCalculator::kMaxPoints),
+      loads(DelayCalculator::kMaxPoints - 1),
+      values(slews.size() * loads.size());
+  float at = 0;
+  for (float& slew : slews) slew = at += step(random);
+  at = 0;
+  for (float& load : loads) load = at += 4 * step(random);
+  for (float& value : values) value = step(random);
+  DelayCalculator calculator;
+  DelayCalculator::TableId table = 0;
+  std::string error;
+  ASSERT_TRUE(calculator.AddTable(slews, loads, values, table, error));
+
+  // Not a multiple of the vector width, and past both ends of the axes
+  const size_t count = 1003;
+  std::uniform_real_distribution<float> slew(-1, slews.back() + 1);
+  std::uniform_real_distribution<float> load(-4, loads.back() + 4);
+  std::vector<float> inSlew(count), inLoad(count), expected(count);
+  for (size_t i = 0; i < count; i++) {
+    inSlew[i] = slew(random);
+    inLoad[i] = load(random);
+    expected[i] = calculator.Lookup(table, inSlew[i], inLoad[i]);
+  }
+  // Exactly on the points
+  inSlew[0] = slews[3];
+  inLoad[0] = loads[2];
+  expected[0] = calculator.Lookup(table, inSlew[0], inLoad[0]);
+  EXPECT_EQ(expected[0], values[3 * loads.size() + 2]);
+  for (DelayCalculator::Isa isa :
+       {DelayCalculator::Scalar, DelayCalculator::Sse2,
+        DelayCalculator::Avx2}) {
+    if (!DelayCalculator::Supported(isa)) continue;
+    std::vector<float> out(count);
+    calculator.Evaluate(table, inSlew.data(), inLoad.data(), out.data(),
+                        count, isa);
+    EXPECT_EQ(std::memcmp(out.data(), expected.data(),
+                          count * sizeof(float)),
+              0)
+        << DelayCalculator::IsaName(isa);
+  }
+  EXPECT_TRUE(DelayCalculator::Supported(DelayCalculator::BestIsa()));
+}
+}  // namespace
+}  // namespace FOEDAG
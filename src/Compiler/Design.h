@@ -26,6 +26,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Command/Command.h"
 #include "Command/CommandStack.h"
+#include "Compiler/CellPlacement.h"
+#include "Compiler/DeviceModel.h"
+#include "Compiler/Netlist.h"
+#include "Compiler/Routing.h"
+#include "Compiler/TimingAnalyzer.h"
+#include "Compiler/TimingConstraints.h"
 #include "Main/CommandLine.h"
 #include "Tcl/TclInterpreter.h"
 
@@ -46,7 +52,16 @@ class Design {
     SYSTEMVERILOG_2009,
     SYSTEMVERILOG_2012,
     SYSTEMVERILOG_2017,
+    // Post-synthesis netlists
+    BLIF,
+    EBLIF,
+    VERILOG_NETLIST,
   };
+  static bool IsNetlist(Language language) { return language >= BLIF; }
+  // For values read from files and sockets before they are cast
+  static bool IsLanguage(int value) {
+    return value >= VHDL_1987 && value <= VERILOG_NETLIST;
+  }
   Design(std::string& designName) : m_designName(designName) {}
   ~Design();
 
@@ -59,15 +74,44 @@ class Design {
     return m_fileList;
   }
 
+  void AddConstraintFile(const std::string& fileName) {
+    m_constraintFileList.push_back(fileName);
+  }
+  std::vector<std::string>& ConstraintFileList() {
+    return m_constraintFileList;
+  }
+
   void TopLevel(const std::string& topLevelModule) {
     m_topLevelModule = topLevelModule;
   }
   const std::string& TopLevel() { return m_topLevelModule; }
 
+  // Shared by all the stages of the flow
+  Netlist& GetNetlist() { return m_netlist; }
+  // Indexed like the netlist cells, empty until global placement
+  CellPlacement& GetPlacement() { return m_placement; }
+  // Target device, empty when none was set: the placers then size a
+  // generic die for the design
+  DeviceModel& GetDevice() { return m_device; }
+  // Indexed like the netlist nets, empty until routing
+  Routing& GetRouting() { return m_routing; }
+  // Timing graph of the netlist and its last analysis, built on first use
+  TimingAnalyzer& GetTiming() { return m_timing; }
+  // SDC constraints of the netlist, read from the .sdc constraint files
+  // on first use
+  TimingConstraints& GetConstraints() { return m_constraints; }
+
  private:
   std::string m_designName;
   std::string m_topLevelModule;
   std::vector<std::pair<Language, std::string>> m_fileList;
+  std::vector<std::string> m_constraintFileList;
+  Netlist m_netlist;
+  CellPlacement m_placement;
+  DeviceModel m_device;
+  Routing m_routing;
+  TimingAnalyzer m_timing;
+  TimingConstraints m_constraints;
 };
 
 }  // namespace FOEDAG
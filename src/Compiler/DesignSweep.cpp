@@ -0,0 +1,179 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DesignSweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+DesignSweep::DesignSweep(const std::vector<Parameter>& grid) {
+  m_points.push_back(Point());
+  for (const Parameter& param : grid) {
+    if (param.m_values.empty()) continue;
+    std::vector<Point> expanded;
+    for (const Point& point : m_points) {
+      for (const std::string& value : param.m_values) {
+        Point next = point;
+        next.m_options[param.m_name] = value;
+        expanded.push_back(next);
+      }
+    }
+    m_points.swap(expanded);
+  }
+  for (size_t i = 0; i < m_points.size(); i++) {
+    m_points[i].m_name = "sweep_" + std::to_string(i + 1);
+  }
+  m_stopHandlers.resize(m_points.size());
+}
+
+void DesignSweep::AddObjective(const std::string& metric, bool minimize) {
+  m_objectives.push_back(Objective{metric, minimize});
+}
+
+const char* DesignSweep::StatusName(Status status) {
+  switch (status) {
+    case Pending:
+      return "pending";
+    case Running:
+      return "running";
+    case Completed:
+      return "completed";
+    case Failed:
+      return "failed";
+    case Pruned:
+      return "pruned";
+  }
+  return "unknown";
+}
+
+bool DesignSweep::Run(PointFunc run, std::ostream& out, unsigned int maxJobs) {
+  m_out = &out;
+  // Points are whole compilations, on threads of their own: on the pool,
+  // each would hold a worker its stages need for their parallel loops
+  if (maxJobs == 0) maxJobs = TaskScheduler::Instance()->Concurrency();
+  const size_t threads = std::min<size_t>(maxJobs, m_points.size());
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([this, &run, &next]() {
+      for (size_t i = next++; i < m_points.size(); i = next++) {
+        RunPoint(i, run);
+      }
+    });
+  }
+  for (std::thread& worker : workers) worker.join();
+  for (const Point& point : m_points) {
+    if (point.m_status == Completed) return true;
+  }
+  return false;
+}
+
+void DesignSweep::RunPoint(size_t index, PointFunc& run) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_points[index].m_status = Running;
+  }
+  bool success = run(index, *this);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Point& point = m_points[index];
+  m_stopHandlers[index] = nullptr;
+  if (point.m_status == Pruned) return;
+  point.m_status = success ? Completed : Failed;
+  *m_out << point.m_name << " " << StatusName(point.m_status) << std::endl;
+  if (!success) return;
+  // A new completed point may dominate the ones still running
+  for (size_t i = 0; i < m_points.size(); i++) {
+    if (m_points[i].m_status == Running && Dominated(i)) Prune(i);
+  }
+}
+
+bool DesignSweep::Report(size_t index, const std::string& metric,
+                         double value, int stage) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Point& point = m_points[index];
+  if (point.m_status == Pruned) return false;
+  point.m_metrics[metric] = value;
+  point.m_stageMetrics[std::make_pair(stage, metric)] = value;
+  *m_out << point.m_name << " " << metric << " " << value << std::endl;
+  if (Dominated(index)) {
+    Prune(index);
+    return false;
+  }
+  return true;
+}
+
+void DesignSweep::SetStopHandler(size_t index, std::function<void()> stop) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_points[index].m_status == Pruned) {
+    if (stop) stop();
+    return;
+  }
+  m_stopHandlers[index] = stop;
+}
+
+// Only objectives the running point already reported are compared, each
+// at the last stage reporting it and with the value of the other point at
+// that stage: a completed point has to be better on all of them
+bool DesignSweep::Dominated(size_t index) const {
+  const Point& point = m_points[index];
+  for (const Point& other : m_points) {
+    if (other.m_status != Completed) continue;
+    bool compared = false;
+    bool better = true;
+    for (const Objective& objective : m_objectives) {
+      auto mine = std::find_if(point.m_stageMetrics.rbegin(),
+                               point.m_stageMetrics.rend(),
+                               [&objective](const auto& metric) {
+                                 return metric.first.second ==
+                                        objective.m_metric;
+                               });
+      if (mine == point.m_stageMetrics.rend()) continue;
+      auto theirs = other.m_stageMetrics.find(mine->first);
+      if (theirs == other.m_stageMetrics.end()) {
+        better = false;
+        break;
+      }
+      double gap = objective.m_minimize ? mine->second - theirs->second
+                                        : theirs->second - mine->second;
+      compared = true;
+      if (gap <= m_margin * std::fabs(mine->second)) {
+        better = false;
+        break;
+      }
+    }
+    if (compared && better) return true;
+  }
+  return false;
+}
+
+void DesignSweep::Prune(size_t index) {
+  Point& point = m_points[index];
+  point.m_status = Pruned;
+  *m_out << point.m_name << " " << StatusName(Pruned) << std::endl;
+  if (m_stopHandlers[index]) m_stopHandlers[index]();
+  m_stopHandlers[index] = nullptr;
+}
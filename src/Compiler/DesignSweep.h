@@ -0,0 +1,104 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef DESIGN_SWEEP_H
+#define DESIGN_SWEEP_H
+
+namespace FOEDAG {
+
+// Design space exploration over a grid of run options. Points run in
+// parallel, off the TaskScheduler pool, and stream their metrics while
+// running; a point whose metrics so far are dominated by a completed point
+// on every objective is stopped early. Metrics are compared stage by stage:
+// the hpwl of a global placement is no match for the one of a detailed
+// placement.
+class DesignSweep {
+ public:
+  struct Parameter {
+    std::string m_name;
+    std::vector<std::string> m_values;
+  };
+  enum Status { Pending, Running, Completed, Failed, Pruned };
+  struct Point {
+    std::string m_name;
+    std::map<std::string, std::string> m_options;
+    // Last value of each metric
+    std::map<std::string, double> m_metrics;
+    // Every value, by stage and metric
+    std::map<std::pair<int, std::string>, double> m_stageMetrics;
+    Status m_status = Pending;
+  };
+  // Runs point index, reporting its metrics through Report()
+  typedef std::function<bool(size_t index, DesignSweep& sweep)> PointFunc;
+
+  // Cartesian product of the parameter values, first parameter slowest
+  explicit DesignSweep(const std::vector<Parameter>& grid);
+
+  void AddObjective(const std::string& metric, bool minimize);
+  // Relative margin by which a completed point must beat a running one on
+  // every reported objective for the running one to be pruned
+  void SetPruneMargin(double margin) { m_margin = margin; }
+
+  std::vector<Point>& Points() { return m_points; }
+
+  // Runs every point on up to maxJobs threads of its own (0 means as many
+  // as the pool has), returns false if no point completed
+  bool Run(PointFunc run, std::ostream& out, unsigned int maxJobs = 0);
+
+  // Called by the point function with the stage reporting the metric.
+  // Returns false once the point is pruned, the point function should then
+  // return as soon as possible.
+  bool Report(size_t index, const std::string& metric, double value,
+              int stage = 0);
+  // How to stop point index, called when the point gets pruned
+  void SetStopHandler(size_t index, std::function<void()> stop);
+
+  static const char* StatusName(Status status);
+
+ private:
+  struct Objective {
+    std::string m_metric;
+    bool m_minimize = true;
+  };
+
+  bool Dominated(size_t index) const;
+  void Prune(size_t index);
+  void RunPoint(size_t index, PointFunc& run);
+
+  std::vector<Point> m_points;
+  std::vector<std::function<void()>> m_stopHandlers;
+  std::vector<Objective> m_objectives;
+  double m_margin = 0.0;
+  std::ostream* m_out = &std::cout;
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,144 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DesignSweep.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "Compiler/TaskScheduler.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(DesignSweep, ExpandsTheGrid) {
+  DesignSweep sweep({{"effort", {"low", "high"}}, {"fsm", {"auto", "onehot",
+                                                           "binary"}}});
+  auto& points = sweep.Points();
+  ASSERT_EQ(points.size(), 6u);
+  EXPECT_EQ(points[0].m_options["effort"], "low");
+  EXPECT_EQ(points[0].m_options["fsm"], "auto");
+  EXPECT_EQ(points[5].m_options["effort"], "high");
+  EXPECT_EQ(points[5].m_options["fsm"], "binary");
+  EXPECT_EQ(points[0].m_name, "sweep_1");
+}
+
+TEST(DesignSweep, RunsPointsOffThePool) {
+  DesignSweep sweep({{"seed", {"1", "2", "3", "4", "5", "6"}}});
+  std::atomic<int> running{0};
+  std::atomic<int> peak{0};
+  std::ostringstream out;
+  bool ok = sweep.Run(
+      [&](size_t index, DesignSweep& s) {
+        int now = ++running;
+        int seen = peak;
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        running--;
+        return !TaskScheduler::Instance()->OnWorkerThread();
+      },
+      out, 2);
+  EXPECT_TRUE(ok);
+  for (auto& point : sweep.Points()) {
+    EXPECT_EQ(point.m_status, DesignSweep::Completed);
+  }
+  EXPECT_LE(peak, 2);
+}
+
+TEST(DesignSweep, PrunesDominatedPoints) {
+  DesignSweep sweep({{"area", {"10", "20", "5"}}});
+  sweep.AddObjective("area", true);
+  sweep.AddObjective("slack", false);
+  int stopped = 0;
+  std::ostringstream out;
+  // One job at a time, points complete in order
+  bool ok = sweep.Run(
+      [&](size_t index, DesignSweep& s) {
+        s.SetStopHandler(index, [&stopped] { stopped++; });
+        double area = std::stod(s.Points()[index].m_options["area"]);
+        if (!s.Report(index, "area", area)) return false;
+        return s.Report(index, "slack", 1.0);
+      },
+      out, 1);
+  EXPECT_TRUE(ok);
+  auto& points = sweep.Points();
+  EXPECT_EQ(points[0].m_status, DesignSweep::Completed);
+  EXPECT_EQ(points[1].m_status, DesignSweep::Pruned);
+  EXPECT_EQ(points[2].m_status, DesignSweep::Completed);
+  EXPECT_EQ(points[1].m_metrics.count("slack"), 0u);
+  EXPECT_EQ(stopped, 1);
+}
+
+TEST(DesignSweep, MarginKeepsClosePoints) {
+  DesignSweep sweep({{"area", {"100", "104"}}});
+  sweep.AddObjective("area", true);
+  sweep.SetPruneMargin(0.05);
+  std::ostringstream out;
+  sweep.Run(
+      [](size_t index, DesignSweep& s) {
+        double area = std::stod(s.Points()[index].m_options["area"]);
+        return s.Report(index, "area", area);
+      },
+      out, 1);
+  EXPECT_EQ(sweep.Points()[1].m_status, DesignSweep::Completed);
+}
+
+TEST(DesignSweep, ComparesMetricsOfTheSameStage) {
+  DesignSweep sweep({{"run", {"a", "b"}}});
+  sweep.AddObjective("hpwl", true);
+  std::ostringstream out;
+  bool earlyKept = false;
+  sweep.Run(
+      [&earlyKept](size_t index, DesignSweep& s) {
+        if (index == 0) {
+          s.Report(index, "hpwl", 100.0, 2);
+          return s.Report(index, "hpwl", 50.0, 3);
+        }
+        // Worse than the final hpwl of the first point, better than its
+        // hpwl of the same stage
+        earlyKept = s.Report(index, "hpwl", 80.0, 2);
+        return s.Report(index, "hpwl", 60.0, 3);
+      },
+      out, 1);
+  EXPECT_TRUE(earlyKept);
+  EXPECT_EQ(sweep.Points()[1].m_status, DesignSweep::Pruned);
+}
+
+TEST(DesignSweep, FailedPointsDoNotPrune) {
+  DesignSweep sweep({{"run", {"a", "b"}}});
+  sweep.AddObjective("area", true);
+  std::ostringstream out;
+  bool ok = sweep.Run(
+      [](size_t index, DesignSweep& s) {
+        s.Report(index, "area", index == 0 ? 1.0 : 2.0);
+        return index != 0;
+      },
+      out, 1);
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(sweep.Points()[0].m_status, DesignSweep::Failed);
+  EXPECT_EQ(sweep.Points()[1].m_status, DesignSweep::Completed);
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,774 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DetailedPlacer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "Compiler/DeviceModel.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+
+// Cells per task; partial sums are per chunk, the results do not depend on
+// the number of threads
+constexpr size_t kGrain = 1024;
+// Sites per side of the matching windows
+constexpr uint32_t kWindow = 16;
+// Cells matched together, and the free sites of the window they may take
+constexpr int kBatch = 8;
+constexpr int kMaxFree = 8;
+// Luby rounds growing each independent set
+constexpr int kIndependentRounds = 4;
+// Gains below this are noise
+constexpr double kMinGain = 1e-6;
+
+constexpr uint32_t kFree = Netlist::kNone;
+constexpr uint32_t kBlocked = Netlist::kNone - 1;
+
+enum CellState : uint8_t { Undecided, Selected, Excluded };
+
+struct Move {
+  Netlist::CellId m_cell;
+  float m_x;
+  float m_y;
+};
+
+// splitmix64 finalizer
+uint64_t Mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Random, but unique, ranking of the cells
+uint64_t Priority(Netlist::CellId cell, uint64_t salt) {
+  return (Mix(salt ^ cell) & ~0xFFFFFFFFULL) | cell;
+}
+
+// Raises claim to key, the outcome does not depend on the order of the
+// claims
+void Claim(std::atomic<uint64_t>& claim, uint64_t key) {
+  uint64_t current = claim.load(std::memory_order_relaxed);
+  while (current < key &&
+         !claim.compare_exchange_weak(current, key,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+// Assigns the rows of cost (rows x columns, rows <= columns) to distinct
+// columns at the least total cost. Hungarian algorithm, O(rows^2 columns).
+void Assign(const double* cost, int rows, int columns, int* column) {
+  constexpr int kMax = kBatch + kMaxFree + 1;
+  const double inf = std::numeric_limits<double>::infinity();
+  std::array<double, kMax> u{}, v{};
+  std::array<int, kMax> row{}, way{};
+  for (int i = 1; i <= rows; i++) {
+    row[0] = i;
+    int j0 = 0;
+    std::array<double, kMax> minimum;
+    std::array<bool, kMax> used{};
+    minimum.fill(inf);
+    do {
+      used[j0] = true;
+      const int i0 = row[j0];
+      double delta = inf;
+      int j1 = 0;
+      for (int j = 1; j <= columns; j++) {
+        if (used[j]) continue;
+        const double reduced =
+            cost[(i0 - 1) * columns + j - 1] - u[i0] - v[j];
+        if (reduced < minimum[j]) {
+          minimum[j] = reduced;
+          way[j] = j0;
+        }
+        if (minimum[j] < delta) {
+          delta = minimum[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= columns; j++) {
+        if (used[j]) {
+          u[row[j]] += delta;
+          v[j] -= delta;
+        } else {
+          minimum[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (row[j0] != 0);
+    do {
+      const int j1 = way[j0];
+      row[j0] = row[j1];
+      j0 = j1;
+    } while (j0);
+  }
+  for (int j = 1; j <= columns; j++) {
+    if (row[j]) column[row[j] - 1] = j - 1;
+  }
+}
+
+class Engine {
+ public:
+  Engine(const Netlist& netlist, CellPlacement& placement,
+         const DetailedPlacer::Options& options, DetailedPlacer::Stats& stats,
+         std::string& error)
+      : m_netlist(netlist),
+        m_placement(placement),
+        m_options(options),
+        m_stats(stats),
+        m_error(error),
+        m_scheduler(TaskScheduler::Instance()) {}
+
+  bool Run();
+
+ private:
+  template <typename F>
+  void For(size_t count, size_t grain, F&& body) {
+    m_scheduler->ParallelFor(0, count, grain, body, m_options.m_threads);
+  }
+  // Sum of body(begin, end) over the chunks, added in chunk order
+  template <typename F>
+  double Sum(size_t count, size_t grain, F&& body) {
+    std::vector<double> partial((count + grain - 1) / grain, 0.0);
+    For(count, grain, [&](size_t begin, size_t end) {
+      partial[begin / grain] = body(begin, end);
+    });
+    double sum = 0;
+    for (double value : partial) sum += value;
+    return sum;
+  }
+
+  bool Setup();
+  void Snap(const std::vector<Netlist::CellId>& cells);
+  void Occupy(Netlist::CellId cell, uint32_t site) {
+    m_site[site] = cell;
+    m_cellSite[cell] = site;
+    m_x[cell] = (site % m_columns) + 0.5f;
+    m_y[cell] = (site / m_columns) + 0.5f;
+  }
+  bool Fits(Netlist::CellId cell, uint32_t site) const {
+    return DeviceModel::Accepts(m_siteType[site],
+                                (DeviceModel::Resource)m_cellResource[cell]);
+  }
+  Netlist::IdSpan CellNets(Netlist::CellId cell) const {
+    const uint32_t* nets = m_cellNets.data();
+    return Netlist::IdSpan(nets + m_cellNetBegin[cell],
+                           nets + m_cellNetBegin[cell + 1]);
+  }
+  double NetCost(Netlist::NetId net, const Move* moves, int count) const;
+  // Wirelength of the nets of cell with the moves applied
+  double CellCost(Netlist::CellId cell, const Move* moves, int count) const;
+  // Wirelength saved by moving cell to site, swapped with its occupant
+  double Gain(Netlist::CellId cell, uint32_t site) const;
+  double Hpwl();
+
+  void SelectIndependent(int pass);
+  size_t Match();
+  size_t Swap();
+  void Propose(Netlist::CellId cell, std::vector<float>& xs,
+               std::vector<float>& ys, uint32_t& site, float& gain) const;
+
+  const Netlist& m_netlist;
+  CellPlacement& m_placement;
+  const DetailedPlacer::Options& m_options;
+  DetailedPlacer::Stats& m_stats;
+  std::string& m_error;
+  TaskScheduler* m_scheduler;
+
+  float* m_x = nullptr;
+  float* m_y = nullptr;
+  uint32_t m_columns = 0;
+  uint32_t m_rows = 0;
+  std::vector<Netlist::CellId> m_movableCells;
+  // Nets the placer optimizes, and those of each movable cell
+  std::vector<Netlist::NetId> m_nets;
+  std::vector<uint8_t> m_netUsed;
+  std::vector<uint32_t> m_cellNetBegin;
+  std::vector<uint32_t> m_cellNets;
+  // Occupant of each site, kFree or kBlocked, and what the site takes
+  std::vector<uint32_t> m_site;
+  std::vector<uint8_t> m_siteType;
+  std::vector<uint8_t> m_cellResource;
+  std::vector<uint32_t> m_cellSite;
+
+  // Independent set
+  std::vector<uint8_t> m_state;
+  std::vector<uint64_t> m_netBest;
+  std::vector<uint8_t> m_netTaken;
+
+  // Swap proposals, by movable cell index, and their claims
+  std::vector<uint32_t> m_proposalSite;
+  std::vector<float> m_proposalGain;
+  std::vector<std::atomic<uint64_t>> m_netClaim;
+  std::vector<std::atomic<uint64_t>> m_siteClaim;
+};
+
+bool Engine::Setup() {
+  const size_t cells = m_netlist.CellCount();
+  m_columns = (uint32_t)std::floor(m_placement.Width() + 1e-6);
+  m_rows = (uint32_t)std::floor(m_placement.Height() + 1e-6);
+  m_x = m_placement.XData();
+  m_y = m_placement.YData();
+  const DeviceModel* device = m_options.m_device;
+  if (device && (device->Columns() != m_columns ||
+                 device->Rows() != m_rows)) {
+    m_error = "the placement die does not match the device";
+    return false;
+  }
+  const bool typed = device && !device->Generic();
+  if (device) {
+    m_siteType = device->Sites();
+  } else {
+    m_siteType.assign((size_t)m_columns * m_rows, DeviceModel::kAnySite);
+  }
+  m_site.assign(m_siteType.size(), kFree);
+  for (size_t site = 0; site < m_site.size(); site++) {
+    if (m_siteType[site] == DeviceModel::kNoSite) m_site[site] = kBlocked;
+  }
+  m_cellSite.assign(cells, kFree);
+  m_cellResource.assign(cells, DeviceModel::Lut);
+
+  std::vector<uint8_t> movable(cells, 0);
+  std::array<size_t, DeviceModel::kResourceCount> needed{};
+  for (Netlist::CellId cell : m_netlist.Cells()) {
+    std::string_view type = m_netlist.CellType(cell);
+    if (CellPlacement::IsConstant(type) || CellPlacement::IsPort(type)) {
+      continue;
+    }
+    if (!m_placement.Fixed(cell)) {
+      if (typed) m_cellResource[cell] = DeviceModel::CellResource(type);
+      movable[cell] = 1;
+      m_movableCells.push_back(cell);
+      needed[m_cellResource[cell]]++;
+      continue;
+    }
+    // Fixed logic takes its site
+    float x = m_x[cell], y = m_y[cell];
+    if (x >= 0 && y >= 0 && x < m_columns && y < m_rows) {
+      m_site[(uint32_t)y * m_columns + (uint32_t)x] = kBlocked;
+    }
+  }
+  m_stats.m_movable = m_movableCells.size();
+  for (int resource = 0; resource < DeviceModel::kResourceCount;
+       resource++) {
+    if (needed[resource] == 0) continue;
+    size_t available = 0;
+    for (size_t site = 0; site < m_site.size(); site++) {
+      if (m_site[site] == kFree &&
+          DeviceModel::Accepts(m_siteType[site],
+                               (DeviceModel::Resource)resource)) {
+        available++;
+      }
+    }
+    if (needed[resource] > available) {
+      m_error = std::to_string(needed[resource]) + " " +
+                (typed ? std::string(DeviceModel::ResourceName(
+                             (DeviceModel::Resource)resource)) + " "
+                       : std::string()) +
+                "cells do not fit on the " + std::to_string(available) +
+                " sites of the " + std::to_string(m_columns) + "x" +
+                std::to_string(m_rows) + " die";
+      return false;
+    }
+  }
+
+  // Cells already on a site of their own stay there
+  std::vector<Netlist::CellId> misplaced;
+  for (Netlist::CellId cell : m_movableCells) {
+    const float x = m_x[cell], y = m_y[cell];
+    const bool inside = x >= 0 && y >= 0 && x < m_columns && y < m_rows;
+    const uint32_t column = inside ? (uint32_t)x : 0;
+    const uint32_t row = inside ? (uint32_t)y : 0;
+    const uint32_t site = row * m_columns + column;
+    if (inside && x == column + 0.5f && y == row + 0.5f &&
+        m_site[site] == kFree && Fits(cell, site)) {
+      Occupy(cell, site);
+    } else {
+      misplaced.push_back(cell);
+    }
+  }
+  Snap(misplaced);
+  m_stats.m_snapped = misplaced.size();
+
+  m_netUsed.assign(m_netlist.NetCount(), 0);
+  for (Netlist::NetId net : m_netlist.Nets()) {
+    Netlist::IdSpan pins = m_netlist.NetPins(net);
+    if (pins.size() < 2 || pins.size() > DetailedPlacer::kMaxNetDegree) {
+      continue;
+    }
+    Netlist::PinId driver = m_netlist.NetDriver(net);
+    if (driver != Netlist::kNone &&
+        CellPlacement::IsConstant(
+            m_netlist.CellType(m_netlist.PinCell(driver)))) {
+      continue;
+    }
+    m_netUsed[net] = 1;
+    m_nets.push_back(net);
+  }
+  m_cellNetBegin.assign(cells + 1, 0);
+  for (Netlist::CellId cell : m_netlist.Cells()) {
+    m_cellNetBegin[cell] = (uint32_t)m_cellNets.size();
+    if (!movable[cell]) continue;
+    const size_t first = m_cellNets.size();
+    for (Netlist::PinId pin : m_netlist.CellPins(cell)) {
+      Netlist::NetId net = m_netlist.PinNet(pin);
+      if (net == Netlist::kNone || !m_netUsed[net]) continue;
+      if (std::find(m_cellNets.begin() + first, m_cellNets.end(), net) ==
+          m_cellNets.end()) {
+        m_cellNets.push_back(net);
+      }
+    }
+  }
+  m_cellNetBegin[cells] = (uint32_t)m_cellNets.size();
+
+  m_state.assign(cells, Excluded);
+  m_netBest.assign(m_netlist.NetCount(), 0);
+  m_netTaken.assign(m_netlist.NetCount(), 0);
+  m_proposalSite.assign(m_movableCells.size(), kFree);
+  m_proposalGain.assign(m_movableCells.size(), 0.0f);
+  m_netClaim = std::vector<std::atomic<uint64_t>>(m_netlist.NetCount());
+  m_siteClaim = std::vector<std::atomic<uint64_t>>(m_site.size());
+  return true;
+}
+
+// Each cell, in netlist order, to the nearest free site, searched in
+// growing square rings
+void Engine::Snap(const std::vector<Netlist::CellId>& cells) {
+  const int columns = (int)m_columns, rows = (int)m_rows;
+  for (Netlist::CellId cell : cells) {
+    const int x = std::min(std::max((int)std::floor(m_x[cell]), 0),
+                           columns - 1);
+    const int y = std::min(std::max((int)std::floor(m_y[cell]), 0),
+                           rows - 1);
+    uint32_t best = kFree;
+    for (int ring = 0; best == kFree; ring++) {
+      int bestDistance = INT32_MAX;
+      for (int dy = -ring; dy <= ring; dy++) {
+        const int row = y + dy;
+        if (row < 0 || row >= rows) continue;
+        const int step = (dy == -ring || dy == ring) ? 1 : 2 * ring;
+        for (int dx = -ring; dx <= ring; dx += step) {
+          const int column = x + dx;
+          if (column < 0 || column >= columns) continue;
+          const uint32_t site = (uint32_t)(row * columns + column);
+          const int distance = dx * dx + dy * dy;
+          if (m_site[site] == kFree && distance < bestDistance &&
+              Fits(cell, site)) {
+            bestDistance = distance;
+            best = site;
+          }
+        }
+      }
+    }
+    Occupy(cell, best);
+  }
+}
+
+double Engine::NetCost(Netlist::NetId net, const Move* moves,
+                       int count) const {
+  float left = FLT_MAX, right = -FLT_MAX, bottom = FLT_MAX, top = -FLT_MAX;
+  for (Netlist::PinId pin : m_netlist.NetPins(net)) {
+    const Netlist::CellId cell = m_netlist.PinCell(pin);
+    float x = m_x[cell], y = m_y[cell];
+    for (int i = 0; i < count; i++) {
+      if (moves[i].m_cell == cell) {
+        x = moves[i].m_x;
+        y = moves[i].m_y;
+      }
+    }
+    left = std::min(left, x);
+    right = std::max(right, x);
+    bottom = std::min(bottom, y);
+    top = std::max(top, y);
+  }
+  return (double)(right - left) + (double)(top - bottom);
+}
+
+double Engine::CellCost(Netlist::CellId cell, const Move* moves,
+                        int count) const {
+  double cost = 0;
+  for (Netlist::NetId net : CellNets(cell)) {
+    cost += NetCost(net, moves, count);
+  }
+  return cost;
+}
+
+double Engine::Gain(Netlist::CellId cell, uint32_t site) const {
+  Move moves[2] = {{cell, (site % m_columns) + 0.5f,
+                    (site / m_columns) + 0.5f},
+                   {m_site[site], m_x[cell], m_y[cell]}};
+  const int count = (m_site[site] == kFree) ? 1 : 2;
+  double gain = 0;
+  for (Netlist::NetId net : CellNets(cell)) {
+    gain += NetCost(net, nullptr, 0) - NetCost(net, moves, count);
+  }
+  if (count == 2) {
+    Netlist::IdSpan shared = CellNets(cell);
+    for (Netlist::NetId net : CellNets(moves[1].m_cell)) {
+      if (std::find(shared.begin(), shared.end(), net) != shared.end()) {
+        continue;
+      }
+      gain += NetCost(net, nullptr, 0) - NetCost(net, moves, count);
+    }
+  }
+  return gain;
+}
+
+double Engine::Hpwl() {
+  return Sum(m_nets.size(), kGrain, [this](size_t begin, size_t end) {
+    double sum = 0;
+    for (size_t i = begin; i < end; i++) sum += NetCost(m_nets[i], nullptr, 0);
+    return sum;
+  });
+}
+
+// Luby's algorithm: a cell joins the set when it ranks first on each of
+// its nets among the undecided cells, the cells sharing a net with it are
+// excluded. Each step is a parallel sweep over nets or cells, without
+// conflicting writes.
+void Engine::SelectIndependent(int pass) {
+  For(m_movableCells.size(), kGrain, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      Netlist::CellId cell = m_movableCells[i];
+      m_state[cell] = CellNets(cell).empty() ? Excluded : Undecided;
+    }
+  });
+  For(m_nets.size(), kGrain, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) m_netTaken[m_nets[i]] = 0;
+  });
+  for (int round = 0; round < kIndependentRounds; round++) {
+    const uint64_t salt =
+        Mix(m_options.m_seed * kIndependentRounds * 1024 +
+            (uint64_t)pass * kIndependentRounds + round);
+    For(m_nets.size(), kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        uint64_t best = 0;
+        for (Netlist::PinId pin : m_netlist.NetPins(m_nets[i])) {
+          Netlist::CellId cell = m_netlist.PinCell(pin);
+          if (m_state[cell] == Undecided) {
+            best = std::max(best, Priority(cell, salt));
+          }
+        }
+        m_netBest[m_nets[i]] = best;
+      }
+    });
+    For(m_movableCells.size(), kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        Netlist::CellId cell = m_movableCells[i];
+        if (m_state[cell] != Undecided) continue;
+        const uint64_t priority = Priority(cell, salt);
+        bool first = true;
+        for (Netlist::NetId net : CellNets(cell)) {
+          first = first && m_netBest[net] == priority;
+        }
+        if (first) m_state[cell] = Selected;
+      }
+    });
+    For(m_nets.size(), kGrain, [this](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        for (Netlist::PinId pin : m_netlist.NetPins(m_nets[i])) {
+          if (m_state[m_netlist.PinCell(pin)] == Selected) {
+            m_netTaken[m_nets[i]] = 1;
+          }
+        }
+      }
+    });
+    For(m_movableCells.size(), kGrain, [this](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        Netlist::CellId cell = m_movableCells[i];
+        if (m_state[cell] != Undecided) continue;
+        for (Netlist::NetId net : CellNets(cell)) {
+          if (m_netTaken[net]) m_state[cell] = Excluded;
+        }
+      }
+    });
+  }
+}
+
+// The selected cells of each window, kBatch at a time, are reassigned to
+// their sites and to free sites of the window. They share no net, so the
+// cost of a cell on a site does not depend on where the others go and the
+// assignment is exact. Windows only touch their own sites and cells.
+size_t Engine::Match() {
+  const uint32_t windowColumns = (m_columns + kWindow - 1) / kWindow;
+  const uint32_t windowRows = (m_rows + kWindow - 1) / kWindow;
+  const size_t windows = (size_t)windowColumns * windowRows;
+  double moved = Sum(windows, 1, [&](size_t begin, size_t end) {
+    size_t count = 0;
+    std::vector<Netlist::CellId> cells;
+    std::array<uint32_t, kBatch + kMaxFree> sites;
+    std::array<double, kBatch*(kBatch + kMaxFree)> cost;
+    std::array<int, kBatch> column;
+    for (size_t window = begin; window < end; window++) {
+      const uint32_t left = (uint32_t)(window % windowColumns) * kWindow;
+      const uint32_t bottom = (uint32_t)(window / windowColumns) * kWindow;
+      const uint32_t right = std::min(left + kWindow, m_columns);
+      const uint32_t top = std::min(bottom + kWindow, m_rows);
+      cells.clear();
+      for (uint32_t row = bottom; row < top; row++) {
+        for (uint32_t x = left; x < right; x++) {
+          uint32_t cell = m_site[row * m_columns + x];
+          if (cell < kBlocked && m_state[cell] == Selected) {
+            cells.push_back(cell);
+          }
+        }
+      }
+      // Batches of cells of one resource
+      std::stable_sort(cells.begin(), cells.end(),
+                       [this](Netlist::CellId a, Netlist::CellId b) {
+                         return m_cellResource[a] < m_cellResource[b];
+                       });
+      for (size_t first = 0, last = 0; first < cells.size(); first = last) {
+        const uint8_t resource = m_cellResource[cells[first]];
+        last = first + 1;
+        while (last < cells.size() && last - first < (size_t)kBatch &&
+               m_cellResource[cells[last]] == resource) {
+          last++;
+        }
+        const int n = (int)(last - first);
+        int m = 0;
+        for (int i = 0; i < n; i++) sites[m++] = m_cellSite[cells[first + i]];
+        for (uint32_t row = bottom; row < top && m < n + kMaxFree; row++) {
+          for (uint32_t x = left; x < right && m < n + kMaxFree; x++) {
+            const uint32_t site = row * m_columns + x;
+            if (m_site[site] == kFree && Fits(cells[first], site)) {
+              sites[m++] = site;
+            }
+          }
+        }
+        double current = 0;
+        for (int i = 0; i < n; i++) {
+          const Netlist::CellId cell = cells[first + i];
+          for (int j = 0; j < m; j++) {
+            Move move{cell, (sites[j] % m_columns) + 0.5f,
+                      (sites[j] / m_columns) + 0.5f};
+            cost[i * m + j] = CellCost(cell, &move, 1);
+          }
+          current += cost[i * m + i];
+        }
+        Assign(cost.data(), n, m, column.data());
+        double assigned = 0;
+        for (int i = 0; i < n; i++) assigned += cost[i * m + column[i]];
+        if (assigned > current - kMinGain) continue;
+        for (int i = 0; i < n; i++) m_site[sites[i]] = kFree;
+        for (int i = 0; i < n; i++) {
+          Occupy(cells[first + i], sites[column[i]]);
+          if (column[i] != i) count++;
+        }
+      }
+    }
+    return (double)count;
+  });
+  return (size_t)moved;
+}
+
+// Best move or swap of cell among the sites around the closest point of
+// the optimal region of its nets: the median box of the bounding boxes of
+// its nets without it
+void Engine::Propose(Netlist::CellId cell, std::vector<float>& xs,
+                     std::vector<float>& ys, uint32_t& site,
+                     float& gain) const {
+  site = kFree;
+  gain = 0;
+  xs.clear();
+  ys.clear();
+  for (Netlist::NetId net : CellNets(cell)) {
+    float left = FLT_MAX, right = -FLT_MAX, bottom = FLT_MAX, top = -FLT_MAX;
+    for (Netlist::PinId pin : m_netlist.NetPins(net)) {
+      const Netlist::CellId other = m_netlist.PinCell(pin);
+      if (other == cell) continue;
+      left = std::min(left, m_x[other]);
+      right = std::max(right, m_x[other]);
+      bottom = std::min(bottom, m_y[other]);
+      top = std::max(top, m_y[other]);
+    }
+    if (left > right) continue;
+    xs.push_back(left);
+    xs.push_back(right);
+    ys.push_back(bottom);
+    ys.push_back(top);
+  }
+  if (xs.empty()) return;
+  const size_t half = xs.size() / 2;
+  std::nth_element(xs.begin(), xs.begin() + half, xs.end());
+  std::nth_element(ys.begin(), ys.begin() + half, ys.end());
+  const float xHigh = xs[half], yHigh = ys[half];
+  const float xLow = *std::max_element(xs.begin(), xs.begin() + half);
+  const float yLow = *std::max_element(ys.begin(), ys.begin() + half);
+  const float x = std::min(std::max(m_x[cell], xLow), xHigh);
+  const float y = std::min(std::max(m_y[cell], yLow), yHigh);
+  const int column =
+      std::min(std::max((int)std::floor(x), 0), (int)m_columns - 1);
+  const int row = std::min(std::max((int)std::floor(y), 0), (int)m_rows - 1);
+  const uint32_t own = m_cellSite[cell];
+  if ((uint32_t)(row * (int)m_columns + column) == own) return;
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      const int r = row + dy, c = column + dx;
+      if (r < 0 || c < 0 || r >= (int)m_rows || c >= (int)m_columns) {
+        continue;
+      }
+      const uint32_t candidate = (uint32_t)(r * (int)m_columns + c);
+      if (candidate == own || m_site[candidate] == kBlocked ||
+          !Fits(cell, candidate)) {
+        continue;
+      }
+      const double candidateGain = Gain(cell, candidate);
+      if (candidateGain > gain + kMinGain) {
+        gain = (float)candidateGain;
+        site = candidate;
+      }
+    }
+  }
+}
+
+// Proposals are computed from the current placement, then each claims the
+// nets and the sites it changes with its rank (gain, then cell id). Those
+// holding all their claims share nothing with the others and are applied
+// as evaluated.
+size_t Engine::Swap() {
+  For(m_movableCells.size(), kGrain, [this](size_t begin, size_t end) {
+    std::vector<float> xs, ys;
+    for (size_t i = begin; i < end; i++) {
+      Propose(m_movableCells[i], xs, ys, m_proposalSite[i],
+              m_proposalGain[i]);
+    }
+  });
+  For(m_nets.size(), kGrain, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_netClaim[m_nets[i]].store(0, std::memory_order_relaxed);
+    }
+  });
+  For(m_site.size(), kGrain * 16, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_siteClaim[i].store(0, std::memory_order_relaxed);
+    }
+  });
+  auto rank = [this](size_t i) {
+    uint32_t bits;
+    std::memcpy(&bits, &m_proposalGain[i], sizeof(bits));
+    return ((uint64_t)bits << 32) | m_movableCells[i];
+  };
+  For(m_movableCells.size(), kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const uint32_t site = m_proposalSite[i];
+      if (site == kFree) continue;
+      const uint64_t key = rank(i);
+      const Netlist::CellId cell = m_movableCells[i];
+      Claim(m_siteClaim[m_cellSite[cell]], key);
+      Claim(m_siteClaim[site], key);
+      for (Netlist::NetId net : CellNets(cell)) Claim(m_netClaim[net], key);
+      if (m_site[site] != kFree) {
+        for (Netlist::NetId net : CellNets(m_site[site])) {
+          Claim(m_netClaim[net], key);
+        }
+      }
+    }
+  });
+  double moved =
+      Sum(m_movableCells.size(), kGrain, [&](size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+          const uint32_t site = m_proposalSite[i];
+          if (site == kFree) continue;
+          const uint64_t key = rank(i);
+          const Netlist::CellId cell = m_movableCells[i];
+          const uint32_t own = m_cellSite[cell];
+          const uint32_t other = m_site[site];
+          bool owner = m_siteClaim[own].load(std::memory_order_relaxed) ==
+                           key &&
+                       m_siteClaim[site].load(std::memory_order_relaxed) ==
+                           key;
+          for (Netlist::NetId net : CellNets(cell)) {
+            owner = owner &&
+                    m_netClaim[net].load(std::memory_order_relaxed) == key;
+          }
+          if (other != kFree) {
+            for (Netlist::NetId net : CellNets(other)) {
+              owner = owner &&
+                      m_netClaim[net].load(std::memory_order_relaxed) == key;
+            }
+          }
+          if (!owner) continue;
+          if (other != kFree) {
+            Occupy(other, own);
+            count++;
+          } else {
+            m_site[own] = kFree;
+          }
+          Occupy(cell, site);
+          count++;
+        }
+        return (double)count;
+      });
+  return (size_t)moved;
+}
+
+bool Engine::Run() {
+  if (!Setup()) return false;
+  const int passes = std::max(m_options.m_passes, 0);
+  for (int pass = 0; pass < passes; pass++) {
+    if (m_options.m_cancel.Cancelled()) return false;
+    const double before = Hpwl();
+    SelectIndependent(pass);
+    m_stats.m_matched += Match();
+    if (m_options.m_cancel.Cancelled()) return false;
+    m_stats.m_swapped += Swap();
+    m_stats.m_passes = pass + 1;
+    const double after = Hpwl();
+    if (m_options.m_progress) m_options.m_progress(100.0 * pass / passes);
+    if (before - after <= m_options.m_minImprovement * before) break;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool DetailedPlacer::Place(const Netlist& netlist, CellPlacement& placement) {
+  auto start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  m_error.clear();
+  if (placement.Size() != netlist.CellCount()) {
+    m_error = "the netlist is not placed";
+    return false;
+  }
+  m_stats.m_initialHpwl = placement.Hpwl(netlist, m_options.m_threads);
+  Engine engine(netlist, placement, m_options, m_stats, m_error);
+  const bool done = engine.Run();
+  m_stats.m_hpwl = placement.Hpwl(netlist, m_options.m_threads);
+  m_stats.m_seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  if (done && m_options.m_progress) m_options.m_progress(100);
+  return done;
+}
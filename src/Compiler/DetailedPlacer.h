@@ -0,0 +1,100 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/EventBus.h"
+#include "Compiler/Netlist.h"
+
+#ifndef DETAILED_PLACER_H
+#define DETAILED_PLACER_H
+
+namespace FOEDAG {
+
+// Detailed placer. Refines a legal placement, every movable cell at the
+// center of its own site of the die grid, by passes of:
+// - independent set matching: cells sharing no net are grouped by window
+//   and reassigned to their sites, and to the free sites of the window,
+//   by an optimal linear assignment of their wirelength;
+// - global swaps: each cell proposes the best move or swap towards the
+//   optimal region of its nets; non-conflicting proposals are applied.
+// Cells moved together never share a net, so every move is evaluated
+// against cells that stay put, without locks, and the wirelength never
+// increases. Proposals are ranked by gain then cell id, which makes the
+// result depend on the seed only, not on the number of threads.
+// Nets larger than kMaxNetDegree pins are ignored.
+//
+// Cells found off their site, on an occupied one or on one of another
+// resource are first moved to the nearest free site; the Legalizer does
+// that better.
+class DeviceModel;
+
+class DetailedPlacer {
+ public:
+  static constexpr uint32_t kMaxNetDegree = 64;
+
+  struct Options {
+    // Matching and swap passes, at most
+    int m_passes = 8;
+    // Stop once a pass shortens the wirelength by less than this fraction
+    double m_minImprovement = 0.001;
+    uint64_t m_seed = 1;
+    // Site types, the die is a grid of sites taking any logic when null
+    const DeviceModel* m_device = nullptr;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    CancellationToken m_cancel;
+    // Completion estimate in percent, called from the placing thread
+    std::function<void(double)> m_progress;
+  };
+  struct Stats {
+    size_t m_movable = 0;
+    size_t m_snapped = 0;  // cells moved to a free site first
+    int m_passes = 0;
+    size_t m_matched = 0;  // cells moved by matching
+    size_t m_swapped = 0;  // cells moved by swaps
+    double m_initialHpwl = 0;
+    double m_hpwl = 0;
+    double m_seconds = 0;
+  };
+
+  DetailedPlacer() = default;
+  explicit DetailedPlacer(const Options& options) : m_options(options) {}
+
+  // False when cancelled, when the die has fewer sites than movable cells
+  // or does not match the device, see Error()
+  bool Place(const Netlist& netlist, CellPlacement& placement);
+
+  const Stats& GetStats() const { return m_stats; }
+  const std::string& Error() const { return m_error; }
+
+ private:
+  Options m_options;
+  Stats m_stats;
+  std::string m_error;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,134 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DetailedPlacer.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+
+#include "Compiler/GlobalPlacer.h"
+#include "Compiler/Test/TestDesigns.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// The logic cells on distinct sites of a die, in random order
+void Scatter(const Netlist& netlist, CellPlacement& placement, int side) {
+  placement.Reset(netlist.CellCount(), side, side);
+  std::vector<int> sites(side * side);
+  for (size_t i = 0; i < sites.size(); i++) sites[i] = (int)i;
+  std::shuffle(sites.begin(), sites.end(), std::mt19937(7));
+  placement.Set(0, 0, 0);
+  placement.SetFixed(0, true);
+  for (Netlist::CellId cell = 1; cell < netlist.CellCount(); cell++) {
+    placement.Set(cell, sites[cell] % side + 0.5f, sites[cell] / side + 0.5f);
+  }
+}
+
+// Every logic cell at the center of a site of its own
+bool Legal(const Netlist& netlist, const CellPlacement& placement) {
+  std::set<std::pair<float, float>> used;
+  for (Netlist::CellId cell = 1; cell < netlist.CellCount(); cell++) {
+    const float x = placement.X(cell), y = placement.Y(cell);
+    if (x != std::floor(x) + 0.5f || y != std::floor(y) + 0.5f) return false;
+    if (x < 0 || y < 0 || x > placement.Width() || y > placement.Height()) {
+      return false;
+    }
+    if (!used.insert({x, y}).second) return false;
+  }
+  return true;
+}
+
+TEST(DetailedPlacer, ShortensWiresOfALegalPlacement) {
+  Netlist netlist;
+  BuildMesh(netlist, 20, MeshPorts::Input);
+  CellPlacement placement;
+  Scatter(netlist, placement, 24);
+  DetailedPlacer::Options options;
+  options.m_passes = 20;
+  DetailedPlacer placer(options);
+  ASSERT_TRUE(placer.Place(netlist, placement));
+  const DetailedPlacer::Stats& stats = placer.GetStats();
+  EXPECT_EQ(stats.m_movable, 400u);
+  EXPECT_EQ(stats.m_snapped, 0u);
+  EXPECT_GT(stats.m_matched, 0u);
+  EXPECT_GT(stats.m_swapped, 0u);
+  EXPECT_TRUE(Legal(netlist, placement));
+  EXPECT_LT(stats.m_hpwl, 0.5 * stats.m_initialHpwl);
+  EXPECT_DOUBLE_EQ(stats.m_hpwl, placement.Hpwl(netlist));
+  EXPECT_EQ(placement.X(0), 0);
+}
+
+TEST(DetailedPlacer, SnapsAGlobalPlacementToSites) {
+  Netlist netlist;
+  BuildMesh(netlist, 30, MeshPorts::Input);
+  CellPlacement placement;
+  GlobalPlacer global;
+  ASSERT_TRUE(global.Place(netlist, placement));
+  DetailedPlacer placer;
+  ASSERT_TRUE(placer.Place(netlist, placement));
+  EXPECT_GT(placer.GetStats().m_snapped, 800u);
+  EXPECT_TRUE(Legal(netlist, placement));
+}
+
+TEST(DetailedPlacer, SameResultWithAnyThreadCount) {
+  Netlist netlist;
+  BuildMesh(netlist, 40, MeshPorts::Input);
+  CellPlacement placements[2];
+  for (int run = 0; run < 2; run++) {
+    Scatter(netlist, placements[run], 44);
+    DetailedPlacer::Options options;
+    options.m_threads = (run == 0) ? 1 : 4;
+    DetailedPlacer placer(options);
+    ASSERT_TRUE(placer.Place(netlist, placements[run]));
+  }
+  for (Netlist::CellId cell : netlist.Cells()) {
+    ASSERT_EQ(placements[0].X(cell), placements[1].X(cell));
+    ASSERT_EQ(placements[0].Y(cell), placements[1].Y(cell));
+  }
+}
+
+TEST(DetailedPlacer, FailsWhenTheDieIsTooSmall) {
+  Netlist netlist;
+  BuildMesh(netlist, 10, MeshPorts::Input);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 9, 9);
+  DetailedPlacer placer;
+  EXPECT_FALSE(placer.Place(netlist, placement));
+  EXPECT_THAT(placer.Error(), testing::HasSubstr("do not fit"));
+}
+
+TEST(DetailedPlacer, StopsWhenCancelled) {
+  Netlist netlist;
+  BuildMesh(netlist, 10, MeshPorts::Input);
+  CellPlacement placement;
+  Scatter(netlist, placement, 12);
+  DetailedPlacer::Options options;
+  options.m_cancel.Cancel();
+  DetailedPlacer placer(options);
+  EXPECT_FALSE(placer.Place(netlist, placement));
+  EXPECT_TRUE(placer.Error().empty());
+}
+}  // namespace
+}  // namespace FOEDAG
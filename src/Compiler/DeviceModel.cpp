@@ -0,0 +1,229 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/DeviceModel.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "Compiler/CellPlacement.h"
+
+using namespace FOEDAG;
+
+static const char* kResourceNames[] = {"lut", "ff", "bram", "io"};
+
+const char* DeviceModel::ResourceName(Resource resource) {
+  return resource < kResourceCount ? kResourceNames[resource] : "";
+}
+
+bool DeviceModel::ResourceFromName(std::string_view name,
+                                   Resource& resource) {
+  for (int i = 0; i < kResourceCount; i++) {
+    if (name == kResourceNames[i]) {
+      resource = (Resource)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+DeviceModel::Resource DeviceModel::CellResource(std::string_view cellType) {
+  if (CellPlacement::IsPort(cellType)) return Io;
+  std::string lower(cellType);
+  for (char& c : lower) c = (char)std::tolower((unsigned char)c);
+  if (lower.find("ff") != std::string::npos ||
+      lower.find("latch") != std::string::npos) {
+    return Ff;
+  }
+  if (lower.find("ram") != std::string::npos) return Bram;
+  return Lut;
+}
+
+// Value of attribute in the tag text, empty when missing
+static std::string Attribute(std::string_view tag, const std::string& name) {
+  const std::string key = " " + name + "=\"";
+  size_t begin = tag.find(key);
+  if (begin == std::string_view::npos) return std::string();
+  begin += key.size();
+  size_t end = tag.find('"', begin);
+  if (end == std::string_view::npos) return std::string();
+  return std::string(tag.substr(begin, end - begin));
+}
+
+bool DeviceModel::Load(const std::string& file, const std::string& name,
+                       std::string& error) {
+  std::ifstream stream(file);
+  if (!stream) {
+    error = "cannot open " + file;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  const std::string xml = buffer.str();
+  for (size_t pos = xml.find("<device "); pos != std::string::npos;
+       pos = xml.find("<device ", pos + 1)) {
+    size_t tagEnd = xml.find('>', pos);
+    if (tagEnd == std::string::npos) break;
+    if (Attribute(std::string_view(xml).substr(pos, tagEnd - pos), "name") !=
+        name) {
+      continue;
+    }
+    size_t end = xml.find("</device>", tagEnd);
+    if (end == std::string::npos) end = xml.size();
+    std::array<uint32_t, kResourceCount> counts{};
+    for (size_t res = xml.find("<resource ", tagEnd); res < end;
+         res = xml.find("<resource ", res + 1)) {
+      std::string_view tag = std::string_view(xml).substr(
+          res, xml.find('>', res) - res);
+      Resource resource;
+      if (!ResourceFromName(Attribute(tag, "type"), resource)) continue;
+      counts[resource] = (uint32_t)std::strtoul(
+          Attribute(tag, "num").c_str(), nullptr, 10);
+    }
+    Build(name, counts);
+    return true;
+  }
+  error = "no device " + name + " in " + file;
+  return false;
+}
+
+void DeviceModel::Build(const std::string& name,
+                        const std::array<uint32_t, kResourceCount>& counts) {
+  m_name = name;
+  m_generic = false;
+  m_counts = counts;
+  Layout();
+}
+
+void DeviceModel::BuildGeneric(uint32_t columns, uint32_t rows) {
+  m_name.clear();
+  m_generic = true;
+  m_counts = {};
+  m_counts[Lut] = columns * rows;
+  m_columns = columns;
+  m_rows = rows;
+  m_sites.assign((size_t)columns * rows, kAnySite);
+  m_pads.clear();
+}
+
+void DeviceModel::Clear() {
+  m_name.clear();
+  m_generic = false;
+  m_counts = {};
+  m_columns = m_rows = 0;
+  m_sites.clear();
+  m_pads.clear();
+}
+
+// About square: as many rows as the square root of the logic sites, the
+// columns of each type interleaved in proportion to their number
+void DeviceModel::Layout() {
+  const Resource logic[] = {Lut, Ff, Bram};
+  uint64_t total = 0;
+  for (Resource resource : logic) total += m_counts[resource];
+  m_rows = std::max<uint32_t>((uint32_t)std::ceil(std::sqrt((double)total)),
+                              1);
+  std::array<uint32_t, kResourceCount> columns{};
+  m_columns = 0;
+  for (Resource resource : logic) {
+    columns[resource] = (m_counts[resource] + m_rows - 1) / m_rows;
+    m_columns += columns[resource];
+  }
+  m_columns = std::max<uint32_t>(m_columns, 1);
+  m_sites.assign((size_t)m_columns * m_rows, kNoSite);
+  std::array<uint32_t, kResourceCount> used{};
+  for (uint32_t column = 0; column < m_columns; column++) {
+    // The type furthest behind its share of the columns so far
+    int best = -1;
+    double bestLag = 0;
+    for (Resource resource : logic) {
+      if (used[resource] == columns[resource]) continue;
+      double lag = (double)columns[resource] * (column + 1) / m_columns -
+                   used[resource];
+      if (best < 0 || lag > bestLag) {
+        best = resource;
+        bestLag = lag;
+      }
+    }
+    if (best < 0) break;
+    const uint32_t first = used[best]++ * m_rows;
+    const uint32_t sites =
+        std::min<uint32_t>(m_rows, m_counts[best] - first);
+    for (uint32_t row = 0; row < sites; row++) {
+      m_sites[(size_t)row * m_columns + column] = (uint8_t)best;
+    }
+  }
+
+  m_pads.clear();
+  const double width = m_columns, height = m_rows;
+  const double perimeter = 2.0 * (width + height);
+  for (uint32_t i = 0; i < m_counts[Io]; i++) {
+    const double t = (i + 0.5) * perimeter / m_counts[Io];
+    Pad pad{0, 0};
+    if (t < width) {
+      pad.m_x = (float)t;
+    } else if (t < width + height) {
+      pad.m_x = (float)width;
+      pad.m_y = (float)(t - width);
+    } else if (t < 2 * width + height) {
+      pad.m_x = (float)(2 * width + height - t);
+      pad.m_y = (float)height;
+    } else {
+      pad.m_y = (float)(perimeter - t);
+    }
+    m_pads.push_back(pad);
+  }
+}
+
+std::string DeviceModel::Spec() const {
+  if (Empty() || m_generic) return std::string();
+  std::ostringstream spec;
+  spec << m_name;
+  for (int i = 0; i < kResourceCount; i++) {
+    spec << " " << kResourceNames[i] << " " << m_counts[i];
+  }
+  return spec.str();
+}
+
+bool DeviceModel::FromSpec(std::string_view spec, std::string& error) {
+  std::istringstream in{std::string(spec)};
+  std::string name, type;
+  std::array<uint32_t, kResourceCount> counts{};
+  if (!(in >> name)) {
+    error = "empty device specification";
+    return false;
+  }
+  while (in >> type) {
+    Resource resource;
+    uint32_t count = 0;
+    if (!ResourceFromName(type, resource) || !(in >> count)) {
+      error = "bad device resource \"" + type + "\", expected " +
+              "lut, ff, bram or io followed by a count";
+      return false;
+    }
+    counts[resource] = count;
+  }
+  Build(name, counts);
+  return true;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef DEVICE_MODEL_H
+#define DEVICE_MODEL_H
+
+namespace FOEDAG {
+
+// Site grid of a device, laid out from its resource counts (device.xml
+// only lists those). Logic sites are one per resource, in columns of a
+// single resource type spread across the die, as in columnar FPGA fabrics;
+// the rows past the count of the last column of a type are not sites. IO
+// pads are evenly spread along the die boundary. The layout only depends
+// on the counts, every run lays a device out the same way.
+//
+// A generic model, without resource types, is a full grid of sites that
+// take any logic cell and has no pads.
+class DeviceModel {
+ public:
+  enum Resource : uint8_t { Lut, Ff, Bram, Io, kResourceCount };
+  // Site values besides the resources
+  static constexpr uint8_t kNoSite = 0xFF;
+  static constexpr uint8_t kAnySite = 0xFE;
+
+  struct Pad {
+    float m_x;
+    float m_y;
+  };
+
+  static const char* ResourceName(Resource resource);
+  static bool ResourceFromName(std::string_view name, Resource& resource);
+  // Resource implementing a netlist cell type: ports are Io, flip-flops
+  // and latches Ff, memories Bram, anything else Lut
+  static Resource CellResource(std::string_view cellType);
+
+  // The device called name in a device.xml file
+  bool Load(const std::string& file, const std::string& name,
+            std::string& error);
+  void Build(const std::string& name,
+             const std::array<uint32_t, kResourceCount>& counts);
+  void BuildGeneric(uint32_t columns, uint32_t rows);
+  void Clear();
+
+  bool Empty() const { return m_sites.empty(); }
+  bool Generic() const { return m_generic; }
+  const std::string& Name() const { return m_name; }
+  uint32_t Count(Resource resource) const { return m_counts[resource]; }
+
+  uint32_t Columns() const { return m_columns; }
+  uint32_t Rows() const { return m_rows; }
+  // Row major, a Resource, kAnySite or kNoSite
+  uint8_t Site(uint32_t column, uint32_t row) const {
+    return m_sites[(size_t)row * m_columns + column];
+  }
+  const std::vector<uint8_t>& Sites() const { return m_sites; }
+  static bool Accepts(uint8_t site, Resource resource) {
+    return site == resource || (site == kAnySite && resource != Io);
+  }
+  // Counterclockwise from the lower left corner
+  const std::vector<Pad>& Pads() const { return m_pads; }
+
+  // "<name> <resource> <count>...", what set_device -spec takes,
+  // empty for generic models
+  std::string Spec() const;
+  bool FromSpec(std::string_view spec, std::string& error);
+
+ private:
+  void Layout();
+
+  std::string m_name;
+  bool m_generic = false;
+  std::array<uint32_t, kResourceCount> m_counts{};
+  uint32_t m_columns = 0;
+  uint32_t m_rows = 0;
+  std::vector<uint8_t> m_sites;
+  std::vector<Pad> m_pads;
+};
+
+}  // namespace FOEDAG
+
+#endif
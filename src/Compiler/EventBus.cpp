@@ -0,0 +1,89 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/EventBus.h"
+
+#include <cstring>
+
+using namespace FOEDAG;
+
+void CompilerEvent::SetName(const char* name) {
+  strncpy(m_name, name, sizeof(m_name) - 1);
+  m_name[sizeof(m_name) - 1] = '\0';
+}
+
+EventBus::EventBus(size_t capacity) : m_ring(capacity) {}
+
+EventBus::~EventBus() {
+  m_running = false;
+  if (m_dispatcher.joinable()) m_dispatcher.join();
+}
+
+EventBus* EventBus::Instance() {
+  // Never destroyed, like the TaskScheduler
+  static EventBus* bus = new EventBus;
+  return bus;
+}
+
+bool EventBus::Publish(CompilerEvent event) {
+  event.m_timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       Clock::now().time_since_epoch())
+                       .count();
+  if (m_ring.Push(event)) return true;
+  m_dropped++;
+  return false;
+}
+
+int EventBus::Subscribe(Subscriber subscriber) {
+  std::lock_guard<std::mutex> lock(m_dispatchMutex);
+  int id = ++m_lastSubscriber;
+  m_subscribers[id] = subscriber;
+  if (!m_running.exchange(true)) {
+    m_dispatcher = std::thread([this] { DispatchLoop(); });
+  }
+  return id;
+}
+
+void EventBus::Unsubscribe(int id) {
+  std::lock_guard<std::mutex> lock(m_dispatchMutex);
+  m_subscribers.erase(id);
+}
+
+// The dispatch mutex makes every caller the single consumer of the ring
+size_t EventBus::Dispatch() {
+  std::lock_guard<std::mutex> lock(m_dispatchMutex);
+  size_t count = 0;
+  CompilerEvent event;
+  while (m_ring.Pop(event)) {
+    for (auto& subscriber : m_subscribers) subscriber.second(event);
+    count++;
+  }
+  return count;
+}
+
+void EventBus::DispatchLoop() {
+  while (m_running) {
+    if (Dispatch() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+  Dispatch();
+}
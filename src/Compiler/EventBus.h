@@ -0,0 +1,169 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+namespace FOEDAG {
+
+// Fixed size record published by the compiler stages, cheap to copy
+struct CompilerEvent {
+  enum Type : uint8_t { Phase, Progress, Counter, Eta };
+  Type m_type = Phase;
+  uint32_t m_source = 0;  // EventBus::NewSource() of the publisher
+  int32_t m_stage = 0;    // Compiler::Action
+  double m_value = 0;     // percent, counter value or seconds left
+  int64_t m_timeNs = 0;   // steady clock
+  char m_name[40] = {};   // phase or counter name, truncated
+
+  void SetName(const char* name);
+};
+
+// Bounded multi-producer single-consumer ring (D. Vyukov's sequence
+// numbered cells). Push never blocks nor locks, it fails when full.
+template <typename T>
+class MpscRing {
+ public:
+  explicit MpscRing(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    m_mask = size - 1;
+    m_cells = std::unique_ptr<Cell[]>(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+      m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool Push(const T& value) {
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = m_cells[pos & m_mask];
+      size_t seq = cell.m_sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+          cell.m_value = value;
+          cell.m_sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Single consumer only
+  bool Pop(T& value) {
+    Cell& cell = m_cells[m_head & m_mask];
+    size_t seq = cell.m_sequence.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(m_head + 1) < 0) return false;  // Empty
+    value = cell.m_value;
+    cell.m_sequence.store(m_head + m_mask + 1, std::memory_order_release);
+    m_head++;
+    return true;
+  }
+
+  size_t Capacity() const { return m_mask + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> m_sequence;
+    T m_value;
+  };
+  std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask = 0;
+  alignas(64) std::atomic<size_t> m_tail{0};
+  alignas(64) size_t m_head = 0;
+};
+
+// Structured progress channel of the compiler. Stages publish from any
+// thread without locking; subscribers (GUI, console, Tcl) are called from
+// one dispatching thread at a time, in publication order per publisher.
+// Events published while the ring is full are dropped and counted, a slow
+// subscriber never stalls a stage.
+class EventBus {
+ public:
+  typedef std::function<void(const CompilerEvent&)> Subscriber;
+  typedef std::chrono::steady_clock Clock;
+
+  explicit EventBus(size_t capacity = 1 << 14);
+  ~EventBus();
+
+  // Process wide bus, started dispatching on first subscription
+  static EventBus* Instance();
+
+  uint32_t NewSource() { return ++m_lastSource; }
+
+  bool Publish(CompilerEvent event);
+  uint64_t Dropped() const { return m_dropped.load(); }
+
+  // Subscribers must not subscribe or unsubscribe from their callback
+  int Subscribe(Subscriber subscriber);
+  // Once it returns, the subscriber is not running and will not be called
+  void Unsubscribe(int id);
+
+  // Delivers the pending events to the subscribers, returns their number.
+  // Called periodically by the dispatching thread, or directly to flush.
+  size_t Dispatch();
+
+ private:
+  void DispatchLoop();
+
+  MpscRing<CompilerEvent> m_ring;
+  std::atomic<uint32_t> m_lastSource{0};
+  std::atomic<uint64_t> m_dropped{0};
+  std::mutex m_dispatchMutex;
+  std::map<int, Subscriber> m_subscribers;
+  int m_lastSubscriber = 0;
+  std::thread m_dispatcher;
+  std::atomic<bool> m_running{false};
+};
+
+// Cancellation flag shared between whoever requests the cancellation and
+// the stages, which poll it with a relaxed load in their loops
+class CancellationToken {
+ public:
+  CancellationToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+  void Cancel() { m_flag->store(true, std::memory_order_relaxed); }
+  void Reset() { m_flag->store(false, std::memory_order_relaxed); }
+  bool Cancelled() const { return m_flag->load(std::memory_order_relaxed); }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,104 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/EventBus.h"
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(EventBus, RingIsFifoAndBounded) {
+  MpscRing<int> ring(4);
+  EXPECT_EQ(ring.Capacity(), 4u);
+  for (int i = 0; i < 4; i++) EXPECT_TRUE(ring.Push(i));
+  EXPECT_FALSE(ring.Push(4));
+  int value = -1;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(ring.Pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(ring.Pop(value));
+  // Wraps around
+  EXPECT_TRUE(ring.Push(5));
+  EXPECT_TRUE(ring.Pop(value));
+  EXPECT_EQ(value, 5);
+}
+
+TEST(EventBus, KeepsPublisherOrder) {
+  EventBus bus(1 << 16);
+  const int producers = 4;
+  const int events = 5000;
+  std::vector<uint32_t> sources;
+  for (int p = 0; p < producers; p++) sources.push_back(bus.NewSource());
+  std::vector<double> last(producers + 1, -1);
+  bool ordered = true;
+  int received = 0;
+  bus.Subscribe([&](const CompilerEvent& event) {
+    if (event.m_value <= last[event.m_source]) ordered = false;
+    last[event.m_source] = event.m_value;
+    received++;
+  });
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&bus, &sources, p] {
+      for (int i = 0; i < events; i++) {
+        CompilerEvent event;
+        event.m_type = CompilerEvent::Progress;
+        event.m_source = sources[p];
+        event.m_value = i;
+        bus.Publish(event);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  bus.Dispatch();
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(bus.Dropped(), 0u);
+  EXPECT_EQ(received, producers * events);
+}
+
+TEST(EventBus, DropsWhenFull) {
+  EventBus bus(2);
+  CompilerEvent event;
+  event.SetName("a name longer than the forty characters of the event record");
+  EXPECT_EQ(std::string(event.m_name).size(), sizeof(event.m_name) - 1);
+  EXPECT_TRUE(bus.Publish(event));
+  EXPECT_TRUE(bus.Publish(event));
+  EXPECT_FALSE(bus.Publish(event));
+  EXPECT_EQ(bus.Dropped(), 1u);
+  EXPECT_EQ(bus.Dispatch(), 2u);
+}
+
+TEST(EventBus, CancellationTokenIsShared) {
+  CancellationToken token;
+  CancellationToken copy = token;
+  EXPECT_FALSE(copy.Cancelled());
+  token.Cancel();
+  EXPECT_TRUE(copy.Cancelled());
+  copy.Reset();
+  EXPECT_FALSE(token.Cancelled());
+}
+}  // namespace
+}  // namespace FOEDAG
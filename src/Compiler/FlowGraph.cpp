@@ -0,0 +1,188 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/FlowGraph.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace FOEDAG;
+
+void FlowGraph::AddStage(int id, const std::string& name,
+                         const std::vector<int>& upstream, InputsFunc inputs,
+                         StageFunc run) {
+  Node& node = m_nodes[id];
+  node.m_name = name;
+  node.m_upstream = upstream;
+  node.m_inputs = inputs;
+  node.m_run = run;
+  node.m_fingerprint = 0;
+  node.m_done = false;
+}
+
+void FlowGraph::SetStageResults(int id, SaveFunc save, RestoreFunc restore) {
+  Node& node = m_nodes[id];
+  node.m_save = save;
+  node.m_restore = restore;
+}
+
+const std::string& FlowGraph::StageName(int id) const {
+  static const std::string unknown = "unknown";
+  auto it = m_nodes.find(id);
+  return (it == m_nodes.end()) ? unknown : it->second.m_name;
+}
+
+void FlowGraph::Ancestors(int id, std::vector<int>& order,
+                          std::map<int, bool>& seen) {
+  if (seen[id]) return;
+  seen[id] = true;
+  auto it = m_nodes.find(id);
+  if (it == m_nodes.end()) return;
+  for (int up : it->second.m_upstream) Ancestors(up, order, seen);
+  order.push_back(id);
+}
+
+FlowGraph::Fingerprint FlowGraph::Fingerprints(
+    int id, std::map<int, Fingerprint>& memo) {
+  auto found = memo.find(id);
+  if (found != memo.end()) return found->second;
+  Node& node = m_nodes[id];
+  Fingerprint fp = Hash(node.m_name);
+  if (node.m_inputs) fp = Hash(node.m_inputs(), fp);
+  for (int up : node.m_upstream) fp = Hash(Fingerprints(up, memo), fp);
+  memo[id] = fp;
+  return fp;
+}
+
+FlowGraph::Fingerprint FlowGraph::ComputeFingerprint(int id) {
+  std::map<int, Fingerprint> memo;
+  return Fingerprints(id, memo);
+}
+
+FlowGraph::Fingerprint FlowGraph::LastFingerprint(int id) const {
+  auto it = m_nodes.find(id);
+  if (it == m_nodes.end() || !it->second.m_done) return 0;
+  return it->second.m_fingerprint;
+}
+
+bool FlowGraph::UpToDate(int id) {
+  auto it = m_nodes.find(id);
+  if (it == m_nodes.end() || !it->second.m_done) return false;
+  return it->second.m_fingerprint == ComputeFingerprint(id);
+}
+
+bool FlowGraph::Run(int id, std::ostream& out) {
+  if (m_nodes.find(id) == m_nodes.end()) return false;
+  std::vector<int> order;
+  std::map<int, bool> seen;
+  Ancestors(id, order, seen);
+
+  // Inputs are hashed once, before anything runs
+  std::map<int, Fingerprint> memo;
+  for (int stage : order) Fingerprints(stage, memo);
+
+  for (int stage : order) {
+    Node& node = m_nodes[stage];
+    Fingerprint fp = memo[stage];
+    if (node.m_done && node.m_fingerprint == fp) {
+      out << node.m_name << " is up to date, skipping." << std::endl;
+      continue;
+    }
+    node.m_done = false;
+    const bool cached = m_cache && m_cache->Enabled() && node.m_save &&
+                        node.m_restore;
+    if (cached) {
+      std::string payload;
+      if (m_cache->Load(StageCache::Key(fp), payload) &&
+          node.m_restore(payload)) {
+        out << node.m_name << " restored from cache." << std::endl;
+        node.m_fingerprint = fp;
+        node.m_done = true;
+        continue;
+      }
+    }
+    if (!node.m_run || !node.m_run()) return false;
+    node.m_fingerprint = fp;
+    node.m_done = true;
+    if (cached) m_cache->Store(StageCache::Key(fp), node.m_save());
+  }
+  return true;
+}
+
+void FlowGraph::Invalidate(int id) {
+  auto it = m_nodes.find(id);
+  if (it == m_nodes.end()) return;
+  it->second.m_done = false;
+  for (auto& node : m_nodes) {
+    for (int up : node.second.m_upstream) {
+      if (up == id) Invalidate(node.first);
+    }
+  }
+}
+
+void FlowGraph::MarkDone(int id, Fingerprint fingerprint) {
+  auto it = m_nodes.find(id);
+  if (it == m_nodes.end()) return;
+  it->second.m_fingerprint = fingerprint;
+  it->second.m_done = true;
+}
+
+FlowGraph::Fingerprint FlowGraph::Hash(const void* data, size_t size,
+                                       Fingerprint seed) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  Fingerprint hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+FlowGraph::Fingerprint FlowGraph::HashFile(const std::string& path,
+                                           Fingerprint seed) {
+  std::error_code ec;
+  uintmax_t size = std::filesystem::file_size(path, ec);
+  if (ec) return Hash(path + ":missing", seed);
+  int64_t time =
+      std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+
+  Fingerprint content = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    auto it = m_fileHashes.find(path);
+    if (it != m_fileHashes.end() && it->second.m_size == size &&
+        it->second.m_time == time) {
+      content = it->second.m_hash;
+    }
+  }
+  if (content == 0) {
+    content = kHashSeed;
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<char> buffer(1 << 16);
+    while (stream) {
+      stream.read(buffer.data(), buffer.size());
+      content = Hash(buffer.data(), (size_t)stream.gcount(), content);
+    }
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    m_fileHashes[path] = FileHash{size, time, content};
+  }
+  return Hash(content, seed);
+}
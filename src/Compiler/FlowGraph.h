@@ -0,0 +1,118 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Compiler/StageCache.h"
+
+#ifndef FLOW_GRAPH_H
+#define FLOW_GRAPH_H
+
+namespace FOEDAG {
+
+// Dependency graph of the compilation stages. Every stage fingerprints its
+// own inputs; a stage's fingerprint also folds in the fingerprints of its
+// upstream stages. Running a stage only executes the stages on its path
+// whose fingerprint changed since their last successful run. When a
+// StageCache is attached, stale stages are first looked up in it by
+// fingerprint and their results restored instead of recomputed.
+class FlowGraph {
+ public:
+  typedef uint64_t Fingerprint;
+  typedef std::function<bool()> StageFunc;
+  typedef std::function<Fingerprint()> InputsFunc;
+  typedef std::function<std::string()> SaveFunc;
+  typedef std::function<bool(const std::string&)> RestoreFunc;
+
+  static const Fingerprint kHashSeed = 14695981039346656037ULL;
+
+  void AddStage(int id, const std::string& name,
+                const std::vector<int>& upstream, InputsFunc inputs,
+                StageFunc run);
+  // Serialization of the stage results, required for caching
+  void SetStageResults(int id, SaveFunc save, RestoreFunc restore);
+  void SetCache(StageCache* cache) { m_cache = cache; }
+
+  // Brings stage id up to date, returns false if a stage fails
+  bool Run(int id, std::ostream& out);
+
+  // Fingerprint of the current inputs of stage id and of all its upstream
+  Fingerprint ComputeFingerprint(int id);
+  // Fingerprint of the last successful run of stage id, 0 if none
+  Fingerprint LastFingerprint(int id) const;
+  bool UpToDate(int id);
+
+  // Forces stage id and everything downstream of it to rerun
+  void Invalidate(int id);
+  // Marks stage id as run with the given fingerprint, used when restoring
+  // results from elsewhere
+  void MarkDone(int id, Fingerprint fingerprint);
+
+  const std::string& StageName(int id) const;
+
+  // FNV-1a hashing helpers
+  static Fingerprint Hash(const void* data, size_t size,
+                          Fingerprint seed = kHashSeed);
+  static Fingerprint Hash(const std::string& str,
+                          Fingerprint seed = kHashSeed) {
+    return Hash(str.data(), str.size(), seed);
+  }
+  static Fingerprint Hash(Fingerprint value, Fingerprint seed) {
+    return Hash(&value, sizeof(value), seed);
+  }
+  // Content hash of a file, memoized on (size, modification time)
+  Fingerprint HashFile(const std::string& path, Fingerprint seed = kHashSeed);
+
+ private:
+  struct Node {
+    std::string m_name;
+    std::vector<int> m_upstream;
+    InputsFunc m_inputs;
+    StageFunc m_run;
+    SaveFunc m_save;
+    RestoreFunc m_restore;
+    Fingerprint m_fingerprint = 0;
+    bool m_done = false;
+  };
+  struct FileHash {
+    uintmax_t m_size = 0;
+    int64_t m_time = 0;
+    Fingerprint m_hash = 0;
+  };
+
+  void Ancestors(int id, std::vector<int>& order, std::map<int, bool>& seen);
+  Fingerprint Fingerprints(int id, std::map<int, Fingerprint>& memo);
+
+  std::map<int, Node> m_nodes;
+  StageCache* m_cache = nullptr;
+  std::mutex m_fileMutex;
+  std::map<std::string, FileHash> m_fileHashes;
+};
+
+}  // namespace FOEDAG
+
+#endif
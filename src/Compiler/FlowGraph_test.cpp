@@ -0,0 +1,89 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/FlowGraph.h"
+
+#include <sstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(FlowGraph, RerunsOnlyStaleStages) {
+  FlowGraph flow;
+  std::string sources = "module top; endmodule";
+  std::string constraints = "create_clock -period 10 clk";
+  int synthRuns = 0;
+  int placeRuns = 0;
+  flow.AddStage(
+      0, "synth", {}, [&sources] { return FlowGraph::Hash(sources); },
+      [&synthRuns] { return ++synthRuns > 0; });
+  flow.AddStage(
+      1, "place", {0}, [&constraints] { return FlowGraph::Hash(constraints); },
+      [&placeRuns] { return ++placeRuns > 0; });
+  std::ostringstream out;
+
+  EXPECT_TRUE(flow.Run(1, out));
+  EXPECT_EQ(synthRuns, 1);
+  EXPECT_EQ(placeRuns, 1);
+
+  // Nothing changed
+  EXPECT_TRUE(flow.Run(1, out));
+  EXPECT_EQ(synthRuns, 1);
+  EXPECT_EQ(placeRuns, 1);
+
+  // Constraints only change skips synthesis
+  constraints = "create_clock -period 5 clk";
+  EXPECT_FALSE(flow.UpToDate(1));
+  EXPECT_TRUE(flow.UpToDate(0));
+  EXPECT_TRUE(flow.Run(1, out));
+  EXPECT_EQ(synthRuns, 1);
+  EXPECT_EQ(placeRuns, 2);
+
+  // Source change reruns everything downstream
+  sources = "module top(input a); endmodule";
+  EXPECT_TRUE(flow.Run(1, out));
+  EXPECT_EQ(synthRuns, 2);
+  EXPECT_EQ(placeRuns, 3);
+
+  flow.Invalidate(0);
+  EXPECT_FALSE(flow.UpToDate(1));
+}
+
+TEST(FlowGraph, FailedStageIsRetried) {
+  FlowGraph flow;
+  bool fail = true;
+  int runs = 0;
+  flow.AddStage(0, "synth", {}, nullptr, [&fail, &runs] {
+    runs++;
+    return !fail;
+  });
+  std::ostringstream out;
+  EXPECT_FALSE(flow.Run(0, out));
+  fail = false;
+  EXPECT_TRUE(flow.Run(0, out));
+  EXPECT_TRUE(flow.Run(0, out));
+  EXPECT_EQ(runs, 2);
+}
+
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,924 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/GlobalPlacer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "Compiler/TaskScheduler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace FOEDAG;
+
+namespace {
+
+// Elements per task; fixed so that the partial sums, hence the results,
+// are the same whatever the number of threads
+constexpr size_t kGrain = 2048;
+// Density rows accumulated per task
+constexpr uint32_t kBandRows = 8;
+// Bins covered by the potential of a cell along one axis. The kernels
+// always process this many, with zero weights past the reach of the cell,
+// so that their inner loops have a fixed trip count and vectorize.
+constexpr int kSpan = 8;
+// Nonlinear iterations between two raises of the density weight
+constexpr int kIterationsPerWeight = 5;
+constexpr float kWeightGrowth = 1.4f;
+// Pull of the quadratic start towards the die center, keeps the system
+// positive definite when nothing is fixed
+constexpr float kAnchorWeight = 0.01f;
+constexpr int kMaxSolverIterations = 200;
+
+// NTUPlace bell shaped potential of a cell along one axis: 1 - a d^2 close
+// to the bin center, b (d - reach)^2 further away, zero beyond reach.
+// Cells are at most a bin wide, the potential spans at most 6 bins.
+class BellAxis {
+ public:
+  BellAxis(float size, float binSize, uint32_t bins)
+      : m_binSize(binSize),
+        m_inverse(1 / binSize),
+        m_inner(size / 2 + binSize),
+        m_reach(size / 2 + 2 * binSize),
+        m_a(4 / ((size + 2 * binSize) * (size + 4 * binSize))),
+        m_b(2 / (binSize * (size + 4 * binSize))),
+        m_bins((int)bins) {}
+
+  // Bin of a coordinate, clamped to the grid
+  int Bin(float c) const {
+    return std::min(std::max((int)(c * m_inverse), 0), m_bins - 1);
+  }
+  // Bins a cell centered at c may touch on each side of its own
+  int Reach() const { return (int)std::ceil(m_reach * m_inverse); }
+
+  // Potential of the kSpan bins from first on for a cell centered at c,
+  // zero for the bins off the grid, and its derivative in c when kSlope.
+  // The first count lanes are the ones within reach. Returns the sum of
+  // the weights. Four lanes at a time with SSE2, the
+  // scalar version is branchy and several times slower.
+  template <bool kSlope>
+  float Weights(float c, int& first, int& count, float* weight,
+                float* slope) const {
+    const float from = (c - m_reach) * m_inverse;
+    first = (int)from - (from < (int)from);
+    count = std::min((int)((c + m_reach) * m_inverse) - first + 1, kSpan);
+    // Lane k is bin first + k, at distance origin - k * binSize from c
+    const float origin = c - (first + 0.5f) * m_binSize;
+    const float lowest = -0.5f - first;
+    const float highest = m_bins - 0.5f - first;
+#if defined(__SSE2__)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 sum = zero;
+    for (int k = 0; k < kSpan; k += 4) {
+      const __m128 lane =
+          _mm_add_ps(_mm_set1_ps((float)k), _mm_setr_ps(0, 1, 2, 3));
+      const __m128 valid =
+          _mm_and_ps(_mm_cmpgt_ps(lane, _mm_set1_ps(lowest)),
+                     _mm_cmplt_ps(lane, _mm_set1_ps(highest)));
+      const __m128 d = _mm_sub_ps(_mm_set1_ps(origin),
+                                  _mm_mul_ps(lane, _mm_set1_ps(m_binSize)));
+      const __m128 ad = _mm_andnot_ps(sign, d);
+      const __m128 t =
+          _mm_min_ps(_mm_sub_ps(ad, _mm_set1_ps(m_reach)), zero);
+      const __m128 inner = _mm_cmple_ps(ad, _mm_set1_ps(m_inner));
+      const __m128 a = _mm_set1_ps(m_a);
+      const __m128 b = _mm_set1_ps(m_b);
+      const __m128 near =
+          _mm_sub_ps(_mm_set1_ps(1), _mm_mul_ps(a, _mm_mul_ps(d, d)));
+      const __m128 far = _mm_mul_ps(b, _mm_mul_ps(t, t));
+      const __m128 w = _mm_and_ps(valid, Select(inner, near, far));
+      _mm_storeu_ps(weight + k, w);
+      sum = _mm_add_ps(sum, w);
+      if (kSlope) {
+        const __m128 nearSlope = _mm_mul_ps(_mm_set1_ps(-2 * m_a), d);
+        const __m128 farSlope =
+            _mm_mul_ps(_mm_set1_ps(2 * m_b),
+                       _mm_xor_ps(t, _mm_and_ps(sign, d)));
+        _mm_storeu_ps(slope + k,
+                      _mm_and_ps(valid, Select(inner, nearSlope, farSlope)));
+      }
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#else
+    float sum = 0;
+    for (int k = 0; k < kSpan; k++) {
+      const bool valid = (k > lowest) & (k < highest);
+      const float d = origin - k * m_binSize;
+      const float ad = std::fabs(d);
+      const float t = std::min(ad - m_reach, 0.0f);
+      const bool inner = ad <= m_inner;
+      weight[k] = valid ? (inner ? 1 - m_a * d * d : m_b * t * t) : 0.0f;
+      sum += weight[k];
+      if (kSlope) {
+        const float s = inner ? -2 * m_a * d : 2 * m_b * (d < 0 ? -t : t);
+        slope[k] = valid ? s : 0.0f;
+      }
+    }
+    return sum;
+#endif
+  }
+
+ private:
+#if defined(__SSE2__)
+  static __m128 Select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+#endif
+
+  float m_binSize;
+  float m_inverse;
+  float m_inner;
+  float m_reach;
+  float m_a;
+  float m_b;
+  int m_bins;
+};
+
+// Lane kernels over kSpan floats
+// out += scale * a
+inline void ScaleAdd(float* out, float scale, const float* a) {
+#if defined(__SSE2__)
+  const __m128 factor = _mm_set1_ps(scale);
+  for (int k = 0; k < kSpan; k += 4) {
+    _mm_storeu_ps(out + k, _mm_add_ps(_mm_loadu_ps(out + k),
+                                      _mm_mul_ps(factor, _mm_loadu_ps(a + k))));
+  }
+#else
+  for (int k = 0; k < kSpan; k++) out[k] += scale * a[k];
+#endif
+}
+
+// out += scale * a * b
+inline void MultiplyAdd(float* out, float scale, const float* a,
+                        const float* b) {
+#if defined(__SSE2__)
+  const __m128 factor = _mm_set1_ps(scale);
+  for (int k = 0; k < kSpan; k += 4) {
+    const __m128 product = _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+    _mm_storeu_ps(out + k, _mm_add_ps(_mm_loadu_ps(out + k),
+                                      _mm_mul_ps(factor, product)));
+  }
+#else
+  for (int k = 0; k < kSpan; k++) out[k] += scale * a[k] * b[k];
+#endif
+}
+
+inline float LaneSum(const float* a) {
+  float sum = 0;
+  for (int k = 0; k < kSpan; k++) sum += a[k];
+  return sum;
+}
+
+// Lanes processed by ExpArray, a multiple of the SIMD width
+inline size_t Padded(size_t count) { return (count + 3) & ~(size_t)3; }
+
+// a = e^a in place over count floats, count a multiple of 4, for a <= 0
+// (the WA exponents are shifted to be). Cephes expf polynomial with SSE2,
+// within 2e-7 of std::exp; results below e^-87 are not exact.
+inline void ExpArray(float* a, size_t count) {
+#if defined(__SSE2__)
+  for (size_t i = 0; i < count; i += 4) {
+    __m128 x = _mm_max_ps(_mm_loadu_ps(a + i), _mm_set1_ps(-87.0f));
+    // x = n ln2 + r, |r| <= ln2 / 2
+    const __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)));
+    const __m128 fn = _mm_cvtepi32_ps(n);
+    x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+    x = _mm_add_ps(x, _mm_mul_ps(fn, _mm_set1_ps(2.12194440e-4f)));
+    __m128 p = _mm_set1_ps(1.9875691500e-4f);
+    for (float c : {1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f,
+                    1.6666665459e-1f, 5.0000001201e-1f}) {
+      p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(c));
+    }
+    p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, x), x),
+                   _mm_add_ps(x, _mm_set1_ps(1.0f)));
+    // times 2^n, built in the exponent bits
+    const __m128i scale =
+        _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    _mm_storeu_ps(a + i, _mm_mul_ps(p, _mm_castsi128_ps(scale)));
+  }
+#else
+  for (size_t i = 0; i < count; i++) a[i] = std::exp(a[i]);
+#endif
+}
+
+class Engine {
+ public:
+  Engine(const Netlist& netlist, CellPlacement& placement,
+         const GlobalPlacer::Options& options, GlobalPlacer::Stats& stats)
+      : m_netlist(netlist),
+        m_placement(placement),
+        m_options(options),
+        m_stats(stats),
+        m_scheduler(TaskScheduler::Instance()) {}
+
+  bool Run();
+
+ private:
+  template <typename F>
+  void For(size_t count, size_t grain, F&& body) {
+    m_scheduler->ParallelFor(0, count, grain, body, m_options.m_threads);
+  }
+  // Sum of body(begin, end) over the chunks, added in chunk order
+  template <typename F>
+  double Sum(size_t count, F&& body) {
+    std::vector<double> partial((count + kGrain - 1) / kGrain, 0.0);
+    For(count, kGrain, [&](size_t begin, size_t end) {
+      partial[begin / kGrain] = body(begin, end);
+    });
+    double sum = 0;
+    for (double value : partial) sum += value;
+    return sum;
+  }
+  double Dot(const float* ax, const float* ay, const float* bx,
+             const float* by) {
+    return Sum(m_cells, [=](size_t begin, size_t end) {
+      double sum = 0;
+      for (size_t i = begin; i < end; i++) {
+        sum += (double)ax[i] * bx[i] + (double)ay[i] * by[i];
+      }
+      return sum;
+    });
+  }
+
+  void Setup();
+  void PlacePorts(const std::vector<Netlist::CellId>& ports);
+  void Clamp();
+
+  void GatherPins(float* gx, float* gy);
+  double WaAxis(const float* v, size_t count, float gamma, float* scratch,
+                float* grad) const;
+  double Wirelength(float gamma, float* gx, float* gy);
+  void QuadraticGradient(const float* vx, const float* vy, float* gx,
+                         float* gy);
+  int SolveQuadratic();
+
+  double Density();
+  void DensityGradient(float* gx, float* gy);
+  double Evaluate(float lambda, float gamma);
+  void Precondition(float lambda, float* zx, float* zy);
+  void Progress(double overflow);
+
+  const Netlist& m_netlist;
+  CellPlacement& m_placement;
+  const GlobalPlacer::Options& m_options;
+  GlobalPlacer::Stats& m_stats;
+  TaskScheduler* m_scheduler;
+
+  size_t m_cells = 0;
+  float* m_x = nullptr;
+  float* m_y = nullptr;
+  float m_width = 0;
+  float m_height = 0;
+  std::vector<uint8_t> m_movable;
+  std::vector<Netlist::CellId> m_movableCells;
+  // Nets that are wires: two pins or more, not driven by a constant
+  std::vector<Netlist::NetId> m_nets;
+  std::vector<float> m_pinCount;  // wire pins per cell
+
+  // Per pin gradients of the net kernels
+  std::vector<float> m_pinGradX;
+  std::vector<float> m_pinGradY;
+  size_t m_maxDegree = 0;
+
+  // Per cell vectors, zero for the cells that do not move
+  std::vector<float> m_gx, m_gy;        // objective gradient
+  std::vector<float> m_wlX, m_wlY;      // wirelength gradient
+  std::vector<float> m_denX, m_denY;    // density gradient
+  std::vector<float> m_prevX, m_prevY;  // previous gradient
+  std::vector<float> m_dirX, m_dirY;    // search direction
+  std::vector<float> m_zX, m_zY;        // preconditioned gradient
+
+  // Density grid, m_bins x m_bins, row major. Rows have kSpan bins of
+  // padding on both sides, where the zero weights of the cells close to
+  // the left and right edges land.
+  uint32_t m_bins = 0;
+  size_t m_stride = 0;
+  float m_binWidth = 0;
+  float m_binHeight = 0;
+  float m_binCapacity = 0;
+  std::vector<float> m_density;
+  std::vector<float> m_excess;  // derivative of the penalty per bin
+  std::vector<uint32_t> m_cellRow;   // per movable cell
+  std::vector<uint32_t> m_rowStart;  // movable cells bucketed by row
+  std::vector<uint32_t> m_rowCells;
+  double m_overflow = 1;
+  double m_firstOverflow = 0;
+  double m_percent = 0;
+};
+
+void Engine::Setup() {
+  m_cells = m_netlist.CellCount();
+  if (m_placement.Size() != m_cells) m_placement.Reset(m_cells, 0, 0);
+  m_movable.assign(m_cells, 0);
+  m_movableCells.clear();
+  std::vector<Netlist::CellId> ports;
+  for (Netlist::CellId cell : m_netlist.Cells()) {
+    std::string_view type = m_netlist.CellType(cell);
+    if (m_placement.Fixed(cell) || CellPlacement::IsConstant(type)) continue;
+    if (CellPlacement::IsPort(type)) {
+      ports.push_back(cell);
+    } else {
+      m_movable[cell] = 1;
+      m_movableCells.push_back(cell);
+    }
+  }
+  m_stats.m_movable = m_movableCells.size();
+  m_stats.m_fixed = m_cells - m_movableCells.size();
+
+  if (m_placement.Width() <= 0 || m_placement.Height() <= 0) {
+    double side = std::ceil(std::sqrt(m_movableCells.size() /
+                                      std::max(m_options.m_targetDensity,
+                                               0.01)));
+    side = std::max(side, 2.0);
+    std::vector<float> x(m_placement.XData(), m_placement.XData() + m_cells);
+    std::vector<float> y(m_placement.YData(), m_placement.YData() + m_cells);
+    std::vector<uint8_t> fixed(m_cells);
+    for (size_t cell = 0; cell < m_cells; cell++) {
+      fixed[cell] = m_placement.Fixed((Netlist::CellId)cell);
+    }
+    m_placement.Reset(m_cells, side, side);
+    for (size_t cell = 0; cell < m_cells; cell++) {
+      if (!fixed[cell]) continue;
+      m_placement.Set((Netlist::CellId)cell, x[cell], y[cell]);
+      m_placement.SetFixed((Netlist::CellId)cell, true);
+    }
+  }
+  m_width = (float)m_placement.Width();
+  m_height = (float)m_placement.Height();
+  m_x = m_placement.XData();
+  m_y = m_placement.YData();
+  PlacePorts(ports);
+
+  m_nets.clear();
+  m_pinCount.assign(m_cells, 0);
+  for (Netlist::NetId net : m_netlist.Nets()) {
+    Netlist::IdSpan pins = m_netlist.NetPins(net);
+    if (pins.size() < 2) continue;
+    Netlist::PinId driver = m_netlist.NetDriver(net);
+    if (driver != Netlist::kNone &&
+        CellPlacement::IsConstant(
+            m_netlist.CellType(m_netlist.PinCell(driver)))) {
+      continue;
+    }
+    m_nets.push_back(net);
+    m_maxDegree = std::max<size_t>(m_maxDegree, pins.size());
+    for (Netlist::PinId pin : pins) m_pinCount[m_netlist.PinCell(pin)]++;
+  }
+  const size_t pins = m_netlist.PinCount();
+  m_pinGradX.assign(pins, 0.0f);
+  m_pinGradY.assign(pins, 0.0f);
+  for (auto* array : {&m_gx, &m_gy, &m_wlX, &m_wlY, &m_denX, &m_denY,
+                      &m_prevX, &m_prevY, &m_dirX, &m_dirY, &m_zX, &m_zY}) {
+    array->assign(m_cells, 0.0f);
+  }
+
+  // About four cells per bin, bins of a site at least
+  const double side = std::min(m_width, m_height);
+  m_bins = (uint32_t)std::lround(std::sqrt(m_movableCells.size() / 4.0));
+  m_bins = std::max<uint32_t>(std::min<uint32_t>(m_bins, 1024), 2);
+  m_bins = std::min<uint32_t>(m_bins, std::max<uint32_t>((uint32_t)side, 1));
+  m_binWidth = m_width / m_bins;
+  m_binHeight = m_height / m_bins;
+  m_binCapacity =
+      (float)(m_options.m_targetDensity * m_binWidth * m_binHeight);
+  m_stride = m_bins + 2 * kSpan;
+  m_density.assign(m_stride * m_bins, 0.0f);
+  m_excess.assign(m_stride * m_bins, 0.0f);
+  m_cellRow.assign(m_movableCells.size(), 0);
+  m_rowStart.assign(m_bins + 1, 0);
+  m_rowCells.assign(m_movableCells.size(), 0);
+  m_stats.m_bins = m_bins;
+
+  // Start from the center, slightly spread so that the cells of a net are
+  // never all at the same point
+  For(m_movableCells.size(), kGrain, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      uint64_t hash = (m_movableCells[i] + 1) * 0x9E3779B97F4A7C15ULL;
+      float dx = ((hash >> 40) / 16777216.0f - 0.5f) * 0.05f;
+      float dy = (((hash >> 16) & 0xFFFFFF) / 16777216.0f - 0.5f) * 0.05f;
+      m_x[m_movableCells[i]] = m_width * (0.5f + dx);
+      m_y[m_movableCells[i]] = m_height * (0.5f + dy);
+    }
+  });
+}
+
+// Evenly along the boundary, counterclockwise from the lower left corner,
+// in netlist order
+void Engine::PlacePorts(const std::vector<Netlist::CellId>& ports) {
+  const double perimeter = 2.0 * (m_width + m_height);
+  for (size_t i = 0; i < ports.size(); i++) {
+    double t = (i + 0.5) * perimeter / ports.size();
+    float x = 0, y = 0;
+    if (t < m_width) {
+      x = (float)t;
+    } else if (t < m_width + m_height) {
+      x = m_width;
+      y = (float)(t - m_width);
+    } else if (t < 2 * m_width + m_height) {
+      x = (float)(2 * m_width + m_height - t);
+      y = m_height;
+    } else {
+      y = (float)(perimeter - t);
+    }
+    m_placement.Set(ports[i], x, y);
+    m_placement.SetFixed(ports[i], true);
+  }
+}
+
+void Engine::Clamp() {
+  For(m_movableCells.size(), kGrain, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      Netlist::CellId cell = m_movableCells[i];
+      m_x[cell] = std::min(std::max(m_x[cell], 0.5f), m_width - 0.5f);
+      m_y[cell] = std::min(std::max(m_y[cell], 0.5f), m_height - 0.5f);
+    }
+  });
+}
+
+// Per pin gradients to per cell gradients. The pins of a cell are
+// contiguous, each cell reads its own.
+void Engine::GatherPins(float* gx, float* gy) {
+  For(m_cells, kGrain, [&](size_t begin, size_t end) {
+    const float* px = m_pinGradX.data();
+    const float* py = m_pinGradY.data();
+    for (size_t cell = begin; cell < end; cell++) {
+      float sx = 0, sy = 0;
+      if (m_movable[cell]) {
+        for (Netlist::PinId pin : m_netlist.CellPins((Netlist::CellId)cell)) {
+          sx += px[pin];
+          sy += py[pin];
+        }
+      }
+      gx[cell] = sx;
+      gy[cell] = sy;
+    }
+  });
+}
+
+// Weighted average wirelength of one net along one axis:
+//   sum(x e^(x/g)) / sum(e^(x/g)) - sum(x e^(-x/g)) / sum(e^(-x/g))
+// with the exponents shifted by the extreme coordinates, for the count pin
+// coordinates of v, and its gradient per pin in grad. scratch holds two
+// Padded(count) floats.
+double Engine::WaAxis(const float* v, size_t count, float gamma,
+                      float* scratch, float* grad) const {
+  float lo = FLT_MAX, hi = -FLT_MAX;
+  for (size_t i = 0; i < count; i++) {
+    lo = std::min(lo, v[i]);
+    hi = std::max(hi, v[i]);
+  }
+  const float inverse = 1 / gamma;
+  const size_t padded = Padded(count);
+  float* expPos = scratch;
+  float* expNeg = scratch + padded;
+  for (size_t i = 0; i < count; i++) {
+    expPos[i] = (v[i] - hi) * inverse;
+    expNeg[i] = (lo - v[i]) * inverse;
+  }
+  for (size_t i = count; i < padded; i++) expPos[i] = expNeg[i] = 0;
+  ExpArray(scratch, 2 * padded);
+  float sumPos = 0, sumPosX = 0, sumNeg = 0, sumNegX = 0;
+  for (size_t i = 0; i < count; i++) {
+    sumPos += expPos[i];
+    sumPosX += v[i] * expPos[i];
+    sumNeg += expNeg[i];
+    sumNegX += v[i] * expNeg[i];
+  }
+  const float pos = 1 / sumPos;
+  const float neg = 1 / sumNeg;
+  const float maxWa = sumPosX * pos;
+  const float minWa = sumNegX * neg;
+  // e+ / S+ * (1 + (v - max) / g) - e- / S- * (1 - (v - min) / g)
+  const float posBase = pos * (1 - maxWa * inverse);
+  const float negBase = neg * (1 + minWa * inverse);
+  const float posSlope = pos * inverse;
+  const float negSlope = neg * inverse;
+  for (size_t i = 0; i < count; i++) {
+    grad[i] = expPos[i] * (posBase + posSlope * v[i]) -
+              expNeg[i] * (negBase - negSlope * v[i]);
+  }
+  return maxWa - minWa;
+}
+
+double Engine::Wirelength(float gamma, float* gx, float* gy) {
+  double value = Sum(m_nets.size(), [&](size_t begin, size_t end) {
+    // Pin coordinates and gradients of a net, then the exponentials
+    const size_t padded = Padded(m_maxDegree);
+    std::vector<float> scratch(4 * padded);
+    float* v = scratch.data();
+    float* grad = v + padded;
+    float* exps = grad + padded;
+    double sum = 0;
+    for (size_t i = begin; i < end; i++) {
+      Netlist::IdSpan pins = m_netlist.NetPins(m_nets[i]);
+      const size_t count = pins.size();
+      for (size_t p = 0; p < count; p++) v[p] = m_x[m_netlist.PinCell(pins[p])];
+      sum += WaAxis(v, count, gamma, exps, grad);
+      for (size_t p = 0; p < count; p++) m_pinGradX[pins[p]] = grad[p];
+      for (size_t p = 0; p < count; p++) v[p] = m_y[m_netlist.PinCell(pins[p])];
+      sum += WaAxis(v, count, gamma, exps, grad);
+      for (size_t p = 0; p < count; p++) m_pinGradY[pins[p]] = grad[p];
+    }
+    return sum;
+  });
+  GatherPins(gx, gy);
+  return value;
+}
+
+// Gradient of the clique model, sum over the nets of
+//   k / (k - 1) * sum((v - mean)^2)
+// a clique of weight 1 / (k - 1) written around the net center
+void Engine::QuadraticGradient(const float* vx, const float* vy, float* gx,
+                               float* gy) {
+  For(m_nets.size(), kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      Netlist::IdSpan pins = m_netlist.NetPins(m_nets[i]);
+      float meanX = 0, meanY = 0;
+      for (Netlist::PinId pin : pins) {
+        meanX += vx[m_netlist.PinCell(pin)];
+        meanY += vy[m_netlist.PinCell(pin)];
+      }
+      const float k = (float)pins.size();
+      meanX /= k;
+      meanY /= k;
+      const float weight = 2 * k / (k - 1);
+      for (Netlist::PinId pin : pins) {
+        m_pinGradX[pin] = weight * (vx[m_netlist.PinCell(pin)] - meanX);
+        m_pinGradY[pin] = weight * (vy[m_netlist.PinCell(pin)] - meanY);
+      }
+    }
+  });
+  GatherPins(gx, gy);
+}
+
+// Preconditioned conjugate gradient on the quadratic model plus the anchor
+// term, for the displacement of the movable cells. Returns the iterations.
+int Engine::SolveQuadratic() {
+  if (m_nets.empty() || m_movableCells.empty()) return 0;
+  // Residual r = -gradient, the anchor is where the cells are
+  std::vector<float>& rx = m_gx;
+  std::vector<float>& ry = m_gy;
+  QuadraticGradient(m_x, m_y, rx.data(), ry.data());
+  // Diagonal of the system, 2 * k / (k - 1) * (1 - 1 / k) = 2 per wire pin
+  auto precondition = [this](const float* gx, const float* gy, float* zx,
+                             float* zy) {
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        const float inverse = 1 / (2 * m_pinCount[i] + 2 * kAnchorWeight);
+        zx[i] = gx[i] * inverse;
+        zy[i] = gy[i] * inverse;
+      }
+    });
+  };
+  For(m_cells, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      rx[i] = -rx[i];
+      ry[i] = -ry[i];
+    }
+  });
+  std::vector<float>& px = m_dirX;
+  std::vector<float>& py = m_dirY;
+  std::vector<float>& apx = m_wlX;
+  std::vector<float>& apy = m_wlY;
+  std::vector<float>& dx = m_denX;
+  std::vector<float>& dy = m_denY;
+  std::fill(dx.begin(), dx.end(), 0.0f);
+  std::fill(dy.begin(), dy.end(), 0.0f);
+  precondition(rx.data(), ry.data(), m_zX.data(), m_zY.data());
+  px = m_zX;
+  py = m_zY;
+  double rz = Dot(rx.data(), ry.data(), m_zX.data(), m_zY.data());
+  const double r0 = Dot(rx.data(), ry.data(), rx.data(), ry.data());
+  int iteration = 0;
+  while (iteration < kMaxSolverIterations && r0 > 0) {
+    if (m_options.m_cancel.Cancelled()) break;
+    iteration++;
+    QuadraticGradient(px.data(), py.data(), apx.data(), apy.data());
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        apx[i] += 2 * kAnchorWeight * px[i];
+        apy[i] += 2 * kAnchorWeight * py[i];
+      }
+    });
+    const double pAp = Dot(px.data(), py.data(), apx.data(), apy.data());
+    if (pAp <= 0) break;
+    const float alpha = (float)(rz / pAp);
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        dx[i] += alpha * px[i];
+        dy[i] += alpha * py[i];
+        rx[i] -= alpha * apx[i];
+        ry[i] -= alpha * apy[i];
+      }
+    });
+    if (Dot(rx.data(), ry.data(), rx.data(), ry.data()) < 1e-6 * r0) break;
+    precondition(rx.data(), ry.data(), m_zX.data(), m_zY.data());
+    const double rzNext = Dot(rx.data(), ry.data(), m_zX.data(), m_zY.data());
+    const float beta = (float)(rzNext / rz);
+    rz = rzNext;
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        px[i] = m_zX[i] + beta * px[i];
+        py[i] = m_zY[i] + beta * py[i];
+      }
+    });
+  }
+  For(m_cells, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_x[i] += dx[i];
+      m_y[i] += dy[i];
+    }
+  });
+  Clamp();
+  return iteration;
+}
+
+// Spreads the potential of the movable cells over the bins. Returns the
+// penalty, sum of the squared density above the bin capacity; sets the
+// overflow and the penalty derivative per bin.
+double Engine::Density() {
+  const BellAxis axisX(1, m_binWidth, m_bins);
+  const BellAxis axisY(1, m_binHeight, m_bins);
+  const size_t movable = m_movableCells.size();
+  // Bucket the cells by row, a band of rows then only reads the cells
+  // close to it and owns its rows of the grid
+  For(movable, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_cellRow[i] = axisY.Bin(m_y[m_movableCells[i]]);
+    }
+  });
+  std::fill(m_rowStart.begin(), m_rowStart.end(), 0);
+  for (size_t i = 0; i < movable; i++) m_rowStart[m_cellRow[i] + 1]++;
+  for (uint32_t row = 0; row < m_bins; row++) {
+    m_rowStart[row + 1] += m_rowStart[row];
+  }
+  {
+    std::vector<uint32_t> cursor(m_rowStart.begin(), m_rowStart.end() - 1);
+    for (size_t i = 0; i < movable; i++) {
+      m_rowCells[cursor[m_cellRow[i]]++] = m_movableCells[i];
+    }
+  }
+
+  const int reach = axisY.Reach();
+  const uint32_t bands = (m_bins + kBandRows - 1) / kBandRows;
+  For(bands, 1, [&](size_t begin, size_t end) {
+    float wx[kSpan], wy[kSpan];
+    for (size_t band = begin; band < end; band++) {
+      const int top = (int)(band * kBandRows);
+      const int bottom = std::min<int>(top + kBandRows, m_bins);
+      std::fill(m_density.begin() + top * m_stride,
+                m_density.begin() + bottom * m_stride, 0.0f);
+      const int from = std::max(top - reach, 0);
+      const int to = std::min<int>(bottom + reach, m_bins);
+      for (uint32_t i = m_rowStart[from]; i < m_rowStart[to]; i++) {
+        const Netlist::CellId cell = m_rowCells[i];
+        int firstX, firstY, countX, countY;
+        const float sumX =
+            axisX.Weights<false>(m_x[cell], firstX, countX, wx, nullptr);
+        const float sumY =
+            axisY.Weights<false>(m_y[cell], firstY, countY, wy, nullptr);
+        if (sumX <= 0 || sumY <= 0) continue;
+        // The potential of a cell integrates to its area
+        const float scale = 1 / (sumX * sumY);
+        const int rowFrom = std::max(firstY, top);
+        const int rowTo = std::min(firstY + countY, bottom);
+        for (int row = rowFrom; row < rowTo; row++) {
+          float* bins = m_density.data() + row * m_stride + kSpan + firstX;
+          ScaleAdd(bins, scale * wy[row - firstY], wx);
+        }
+      }
+    }
+  });
+
+  const float capacity = m_binCapacity;
+  double overflow = 0;
+  double penalty = Sum(m_bins, [&](size_t begin, size_t end) {
+    double sum = 0;
+    for (size_t row = begin; row < end; row++) {
+      const float* density = m_density.data() + row * m_stride + kSpan;
+      float* excess = m_excess.data() + row * m_stride + kSpan;
+      for (uint32_t col = 0; col < m_bins; col++) {
+        const float over = std::max(density[col] - capacity, 0.0f);
+        excess[col] = 2 * over;
+        sum += (double)over * over;
+      }
+    }
+    return sum;
+  });
+  overflow = Sum(m_excess.size(), [&](size_t begin, size_t end) {
+    double sum = 0;
+    for (size_t bin = begin; bin < end; bin++) sum += m_excess[bin] / 2;
+    return sum;
+  });
+  m_overflow = movable ? overflow / movable : 0;
+  return penalty;
+}
+
+// Derivative of the penalty for the movable cells, from the per bin
+// derivatives left by Density()
+void Engine::DensityGradient(float* gx, float* gy) {
+  const BellAxis axisX(1, m_binWidth, m_bins);
+  const BellAxis axisY(1, m_binHeight, m_bins);
+  For(m_movableCells.size(), kGrain, [&](size_t begin, size_t end) {
+    float wx[kSpan], wy[kSpan], sx[kSpan], sy[kSpan];
+    float alongX[kSpan], alongY[kSpan];
+    for (size_t i = begin; i < end; i++) {
+      const Netlist::CellId cell = m_movableCells[i];
+      int firstX, firstY, countX, countY;
+      const float sumX = axisX.Weights<true>(m_x[cell], firstX, countX, wx, sx);
+      const float sumY = axisY.Weights<true>(m_y[cell], firstY, countY, wy, sy);
+      float dx = 0, dy = 0;
+      if (sumX > 0 && sumY > 0) {
+        // Lane wise accumulation, reduced once per cell
+        std::fill(alongX, alongX + kSpan, 0.0f);
+        std::fill(alongY, alongY + kSpan, 0.0f);
+        const int rowFrom = std::max(firstY, 0);
+        const int rowTo = std::min<int>(firstY + countY, m_bins);
+        for (int row = rowFrom; row < rowTo; row++) {
+          const float* excess =
+              m_excess.data() + row * m_stride + kSpan + firstX;
+          MultiplyAdd(alongX, wy[row - firstY], excess, sx);
+          MultiplyAdd(alongY, sy[row - firstY], excess, wx);
+        }
+        const float scale = 1 / (sumX * sumY);
+        dx = LaneSum(alongX) * scale;
+        dy = LaneSum(alongY) * scale;
+      }
+      gx[cell] = dx;
+      gy[cell] = dy;
+    }
+  });
+}
+
+// Objective at the current positions, gradient in m_gx / m_gy
+double Engine::Evaluate(float lambda, float gamma) {
+  const double wirelength = Wirelength(gamma, m_wlX.data(), m_wlY.data());
+  const double penalty = Density();
+  DensityGradient(m_denX.data(), m_denY.data());
+  For(m_cells, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_gx[i] = m_wlX[i] + lambda * m_denX[i];
+      m_gy[i] = m_wlY[i] + lambda * m_denY[i];
+    }
+  });
+  return wirelength + lambda * penalty;
+}
+
+// Diagonal preconditioner of ePlace: wire pins plus lambda times the area
+void Engine::Precondition(float lambda, float* zx, float* zy) {
+  For(m_cells, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const float inverse = 1 / std::max(m_pinCount[i] + lambda, 1.0f);
+      zx[i] = m_gx[i] * inverse;
+      zy[i] = m_gy[i] * inverse;
+    }
+  });
+}
+
+// Overflow goes down about geometrically, report the progress in log scale
+void Engine::Progress(double overflow) {
+  if (!m_options.m_progress) return;
+  const double target = std::max(m_options.m_targetOverflow, 1e-3);
+  double percent = 0;
+  if (m_firstOverflow > target && overflow > 0) {
+    percent = 100 * std::log(m_firstOverflow / overflow) /
+              std::log(m_firstOverflow / target);
+  }
+  percent = std::floor(std::min(std::max(percent, m_percent), 99.0));
+  if (percent >= m_percent + 1) {
+    m_percent = percent;
+    m_options.m_progress(percent);
+  }
+}
+
+bool Engine::Run() {
+  Setup();
+  if (m_movableCells.empty()) return true;
+  m_stats.m_solverIterations = SolveQuadratic();
+  if (m_options.m_cancel.Cancelled()) return false;
+
+  // WA smoothing from ePlace, coarse while the cells overlap a lot
+  auto smoothing = [this](double overflow) {
+    return (float)(8 * m_binWidth *
+                   std::pow(10.0, 20.0 / 9 * (overflow - 0.1) - 1));
+  };
+  float gamma = smoothing(1.0);
+  // Initial density weight balancing the two gradients
+  Evaluate(0, gamma);
+  m_firstOverflow = m_overflow;
+  double wireNorm = 0, densityNorm = 0;
+  for (size_t i = 0; i < m_cells; i++) {
+    wireNorm += std::fabs(m_wlX[i]) + std::fabs(m_wlY[i]);
+    densityNorm += std::fabs(m_denX[i]) + std::fabs(m_denY[i]);
+  }
+  float lambda = densityNorm > 0 ? (float)(wireNorm / densityNorm) : 1.0f;
+  gamma = smoothing(m_overflow);
+
+  double objective = Evaluate(lambda, gamma);
+  Precondition(lambda, m_zX.data(), m_zY.data());
+  for (size_t i = 0; i < m_cells; i++) {
+    m_dirX[i] = -m_zX[i];
+    m_dirY[i] = -m_zY[i];
+  }
+  double gz = Dot(m_gx.data(), m_gy.data(), m_zX.data(), m_zY.data());
+  // Step as a fraction of a bin, adapted to the progress of the objective
+  float step = 0.5f;
+  int iteration = 0;
+  while (m_overflow > m_options.m_targetOverflow &&
+         iteration < m_options.m_maxIterations) {
+    if (m_options.m_cancel.Cancelled()) {
+      m_stats.m_iterations = iteration;
+      m_stats.m_overflow = m_overflow;
+      return false;
+    }
+    iteration++;
+    const double length = std::sqrt(
+        Dot(m_dirX.data(), m_dirY.data(), m_dirX.data(), m_dirY.data()) /
+        m_movableCells.size());
+    if (length <= 0) break;
+    const float alpha = (float)(step * m_binWidth / length);
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        m_x[i] += alpha * m_dirX[i];
+        m_y[i] += alpha * m_dirY[i];
+      }
+    });
+    Clamp();
+    std::swap(m_prevX, m_gx);
+    std::swap(m_prevY, m_gy);
+    const double next = Evaluate(lambda, gamma);
+    step = (next < objective) ? std::min(step * 1.1f, 1.0f) : step * 0.5f;
+    objective = next;
+    Progress(m_overflow);
+
+    const bool raise = iteration % kIterationsPerWeight == 0;
+    if (raise) {
+      lambda *= kWeightGrowth;
+      gamma = smoothing(m_overflow);
+      objective = Evaluate(lambda, gamma);
+    }
+    Precondition(lambda, m_zX.data(), m_zY.data());
+    // Polak-Ribiere, restarted when the objective changed or the direction
+    // would go uphill
+    double gzNext = Dot(m_gx.data(), m_gy.data(), m_zX.data(), m_zY.data());
+    double beta = 0;
+    if (!raise && gz > 0) {
+      beta = (gzNext - Dot(m_prevX.data(), m_prevY.data(), m_zX.data(),
+                           m_zY.data())) /
+             gz;
+      beta = std::max(beta, 0.0);
+    }
+    gz = gzNext;
+    const float b = (float)beta;
+    For(m_cells, kGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        m_dirX[i] = -m_zX[i] + b * m_dirX[i];
+        m_dirY[i] = -m_zY[i] + b * m_dirY[i];
+      }
+    });
+  }
+  m_stats.m_iterations = iteration;
+  m_stats.m_overflow = m_overflow;
+  return true;
+}
+
+}  // namespace
+
+bool GlobalPlacer::Place(const Netlist& netlist, CellPlacement& placement) {
+  auto start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  Engine engine(netlist, placement, m_options, m_stats);
+  const bool done = engine.Run();
+  m_stats.m_hpwl = placement.Hpwl(netlist, m_options.m_threads);
+  m_stats.m_seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  if (done && m_options.m_progress) m_options.m_progress(100);
+  return done;
+}
@@ -0,0 +1,89 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/EventBus.h"
+#include "Compiler/Netlist.h"
+
+#ifndef GLOBAL_PLACER_H
+#define GLOBAL_PLACER_H
+
+namespace FOEDAG {
+
+// Analytical global placer. Minimizes the weighted average (WA) smooth
+// wirelength plus lambda times a bin density penalty, with a nonlinear
+// preconditioned conjugate gradient, raising lambda until the density
+// overflow is below the target. Density uses the bell shaped cell potential
+// of NTUPlace, the penalty only counts bins filled above the target.
+// The start point is the solution of a quadratic (clique) wirelength
+// problem, solved with a linear conjugate gradient.
+//
+// Logic cells are one site wide and tall. Unfixed top level ports are
+// fixed, evenly spread along the die boundary. Every kernel runs on the
+// TaskScheduler over fixed size chunks with per chunk partial sums, so the
+// result does not depend on the number of threads.
+class GlobalPlacer {
+ public:
+  struct Options {
+    // Die utilization, sizes the die of a placement without one
+    double m_targetDensity = 0.7;
+    // Stop once the overflowing area is this fraction of the cell area
+    double m_targetOverflow = 0.1;
+    // Nonlinear conjugate gradient iterations, at most
+    int m_maxIterations = 1000;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    CancellationToken m_cancel;
+    // Completion estimate in percent, called from the placing thread
+    std::function<void(double)> m_progress;
+  };
+  struct Stats {
+    size_t m_movable = 0;
+    size_t m_fixed = 0;
+    uint32_t m_bins = 0;  // per side
+    int m_iterations = 0;
+    int m_solverIterations = 0;  // of the quadratic start
+    double m_overflow = 0;
+    double m_hpwl = 0;
+    double m_seconds = 0;
+  };
+
+  GlobalPlacer() = default;
+  explicit GlobalPlacer(const Options& options) : m_options(options) {}
+
+  // Places the unfixed cells of placement, reset first if it does not
+  // match the netlist. False when cancelled.
+  bool Place(const Netlist& netlist, CellPlacement& placement);
+
+  const Stats& GetStats() const { return m_stats; }
+
+ private:
+  Options m_options;
+  Stats m_stats;
+};
+
+}  // namespace FOEDAG
+
+#endif
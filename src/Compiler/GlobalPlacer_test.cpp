@@ -0,0 +1,110 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/GlobalPlacer.h"
+
+#include <string>
+
+#include "Compiler/Test/TestDesigns.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(GlobalPlacer, SpreadsCellsAndShortensWires) {
+  Netlist netlist;
+  BuildMesh(netlist, 30, MeshPorts::InputOutput);
+  CellPlacement placement;
+  GlobalPlacer::Options options;
+  GlobalPlacer placer(options);
+  ASSERT_TRUE(placer.Place(netlist, placement));
+  const GlobalPlacer::Stats& stats = placer.GetStats();
+  EXPECT_EQ(stats.m_movable, 900u);
+  EXPECT_EQ(stats.m_fixed, 2u);
+  EXPECT_LE(stats.m_overflow, options.m_targetOverflow);
+  EXPECT_GT(placement.Width(), 30);
+  EXPECT_TRUE(placement.Fixed(0));
+  for (Netlist::CellId cell : netlist.Cells()) {
+    EXPECT_GE(placement.X(cell), 0);
+    EXPECT_LE(placement.X(cell), placement.Width());
+    EXPECT_GE(placement.Y(cell), 0);
+    EXPECT_LE(placement.Y(cell), placement.Height());
+  }
+  // A mesh placed as a grid has one site long wires, a cell order placement
+  // (rows of the die filled one after the other) is much worse
+  CellPlacement rows;
+  rows.Reset(netlist.CellCount(), placement.Width(), placement.Height());
+  const int perRow = (int)placement.Width();
+  for (Netlist::CellId cell : netlist.Cells()) {
+    rows.Set(cell, cell % perRow + 0.5f, cell / perRow + 0.5f);
+  }
+  EXPECT_LT(stats.m_hpwl, 0.75 * rows.Hpwl(netlist));
+  EXPECT_DOUBLE_EQ(stats.m_hpwl, placement.Hpwl(netlist));
+}
+
+TEST(GlobalPlacer, SameResultWithAnyThreadCount) {
+  Netlist netlist;
+  BuildMesh(netlist, 40, MeshPorts::InputOutput);
+  CellPlacement placements[2];
+  for (int run = 0; run < 2; run++) {
+    GlobalPlacer::Options options;
+    options.m_threads = (run == 0) ? 1 : 4;
+    GlobalPlacer placer(options);
+    ASSERT_TRUE(placer.Place(netlist, placements[run]));
+  }
+  for (Netlist::CellId cell : netlist.Cells()) {
+    ASSERT_EQ(placements[0].X(cell), placements[1].X(cell));
+    ASSERT_EQ(placements[0].Y(cell), placements[1].Y(cell));
+  }
+}
+
+TEST(GlobalPlacer, StopsWhenCancelled) {
+  Netlist netlist;
+  BuildMesh(netlist, 20, MeshPorts::InputOutput);
+  GlobalPlacer::Options options;
+  options.m_cancel.Cancel();
+  GlobalPlacer placer(options);
+  CellPlacement placement;
+  EXPECT_FALSE(placer.Place(netlist, placement));
+}
+
+TEST(GlobalPlacer, PlacementRoundTrip) {
+  Netlist netlist;
+  BuildMesh(netlist, 3, MeshPorts::InputOutput);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 10, 8);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, cell * 0.5f, 8 - cell * 0.25f);
+  }
+  placement.SetFixed(3, true);
+  CellPlacement copy;
+  ASSERT_TRUE(copy.Deserialize(placement.Serialize()));
+  EXPECT_EQ(copy.Size(), placement.Size());
+  EXPECT_EQ(copy.Width(), 10);
+  EXPECT_EQ(copy.Height(), 8);
+  EXPECT_TRUE(copy.Fixed(3));
+  EXPECT_FALSE(copy.Fixed(2));
+  EXPECT_EQ(copy.Y(5), placement.Y(5));
+  EXPECT_EQ(copy.Hpwl(netlist), placement.Hpwl(netlist));
+  EXPECT_FALSE(copy.Deserialize("short"));
+}
+}  // namespace
+}  // namespace FOEDAG
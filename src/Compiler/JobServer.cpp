@@ -0,0 +1,761 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/JobServer.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "Compiler/Compiler.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static void PutU32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out += (char)((value >> (8 * i)) & 0xff);
+}
+
+static void PutString(std::string& out, const std::string& str) {
+  PutU32(out, (uint32_t)str.size());
+  out += str;
+}
+
+namespace {
+
+// Bounds checked decoding, m_ok turns false on the first short read
+struct Reader {
+  const std::string& m_data;
+  size_t m_pos = 0;
+  bool m_ok = true;
+
+  uint32_t U32() {
+    if (m_pos + 4 > m_data.size()) {
+      m_ok = false;
+      return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      value |= (uint32_t)(unsigned char)m_data[m_pos + i] << (8 * i);
+    }
+    m_pos += 4;
+    return value;
+  }
+  std::string String() {
+    uint32_t size = U32();
+    if (!m_ok || m_pos + size > m_data.size()) {
+      m_ok = false;
+      return std::string();
+    }
+    std::string str = m_data.substr(m_pos, size);
+    m_pos += size;
+    return str;
+  }
+};
+
+}  // namespace
+
+std::string RemoteJob::Serialize() const {
+  std::string out;
+  PutString(out, m_secret);
+  PutString(out, m_name);
+  PutString(out, m_top);
+  PutString(out, m_device);
+  PutU32(out, (uint32_t)m_action);
+  for (auto files : {&m_designFiles, &m_constraintFiles}) {
+    PutU32(out, (uint32_t)files->size());
+    for (auto& file : *files) {
+      PutU32(out, (uint32_t)file.m_language);
+      PutString(out, file.m_path);
+      PutString(out, file.m_content);
+    }
+  }
+  PutU32(out, (uint32_t)m_options.size());
+  for (auto& stage : m_options) {
+    PutU32(out, (uint32_t)stage.first);
+    PutU32(out, (uint32_t)stage.second.size());
+    for (auto& option : stage.second) {
+      PutString(out, option.first);
+      PutString(out, option.second);
+    }
+  }
+  PutU32(out, (uint32_t)m_results.size());
+  for (auto& result : m_results) {
+    PutString(out, result.first);
+    PutString(out, result.second);
+  }
+  return out;
+}
+
+bool RemoteJob::Deserialize(const std::string& data) {
+  Reader in{data};
+  m_secret = in.String();
+  m_name = in.String();
+  m_top = in.String();
+  m_device = in.String();
+  m_action = (int)in.U32();
+  for (auto files : {&m_designFiles, &m_constraintFiles}) {
+    files->clear();
+    uint32_t count = in.U32();
+    for (uint32_t i = 0; in.m_ok && i < count; i++) {
+      File file;
+      file.m_language = (int)in.U32();
+      file.m_path = in.String();
+      file.m_content = in.String();
+      files->push_back(file);
+    }
+  }
+  m_options.clear();
+  uint32_t stages = in.U32();
+  for (uint32_t i = 0; in.m_ok && i < stages; i++) {
+    auto& options = m_options[(int)in.U32()];
+    uint32_t count = in.U32();
+    for (uint32_t j = 0; in.m_ok && j < count; j++) {
+      std::string key = in.String();
+      options[key] = in.String();
+    }
+  }
+  m_results.clear();
+  uint32_t results = in.U32();
+  for (uint32_t i = 0; in.m_ok && i < results; i++) {
+    std::string key = in.String();
+    m_results[key] = in.String();
+  }
+  return in.m_ok && in.m_pos == data.size();
+}
+
+std::string FOEDAG::WorkerSecret(bool create, std::string& error) {
+  const char* variable = std::getenv("FOEDAG_WORKER_SECRET");
+  if (variable && *variable) return variable;
+  namespace fs = std::filesystem;
+  const fs::path directory = StageCache::UserDirectory();
+  if (directory.empty()) {
+    error = "no worker secret, set FOEDAG_WORKER_SECRET";
+    return std::string();
+  }
+  const fs::path path = directory / "worker_secret";
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+  for (int attempt = 0; attempt < 2; attempt++) {
+    std::ifstream in(path);
+    std::string secret;
+    if (in >> secret) {
+#ifndef _WIN32
+      // Only the user may read it, or it is no secret
+      struct stat info;
+      if (lstat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode) ||
+          info.st_uid != getuid() || (info.st_mode & 077) != 0) {
+        error = path.string() + " must be a file only its owner can read";
+        return std::string();
+      }
+#endif
+      return secret;
+    }
+    if (!create) break;
+    std::random_device random;
+    std::ostringstream text;
+    for (int i = 0; i < 4; i++) {
+      text << std::hex << ((uint64_t)random() << 32 | random());
+    }
+    secret = text.str();
+#ifdef _WIN32
+    std::ofstream out(path, std::ios::trunc);
+    out << secret << std::endl;
+    if (out) return secret;
+#else
+    // Exclusive: two workers starting at once agree on the first file
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      if (errno == EEXIST) continue;
+      break;
+    }
+    secret += "\n";
+    bool written =
+        write(fd, secret.data(), secret.size()) == (ssize_t)secret.size();
+    close(fd);
+    secret.pop_back();
+    if (written) return secret;
+#endif
+    break;
+  }
+  error = "no worker secret in " + path.string() +
+          ", set FOEDAG_WORKER_SECRET or start a worker of the user first";
+  return std::string();
+}
+
+// Compares in a time independent of where the secrets differ
+static bool SameSecret(const std::string& a, const std::string& b) {
+  if (a.size() != b.size()) return false;
+  unsigned char difference = 0;
+  for (size_t i = 0; i < a.size(); i++) difference |= a[i] ^ b[i];
+  return difference == 0;
+}
+
+bool JobChannel::Supported() {
+#ifdef _WIN32
+  return false;
+#else
+  return true;
+#endif
+}
+
+// Resolves address and returns a connected, or listening, socket
+static int OpenSocket(const std::string& address, bool listening,
+                      std::string& error) {
+#ifdef _WIN32
+  error = "job server sockets are not supported on this platform";
+  return -1;
+#else
+  if (address.compare(0, 5, "unix:") == 0) {
+    std::string path = address.substr(5);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      error = "invalid socket path " + path;
+      return -1;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      error = std::string("socket: ") + strerror(errno);
+      return -1;
+    }
+    if (listening) unlink(path.c_str());
+    int status = listening
+                     ? bind(fd, (struct sockaddr*)&addr, sizeof(addr))
+                     : connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+    if (status == 0 && listening) status = listen(fd, 64);
+    if (status != 0) {
+      error = path + ": " + strerror(errno);
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    error = "invalid address " + address + ", expecting <host>:<port>";
+    return -1;
+  }
+  std::string host = address.substr(0, colon);
+  std::string port = address.substr(colon + 1);
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  // No host is the loopback interface, "*" every interface
+  if (listening && host == "*") hints.ai_flags = AI_PASSIVE;
+  struct addrinfo* infos = nullptr;
+  int status = getaddrinfo((host.empty() || host == "*") ? nullptr
+                                                         : host.c_str(),
+                           port.c_str(), &hints, &infos);
+  if (status != 0) {
+    error = address + ": " + gai_strerror(status);
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* info = infos; info; info = info->ai_next) {
+    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fd < 0) continue;
+    if (listening) {
+      int on = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      if (bind(fd, info->ai_addr, info->ai_addrlen) == 0 &&
+          listen(fd, 64) == 0) {
+        break;
+      }
+    } else if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+      break;
+    }
+    error = address + ": " + strerror(errno);
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(infos);
+#ifdef SO_NOSIGPIPE
+  if (fd >= 0) {
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+  }
+#endif
+  return fd;
+#endif
+}
+
+bool JobChannel::Connect(const std::string& address) {
+  Close();
+  m_fd = OpenSocket(address, false, m_error);
+  return m_fd >= 0;
+}
+
+void JobChannel::Close() {
+#ifndef _WIN32
+  if (m_fd >= 0) close(m_fd);
+#endif
+  m_fd = -1;
+}
+
+bool JobChannel::PeerClosed(int timeoutMs) {
+#ifdef _WIN32
+  return false;
+#else
+  if (m_fd < 0) return true;
+  struct pollfd fd = {m_fd, POLLIN, 0};
+  if (poll(&fd, 1, timeoutMs) <= 0) return false;
+  char byte;
+  return recv(m_fd, &byte, 1, MSG_PEEK) <= 0;
+#endif
+}
+
+bool JobChannel::Send(Frame type, const std::string& payload) {
+#ifdef _WIN32
+  return false;
+#else
+  std::string frame;
+  frame.reserve(payload.size() + 5);
+  frame += (char)type;
+  PutU32(frame, (uint32_t)payload.size());
+  frame += payload;
+  std::lock_guard<std::mutex> lock(m_sendMutex);
+  size_t sent = 0;
+  while (m_fd >= 0 && sent < frame.size()) {
+    ssize_t count =
+        send(m_fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) {
+      m_error = std::string("send: ") + strerror(errno);
+      return false;
+    }
+    sent += (size_t)count;
+  }
+  return sent == frame.size();
+#endif
+}
+
+bool JobChannel::ReadFully(char* data, size_t size,
+                           const CancellationToken* token,
+                           Clock::time_point deadline) {
+#ifdef _WIN32
+  return false;
+#else
+  const bool timed = deadline != Clock::time_point();
+  size_t received = 0;
+  while (received < size) {
+    if (token && token->Cancelled()) {
+      m_error = "cancelled";
+      return false;
+    }
+    if (token || timed) {
+      int waitMs = token ? 100 : -1;
+      if (timed) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - Clock::now())
+                        .count();
+        if (left <= 0) {
+          m_error = "timed out";
+          return false;
+        }
+        if (waitMs < 0 || left < waitMs) waitMs = (int)left;
+      }
+      struct pollfd fd = {m_fd, POLLIN, 0};
+      if (poll(&fd, 1, waitMs) == 0) continue;
+    }
+    ssize_t count = recv(m_fd, data + received, size - received, 0);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) {
+      m_error = (count == 0) ? "connection closed by peer"
+                             : std::string("recv: ") + strerror(errno);
+      return false;
+    }
+    received += (size_t)count;
+  }
+  return true;
+#endif
+}
+
+bool JobChannel::Receive(Frame& type, std::string& payload,
+                         const CancellationToken* token, int timeoutMs) {
+  if (m_fd < 0) return false;
+  const Clock::time_point deadline =
+      timeoutMs < 0 ? Clock::time_point()
+                    : Clock::now() + std::chrono::milliseconds(timeoutMs);
+  std::string header(5, '\0');
+  if (!ReadFully(&header[0], header.size(), token, deadline)) return false;
+  Reader in{header, 1};
+  uint32_t size = in.U32();
+  type = (Frame)header[0];
+  if (size > kMaxFrameSize) {
+    m_error = "frame of " + std::to_string(size) + " bytes, larger than " +
+              std::to_string(kMaxFrameSize);
+    return false;
+  }
+  // A peer announcing a large frame has to send it before it is allocated
+  static const size_t kChunk = 1 << 20;
+  payload.clear();
+  while (payload.size() < size) {
+    const size_t received = payload.size();
+    payload.resize(received + std::min<size_t>(kChunk, size - received));
+    if (!ReadFully(&payload[received], payload.size() - received, token,
+                   deadline)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FOEDAG::RunRemoteJob(const std::string& address, const RemoteJob& job,
+                          std::ostream& out, StageCache& cache,
+                          RemoteMetricFunc metricHandler,
+                          const CancellationToken& token,
+                          std::string& error) {
+  JobChannel channel;
+  if (!channel.Connect(address) ||
+      !channel.Send(JobChannel::Submit, job.Serialize())) {
+    error = channel.Error();
+    return false;
+  }
+  // Dropping the connection is what cancels the job on the worker
+  JobChannel::Frame type;
+  std::string payload;
+  while (channel.Receive(type, payload, &token)) {
+    switch (type) {
+      case JobChannel::Output:
+        out << payload << std::flush;
+        break;
+      case JobChannel::Metric: {
+        std::istringstream metric(payload);
+        int stage = 0;
+        std::string name;
+        double value = 0;
+        if (metric >> stage >> name >> value && metricHandler) {
+          metricHandler(stage, name, value);
+        }
+        break;
+      }
+      case JobChannel::Result: {
+        // Store() refuses keys other than fingerprints, which name files
+        size_t newline = payload.find('\n');
+        if (newline != std::string::npos) {
+          cache.Store(payload.substr(0, newline), payload.substr(newline + 1));
+        }
+        break;
+      }
+      case JobChannel::Done:
+        if (payload == "1") return true;
+        error = job.m_name + " failed on " + address;
+        return false;
+      default:
+        break;
+    }
+  }
+  error = address + ": " + channel.Error();
+  return false;
+}
+
+namespace {
+
+// Turns the compiler output into Output frames, one per flushed line. A
+// failed send means the client is gone, which cancels the job.
+class ChannelBuffer : public std::streambuf {
+ public:
+  ChannelBuffer(JobChannel& channel, CancellationToken& token)
+      : m_channel(channel), m_token(token) {}
+
+ protected:
+  int overflow(int c) override {
+    if (c == EOF) return 0;
+    m_pending += (char)c;
+    if (c == '\n') sync();
+    return c;
+  }
+  std::streamsize xsputn(const char* data, std::streamsize size) override {
+    m_pending.append(data, (size_t)size);
+    return size;
+  }
+  int sync() override {
+    if (m_pending.empty()) return 0;
+    if (!m_channel.Send(JobChannel::Output, m_pending)) m_token.Cancel();
+    m_pending.clear();
+    return 0;
+  }
+
+ private:
+  JobChannel& m_channel;
+  CancellationToken& m_token;
+  std::string m_pending;
+};
+
+}  // namespace
+
+bool JobServer::Execute(const RemoteJob& job, JobChannel& channel,
+                        const std::string& workDir,
+                        const std::string& cacheDir) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  CancellationToken token;
+  ChannelBuffer buffer(channel, token);
+  std::ostream out(&buffer);
+  if (job.m_action < Compiler::Synthesis || job.m_action > Compiler::Bitream) {
+    out << "ERROR: " << job.m_name << ": invalid action " << job.m_action
+        << std::endl;
+    channel.Send(JobChannel::Done, "0");
+    return false;
+  }
+
+  // Sources keep their absolute path below workDir/sources, so that
+  // relative includes between them still resolve. The path comes from the
+  // client: one with a .. component could write anywhere, it is rejected.
+  auto materialize = [&](const RemoteJob::File& file, std::string& path) {
+    const fs::path relative =
+        fs::path(file.m_path).relative_path().lexically_normal();
+    if (relative.empty() || relative.is_absolute()) return false;
+    for (const fs::path& part : relative) {
+      if (part == "..") return false;
+    }
+    const fs::path root = (fs::path(workDir) / "sources").lexically_normal();
+    const fs::path target = (root / relative).lexically_normal();
+    const fs::path inside = target.lexically_relative(root);
+    if (inside.empty() || *inside.begin() == "..") return false;
+    fs::create_directories(target.parent_path(), ec);
+    std::ofstream stream(target, std::ios::binary | std::ios::trunc);
+    stream.write(file.m_content.data(), file.m_content.size());
+    path = target.string();
+    return stream.good();
+  };
+  auto badFile = [&](const RemoteJob::File& file) {
+    out << "ERROR: " << job.m_name << ": cannot write source \""
+        << file.m_path << "\"" << std::endl;
+    channel.Send(JobChannel::Done, "0");
+    return false;
+  };
+  std::string designName = job.m_name;
+  Design design(designName);
+  design.TopLevel(job.m_top);
+  std::string error;
+  if (!job.m_device.empty() &&
+      !design.GetDevice().FromSpec(job.m_device, error)) {
+    out << "ERROR: " << job.m_name << ": " << error << std::endl;
+    channel.Send(JobChannel::Done, "0");
+    return false;
+  }
+  std::string path;
+  for (auto& file : job.m_designFiles) {
+    if (!Design::IsLanguage(file.m_language)) {
+      out << "ERROR: " << job.m_name << ": invalid language "
+          << file.m_language << " of \"" << file.m_path << "\"" << std::endl;
+      channel.Send(JobChannel::Done, "0");
+      return false;
+    }
+    if (!materialize(file, path)) return badFile(file);
+    design.AddFile((Design::Language)file.m_language, path);
+  }
+  for (auto& file : job.m_constraintFiles) {
+    if (!materialize(file, path)) return badFile(file);
+    design.AddConstraintFile(path);
+  }
+
+  // The results sent by the client are only trusted for its own job, they
+  // go to a cache of the job that reads through to the shared one
+  StageCache shared;
+  shared.SetDirectory(cacheDir);
+  Compiler compiler(nullptr, &design, out);
+  compiler.Cache().SetDirectory((fs::path(workDir) / "cache").string());
+  compiler.Cache().SetFallback(&shared);
+  for (auto& result : job.m_results) {
+    compiler.Cache().Store(result.first, result.second);
+  }
+  for (auto& stage : job.m_options) {
+    for (auto& option : stage.second) {
+      compiler.SetStageOption((Compiler::Action)stage.first, option.first,
+                              option.second);
+    }
+  }
+  compiler.SetMetricHandler([&channel](Compiler::Action stage,
+                                       const std::string& metric,
+                                       double value) {
+    std::ostringstream payload;
+    payload << stage << " " << metric << " " << value;
+    channel.Send(JobChannel::Metric, payload.str());
+  });
+  compiler.SetCancellationToken(token);
+  // The client sends nothing after the job, watch for it going away
+  std::atomic<bool> finished{false};
+  std::thread watcher([&]() {
+    while (!finished) {
+      if (channel.PeerClosed(100)) {
+        token.Cancel();
+        return;
+      }
+    }
+  });
+  bool success = compiler.Compile((Compiler::Action)job.m_action);
+  finished = true;
+  watcher.join();
+  out.flush();
+
+  // Every stage result the client does not have yet goes back to it. The
+  // ones computed from nothing the client sent are shared with the other
+  // jobs, the stages after a result of the client may derive from it.
+  bool fromWorker = true;
+  for (int stage = Compiler::Synthesis; stage <= Compiler::Bitream; stage++) {
+    FlowGraph::Fingerprint fp = compiler.Flow().LastFingerprint(stage);
+    if (fp == 0) continue;
+    std::string key = StageCache::Key(fp);
+    std::string payload;
+    if (job.m_results.count(key)) {
+      fromWorker = false;
+      continue;
+    }
+    if (!compiler.Cache().Load(key, payload)) continue;
+    if (fromWorker && !shared.Contains(key)) shared.Store(key, payload);
+    channel.Send(JobChannel::Result, key + "\n" + payload);
+  }
+  compiler.Cache().SetFallback(nullptr);
+  channel.Send(JobChannel::Done, success ? "1" : "0");
+  return success;
+}
+
+JobServer::~JobServer() {
+  Shutdown();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_jobDone.wait(lock, [this]() { return m_running == 0; });
+#ifndef _WIN32
+  if (m_listenFd >= 0) close(m_listenFd);
+  if (!m_unixPath.empty()) unlink(m_unixPath.c_str());
+#endif
+}
+
+bool JobServer::Listen(const std::string& address) {
+  m_secret = WorkerSecret(true, m_error);
+  if (m_secret.empty()) return false;
+  // The cache is shared by all the workers of the user on the host, in a
+  // directory other users cannot make or replace
+  namespace fs = std::filesystem;
+  const fs::path user = StageCache::UserDirectory();
+  if (user.empty()) {
+    m_error = "no cache directory of the user for the worker";
+    return false;
+  }
+  const fs::path root = user / "worker";
+  std::error_code ec;
+  fs::create_directories(root / "cache", ec);
+  fs::permissions(root, fs::perms::owner_all, ec);
+  if (ec) {
+    m_error = root.string() + ": " + ec.message();
+    return false;
+  }
+  m_cacheDir = (root / "cache").string();
+#ifndef _WIN32
+  m_workDir = (root / std::to_string(getpid())).string();
+#endif
+  m_listenFd = OpenSocket(address, true, m_error);
+  if (m_listenFd < 0) return false;
+  if (address.compare(0, 5, "unix:") == 0) m_unixPath = address.substr(5);
+  return true;
+}
+
+void JobServer::Shutdown() {
+  m_shutdown = true;
+  m_jobDone.notify_all();
+}
+
+void JobServer::Serve(unsigned int maxJobs) {
+#ifndef _WIN32
+  if (maxJobs == 0) maxJobs = TaskScheduler::Instance()->Concurrency();
+  while (!m_shutdown) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobDone.wait(lock, [this, maxJobs]() {
+        return m_running < maxJobs || m_shutdown;
+      });
+    }
+    // Polled, so that Shutdown() is noticed without a connection
+    struct pollfd listener = {m_listenFd, POLLIN, 0};
+    if (m_shutdown || poll(&listener, 1, 200) <= 0) continue;
+    int fd = accept(m_listenFd, nullptr, nullptr);
+    if (fd < 0) continue;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running++;
+    std::thread([this, fd]() {
+      HandleConnection(fd);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running--;
+      m_jobDone.notify_all();
+    }).detach();
+  }
+#endif
+}
+
+void JobServer::HandleConnection(int fd) {
+  namespace fs = std::filesystem;
+  JobChannel channel(fd);
+  JobChannel::Frame type;
+  std::string payload;
+  RemoteJob job;
+  if (!channel.Receive(type, payload, nullptr,
+                       JobChannel::kSubmitTimeoutMs) ||
+      type != JobChannel::Submit || !job.Deserialize(payload)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log << "Rejected a malformed job request" << std::endl;
+    return;
+  }
+  if (!SameSecret(job.m_secret, m_secret)) {
+    channel.Send(JobChannel::Output, "ERROR: wrong worker secret\n");
+    channel.Send(JobChannel::Done, "0");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log << "Rejected job " << job.m_name << ", wrong secret" << std::endl;
+    return;
+  }
+  fs::path jobDir;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    jobDir = fs::path(m_workDir) / std::to_string(m_jobCounter++);
+    m_log << "Job " << job.m_name << " started" << std::endl;
+  }
+  bool success = Execute(job, channel, jobDir.string(), m_cacheDir);
+  std::error_code ec;
+  fs::remove_all(jobDir, ec);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_log << "Job " << job.m_name << (success ? " completed" : " failed")
+        << std::endl;
+}
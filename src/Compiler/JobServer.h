@@ -0,0 +1,178 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Compiler/EventBus.h"
+#include "Compiler/StageCache.h"
+
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+namespace FOEDAG {
+
+// Everything a worker needs to run a compilation: the design sources and
+// constraints with their content, the stage options, and the stage results
+// the client already has, so that the worker does not recompute them.
+struct RemoteJob {
+  struct File {
+    int m_language = 0;
+    std::string m_path;
+    std::string m_content;
+  };
+  // WorkerSecret(), the worker refuses the job without it
+  std::string m_secret;
+  std::string m_name;
+  std::string m_top;
+  // DeviceModel::Spec(), empty without a device
+  std::string m_device;
+  std::vector<File> m_designFiles;
+  std::vector<File> m_constraintFiles;
+  std::map<int, std::map<std::string, std::string>> m_options;
+  // Cache key -> stage result payload
+  std::map<std::string, std::string> m_results;
+  int m_action = 0;
+
+  std::string Serialize() const;
+  bool Deserialize(const std::string& data);
+};
+
+// Secret the workers of the user require in every job: $FOEDAG_WORKER_SECRET,
+// otherwise the content of worker_secret in StageCache::UserDirectory(),
+// made by the first worker when create is set. Clients on other hosts need
+// the same variable or file. Empty, with error set, when there is none.
+std::string WorkerSecret(bool create, std::string& error);
+
+// Framed, bidirectional connection between a client and a worker. A frame
+// is a type byte, a little endian 32 bits size and the payload. Addresses
+// are "<host>:<port>" for TCP or "unix:<path>" for a Unix domain socket.
+// A worker listening on ":<port>" only accepts local connections, on
+// "*:<port>" connections from any host.
+class JobChannel {
+ public:
+  enum Frame : uint8_t {
+    Submit = 1,  // client -> worker, serialized RemoteJob
+    Output,      // worker -> client, console output of the compiler
+    Metric,      // worker -> client, "<stage> <metric> <value>"
+    Result,      // worker -> client, "<cache key>\n<payload>"
+    Done         // worker -> client, "1" on success, "0" otherwise
+  };
+
+  // Larger frames are refused before anything is read
+  static constexpr uint32_t kMaxFrameSize = 1u << 30;
+  // Time a worker gives a client to send its job
+  static constexpr int kSubmitTimeoutMs = 60000;
+
+  explicit JobChannel(int fd = -1) : m_fd(fd) {}
+  ~JobChannel() { Close(); }
+  JobChannel(const JobChannel&) = delete;
+  JobChannel& operator=(const JobChannel&) = delete;
+
+  static bool Supported();
+
+  bool Connect(const std::string& address);
+  bool Valid() const { return m_fd >= 0; }
+  // Safe to call from several threads
+  bool Send(Frame type, const std::string& payload);
+  // Blocks until a frame arrives; when a token is given, gives up once it
+  // gets cancelled, with a timeout once the whole frame did not arrive in
+  // time. The payload grows as it arrives, not on the announced size.
+  bool Receive(Frame& type, std::string& payload,
+               const CancellationToken* token = nullptr,
+               int timeoutMs = -1);
+  void Close();
+  // Waits up to timeoutMs for the peer to hang up, true if it did
+  bool PeerClosed(int timeoutMs);
+
+  const std::string& Error() const { return m_error; }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  // A default deadline never expires
+  bool ReadFully(char* data, size_t size, const CancellationToken* token,
+                 Clock::time_point deadline);
+
+  int m_fd = -1;
+  std::mutex m_sendMutex;
+  std::string m_error;
+};
+
+// Runs job on the worker at address, streaming its output to out and its
+// metrics to metricHandler, with the Compiler::Action of the stage
+// reporting them. The stage results sent back are stored in cache.
+typedef std::function<void(int, const std::string&, double)>
+    RemoteMetricFunc;
+bool RunRemoteJob(const std::string& address, const RemoteJob& job,
+                  std::ostream& out, StageCache& cache,
+                  RemoteMetricFunc metricHandler,
+                  const CancellationToken& token, std::string& error);
+
+// The worker side: accepts connections and runs one job per connection,
+// each with its own Design and Compiler, up to maxJobs at a time. Jobs
+// without the WorkerSecret() are refused. Stage results are kept in a
+// cache shared by all the jobs of the worker, in StageCache::UserDirectory().
+class JobServer {
+ public:
+  explicit JobServer(std::ostream& log) : m_log(log) {}
+  ~JobServer();
+
+  bool Listen(const std::string& address);
+  // Returns once Shutdown() is called, 0 jobs means one per scheduler thread
+  void Serve(unsigned int maxJobs = 0);
+  void Shutdown();
+
+  const std::string& Error() const { return m_error; }
+
+  // Runs job, reporting back over channel. Sources are written under
+  // workDir, results are looked up and stored in cacheDir.
+  static bool Execute(const RemoteJob& job, JobChannel& channel,
+                      const std::string& workDir,
+                      const std::string& cacheDir);
+
+ private:
+  void HandleConnection(int fd);
+
+  std::ostream& m_log;
+  int m_listenFd = -1;
+  std::string m_unixPath;
+  std::string m_error;
+  std::string m_workDir;
+  std::string m_cacheDir;
+  std::string m_secret;
+  std::atomic<bool> m_shutdown{false};
+  std::mutex m_mutex;
+  std::condition_variable m_jobDone;
+  unsigned int m_running = 0;
+  uint64_t m_jobCounter = 0;
+};
+
+}  // namespace FOEDAG
+
+#endif
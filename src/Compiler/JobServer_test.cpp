@@ -0,0 +1,245 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/JobServer.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+#include "Compiler/Compiler.h"
+#include "Compiler/Design.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// Keeps the tests off the secret file and the worker cache of the user
+std::string TestSecret() {
+#ifndef _WIN32
+  setenv("FOEDAG_WORKER_SECRET", "job_server_test", 1);
+  const std::string cache = (std::filesystem::temp_directory_path() /
+                             "foedag_job_server_test_home")
+                                .string();
+  setenv("XDG_CACHE_HOME", cache.c_str(), 1);
+#endif
+  std::string error;
+  return WorkerSecret(false, error);
+}
+
+TEST(JobServer, JobRoundTrip) {
+  RemoteJob job;
+  job.m_secret = "secret";
+  job.m_name = "run_1";
+  job.m_top = "top";
+  job.m_action = 3;
+  job.m_designFiles.push_back({4, "/src/top.v", "module top;\nendmodule\n"});
+  job.m_constraintFiles.push_back({0, "/src/top.sdc", std::string("\0x", 2)});
+  job.m_options[1]["effort"] = "high";
+  job.m_results["0123"] = "stage 1";
+
+  RemoteJob copy;
+  std::string data = job.Serialize();
+  ASSERT_TRUE(copy.Deserialize(data));
+  EXPECT_EQ(copy.m_secret, "secret");
+  EXPECT_EQ(copy.m_name, "run_1");
+  EXPECT_EQ(copy.m_top, "top");
+  EXPECT_EQ(copy.m_action, 3);
+  ASSERT_EQ(copy.m_designFiles.size(), 1u);
+  EXPECT_EQ(copy.m_designFiles[0].m_language, 4);
+  EXPECT_EQ(copy.m_designFiles[0].m_content, job.m_designFiles[0].m_content);
+  ASSERT_EQ(copy.m_constraintFiles.size(), 1u);
+  EXPECT_EQ(copy.m_constraintFiles[0].m_content, std::string("\0x", 2));
+  EXPECT_EQ(copy.m_options[1]["effort"], "high");
+  EXPECT_EQ(copy.m_results["0123"], "stage 1");
+
+  EXPECT_FALSE(copy.Deserialize(data.substr(0, data.size() - 1)));
+}
+
+TEST(JobServer, RejectsInvalidJobOverUnixSocket) {
+  if (!JobChannel::Supported()) GTEST_SKIP();
+  std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_job_server_test")
+          .string();
+  std::ostringstream log;
+  JobServer server(log);
+  const std::string secret = TestSecret();
+  ASSERT_TRUE(server.Listen("unix:" + path)) << server.Error();
+  std::thread serving([&server]() { server.Serve(2); });
+
+  RemoteJob job;
+  job.m_name = "bad";
+  StageCache cache;
+  std::ostringstream out;
+  std::string error;
+  // Refused before anything is looked at without the secret
+  EXPECT_FALSE(RunRemoteJob("unix:" + path, job, out, cache, nullptr,
+                            CancellationToken(), error));
+  EXPECT_THAT(out.str(), testing::HasSubstr("wrong worker secret"));
+
+  job.m_secret = secret;
+  out.str("");
+  EXPECT_FALSE(RunRemoteJob("unix:" + path, job, out, cache, nullptr,
+                            CancellationToken(), error));
+  EXPECT_THAT(out.str(), testing::HasSubstr("invalid action"));
+  EXPECT_THAT(error, testing::HasSubstr("bad failed"));
+
+  server.Shutdown();
+  serving.join();
+  EXPECT_FALSE(
+      JobChannel().Connect("unix:" + path + "_missing"));
+}
+
+#ifndef _WIN32
+// Submits a job over TCP on the loopback interface, the worker reads the
+// netlist and sends the synthesis result back
+TEST(JobServer, RunsAJobOnLocalhost) {
+  if (!JobChannel::Supported()) GTEST_SKIP();
+  std::ostringstream log;
+  JobServer server(log);
+  const std::string secret = TestSecret();
+  std::string address;
+  // No host, the loopback interface only
+  for (int port = 20000 + getpid() % 10000, tries = 0; tries < 50;
+       port++, tries++) {
+    address = ":" + std::to_string(port);
+    if (server.Listen(address)) break;
+    address.clear();
+  }
+  ASSERT_FALSE(address.empty()) << server.Error();
+  std::thread serving([&server]() { server.Serve(2); });
+
+  RemoteJob job;
+  job.m_secret = secret;
+  job.m_name = "local";
+  job.m_top = "top";
+  job.m_action = Compiler::Synthesis;
+  // Unique, the worker cache must not have the result already
+  const std::string stamp = std::to_string(getpid()) + " " +
+                            std::to_string(std::chrono::steady_clock::now()
+                                               .time_since_epoch()
+                                               .count());
+  job.m_designFiles.push_back(
+      {Design::BLIF, "/src/top.blif",
+       "# " + stamp +
+           "\n.model top\n.inputs a b\n.outputs y\n.names a b y\n11 1\n"
+           ".end\n"});
+  namespace fs = std::filesystem;
+  const fs::path cacheDir =
+      fs::temp_directory_path() /
+      ("foedag_job_server_cache_" + std::to_string(getpid()));
+  StageCache cache;
+  cache.SetDirectory(cacheDir.string());
+  std::ostringstream out;
+  std::string error;
+  EXPECT_TRUE(RunRemoteJob(address, job, out, cache, nullptr,
+                           CancellationToken(), error))
+      << error << out.str();
+  EXPECT_THAT(out.str(), testing::HasSubstr("is synthesized"));
+  EXPECT_EQ(cache.Entries().size(), 1u);
+
+  // A source path out of the work directory is refused
+  job.m_designFiles[0].m_path = "/../../foedag_job_server_escape.blif";
+  out.str("");
+  EXPECT_FALSE(RunRemoteJob(address, job, out, cache, nullptr,
+                            CancellationToken(), error));
+  EXPECT_THAT(out.str(), testing::HasSubstr("cannot write source"));
+
+  job.m_designFiles[0].m_language = 99;
+  out.str("");
+  EXPECT_FALSE(RunRemoteJob(address, job, out, cache, nullptr,
+                            CancellationToken(), error));
+  EXPECT_THAT(out.str(), testing::HasSubstr("invalid language 99"));
+
+  server.Shutdown();
+  serving.join();
+  std::error_code ec;
+  fs::remove_all(cacheDir, ec);
+}
+
+TEST(JobServer, MakesAPrivateSecret) {
+  namespace fs = std::filesystem;
+  const fs::path home =
+      fs::temp_directory_path() /
+      ("foedag_job_server_secret_" + std::to_string(getpid()));
+  unsetenv("FOEDAG_WORKER_SECRET");
+  setenv("XDG_CACHE_HOME", home.c_str(), 1);
+  std::string error;
+  EXPECT_TRUE(WorkerSecret(false, error).empty());
+  const std::string secret = WorkerSecret(true, error);
+  EXPECT_GE(secret.size(), 16u) << error;
+  EXPECT_EQ(WorkerSecret(false, error), secret);
+  const fs::path file = home / "foedag" / "worker_secret";
+  EXPECT_EQ(fs::status(file).permissions(),
+            fs::perms::owner_read | fs::perms::owner_write);
+  // Readable by others, it is refused
+  fs::permissions(file, fs::perms::others_read, fs::perm_options::add);
+  EXPECT_TRUE(WorkerSecret(false, error).empty());
+  EXPECT_THAT(error, testing::HasSubstr("only its owner"));
+  std::error_code ec;
+  fs::remove_all(home, ec);
+  TestSecret();
+}
+
+TEST(JobServer, RefusesOversizedFrames) {
+  if (!JobChannel::Supported()) GTEST_SKIP();
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  JobChannel reader(fds[0]);
+  // A Submit frame announcing 4GB
+  const char header[] = {JobChannel::Submit, '\xff', '\xff', '\xff', '\xff'};
+  ASSERT_EQ(write(fds[1], header, sizeof(header)), (ssize_t)sizeof(header));
+  JobChannel::Frame type;
+  std::string payload;
+  EXPECT_FALSE(reader.Receive(type, payload));
+  EXPECT_THAT(reader.Error(), testing::HasSubstr("larger than"));
+  EXPECT_TRUE(payload.empty());
+  close(fds[1]);
+}
+
+TEST(JobServer, GivesUpOnSilentPeers) {
+  if (!JobChannel::Supported()) GTEST_SKIP();
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  JobChannel reader(fds[0]);
+  JobChannel::Frame type;
+  std::string payload;
+  EXPECT_FALSE(reader.Receive(type, payload, nullptr, 50));
+  EXPECT_THAT(reader.Error(), testing::HasSubstr("timed out"));
+
+  // A frame announcing 512MB, of which only a few bytes ever come, is not
+  // allocated up front
+  const char header[] = {JobChannel::Submit, 0, 0, 0, 0x20, 'j', 'o', 'b'};
+  ASSERT_EQ(write(fds[1], header, sizeof(header)), (ssize_t)sizeof(header));
+  EXPECT_FALSE(reader.Receive(type, payload, nullptr, 50));
+  EXPECT_THAT(reader.Error(), testing::HasSubstr("timed out"));
+  EXPECT_LE(payload.capacity(), 2u << 20);
+  close(fds[1]);
+}
+#endif
+}  // namespace
+}  // namespace FOEDAG
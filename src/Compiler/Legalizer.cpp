@@ -0,0 +1,465 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Legalizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+
+// Columns handled by one task. Cells only move within their strip, the
+// strips are balanced first.
+constexpr size_t kStripColumns = 16;
+
+// The columns of a resource
+struct Region {
+  std::vector<Netlist::CellId> m_cells;
+  std::vector<uint32_t> m_columns;
+  // Per column, the rows that are free sites
+  std::vector<std::vector<uint32_t>> m_rows;
+  // Per strip, the first of its cells, which are sorted by x then
+  // distributed to the strips in x order
+  std::vector<size_t> m_first;
+};
+
+struct Cluster {
+  size_t m_first;
+  int64_t m_width;
+  double m_sum;
+  int64_t m_position;
+};
+
+// A column being filled, in y order
+struct Column {
+  const std::vector<uint32_t>* m_rows = nullptr;
+  float m_x = 0;
+  // Tetris: the lowest slot still free
+  int64_t m_next = 0;
+  // Abacus: the cells in the order they came, and their clusters
+  std::vector<Netlist::CellId> m_cells;
+  std::vector<Cluster> m_clusters;
+};
+
+// Fractional index of value among the sorted slot positions, for the
+// slots are not evenly spaced: columns with blocked sites, pads
+template <typename T>
+float SlotOf(const std::vector<T>& slots, float value) {
+  size_t k = std::lower_bound(slots.begin(), slots.end(), value) -
+             slots.begin();
+  if (k == 0) return value - slots.front();
+  if (k == slots.size()) return (float)(k - 1) + (value - slots.back());
+  return (float)(k - 1) +
+         (value - slots[k - 1]) / (float)(slots[k] - slots[k - 1]);
+}
+
+int64_t ClusterPosition(double sum, int64_t width, int64_t slots) {
+  return std::min<int64_t>(std::max<int64_t>(std::llround(sum / width), 0),
+                           slots - width);
+}
+
+// Abacus: slot of a cell appended to the column at desired, the clusters
+// it overlaps merged and moved to their best position; -1 when the column
+// is full. Only a trial unless commit.
+int64_t Append(Column& column, Netlist::CellId cell, float desired,
+               bool commit) {
+  const int64_t slots = (int64_t)column.m_rows->size();
+  Cluster cluster{column.m_cells.size(), 1, desired, 0};
+  cluster.m_position = ClusterPosition(cluster.m_sum, 1, slots);
+  size_t count = column.m_clusters.size();
+  while (count > 0) {
+    const Cluster& previous = column.m_clusters[count - 1];
+    if (previous.m_position + previous.m_width <= cluster.m_position) break;
+    cluster.m_sum = previous.m_sum + cluster.m_sum -
+                    (double)cluster.m_width * previous.m_width;
+    cluster.m_width += previous.m_width;
+    cluster.m_first = previous.m_first;
+    cluster.m_position =
+        ClusterPosition(cluster.m_sum, cluster.m_width, slots);
+    count--;
+  }
+  if (cluster.m_width > slots) return -1;
+  if (commit) {
+    column.m_clusters.resize(count);
+    column.m_clusters.push_back(cluster);
+    column.m_cells.push_back(cell);
+  }
+  return cluster.m_position + cluster.m_width - 1;
+}
+
+// 1D forms, for the pads: count items, sorted by desired slot, on distinct
+// slots in [0, slots) keeping their order. count <= slots.
+void Tetris1D(const float* desired, size_t count, uint32_t slots,
+              uint32_t* slot) {
+  int64_t next = 0;
+  for (size_t i = 0; i < count; i++) {
+    int64_t position = std::max<int64_t>(std::llround(desired[i]), next);
+    position = std::min<int64_t>(position, (int64_t)(slots - (count - i)));
+    slot[i] = (uint32_t)position;
+    next = position + 1;
+  }
+}
+
+void Abacus1D(const float* desired, size_t count, uint32_t slots,
+              uint32_t* slot) {
+  std::vector<uint32_t> rows(slots);
+  for (uint32_t i = 0; i < slots; i++) rows[i] = i;
+  Column column;
+  column.m_rows = &rows;
+  for (size_t i = 0; i < count; i++) {
+    Append(column, (Netlist::CellId)i, desired[i], true);
+  }
+  for (const Cluster& cluster : column.m_clusters) {
+    for (int64_t k = 0; k < cluster.m_width; k++) {
+      slot[cluster.m_first + k] = (uint32_t)(cluster.m_position + k);
+    }
+  }
+}
+
+// Legalizes the cells of a strip, in y order, each on the column of the
+// strip where it moves the least
+void LegalizeStrip(Region& region, size_t strip, bool tetris,
+                   CellPlacement& placement, std::vector<Column>& columns) {
+  const float* x = placement.XData();
+  const float* y = placement.YData();
+  const size_t firstColumn = strip * kStripColumns;
+  const size_t count =
+      std::min(kStripColumns, region.m_columns.size() - firstColumn);
+  columns.resize(count);
+  int64_t free = 0;
+  for (size_t i = 0; i < count; i++) {
+    Column& column = columns[i];
+    column.m_rows = &region.m_rows[firstColumn + i];
+    column.m_x = region.m_columns[firstColumn + i] + 0.5f;
+    column.m_next = 0;
+    column.m_cells.clear();
+    column.m_clusters.clear();
+    free += (int64_t)column.m_rows->size();
+  }
+  auto first = region.m_cells.begin() + region.m_first[strip];
+  auto last = region.m_cells.begin() + region.m_first[strip + 1];
+  std::sort(first, last, [&](Netlist::CellId a, Netlist::CellId b) {
+    if (y[a] != y[b]) return y[a] < y[b];
+    if (x[a] != x[b]) return x[a] < x[b];
+    return a < b;
+  });
+  int64_t remaining = last - first;
+  for (auto it = first; it != last; ++it) {
+    const Netlist::CellId cell = *it;
+    remaining--;
+    // Columns by distance, stopping once that alone costs more than the
+    // best so far
+    size_t right = 0;
+    while (right < count && columns[right].m_x < x[cell]) right++;
+    size_t left = right;
+    double bestCost = INFINITY;
+    size_t best = 0;
+    int64_t bestSlot = -1;
+    while (left > 0 || right < count) {
+      size_t i;
+      if (left == 0) {
+        i = right++;
+      } else if (right == count) {
+        i = --left;
+      } else if (x[cell] - columns[left - 1].m_x <=
+                 columns[right].m_x - x[cell]) {
+        i = --left;
+      } else {
+        i = right++;
+      }
+      Column& column = columns[i];
+      const double dx = std::abs(column.m_x - x[cell]);
+      if (dx >= bestCost) break;
+      const std::vector<uint32_t>& rows = *column.m_rows;
+      const float desired = SlotOf(rows, y[cell] - 0.5f);
+      int64_t slot;
+      if (tetris) {
+        // Never past the point where the strip could not take the cells
+        // still to come
+        const int64_t slots = (int64_t)rows.size();
+        if (column.m_next >= slots) continue;
+        slot = std::max<int64_t>(std::llround(desired), column.m_next);
+        slot = std::min(slot, std::min(slots - 1, column.m_next + free -
+                                                      remaining - 1));
+      } else {
+        slot = Append(column, cell, desired, false);
+        if (slot < 0) continue;
+      }
+      const double cost = dx + std::abs(rows[slot] + 0.5f - y[cell]);
+      if (cost < bestCost) {
+        bestCost = cost;
+        best = i;
+        bestSlot = slot;
+      }
+    }
+    Column& column = columns[best];
+    if (tetris) {
+      free -= bestSlot - column.m_next + 1;
+      column.m_next = bestSlot + 1;
+      placement.Set(cell, column.m_x, (*column.m_rows)[bestSlot] + 0.5f);
+    } else {
+      Append(column, cell, SlotOf(*column.m_rows, y[cell] - 0.5f), true);
+    }
+  }
+  if (tetris) return;
+  for (Column& column : columns) {
+    for (const Cluster& cluster : column.m_clusters) {
+      for (int64_t k = 0; k < cluster.m_width; k++) {
+        placement.Set(column.m_cells[cluster.m_first + k], column.m_x,
+                      (*column.m_rows)[cluster.m_position + k] + 0.5f);
+      }
+    }
+  }
+}
+
+// Position along the boundary, counterclockwise from the lower left
+// corner, of the closest boundary point
+float Perimeter(float x, float y, float width, float height) {
+  const float bottom = y, right = width - x, top = height - y, left = x;
+  const float closest = std::min(std::min(bottom, right), std::min(top, left));
+  if (closest == bottom) return std::min(std::max(x, 0.0f), width);
+  if (closest == right) return width + std::min(std::max(y, 0.0f), height);
+  if (closest == top) {
+    return 2 * width + height - std::min(std::max(x, 0.0f), width);
+  }
+  return 2 * (width + height) - std::min(std::max(y, 0.0f), height);
+}
+
+}  // namespace
+
+bool Legalizer::Place(const Netlist& netlist, const DeviceModel& device,
+                      CellPlacement& placement) {
+  auto start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  m_error.clear();
+  if (placement.Size() != netlist.CellCount()) {
+    m_error = "the netlist is not placed";
+    return false;
+  }
+  if ((uint32_t)std::floor(placement.Width() + 1e-6) != device.Columns() ||
+      (uint32_t)std::floor(placement.Height() + 1e-6) != device.Rows()) {
+    m_error = "the placement die does not match the device";
+    return false;
+  }
+  m_stats.m_initialHpwl = placement.Hpwl(netlist, m_options.m_threads);
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  const uint32_t columns = device.Columns(), rows = device.Rows();
+  float* x = placement.XData();
+  float* y = placement.YData();
+
+  // Regions by resource, kResourceCount for the generic sites
+  const int generic = DeviceModel::kResourceCount;
+  std::vector<Region> regions(DeviceModel::kResourceCount + 1);
+  std::vector<uint8_t> blocked(device.Sites().size(), 0);
+  std::vector<Netlist::CellId> ports;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    std::string_view type = netlist.CellType(cell);
+    if (CellPlacement::IsConstant(type)) continue;
+    if (CellPlacement::IsPort(type)) {
+      ports.push_back(cell);
+    } else if (placement.Fixed(cell)) {
+      if (x[cell] >= 0 && y[cell] >= 0 && x[cell] < columns &&
+          y[cell] < rows) {
+        blocked[(size_t)y[cell] * columns + (size_t)x[cell]] = 1;
+      }
+    } else {
+      const int region = device.Generic()
+                             ? generic
+                             : (int)DeviceModel::CellResource(type);
+      regions[region].m_cells.push_back(cell);
+    }
+  }
+
+  // Free sites of the columns
+  for (uint32_t column = 0; column < columns; column++) {
+    for (int region = 0; region <= generic; region++) {
+      if (region == DeviceModel::Io) continue;
+      std::vector<uint32_t> free;
+      for (uint32_t row = 0; row < rows; row++) {
+        const uint8_t site = device.Site(column, row);
+        const bool fits = (region == generic)
+                              ? site == DeviceModel::kAnySite
+                              : site == region;
+        if (fits && !blocked[(size_t)row * columns + column]) {
+          free.push_back(row);
+        }
+      }
+      if (free.empty()) continue;
+      regions[region].m_columns.push_back(column);
+      regions[region].m_rows.push_back(std::move(free));
+    }
+  }
+  for (int region = 0; region <= generic; region++) {
+    if (region == DeviceModel::Io) continue;
+    size_t capacity = 0;
+    for (auto& free : regions[region].m_rows) capacity += free.size();
+    if (regions[region].m_cells.size() > capacity) {
+      const char* name = (region == generic)
+                             ? "logic"
+                             : DeviceModel::ResourceName(
+                                   (DeviceModel::Resource)region);
+      m_error = "the design needs " +
+                std::to_string(regions[region].m_cells.size()) + " " +
+                name + " sites, " + std::to_string(capacity) +
+                " are available";
+      return false;
+    }
+  }
+  if (!device.Generic() && ports.size() > device.Pads().size()) {
+    m_error = "the design has " + std::to_string(ports.size()) +
+              " ports, the device " + std::to_string(device.Pads().size()) +
+              " pads";
+    return false;
+  }
+  if (m_options.m_cancel.Cancelled()) return false;
+
+  std::vector<float> initialX(x, x + netlist.CellCount());
+  std::vector<float> initialY(y, y + netlist.CellCount());
+
+  // Strips: cells in x order to the strip of their closest column, then
+  // the surplus of the full strips pushed right, and what is left over
+  // back left
+  struct Job {
+    Region* m_region;
+    size_t m_strip;
+  };
+  std::vector<Job> jobs;
+  for (int region = 0; region <= generic; region++) {
+    Region& r = regions[region];
+    if (r.m_cells.empty() || region == DeviceModel::Io) continue;
+    std::sort(r.m_cells.begin(), r.m_cells.end(),
+              [&](Netlist::CellId a, Netlist::CellId b) {
+                if (x[a] != x[b]) return x[a] < x[b];
+                if (y[a] != y[b]) return y[a] < y[b];
+                return a < b;
+              });
+    const size_t strips =
+        (r.m_columns.size() + kStripColumns - 1) / kStripColumns;
+    std::vector<int64_t> capacity(strips, 0), cells(strips, 0);
+    for (size_t i = 0; i < r.m_columns.size(); i++) {
+      capacity[i / kStripColumns] += (int64_t)r.m_rows[i].size();
+    }
+    size_t column = 0;
+    for (Netlist::CellId cell : r.m_cells) {
+      while (column + 1 < r.m_columns.size() &&
+             std::abs(r.m_columns[column + 1] + 0.5f - x[cell]) <=
+                 std::abs(r.m_columns[column] + 0.5f - x[cell])) {
+        column++;
+      }
+      cells[column / kStripColumns]++;
+    }
+    for (size_t i = 0; i + 1 < strips; i++) {
+      const int64_t surplus = cells[i] - capacity[i];
+      if (surplus > 0) {
+        cells[i] -= surplus;
+        cells[i + 1] += surplus;
+      }
+    }
+    for (size_t i = strips - 1; i > 0; i--) {
+      const int64_t surplus = cells[i] - capacity[i];
+      if (surplus > 0) {
+        cells[i] -= surplus;
+        cells[i - 1] += surplus;
+      }
+    }
+    r.m_first.assign(strips + 1, 0);
+    for (size_t i = 0; i < strips; i++) {
+      r.m_first[i + 1] = r.m_first[i] + (size_t)cells[i];
+      if (cells[i] > 0) jobs.push_back(Job{&r, i});
+    }
+  }
+
+  // Each strip on its own
+  const bool tetris = m_options.m_mode == Tetris;
+  scheduler->ParallelFor(
+      0, jobs.size(), 1,
+      [&](size_t begin, size_t end) {
+        std::vector<Column> columns;
+        for (size_t j = begin; j < end; j++) {
+          LegalizeStrip(*jobs[j].m_region, jobs[j].m_strip, tetris,
+                        placement, columns);
+        }
+      },
+      m_options.m_threads);
+  if (m_options.m_cancel.Cancelled()) return false;
+
+  // Ports on pads, in the order they are along the boundary
+  const std::vector<DeviceModel::Pad>& pads = device.Pads();
+  if (!device.Generic() && !ports.empty()) {
+    const float width = (float)columns, height = (float)rows;
+    std::vector<float> along(netlist.CellCount());
+    for (Netlist::CellId port : ports) {
+      along[port] = Perimeter(x[port], y[port], width, height);
+    }
+    std::sort(ports.begin(), ports.end(),
+              [&](Netlist::CellId a, Netlist::CellId b) {
+                if (along[a] != along[b]) return along[a] < along[b];
+                return a < b;
+              });
+    std::vector<float> slots, desired;
+    for (const DeviceModel::Pad& pad : pads) {
+      slots.push_back(Perimeter(pad.m_x, pad.m_y, width, height));
+    }
+    for (Netlist::CellId port : ports) {
+      desired.push_back(SlotOf(slots, along[port]));
+    }
+    std::vector<uint32_t> slot(ports.size());
+    if (tetris) {
+      Tetris1D(desired.data(), ports.size(), (uint32_t)pads.size(),
+               slot.data());
+    } else {
+      Abacus1D(desired.data(), ports.size(), (uint32_t)pads.size(),
+               slot.data());
+    }
+    for (size_t k = 0; k < ports.size(); k++) {
+      placement.Set(ports[k], pads[slot[k]].m_x, pads[slot[k]].m_y);
+      placement.SetFixed(ports[k], true);
+    }
+    regions[DeviceModel::Io].m_cells = ports;
+  }
+
+  for (const Region& region : regions) {
+    for (Netlist::CellId cell : region.m_cells) {
+      const double displacement = std::abs(x[cell] - initialX[cell]) +
+                                  std::abs(y[cell] - initialY[cell]);
+      m_stats.m_cells++;
+      if (displacement > 0) m_stats.m_moved++;
+      m_stats.m_totalDisplacement += displacement;
+      m_stats.m_maxDisplacement =
+          std::max(m_stats.m_maxDisplacement, displacement);
+    }
+  }
+  if (m_stats.m_cells) {
+    m_stats.m_averageDisplacement =
+        m_stats.m_totalDisplacement / m_stats.m_cells;
+  }
+  m_stats.m_hpwl = placement.Hpwl(netlist, m_options.m_threads);
+  m_stats.m_seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return true;
+}
@@ -0,0 +1,90 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/DeviceModel.h"
+#include "Compiler/EventBus.h"
+#include "Compiler/Netlist.h"
+
+#ifndef LEGALIZER_H
+#define LEGALIZER_H
+
+namespace FOEDAG {
+
+// Moves the cells of a global placement to distinct sites of the device
+// that fit their resource, and the ports to pads. The columns of each
+// resource are grouped in strips of a few columns; cells are spread over
+// the strips in x order, within the capacity of each strip, then every
+// strip is legalized on its own, in parallel, in y order, each cell on the
+// column of the strip where it moves the least:
+// - Tetris: on the lowest free site of the column at or above its
+//   position, leaving room for the cells still to come;
+// - Abacus: cells keep their y order in a column and are clustered where
+//   they would overlap, each cluster on the sites minimizing the squared
+//   displacement of its cells.
+// Ports take the pads in the same way, along the boundary. The result
+// does not depend on the number of threads. Fixed logic cells stay, on
+// sites the others do not use.
+class Legalizer {
+ public:
+  enum Mode { Tetris, Abacus };
+
+  struct Options {
+    Mode m_mode = Abacus;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    CancellationToken m_cancel;
+  };
+  struct Stats {
+    size_t m_cells = 0;  // logic cells and ports legalized
+    size_t m_moved = 0;
+    // Manhattan distance from the global placement, in sites
+    double m_totalDisplacement = 0;
+    double m_averageDisplacement = 0;
+    double m_maxDisplacement = 0;
+    double m_initialHpwl = 0;
+    double m_hpwl = 0;
+    double m_seconds = 0;
+  };
+
+  Legalizer() = default;
+  explicit Legalizer(const Options& options) : m_options(options) {}
+
+  // False when cancelled or when the design does not fit the device, see
+  // Error()
+  bool Place(const Netlist& netlist, const DeviceModel& device,
+             CellPlacement& placement);
+
+  const Stats& GetStats() const { return m_stats; }
+  const std::string& Error() const { return m_error; }
+
+ private:
+  Options m_options;
+  Stats m_stats;
+  std::string m_error;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,231 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Legalizer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include "Compiler/GlobalPlacer.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// A chain of LUTs, each other one registered, between an input and an
+// output port
+void BuildChain(Netlist& netlist, int length) {
+  Netlist::NetId previous = netlist.AddNet("in");
+  Netlist::CellId in = netlist.AddCell("in", "$input");
+  netlist.Connect(netlist.AddPin(in, "Y", Netlist::Output), previous);
+  for (int i = 0; i < length; i++) {
+    Netlist::NetId net = netlist.AddNet("n" + std::to_string(i));
+    Netlist::CellId cell = netlist.AddCell(
+        "c" + std::to_string(i), (i % 2) ? "dff" : "LUT1");
+    netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), previous);
+    netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), net);
+    previous = net;
+  }
+  Netlist::CellId out = netlist.AddCell("out", "$output");
+  netlist.Connect(netlist.AddPin(out, "A", Netlist::Input), previous);
+  netlist.Finalize();
+}
+
+DeviceModel Device(uint32_t luts, uint32_t ffs, uint32_t ios) {
+  DeviceModel device;
+  device.Build("test", {luts, ffs, 0, ios});
+  return device;
+}
+
+void GlobalPlace(const Netlist& netlist, const DeviceModel& device,
+                 CellPlacement& placement) {
+  placement.Reset(netlist.CellCount(), device.Columns(), device.Rows());
+  GlobalPlacer global;
+  ASSERT_TRUE(global.Place(netlist, placement));
+}
+
+// Every cell on a site of its own accepting its resource, ports on pads
+bool Legal(const Netlist& netlist, const DeviceModel& device,
+           const CellPlacement& placement) {
+  std::set<std::pair<float, float>> used;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    const float x = placement.X(cell), y = placement.Y(cell);
+    if (!used.insert({x, y}).second) return false;
+    const DeviceModel::Resource resource =
+        DeviceModel::CellResource(netlist.CellType(cell));
+    if (resource == DeviceModel::Io) {
+      bool onPad = false;
+      for (const DeviceModel::Pad& pad : device.Pads()) {
+        onPad |= pad.m_x == x && pad.m_y == y;
+      }
+      if (!onPad) return false;
+      continue;
+    }
+    if (x != std::floor(x) + 0.5f || y != std::floor(y) + 0.5f) return false;
+    if (x < 0 || y < 0 || x > device.Columns() || y > device.Rows()) {
+      return false;
+    }
+    if (!DeviceModel::Accepts(device.Site((uint32_t)x, (uint32_t)y),
+                              resource)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(DeviceModel, LaysOutColumnsOfEachResource) {
+  DeviceModel device = Device(1000, 500, 40);
+  std::array<uint32_t, DeviceModel::kResourceCount> sites{};
+  for (uint32_t row = 0; row < device.Rows(); row++) {
+    for (uint32_t column = 0; column < device.Columns(); column++) {
+      const uint8_t site = device.Site(column, row);
+      if (site == DeviceModel::kNoSite) continue;
+      ASSERT_LT(site, DeviceModel::kResourceCount);
+      sites[site]++;
+      // Columns of a single resource
+      const uint8_t bottom = device.Site(column, 0);
+      EXPECT_EQ(site, bottom);
+    }
+  }
+  EXPECT_EQ(sites[DeviceModel::Lut], 1000u);
+  EXPECT_EQ(sites[DeviceModel::Ff], 500u);
+  EXPECT_EQ(device.Pads().size(), 40u);
+  EXPECT_EQ(device.Spec(), "test lut 1000 ff 500 bram 0 io 40");
+  DeviceModel copy;
+  std::string error;
+  ASSERT_TRUE(copy.FromSpec(device.Spec(), error)) << error;
+  EXPECT_EQ(copy.Sites(), device.Sites());
+  EXPECT_FALSE(copy.FromSpec("test gates 10", error));
+}
+
+TEST(DeviceModel, LoadsResourceCounts) {
+  const std::string file = "legalizer_test_device.xml";
+  {
+    std::ofstream stream(file);
+    stream << "<device_list>\n"
+              "  <device name=\"other\">\n"
+              "    <resource type=\"lut\" num=\"10\"/>\n"
+              "  </device>\n"
+              "  <device name=\"small\">\n"
+              "    <resource type=\"lut\" num=\"64\"/>\n"
+              "    <resource type=\"ff\" num=\"32\"/>\n"
+              "    <resource type=\"io\" num=\"8\"/>\n"
+              "  </device>\n"
+              "</device_list>\n";
+  }
+  DeviceModel device;
+  std::string error;
+  ASSERT_TRUE(device.Load(file, "small", error)) << error;
+  EXPECT_EQ(device.Count(DeviceModel::Lut), 64u);
+  EXPECT_EQ(device.Count(DeviceModel::Ff), 32u);
+  EXPECT_EQ(device.Count(DeviceModel::Io), 8u);
+  EXPECT_FALSE(device.Load(file, "missing", error));
+  EXPECT_THAT(error, testing::HasSubstr("no device missing"));
+  std::remove(file.c_str());
+}
+
+class LegalizerModes : public testing::TestWithParam<Legalizer::Mode> {};
+
+TEST_P(LegalizerModes, PlacesCellsOnSitesOfTheirResource) {
+  Netlist netlist;
+  BuildChain(netlist, 600);
+  DeviceModel device = Device(400, 400, 16);
+  CellPlacement placement;
+  GlobalPlace(netlist, device, placement);
+  Legalizer::Options options;
+  options.m_mode = GetParam();
+  Legalizer legalizer(options);
+  ASSERT_TRUE(legalizer.Place(netlist, device, placement))
+      << legalizer.Error();
+  EXPECT_TRUE(Legal(netlist, device, placement));
+  const Legalizer::Stats& stats = legalizer.GetStats();
+  EXPECT_EQ(stats.m_cells, 602u);
+  EXPECT_GT(stats.m_moved, 0u);
+  EXPECT_LE(stats.m_averageDisplacement, stats.m_maxDisplacement);
+  EXPECT_DOUBLE_EQ(stats.m_hpwl, placement.Hpwl(netlist));
+  EXPECT_TRUE(placement.Fixed(0));
+
+  // A legal placement stays as it is
+  Legalizer again(options);
+  ASSERT_TRUE(again.Place(netlist, device, placement));
+  EXPECT_EQ(again.GetStats().m_moved, 0u);
+}
+
+TEST_P(LegalizerModes, SameResultWithAnyThreadCount) {
+  Netlist netlist;
+  BuildChain(netlist, 2000);
+  DeviceModel device = Device(1200, 1200, 8);
+  CellPlacement placements[2];
+  for (int run = 0; run < 2; run++) {
+    GlobalPlace(netlist, device, placements[run]);
+    Legalizer::Options options;
+    options.m_mode = GetParam();
+    options.m_threads = (run == 0) ? 1 : 4;
+    Legalizer legalizer(options);
+    ASSERT_TRUE(legalizer.Place(netlist, device, placements[run]));
+  }
+  for (Netlist::CellId cell : netlist.Cells()) {
+    ASSERT_EQ(placements[0].X(cell), placements[1].X(cell));
+    ASSERT_EQ(placements[0].Y(cell), placements[1].Y(cell));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Legalizer, LegalizerModes,
+                         testing::Values(Legalizer::Tetris,
+                                         Legalizer::Abacus));
+
+TEST(Legalizer, AbacusMovesCellsLessThanTetris) {
+  Netlist netlist;
+  BuildChain(netlist, 2000);
+  DeviceModel device = Device(1100, 1100, 8);
+  double displacement[2];
+  for (Legalizer::Mode mode : {Legalizer::Tetris, Legalizer::Abacus}) {
+    CellPlacement placement;
+    GlobalPlace(netlist, device, placement);
+    Legalizer::Options options;
+    options.m_mode = mode;
+    Legalizer legalizer(options);
+    ASSERT_TRUE(legalizer.Place(netlist, device, placement));
+    displacement[mode] = legalizer.GetStats().m_totalDisplacement;
+  }
+  EXPECT_LE(displacement[Legalizer::Abacus], displacement[Legalizer::Tetris]);
+}
+
+TEST(Legalizer, FailsWhenTheDeviceIsTooSmall) {
+  Netlist netlist;
+  BuildChain(netlist, 100);
+  DeviceModel device = Device(40, 100, 4);
+  CellPlacement placement;
+  GlobalPlace(netlist, device, placement);
+  Legalizer legalizer;
+  EXPECT_FALSE(legalizer.Place(netlist, device, placement));
+  EXPECT_THAT(legalizer.Error(),
+              testing::HasSubstr("the design needs 50 lut sites, 40 are"));
+
+  DeviceModel noPads = Device(100, 100, 1);
+  GlobalPlace(netlist, noPads, placement);
+  EXPECT_FALSE(legalizer.Place(netlist, noPads, placement));
+  EXPECT_THAT(legalizer.Error(), testing::HasSubstr("pad"));
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,85 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace FOEDAG;
+
+bool MappedFile::Open(const std::string& path, std::string& error) {
+  Close();
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0) {
+    error = path + ": " + strerror(errno);
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  m_size = (size_t)status.st_size;
+  if (m_size > 0) {
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      m_data = (const char*)data;
+      m_mapped = true;
+    }
+  }
+  close(fd);
+  if (m_mapped || m_size == 0) return true;
+#endif
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    error = "cannot read " + path;
+    return false;
+  }
+  m_buffer.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  return true;
+}
+
+void MappedFile::Close() {
+#ifndef _WIN32
+  if (m_mapped) munmap((void*)m_data, m_size);
+#endif
+  m_buffer = std::vector<char>();
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+}
+
+void MappedFile::AdviseSequential() const {
+#ifndef _WIN32
+  if (m_mapped) madvise((void*)m_data, m_size, MADV_SEQUENTIAL);
+#endif
+}
@@ -0,0 +1,60 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+namespace FOEDAG {
+
+// Read-only memory mapping of a whole file, read into memory instead where
+// mmap is not available
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& path, std::string& error);
+  void Close();
+  // Hint for a front to back pass, the kernel reads ahead more aggressively
+  void AdviseSequential() const;
+
+  const char* Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+  std::string_view View() const { return std::string_view(m_data, m_size); }
+  bool Mapped() const { return m_mapped; }
+
+ private:
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_mapped = false;
+  std::vector<char> m_buffer;
+};
+
+}  // namespace FOEDAG
+
+#endif
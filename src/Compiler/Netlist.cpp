@@ -0,0 +1,336 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Netlist.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Compiler/Checkpoint.h"
+
+using namespace FOEDAG;
+
+static uintptr_t AlignUp(const char* pointer, size_t align) {
+  return ((uintptr_t)pointer + align - 1) & ~(uintptr_t)(align - 1);
+}
+
+void* Arena::Allocate(size_t size, size_t align) {
+  uintptr_t cursor = AlignUp(m_cursor, align);
+  if (m_cursor == nullptr || cursor + size > (uintptr_t)m_end) {
+    // Oversized requests get a block of their own
+    size_t blockSize = std::max(m_blockSize, size + align);
+    m_blocks.emplace_back(new char[blockSize]);
+    m_cursor = m_blocks.back().get();
+    m_end = m_cursor + blockSize;
+    m_capacity += blockSize;
+    cursor = AlignUp(m_cursor, align);
+  }
+  m_cursor = (char*)(cursor + size);
+  return (void*)cursor;
+}
+
+void Arena::Clear() {
+  m_blocks.clear();
+  m_cursor = m_end = nullptr;
+  m_capacity = 0;
+}
+
+uint32_t StringPool::Add(std::string_view str) {
+  char* data = (char*)m_arena.Allocate(str.size() + 1, 1);
+  memcpy(data, str.data(), str.size());
+  data[str.size()] = '\0';
+  m_strings.emplace_back(data, str.size());
+  return (uint32_t)(Size() - 1);
+}
+
+uint32_t StringPool::Intern(std::string_view str) {
+  auto found = m_index.find(str);
+  if (found != m_index.end()) return found->second;
+  uint32_t id = Add(str);
+  m_index.emplace(Get(id), id);
+  return id;
+}
+
+uint32_t StringPool::Find(std::string_view str) const {
+  auto found = m_index.find(str);
+  return (found == m_index.end()) ? kNone : found->second;
+}
+
+size_t StringPool::MemoryBytes() const {
+  // Rough cost of a hash node: key, value, next pointer and the bucket
+  const size_t nodeBytes = sizeof(std::string_view) + 2 * sizeof(void*) + 8;
+  return m_arena.Capacity() +
+         m_strings.capacity() * sizeof(std::string_view) +
+         m_index.size() * nodeBytes;
+}
+
+void StringPool::Clear() {
+  m_arena.Clear();
+  m_strings.clear();
+  m_index.clear();
+  m_viewData = nullptr;
+  m_viewOffsets = nullptr;
+  m_viewCount = 0;
+}
+
+bool StringPool::Save(CheckpointWriter& writer,
+                      const std::string& prefix) const {
+  std::vector<uint64_t> offsets(Size() + 1, 0);
+  if (!writer.BeginSection(prefix + ".data")) return false;
+  for (uint32_t id = 0; id < Size(); id++) {
+    std::string_view str = Get(id);
+    // Terminated, so that views on the checkpoint stay C strings
+    writer.Append(str.data(), str.size());
+    writer.Append("", 1);
+    offsets[id + 1] = offsets[id] + str.size() + 1;
+  }
+  std::vector<uint32_t> interned;
+  interned.reserve(m_index.size());
+  for (auto& entry : m_index) interned.push_back(entry.second);
+  std::sort(interned.begin(), interned.end());
+  return writer.EndSection() &&
+         writer.WriteArray(prefix + ".offsets", offsets.data(),
+                           offsets.size()) &&
+         writer.WriteArray(prefix + ".interned", interned.data(),
+                           interned.size());
+}
+
+bool StringPool::Load(const MappedCheckpoint& checkpoint,
+                      const std::string& prefix) {
+  Clear();
+  size_t count = 0;
+  std::string_view data = checkpoint.Section(prefix + ".data");
+  const uint64_t* offsets =
+      checkpoint.Array<uint64_t>(prefix + ".offsets", count);
+  if (count == 0 || offsets[0] != 0 || offsets[count - 1] != data.size()) {
+    return false;
+  }
+  for (size_t i = 0; i + 1 < count; i++) {
+    if (offsets[i + 1] <= offsets[i]) return false;
+  }
+  m_viewData = data.data();
+  m_viewOffsets = offsets;
+  m_viewCount = (uint32_t)(count - 1);
+  const uint32_t* interned =
+      checkpoint.Array<uint32_t>(prefix + ".interned", count);
+  for (size_t i = 0; i < count; i++) {
+    if (interned[i] < m_viewCount) {
+      m_index.emplace(Get(interned[i]), interned[i]);
+    }
+  }
+  return true;
+}
+
+void Netlist::Reserve(size_t cells, size_t pins, size_t nets) {
+  m_cellName.reserve(cells);
+  m_cellType.reserve(cells);
+  m_cellPinBegin.reserve(cells + 1);
+  m_pinCell.reserve(pins);
+  m_pinNet.reserve(pins);
+  m_pinName.reserve(pins);
+  m_pinDirection.reserve(pins);
+  m_netName.reserve(nets);
+}
+
+void Netlist::Clear() {
+  m_strings.Clear();
+  m_cellName.clear();
+  m_cellType.clear();
+  m_cellPinBegin.Assign(std::vector<uint32_t>(1, 0));
+  m_pinCell.clear();
+  m_pinNet.clear();
+  m_pinName.clear();
+  m_pinDirection.clear();
+  m_netName.clear();
+  m_netPinBegin.clear();
+  m_netPins.clear();
+  m_finalized = false;
+  m_checkpoint.reset();
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  m_indexed = false;
+  m_cellIndex.clear();
+  m_netIndex.clear();
+}
+
+Netlist::CellId Netlist::AddCell(std::string_view name,
+                                 std::string_view type) {
+  m_cellName.push_back(m_strings.Add(name));
+  m_cellType.push_back(m_strings.Intern(type));
+  m_cellPinBegin.push_back(m_cellPinBegin.back());
+  m_indexed = false;
+  return (CellId)(m_cellType.size() - 1);
+}
+
+Netlist::PinId Netlist::AddPin(CellId cell, std::string_view name,
+                               Direction direction) {
+  if (cell + 1 != CellCount()) return kNone;
+  m_pinCell.push_back(cell);
+  m_pinNet.push_back(kNone);
+  m_pinName.push_back(m_strings.Intern(name));
+  m_pinDirection.push_back(direction);
+  m_cellPinBegin.Set(m_cellPinBegin.size() - 1, m_cellPinBegin.back() + 1);
+  m_finalized = false;
+  return (PinId)(m_pinCell.size() - 1);
+}
+
+Netlist::NetId Netlist::AddNet(std::string_view name) {
+  m_netName.push_back(m_strings.Add(name));
+  m_finalized = false;
+  m_indexed = false;
+  return (NetId)(m_netName.size() - 1);
+}
+
+// Counting sort of the pins by net, drivers placed first
+void Netlist::Finalize() {
+  const size_t nets = NetCount();
+  std::vector<uint32_t> begin(nets + 1, 0);
+  for (PinId pin = 0; pin < PinCount(); pin++) {
+    if (m_pinNet[pin] != kNone) begin[m_pinNet[pin] + 1]++;
+  }
+  for (size_t net = 0; net < nets; net++) begin[net + 1] += begin[net];
+  std::vector<PinId> pins(begin[nets]);
+  std::vector<uint32_t> fill(begin.begin(), begin.end() - 1);
+  for (int drivers = 1; drivers >= 0; drivers--) {
+    for (PinId pin = 0; pin < PinCount(); pin++) {
+      NetId net = m_pinNet[pin];
+      if (net == kNone || (m_pinDirection[pin] != Input) != (drivers == 1)) {
+        continue;
+      }
+      pins[fill[net]++] = pin;
+    }
+  }
+  m_netPinBegin.Assign(std::move(begin));
+  m_netPins.Assign(std::move(pins));
+  m_finalized = true;
+}
+
+void Netlist::BuildNameIndex() const {
+  if (m_indexed) return;
+  m_cellIndex.clear();
+  m_netIndex.clear();
+  m_cellIndex.reserve(CellCount());
+  m_netIndex.reserve(NetCount());
+  for (CellId cell = 0; cell < CellCount(); cell++) {
+    m_cellIndex.emplace(CellName(cell), cell);
+  }
+  for (NetId net = 0; net < NetCount(); net++) {
+    m_netIndex.emplace(NetName(net), net);
+  }
+  m_indexed = true;
+}
+
+Netlist::CellId Netlist::FindCell(std::string_view name) const {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  BuildNameIndex();
+  auto found = m_cellIndex.find(name);
+  return (found == m_cellIndex.end()) ? kNone : found->second;
+}
+
+Netlist::NetId Netlist::FindNet(std::string_view name) const {
+  std::lock_guard<std::mutex> lock(m_indexMutex);
+  BuildNameIndex();
+  auto found = m_netIndex.find(name);
+  return (found == m_netIndex.end()) ? kNone : found->second;
+}
+
+size_t Netlist::MemoryBytes() const {
+  auto bytes = [](const auto& array) { return array.OwnedBytes(); };
+  size_t total = m_strings.MemoryBytes();
+  total += bytes(m_cellName) + bytes(m_cellType) + bytes(m_cellPinBegin);
+  total += bytes(m_pinCell) + bytes(m_pinNet) + bytes(m_pinName) +
+           bytes(m_pinDirection);
+  total += bytes(m_netName) + bytes(m_netPinBegin) + bytes(m_netPins);
+  return total;
+}
+
+bool Netlist::Save(CheckpointWriter& writer) const {
+  if (!m_finalized) return false;
+  auto write = [&writer](const std::string& name, const auto& array) {
+    return writer.WriteArray("netlist." + name, array.data(), array.size());
+  };
+  return m_strings.Save(writer, "netlist.strings") &&
+         write("cell.name", m_cellName) && write("cell.type", m_cellType) &&
+         write("cell.pins", m_cellPinBegin) && write("pin.cell", m_pinCell) &&
+         write("pin.net", m_pinNet) && write("pin.name", m_pinName) &&
+         write("pin.direction", m_pinDirection) &&
+         write("net.name", m_netName) && write("net.pins", m_netPinBegin) &&
+         write("net.pin_list", m_netPins);
+}
+
+bool Netlist::Load(std::shared_ptr<const MappedCheckpoint> checkpoint,
+                   std::string& error) {
+  Clear();
+  bool ok = true;
+  auto view = [&](const std::string& name, auto& array, size_t expected) {
+    typedef typename std::decay<decltype(array[0])>::type Element;
+    size_t count = 0;
+    const Element* data =
+        checkpoint->Array<Element>("netlist." + name, count);
+    if (count != expected && expected != kNone) ok = false;
+    array.View(data, count);
+    return count;
+  };
+  size_t cells = view("cell.type", m_cellType, kNone);
+  view("cell.name", m_cellName, cells);
+  size_t pins = view("pin.cell", m_pinCell, kNone);
+  view("cell.pins", m_cellPinBegin, cells + 1);
+  view("pin.net", m_pinNet, pins);
+  view("pin.name", m_pinName, pins);
+  view("pin.direction", m_pinDirection, pins);
+  size_t nets = view("net.name", m_netName, kNone);
+  view("net.pins", m_netPinBegin, nets + 1);
+  ok = ok && m_cellPinBegin.back() == pins &&
+       m_netPinBegin.back() <= pins;
+  view("net.pin_list", m_netPins, ok ? m_netPinBegin.back() : kNone);
+  ok = ok && m_strings.Load(*checkpoint, "netlist.strings");
+
+  // Every accessor indexes with these, a damaged file must not send them
+  // out of the arrays
+  auto offsets = [&ok](const MappedArray<uint32_t>& begin) {
+    ok = ok && begin[0] == 0;
+    for (size_t i = 0; ok && i + 1 < begin.size(); i++) {
+      ok = begin[i] <= begin[i + 1];
+    }
+  };
+  auto below = [&ok](const auto& array, size_t size, bool none) {
+    for (size_t i = 0; ok && i < array.size(); i++) {
+      ok = array[i] < size || (none && array[i] == kNone);
+    }
+  };
+  offsets(m_cellPinBegin);
+  offsets(m_netPinBegin);
+  below(m_pinCell, cells, false);
+  below(m_pinNet, nets, true);
+  below(m_pinDirection, InOut + 1, false);
+  below(m_netPins, pins, false);
+  for (auto names : {&m_cellName, &m_cellType, &m_pinName, &m_netName}) {
+    below(*names, m_strings.Size(), false);
+  }
+
+  if (!ok) {
+    Clear();
+    error = "invalid netlist in checkpoint";
+    return false;
+  }
+  m_checkpoint = checkpoint;
+  m_finalized = true;
+  return true;
+}
@@ -0,0 +1,333 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef NETLIST_H
+#define NETLIST_H
+
+namespace FOEDAG {
+
+// Bump allocator handing out memory from large blocks. Nothing is freed
+// before Clear() or the destruction of the arena.
+class Arena {
+ public:
+  explicit Arena(size_t blockSize = 1 << 20) : m_blockSize(blockSize) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+  // Bytes reserved from the system
+  size_t Capacity() const { return m_capacity; }
+  void Clear();
+
+ private:
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+  char* m_cursor = nullptr;
+  char* m_end = nullptr;
+  size_t m_blockSize;
+  size_t m_capacity = 0;
+};
+
+// Array that either owns its elements or views elements owned by someone
+// else, typically a mapped checkpoint. Reads go through a plain pointer in
+// both cases; the first modification of a view copies it (copy on write).
+template <typename T>
+class MappedArray {
+ public:
+  MappedArray() = default;
+  MappedArray(std::initializer_list<T> values) : m_owned(values) { Sync(); }
+  MappedArray(const MappedArray&) = delete;
+  MappedArray& operator=(const MappedArray&) = delete;
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  const T* data() const { return m_data; }
+  const T& operator[](size_t i) const { return m_data[i]; }
+  const T& back() const { return m_data[m_size - 1]; }
+
+  void push_back(const T& value) {
+    Own();
+    m_owned.push_back(value);
+    Sync();
+  }
+  void Set(size_t i, const T& value) {
+    Own();
+    m_owned[i] = value;
+  }
+  void reserve(size_t count) {
+    Own();
+    m_owned.reserve(count);
+    Sync();
+  }
+  void Assign(std::vector<T>&& values) {
+    m_view = false;
+    m_owned = std::move(values);
+    Sync();
+  }
+  void clear() { Assign(std::vector<T>()); }
+  void View(const T* data, size_t size) {
+    m_owned = std::vector<T>();
+    m_view = true;
+    m_data = data;
+    m_size = size;
+  }
+  bool IsView() const { return m_view; }
+  size_t OwnedBytes() const { return m_owned.capacity() * sizeof(T); }
+
+ private:
+  void Own() {
+    if (!m_view) return;
+    m_owned.assign(m_data, m_data + m_size);
+    m_view = false;
+    Sync();
+  }
+  void Sync() {
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+  }
+
+  std::vector<T> m_owned;
+  const T* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_view = false;
+};
+
+class CheckpointWriter;
+class MappedCheckpoint;
+
+// Strings stored back to back in an Arena, identified by a dense index.
+// Intern() deduplicates, Add() does not and keeps no lookup entry, which is
+// what unique names (cells, nets) want.
+class StringPool {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint32_t Add(std::string_view str);
+  uint32_t Intern(std::string_view str);
+  uint32_t Find(std::string_view str) const;
+  std::string_view Get(uint32_t id) const {
+    if (id < m_viewCount) {
+      return std::string_view(m_viewData + m_viewOffsets[id],
+                              m_viewOffsets[id + 1] - m_viewOffsets[id] - 1);
+    }
+    return m_strings[id - m_viewCount];
+  }
+  size_t Size() const { return m_viewCount + m_strings.size(); }
+  size_t MemoryBytes() const;
+  void Clear();
+
+  // Checkpoint sections <prefix>.data, <prefix>.offsets and
+  // <prefix>.interned
+  bool Save(CheckpointWriter& writer, const std::string& prefix) const;
+  // The strings become a view on the checkpoint, only the interned ones are
+  // indexed again
+  bool Load(const MappedCheckpoint& checkpoint, const std::string& prefix);
+
+ private:
+  Arena m_arena{1 << 16};
+  std::vector<std::string_view> m_strings;
+  std::unordered_map<std::string_view, uint32_t> m_index;
+  // Strings 0..m_viewCount-1 live in a checkpoint
+  const char* m_viewData = nullptr;
+  const uint64_t* m_viewOffsets = nullptr;
+  uint32_t m_viewCount = 0;
+};
+
+// Flat netlist database. Cells, pins and nets are dense indices into
+// structure of arrays storage: iterating a net touches a few contiguous
+// arrays instead of chasing pointers. The pins of a cell are contiguous
+// (cells and their pins are appended in order), the pins of a net are
+// gathered in a CSR index by Finalize(), driver first.
+//
+// Building is single threaded. Once finalized, all the accessors are safe
+// to call concurrently.
+class Netlist {
+ public:
+  typedef uint32_t CellId;
+  typedef uint32_t PinId;
+  typedef uint32_t NetId;
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  enum Direction : uint8_t { Input, Output, InOut };
+
+  // Range of consecutive ids, the pins of a cell or all the cells
+  class IdRange {
+   public:
+    class Iterator {
+     public:
+      explicit Iterator(uint32_t id) : m_id(id) {}
+      uint32_t operator*() const { return m_id; }
+      Iterator& operator++() {
+        m_id++;
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const {
+        return m_id != other.m_id;
+      }
+
+     private:
+      uint32_t m_id;
+    };
+    IdRange(uint32_t begin, uint32_t end) : m_begin(begin), m_end(end) {}
+    Iterator begin() const { return Iterator(m_begin); }
+    Iterator end() const { return Iterator(m_end); }
+    uint32_t size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+    uint32_t operator[](uint32_t i) const { return m_begin + i; }
+
+   private:
+    uint32_t m_begin;
+    uint32_t m_end;
+  };
+
+  // View on a slice of an index array, the pins of a net
+  class IdSpan {
+   public:
+    IdSpan(const uint32_t* begin, const uint32_t* end)
+        : m_begin(begin), m_end(end) {}
+    const uint32_t* begin() const { return m_begin; }
+    const uint32_t* end() const { return m_end; }
+    uint32_t size() const { return (uint32_t)(m_end - m_begin); }
+    bool empty() const { return m_begin == m_end; }
+    uint32_t operator[](uint32_t i) const { return m_begin[i]; }
+
+   private:
+    const uint32_t* m_begin;
+    const uint32_t* m_end;
+  };
+
+  Netlist() = default;
+  Netlist(const Netlist&) = delete;
+  Netlist& operator=(const Netlist&) = delete;
+
+  void Reserve(size_t cells, size_t pins, size_t nets);
+  void Clear();
+
+  CellId AddCell(std::string_view name, std::string_view type);
+  // Pins go to the last added cell, kNone for any other cell
+  PinId AddPin(CellId cell, std::string_view name, Direction direction);
+  NetId AddNet(std::string_view name);
+  void Connect(PinId pin, NetId net) {
+    m_pinNet.Set(pin, net);
+    m_finalized = false;
+  }
+  // Builds the net to pins index. Required after connecting pins and
+  // before NetPins() / NetDriver().
+  void Finalize();
+  bool Finalized() const { return m_finalized; }
+
+  size_t CellCount() const { return m_cellType.size(); }
+  size_t PinCount() const { return m_pinCell.size(); }
+  size_t NetCount() const { return m_netName.size(); }
+  IdRange Cells() const { return IdRange(0, (uint32_t)CellCount()); }
+  IdRange Pins() const { return IdRange(0, (uint32_t)PinCount()); }
+  IdRange Nets() const { return IdRange(0, (uint32_t)NetCount()); }
+
+  std::string_view CellName(CellId cell) const {
+    return m_strings.Get(m_cellName[cell]);
+  }
+  // Cell types are interned, equal ids mean equal types
+  uint32_t CellTypeId(CellId cell) const { return m_cellType[cell]; }
+  std::string_view CellType(CellId cell) const {
+    return m_strings.Get(m_cellType[cell]);
+  }
+  IdRange CellPins(CellId cell) const {
+    return IdRange(m_cellPinBegin[cell], m_cellPinBegin[cell + 1]);
+  }
+
+  CellId PinCell(PinId pin) const { return m_pinCell[pin]; }
+  NetId PinNet(PinId pin) const { return m_pinNet[pin]; }
+  Direction PinDirection(PinId pin) const {
+    return (Direction)m_pinDirection[pin];
+  }
+  std::string_view PinName(PinId pin) const {
+    return m_strings.Get(m_pinName[pin]);
+  }
+
+  std::string_view NetName(NetId net) const {
+    return m_strings.Get(m_netName[net]);
+  }
+  IdSpan NetPins(NetId net) const {
+    const uint32_t* pins = m_netPins.data();
+    return IdSpan(pins + m_netPinBegin[net], pins + m_netPinBegin[net + 1]);
+  }
+  // kNone for undriven nets
+  PinId NetDriver(NetId net) const {
+    uint32_t first = m_netPinBegin[net];
+    if (first == m_netPinBegin[net + 1]) return kNone;
+    PinId pin = m_netPins[first];
+    return PinDirection(pin) == Input ? kNone : pin;
+  }
+
+  // Name lookups, the index is built on first use
+  CellId FindCell(std::string_view name) const;
+  NetId FindNet(std::string_view name) const;
+
+  // Heap bytes held by the netlist, names included. Arrays viewed from a
+  // checkpoint are not counted, their pages are shared.
+  size_t MemoryBytes() const;
+
+  // Checkpoint sections netlist.*. The netlist must be finalized.
+  bool Save(CheckpointWriter& writer) const;
+  // Replaces the netlist by a zero-copy view on the checkpoint, kept alive
+  // by the netlist. Modifying the netlist afterwards copies what changes.
+  bool Load(std::shared_ptr<const MappedCheckpoint> checkpoint,
+            std::string& error);
+
+ private:
+  void BuildNameIndex() const;
+
+  StringPool m_strings;
+
+  // Cells
+  MappedArray<uint32_t> m_cellName;
+  MappedArray<uint32_t> m_cellType;
+  MappedArray<uint32_t> m_cellPinBegin{0};  // CellCount() + 1 offsets
+  // Pins
+  MappedArray<CellId> m_pinCell;
+  MappedArray<NetId> m_pinNet;
+  MappedArray<uint32_t> m_pinName;
+  MappedArray<uint8_t> m_pinDirection;
+  // Nets
+  MappedArray<uint32_t> m_netName;
+  MappedArray<uint32_t> m_netPinBegin;  // NetCount() + 1 offsets
+  MappedArray<PinId> m_netPins;
+  bool m_finalized = false;
+  std::shared_ptr<const MappedCheckpoint> m_checkpoint;
+
+  mutable std::mutex m_indexMutex;
+  mutable bool m_indexed = false;
+  mutable std::unordered_map<std::string_view, CellId> m_cellIndex;
+  mutable std::unordered_map<std::string_view, NetId> m_netIndex;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,1806 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/NetlistReader.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+#include "Compiler/MappedFile.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+const char* TextScanner::Find(const char* begin, const char* end, char c) {
+  const char* p = begin;
+#if defined(__AVX2__)
+  const __m256i needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)p);
+    uint32_t mask =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)p);
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == c) return p;
+  }
+  return end;
+}
+
+const char* TextScanner::FindAny(const char* begin, const char* end,
+                                 const char* set) {
+  const size_t count = std::min<size_t>(strlen(set), 4);
+  if (count == 0) return end;
+  // Unused needles repeat the first byte
+  char needles[4];
+  for (size_t i = 0; i < 4; i++) needles[i] = set[i < count ? i : 0];
+  const char* p = begin;
+#if defined(__AVX2__)
+  const __m256i n0 = _mm256_set1_epi8(needles[0]);
+  const __m256i n1 = _mm256_set1_epi8(needles[1]);
+  const __m256i n2 = _mm256_set1_epi8(needles[2]);
+  const __m256i n3 = _mm256_set1_epi8(needles[3]);
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, n0),
+                        _mm256_cmpeq_epi8(block, n1)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, n2),
+                        _mm256_cmpeq_epi8(block, n3)));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  const __m128i n0 = _mm_set1_epi8(needles[0]);
+  const __m128i n1 = _mm_set1_epi8(needles[1]);
+  const __m128i n2 = _mm_set1_epi8(needles[2]);
+  const __m128i n3 = _mm_set1_epi8(needles[3]);
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)p);
+    __m128i hits =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, n0),
+                                  _mm_cmpeq_epi8(block, n1)),
+                     _mm_or_si128(_mm_cmpeq_epi8(block, n2),
+                                  _mm_cmpeq_epi8(block, n3)));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(hits);
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == needles[0] || *p == needles[1] || *p == needles[2] ||
+        *p == needles[3]) {
+      return p;
+    }
+  }
+  return end;
+}
+
+namespace {
+
+const uint8_t kUnknownDirection = 3;
+const uint32_t kOpen = UINT32_MAX;
+
+// Text of a token, relative to the start of its chunk
+struct Span {
+  uint32_t m_offset;
+  uint32_t m_size;
+};
+
+// What the chunk parsers produce. Items are stitched into modules in file
+// order, once all the chunks are parsed.
+enum ItemKind : uint8_t {
+  kModule,    // m_name
+  kPort,      // m_name, m_direction (unknown: position in the header only)
+  kNet,       // m_name, optional m_supply
+  kInstance,  // m_type, m_name (empty for an unnamed primitive)
+  kLut,       // BLIF .names: the inputs, then the output
+  kLatch,     // BLIF .latch: D, Q, optionally the clock
+  kAlias,     // two connections, the first one is driven by the second
+  kRename,    // EBLIF .cname, names the previous instance
+  kBlackbox,
+  kEnd
+};
+
+struct Item {
+  ItemKind m_kind = kEnd;
+  uint8_t m_direction = kUnknownDirection;
+  uint8_t m_supply = 0;  // kNet: 1 for supply0, 2 for supply1
+  bool m_bus = false;
+  int32_t m_msb = 0;
+  int32_t m_lsb = 0;
+  Span m_name{0, 0};
+  Span m_type{0, 0};
+  uint32_t m_firstConnection = 0;
+  uint32_t m_connectionCount = 0;
+  uint64_t m_offset = 0;  // in the file, for the error messages
+};
+
+// Formal (empty if positional) and actual, a range of expression tokens
+struct Connection {
+  Span m_formal;
+  uint32_t m_firstToken;
+  uint32_t m_tokenCount;
+};
+
+struct Chunk {
+  size_t m_source = 0;
+  const char* m_base = nullptr;
+  uint64_t m_offset = 0;  // of m_base in the file
+  size_t m_size = 0;
+  std::vector<Span> m_tokens;
+  std::vector<Item> m_items;
+  std::vector<Connection> m_connections;
+  std::string m_error;
+  uint64_t m_errorOffset = 0;
+
+  std::string_view Text(Span span) const {
+    return std::string_view(m_base + span.m_offset, span.m_size);
+  }
+  Span MakeSpan(const char* begin, const char* end) const {
+    return Span{(uint32_t)(begin - m_base), (uint32_t)(end - begin)};
+  }
+  void Fail(const char* at, const std::string& error) {
+    if (!m_error.empty()) return;
+    m_error = error;
+    m_errorOffset = m_offset + (uint64_t)(at - m_base);
+  }
+  void AddConnection(Span formal, const Span* tokens, size_t count) {
+    m_connections.push_back(
+        Connection{formal, (uint32_t)m_tokens.size(), (uint32_t)count});
+    m_tokens.insert(m_tokens.end(), tokens, tokens + count);
+  }
+};
+
+struct Source {
+  std::string m_path;
+  NetlistReader::Format m_format;
+  MappedFile m_file;
+  std::vector<Chunk> m_chunks;
+};
+
+// "<path>:<line>" of an offset in a source
+std::string Location(const Source& source, uint64_t offset) {
+  const char* p = source.m_file.Data();
+  const char* end = p + std::min<uint64_t>(offset, source.m_file.Size());
+  size_t line = 1;
+  while ((p = TextScanner::Find(p, end, '\n')) < end) {
+    line++;
+    p++;
+  }
+  return source.m_path + ":" + std::to_string(line);
+}
+
+bool IsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool IsSpace(char c) { return IsBlank(c) || c == '\n'; }
+
+// ---------------------------------------------------------------------------
+// BLIF
+
+// Chunks start on the lines opening a model or a cell, never on a
+// continuation line nor on the .cname / .param / .attr lines that follow a
+// cell
+bool BlifStatementStart(const char* data, const char* line,
+                        const char* first, const char* end) {
+  if (first >= end || *first != '.') return false;
+  std::string_view rest(first + 1, std::min<size_t>(end - first - 1, 8));
+  bool opening = false;
+  for (std::string_view keyword : {"model", "names", "subckt", "gate",
+                                   "latch"}) {
+    if (rest.substr(0, keyword.size()) == keyword &&
+        (rest.size() == keyword.size() || IsSpace(rest[keyword.size()]))) {
+      opening = true;
+    }
+  }
+  if (!opening) return false;
+  // line[-1] is the end of the previous line
+  const char* last = line - 1;
+  while (last > data && IsBlank(last[-1])) last--;
+  return !(last > data && last[-1] == '\\');
+}
+
+size_t NextBlifBoundary(const char* data, size_t size, size_t from) {
+  const char* end = data + size;
+  const char* p = data + from;
+  for (;;) {
+    const char* newline = TextScanner::Find(p, end, '\n');
+    if (end - newline <= 1) return size;
+    const char* line = newline + 1;
+    const char* first = line;
+    while (first < end && IsBlank(*first)) first++;
+    if (BlifStatementStart(data, line, first, end)) return line - data;
+    p = line;
+  }
+}
+
+void ParseBlifChunk(Chunk& chunk) {
+  const char* p = chunk.m_base;
+  const char* end = p + chunk.m_size;
+  std::vector<Span> line;
+  bool cover = false;  // the truth table lines of a .names
+  while (p < end && chunk.m_error.empty()) {
+    // Logical line: comments removed, continuations joined
+    line.clear();
+    const char* statement = p;
+    bool continued = true;
+    while (continued && p < end) {
+      const char* newline = TextScanner::Find(p, end, '\n');
+      const char* stop = TextScanner::Find(p, newline, '#');
+      const char* last = stop;
+      while (last > p && IsBlank(last[-1])) last--;
+      continued = (stop == newline && last > p && last[-1] == '\\');
+      if (continued) last--;
+      for (const char* q = p; q < last;) {
+        while (q < last && IsBlank(*q)) q++;
+        const char* start = q;
+        while (q < last && !IsBlank(*q)) q++;
+        if (q > start) line.push_back(chunk.MakeSpan(start, q));
+      }
+      p = (newline < end) ? newline + 1 : end;
+    }
+    if (line.empty()) continue;
+
+    std::string_view keyword = chunk.Text(line[0]);
+    if (keyword[0] != '.') {
+      if (!cover) {
+        chunk.Fail(statement, "unexpected '" + std::string(keyword) + "'");
+      }
+      continue;
+    }
+    cover = false;
+    Item item;
+    item.m_offset = chunk.m_offset + (uint64_t)(statement - chunk.m_base);
+    item.m_firstConnection = (uint32_t)chunk.m_connections.size();
+    const size_t count = line.size();
+    if (keyword == ".model") {
+      if (count < 2) return chunk.Fail(statement, "missing model name");
+      item.m_kind = kModule;
+      item.m_name = line[1];
+    } else if (keyword == ".inputs" || keyword == ".outputs") {
+      item.m_kind = kPort;
+      item.m_direction =
+          (keyword == ".inputs") ? Netlist::Input : Netlist::Output;
+      for (size_t i = 1; i < count; i++) {
+        item.m_name = line[i];
+        chunk.m_items.push_back(item);
+      }
+      continue;
+    } else if (keyword == ".names") {
+      if (count < 2) return chunk.Fail(statement, ".names without output");
+      item.m_kind = kLut;
+      for (size_t i = 1; i < count; i++) {
+        chunk.AddConnection(Span{0, 0}, &line[i], 1);
+      }
+      cover = true;
+    } else if (keyword == ".latch") {
+      // .latch <input> <output> [<type> <control>] [<init>]
+      if (count < 3) return chunk.Fail(statement, ".latch needs 2 nets");
+      item.m_kind = kLatch;
+      chunk.AddConnection(Span{0, 0}, &line[1], 1);
+      chunk.AddConnection(Span{0, 0}, &line[2], 1);
+      if (count >= 5) {
+        item.m_type = line[3];
+        if (chunk.Text(line[4]) != "NIL") {
+          chunk.AddConnection(Span{0, 0}, &line[4], 1);
+        }
+      }
+    } else if (keyword == ".subckt" || keyword == ".gate") {
+      if (count < 2) return chunk.Fail(statement, "missing cell type");
+      item.m_kind = kInstance;
+      item.m_type = line[1];
+      for (size_t i = 2; i < count; i++) {
+        std::string_view text = chunk.Text(line[i]);
+        size_t equal = text.find('=');
+        if (equal == std::string_view::npos) {
+          return chunk.Fail(statement, "expected <formal>=<actual>, got '" +
+                                           std::string(text) + "'");
+        }
+        Span formal{line[i].m_offset, (uint32_t)equal};
+        Span actual{line[i].m_offset + (uint32_t)equal + 1,
+                    line[i].m_size - (uint32_t)equal - 1};
+        chunk.AddConnection(formal, &actual, actual.m_size ? 1 : 0);
+      }
+    } else if (keyword == ".conn") {
+      // .conn <driver> <driven>
+      if (count != 3) return chunk.Fail(statement, ".conn needs 2 nets");
+      item.m_kind = kAlias;
+      chunk.AddConnection(Span{0, 0}, &line[2], 1);
+      chunk.AddConnection(Span{0, 0}, &line[1], 1);
+    } else if (keyword == ".cname") {
+      if (count < 2) return chunk.Fail(statement, "missing cell name");
+      item.m_kind = kRename;
+      item.m_name = line[1];
+    } else if (keyword == ".blackbox") {
+      item.m_kind = kBlackbox;
+    } else if (keyword == ".end") {
+      item.m_kind = kEnd;
+    } else if (keyword == ".exdc") {
+      return chunk.Fail(statement, ".exdc networks are not supported");
+    } else {
+      // .param, .attr, .clock, .default_input_arrival... do not change the
+      // connectivity
+      continue;
+    }
+    item.m_connectionCount =
+        (uint32_t)chunk.m_connections.size() - item.m_firstConnection;
+    chunk.m_items.push_back(item);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Verilog
+
+const char* EndOfBlockComment(const char* p, const char* end) {
+  for (;;) {
+    p = TextScanner::Find(p, end, '*');
+    if (end - p <= 1) return end;
+    if (p[1] == '/') return p + 2;
+    p++;
+  }
+}
+
+const char* EndOfString(const char* p, const char* end) {
+  for (;;) {
+    p = TextScanner::FindAny(p, end, "\"\\");
+    if (p == end) return end;
+    if (*p == '"') return p + 1;
+    p = std::min(p + 2, end);
+  }
+}
+
+const char* EndOfEscapedIdentifier(const char* p, const char* end) {
+  while (p < end && !isspace((unsigned char)*p)) p++;
+  return p;
+}
+
+// Offset past the first ';' at or after from that is code, not part of a
+// comment, a string or an escaped identifier. scan is where the previous
+// search stopped, in code: comments opened before from are skipped whole.
+size_t NextVerilogBoundary(const char* data, size_t size, size_t& scan,
+                           size_t from) {
+  const char* end = data + size;
+  const char* target = data + from;
+  const char* p = data + scan;
+  for (;;) {
+    // Statement ends only matter past target, before it only the constructs
+    // that could hide one are looked for
+    const bool past = p >= target;
+    const char* limit = past ? end : target;
+    const char* hit =
+        TextScanner::FindAny(p, limit, past ? "/\"\\;" : "/\"\\");
+    if (hit == limit) {
+      if (past) break;
+      p = target;
+      continue;
+    }
+    switch (*hit) {
+      case ';':
+        scan = hit + 1 - data;
+        return scan;
+      case '/':
+        if (end - hit > 1 && hit[1] == '/') {
+          p = TextScanner::Find(hit, end, '\n');
+        } else if (end - hit > 1 && hit[1] == '*') {
+          p = EndOfBlockComment(hit + 2, end);
+        } else {
+          p = hit + 1;
+        }
+        break;
+      case '"':
+        p = EndOfString(hit + 1, end);
+        break;
+      default:
+        p = EndOfEscapedIdentifier(hit + 1, end);
+        break;
+    }
+  }
+  scan = size;
+  return size;
+}
+
+bool IsIdentifierStart(char c) {
+  return isalpha((unsigned char)c) || c == '_' || c == '$';
+}
+
+bool IsIdentifierChar(char c) {
+  return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+bool IsDigitChar(char c) {
+  return isxdigit((unsigned char)c) || c == '_' || c == 'x' || c == 'X' ||
+         c == 'z' || c == 'Z' || c == '?';
+}
+
+// Tokens of the next statement, up to and including its ';' or a lone
+// endmodule. Escaped identifiers keep their backslash, which tells them
+// from punctuation. False once the chunk is exhausted.
+bool LexVerilogStatement(const Chunk& chunk, const char*& p, const char* end,
+                         std::vector<Span>& tokens) {
+  tokens.clear();
+  while (p < end) {
+    const char c = *p;
+    const char* start = p;
+    if (isspace((unsigned char)c)) {
+      p++;
+    } else if (c == '/' && end - p > 1 && p[1] == '/') {
+      p = TextScanner::Find(p, end, '\n');
+    } else if (c == '/' && end - p > 1 && p[1] == '*') {
+      p = EndOfBlockComment(p + 2, end);
+    } else if (c == '(' && end - p > 2 && p[1] == '*' && p[2] != ')') {
+      // Attribute (* ... *)
+      for (p += 2;; p++) {
+        p = TextScanner::Find(p, end, '*');
+        if (end - p <= 1) {
+          p = end;
+          break;
+        }
+        if (p[1] == ')') {
+          p += 2;
+          break;
+        }
+      }
+    } else if (c == '`') {
+      p = TextScanner::Find(p, end, '\n');
+    } else if (c == '"') {
+      p = EndOfString(p + 1, end);
+      tokens.push_back(chunk.MakeSpan(start, p));
+    } else if (c == '\\') {
+      p = EndOfEscapedIdentifier(p + 1, end);
+      tokens.push_back(chunk.MakeSpan(start, p));
+    } else if (IsIdentifierStart(c)) {
+      while (p < end && IsIdentifierChar(*p)) p++;
+      tokens.push_back(chunk.MakeSpan(start, p));
+      if (tokens.size() == 1 && chunk.Text(tokens[0]) == "endmodule") {
+        return true;
+      }
+    } else if (isdigit((unsigned char)c) || c == '\'') {
+      // 12, 4'b10x1, 8'shFF, 'h0, also with blanks around the quote
+      while (p < end && (isdigit((unsigned char)*p) || *p == '_')) p++;
+      const char* quote = p;
+      while (quote < end && IsBlank(*quote)) quote++;
+      if (quote < end && *quote == '\'') {
+        p = quote + 1;
+        if (p < end && (*p == 's' || *p == 'S')) p++;
+        if (p < end && isalpha((unsigned char)*p)) p++;
+        while (p < end && IsBlank(*p)) p++;
+        while (p < end && IsDigitChar(*p)) p++;
+      }
+      tokens.push_back(chunk.MakeSpan(start, p));
+    } else {
+      p++;
+      tokens.push_back(chunk.MakeSpan(start, p));
+      if (c == ';') return true;
+    }
+  }
+  return !tokens.empty();
+}
+
+// Parser of one lexed statement, appends items to the chunk
+class VerilogStatement {
+ public:
+  VerilogStatement(Chunk& chunk, const std::vector<Span>& tokens)
+      : m_chunk(chunk), m_tokens(tokens) {}
+
+  void Parse() {
+    std::string_view keyword = Text(0);
+    if (keyword == "endmodule") {
+      m_chunk.m_items.push_back(NewItem(kEnd));
+    } else if (keyword == "module" || keyword == "macromodule") {
+      ParseModule();
+    } else if (keyword == "input" || keyword == "output" ||
+               keyword == "inout") {
+      Item port = NewItem(kPort);
+      port.m_direction = (keyword == "input")    ? Netlist::Input
+                         : (keyword == "output") ? Netlist::Output
+                                                 : Netlist::InOut;
+      ParseDeclaration(port);
+    } else if (keyword == "wire" || keyword == "tri" || keyword == "wand" ||
+               keyword == "wor" || keyword == "reg" || keyword == "logic" ||
+               keyword == "uwire" || keyword == "tri0" ||
+               keyword == "tri1" || keyword == "supply0" ||
+               keyword == "supply1") {
+      Item net = NewItem(kNet);
+      if (keyword == "supply0") net.m_supply = 1;
+      if (keyword == "supply1") net.m_supply = 2;
+      ParseDeclaration(net);
+    } else if (keyword == "assign") {
+      ParseAssign();
+    } else if (keyword == ";" || keyword == "parameter" ||
+               keyword == "localparam" || keyword == "defparam" ||
+               keyword == "specparam" || keyword == "genvar" ||
+               keyword == "timeunit" || keyword == "timeprecision") {
+      // No connectivity
+    } else if (keyword == "always" || keyword == "always_ff" ||
+               keyword == "always_comb" || keyword == "always_latch" ||
+               keyword == "initial" || keyword == "function" ||
+               keyword == "task" || keyword == "generate" ||
+               keyword == "begin" || keyword == "if" || keyword == "for" ||
+               keyword == "case" || keyword == "primitive" ||
+               keyword == "specify") {
+      Fail("'" + std::string(keyword) +
+           "' is not supported, expected a structural netlist");
+    } else if (IsIdentifier(0)) {
+      ParseInstance();
+    } else {
+      Fail("unexpected '" + std::string(keyword) + "'");
+    }
+  }
+
+ private:
+  std::string_view Text(size_t i) const {
+    return (i < m_tokens.size()) ? m_chunk.Text(m_tokens[i])
+                                 : std::string_view();
+  }
+  bool Is(size_t i, std::string_view text) const { return Text(i) == text; }
+  bool IsIdentifier(size_t i) const {
+    std::string_view text = Text(i);
+    return !text.empty() && (IsIdentifierStart(text[0]) || text[0] == '\\');
+  }
+  // Identifier without the backslash of an escaped one
+  Span Name(size_t i) const {
+    Span span = m_tokens[i];
+    if (Text(i)[0] == '\\') {
+      span.m_offset++;
+      span.m_size--;
+    }
+    return span;
+  }
+  bool Fail(const std::string& error) {
+    size_t at = std::min(m_i, m_tokens.size() - 1);
+    m_chunk.Fail(m_chunk.m_base + m_tokens[at].m_offset, error);
+    return false;
+  }
+  Item NewItem(ItemKind kind) const {
+    Item item;
+    item.m_kind = kind;
+    item.m_offset = m_chunk.m_offset + m_tokens[0].m_offset;
+    item.m_firstConnection = (uint32_t)m_chunk.m_connections.size();
+    return item;
+  }
+  // Index of the bracket closing the one at open, npos if unbalanced
+  size_t GroupEnd(size_t open) const {
+    int depth = 0;
+    for (size_t i = open; i < m_tokens.size(); i++) {
+      std::string_view text = Text(i);
+      if (text.size() != 1) continue;
+      if (text[0] == '(' || text[0] == '[' || text[0] == '{') depth++;
+      if (text[0] == ')' || text[0] == ']' || text[0] == '}') {
+        if (--depth == 0) return i;
+      }
+    }
+    return std::string_view::npos;
+  }
+  // First token at bracket depth 0 that is one of stops
+  size_t ExpressionEnd(size_t from, std::string_view stops) const {
+    int depth = 0;
+    for (size_t i = from; i < m_tokens.size(); i++) {
+      std::string_view text = Text(i);
+      if (text.size() != 1) continue;
+      if (depth == 0 && stops.find(text[0]) != std::string_view::npos) {
+        return i;
+      }
+      if (text[0] == '(' || text[0] == '[' || text[0] == '{') depth++;
+      if (text[0] == ')' || text[0] == ']' || text[0] == '}') depth--;
+    }
+    return m_tokens.size();
+  }
+  void SkipNetKeywords() {
+    while (Is(m_i, "wire") || Is(m_i, "reg") || Is(m_i, "logic") ||
+           Is(m_i, "signed") || Is(m_i, "unsigned") || Is(m_i, "tri") ||
+           Is(m_i, "var") || Is(m_i, "scalared") || Is(m_i, "vectored")) {
+      m_i++;
+    }
+  }
+  bool ParseInteger(int32_t& value) {
+    bool negative = Is(m_i, "-");
+    if (negative) m_i++;
+    std::string_view text = Text(m_i);
+    if (text.empty() || !isdigit((unsigned char)text[0]) ||
+        text.find('\'') != std::string_view::npos) {
+      return Fail("unsupported range expression");
+    }
+    value = 0;
+    for (char c : text) {
+      if (c != '_') value = value * 10 + (c - '0');
+    }
+    if (negative) value = -value;
+    m_i++;
+    return true;
+  }
+  // [ msb : lsb ]
+  bool ParseRange(Item& item) {
+    m_i++;
+    if (!ParseInteger(item.m_msb)) return false;
+    if (!Is(m_i++, ":")) return Fail("expected ':' in range");
+    if (!ParseInteger(item.m_lsb)) return false;
+    if (!Is(m_i++, "]")) return Fail("expected ']'");
+    item.m_bus = true;
+    return true;
+  }
+  void AddConnection(Span formal, size_t from, size_t to) {
+    m_chunk.AddConnection(formal, m_tokens.data() + from, to - from);
+  }
+
+  // module <name> [#(...)] [(<ports>)] ;
+  bool ParseModule() {
+    m_i = 1;
+    if (!IsIdentifier(m_i)) return Fail("missing module name");
+    Item module = NewItem(kModule);
+    module.m_name = Name(m_i++);
+    m_chunk.m_items.push_back(module);
+    if (Is(m_i, "#")) {
+      size_t close = GroupEnd(++m_i);
+      if (!Is(m_i, "(") || close == std::string_view::npos) {
+        return Fail("malformed parameter list");
+      }
+      m_i = close + 1;
+    }
+    if (Is(m_i, "(")) {
+      size_t close = GroupEnd(m_i++);
+      if (close == std::string_view::npos) return Fail("unbalanced '('");
+      // ANSI ports inherit the direction and range of the previous one
+      Item port = NewItem(kPort);
+      while (m_i < close) {
+        if (Is(m_i, "input") || Is(m_i, "output") || Is(m_i, "inout")) {
+          port.m_direction = Is(m_i, "input")    ? Netlist::Input
+                             : Is(m_i, "output") ? Netlist::Output
+                                                 : Netlist::InOut;
+          m_i++;
+          port.m_bus = false;
+          SkipNetKeywords();
+          if (Is(m_i, "[") && !ParseRange(port)) return false;
+        }
+        if (Is(m_i, ".")) return Fail("port expressions are not supported");
+        if (!IsIdentifier(m_i)) return Fail("expected a port name");
+        port.m_name = Name(m_i++);
+        m_chunk.m_items.push_back(port);
+        if (Is(m_i, ",")) {
+          m_i++;
+        } else if (m_i != close) {
+          return Fail("expected ',' in port list");
+        }
+      }
+      m_i = close + 1;
+    }
+    if (!Is(m_i, ";")) return Fail("expected ';' after module header");
+    return true;
+  }
+
+  // <keyword> [<keywords>] [range] <name> [= <expression>], ... ;
+  bool ParseDeclaration(Item declaration) {
+    m_i = 1;
+    SkipNetKeywords();
+    if (Is(m_i, "[") && !ParseRange(declaration)) return false;
+    if (Is(m_i, "#")) m_i += 2;  // delay
+    for (;;) {
+      if (!IsIdentifier(m_i)) return Fail("expected a name");
+      const size_t name = m_i;
+      Item item = declaration;
+      item.m_name = Name(m_i++);
+      if (Is(m_i, "[")) return Fail("arrays are not supported");
+      m_chunk.m_items.push_back(item);
+      if (Is(m_i, "=")) {
+        size_t end = ExpressionEnd(++m_i, ",;");
+        Item alias = NewItem(kAlias);
+        AddConnection(Span{0, 0}, name, name + 1);
+        AddConnection(Span{0, 0}, m_i, end);
+        alias.m_connectionCount = 2;
+        m_chunk.m_items.push_back(alias);
+        m_i = end;
+      }
+      if (Is(m_i, ";")) return true;
+      if (!Is(m_i++, ",")) return Fail("expected ',' or ';'");
+    }
+  }
+
+  // assign [#<delay>] <lhs> = <rhs>, ... ;
+  bool ParseAssign() {
+    m_i = 1;
+    if (Is(m_i, "#")) m_i += 2;
+    for (;;) {
+      size_t equal = ExpressionEnd(m_i, "=;");
+      if (!Is(equal, "=")) return Fail("expected '='");
+      size_t end = ExpressionEnd(equal + 1, ",;");
+      Item alias = NewItem(kAlias);
+      AddConnection(Span{0, 0}, m_i, equal);
+      AddConnection(Span{0, 0}, equal + 1, end);
+      alias.m_connectionCount = 2;
+      m_chunk.m_items.push_back(alias);
+      m_i = end;
+      if (Is(m_i, ";")) return true;
+      if (!Is(m_i++, ",")) return Fail("expected ',' or ';'");
+    }
+  }
+
+  // <type> [#(...)] [<name>] (<connections>) [, [<name>] (...)] ;
+  bool ParseInstance() {
+    const Span type = Name(0);
+    m_i = 1;
+    if (Is(m_i, "#")) {
+      m_i++;
+      if (Is(m_i, "(")) {
+        size_t close = GroupEnd(m_i);
+        if (close == std::string_view::npos) return Fail("unbalanced '('");
+        m_i = close + 1;
+      } else {
+        m_i++;  // delay
+      }
+    }
+    for (;;) {
+      Item instance = NewItem(kInstance);
+      instance.m_type = type;
+      if (IsIdentifier(m_i)) instance.m_name = Name(m_i++);
+      if (Is(m_i, "[")) return Fail("instance arrays are not supported");
+      if (!Is(m_i, "(")) return Fail("expected '(' after instance name");
+      const size_t close = GroupEnd(m_i++);
+      if (close == std::string_view::npos) return Fail("unbalanced '('");
+      while (m_i < close) {
+        if (Is(m_i, ".")) {
+          if (!IsIdentifier(m_i + 1) || !Is(m_i + 2, "(")) {
+            return Fail("expected .<port>(<expression>)");
+          }
+          size_t open = m_i + 2;
+          size_t end = GroupEnd(open);
+          AddConnection(Name(m_i + 1), open + 1, end);
+          m_i = end + 1;
+        } else {
+          size_t end = ExpressionEnd(m_i, ",)");
+          AddConnection(Span{0, 0}, m_i, end);
+          m_i = end;
+        }
+        if (m_i >= close) break;
+        if (!Is(m_i++, ",")) return Fail("expected ',' between connections");
+        // Trailing empty positional connection
+        if (m_i == close) AddConnection(Span{0, 0}, m_i, m_i);
+      }
+      m_i = close + 1;
+      instance.m_connectionCount =
+          (uint32_t)m_chunk.m_connections.size() - instance.m_firstConnection;
+      m_chunk.m_items.push_back(instance);
+      if (Is(m_i, ";")) return true;
+      if (!Is(m_i++, ",")) return Fail("expected ';' after instance");
+    }
+  }
+
+  Chunk& m_chunk;
+  const std::vector<Span>& m_tokens;
+  size_t m_i = 0;
+};
+
+void ParseVerilogChunk(Chunk& chunk) {
+  const char* p = chunk.m_base;
+  const char* end = p + chunk.m_size;
+  std::vector<Span> tokens;
+  while (chunk.m_error.empty() &&
+         LexVerilogStatement(chunk, p, end, tokens)) {
+    VerilogStatement(chunk, tokens).Parse();
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Elaboration
+
+struct ItemRef {
+  const Chunk* m_chunk;
+  const Item* m_item;
+};
+
+struct PortDef {
+  std::string_view m_name;
+  uint8_t m_direction = kUnknownDirection;
+  bool m_bus = false;
+  int32_t m_msb = 0;
+  int32_t m_lsb = 0;
+};
+
+struct ModuleDef {
+  std::string_view m_name;
+  const Source* m_source = nullptr;
+  uint64_t m_offset = 0;
+  bool m_verilog = false;
+  bool m_blackbox = false;
+  bool m_instantiated = false;
+  std::vector<std::string_view> m_portOrder;
+  std::unordered_map<std::string_view, PortDef> m_ports;
+  // Declared ranges of the ports and nets, for the whole-bus references
+  std::unordered_map<std::string_view, std::pair<int32_t, int32_t>> m_buses;
+  std::vector<ItemRef> m_body;
+};
+
+// Bits of a bus, most significant first, as names "<bus>[<index>]"
+void BusBitNames(std::string_view name, int32_t msb, int32_t lsb,
+                 std::vector<std::string>& names) {
+  const int32_t step = (msb >= lsb) ? -1 : 1;
+  for (int32_t i = msb;; i += step) {
+    names.push_back(std::string(name) + "[" + std::to_string(i) + "]");
+    if (i == lsb) break;
+  }
+}
+
+// Output pin names of the usual cell libraries
+Netlist::Direction GuessDirection(std::string_view pin) {
+  std::string base(pin.substr(0, pin.find('[')));
+  for (char& c : base) c = (char)toupper((unsigned char)c);
+  static const char* kOutputs[] = {"Q",   "QN", "Y",   "YN",   "Z",
+                                   "ZN",  "O",  "ON",  "OUT",  "CO",
+                                   "SUM", "DO", "DOUT", "RDATA"};
+  for (const char* output : kOutputs) {
+    if (base == output) return Netlist::Output;
+  }
+  if (base.compare(0, 3, "OUT") == 0 || base.compare(0, 4, "DOUT") == 0) {
+    return Netlist::Output;
+  }
+  // Q0, O6...
+  if (base.size() > 1 && (base[0] == 'Q' || base[0] == 'O') &&
+      std::all_of(base.begin() + 1, base.end(),
+                  [](char c) { return isdigit((unsigned char)c); })) {
+    return Netlist::Output;
+  }
+  return Netlist::Input;
+}
+
+bool IsPrimitive(std::string_view type) {
+  for (std::string_view primitive :
+       {"and", "nand", "or", "nor", "xor", "xnor", "buf", "not", "bufif0",
+        "bufif1", "notif0", "notif1"}) {
+    if (type == primitive) return true;
+  }
+  return false;
+}
+
+// Terminals of the Verilog gate primitives: outputs first, then inputs
+void PrimitivePin(std::string_view type, size_t index, size_t count,
+                  std::string& name, Netlist::Direction& direction) {
+  direction = Netlist::Input;
+  if (type == "buf" || type == "not") {
+    if (index + 1 == count) {
+      name = "A";
+    } else {
+      name = (index == 0) ? "Y" : "Y" + std::to_string(index);
+      direction = Netlist::Output;
+    }
+  } else if (type.substr(0, 5) == "bufif" || type.substr(0, 5) == "notif") {
+    name = (index == 0) ? "Y" : (index == 1) ? "A" : "EN";
+    if (index == 0) direction = Netlist::Output;
+  } else if (index == 0) {
+    name = "Y";
+    direction = Netlist::Output;
+  } else {
+    name = "A" + std::to_string(index - 1);
+  }
+}
+
+// Constant bits, most significant first: 0, 1 or -1 for x / z. Unsized
+// literals take the width of their value.
+bool DecodeConstant(std::string_view token, std::vector<int>& bits) {
+  std::string text;
+  for (char c : token) {
+    if (c != '_' && !IsBlank(c)) text += c;
+  }
+  bits.clear();
+  size_t quote = text.find('\'');
+  if (quote == std::string::npos) {
+    uint64_t value = std::strtoull(text.c_str(), nullptr, 10);
+    do {
+      bits.insert(bits.begin(), (int)(value & 1));
+      value >>= 1;
+    } while (value);
+    return true;
+  }
+  long width = (quote > 0) ? std::atol(text.substr(0, quote).c_str()) : 0;
+  size_t base = quote + 1;
+  if (base < text.size() && (text[base] == 's' || text[base] == 'S')) base++;
+  if (base >= text.size()) return false;
+  const char radix = (char)tolower((unsigned char)text[base]);
+  const std::string digits = text.substr(base + 1);
+  if (digits.empty()) return false;
+  if (radix == 'd') {
+    if (digits.find_first_not_of("0123456789") != std::string::npos) {
+      bits.assign(width ? width : 1, -1);
+      return true;
+    }
+    uint64_t value = std::strtoull(digits.c_str(), nullptr, 10);
+    do {
+      bits.insert(bits.begin(), (int)(value & 1));
+      value >>= 1;
+    } while (value);
+  } else {
+    const int digitBits = (radix == 'b') ? 1 : (radix == 'o') ? 3 : 4;
+    if (radix != 'b' && radix != 'o' && radix != 'h') return false;
+    for (char c : digits) {
+      int value = 0;
+      if (c == 'x' || c == 'X' || c == 'z' || c == 'Z' || c == '?') {
+        value = -1;
+      } else if (isdigit((unsigned char)c)) {
+        value = c - '0';
+      } else if (isxdigit((unsigned char)c)) {
+        value = tolower((unsigned char)c) - 'a' + 10;
+      }
+      if (value >= (1 << digitBits)) return false;
+      for (int bit = digitBits - 1; bit >= 0; bit--) {
+        bits.push_back(value < 0 ? -1 : (value >> bit) & 1);
+      }
+    }
+  }
+  if (width <= 0) return true;
+  if (width > (1 << 20)) return false;
+  if ((size_t)width < bits.size()) {
+    bits.erase(bits.begin(), bits.end() - width);
+  } else {
+    bits.insert(bits.begin(), width - bits.size(), 0);
+  }
+  return true;
+}
+
+// Open addressing map from names to ids, names are not copied. A lookup is
+// usually a single cache miss, where std::unordered_map chases a node.
+class NameTable {
+ public:
+  static uint64_t Hash(std::string_view name) {
+    return std::hash<std::string_view>()(name);
+  }
+  void Reserve(size_t count) {
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+    if (capacity > m_slots.size()) Rehash(capacity);
+  }
+  // kOpen if absent
+  uint32_t Find(std::string_view name, uint64_t hash) const {
+    if (m_slots.empty()) return kOpen;
+    for (size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+      const Slot& slot = m_slots[i];
+      if (slot.m_id == kOpen) return kOpen;
+      if (slot.m_hash == hash && slot.m_size == name.size() &&
+          memcmp(slot.m_data, name.data(), name.size()) == 0) {
+        return slot.m_id;
+      }
+    }
+  }
+  // Inserts or replaces
+  void Set(std::string_view name, uint64_t hash, uint32_t id) {
+    if ((m_count + 1) * 2 > m_slots.size()) {
+      Rehash(std::max<size_t>(16, m_slots.size() * 2));
+    }
+    for (size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+      Slot& slot = m_slots[i];
+      if (slot.m_id == kOpen) {
+        slot = Slot{hash, name.data(), (uint32_t)name.size(), id};
+        m_count++;
+        return;
+      }
+      if (slot.m_hash == hash && slot.m_size == name.size() &&
+          memcmp(slot.m_data, name.data(), name.size()) == 0) {
+        slot.m_id = id;
+        return;
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint64_t m_hash;
+    const char* m_data;
+    uint32_t m_size;
+    uint32_t m_id;
+  };
+  void Rehash(size_t capacity) {
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    m_slots.assign(capacity, Slot{0, nullptr, 0, kOpen});
+    m_mask = capacity - 1;
+    m_count = 0;
+    for (const Slot& slot : old) {
+      if (slot.m_id != kOpen) {
+        Set(std::string_view(slot.m_data, slot.m_size), slot.m_hash,
+            slot.m_id);
+      }
+    }
+  }
+  std::vector<Slot> m_slots;
+  size_t m_mask = 0;
+  size_t m_count = 0;
+};
+
+// Flattens the top module into the netlist. Nets are first collected in a
+// union-find, so that assigns and .conn merge nets instead of adding
+// buffers; the Netlist only gets the surviving nets, once everything is
+// connected.
+class Elaborator {
+ public:
+  typedef std::unordered_map<std::string_view, ModuleDef*> ModuleMap;
+  typedef std::map<std::string, std::map<std::string, Netlist::Direction>>
+      DirectionMap;
+
+  Elaborator(Netlist& netlist, const ModuleMap& modules,
+             const DirectionMap& directions, const CancellationToken& cancel,
+             size_t expectedNets)
+      : m_expectedNets(expectedNets),
+        m_netlist(netlist),
+        m_modules(modules),
+        m_directions(directions),
+        m_cancel(cancel) {}
+
+  bool Run(const ModuleDef& top, std::string& error) {
+    Scope scope;
+    scope.m_module = &top;
+    scope.m_nets.Reserve(m_expectedNets);
+    m_netNames.reserve(m_expectedNets);
+    m_netParent.reserve(m_expectedNets);
+    m_netRank.reserve(m_expectedNets);
+    std::vector<std::string> bits;
+    for (std::string_view name : top.m_portOrder) {
+      const PortDef& port = top.m_ports.at(name);
+      // The cell of an input port drives its net, the one of an output
+      // port is a sink
+      static const char* kPortTypes[] = {"$input", "$output", "$inout"};
+      static const char* kPortPins[] = {"Y", "A", "Y"};
+      static const Netlist::Direction kPinDirections[] = {
+          Netlist::Output, Netlist::Input, Netlist::InOut};
+      if (port.m_direction == kUnknownDirection) {
+        error = Location(*top.m_source, top.m_offset) + ": port " +
+                std::string(name) + " of " + std::string(top.m_name) +
+                " has no direction";
+        return false;
+      }
+      bits.clear();
+      if (port.m_bus) {
+        BusBitNames(name, port.m_msb, port.m_lsb, bits);
+      } else {
+        bits.push_back(std::string(name));
+      }
+      for (const std::string& bit : bits) {
+        Netlist::CellId cell =
+            m_netlist.AddCell(bit, kPortTypes[port.m_direction]);
+        uint32_t net = Net(scope, bit, false);
+        m_netRank[net] = 2;
+        AddPin(cell, kPortPins[port.m_direction],
+               kPinDirections[port.m_direction], net);
+      }
+    }
+    if (!Elaborate(scope, 0)) {
+      error = m_error;
+      return false;
+    }
+
+    for (int value = 0; value < 2; value++) {
+      if (m_constants[value] == kOpen) continue;
+      Netlist::CellId cell = m_netlist.AddCell(
+          value ? "$true" : "$false", value ? "$const1" : "$const0");
+      AddPin(cell, "Y", Netlist::Output, m_constants[value]);
+    }
+    std::vector<Netlist::NetId> nets(m_netNames.size(), Netlist::kNone);
+    for (Netlist::PinId pin = 0; pin < m_pinNets.size(); pin++) {
+      if (m_pinNets[pin] == kOpen) continue;
+      uint32_t root = Find(m_pinNets[pin]);
+      if (nets[root] == Netlist::kNone) {
+        nets[root] = m_netlist.AddNet(m_netNames[root]);
+      }
+      m_netlist.Connect(pin, nets[root]);
+    }
+    m_netlist.Finalize();
+    return true;
+  }
+
+ private:
+  struct Scope {
+    const ModuleDef* m_module = nullptr;
+    std::string m_prefix;  // "<instance>/" of every level
+    NameTable m_nets;
+  };
+
+  bool Fail(const ItemRef& ref, const std::string& error) {
+    if (m_error.empty()) {
+      const ModuleDef& module = *m_current;
+      m_error = Location(*module.m_source, ref.m_item->m_offset) + ": " + error;
+    }
+    return false;
+  }
+
+  std::string_view Store(std::string_view text) {
+    char* copy = (char*)m_arena.Allocate(text.size(), 1);
+    memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+  }
+
+  uint32_t NewNet(std::string_view name, uint8_t rank) {
+    m_netNames.push_back(name);
+    m_netParent.push_back((uint32_t)m_netParent.size());
+    m_netRank.push_back(rank);
+    return (uint32_t)m_netParent.size() - 1;
+  }
+
+  // Net of a local name, stable names point into the mapped files
+  uint32_t Net(Scope& scope, std::string_view name, bool stable) {
+    const uint64_t hash = NameTable::Hash(name);
+    uint32_t found = scope.m_nets.Find(name, hash);
+    if (found != kOpen) return found;
+    std::string_view key = stable ? name : Store(name);
+    uint32_t net =
+        scope.m_prefix.empty()
+            ? NewNet(key, 1)
+            : NewNet(Store(scope.m_prefix + std::string(name)), 0);
+    scope.m_nets.Set(key, hash, net);
+    return net;
+  }
+
+  uint32_t Constant(int value) {
+    if (value < 0) return kOpen;
+    if (m_constants[value] == kOpen) {
+      m_constants[value] = NewNet(value ? "$true" : "$false", 3);
+    }
+    return m_constants[value];
+  }
+
+  uint32_t Find(uint32_t net) {
+    while (m_netParent[net] != net) {
+      m_netParent[net] = m_netParent[m_netParent[net]];
+      net = m_netParent[net];
+    }
+    return net;
+  }
+
+  // The name of the driver wins, unless the driven net is a port or a
+  // constant or sits higher in the hierarchy
+  void Union(uint32_t driven, uint32_t driver) {
+    if (driven == kOpen || driver == kOpen) return;
+    driven = Find(driven);
+    driver = Find(driver);
+    if (driven == driver) return;
+    if (m_netRank[driven] > m_netRank[driver]) {
+      m_netParent[driver] = driven;
+    } else {
+      m_netParent[driven] = driver;
+    }
+  }
+
+  void AddPin(Netlist::CellId cell, std::string_view name,
+              Netlist::Direction direction, uint32_t net) {
+    m_netlist.AddPin(cell, name, direction);
+    m_pinNets.push_back(net);
+  }
+
+  Netlist::Direction PinDirection(std::string_view type,
+                                  std::string_view pin) {
+    if (!m_directions.empty()) {
+      auto cell = m_directions.find(std::string(type));
+      if (cell != m_directions.end()) {
+        std::string base(pin.substr(0, pin.find('[')));
+        auto found = cell->second.find(base);
+        if (found != cell->second.end()) return found->second;
+      }
+    }
+    auto cached = m_guessed.find(pin);
+    if (cached != m_guessed.end()) return cached->second;
+    Netlist::Direction direction = GuessDirection(pin);
+    m_guessed.emplace(Store(pin), direction);
+    return direction;
+  }
+
+  // Bits of a connection, most significant first, kOpen where unconnected
+  bool Expand(Scope& scope, const ItemRef& ref, const Connection& connection,
+              std::vector<uint32_t>& bits) {
+    bits.clear();
+    if (connection.m_tokenCount == 0) return true;
+    const Chunk& chunk = *ref.m_chunk;
+    const Span* tokens = chunk.m_tokens.data() + connection.m_firstToken;
+    if (!scope.m_module->m_verilog) {
+      bits.push_back(Net(scope, chunk.Text(tokens[0]), true));
+      return true;
+    }
+    size_t i = 0;
+    if (!ExpandExpression(scope, ref, tokens, connection.m_tokenCount, i,
+                          bits)) {
+      return false;
+    }
+    if (i != connection.m_tokenCount) {
+      return Fail(ref, "unsupported expression near '" +
+                           std::string(chunk.Text(tokens[i])) + "'");
+    }
+    return true;
+  }
+
+  bool ExpandExpression(Scope& scope, const ItemRef& ref, const Span* tokens,
+                        size_t count, size_t& i, std::vector<uint32_t>& bits) {
+    const Chunk& chunk = *ref.m_chunk;
+    auto text = [&](size_t index) {
+      return (index < count) ? chunk.Text(tokens[index]) : std::string_view();
+    };
+    std::string_view token = text(i);
+    if (token.empty()) return Fail(ref, "missing expression");
+    if (token == "{") {
+      i++;
+      // Replication {<n>{...}}
+      if (isdigit((unsigned char)text(i)[0]) && text(i + 1) == "{") {
+        long times = std::atol(std::string(text(i)).c_str());
+        i++;
+        std::vector<uint32_t> inner;
+        if (!ExpandExpression(scope, ref, tokens, count, i, inner)) {
+          return false;
+        }
+        for (long k = 0; k < times; k++) {
+          bits.insert(bits.end(), inner.begin(), inner.end());
+        }
+        if (text(i++) != "}") return Fail(ref, "expected '}'");
+        return true;
+      }
+      for (;;) {
+        if (!ExpandExpression(scope, ref, tokens, count, i, bits)) {
+          return false;
+        }
+        token = text(i++);
+        if (token == "}") return true;
+        if (token != ",") return Fail(ref, "expected ',' or '}'");
+      }
+    }
+    if (isdigit((unsigned char)token[0]) || token[0] == '\'') {
+      std::vector<int> values;
+      if (!DecodeConstant(token, values)) {
+        return Fail(ref, "malformed constant " + std::string(token));
+      }
+      for (int value : values) bits.push_back(Constant(value));
+      i++;
+      return true;
+    }
+    if (!IsIdentifierStart(token[0]) && token[0] != '\\') {
+      return Fail(ref, "unsupported expression near '" + std::string(token) +
+                           "'");
+    }
+    std::string_view name = (token[0] == '\\') ? token.substr(1) : token;
+    i++;
+    int32_t msb = 0;
+    int32_t lsb = 0;
+    if (text(i) == "[") {
+      msb = lsb = std::atoi(std::string(text(i + 1)).c_str());
+      i += 2;
+      if (text(i) == ":") {
+        lsb = std::atoi(std::string(text(i + 1)).c_str());
+        i += 2;
+      }
+      if (text(i++) != "]") return Fail(ref, "unsupported bit select");
+    } else {
+      auto bus = scope.m_module->m_buses.find(name);
+      if (bus == scope.m_module->m_buses.end()) {
+        bits.push_back(Net(scope, name, true));
+        return true;
+      }
+      msb = bus->second.first;
+      lsb = bus->second.second;
+    }
+    m_names.clear();
+    BusBitNames(name, msb, lsb, m_names);
+    for (const std::string& bit : m_names) {
+      bits.push_back(Net(scope, bit, false));
+    }
+    return true;
+  }
+
+  bool Elaborate(Scope& scope, int depth) {
+    const ModuleDef* module = scope.m_module;
+    const std::vector<ItemRef>& body = module->m_body;
+    std::vector<uint32_t> lhs;
+    std::vector<uint32_t> rhs;
+    for (size_t k = 0; k < body.size(); k++) {
+      m_current = module;
+      const ItemRef& ref = body[k];
+      const Item& item = *ref.m_item;
+      if ((k & 4095) == 0 && m_cancel.Cancelled()) {
+        return Fail(ref, "cancelled");
+      }
+      switch (item.m_kind) {
+        case kNet: {
+          // supply0 / supply1
+          std::vector<std::string> names;
+          std::string_view name = ref.m_chunk->Text(item.m_name);
+          if (item.m_bus) {
+            BusBitNames(name, item.m_msb, item.m_lsb, names);
+          } else {
+            names.push_back(std::string(name));
+          }
+          for (const std::string& bit : names) {
+            Union(Net(scope, bit, false), Constant(item.m_supply - 1));
+          }
+          break;
+        }
+        case kAlias: {
+          const Connection* connections =
+              ref.m_chunk->m_connections.data() + item.m_firstConnection;
+          if (!Expand(scope, ref, connections[0], lhs) ||
+              !Expand(scope, ref, connections[1], rhs)) {
+            return false;
+          }
+          // Right aligned, as Verilog assigns are
+          size_t width = std::min(lhs.size(), rhs.size());
+          for (size_t j = 1; j <= width; j++) {
+            Union(lhs[lhs.size() - j], rhs[rhs.size() - j]);
+          }
+          break;
+        }
+        case kLut:
+        case kLatch:
+        case kInstance: {
+          std::string_view rename;
+          if (k + 1 < body.size() && body[k + 1].m_item->m_kind == kRename) {
+            rename = body[k + 1].m_chunk->Text(body[k + 1].m_item->m_name);
+          }
+          if (!Instantiate(scope, ref, rename, depth)) return false;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    return true;
+  }
+
+  bool Instantiate(Scope& scope, const ItemRef& ref, std::string_view rename,
+                   int depth) {
+    const Chunk& chunk = *ref.m_chunk;
+    const Item& item = *ref.m_item;
+    const Connection* connections =
+        chunk.m_connections.data() + item.m_firstConnection;
+    const size_t count = item.m_connectionCount;
+    std::vector<uint32_t> bits;
+
+    if (item.m_kind == kLut || item.m_kind == kLatch) {
+      // Named after their output net, unless renamed
+      const Connection& output = connections[item.m_kind == kLut ? count - 1
+                                                                 : 1];
+      std::string_view name =
+          rename.empty() ? chunk.Text(chunk.m_tokens[output.m_firstToken])
+                         : rename;
+      Netlist::CellId cell =
+          m_netlist.AddCell(scope.m_prefix + std::string(name),
+                            item.m_kind == kLut ? "$lut" : "$latch");
+      static const char* kLatchPins[] = {"D", "Q", "C"};
+      for (size_t j = 0; j < count; j++) {
+        if (!Expand(scope, ref, connections[j], bits)) return false;
+        uint32_t net = bits.empty() ? kOpen : bits[0];
+        if (item.m_kind == kLatch) {
+          AddPin(cell, kLatchPins[j],
+                 j == 1 ? Netlist::Output : Netlist::Input, net);
+        } else if (j + 1 == count) {
+          AddPin(cell, "out", Netlist::Output, net);
+        } else {
+          AddPin(cell, "in[" + std::to_string(j) + "]", Netlist::Input, net);
+        }
+      }
+      return true;
+    }
+
+    const std::string_view type = chunk.Text(item.m_type);
+    std::string_view name = rename.empty() ? chunk.Text(item.m_name) : rename;
+    auto found = m_modules.find(type);
+    const ModuleDef* definition =
+        (found == m_modules.end()) ? nullptr : found->second;
+
+    if (definition && !definition->m_blackbox) {
+      // Hierarchical instance: its ports are bound to the nets of this
+      // scope, then its body is elaborated in a scope of its own
+      if (name.empty()) return Fail(ref, "instance of a module has no name");
+      if (depth >= 64) {
+        return Fail(ref, "module hierarchy too deep (recursive instance?)");
+      }
+      Scope child;
+      child.m_module = definition;
+      child.m_prefix = scope.m_prefix + std::string(name) + "/";
+      std::vector<std::string> portBits;
+      for (size_t j = 0; j < count; j++) {
+        std::string_view formal = chunk.Text(connections[j].m_formal);
+        if (formal.empty()) {
+          if (j >= definition->m_portOrder.size()) {
+            return Fail(ref, "too many connections for " + std::string(type));
+          }
+          formal = definition->m_portOrder[j];
+        }
+        auto port = definition->m_ports.find(formal);
+        if (port == definition->m_ports.end()) {
+          return Fail(ref, std::string(type) + " has no port " +
+                               std::string(formal));
+        }
+        if (!Expand(scope, ref, connections[j], bits)) return false;
+        portBits.clear();
+        if (port->second.m_bus) {
+          BusBitNames(port->first, port->second.m_msb, port->second.m_lsb,
+                      portBits);
+        } else {
+          portBits.push_back(std::string(port->first));
+        }
+        size_t width = std::min(bits.size(), portBits.size());
+        for (size_t b = 1; b <= width; b++) {
+          uint32_t net = bits[bits.size() - b];
+          if (net == kOpen) continue;
+          const std::string& bit = portBits[portBits.size() - b];
+          std::string_view key =
+              port->second.m_bus ? Store(bit) : port->first;
+          child.m_nets.Set(key, NameTable::Hash(key), net);
+        }
+      }
+      if (!Elaborate(child, depth + 1)) return false;
+      m_current = scope.m_module;
+      return true;
+    }
+
+    // Leaf cell
+    const bool primitive =
+        !definition && scope.m_module->m_verilog && IsPrimitive(type);
+    // Expanded before the cell is added, pins go to the last cell
+    if (m_expanded.size() < count) m_expanded.resize(count);
+    for (size_t j = 0; j < count; j++) {
+      if (!Expand(scope, ref, connections[j], m_expanded[j])) return false;
+    }
+    Netlist::CellId cell;
+    if (name.empty()) {
+      cell = m_netlist.AddCell(scope.m_prefix + "$" + std::string(type) +
+                                   "$" + std::to_string(m_unnamed++),
+                               type);
+    } else if (scope.m_prefix.empty()) {
+      cell = m_netlist.AddCell(name, type);
+    } else {
+      cell = m_netlist.AddCell(scope.m_prefix + std::string(name), type);
+    }
+    for (size_t j = 0; j < count; j++) {
+      const std::vector<uint32_t>& actual = m_expanded[j];
+      std::string_view pin = chunk.Text(connections[j].m_formal);
+      Netlist::Direction direction = Netlist::Input;
+      if (pin.empty()) {
+        if (primitive) {
+          PrimitivePin(type, j, count, m_pin, direction);
+          pin = m_pin;
+        } else if (definition && j < definition->m_portOrder.size()) {
+          pin = definition->m_portOrder[j];
+        } else {
+          m_pin = "p" + std::to_string(j);
+          pin = m_pin;
+        }
+      }
+      const PortDef* port = nullptr;
+      if (definition) {
+        auto found = definition->m_ports.find(pin);
+        if (found != definition->m_ports.end()) port = &found->second;
+      }
+      if (port && port->m_direction != kUnknownDirection) {
+        direction = (Netlist::Direction)port->m_direction;
+      } else if (!primitive) {
+        direction = PinDirection(type, pin);
+      }
+      if (port ? !port->m_bus : actual.size() <= 1) {
+        AddPin(cell, pin, direction, actual.empty() ? kOpen : actual.back());
+        continue;
+      }
+      m_pinBits.clear();
+      if (port) {
+        BusBitNames(pin, port->m_msb, port->m_lsb, m_pinBits);
+      } else {
+        BusBitNames(pin, (int32_t)actual.size() - 1, 0, m_pinBits);
+      }
+      // Right aligned, missing bits are left unconnected
+      for (size_t b = 0; b < m_pinBits.size(); b++) {
+        size_t fromRight = m_pinBits.size() - b;
+        uint32_t net = (fromRight <= actual.size())
+                           ? actual[actual.size() - fromRight]
+                           : kOpen;
+        AddPin(cell, m_pinBits[b], direction, net);
+      }
+    }
+    return true;
+  }
+
+  size_t m_expectedNets;
+  Netlist& m_netlist;
+  const ModuleMap& m_modules;
+  const DirectionMap& m_directions;
+  const CancellationToken& m_cancel;
+  const ModuleDef* m_current = nullptr;
+  Arena m_arena;
+  std::vector<std::string_view> m_netNames;
+  std::vector<uint32_t> m_netParent;
+  // 3 constants, 2 top level ports, 1 top level nets, 0 the others
+  std::vector<uint8_t> m_netRank;
+  std::vector<uint32_t> m_pinNets;
+  uint32_t m_constants[2] = {kOpen, kOpen};
+  uint32_t m_unnamed = 0;
+  // Scratch buffers, reused from cell to cell
+  std::vector<std::vector<uint32_t>> m_expanded;
+  std::vector<std::string> m_names;
+  std::vector<std::string> m_pinBits;
+  std::string m_pin;
+  std::unordered_map<std::string_view, Netlist::Direction> m_guessed;
+  std::string m_error;
+};
+
+void Split(Source& source, size_t index, size_t chunkSize) {
+  const char* data = source.m_file.Data();
+  const size_t size = source.m_file.Size();
+  size_t begin = 0;
+  size_t scan = 0;
+  while (begin < size) {
+    size_t end = size;
+    if (size - begin > chunkSize) {
+      end = (source.m_format == NetlistReader::Blif)
+                ? NextBlifBoundary(data, size, begin + chunkSize)
+                : NextVerilogBoundary(data, size, scan, begin + chunkSize);
+    }
+    Chunk chunk;
+    chunk.m_source = index;
+    chunk.m_base = data + begin;
+    chunk.m_offset = begin;
+    chunk.m_size = end - begin;
+    // Token offsets are 32 bits
+    if (chunk.m_size > UINT32_MAX) {
+      chunk.Fail(chunk.m_base, "statement too long");
+    }
+    source.m_chunks.push_back(std::move(chunk));
+    begin = end;
+  }
+}
+
+}  // namespace
+
+bool NetlistReader::FormatFromPath(const std::string& path, Format& format) {
+  std::string extension;
+  size_t dot = path.find_last_of('.');
+  if (dot != std::string::npos) extension = path.substr(dot + 1);
+  for (char& c : extension) c = (char)tolower((unsigned char)c);
+  if (extension == "blif" || extension == "eblif") {
+    format = Blif;
+    return true;
+  }
+  // Gate level and mapped Verilog
+  if (extension == "vg" || extension == "vm") {
+    format = Verilog;
+    return true;
+  }
+  return false;
+}
+
+void NetlistReader::SetPinDirection(const std::string& cellType,
+                                    const std::string& pin,
+                                    Netlist::Direction direction) {
+  m_pinDirections[cellType][pin] = direction;
+}
+
+bool NetlistReader::Read(Netlist& netlist) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  m_error.clear();
+  m_warnings.clear();
+  m_stats = Stats();
+  if (m_files.empty()) {
+    m_error = "no netlist file";
+    return false;
+  }
+  std::vector<std::unique_ptr<Source>> sources;
+  for (const File& file : m_files) {
+    sources.emplace_back(new Source);
+    Source& source = *sources.back();
+    source.m_path = file.m_path;
+    source.m_format = file.m_format;
+    if (!source.m_file.Open(file.m_path, m_error)) return false;
+    source.m_file.AdviseSequential();
+    m_stats.m_bytes += source.m_file.Size();
+  }
+  m_stats.m_files = sources.size();
+
+  // Finding the chunk boundaries of a Verilog file is a sequential pass,
+  // files are split concurrently
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  const size_t chunkSize =
+      std::clamp<size_t>(m_options.m_chunkSize, 1 << 12, 1 << 30);
+  scheduler->ParallelFor(
+      0, sources.size(), 1,
+      [&sources, chunkSize](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) Split(*sources[i], i, chunkSize);
+      },
+      m_options.m_threads);
+  std::vector<Chunk*> chunks;
+  for (auto& source : sources) {
+    for (Chunk& chunk : source->m_chunks) chunks.push_back(&chunk);
+  }
+  m_stats.m_chunks = chunks.size();
+  const CancellationToken& cancel = m_options.m_cancel;
+  scheduler->ParallelFor(
+      0, chunks.size(), 1,
+      [&chunks, &sources, &cancel](size_t from, size_t to) {
+        for (size_t i = from; i < to && !cancel.Cancelled(); i++) {
+          Chunk& chunk = *chunks[i];
+          if (!chunk.m_error.empty()) continue;
+          if (sources[chunk.m_source]->m_format == Blif) {
+            ParseBlifChunk(chunk);
+          } else {
+            ParseVerilogChunk(chunk);
+          }
+        }
+      },
+      m_options.m_threads);
+  if (cancel.Cancelled()) {
+    m_error = "netlist reading cancelled";
+    return false;
+  }
+  size_t items = 0;
+  size_t connections = 0;
+  for (Chunk* chunk : chunks) {
+    if (!chunk->m_error.empty()) {
+      m_error = Location(*sources[chunk->m_source], chunk->m_errorOffset) +
+                ": " + chunk->m_error;
+      return false;
+    }
+    items += chunk->m_items.size();
+    connections += chunk->m_connections.size();
+  }
+  Clock::time_point parsed = Clock::now();
+  m_stats.m_parseSeconds =
+      std::chrono::duration<double>(parsed - start).count();
+
+  // Stitch the items of the chunks into modules, in file order
+  std::vector<std::unique_ptr<ModuleDef>> modules;
+  Elaborator::ModuleMap byName;
+  for (auto& source : sources) {
+    const bool verilog = source->m_format == Verilog;
+    ModuleDef* module = nullptr;
+    for (const Chunk& chunk : source->m_chunks) {
+      for (const Item& item : chunk.m_items) {
+        if (item.m_kind == kModule) {
+          if (module && verilog) {
+            m_error = Location(*source, item.m_offset) +
+                      ": module inside module " + std::string(module->m_name);
+            return false;
+          }
+          modules.emplace_back(new ModuleDef);
+          module = modules.back().get();
+          module->m_name = chunk.Text(item.m_name);
+          module->m_source = source.get();
+          module->m_offset = item.m_offset;
+          module->m_verilog = verilog;
+          if (!byName.emplace(module->m_name, module).second) {
+            m_warnings.push_back(Location(*source, item.m_offset) +
+                                 ": " + std::string(module->m_name) +
+                                 " redefined, the first definition is used");
+          }
+          continue;
+        }
+        if (!module) {
+          m_error = Location(*source, item.m_offset) +
+                    (verilog ? ": statement outside of a module"
+                             : ": statement outside of a model");
+          return false;
+        }
+        switch (item.m_kind) {
+          case kEnd:
+            module = nullptr;
+            break;
+          case kBlackbox:
+            module->m_blackbox = true;
+            break;
+          case kPort: {
+            std::string_view name = chunk.Text(item.m_name);
+            auto found = module->m_ports.find(name);
+            if (found == module->m_ports.end()) {
+              PortDef port;
+              port.m_name = name;
+              found = module->m_ports.emplace(name, port).first;
+              module->m_portOrder.push_back(name);
+            }
+            if (item.m_direction != kUnknownDirection) {
+              found->second.m_direction = item.m_direction;
+            }
+            if (item.m_bus) {
+              found->second.m_bus = true;
+              found->second.m_msb = item.m_msb;
+              found->second.m_lsb = item.m_lsb;
+              module->m_buses[name] = {item.m_msb, item.m_lsb};
+            }
+            break;
+          }
+          case kNet:
+            if (item.m_bus) {
+              module->m_buses[chunk.Text(item.m_name)] = {item.m_msb,
+                                                          item.m_lsb};
+            }
+            if (item.m_supply) module->m_body.push_back({&chunk, &item});
+            break;
+          default:
+            module->m_body.push_back({&chunk, &item});
+            break;
+        }
+      }
+    }
+    if (module && verilog) {
+      m_error = source->m_path + ": missing endmodule for " +
+                std::string(module->m_name);
+      return false;
+    }
+  }
+  m_stats.m_modules = modules.size();
+
+  // The top is the requested one, or else the model nobody instantiates.
+  // BLIF puts the top model first, Verilog has no such convention.
+  for (auto& module : modules) {
+    for (const ItemRef& ref : module->m_body) {
+      if (ref.m_item->m_kind != kInstance) continue;
+      auto found = byName.find(ref.m_chunk->Text(ref.m_item->m_type));
+      if (found != byName.end()) found->second->m_instantiated = true;
+    }
+  }
+  const ModuleDef* top = nullptr;
+  if (!m_options.m_top.empty()) {
+    auto found = byName.find(m_options.m_top);
+    if (found == byName.end() || found->second->m_blackbox) {
+      m_error = "top level module " + m_options.m_top + " not found";
+      return false;
+    }
+    top = found->second;
+  } else {
+    std::vector<const ModuleDef*> candidates;
+    bool blifOnly = true;
+    for (auto& module : modules) {
+      if (module->m_verilog) blifOnly = false;
+      if (!module->m_blackbox && !module->m_instantiated &&
+          byName[module->m_name] == module.get()) {
+        candidates.push_back(module.get());
+      }
+    }
+    if (candidates.empty()) {
+      m_error = "no top level module in the netlist";
+      return false;
+    }
+    if (candidates.size() > 1 && !blifOnly) {
+      m_error = "several top level candidates:";
+      for (const ModuleDef* module : candidates) {
+        m_error += " " + std::string(module->m_name);
+      }
+      m_error += ", pick one with set_top_level";
+      return false;
+    }
+    top = candidates.front();
+  }
+
+  netlist.Clear();
+  netlist.Reserve(items, connections + items, items);
+  // Connections are a fair upper bound of the nets, most nets have a
+  // driver and a sink
+  Elaborator elaborator(netlist, byName, m_pinDirections, cancel,
+                        connections / 2);
+  if (!elaborator.Run(*top, m_error)) {
+    netlist.Clear();
+    return false;
+  }
+  m_stats.m_elaborateSeconds =
+      std::chrono::duration<double>(Clock::now() - parsed).count();
+  return true;
+}
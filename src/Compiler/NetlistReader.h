@@ -0,0 +1,116 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Compiler/EventBus.h"
+#include "Compiler/Netlist.h"
+
+#ifndef NETLIST_READER_H
+#define NETLIST_READER_H
+
+namespace FOEDAG {
+
+// Byte search over text, 32 or 16 bytes per step when the build targets
+// AVX2 or SSE2, one byte at a time otherwise
+class TextScanner {
+ public:
+  // First occurrence of c in [begin, end), end if there is none
+  static const char* Find(const char* begin, const char* end, char c);
+  // First occurrence of any byte of set, a string of 1 to 4 bytes
+  static const char* FindAny(const char* begin, const char* end,
+                             const char* set);
+};
+
+// Reads gate level netlists into a Netlist: BLIF, EBLIF (BLIF plus .conn,
+// .cname, .param and .attr) and structural Verilog (module instances,
+// primitives, assigns, bus and constant expressions; no behavior).
+//
+// Files are mapped, not streamed. Each file is parsed by its own task and a
+// large file is split in chunks, cut at statement boundaries, which are
+// tokenized and parsed in parallel. The chunks are then stitched together in
+// file order and the top module is elaborated (flattened) sequentially.
+// Top level ports become $input, $output and $inout cells, constants are
+// driven by $const0 / $const1 cells, BLIF covers become $lut cells (the
+// truth tables are not kept) and latches $latch cells. Pin directions of
+// library cells come from the blackbox models / modules of the files, from
+// SetPinDirection(), or else from the usual output names (Q, Y, Z, O...).
+class NetlistReader {
+ public:
+  enum Format { Blif, Verilog };
+  struct Options {
+    // Empty: the design top level, else the model nobody instantiates
+    std::string m_top;
+    // Bytes parsed per task
+    size_t m_chunkSize = 4 << 20;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    CancellationToken m_cancel;
+  };
+  struct Stats {
+    size_t m_files = 0;
+    size_t m_bytes = 0;
+    size_t m_chunks = 0;
+    size_t m_modules = 0;
+    double m_parseSeconds = 0;
+    double m_elaborateSeconds = 0;
+  };
+
+  NetlistReader() = default;
+  explicit NetlistReader(const Options& options) : m_options(options) {}
+
+  // Format from the file extension, false if it is not a netlist
+  static bool FormatFromPath(const std::string& path, Format& format);
+
+  void AddFile(const std::string& path, Format format) {
+    m_files.push_back({path, format});
+  }
+  void SetPinDirection(const std::string& cellType, const std::string& pin,
+                       Netlist::Direction direction);
+  // Replaces the content of netlist, which is finalized on success
+  bool Read(Netlist& netlist);
+
+  const std::string& Error() const { return m_error; }
+  const std::vector<std::string>& Warnings() const { return m_warnings; }
+  const Stats& GetStats() const { return m_stats; }
+
+ private:
+  struct File {
+    std::string m_path;
+    Format m_format;
+  };
+  Options m_options;
+  std::vector<File> m_files;
+  // Cell type -> pin -> direction
+  std::map<std::string, std::map<std::string, Netlist::Direction>>
+      m_pinDirections;
+  std::string m_error;
+  std::vector<std::string> m_warnings;
+  Stats m_stats;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,235 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/NetlistReader.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+std::string WriteFile(const std::string& name, const std::string& content) {
+  std::string path = (std::filesystem::temp_directory_path() / name).string();
+  std::ofstream out(path, std::ios::binary);
+  out << content;
+  return path;
+}
+
+// Cell names, types, pins and their nets, in a comparable form
+std::string Dump(const Netlist& netlist) {
+  std::ostringstream out;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    out << netlist.CellName(cell) << " " << netlist.CellType(cell);
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      out << " " << netlist.PinName(pin) << "="
+          << (netlist.PinNet(pin) == Netlist::kNone
+                  ? "-"
+                  : netlist.NetName(netlist.PinNet(pin)));
+    }
+    out << "\n";
+  }
+  return out.str();
+}
+
+Netlist::PinId FindPin(const Netlist& netlist, const std::string& cell,
+                       const std::string& pin) {
+  Netlist::CellId id = netlist.FindCell(cell);
+  if (id == Netlist::kNone) return Netlist::kNone;
+  for (Netlist::PinId p : netlist.CellPins(id)) {
+    if (netlist.PinName(p) == pin) return p;
+  }
+  return Netlist::kNone;
+}
+
+std::string PinNet(const Netlist& netlist, const std::string& cell,
+                   const std::string& pin) {
+  Netlist::PinId id = FindPin(netlist, cell, pin);
+  if (id == Netlist::kNone || netlist.PinNet(id) == Netlist::kNone) return "";
+  return std::string(netlist.NetName(netlist.PinNet(id)));
+}
+
+TEST(NetlistReader, ScannerMatchesScalarSearch) {
+  std::string text(300, 'a');
+  for (size_t i = 0; i < text.size(); i += 37) text[i] = ';';
+  text[250] = '\n';
+  const char* begin = text.data();
+  const char* end = begin + text.size();
+  for (size_t from = 0; from < text.size(); from += 7) {
+    EXPECT_EQ(TextScanner::Find(begin + from, end, '\n'),
+              (from <= 250) ? begin + 250 : end);
+    const char* any = TextScanner::FindAny(begin + from, end, "\n;");
+    const char* expected = begin + from;
+    while (expected < end && *expected != '\n' && *expected != ';') {
+      expected++;
+    }
+    EXPECT_EQ(any, expected);
+  }
+  EXPECT_EQ(TextScanner::Find(begin, begin, 'a'), begin);
+}
+
+TEST(NetlistReader, ReadsBlif) {
+  std::string path = WriteFile("foedag_reader.eblif", R"(
+# comment
+.model top
+.inputs a b \
+  clk
+.outputs y
+.names a b n1   # and
+11 1
+.latch n1 q re clk 0
+.subckt LUT2 A=q B=a Y=n2
+.cname lut_q
+.param INIT 0110
+.conn n2 y
+.end
+
+.model LUT2
+.inputs A B
+.outputs Y
+.blackbox
+.end
+)");
+  NetlistReader reader;
+  reader.AddFile(path, NetlistReader::Blif);
+  Netlist netlist;
+  ASSERT_TRUE(reader.Read(netlist)) << reader.Error();
+  // 3 inputs, 1 output, .names, .latch, .subckt
+  EXPECT_EQ(netlist.CellCount(), 7u);
+  EXPECT_EQ(netlist.CellType(netlist.FindCell("n1")), "$lut");
+  EXPECT_EQ(PinNet(netlist, "n1", "in[1]"), "b");
+  EXPECT_EQ(PinNet(netlist, "q", "C"), "clk");
+  EXPECT_EQ(netlist.CellType(netlist.FindCell("lut_q")), "LUT2");
+  // .conn merged the nets, the port name survives
+  EXPECT_EQ(PinNet(netlist, "lut_q", "Y"), "y");
+  EXPECT_EQ(PinNet(netlist, "y", "A"), "y");
+  Netlist::PinId out = FindPin(netlist, "lut_q", "Y");
+  EXPECT_EQ(netlist.PinDirection(out), Netlist::Output);
+  EXPECT_EQ(netlist.NetDriver(netlist.PinNet(out)), out);
+  std::filesystem::remove(path);
+}
+
+TEST(NetlistReader, ReadsStructuralVerilog) {
+  std::string path = WriteFile("foedag_reader.v", R"(
+`timescale 1ns/1ps
+// full adder bit, flattened into top
+module half (input a, input b, output s, output c);
+  xor (s, a, b);
+  and g1 (c, a, b);
+endmodule
+
+module top (clk, d, q);
+  input clk;
+  input [1:0] d;   /* two bits; not a statement end */
+  output [1:0] q;
+  wire \odd;name ;
+  wire [1:0] sum;
+  (* keep = "yes;" *)
+  half h0 (.a(d[0]), .b(d[1]), .s(\odd;name ), .c(sum[1]));
+  DFF r0 (.C(clk), .D(\odd;name ), .Q(q[0])),
+      r1 (.C(clk), .D(sum[1]), .Q(q[1]));
+  RAM2 m0 (.ADDR({d[0], 1'b1}), .WE(1'b0));
+  assign sum[0] = q[0];
+endmodule
+)");
+  NetlistReader reader;
+  reader.AddFile(path, NetlistReader::Verilog);
+  Netlist netlist;
+  ASSERT_TRUE(reader.Read(netlist)) << reader.Error();
+  // Ports: clk, d[1], d[0], q[1], q[0]
+  EXPECT_EQ(netlist.CellType(netlist.FindCell("d[1]")), "$input");
+  EXPECT_EQ(netlist.CellType(netlist.FindCell("h0/g1")), "and");
+  EXPECT_EQ(PinNet(netlist, "h0/g1", "A0"), "d[0]");
+  EXPECT_EQ(PinNet(netlist, "r1", "D"), "sum[1]");
+  EXPECT_EQ(PinNet(netlist, "r0", "D"), "odd;name");
+  EXPECT_EQ(PinNet(netlist, "h0/$xor$0", "Y"), "odd;name");
+  EXPECT_EQ(PinNet(netlist, "m0", "ADDR[1]"), "d[0]");
+  EXPECT_EQ(PinNet(netlist, "m0", "ADDR[0]"), "$true");
+  EXPECT_EQ(PinNet(netlist, "m0", "WE"), "$false");
+  EXPECT_EQ(netlist.CellType(netlist.FindCell("$true")), "$const1");
+  Netlist::PinId q = FindPin(netlist, "r0", "Q");
+  EXPECT_EQ(netlist.PinDirection(q), Netlist::Output);
+  std::filesystem::remove(path);
+}
+
+TEST(NetlistReader, ChunksGiveTheSameNetlist) {
+  std::ostringstream blif;
+  std::ostringstream verilog;
+  blif << ".model chain\n.inputs i\n.outputs o\n";
+  verilog << "module chain (i, o);\n input i;\n output o;\n";
+  const int cells = 3000;
+  for (int c = 0; c < cells; c++) {
+    std::string in = c ? "n" + std::to_string(c - 1) : "i";
+    std::string out = (c + 1 < cells) ? "n" + std::to_string(c) : "o";
+    blif << ".subckt INV A=" << in << " \\\n  Y=" << out << "\n";
+    blif << ".cname u" << c << "\n";
+    verilog << " INV u" << c << " (.A(" << in << "), /* ; */ .Y(" << out
+            << "));\n";
+  }
+  blif << ".end\n";
+  verilog << "endmodule\n";
+  for (auto format : {NetlistReader::Blif, NetlistReader::Verilog}) {
+    const bool isBlif = format == NetlistReader::Blif;
+    std::string path =
+        WriteFile(isBlif ? "foedag_chunks.blif" : "foedag_chunks.v",
+                  isBlif ? blif.str() : verilog.str());
+    NetlistReader whole;
+    whole.AddFile(path, format);
+    Netlist expected;
+    ASSERT_TRUE(whole.Read(expected)) << whole.Error();
+    EXPECT_EQ(whole.GetStats().m_chunks, 1u);
+    EXPECT_EQ(expected.CellCount(), (size_t)cells + 2);
+
+    NetlistReader::Options options;
+    options.m_chunkSize = 4096;
+    NetlistReader chunked(options);
+    chunked.AddFile(path, format);
+    Netlist netlist;
+    ASSERT_TRUE(chunked.Read(netlist)) << chunked.Error();
+    EXPECT_GT(chunked.GetStats().m_chunks, 10u);
+    EXPECT_EQ(Dump(netlist), Dump(expected));
+    std::filesystem::remove(path);
+  }
+}
+
+TEST(NetlistReader, ReportsErrorsWithLocation) {
+  std::string path = WriteFile("foedag_behavior.v",
+                               "module top (input a, output reg y);\n"
+                               "  always @(a) y = a;\n"
+                               "endmodule\n");
+  NetlistReader reader;
+  reader.AddFile(path, NetlistReader::Verilog);
+  Netlist netlist;
+  EXPECT_FALSE(reader.Read(netlist));
+  EXPECT_THAT(reader.Error(), testing::HasSubstr("foedag_behavior.v:2"));
+  EXPECT_THAT(reader.Error(), testing::HasSubstr("structural"));
+  std::filesystem::remove(path);
+
+  NetlistReader missing;
+  missing.AddFile(path, NetlistReader::Verilog);
+  EXPECT_FALSE(missing.Read(netlist));
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,98 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Netlist.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// a -> inv -> b -> and2.A, c -> and2.B, and2 -> y
+TEST(Netlist, BuildsConnectivity) {
+  Netlist netlist;
+  Netlist::CellId inv = netlist.AddCell("u1", "INV");
+  Netlist::PinId invA = netlist.AddPin(inv, "A", Netlist::Input);
+  Netlist::PinId invY = netlist.AddPin(inv, "Y", Netlist::Output);
+  Netlist::CellId and2 = netlist.AddCell("u2", "AND2");
+  Netlist::PinId andA = netlist.AddPin(and2, "A", Netlist::Input);
+  Netlist::PinId andB = netlist.AddPin(and2, "B", Netlist::Input);
+  Netlist::PinId andY = netlist.AddPin(and2, "Y", Netlist::Output);
+  EXPECT_EQ(netlist.AddPin(inv, "Z", Netlist::Output), Netlist::kNone);
+
+  Netlist::NetId a = netlist.AddNet("a");
+  Netlist::NetId b = netlist.AddNet("b");
+  Netlist::NetId c = netlist.AddNet("c");
+  Netlist::NetId y = netlist.AddNet("y");
+  netlist.Connect(invA, a);
+  netlist.Connect(andA, b);
+  netlist.Connect(invY, b);
+  netlist.Connect(andB, c);
+  netlist.Connect(andY, y);
+  netlist.Finalize();
+
+  EXPECT_EQ(netlist.CellCount(), 2u);
+  EXPECT_EQ(netlist.PinCount(), 5u);
+  EXPECT_EQ(netlist.NetCount(), 4u);
+  EXPECT_EQ(netlist.CellPins(and2).size(), 3u);
+  EXPECT_EQ(netlist.PinCell(andB), and2);
+  EXPECT_EQ(netlist.PinName(andB), "B");
+  EXPECT_EQ(netlist.CellType(and2), "AND2");
+  EXPECT_EQ(netlist.CellTypeId(inv), netlist.CellTypeId(inv));
+  EXPECT_NE(netlist.CellTypeId(inv), netlist.CellTypeId(and2));
+
+  // Driver first, even though it was connected last
+  ASSERT_EQ(netlist.NetPins(b).size(), 2u);
+  EXPECT_EQ(netlist.NetPins(b)[0], invY);
+  EXPECT_EQ(netlist.NetPins(b)[1], andA);
+  EXPECT_EQ(netlist.NetDriver(b), invY);
+  EXPECT_EQ(netlist.NetDriver(a), Netlist::kNone);
+
+  std::vector<Netlist::PinId> pins;
+  for (Netlist::PinId pin : netlist.CellPins(and2)) pins.push_back(pin);
+  EXPECT_THAT(pins, testing::ElementsAre(andA, andB, andY));
+
+  EXPECT_EQ(netlist.FindCell("u2"), and2);
+  EXPECT_EQ(netlist.FindNet("c"), c);
+  EXPECT_EQ(netlist.FindNet("missing"), Netlist::kNone);
+  EXPECT_GT(netlist.MemoryBytes(), 0u);
+
+  netlist.Clear();
+  EXPECT_EQ(netlist.CellCount(), 0u);
+  EXPECT_EQ(netlist.FindCell("u2"), Netlist::kNone);
+}
+
+TEST(Netlist, ArenaAlignsAndGrows) {
+  Arena arena(64);
+  void* small = arena.Allocate(3, 1);
+  double* aligned = (double*)arena.Allocate(sizeof(double), alignof(double));
+  EXPECT_EQ((uintptr_t)aligned % alignof(double), 0u);
+  EXPECT_NE(small, (void*)aligned);
+  void* large = arena.Allocate(1000);
+  EXPECT_NE(large, nullptr);
+  EXPECT_GE(arena.Capacity(), 1064u);
+  arena.Clear();
+  EXPECT_EQ(arena.Capacity(), 0u);
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,475 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "Compiler/ObjectFilter.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "Compiler/DeviceModel.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+// Objects a filter task evaluates at once
+constexpr size_t kBlock = 4096;
+
+const char* const kDirections[] = {"in", "out", "inout"};
+
+// Sinks of the nets a cell or pin drives
+uint32_t PinFanout(const Netlist& netlist, Netlist::PinId pin) {
+  const Netlist::NetId net = netlist.PinNet(pin);
+  if (netlist.PinDirection(pin) == Netlist::Input || net == Netlist::kNone) {
+    return 0;
+  }
+  return netlist.NetPins(net).size() - 1;
+}
+
+template <typename Pass>
+void Fill(const uint32_t* ids, size_t count, uint8_t* out, Pass pass) {
+  for (size_t i = 0; i < count; i++) out[i] = pass(ids[i]);
+}
+}  // namespace
+
+void ObjectProperties::Bind(const ObjectNames* names) {
+  m_names = names;
+  m_columns.clear();
+}
+
+const char* ObjectProperties::PropertyNames(Kind kind) {
+  switch (kind) {
+    case ObjectNames::Port:
+      return "name direction fanout";
+    case ObjectNames::Cell:
+      return "name ref_name type fanin fanout";
+    case ObjectNames::Pin:
+      return "name direction fanout";
+    case ObjectNames::Net:
+      return "name fanout pins";
+    case ObjectNames::Clock:
+      return "name period";
+  }
+  return "";
+}
+
+const ObjectProperties::Column* ObjectProperties::Get(
+    Kind kind, std::string_view property) {
+  if (m_names == nullptr || m_names->GetNetlist() == nullptr ||
+      kind == ObjectNames::Clock) {
+    return nullptr;
+  }
+  const std::pair<Kind, std::string> key(kind, std::string(property));
+  auto found = m_columns.find(key);
+  if (found != m_columns.end()) return &found->second;
+  Column column;
+  if (!Build(kind, property, column)) return nullptr;
+  return &m_columns.emplace(key, std::move(column)).first->second;
+}
+
+bool ObjectProperties::Build(Kind kind, std::string_view property,
+                             Column& column) const {
+  const Netlist& netlist = *m_names->GetNetlist();
+  if (property == "name") {
+    column.m_type = Name;
+    return true;
+  }
+  if (property == "direction" &&
+      (kind == ObjectNames::Port || kind == ObjectNames::Pin)) {
+    column.m_type = Symbol;
+    column.m_symbolNames.assign(std::begin(kDirections),
+                                std::end(kDirections));
+    if (kind == ObjectNames::Pin) {
+      column.m_symbols.resize(netlist.PinCount());
+      for (Netlist::PinId pin : netlist.Pins()) {
+        column.m_symbols[pin] = netlist.PinDirection(pin);
+      }
+      return true;
+    }
+    column.m_symbols.resize(netlist.CellCount());
+    for (Netlist::CellId cell : netlist.Cells()) {
+      const std::string_view type = netlist.CellType(cell);
+      // Of the design, an $input cell drives its pin
+      column.m_symbols[cell] = type == "$input"    ? 0
+                               : type == "$output" ? 1
+                                                   : 2;
+    }
+    return true;
+  }
+  if (property == "fanout") {
+    if (kind == ObjectNames::Pin) {
+      column.m_numbers.resize(netlist.PinCount());
+      for (Netlist::PinId pin : netlist.Pins()) {
+        column.m_numbers[pin] = PinFanout(netlist, pin);
+      }
+    } else if (kind == ObjectNames::Net) {
+      column.m_numbers.resize(netlist.NetCount());
+      for (Netlist::NetId net : netlist.Nets()) {
+        column.m_numbers[net] =
+            netlist.NetPins(net).size() -
+            (netlist.NetDriver(net) == Netlist::kNone ? 0 : 1);
+      }
+    } else {
+      column.m_numbers.resize(netlist.CellCount());
+      for (Netlist::CellId cell : netlist.Cells()) {
+        uint32_t fanout = 0;
+        for (Netlist::PinId pin : netlist.CellPins(cell)) {
+          fanout += PinFanout(netlist, pin);
+        }
+        column.m_numbers[cell] = fanout;
+      }
+    }
+    return true;
+  }
+  if (property == "fanin" && kind == ObjectNames::Cell) {
+    column.m_numbers.resize(netlist.CellCount());
+    for (Netlist::CellId cell : netlist.Cells()) {
+      uint32_t fanin = 0;
+      for (Netlist::PinId pin : netlist.CellPins(cell)) {
+        fanin += netlist.PinDirection(pin) == Netlist::Input &&
+                 netlist.PinNet(pin) != Netlist::kNone;
+      }
+      column.m_numbers[cell] = fanin;
+    }
+    return true;
+  }
+  if (property == "pins" && kind == ObjectNames::Net) {
+    column.m_numbers.resize(netlist.NetCount());
+    for (Netlist::NetId net : netlist.Nets()) {
+      column.m_numbers[net] = netlist.NetPins(net).size();
+    }
+    return true;
+  }
+  if ((property == "ref_name" || property == "type") &&
+      kind == ObjectNames::Cell) {
+    column.m_type = Symbol;
+    const bool resource = property == "type";
+    if (resource) {
+      for (int r = 0; r < DeviceModel::kResourceCount; r++) {
+        column.m_symbolNames.push_back(
+            DeviceModel::ResourceName((DeviceModel::Resource)r));
+      }
+    }
+    // Interned type ids to symbols
+    std::unordered_map<uint32_t, uint32_t> symbols;
+    column.m_symbols.resize(netlist.CellCount());
+    for (Netlist::CellId cell : netlist.Cells()) {
+      auto found = symbols.find(netlist.CellTypeId(cell));
+      if (found == symbols.end()) {
+        const std::string_view type = netlist.CellType(cell);
+        uint32_t symbol = DeviceModel::CellResource(type);
+        if (!resource) {
+          symbol = (uint32_t)column.m_symbolNames.size();
+          column.m_symbolNames.emplace_back(type);
+        }
+        found = symbols.emplace(netlist.CellTypeId(cell), symbol).first;
+      }
+      column.m_symbols[cell] = found->second;
+    }
+    return true;
+  }
+  return false;
+}
+
+class ObjectFilter::Parser {
+ public:
+  Parser(ObjectFilter& filter, std::string_view text,
+         const ColumnSource& columns, std::string& error)
+      : m_filter(filter), m_text(text), m_columns(columns), m_error(error) {}
+
+  bool Parse() {
+    if (!Expression()) return false;
+    Skip();
+    if (m_pos != m_text.size()) {
+      return Fail("unexpected \"" + std::string(m_text.substr(m_pos)) +
+                  "\"");
+    }
+    return true;
+  }
+
+ private:
+  void Skip() {
+    while (m_pos < m_text.size() &&
+           std::isspace((unsigned char)m_text[m_pos])) {
+      m_pos++;
+    }
+  }
+  bool Accept(std::string_view token) {
+    Skip();
+    if (m_text.compare(m_pos, token.size(), token) != 0) return false;
+    m_pos += token.size();
+    return true;
+  }
+  bool Fail(const std::string& message) {
+    m_error = message;
+    return false;
+  }
+  void Emit(Instruction instruction) {
+    if (instruction.m_op == Leaf) {
+      m_filter.m_depth = std::max(m_filter.m_depth, ++m_depth);
+    } else if (instruction.m_op != Not) {
+      m_depth--;
+    }
+    m_filter.m_program.push_back(std::move(instruction));
+  }
+  void Emit(Op op) {
+    Instruction instruction;
+    instruction.m_op = op;
+    Emit(std::move(instruction));
+  }
+
+  bool Expression() {
+    if (!Term()) return false;
+    while (Accept("||")) {
+      if (!Term()) return false;
+      Emit(Or);
+    }
+    return true;
+  }
+  bool Term() {
+    if (!Factor()) return false;
+    while (Accept("&&")) {
+      if (!Factor()) return false;
+      Emit(And);
+    }
+    return true;
+  }
+  bool Factor() {
+    if (Accept("!")) {
+      if (!Factor()) return false;
+      Emit(Not);
+      return true;
+    }
+    if (Accept("(")) {
+      if (!Expression()) return false;
+      return Accept(")") ? true : Fail("missing \")\"");
+    }
+    return Test();
+  }
+  // A "quoted string", with \ escapes, or the characters up to a space or
+  // an operator
+  bool Word(std::string& word) {
+    Skip();
+    word.clear();
+    if (m_pos < m_text.size() && m_text[m_pos] == '"') {
+      for (m_pos++; m_pos < m_text.size() && m_text[m_pos] != '"';
+           m_pos++) {
+        if (m_text[m_pos] == '\\' && m_pos + 1 < m_text.size()) m_pos++;
+        word += m_text[m_pos];
+      }
+      if (m_pos == m_text.size()) return Fail("missing closing quote");
+      m_pos++;
+      return true;
+    }
+    const size_t begin = m_pos;
+    while (m_pos < m_text.size() &&
+           !std::isspace((unsigned char)m_text[m_pos]) &&
+           std::strchr("()!=~<>&|\"", m_text[m_pos]) == nullptr) {
+      m_pos++;
+    }
+    word.assign(m_text.substr(begin, m_pos - begin));
+    if (!word.empty()) return true;
+    return Fail(m_pos == m_text.size()
+                    ? std::string("unexpected end of filter")
+                    : "unexpected \"" + std::string(m_text.substr(m_pos)) +
+                          "\"");
+  }
+  bool Test() {
+    static const std::pair<const char*, Comparison>
+        kOperators[] = {{"==", Eq},    {"!=", Ne}, {"=~", Match},
+                        {"!~", NoMatch}, {"<=", Le}, {">=", Ge},
+                        {"<", Lt},     {">", Gt}};
+    std::string property;
+    if (!Word(property)) return false;
+    Instruction leaf;
+    bool found = false;
+    for (const auto& op : kOperators) {
+      if ((found = Accept(op.first))) {
+        leaf.m_comparison = op.second;
+        break;
+      }
+    }
+    if (!found) return Fail("expected an operator after \"" + property + "\"");
+    if (!Word(leaf.m_text)) return false;
+    leaf.m_column = m_columns(property);
+    if (leaf.m_column == nullptr) {
+      return Fail("unknown " +
+                  std::string(ObjectNames::KindName(m_filter.m_kind)) +
+                  " property \"" + property + "\", expected one of: " +
+                  ObjectProperties::PropertyNames(m_filter.m_kind));
+    }
+    switch (leaf.m_column->m_type) {
+      case ObjectProperties::Number: {
+        if (leaf.m_comparison == Match || leaf.m_comparison == NoMatch) {
+          return Fail("property \"" + property + "\" is a number");
+        }
+        char* end = nullptr;
+        leaf.m_number = std::strtod(leaf.m_text.c_str(), &end);
+        if (leaf.m_text.empty() || *end != '\0') {
+          return Fail("expected a number for \"" + property + "\", got \"" +
+                      leaf.m_text + "\"");
+        }
+        break;
+      }
+      case ObjectProperties::Symbol:
+        for (const std::string& symbol : leaf.m_column->m_symbolNames) {
+          leaf.m_table.push_back(
+              CompareText(leaf.m_comparison, symbol, leaf.m_text));
+        }
+        break;
+      case ObjectProperties::Name:
+        break;
+    }
+    Emit(std::move(leaf));
+    return true;
+  }
+
+  ObjectFilter& m_filter;
+  std::string_view m_text;
+  size_t m_pos = 0;
+  const ColumnSource& m_columns;
+  std::string& m_error;
+  size_t m_depth = 0;
+};
+
+bool ObjectFilter::Compile(Kind kind, std::string_view expression,
+                           const ColumnSource& columns, std::string& error) {
+  m_kind = kind;
+  m_program.clear();
+  m_depth = 0;
+  if (Parser(*this, expression, columns, error).Parse()) return true;
+  m_program.clear();
+  return false;
+}
+
+bool ObjectFilter::CompareText(Comparison comparison, std::string_view value,
+                               std::string_view operand) {
+  switch (comparison) {
+    case Eq:
+      return value == operand;
+    case Ne:
+      return value != operand;
+    case Lt:
+      return value < operand;
+    case Le:
+      return value <= operand;
+    case Gt:
+      return value > operand;
+    case Ge:
+      return value >= operand;
+    case Match:
+      return ObjectNames::GlobMatch(operand, value);
+    case NoMatch:
+      return !ObjectNames::GlobMatch(operand, value);
+  }
+  return false;
+}
+
+void ObjectFilter::EvaluateLeaf(const Instruction& leaf,
+                                const ObjectNames& names,
+                                const uint32_t* ids, size_t count,
+                                uint8_t* pass) const {
+  const Column& column = *leaf.m_column;
+  if (column.m_type == ObjectProperties::Symbol) {
+    const uint32_t* symbols = column.m_symbols.data();
+    const uint8_t* table = leaf.m_table.data();
+    Fill(ids, count, pass, [=](uint32_t id) { return table[symbols[id]]; });
+    return;
+  }
+  if (column.m_type == ObjectProperties::Name) {
+    std::string scratch;
+    Fill(ids, count, pass, [&](uint32_t id) {
+      return CompareText(leaf.m_comparison,
+                         names.Name(m_kind, id, scratch), leaf.m_text);
+    });
+    return;
+  }
+  const double* numbers = column.m_numbers.data();
+  const double value = leaf.m_number;
+  switch (leaf.m_comparison) {
+    case Eq:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] == value; });
+      break;
+    case Ne:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] != value; });
+      break;
+    case Lt:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] < value; });
+      break;
+    case Le:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] <= value; });
+      break;
+    case Gt:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] > value; });
+      break;
+    case Ge:
+      Fill(ids, count, pass, [=](uint32_t id) { return numbers[id] >= value; });
+      break;
+    case Match:
+    case NoMatch:
+      break;
+  }
+}
+
+void ObjectFilter::Evaluate(const ObjectNames& names, const uint32_t* ids,
+                            size_t count, uint8_t* pass) const {
+  std::vector<std::vector<uint8_t>> stack(m_depth,
+                                          std::vector<uint8_t>(count));
+  size_t top = 0;
+  for (const Instruction& instruction : m_program) {
+    if (instruction.m_op == Leaf) {
+      EvaluateLeaf(instruction, names, ids, count, stack[top++].data());
+      continue;
+    }
+    uint8_t* result = stack[top - 1].data();
+    if (instruction.m_op == Not) {
+      for (size_t i = 0; i < count; i++) result[i] ^= 1;
+      continue;
+    }
+    result = stack[--top - 1].data();
+    const uint8_t* operand = stack[top].data();
+    if (instruction.m_op == And) {
+      for (size_t i = 0; i < count; i++) result[i] &= operand[i];
+    } else {
+      for (size_t i = 0; i < count; i++) result[i] |= operand[i];
+    }
+  }
+  std::memcpy(pass, stack[0].data(), count);
+}
+
+void ObjectFilter::Apply(const ObjectNames& names,
+                         std::vector<uint32_t>& ids) const {
+  if (m_program.empty() || ids.empty()) return;
+  std::vector<uint8_t> pass(ids.size());
+  TaskScheduler::Instance()->ParallelFor(
+      0, ids.size(), kBlock, [&](size_t begin, size_t end) {
+        Evaluate(names, ids.data() + begin, end - begin, pass.data() + begin);
+      });
+  size_t kept = 0;
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (pass[i]) ids[kept++] = ids[i];
+  }
+  ids.resize(kept);
+}
@@ -0,0 +1,127 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Compiler/ObjectNames.h"
+
+#ifndef OBJECT_FILTER_H
+#define OBJECT_FILTER_H
+
+namespace FOEDAG {
+
+// Properties of the netlist objects the -filter option of the queries
+// tests, one array per kind and property, indexed by object id:
+//   port  name, direction (in, out, inout), fanout
+//   cell  name, ref_name (its type), type (its resource: lut, ff, bram,
+//         io), fanin, fanout
+//   pin   name, direction, fanout
+//   net   name, fanout, pins
+// Clocks have a name and a period, the TimingConstraints builds those.
+// A column is built on its first use and kept until the next Bind().
+class ObjectProperties {
+ public:
+  typedef ObjectNames::Kind Kind;
+  enum Type : uint8_t { Number, Symbol, Name };
+  struct Column {
+    Type m_type = Number;
+    std::vector<double> m_numbers;
+    // Properties with few values: the index of the value of each object
+    // in m_symbolNames
+    std::vector<uint32_t> m_symbols;
+    std::vector<std::string> m_symbolNames;
+  };
+
+  // Drops the columns, names must outlive the binding
+  void Bind(const ObjectNames* names);
+  // Column of property for objects of kind, nullptr when they have no
+  // such property. Not for clocks.
+  const Column* Get(Kind kind, std::string_view property);
+  // Space separated, for error messages
+  static const char* PropertyNames(Kind kind);
+
+ private:
+  bool Build(Kind kind, std::string_view property, Column& column) const;
+
+  const ObjectNames* m_names = nullptr;
+  std::map<std::pair<Kind, std::string>, Column> m_columns;
+};
+
+// A -filter expression compiled against the property columns of a kind:
+//   expression := term ("||" term)...
+//   term       := factor ("&&" factor)...
+//   factor     := "!" factor | "(" expression ")" | property op value
+// op is one of == != < <= > >=, on numbers or strings, or =~ !~, a string
+// match pattern. A value is a number, a word or a "quoted string".
+//
+// Compile() resolves the properties once, into a postfix program. A test
+// of a symbol property becomes a table of the symbols passing it. Apply()
+// runs the program a block of objects at a time, each comparison a loop
+// over the block, the blocks in parallel.
+class ObjectFilter {
+ public:
+  typedef ObjectProperties::Kind Kind;
+  typedef ObjectProperties::Column Column;
+  // Column of a property of kind, nullptr when there is none
+  typedef std::function<const Column*(std::string_view property)>
+      ColumnSource;
+
+  bool Compile(Kind kind, std::string_view expression,
+               const ColumnSource& columns, std::string& error);
+  // Keeps the ids passing the filter, in order. The columns and names
+  // must be the ones compiled against.
+  void Apply(const ObjectNames& names, std::vector<uint32_t>& ids) const;
+
+ private:
+  enum Op : uint8_t { Leaf, And, Or, Not };
+  enum Comparison : uint8_t { Eq, Ne, Lt, Le, Gt, Ge, Match, NoMatch };
+  struct Instruction {
+    Op m_op = Leaf;
+    Comparison m_comparison = Eq;
+    const Column* m_column = nullptr;
+    double m_number = 0;
+    std::string m_text;
+    // Of a symbol column: passes, by symbol
+    std::vector<uint8_t> m_table;
+  };
+  class Parser;
+
+  static bool CompareText(Comparison comparison, std::string_view value,
+                          std::string_view operand);
+  void EvaluateLeaf(const Instruction& leaf, const ObjectNames& names,
+                    const uint32_t* ids, size_t count, uint8_t* pass) const;
+  void Evaluate(const ObjectNames& names, const uint32_t* ids,
+                size_t count, uint8_t* pass) const;
+
+  Kind m_kind = ObjectNames::Cell;
+  std::vector<Instruction> m_program;
+  size_t m_depth = 0;  // of the evaluation stack
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,313 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/ObjectNames.h"
+
+#include <algorithm>
+
+#include "Compiler/CellPlacement.h"
+
+using namespace FOEDAG;
+
+namespace {
+constexpr const char* kWildcards = "*?[\\";
+
+// [chars] at pattern[open], next set past its closing bracket
+bool MatchClass(std::string_view pattern, size_t open, char c,
+                size_t& next) {
+  bool match = false;
+  size_t p = open + 1;
+  while (p < pattern.size() && pattern[p] != ']') {
+    char first = pattern[p];
+    if (first == '\\' && p + 1 < pattern.size()) first = pattern[++p];
+    char last = first;
+    if (p + 2 < pattern.size() && pattern[p + 1] == '-' &&
+        pattern[p + 2] != ']') {
+      last = pattern[p + 2];
+      p += 2;
+    }
+    if (first > last) std::swap(first, last);
+    if (c >= first && c <= last) match = true;
+    p++;
+  }
+  next = std::min(p + 1, pattern.size());
+  return match;
+}
+}  // namespace
+
+void ObjectNames::Bind(const Netlist* netlist) {
+  m_netlist = netlist;
+  m_sortedCells.clear();
+  m_sortedNets.clear();
+}
+
+bool ObjectNames::IsKind(Kind kind, uint32_t id) const {
+  switch (kind) {
+    case Port:
+      return CellPlacement::IsPort(m_netlist->CellType(id));
+    case Cell: {
+      const std::string_view type = m_netlist->CellType(id);
+      return !CellPlacement::IsPort(type) && !CellPlacement::IsConstant(type);
+    }
+    case Pin:
+      return IsKind(Cell, m_netlist->PinCell(id));
+    case Net:
+      return true;
+    case Clock:
+      return false;
+  }
+  return false;
+}
+
+uint32_t ObjectNames::Find(Kind kind, std::string_view name) const {
+  if (m_netlist == nullptr) return kNone;
+  switch (kind) {
+    case Port:
+    case Cell: {
+      const Netlist::CellId cell = m_netlist->FindCell(name);
+      return (cell != kNone && IsKind(kind, cell)) ? cell : kNone;
+    }
+    case Pin: {
+      const size_t slash = name.rfind('/');
+      if (slash == std::string_view::npos) return kNone;
+      const Netlist::CellId cell = m_netlist->FindCell(name.substr(0, slash));
+      if (cell == kNone || !IsKind(Cell, cell)) return kNone;
+      const std::string_view pin = name.substr(slash + 1);
+      for (Netlist::PinId id : m_netlist->CellPins(cell)) {
+        if (m_netlist->PinName(id) == pin) return id;
+      }
+      return kNone;
+    }
+    case Net:
+      return m_netlist->FindNet(name);
+    case Clock:
+      return kNone;
+  }
+  return kNone;
+}
+
+void ObjectNames::SortCells() {
+  if (!m_sortedCells.empty() || m_netlist->CellCount() == 0) return;
+  m_sortedCells.resize(m_netlist->CellCount());
+  for (uint32_t cell = 0; cell < m_sortedCells.size(); cell++) {
+    m_sortedCells[cell] = cell;
+  }
+  std::sort(m_sortedCells.begin(), m_sortedCells.end(),
+            [this](uint32_t a, uint32_t b) {
+              return m_netlist->CellName(a) < m_netlist->CellName(b);
+            });
+}
+
+void ObjectNames::SortNets() {
+  if (!m_sortedNets.empty() || m_netlist->NetCount() == 0) return;
+  m_sortedNets.resize(m_netlist->NetCount());
+  for (uint32_t net = 0; net < m_sortedNets.size(); net++) {
+    m_sortedNets[net] = net;
+  }
+  std::sort(m_sortedNets.begin(), m_sortedNets.end(),
+            [this](uint32_t a, uint32_t b) {
+              return m_netlist->NetName(a) < m_netlist->NetName(b);
+            });
+}
+
+template <typename NameOf>
+std::pair<const uint32_t*, const uint32_t*> ObjectNames::PrefixRange(
+    const std::vector<uint32_t>& sorted, std::string_view prefix,
+    NameOf name) {
+  const uint32_t* begin = sorted.data();
+  const uint32_t* end = begin + sorted.size();
+  begin = std::lower_bound(begin, end, prefix,
+                           [&name](uint32_t id, std::string_view prefix) {
+                             return name(id) < prefix;
+                           });
+  end = std::partition_point(begin, end, [&name, prefix](uint32_t id) {
+    return name(id).compare(0, prefix.size(), prefix) == 0;
+  });
+  return {begin, end};
+}
+
+void ObjectNames::MatchPins(std::string_view pattern,
+                            std::string_view prefix,
+                            std::vector<uint32_t>& ids) {
+  std::string name;
+  auto matchCell = [&](Netlist::CellId cell) {
+    if (!IsKind(Cell, cell)) return;
+    const std::string_view cellName = m_netlist->CellName(cell);
+    for (Netlist::PinId pin : m_netlist->CellPins(cell)) {
+      name.assign(cellName);
+      name += '/';
+      name += m_netlist->PinName(pin);
+      if (GlobMatch(pattern, name)) ids.push_back(pin);
+    }
+  };
+  // <cell>/<pin> starts with the prefix when the cell does, or when the
+  // cell is the prefix up to one of its slashes
+  for (size_t slash = prefix.find('/'); slash != std::string_view::npos;
+       slash = prefix.find('/', slash + 1)) {
+    const Netlist::CellId cell = m_netlist->FindCell(prefix.substr(0, slash));
+    if (cell != kNone) matchCell(cell);
+  }
+  SortCells();
+  auto range = PrefixRange(m_sortedCells, prefix, [this](uint32_t cell) {
+    return m_netlist->CellName(cell);
+  });
+  for (const uint32_t* cell = range.first; cell != range.second; cell++) {
+    matchCell(*cell);
+  }
+}
+
+void ObjectNames::Match(Kind kind, std::string_view pattern,
+                        std::vector<uint32_t>& ids) {
+  if (m_netlist == nullptr || kind == Clock) return;
+  if (!IsPattern(pattern)) {
+    const uint32_t id = Find(kind, pattern);
+    if (id != kNone) ids.push_back(id);
+    return;
+  }
+  if (pattern == "*") {
+    // Everything, in id order
+    const size_t count = kind == Pin   ? m_netlist->PinCount()
+                         : kind == Net ? m_netlist->NetCount()
+                                       : m_netlist->CellCount();
+    for (uint32_t id = 0; id < count; id++) {
+      if (IsKind(kind, id)) ids.push_back(id);
+    }
+    return;
+  }
+  const std::string_view prefix =
+      pattern.substr(0, pattern.find_first_of(kWildcards));
+  if (kind == Pin) {
+    MatchPins(pattern, prefix, ids);
+    return;
+  }
+  if (kind == Net) {
+    SortNets();
+    auto name = [this](uint32_t net) { return m_netlist->NetName(net); };
+    auto range = PrefixRange(m_sortedNets, prefix, name);
+    for (const uint32_t* net = range.first; net != range.second; net++) {
+      if (GlobMatch(pattern, name(*net))) ids.push_back(*net);
+    }
+    return;
+  }
+  SortCells();
+  auto name = [this](uint32_t cell) { return m_netlist->CellName(cell); };
+  auto range = PrefixRange(m_sortedCells, prefix, name);
+  for (const uint32_t* cell = range.first; cell != range.second; cell++) {
+    if (IsKind(kind, *cell) && GlobMatch(pattern, name(*cell))) {
+      ids.push_back(*cell);
+    }
+  }
+}
+
+std::string ObjectNames::Name(Kind kind, uint32_t id) const {
+  switch (kind) {
+    case Port:
+    case Cell:
+      return std::string(m_netlist->CellName(id));
+    case Pin:
+      return std::string(m_netlist->CellName(m_netlist->PinCell(id))) + "/" +
+             std::string(m_netlist->PinName(id));
+    case Net:
+      return std::string(m_netlist->NetName(id));
+    case Clock:
+      break;
+  }
+  return std::string();
+}
+
+std::string_view ObjectNames::Name(Kind kind, uint32_t id,
+                                   std::string& scratch) const {
+  switch (kind) {
+    case Port:
+    case Cell:
+      return m_netlist->CellName(id);
+    case Pin:
+      scratch.assign(m_netlist->CellName(m_netlist->PinCell(id)));
+      scratch += '/';
+      scratch += m_netlist->PinName(id);
+      return scratch;
+    case Net:
+      return m_netlist->NetName(id);
+    case Clock:
+      break;
+  }
+  return std::string_view();
+}
+
+const char* ObjectNames::KindName(Kind kind) {
+  switch (kind) {
+    case Port:
+      return "port";
+    case Cell:
+      return "cell";
+    case Pin:
+      return "pin";
+    case Net:
+      return "net";
+    case Clock:
+      return "clock";
+  }
+  return "";
+}
+
+bool ObjectNames::IsPattern(std::string_view name) {
+  return name.find_first_of(kWildcards) != std::string_view::npos;
+}
+
+bool ObjectNames::GlobMatch(std::string_view pattern, std::string_view name) {
+  size_t p = 0, n = 0;
+  // Position after the last star and the name position it stands for,
+  // to backtrack to
+  size_t star = std::string_view::npos, mark = 0;
+  while (n < name.size()) {
+    if (p < pattern.size()) {
+      const char c = pattern[p];
+      if (c == '*') {
+        star = ++p;
+        mark = n;
+        continue;
+      }
+      size_t next = p + 1;
+      bool match;
+      if (c == '?') {
+        match = true;
+      } else if (c == '[') {
+        match = MatchClass(pattern, p, name[n], next);
+      } else if (c == '\\' && p + 1 < pattern.size()) {
+        match = pattern[p + 1] == name[n];
+        next = p + 2;
+      } else {
+        match = c == name[n];
+      }
+      if (match) {
+        p = next;
+        n++;
+        continue;
+      }
+    }
+    if (star == std::string_view::npos) return false;
+    p = star;
+    n = ++mark;
+  }
+  while (p < pattern.size() && pattern[p] == '*') p++;
+  return p == pattern.size();
+}
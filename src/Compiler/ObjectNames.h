@@ -0,0 +1,89 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Compiler/Netlist.h"
+
+#ifndef OBJECT_NAMES_H
+#define OBJECT_NAMES_H
+
+namespace FOEDAG {
+
+// Name table of the netlist objects the SDC queries return: ports (the
+// port cells), cells, pins named <cell>/<pin> and nets. Clocks are
+// objects too, named by the constraints.
+//
+// An exact name goes through the hash indexes of the Netlist, a pin
+// through the one of its cell. A glob pattern (string match syntax)
+// only scans the names starting with its literal prefix: cells and nets
+// are sorted by name once, on the first pattern of their kind, and the
+// prefix selects a range of them by binary search. The pins of a pattern
+// are the ones of the cells its prefix selects.
+class ObjectNames {
+ public:
+  enum Kind : uint8_t { Port, Cell, Pin, Net, Clock };
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // Drops the indexes, netlist must be finalized
+  void Bind(const Netlist* netlist);
+  const Netlist* GetNetlist() const { return m_netlist; }
+
+  // Object of kind named name, kNone when there is none. Not for clocks.
+  uint32_t Find(Kind kind, std::string_view name) const;
+  // Appends the objects of kind matching pattern, all of them in id order
+  // for *
+  void Match(Kind kind, std::string_view pattern,
+             std::vector<uint32_t>& ids);
+  std::string Name(Kind kind, uint32_t id) const;
+  // The same, made in scratch when the netlist does not hold it
+  std::string_view Name(Kind kind, uint32_t id, std::string& scratch) const;
+  // Cell of a port or cell object, pins of the port cells excluded
+  bool IsKind(Kind kind, uint32_t id) const;
+
+  static const char* KindName(Kind kind);
+  // Holds a wildcard, or an escape
+  static bool IsPattern(std::string_view name);
+  // Tcl string match: *, ?, [chars] with ranges and \ escapes
+  static bool GlobMatch(std::string_view pattern, std::string_view name);
+
+ private:
+  void SortCells();
+  void SortNets();
+  // Sorted ids in [begin, end) whose name starts with prefix
+  template <typename NameOf>
+  static std::pair<const uint32_t*, const uint32_t*> PrefixRange(
+      const std::vector<uint32_t>& sorted, std::string_view prefix,
+      NameOf name);
+  void MatchPins(std::string_view pattern, std::string_view prefix,
+                 std::vector<uint32_t>& ids);
+
+  const Netlist* m_netlist = nullptr;
+  std::vector<uint32_t> m_sortedCells;
+  std::vector<uint32_t> m_sortedNets;
+};
+
+}  // namespace FOEDAG
+
+#endif
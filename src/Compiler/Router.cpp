@@ -0,0 +1,640 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/Router.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+
+typedef RoutingGraph::NodeId NodeId;
+
+// Regions with fewer nets, or smaller than twice this many tiles per side,
+// are not cut further
+constexpr size_t kMinRegionNets = 32;
+constexpr uint32_t kMinRegionSide = 8;
+// Nodes per task when updating the congestion costs
+constexpr size_t kGrain = 16384;
+// Route trees larger than this only start the searches from their nodes
+// around the sink, in tiles
+constexpr size_t kWholeTreeNodes = 256;
+constexpr int kTreeRadius = 3;
+
+// Tiles, bounds included
+struct Box {
+  uint32_t m_x0, m_y0, m_x1, m_y1;
+  bool Contains(uint32_t x, uint32_t y) const {
+    return x >= m_x0 && x <= m_x1 && y >= m_y0 && y <= m_y1;
+  }
+};
+
+struct Sink {
+  NodeId m_node;
+  float m_criticality;
+  uint32_t m_distance;
+};
+
+struct Net {
+  Netlist::NetId m_id;
+  NodeId m_source;
+  Box m_box;
+  std::vector<Sink> m_sinks;  // in routing order, most critical first
+  // Route tree, see Routing
+  std::vector<NodeId> m_nodes;
+  std::vector<uint32_t> m_parents;
+  uint32_t m_wires = 0;
+};
+
+struct Region {
+  Box m_box;
+  std::vector<uint32_t> m_nets;  // in routing order
+};
+
+struct HeapItem {
+  float m_total;  // cost so far plus the estimate to the target
+  float m_cost;
+  NodeId m_node;
+};
+// Heap order, the cheapest on top and ties broken by node so that the
+// search does not depend on the heap history
+bool Later(const HeapItem& a, const HeapItem& b) {
+  if (a.m_total != b.m_total) return a.m_total > b.m_total;
+  return a.m_node > b.m_node;
+}
+
+// Search state of a thread, sized to the graph once. Stamps tell the
+// entries of the current search and of the current route tree from stale
+// ones, nothing is cleared between searches.
+struct Scratch {
+  explicit Scratch(size_t nodes)
+      : m_cost(nodes),
+        m_previous(nodes),
+        m_visit(nodes, 0),
+        m_treeMark(nodes, 0),
+        m_treeIndex(nodes) {}
+
+  static void Next(uint32_t& stamp, std::vector<uint32_t>& marks) {
+    if (++stamp != 0) return;
+    std::fill(marks.begin(), marks.end(), 0);
+    stamp = 1;
+  }
+
+  std::vector<float> m_cost;
+  std::vector<NodeId> m_previous;
+  std::vector<uint32_t> m_visit;
+  std::vector<uint32_t> m_treeMark;
+  std::vector<uint32_t> m_treeIndex;
+  uint32_t m_search = 0;
+  uint32_t m_tree = 0;
+  std::vector<HeapItem> m_heap;
+  std::vector<float> m_treeDelay;  // indexed like the tree nodes
+  std::vector<NodeId> m_path;
+  uint64_t m_expanded = 0;
+};
+
+class Engine {
+ public:
+  Engine(const Netlist& netlist, const CellPlacement& placement,
+         const RoutingGraph& graph, const Router::Options& options,
+         Router::Stats& stats, std::string& error)
+      : m_netlist(netlist),
+        m_placement(placement),
+        m_graph(graph),
+        m_options(options),
+        m_stats(stats),
+        m_error(error),
+        m_scheduler(TaskScheduler::Instance()) {}
+
+  bool Run(Routing& routing);
+
+ private:
+  void Tile(Netlist::CellId cell, uint32_t& x, uint32_t& y) const;
+  void Setup();
+  // Criticality of the sinks from the one of their pins, indexed by PinId
+  void SetCriticality(const std::vector<float>& criticality);
+  void SortSinks(Net& net) const;
+  // The routes of every net when routed, none otherwise
+  void Export(Routing& routing, bool routed) const;
+  void BuildRegions(const Box& box, std::vector<uint32_t>& nets,
+                    size_t level);
+  float Congestion(NodeId node, float presentFactor) const {
+    const int32_t over =
+        m_occupancy[node] + 1 - (int32_t)m_graph.Capacity(node);
+    const float present = (over > 0) ? 1 + presentFactor * over : 1;
+    return m_graph.BaseCost(node) * m_history[node] * present;
+  }
+  bool Overused(const Net& net) const;
+  void Occupy(const Net& net, int32_t delta);
+  uint32_t AddTreeNode(Net& net, Scratch& scratch, NodeId node,
+                       uint32_t parent);
+  bool Search(const Net& net, const Sink& sink, Scratch& scratch,
+              float presentFactor);
+  bool RouteNet(Net& net, Scratch& scratch, float presentFactor);
+  Scratch* AcquireScratch();
+  void ReleaseScratch(Scratch* scratch);
+
+  const Netlist& m_netlist;
+  const CellPlacement& m_placement;
+  const RoutingGraph& m_graph;
+  const Router::Options& m_options;
+  Router::Stats& m_stats;
+  std::string& m_error;
+  TaskScheduler* m_scheduler;
+
+  std::vector<Net> m_nets;  // NetId order
+  std::vector<std::vector<Region>> m_levels;
+  std::vector<int32_t> m_occupancy;
+  std::vector<float> m_history;
+  // Delay to congestion cost units: one tile of wire costs as much either
+  // way, which keeps the A* estimate independent of the criticality
+  float m_delayScale = 1;
+  const RouterLookahead* m_lookahead = nullptr;
+
+  std::mutex m_scratchMutex;
+  std::vector<std::unique_ptr<Scratch>> m_scratch;
+  std::vector<Scratch*> m_freeScratch;
+  std::atomic<uint64_t> m_expanded{0};
+};
+
+void Engine::Tile(Netlist::CellId cell, uint32_t& x, uint32_t& y) const {
+  // Ports sit on the die boundary, at the edge of the outer tiles
+  const int64_t column = (int64_t)std::floor(m_placement.X(cell));
+  const int64_t row = (int64_t)std::floor(m_placement.Y(cell));
+  x = (uint32_t)std::clamp<int64_t>(column, 0, m_graph.Columns() - 1);
+  y = (uint32_t)std::clamp<int64_t>(row, 0, m_graph.Rows() - 1);
+}
+
+void Engine::Setup() {
+  const bool given = m_options.m_criticality.size() == m_netlist.PinCount();
+  uint32_t longest = 1;
+  for (Netlist::NetId id : m_netlist.Nets()) {
+    const Netlist::PinId driver = m_netlist.NetDriver(id);
+    if (driver == Netlist::kNone) continue;
+    const Netlist::CellId driverCell = m_netlist.PinCell(driver);
+    if (CellPlacement::IsConstant(m_netlist.CellType(driverCell))) continue;
+    Net net;
+    net.m_id = id;
+    uint32_t sx, sy;
+    Tile(driverCell, sx, sy);
+    net.m_source = m_graph.SourceNode(sx, sy);
+    net.m_box = Box{sx, sy, sx, sy};
+    for (Netlist::PinId pin : m_netlist.NetPins(id)) {
+      if (pin == driver || m_netlist.PinDirection(pin) == Netlist::Output) {
+        continue;
+      }
+      uint32_t x, y;
+      Tile(m_netlist.PinCell(pin), x, y);
+      // Within the tile of the driver, no wire needed
+      if (x == sx && y == sy) continue;
+      const uint32_t distance = (uint32_t)(std::abs((int)x - (int)sx) +
+                                           std::abs((int)y - (int)sy));
+      longest = std::max(longest, distance);
+      net.m_sinks.push_back(Sink{m_graph.SinkNode(x, y),
+                                 given ? m_options.m_criticality[pin] : 0,
+                                 distance});
+      net.m_box.m_x0 = std::min(net.m_box.m_x0, x);
+      net.m_box.m_y0 = std::min(net.m_box.m_y0, y);
+      net.m_box.m_x1 = std::max(net.m_box.m_x1, x);
+      net.m_box.m_y1 = std::max(net.m_box.m_y1, y);
+    }
+    if (net.m_sinks.empty()) continue;
+    // One connection per sink tile, as critical as its most critical pin
+    std::sort(net.m_sinks.begin(), net.m_sinks.end(),
+              [](const Sink& a, const Sink& b) {
+                if (a.m_node != b.m_node) return a.m_node < b.m_node;
+                return a.m_criticality > b.m_criticality;
+              });
+    net.m_sinks.erase(std::unique(net.m_sinks.begin(), net.m_sinks.end(),
+                                  [](const Sink& a, const Sink& b) {
+                                    return a.m_node == b.m_node;
+                                  }),
+                      net.m_sinks.end());
+    const uint32_t margin = m_options.m_boxMargin;
+    Box& box = net.m_box;
+    box.m_x0 = (box.m_x0 > margin) ? box.m_x0 - margin : 0;
+    box.m_y0 = (box.m_y0 > margin) ? box.m_y0 - margin : 0;
+    box.m_x1 = std::min(box.m_x1 + margin, m_graph.Columns() - 1);
+    box.m_y1 = std::min(box.m_y1 + margin, m_graph.Rows() - 1);
+    m_stats.m_connections += net.m_sinks.size();
+    m_nets.push_back(std::move(net));
+  }
+  for (Net& net : m_nets) {
+    for (Sink& sink : net.m_sinks) {
+      if (!given) {
+        sink.m_criticality =
+            (float)m_options.m_maxCriticality * sink.m_distance / longest;
+      }
+      sink.m_criticality =
+          std::min(sink.m_criticality, m_options.m_maxCriticality);
+    }
+    SortSinks(net);
+  }
+  m_stats.m_nets = m_nets.size();
+
+  std::vector<uint32_t> nets(m_nets.size());
+  for (uint32_t i = 0; i < nets.size(); i++) nets[i] = i;
+  BuildRegions(Box{0, 0, m_graph.Columns() - 1, m_graph.Rows() - 1}, nets,
+               0);
+  for (auto& level : m_levels) m_stats.m_regions += level.size();
+
+  m_occupancy.assign(m_graph.NodeCount(), 0);
+  m_history.assign(m_graph.NodeCount(), 1);
+  m_delayScale = m_graph.MinWireCost() / m_graph.MinWireDelay();
+  if (m_options.m_lookahead && m_options.m_lookahead->Matches(m_graph)) {
+    m_lookahead = m_options.m_lookahead.get();
+  }
+}
+
+// Nets crossing the cut stay in the region, the others go down to its
+// halves. The largest nets of a region are routed first.
+void Engine::SetCriticality(const std::vector<float>& criticality) {
+  for (Net& net : m_nets) {
+    for (Sink& sink : net.m_sinks) sink.m_criticality = 0;
+    const Netlist::PinId driver = m_netlist.NetDriver(net.m_id);
+    for (Netlist::PinId pin : m_netlist.NetPins(net.m_id)) {
+      if (pin == driver || m_netlist.PinDirection(pin) == Netlist::Output) {
+        continue;
+      }
+      uint32_t x, y;
+      Tile(m_netlist.PinCell(pin), x, y);
+      const NodeId node = m_graph.SinkNode(x, y);
+      for (Sink& sink : net.m_sinks) {
+        if (sink.m_node != node) continue;
+        sink.m_criticality =
+            std::min(std::max(sink.m_criticality, criticality[pin]),
+                     m_options.m_maxCriticality);
+        break;
+      }
+    }
+    SortSinks(net);
+  }
+}
+
+void Engine::SortSinks(Net& net) const {
+  std::sort(net.m_sinks.begin(), net.m_sinks.end(),
+            [](const Sink& a, const Sink& b) {
+              if (a.m_criticality != b.m_criticality) {
+                return a.m_criticality > b.m_criticality;
+              }
+              if (a.m_distance != b.m_distance) {
+                return a.m_distance > b.m_distance;
+              }
+              return a.m_node < b.m_node;
+            });
+}
+
+void Engine::Export(Routing& routing, bool routed) const {
+  routing.Reset(routed ? m_netlist.NetCount() : 0, m_graph.Columns(),
+                m_graph.Rows(), m_graph.ChannelWidth());
+  if (!routed) return;
+  static const std::vector<NodeId> kNoNodes;
+  static const std::vector<uint32_t> kNoParents;
+  size_t next = 0;
+  for (Netlist::NetId id : m_netlist.Nets()) {
+    if (next < m_nets.size() && m_nets[next].m_id == id) {
+      const Net& net = m_nets[next++];
+      routing.AppendRoute(net.m_nodes, net.m_parents, net.m_wires);
+    } else {
+      routing.AppendRoute(kNoNodes, kNoParents, 0);
+    }
+  }
+}
+
+void Engine::BuildRegions(const Box& box, std::vector<uint32_t>& nets,
+                          size_t level) {
+  Region region{box, {}};
+  const uint32_t width = box.m_x1 - box.m_x0 + 1;
+  const uint32_t height = box.m_y1 - box.m_y0 + 1;
+  if (nets.size() >= kMinRegionNets &&
+      std::max(width, height) >= 2 * kMinRegionSide) {
+    const bool vertical = width >= height;
+    const uint32_t cut =
+        vertical ? box.m_x0 + width / 2 : box.m_y0 + height / 2;
+    std::vector<uint32_t> low, high;
+    for (uint32_t index : nets) {
+      const Box& netBox = m_nets[index].m_box;
+      const uint32_t first = vertical ? netBox.m_x0 : netBox.m_y0;
+      const uint32_t last = vertical ? netBox.m_x1 : netBox.m_y1;
+      if (last < cut) {
+        low.push_back(index);
+      } else if (first >= cut) {
+        high.push_back(index);
+      } else {
+        region.m_nets.push_back(index);
+      }
+    }
+    Box lowBox = box, highBox = box;
+    if (vertical) {
+      lowBox.m_x1 = cut - 1;
+      highBox.m_x0 = cut;
+    } else {
+      lowBox.m_y1 = cut - 1;
+      highBox.m_y0 = cut;
+    }
+    if (!low.empty()) BuildRegions(lowBox, low, level + 1);
+    if (!high.empty()) BuildRegions(highBox, high, level + 1);
+  } else {
+    region.m_nets = nets;
+  }
+  if (region.m_nets.empty()) return;
+  std::sort(region.m_nets.begin(), region.m_nets.end(),
+            [this](uint32_t a, uint32_t b) {
+              const size_t sinksA = m_nets[a].m_sinks.size();
+              const size_t sinksB = m_nets[b].m_sinks.size();
+              if (sinksA != sinksB) return sinksA > sinksB;
+              return a < b;
+            });
+  if (m_levels.size() <= level) m_levels.resize(level + 1);
+  m_levels[level].push_back(std::move(region));
+}
+
+bool Engine::Overused(const Net& net) const {
+  for (NodeId node : net.m_nodes) {
+    if (m_occupancy[node] > (int32_t)m_graph.Capacity(node)) return true;
+  }
+  return false;
+}
+
+void Engine::Occupy(const Net& net, int32_t delta) {
+  for (NodeId node : net.m_nodes) m_occupancy[node] += delta;
+}
+
+uint32_t Engine::AddTreeNode(Net& net, Scratch& scratch, NodeId node,
+                             uint32_t parent) {
+  const uint32_t index = (uint32_t)net.m_nodes.size();
+  net.m_nodes.push_back(node);
+  net.m_parents.push_back(parent);
+  const float delay = (parent == Netlist::kNone)
+                          ? 0
+                          : scratch.m_treeDelay[parent] + m_graph.Delay(node);
+  scratch.m_treeDelay.push_back(delay);
+  scratch.m_treeMark[node] = scratch.m_tree;
+  scratch.m_treeIndex[node] = index;
+  if (m_graph.IsWire(node)) net.m_wires++;
+  return index;
+}
+
+// A* from every node of the route tree to the sink, within the net box
+bool Engine::Search(const Net& net, const Sink& sink, Scratch& scratch,
+                    float presentFactor) {
+  Scratch::Next(scratch.m_search, scratch.m_visit);
+  const uint32_t search = scratch.m_search;
+  const NodeId target = sink.m_node;
+  const int targetX = m_graph.X(target), targetY = m_graph.Y(target);
+  const float criticality = sink.m_criticality;
+  const float delayWeight = criticality * m_delayScale;
+  const float congestionWeight = 1 - criticality;
+  const float factor = (float)m_options.m_astarFactor;
+  const float perTile = factor * m_graph.MinWireCost();
+  const RouterLookahead* lookahead = m_lookahead;
+  auto estimate = [&](NodeId node) {
+    const uint32_t dx = std::abs(m_graph.X(node) - targetX);
+    const uint32_t dy = std::abs(m_graph.Y(node) - targetY);
+    const RoutingGraph::Segment segment = m_graph.NodeSegment(node);
+    if (lookahead == nullptr || segment == RoutingGraph::kNoSegment) {
+      return perTile * (float)(dx + dy);
+    }
+    return factor *
+           (congestionWeight * lookahead->Cost(segment, dx, dy) +
+            delayWeight * lookahead->Delay(segment, dx, dy));
+  };
+  std::vector<HeapItem>& heap = scratch.m_heap;
+  heap.clear();
+  // The nodes of a large tree far from the sink would each cost a heap
+  // entry and rarely be where the connection starts
+  int radius = (net.m_nodes.size() > kWholeTreeNodes) ? kTreeRadius : -1;
+  while (heap.empty()) {
+    for (uint32_t i = 0; i < net.m_nodes.size(); i++) {
+      const NodeId node = net.m_nodes[i];
+      if (m_graph.Type(node) == RoutingGraph::Sink) continue;
+      if (radius >= 0 && std::abs(m_graph.X(node) - targetX) +
+                                 std::abs(m_graph.Y(node) - targetY) >
+                             radius) {
+        continue;
+      }
+      const float cost = delayWeight * scratch.m_treeDelay[i];
+      scratch.m_visit[node] = search;
+      scratch.m_cost[node] = cost;
+      heap.push_back(HeapItem{cost + estimate(node), cost, node});
+    }
+    radius *= 2;
+  }
+  std::make_heap(heap.begin(), heap.end(), Later);
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), Later);
+    const HeapItem item = heap.back();
+    heap.pop_back();
+    if (item.m_cost > scratch.m_cost[item.m_node]) continue;
+    scratch.m_expanded++;
+    if (item.m_node == target) return true;
+    for (NodeId next : m_graph.Edges(item.m_node)) {
+      if (m_graph.IsWire(next)) {
+        if (!net.m_box.Contains(m_graph.X(next), m_graph.Y(next))) continue;
+      } else if (next != target) {
+        continue;
+      }
+      const float cost = item.m_cost + delayWeight * m_graph.Delay(next) +
+                         congestionWeight * Congestion(next, presentFactor);
+      if (scratch.m_visit[next] == search && cost >= scratch.m_cost[next]) {
+        continue;
+      }
+      scratch.m_visit[next] = search;
+      scratch.m_cost[next] = cost;
+      scratch.m_previous[next] = item.m_node;
+      heap.push_back(HeapItem{cost + estimate(next), cost, next});
+      std::push_heap(heap.begin(), heap.end(), Later);
+    }
+  }
+  return false;
+}
+
+bool Engine::RouteNet(Net& net, Scratch& scratch, float presentFactor) {
+  Scratch::Next(scratch.m_tree, scratch.m_treeMark);
+  net.m_nodes.clear();
+  net.m_parents.clear();
+  net.m_wires = 0;
+  scratch.m_treeDelay.clear();
+  AddTreeNode(net, scratch, net.m_source, Netlist::kNone);
+  for (const Sink& sink : net.m_sinks) {
+    if (!Search(net, sink, scratch, presentFactor)) return false;
+    // Back to the tree, then down again to the sink
+    std::vector<NodeId>& path = scratch.m_path;
+    path.clear();
+    NodeId node = sink.m_node;
+    while (scratch.m_treeMark[node] != scratch.m_tree) {
+      path.push_back(node);
+      node = scratch.m_previous[node];
+    }
+    uint32_t parent = scratch.m_treeIndex[node];
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      parent = AddTreeNode(net, scratch, *it, parent);
+    }
+  }
+  return true;
+}
+
+Scratch* Engine::AcquireScratch() {
+  std::lock_guard<std::mutex> lock(m_scratchMutex);
+  if (m_freeScratch.empty()) {
+    m_scratch.push_back(std::make_unique<Scratch>(m_graph.NodeCount()));
+    return m_scratch.back().get();
+  }
+  Scratch* scratch = m_freeScratch.back();
+  m_freeScratch.pop_back();
+  return scratch;
+}
+
+void Engine::ReleaseScratch(Scratch* scratch) {
+  m_expanded += scratch->m_expanded;
+  scratch->m_expanded = 0;
+  std::lock_guard<std::mutex> lock(m_scratchMutex);
+  m_freeScratch.push_back(scratch);
+}
+
+bool Engine::Run(Routing& routing) {
+  Setup();
+  std::vector<Routing::Iteration> iterations;
+  auto finish = [&](bool routed) {
+    Export(routing, routed);
+    routing.Iterations() = iterations;
+    return routed;
+  };
+
+  double presentFactor = m_options.m_initialPresentFactor;
+  for (int iteration = 1; iteration <= m_options.m_maxIterations;
+       iteration++) {
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> rerouted{0};
+    std::atomic<bool> failed{false};
+    m_expanded = 0;
+    for (std::vector<Region>& level : m_levels) {
+      m_scheduler->ParallelFor(
+          0, level.size(), 1,
+          [&](size_t begin, size_t end) {
+            Scratch* scratch = AcquireScratch();
+            for (size_t r = begin; r < end; r++) {
+              for (uint32_t index : level[r].m_nets) {
+                if (m_options.m_cancel.Cancelled()) break;
+                Net& net = m_nets[index];
+                if (iteration > 1 && !Overused(net)) continue;
+                Occupy(net, -1);
+                if (!RouteNet(net, *scratch, (float)presentFactor)) {
+                  failed = true;
+                }
+                Occupy(net, 1);
+                rerouted++;
+              }
+            }
+            ReleaseScratch(scratch);
+          },
+          m_options.m_threads);
+    }
+    if (m_options.m_cancel.Cancelled()) return finish(false);
+    if (failed) {
+      m_error = "a net has no path between its pins";
+      return finish(false);
+    }
+
+    // Nodes still overused get more expensive for good
+    const size_t nodes = m_graph.NodeCount();
+    std::vector<uint64_t> partial((nodes + kGrain - 1) / kGrain, 0);
+    const float historyFactor = (float)m_options.m_historyFactor;
+    m_scheduler->ParallelFor(
+        0, nodes, kGrain,
+        [&](size_t begin, size_t end) {
+          uint64_t overused = 0;
+          for (size_t node = begin; node < end; node++) {
+            const int32_t over = m_occupancy[node] -
+                                 (int32_t)m_graph.Capacity((NodeId)node);
+            if (over <= 0) continue;
+            overused++;
+            m_history[node] += historyFactor * over;
+          }
+          partial[begin / kGrain] = overused;
+        },
+        m_options.m_threads);
+    Routing::Iteration stats;
+    stats.m_iteration = (uint32_t)iteration;
+    stats.m_rerouted = rerouted;
+    for (uint64_t count : partial) stats.m_overused += count;
+    for (const Net& net : m_nets) stats.m_wirelength += net.m_wires;
+    stats.m_expanded = m_expanded;
+    stats.m_seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    iterations.push_back(stats);
+    m_stats.m_iterations = iteration;
+    m_stats.m_overused = stats.m_overused;
+    m_stats.m_wirelength = stats.m_wirelength;
+    m_stats.m_expanded += stats.m_expanded;
+    if (m_options.m_iteration) m_options.m_iteration(stats);
+    if (stats.m_overused == 0) return finish(true);
+    presentFactor *= m_options.m_presentFactorMultiplier;
+    // The nets still to route again see the delays of the routes so far
+    if (m_options.m_timingUpdate && m_options.m_timingInterval > 0 &&
+        iteration % m_options.m_timingInterval == 0) {
+      Routing routes;
+      Export(routes, true);
+      std::vector<float> criticality;
+      m_options.m_timingUpdate(routes, criticality);
+      if (criticality.size() == m_netlist.PinCount()) {
+        SetCriticality(criticality);
+      }
+    }
+  }
+  m_error = "routing did not converge in " +
+            std::to_string(m_options.m_maxIterations) + " iterations, " +
+            std::to_string(m_stats.m_overused) + " nodes are overused";
+  return finish(false);
+}
+
+}  // namespace
+
+bool Router::Route(const Netlist& netlist, const CellPlacement& placement,
+                   const RoutingGraph& graph, Routing& routing) {
+  auto start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  m_error.clear();
+  if (placement.Size() != netlist.CellCount()) {
+    m_error = "the netlist is not placed";
+    return false;
+  }
+  if (graph.Empty()) {
+    m_error = "the routing graph is empty";
+    return false;
+  }
+  Engine engine(netlist, placement, graph, m_options, m_stats, m_error);
+  const bool done = engine.Run(routing);
+  m_stats.m_seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return done;
+}
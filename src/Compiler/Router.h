@@ -0,0 +1,116 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/EventBus.h"
+#include "Compiler/Netlist.h"
+#include "Compiler/RouterLookahead.h"
+#include "Compiler/Routing.h"
+#include "Compiler/RoutingGraph.h"
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+namespace FOEDAG {
+
+// Timing driven negotiated congestion (PathFinder) router. Every iteration
+// rips up and routes again the nets using an overused node, all of them
+// the first time. Each connection is an A* search from the current route
+// tree of its net. The cost of a node grows with its present overuse and
+// its overuse history, until no node carries more nets than its capacity.
+// Connections blend delay and congestion by the criticality of their sink,
+// refreshed from the delays of the routes every few iterations when a
+// timing update is given.
+//
+// The A* estimate comes from the lookahead tables of the graph when given,
+// from the distance at the lowest wire cost per tile otherwise.
+//
+// Searches stay in the bounding box of their net, grown by a margin. The
+// die is cut in two recursively and every net goes to the smallest region
+// containing its box: the regions of a level share no node, so their nets
+// are routed in parallel, each region in a fixed order. The result does
+// not depend on the number of threads. Every thread has its own heap and
+// scratch arrays, sized to the graph once and reused by every search.
+class Router {
+ public:
+  struct Options {
+    int m_maxIterations = 50;
+    double m_initialPresentFactor = 0.5;
+    double m_presentFactorMultiplier = 1.3;
+    double m_historyFactor = 0.2;
+    // Weight of the A* estimate, above 1 trades quality for speed
+    double m_astarFactor = 1.2;
+    // Ignored unless computed on the graph being routed
+    std::shared_ptr<const RouterLookahead> m_lookahead;
+    uint32_t m_boxMargin = 3;
+    float m_maxCriticality = 0.99f;
+    // Criticality of the sinks, indexed by PinId. When empty, the longest
+    // connections are the most critical.
+    std::vector<float> m_criticality;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    CancellationToken m_cancel;
+    // Called after every iteration
+    std::function<void(const Routing::Iteration&)> m_iteration;
+    // Called every m_timingInterval iterations until the routes converge,
+    // with the routes so far: criticalities filled in, indexed by PinId,
+    // replace the ones of the sinks
+    std::function<void(const Routing&, std::vector<float>&)> m_timingUpdate;
+    int m_timingInterval = 4;
+  };
+  struct Stats {
+    size_t m_nets = 0;  // nets with wires to route
+    size_t m_connections = 0;
+    size_t m_regions = 0;
+    int m_iterations = 0;
+    uint64_t m_overused = 0;
+    uint64_t m_wirelength = 0;
+    uint64_t m_expanded = 0;
+    double m_seconds = 0;
+  };
+
+  Router() = default;
+  explicit Router(const Options& options) : m_options(options) {}
+
+  // False when cancelled, or when the nets still overuse the graph after
+  // the last iteration, see Error(). The routing keeps the iterations in
+  // both cases, the routes only on success.
+  bool Route(const Netlist& netlist, const CellPlacement& placement,
+             const RoutingGraph& graph, Routing& routing);
+
+  const Stats& GetStats() const { return m_stats; }
+  const std::string& Error() const { return m_error; }
+
+ private:
+  Options m_options;
+  Stats m_stats;
+  std::string m_error;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,227 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/RouterLookahead.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <set>
+#include <vector>
+
+#include "Compiler/Checkpoint.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+typedef RoutingGraph::NodeId NodeId;
+
+constexpr float kUnreached = std::numeric_limits<float>::infinity();
+constexpr size_t kMetaFields = 4;
+// Start tiles per corner, along the diagonal, for the phases of the L4
+// stagger
+constexpr uint32_t kCornerSamples = 4;
+
+// Cheapest first, the fastest of the same cost
+struct Label {
+  float m_cost;
+  float m_delay;
+  bool operator<(const Label& other) const {
+    return m_cost < other.m_cost ||
+           (m_cost == other.m_cost && m_delay < other.m_delay);
+  }
+};
+
+struct QueueItem {
+  Label m_label;
+  NodeId m_node;
+  bool operator>(const QueueItem& other) const {
+    return other.m_label < m_label;
+  }
+};
+
+// Labels of the sinks reached from the wires of segment starting on
+// (x, y), by tile offset
+void Explore(const RoutingGraph& graph, uint32_t x, uint32_t y,
+             RoutingGraph::Segment segment, std::vector<Label>& offsets) {
+  const Label unreached{kUnreached, kUnreached};
+  offsets.assign((size_t)graph.Columns() * graph.Rows(), unreached);
+  std::vector<Label> labels(graph.NodeCount(), unreached);
+  std::priority_queue<QueueItem, std::vector<QueueItem>,
+                      std::greater<QueueItem>>
+      queue;
+  for (NodeId wire : graph.Edges(graph.SourceNode(x, y))) {
+    if (graph.NodeSegment(wire) != segment) continue;
+    labels[wire] = Label{0, 0};
+    queue.push(QueueItem{labels[wire], wire});
+  }
+  while (!queue.empty()) {
+    const QueueItem item = queue.top();
+    queue.pop();
+    if (labels[item.m_node] < item.m_label) continue;
+    if (graph.Type(item.m_node) == RoutingGraph::Sink) {
+      const uint32_t dx = std::abs((int)graph.X(item.m_node) - (int)x);
+      const uint32_t dy = std::abs((int)graph.Y(item.m_node) - (int)y);
+      Label& offset = offsets[(size_t)dy * graph.Columns() + dx];
+      if (item.m_label < offset) offset = item.m_label;
+      continue;
+    }
+    for (NodeId next : graph.Edges(item.m_node)) {
+      const Label label{item.m_label.m_cost + graph.BaseCost(next),
+                        item.m_label.m_delay + graph.Delay(next)};
+      if (!(label < labels[next])) continue;
+      labels[next] = label;
+      queue.push(QueueItem{label, next});
+    }
+  }
+}
+}  // namespace
+
+void RouterLookahead::Clear() {
+  m_device.clear();
+  m_columns = m_rows = m_channelWidth = 0;
+  m_cost.clear();
+  m_delay.clear();
+  m_checkpoint.reset();
+}
+
+void RouterLookahead::Compute(const RoutingGraph& graph,
+                              unsigned int threads) {
+  Clear();
+  if (graph.Empty()) return;
+  const uint32_t columns = graph.Columns(), rows = graph.Rows();
+  std::set<std::pair<uint32_t, uint32_t>> tiles;
+  for (uint32_t k = 0; k < kCornerSamples; k++) {
+    const uint32_t x = std::min(k, columns - 1), y = std::min(k, rows - 1);
+    tiles.insert({x, y});
+  }
+  struct Job {
+    uint32_t m_x, m_y;
+    RoutingGraph::Segment m_segment;
+    std::vector<Label> m_offsets;
+  };
+  std::vector<Job> jobs;
+  for (auto& tile : tiles) {
+    for (uint32_t segment = 0; segment < RoutingGraph::kSegmentCount;
+         segment++) {
+      if (graph.Tracks((RoutingGraph::Segment)segment) == 0) continue;
+      jobs.push_back(Job{tile.first, tile.second,
+                         (RoutingGraph::Segment)segment, {}});
+    }
+  }
+  TaskScheduler::Instance()->ParallelFor(
+      0, jobs.size(), 1,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          Explore(graph, jobs[i].m_x, jobs[i].m_y, jobs[i].m_segment,
+                  jobs[i].m_offsets);
+        }
+      },
+      threads);
+
+  // The minimum does not depend on the order the jobs ran in
+  const size_t tilesCount = (size_t)columns * rows;
+  std::vector<Label> best(RoutingGraph::kSegmentCount * tilesCount,
+                          Label{kUnreached, kUnreached});
+  for (const Job& job : jobs) {
+    Label* table = best.data() + job.m_segment * tilesCount;
+    for (size_t i = 0; i < tilesCount; i++) {
+      if (job.m_offsets[i] < table[i]) table[i] = job.m_offsets[i];
+    }
+  }
+  // Offsets no search reached, or a segment type the graph lacks: the
+  // distance at the lowest cost and delay per tile
+  std::vector<float> cost(best.size()), delay(best.size());
+  for (size_t i = 0; i < best.size(); i++) {
+    const size_t tile = i % tilesCount;
+    const float distance = (float)(tile % columns + tile / columns);
+    cost[i] = std::isinf(best[i].m_cost) ? distance * graph.MinWireCost()
+                                         : best[i].m_cost;
+    delay[i] = std::isinf(best[i].m_delay)
+                   ? distance * graph.MinWireDelay()
+                   : best[i].m_delay;
+  }
+  m_device = graph.Device();
+  m_columns = columns;
+  m_rows = rows;
+  m_channelWidth = graph.ChannelWidth();
+  m_cost.Assign(std::move(cost));
+  m_delay.Assign(std::move(delay));
+}
+
+// Sections la.meta (schema version, columns, rows, channel width),
+// la.device, la.cost and la.delay
+bool RouterLookahead::Save(const std::string& path,
+                           std::string& error) const {
+  const uint32_t meta[kMetaFields] = {kSchemaVersion, m_columns, m_rows,
+                                      m_channelWidth};
+  CheckpointWriter writer;
+  bool ok =
+      writer.Open(path) && writer.WriteArray("la.meta", meta, kMetaFields) &&
+      writer.WriteSection("la.device", m_device.data(), m_device.size()) &&
+      writer.WriteArray("la.cost", m_cost.data(), m_cost.size()) &&
+      writer.WriteArray("la.delay", m_delay.data(), m_delay.size());
+  if (!ok || !writer.Close()) {
+    error = writer.Error().empty() ? "cannot write " + path : writer.Error();
+    return false;
+  }
+  return true;
+}
+
+bool RouterLookahead::Load(const std::string& path, std::string& error) {
+  Clear();
+  std::shared_ptr<const MappedCheckpoint> checkpoint =
+      MappedCheckpoint::Open(path, error);
+  if (!checkpoint) return false;
+  size_t count = 0;
+  const uint32_t* meta = checkpoint->Array<uint32_t>("la.meta", count);
+  if (count != kMetaFields || meta[0] != kSchemaVersion) {
+    error = path + ": not a router lookahead of schema version " +
+            std::to_string(kSchemaVersion);
+    return false;
+  }
+  const size_t entries =
+      (size_t)RoutingGraph::kSegmentCount * meta[1] * meta[2];
+  size_t costs = 0, delays = 0;
+  const float* cost = checkpoint->Array<float>("la.cost", costs);
+  const float* delay = checkpoint->Array<float>("la.delay", delays);
+  bool ok = costs == entries && delays == entries;
+  // Lower bounds of A*: a negative or NaN one from a damaged file would
+  // make the router give up on reachable sinks
+  for (size_t entry = 0; ok && entry < entries; entry++) {
+    ok = cost[entry] >= 0 && delay[entry] >= 0;
+  }
+  if (!ok) {
+    error = path + ": invalid router lookahead";
+    return false;
+  }
+  m_device = std::string(checkpoint->Section("la.device"));
+  m_columns = meta[1];
+  m_rows = meta[2];
+  m_channelWidth = meta[3];
+  m_cost.View(cost, costs);
+  m_delay.View(delay, delays);
+  m_checkpoint = checkpoint;
+  return true;
+}
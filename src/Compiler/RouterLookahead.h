@@ -0,0 +1,97 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Compiler/Netlist.h"
+#include "Compiler/RoutingGraph.h"
+
+#ifndef ROUTER_LOOKAHEAD_H
+#define ROUTER_LOOKAHEAD_H
+
+namespace FOEDAG {
+
+class MappedCheckpoint;
+
+// A* estimate of the router: lowest base cost and delay from a wire of
+// each segment type to the sink of a tile dx, dy tiles away from the first
+// tile of the wire, congestion aside. The graph is the same everywhere but
+// at the edges and the L4 stagger, so a few start tiles near each corner
+// tell every offset: one Dijkstra search per start tile and segment type,
+// in parallel. Tables are (segment, dy, dx) arrays of floats, saved as a
+// checkpoint file and mapped back in place like the routing graph.
+class RouterLookahead {
+ public:
+  // Bumped whenever the table content changes, stale files are recomputed
+  static constexpr uint32_t kSchemaVersion = 1;
+
+  RouterLookahead() = default;
+  RouterLookahead(const RouterLookahead&) = delete;
+  RouterLookahead& operator=(const RouterLookahead&) = delete;
+
+  // 0 threads for the TaskScheduler concurrency
+  void Compute(const RoutingGraph& graph, unsigned int threads = 0);
+  void Clear();
+
+  bool Save(const std::string& path, std::string& error) const;
+  bool Load(const std::string& path, std::string& error);
+  bool IsView() const { return m_checkpoint != nullptr; }
+
+  bool Empty() const { return m_cost.empty(); }
+  // RoutingGraph::Device() of the graph the tables come from
+  const std::string& Device() const { return m_device; }
+  uint32_t Columns() const { return m_columns; }
+  uint32_t Rows() const { return m_rows; }
+  uint32_t ChannelWidth() const { return m_channelWidth; }
+  bool Matches(const RoutingGraph& graph) const {
+    return !Empty() && m_device == graph.Device() &&
+           m_columns == graph.Columns() && m_rows == graph.Rows() &&
+           m_channelWidth == graph.ChannelWidth();
+  }
+
+  float Cost(RoutingGraph::Segment segment, uint32_t dx, uint32_t dy) const {
+    return m_cost[Index(segment, dx, dy)];
+  }
+  // ns
+  float Delay(RoutingGraph::Segment segment, uint32_t dx,
+              uint32_t dy) const {
+    return m_delay[Index(segment, dx, dy)];
+  }
+
+ private:
+  size_t Index(uint32_t segment, uint32_t dx, uint32_t dy) const {
+    return ((size_t)segment * m_rows + dy) * m_columns + dx;
+  }
+
+  std::string m_device;
+  uint32_t m_columns = 0;
+  uint32_t m_rows = 0;
+  uint32_t m_channelWidth = 0;
+  MappedArray<float> m_cost;
+  MappedArray<float> m_delay;
+  std::shared_ptr<const MappedCheckpoint> m_checkpoint;
+};
+
+}  // namespace FOEDAG
+
+#endif
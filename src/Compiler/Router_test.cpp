@@ -0,0 +1,439 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Router.h"
+
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Compiler/Checkpoint.h"
+#include "Compiler/Test/TestDesigns.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// Trees of graph edges from the driver tile to every sink tile, without
+// any wire used twice
+void ExpectLegal(const Netlist& netlist, const CellPlacement& placement,
+                 const RoutingGraph& graph, const Routing& routing) {
+  ASSERT_EQ(routing.NetCount(), netlist.NetCount());
+  std::set<RoutingGraph::NodeId> used;
+  uint64_t wires = 0;
+  for (Netlist::NetId net : netlist.Nets()) {
+    Netlist::IdSpan nodes = routing.Nodes(net);
+    Netlist::IdSpan parents = routing.Parents(net);
+    std::set<RoutingGraph::NodeId> reached;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      if (i == 0) {
+        EXPECT_EQ(parents[0], Netlist::kNone);
+        EXPECT_EQ(graph.Type(nodes[0]), RoutingGraph::Source);
+        continue;
+      }
+      ASSERT_LT(parents[i], i);
+      Netlist::IdSpan edges = graph.Edges(nodes[parents[i]]);
+      EXPECT_NE(std::find(edges.begin(), edges.end(), nodes[i]),
+                edges.end());
+      if (graph.IsWire(nodes[i])) {
+        EXPECT_TRUE(used.insert(nodes[i]).second);
+        wires++;
+      }
+      reached.insert(nodes[i]);
+    }
+    for (Netlist::PinId pin : netlist.NetPins(net)) {
+      if (netlist.PinDirection(pin) != Netlist::Input) continue;
+      const Netlist::CellId cell = netlist.PinCell(pin);
+      const Netlist::CellId driver =
+          netlist.PinCell(netlist.NetDriver(net));
+      const RoutingGraph::NodeId sink = graph.SinkNode(
+          (uint32_t)placement.X(cell), (uint32_t)placement.Y(cell));
+      if (sink == graph.SinkNode((uint32_t)placement.X(driver),
+                                 (uint32_t)placement.Y(driver))) {
+        continue;
+      }
+      EXPECT_TRUE(reached.count(sink)) << netlist.NetName(net);
+    }
+  }
+  EXPECT_EQ(wires, routing.Wirelength());
+}
+
+TEST(RoutingGraph, IsACompactIslandFabric) {
+  RoutingGraph graph;
+  graph.Build(3, 2, 4);
+  EXPECT_EQ(graph.NodeCount(), 3u * 2 * (2 + 2 * 4));
+  const RoutingGraph::NodeId source = graph.SourceNode(1, 1);
+  EXPECT_EQ(graph.Type(source), RoutingGraph::Source);
+  EXPECT_EQ(graph.Type(graph.SinkNode(1, 1)), RoutingGraph::Sink);
+  EXPECT_EQ(graph.Edges(source).size(), 8u);
+  EXPECT_TRUE(graph.Edges(graph.SinkNode(1, 1)).empty());
+  for (RoutingGraph::NodeId next : graph.Edges(source)) {
+    EXPECT_TRUE(graph.IsWire(next));
+    EXPECT_EQ(graph.X(next), 1);
+    EXPECT_EQ(graph.Y(next), 1);
+    EXPECT_EQ(graph.Capacity(next), 1);
+    // Along the track, two turns and the sink; the top row has no wire
+    // above
+    const size_t along = graph.Type(next) == RoutingGraph::ChanX ? 2 : 1;
+    EXPECT_EQ(graph.Edges(next).size(), along + 3);
+  }
+}
+
+TEST(RoutingGraph, HasStaggeredLengthFourWires) {
+  RoutingGraph graph;
+  graph.Build(10, 3, 16);
+  EXPECT_EQ(graph.Tracks(RoutingGraph::L1), 12u);
+  EXPECT_EQ(graph.Tracks(RoutingGraph::L4), 4u);
+  // One L4 wire per direction starts in every tile
+  EXPECT_EQ(graph.NodeCount(), 10u * 3 * (2 + 2 * (12 + 1)));
+  EXPECT_FLOAT_EQ(graph.MinWireCost(), 1.0f);
+  EXPECT_FLOAT_EQ(graph.MinWireDelay(), 0.0625f);
+  size_t l4 = 0;
+  for (RoutingGraph::NodeId next : graph.Edges(graph.SourceNode(4, 1))) {
+    if (graph.NodeSegment(next) != RoutingGraph::L4) continue;
+    l4++;
+    if (graph.Type(next) != RoutingGraph::ChanX) continue;
+    // Continues 4 tiles away both ways, reaches the sinks of x 4 to 7
+    std::set<uint32_t> wires, sinks;
+    for (RoutingGraph::NodeId node : graph.Edges(next)) {
+      if (graph.NodeSegment(node) == RoutingGraph::L4) {
+        wires.insert(graph.X(node));
+      } else if (graph.Type(node) == RoutingGraph::Sink) {
+        sinks.insert(graph.X(node));
+      }
+    }
+    EXPECT_EQ(wires, std::set<uint32_t>({0, 8}));
+    EXPECT_EQ(sinks, std::set<uint32_t>({4, 5, 6, 7}));
+  }
+  EXPECT_EQ(l4, 2u);
+}
+
+TEST(RoutingGraph, MapsBackWhatItSaved) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_graph_test.rrg")
+          .string();
+  RoutingGraph graph;
+  graph.Build(12, 9, 24);
+  std::string error;
+  ASSERT_TRUE(graph.Save(path, error)) << error;
+  RoutingGraph mapped;
+  ASSERT_TRUE(mapped.Load(path, error)) << error;
+  EXPECT_TRUE(mapped.IsView());
+  EXPECT_EQ(mapped.MemoryBytes(), 0u);
+  EXPECT_EQ(mapped.Device(), graph.Device());
+  EXPECT_EQ(mapped.NodeCount(), graph.NodeCount());
+  EXPECT_EQ(mapped.EdgeCount(), graph.EdgeCount());
+  EXPECT_EQ(mapped.MinWireDelay(), graph.MinWireDelay());
+  for (RoutingGraph::NodeId node = 0; node < graph.NodeCount(); node++) {
+    ASSERT_EQ(mapped.Delay(node), graph.Delay(node));
+    ASSERT_EQ(mapped.X(node), graph.X(node));
+    Netlist::IdSpan a = graph.Edges(node), b = mapped.Edges(node);
+    ASSERT_EQ(std::vector<uint32_t>(a.begin(), a.end()),
+              std::vector<uint32_t>(b.begin(), b.end()));
+  }
+  std::filesystem::remove(path);
+  EXPECT_FALSE(mapped.Load(path, error));
+}
+
+// Rewrites the checkpoint at path with size bytes of data at the start of
+// its section name
+void OverwriteSection(const std::string& path, const std::string& name,
+                      const void* data, size_t size) {
+  std::vector<std::pair<std::string, std::string>> sections;
+  std::string error;
+  {
+    auto checkpoint = MappedCheckpoint::Open(path, error);
+    ASSERT_TRUE(checkpoint) << error;
+    for (const std::string& section : checkpoint->SectionNames()) {
+      sections.emplace_back(section,
+                            std::string(checkpoint->Section(section)));
+    }
+  }
+  CheckpointWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  for (auto& section : sections) {
+    if (section.first == name) std::memcpy(&section.second[0], data, size);
+    writer.WriteSection(section.first, section.second.data(),
+                        section.second.size());
+  }
+  ASSERT_TRUE(writer.Close()) << writer.Error();
+}
+
+TEST(RoutingGraph, RefusesEdgesOutOfTheGraph) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_graph_bad.rrg")
+          .string();
+  RoutingGraph graph;
+  graph.Build(6, 6, 8);
+  std::string error;
+  ASSERT_TRUE(graph.Save(path, error)) << error;
+  // The same file, but for an edge to a node past the last one
+  const uint32_t node = (uint32_t)graph.NodeCount();
+  OverwriteSection(path, "rrg.edge_targets", &node, sizeof(node));
+  RoutingGraph mapped;
+  EXPECT_FALSE(mapped.Load(path, error));
+  EXPECT_THAT(error, testing::HasSubstr("invalid routing graph"));
+  std::filesystem::remove(path);
+}
+
+TEST(RoutingGraph, CacheSharesOneGraphPerDevice) {
+  const std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "foedag_arch_cache_test";
+  std::filesystem::remove_all(dir);
+  RoutingGraphCache* cache = RoutingGraphCache::Instance();
+  const std::string previous = cache->Directory();
+  cache->SetDirectory(dir.string());
+  DeviceModel device;
+  device.BuildGeneric(7, 5);
+  const RoutingGraphCache::Stats start = cache->GetStats();
+  std::string error;
+  auto first = cache->Get(device, 12, error);
+  ASSERT_TRUE(first) << error;
+  auto second = cache->Get(device, 12, error);
+  EXPECT_EQ(first, second);
+  EXPECT_TRUE(first->IsView());
+  EXPECT_TRUE(std::filesystem::exists(dir / cache->FileName(device, 12)));
+  EXPECT_EQ(cache->FileName(device, 12), "generic_7x5_w12_v" +
+                std::to_string(RoutingGraph::kSchemaVersion) + ".rrg");
+  // Mapped from the file once no longer in use
+  first.reset();
+  second.reset();
+  auto third = cache->Get(device, 12, error);
+  ASSERT_TRUE(third);
+  EXPECT_EQ(third->Columns(), 7u);
+  auto other = cache->Get(device, 16, error);
+  ASSERT_TRUE(other);
+  EXPECT_NE(third, other);
+  const RoutingGraphCache::Stats end = cache->GetStats();
+  EXPECT_EQ(end.m_built - start.m_built, 2u);
+  EXPECT_EQ(end.m_shared - start.m_shared, 1u);
+  EXPECT_EQ(end.m_loaded - start.m_loaded, 1u);
+  // The lookahead of a graph is computed once, then mapped from its file
+  auto lookahead = cache->GetLookahead(device, *third);
+  ASSERT_TRUE(lookahead && lookahead->Matches(*third));
+  EXPECT_EQ(cache->GetLookahead(device, *third), lookahead);
+  lookahead.reset();
+  EXPECT_TRUE(cache->GetLookahead(device, *third)->IsView());
+  const RoutingGraphCache::Stats last = cache->GetStats();
+  EXPECT_EQ(last.m_lookaheadsComputed - start.m_lookaheadsComputed, 1u);
+  EXPECT_EQ(last.m_lookaheadsLoaded - start.m_lookaheadsLoaded, 1u);
+  cache->SetDirectory(previous);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(Router, RoutesOnLengthFourWires) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 20, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 20);
+  RoutingGraph graph;
+  graph.Build(20, 20, 16);
+  Router router;
+  Routing routing;
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing))
+      << router.Error();
+  ExpectLegal(netlist, placement, graph, routing);
+  bool l4 = false;
+  for (Netlist::NetId net : netlist.Nets()) {
+    for (RoutingGraph::NodeId node : routing.Nodes(net)) {
+      l4 |= graph.NodeSegment(node) == RoutingGraph::L4;
+    }
+  }
+  EXPECT_TRUE(l4);
+}
+
+TEST(RouterLookahead, IsTheCheapestPathOfTheGraph) {
+  RoutingGraph graph;
+  graph.Build(12, 9, 16);
+  RouterLookahead lookahead;
+  lookahead.Compute(graph, 2);
+  ASSERT_TRUE(lookahead.Matches(graph));
+  EXPECT_FLOAT_EQ(lookahead.Cost(RoutingGraph::L1, 0, 0), 0);
+  // Along the track, then into the sink
+  EXPECT_FLOAT_EQ(lookahead.Cost(RoutingGraph::L1, 5, 0), 5);
+  EXPECT_FLOAT_EQ(lookahead.Delay(RoutingGraph::L1, 5, 0), 0.55f);
+  // A turn takes a wire of the crossing channel in the same tile
+  EXPECT_FLOAT_EQ(lookahead.Cost(RoutingGraph::L1, 2, 3), 6);
+  // An L4 wire reaches the sinks of the tiles it spans
+  EXPECT_FLOAT_EQ(lookahead.Cost(RoutingGraph::L4, 3, 0), 0);
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_lookahead.test")
+          .string();
+  std::string error;
+  ASSERT_TRUE(lookahead.Save(path, error)) << error;
+  RouterLookahead mapped;
+  ASSERT_TRUE(mapped.Load(path, error)) << error;
+  EXPECT_TRUE(mapped.IsView());
+  EXPECT_TRUE(mapped.Matches(graph));
+  for (uint32_t dy = 0; dy < graph.Rows(); dy++) {
+    for (uint32_t dx = 0; dx < graph.Columns(); dx++) {
+      ASSERT_EQ(mapped.Cost(RoutingGraph::L4, dx, dy),
+                lookahead.Cost(RoutingGraph::L4, dx, dy));
+    }
+  }
+  // A lower bound that is not one is refused
+  const float negative = -1;
+  OverwriteSection(path, "la.delay", &negative, sizeof(negative));
+  RouterLookahead damaged;
+  EXPECT_FALSE(damaged.Load(path, error));
+  std::filesystem::remove(path);
+  RoutingGraph other;
+  other.Build(12, 9, 24);
+  EXPECT_FALSE(mapped.Matches(other));
+}
+
+TEST(RouterLookahead, ExpandsFewerNodes) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 20, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 20);
+  RoutingGraph graph;
+  graph.Build(20, 20, 16);
+  Router::Options options;
+  Router plain(options);
+  Routing routing;
+  ASSERT_TRUE(plain.Route(netlist, placement, graph, routing));
+  auto lookahead = std::make_shared<RouterLookahead>();
+  lookahead->Compute(graph);
+  options.m_lookahead = lookahead;
+  Router router(options);
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing))
+      << router.Error();
+  ExpectLegal(netlist, placement, graph, routing);
+  EXPECT_LT(router.GetStats().m_expanded, plain.GetStats().m_expanded);
+}
+
+TEST(Router, RoutesEveryConnection) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 20, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 20);
+  RoutingGraph graph;
+  graph.Build(20, 20, 6);
+  Router router;
+  Routing routing;
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing))
+      << router.Error();
+  const Router::Stats& stats = router.GetStats();
+  EXPECT_GT(stats.m_nets, 100u);
+  EXPECT_EQ(stats.m_overused, 0u);
+  EXPECT_EQ(routing.Iterations().size(), (size_t)stats.m_iterations);
+  EXPECT_EQ(routing.Iterations().back().m_overused, 0u);
+  EXPECT_GT(stats.m_regions, 1u);
+  ExpectLegal(netlist, placement, graph, routing);
+
+  // Round trip through the stage result image
+  Routing copy;
+  ASSERT_TRUE(copy.Deserialize(routing.Serialize()));
+  EXPECT_EQ(copy.Serialize(), routing.Serialize());
+  EXPECT_EQ(copy.Wirelength(), routing.Wirelength());
+  EXPECT_EQ(copy.Iterations().size(), routing.Iterations().size());
+}
+
+TEST(Router, NegotiatesCongestion) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 16, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 16);
+  RoutingGraph graph;
+  graph.Build(16, 16, 6);
+  Router router;
+  Routing routing;
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing))
+      << router.Error();
+  // The first iteration ignores the others, the next ones settle the
+  // overuse
+  EXPECT_GT(routing.Iterations().front().m_overused, 0u);
+  EXPECT_GT(router.GetStats().m_iterations, 1);
+  ExpectLegal(netlist, placement, graph, routing);
+}
+
+TEST(Router, RefreshesCriticalitiesFromTheRoutes) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 16, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 16);
+  RoutingGraph graph;
+  graph.Build(16, 16, 6);
+  Router::Options options;
+  options.m_timingInterval = 1;
+  int updates = 0;
+  options.m_timingUpdate = [&](const Routing& routes,
+                               std::vector<float>& criticality) {
+    updates++;
+    EXPECT_EQ(routes.NetCount(), netlist.NetCount());
+    criticality.assign(netlist.PinCount(), 0.5f);
+  };
+  Router router(options);
+  Routing routing;
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing))
+      << router.Error();
+  // After every iteration but the last one, which converged
+  EXPECT_GT(updates, 0);
+  EXPECT_EQ(updates, router.GetStats().m_iterations - 1);
+  ExpectLegal(netlist, placement, graph, routing);
+}
+
+TEST(Router, SameResultWithAnyThreadCount) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 24, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 24);
+  RoutingGraph graph;
+  graph.Build(24, 24, 8);
+  Routing routings[2];
+  for (int run = 0; run < 2; run++) {
+    Router::Options options;
+    options.m_threads = (run == 0) ? 1 : 4;
+    Router router(options);
+    ASSERT_TRUE(router.Route(netlist, placement, graph, routings[run]));
+  }
+  EXPECT_EQ(routings[0].Serialize().substr(0, 40),
+            routings[1].Serialize().substr(0, 40));
+  for (Netlist::NetId net : netlist.Nets()) {
+    Netlist::IdSpan a = routings[0].Nodes(net), b = routings[1].Nodes(net);
+    ASSERT_EQ(std::vector<uint32_t>(a.begin(), a.end()),
+              std::vector<uint32_t>(b.begin(), b.end()));
+  }
+}
+
+TEST(Router, FailsWhenTheChannelsAreTooNarrow) {
+  Netlist netlist;
+  CellPlacement placement;
+  BuildMesh(netlist, 12, MeshPorts::None);
+  PlaceMeshInBlocks(netlist, placement, 12);
+  RoutingGraph graph;
+  graph.Build(12, 12, 1);
+  Router::Options options;
+  options.m_maxIterations = 5;
+  Router router(options);
+  Routing routing;
+  EXPECT_FALSE(router.Route(netlist, placement, graph, routing));
+  EXPECT_THAT(router.Error(), testing::HasSubstr("did not converge"));
+  EXPECT_TRUE(routing.Empty());
+  EXPECT_EQ(routing.Iterations().size(), 5u);
+}
+}  // namespace
+}  // namespace FOEDAG
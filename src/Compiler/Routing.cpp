@@ -0,0 +1,189 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/Routing.h"
+
+#include <cstring>
+
+#include "Compiler/Checkpoint.h"
+
+using namespace FOEDAG;
+
+void Routing::Reset(size_t nets, uint32_t columns, uint32_t rows,
+                    uint32_t channelWidth) {
+  m_columns = columns;
+  m_rows = rows;
+  m_channelWidth = channelWidth;
+  m_netBegin.assign(1, 0);
+  m_netBegin.reserve(nets + 1);
+  m_nodes.clear();
+  m_parents.clear();
+  m_iterations.clear();
+  m_wirelength = 0;
+}
+
+void Routing::AppendRoute(const std::vector<RoutingGraph::NodeId>& nodes,
+                          const std::vector<uint32_t>& parents,
+                          uint32_t wires) {
+  m_nodes.insert(m_nodes.end(), nodes.begin(), nodes.end());
+  m_parents.insert(m_parents.end(), parents.begin(), parents.end());
+  m_netBegin.push_back((uint32_t)m_nodes.size());
+  m_wirelength += wires;
+}
+
+namespace {
+// Header: columns, rows, channel width, then the counts of nets, nodes and
+// iterations and the wirelength
+struct Header {
+  uint32_t m_graph[3];
+  uint64_t m_counts[3];
+  uint64_t m_wirelength;
+};
+constexpr size_t kIterationFields = 6;
+
+void PackIterations(const std::vector<Routing::Iteration>& iterations,
+                    std::vector<uint64_t>& fields) {
+  fields.clear();
+  for (const Routing::Iteration& iteration : iterations) {
+    uint64_t seconds;
+    memcpy(&seconds, &iteration.m_seconds, sizeof(seconds));
+    fields.insert(fields.end(),
+                  {iteration.m_iteration, iteration.m_rerouted,
+                   iteration.m_overused, iteration.m_wirelength,
+                   iteration.m_expanded, seconds});
+  }
+}
+
+void UnpackIterations(const uint64_t* fields, size_t count,
+                      std::vector<Routing::Iteration>& iterations) {
+  iterations.resize(count);
+  for (size_t i = 0; i < count; i++, fields += kIterationFields) {
+    Routing::Iteration& iteration = iterations[i];
+    iteration.m_iteration = (uint32_t)fields[0];
+    iteration.m_rerouted = fields[1];
+    iteration.m_overused = fields[2];
+    iteration.m_wirelength = fields[3];
+    iteration.m_expanded = fields[4];
+    memcpy(&iteration.m_seconds, &fields[5], sizeof(double));
+  }
+}
+}  // namespace
+
+bool Routing::Save(CheckpointWriter& writer) const {
+  if (Empty()) return true;
+  const uint64_t header[4] = {m_columns, m_rows, m_channelWidth,
+                              m_wirelength};
+  std::vector<uint64_t> iterations;
+  PackIterations(m_iterations, iterations);
+  return writer.WriteArray("routing.header", header, 4) &&
+         writer.WriteArray("routing.net_begin", m_netBegin.data(),
+                           m_netBegin.size()) &&
+         writer.WriteArray("routing.nodes", m_nodes.data(), m_nodes.size()) &&
+         writer.WriteArray("routing.parents", m_parents.data(),
+                           m_parents.size()) &&
+         writer.WriteArray("routing.iterations", iterations.data(),
+                           iterations.size());
+}
+
+bool Routing::Load(const MappedCheckpoint& checkpoint, std::string& error) {
+  Clear();
+  if (!checkpoint.Has("routing.header")) return true;
+  size_t count = 0, offsets = 0, nodes = 0, parents = 0, fields = 0;
+  const uint64_t* header =
+      checkpoint.Array<uint64_t>("routing.header", count);
+  const uint32_t* netBegin =
+      checkpoint.Array<uint32_t>("routing.net_begin", offsets);
+  const uint32_t* nodeData = checkpoint.Array<uint32_t>("routing.nodes", nodes);
+  const uint32_t* parentData =
+      checkpoint.Array<uint32_t>("routing.parents", parents);
+  const uint64_t* iterations =
+      checkpoint.Array<uint64_t>("routing.iterations", fields);
+  if (count != 4 || offsets == 0 || parents != nodes ||
+      netBegin[offsets - 1] != nodes || fields % kIterationFields != 0) {
+    error = "invalid routing in checkpoint";
+    return false;
+  }
+  m_columns = (uint32_t)header[0];
+  m_rows = (uint32_t)header[1];
+  m_channelWidth = (uint32_t)header[2];
+  m_wirelength = header[3];
+  m_netBegin.assign(netBegin, netBegin + offsets);
+  m_nodes.assign(nodeData, nodeData + nodes);
+  m_parents.assign(parentData, parentData + parents);
+  UnpackIterations(iterations, fields / kIterationFields, m_iterations);
+  return true;
+}
+
+std::string Routing::Serialize() const {
+  Header header;
+  memset(&header, 0, sizeof(header));  // no garbage in the padding
+  header.m_graph[0] = m_columns;
+  header.m_graph[1] = m_rows;
+  header.m_graph[2] = m_channelWidth;
+  header.m_counts[0] = m_netBegin.size() - 1;
+  header.m_counts[1] = m_nodes.size();
+  header.m_counts[2] = m_iterations.size();
+  header.m_wirelength = m_wirelength;
+  std::vector<uint64_t> iterations;
+  PackIterations(m_iterations, iterations);
+  std::string data;
+  data.append((const char*)&header, sizeof(header));
+  data.append((const char*)m_netBegin.data(),
+              m_netBegin.size() * sizeof(uint32_t));
+  data.append((const char*)m_nodes.data(), m_nodes.size() * sizeof(uint32_t));
+  data.append((const char*)m_parents.data(),
+              m_parents.size() * sizeof(uint32_t));
+  data.append((const char*)iterations.data(),
+              iterations.size() * sizeof(uint64_t));
+  return data;
+}
+
+bool Routing::Deserialize(std::string_view data) {
+  Header header;
+  if (data.size() < sizeof(header)) return false;
+  memcpy(&header, data.data(), sizeof(header));
+  const uint64_t nets = header.m_counts[0];
+  const uint64_t nodes = header.m_counts[1];
+  const uint64_t iterations = header.m_counts[2];
+  if (data.size() != sizeof(header) + (nets + 1 + 2 * nodes) * 4 +
+                         iterations * kIterationFields * 8) {
+    return false;
+  }
+  m_columns = header.m_graph[0];
+  m_rows = header.m_graph[1];
+  m_channelWidth = header.m_graph[2];
+  m_wirelength = header.m_wirelength;
+  const char* cursor = data.data() + sizeof(header);
+  m_netBegin.resize(nets + 1);
+  memcpy(m_netBegin.data(), cursor, (nets + 1) * 4);
+  cursor += (nets + 1) * 4;
+  m_nodes.resize(nodes);
+  memcpy(m_nodes.data(), cursor, nodes * 4);
+  cursor += nodes * 4;
+  m_parents.resize(nodes);
+  memcpy(m_parents.data(), cursor, nodes * 4);
+  cursor += nodes * 4;
+  std::vector<uint64_t> fields(iterations * kIterationFields);
+  memcpy(fields.data(), cursor, fields.size() * 8);
+  UnpackIterations(fields.data(), iterations, m_iterations);
+  return true;
+}
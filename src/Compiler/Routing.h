@@ -0,0 +1,105 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Compiler/Netlist.h"
+#include "Compiler/RoutingGraph.h"
+
+#ifndef ROUTING_H
+#define ROUTING_H
+
+namespace FOEDAG {
+
+class CheckpointWriter;
+class MappedCheckpoint;
+
+// Routes of the nets of a Netlist, indexed by NetId. A route is a tree of
+// RoutingGraph nodes, parents before their children and the source first;
+// nets without wires have an empty one. The graph is the one built for
+// Columns() x Rows() tiles and ChannelWidth() tracks. The iterations of the
+// router that produced the routes are kept with them.
+class Routing {
+ public:
+  struct Iteration {
+    uint32_t m_iteration = 0;
+    uint64_t m_rerouted = 0;    // nets ripped up and routed again
+    uint64_t m_overused = 0;    // nodes used beyond their capacity
+    uint64_t m_wirelength = 0;  // wire nodes used, in tiles
+    uint64_t m_expanded = 0;    // nodes taken off the search heaps
+    double m_seconds = 0;
+  };
+
+  void Reset(size_t nets, uint32_t columns, uint32_t rows,
+             uint32_t channelWidth);
+  void Clear() { Reset(0, 0, 0, 0); }
+
+  bool Empty() const { return m_netBegin.size() <= 1; }
+  size_t NetCount() const { return m_netBegin.size() - 1; }
+  uint32_t Columns() const { return m_columns; }
+  uint32_t Rows() const { return m_rows; }
+  uint32_t ChannelWidth() const { return m_channelWidth; }
+
+  Netlist::IdSpan Nodes(Netlist::NetId net) const {
+    return Netlist::IdSpan(m_nodes.data() + m_netBegin[net],
+                           m_nodes.data() + m_netBegin[net + 1]);
+  }
+  // Index in Nodes(net) of the parent of each node, kNone for the source
+  Netlist::IdSpan Parents(Netlist::NetId net) const {
+    return Netlist::IdSpan(m_parents.data() + m_netBegin[net],
+                           m_parents.data() + m_netBegin[net + 1]);
+  }
+  // Routes are set in NetId order, every net once; wires is the number
+  // of wire nodes of the route
+  void AppendRoute(const std::vector<RoutingGraph::NodeId>& nodes,
+                   const std::vector<uint32_t>& parents, uint32_t wires);
+
+  std::vector<Iteration>& Iterations() { return m_iterations; }
+  const std::vector<Iteration>& Iterations() const { return m_iterations; }
+  // Wire nodes used by all the routes
+  uint64_t Wirelength() const { return m_wirelength; }
+
+  // Checkpoint sections routing.*, nothing when empty
+  bool Save(CheckpointWriter& writer) const;
+  // Clears the routing when the checkpoint has none
+  bool Load(const MappedCheckpoint& checkpoint, std::string& error);
+
+  // Binary image for the stage results
+  std::string Serialize() const;
+  bool Deserialize(std::string_view data);
+
+ private:
+  uint32_t m_columns = 0;
+  uint32_t m_rows = 0;
+  uint32_t m_channelWidth = 0;
+  std::vector<uint32_t> m_netBegin{0};  // NetCount() + 1 offsets
+  std::vector<RoutingGraph::NodeId> m_nodes;
+  std::vector<uint32_t> m_parents;
+  std::vector<Iteration> m_iterations;
+  uint64_t m_wirelength = 0;
+};
+
+}  // namespace FOEDAG
+
+#endif
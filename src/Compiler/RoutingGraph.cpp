@@ -0,0 +1,466 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/RoutingGraph.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "Compiler/Checkpoint.h"
+#include "Compiler/RouterLookahead.h"
+#include "Compiler/StageCache.h"
+
+using namespace FOEDAG;
+
+namespace {
+// Delays of the wires and of the pin connections, ns, and the costs of the
+// wires, the same per tile spanned: L4 wires are faster per tile
+constexpr float kL1Delay = 0.1f;
+constexpr float kL4Delay = 0.25f;
+constexpr float kPinDelay = 0.05f;
+constexpr float kL1Cost = 1.0f;
+constexpr float kL4Cost = 4.0f;
+constexpr uint16_t kPinCapacity = UINT16_MAX;
+constexpr size_t kMetaFields = 6;
+
+std::string DeviceKey(const DeviceModel& device) {
+  if (!device.Generic()) return device.Spec();
+  return "generic " + std::to_string(device.Columns()) + " " +
+         std::to_string(device.Rows());
+}
+
+template <typename T>
+bool ViewArray(const MappedCheckpoint& checkpoint, const std::string& name,
+               size_t expected, MappedArray<T>& array) {
+  size_t count = 0;
+  const T* data = checkpoint.Array<T>(name, count);
+  if (count != expected) return false;
+  array.View(data, count);
+  return true;
+}
+}  // namespace
+
+void RoutingGraph::Clear() {
+  m_device.clear();
+  m_columns = m_rows = m_channelWidth = 0;
+  m_tracks[L1] = m_tracks[L4] = 0;
+  m_tileType.clear();
+  m_type.clear();
+  m_segment.clear();
+  m_x.clear();
+  m_y.clear();
+  m_capacity.clear();
+  m_baseCost.clear();
+  m_delay.clear();
+  m_edgeBegin.clear();
+  m_edgeTargets.clear();
+  m_minimums[0] = m_minimums[1] = 0;
+  m_checkpoint.reset();
+}
+
+void RoutingGraph::Build(uint32_t columns, uint32_t rows,
+                         uint32_t channelWidth) {
+  DeviceModel device;
+  device.BuildGeneric(columns, rows);
+  Build(device, channelWidth);
+}
+
+void RoutingGraph::Build(const DeviceModel& device, uint32_t channelWidth) {
+  Clear();
+  if (device.Empty() || channelWidth == 0) return;
+  m_device = DeviceKey(device);
+  m_columns = device.Columns();
+  m_rows = device.Rows();
+  m_channelWidth = channelWidth;
+  // A quarter of the tracks L4, by groups of four for the stagger
+  m_tracks[L4] = channelWidth / 4 / 4 * 4;
+  m_tracks[L1] = channelWidth - m_tracks[L4];
+  const uint32_t l1 = m_tracks[L1];
+  const uint32_t l4 = m_tracks[L4] / 4;  // starting in each tile
+  const uint32_t columns = m_columns, rows = m_rows;
+
+  std::vector<uint8_t> tileType(device.Sites().begin(),
+                                device.Sites().end());
+  const size_t nodes = (size_t)columns * rows * NodesPerTile();
+  std::vector<uint8_t> type(nodes), segment(nodes, kNoSegment);
+  std::vector<uint16_t> x(nodes), y(nodes), capacity(nodes, 1);
+  std::vector<float> baseCost(nodes), delay(nodes);
+  std::vector<uint32_t> edgeBegin;
+  std::vector<NodeId> edgeTargets;
+  edgeBegin.reserve(nodes + 1);
+  edgeTargets.reserve(nodes * 7);
+  edgeBegin.push_back(0);
+
+  // Wires by the tile they start in, L4 ones by their index among the
+  // ones starting there
+  auto x1 = [&](uint32_t tx, uint32_t ty, uint32_t track) {
+    return SourceNode(tx, ty) + 2 + track;
+  };
+  auto x4 = [&](uint32_t tx, uint32_t ty, uint32_t index) {
+    return SourceNode(tx, ty) + 2 + l1 + index;
+  };
+  auto y1 = [&](uint32_t tx, uint32_t ty, uint32_t track) {
+    return SourceNode(tx, ty) + 2 + l1 + l4 + track;
+  };
+  auto y4 = [&](uint32_t tx, uint32_t ty, uint32_t index) {
+    return SourceNode(tx, ty) + 2 + 2 * l1 + l4 + index;
+  };
+  auto endNode = [&]() {
+    edgeBegin.push_back((uint32_t)edgeTargets.size());
+  };
+  for (uint32_t ty = 0; ty < rows; ty++) {
+    for (uint32_t tx = 0; tx < columns; tx++) {
+      const NodeId source = SourceNode(tx, ty);
+      const NodeId sink = source + 1;
+      for (NodeId node = source; node < source + NodesPerTile(); node++) {
+        x[node] = (uint16_t)tx;
+        y[node] = (uint16_t)ty;
+      }
+      type[source] = Source;
+      type[sink] = Sink;
+      capacity[source] = capacity[sink] = kPinCapacity;
+      delay[sink] = kPinDelay;
+      for (uint32_t track = 0; track < l1; track++) {
+        edgeTargets.push_back(x1(tx, ty, track));
+        edgeTargets.push_back(y1(tx, ty, track));
+      }
+      for (uint32_t index = 0; index < l4; index++) {
+        edgeTargets.push_back(x4(tx, ty, index));
+        edgeTargets.push_back(y4(tx, ty, index));
+      }
+      endNode();
+      endNode();
+
+      for (int vertical = 0; vertical < 2; vertical++) {
+        const uint32_t along = vertical ? ty : tx;
+        const uint32_t length = vertical ? rows : columns;
+        auto same1 = [&](uint32_t position, uint32_t track) {
+          return vertical ? y1(tx, position, track) : x1(position, ty, track);
+        };
+        auto same4 = [&](uint32_t position, uint32_t index) {
+          return vertical ? y4(tx, position, index) : x4(position, ty, index);
+        };
+        auto cross1 = [&](uint32_t position, uint32_t track) {
+          return vertical ? x1(tx, position, track) : y1(position, ty, track);
+        };
+        auto sinkAt = [&](uint32_t position) {
+          return vertical ? SinkNode(tx, position) : SinkNode(position, ty);
+        };
+        for (uint32_t track = 0; track < l1; track++) {
+          const NodeId node = same1(along, track);
+          type[node] = vertical ? ChanY : ChanX;
+          segment[node] = L1;
+          baseCost[node] = kL1Cost;
+          delay[node] = kL1Delay;
+          if (along > 0) edgeTargets.push_back(same1(along - 1, track));
+          if (along + 1 < length) {
+            edgeTargets.push_back(same1(along + 1, track));
+          }
+          // Turns mix tracks in opposite ways, so that a turn back does
+          // not undo the other
+          const uint32_t turn =
+              vertical ? (track + l1 - 1) % l1 : (track + 1) % l1;
+          edgeTargets.push_back(cross1(along, track));
+          edgeTargets.push_back(cross1(along, turn));
+          if (l4 > 0) edgeTargets.push_back(same4(along, track % l4));
+          edgeTargets.push_back(sinkAt(along));
+          endNode();
+        }
+        for (uint32_t index = 0; index < l4; index++) {
+          const NodeId node = same4(along, index);
+          type[node] = vertical ? ChanY : ChanX;
+          segment[node] = L4;
+          baseCost[node] = kL4Cost;
+          delay[node] = kL4Delay;
+          const uint32_t end = std::min(along + 3, length - 1);
+          if (along + 4 < length) {
+            edgeTargets.push_back(same4(along + 4, index));
+          }
+          if (along >= 4) edgeTargets.push_back(same4(along - 4, index));
+          const uint32_t track = (4 * index + along % 4) % l1;
+          for (uint32_t position : {along, end}) {
+            edgeTargets.push_back(same1(position, track));
+            edgeTargets.push_back(cross1(position, track));
+          }
+          for (uint32_t position = along; position <= end; position++) {
+            edgeTargets.push_back(sinkAt(position));
+          }
+          endNode();
+        }
+      }
+    }
+  }
+  m_minimums[0] = kL1Cost;
+  m_minimums[1] = kL1Delay;
+  if (l4 > 0) {
+    m_minimums[0] = std::min(m_minimums[0], kL4Cost / 4);
+    m_minimums[1] = std::min(m_minimums[1], kL4Delay / 4);
+  }
+  m_tileType.Assign(std::move(tileType));
+  m_type.Assign(std::move(type));
+  m_segment.Assign(std::move(segment));
+  m_x.Assign(std::move(x));
+  m_y.Assign(std::move(y));
+  m_capacity.Assign(std::move(capacity));
+  m_baseCost.Assign(std::move(baseCost));
+  m_delay.Assign(std::move(delay));
+  m_edgeBegin.Assign(std::move(edgeBegin));
+  m_edgeTargets.Assign(std::move(edgeTargets));
+}
+
+// Sections rrg.meta (schema version, columns, rows, channel width, L1 and
+// L4 tracks), rrg.device, rrg.minimums, then one per array
+bool RoutingGraph::Save(const std::string& path, std::string& error) const {
+  const uint32_t meta[kMetaFields] = {kSchemaVersion, m_columns,
+                                      m_rows,         m_channelWidth,
+                                      m_tracks[L1],   m_tracks[L4]};
+  CheckpointWriter writer;
+  bool ok =
+      writer.Open(path) && writer.WriteArray("rrg.meta", meta, kMetaFields) &&
+      writer.WriteSection("rrg.device", m_device.data(), m_device.size()) &&
+      writer.WriteArray("rrg.minimums", m_minimums, 2) &&
+      writer.WriteArray("rrg.tile_type", m_tileType.data(),
+                        m_tileType.size()) &&
+      writer.WriteArray("rrg.type", m_type.data(), m_type.size()) &&
+      writer.WriteArray("rrg.segment", m_segment.data(), m_segment.size()) &&
+      writer.WriteArray("rrg.x", m_x.data(), m_x.size()) &&
+      writer.WriteArray("rrg.y", m_y.data(), m_y.size()) &&
+      writer.WriteArray("rrg.capacity", m_capacity.data(),
+                        m_capacity.size()) &&
+      writer.WriteArray("rrg.base_cost", m_baseCost.data(),
+                        m_baseCost.size()) &&
+      writer.WriteArray("rrg.delay", m_delay.data(), m_delay.size()) &&
+      writer.WriteArray("rrg.edge_begin", m_edgeBegin.data(),
+                        m_edgeBegin.size()) &&
+      writer.WriteArray("rrg.edge_targets", m_edgeTargets.data(),
+                        m_edgeTargets.size());
+  if (!ok || !writer.Close()) {
+    error = writer.Error().empty() ? "cannot write " + path : writer.Error();
+    return false;
+  }
+  return true;
+}
+
+bool RoutingGraph::Load(const std::string& path, std::string& error) {
+  Clear();
+  std::shared_ptr<const MappedCheckpoint> checkpoint =
+      MappedCheckpoint::Open(path, error);
+  if (!checkpoint) return false;
+  size_t count = 0;
+  const uint32_t* meta = checkpoint->Array<uint32_t>("rrg.meta", count);
+  if (count != kMetaFields || meta[0] != kSchemaVersion) {
+    error = path + ": not a routing graph of schema version " +
+            std::to_string(kSchemaVersion);
+    return false;
+  }
+  m_columns = meta[1];
+  m_rows = meta[2];
+  m_channelWidth = meta[3];
+  m_tracks[L1] = meta[4];
+  m_tracks[L4] = meta[5];
+  const float* minimums = checkpoint->Array<float>("rrg.minimums", count);
+  const size_t tiles = (size_t)m_columns * m_rows;
+  const size_t nodes = tiles * NodesPerTile();
+  bool ok = count == 2 &&
+            ViewArray(*checkpoint, "rrg.tile_type", tiles, m_tileType) &&
+            ViewArray(*checkpoint, "rrg.type", nodes, m_type) &&
+            ViewArray(*checkpoint, "rrg.segment", nodes, m_segment) &&
+            ViewArray(*checkpoint, "rrg.x", nodes, m_x) &&
+            ViewArray(*checkpoint, "rrg.y", nodes, m_y) &&
+            ViewArray(*checkpoint, "rrg.capacity", nodes, m_capacity) &&
+            ViewArray(*checkpoint, "rrg.base_cost", nodes, m_baseCost) &&
+            ViewArray(*checkpoint, "rrg.delay", nodes, m_delay) &&
+            ViewArray(*checkpoint, "rrg.edge_begin", nodes + 1, m_edgeBegin);
+  if (ok) {
+    checkpoint->Array<NodeId>("rrg.edge_targets", count);
+    ok = count == m_edgeBegin.back() &&
+         ViewArray(*checkpoint, "rrg.edge_targets", count, m_edgeTargets);
+  }
+  // The router indexes with both, a damaged file must not send it out of
+  // the arrays
+  for (size_t node = 0; ok && node < nodes; node++) {
+    ok = m_edgeBegin[node] <= m_edgeBegin[node + 1];
+  }
+  if (ok && !m_edgeBegin.empty()) ok = m_edgeBegin[0] == 0;
+  for (size_t edge = 0; ok && edge < m_edgeTargets.size(); edge++) {
+    ok = m_edgeTargets[edge] < nodes;
+  }
+  if (!ok) {
+    Clear();
+    error = path + ": invalid routing graph";
+    return false;
+  }
+  m_minimums[0] = minimums[0];
+  m_minimums[1] = minimums[1];
+  m_device = std::string(checkpoint->Section("rrg.device"));
+  m_checkpoint = checkpoint;
+  return true;
+}
+
+size_t RoutingGraph::MemoryBytes() const {
+  return m_tileType.OwnedBytes() + m_type.OwnedBytes() +
+         m_segment.OwnedBytes() + m_x.OwnedBytes() + m_y.OwnedBytes() +
+         m_capacity.OwnedBytes() + m_baseCost.OwnedBytes() +
+         m_delay.OwnedBytes() + m_edgeBegin.OwnedBytes() +
+         m_edgeTargets.OwnedBytes();
+}
+
+RoutingGraphCache::RoutingGraphCache() {
+  const std::filesystem::path directory = StageCache::UserDirectory();
+  if (!directory.empty()) m_directory = (directory / "arch").string();
+}
+
+RoutingGraphCache* RoutingGraphCache::Instance() {
+  static RoutingGraphCache cache;
+  return &cache;
+}
+
+void RoutingGraphCache::SetDirectory(const std::string& directory) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_directory = directory;
+}
+
+std::string RoutingGraphCache::Directory() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_directory;
+}
+
+std::string RoutingGraphCache::FileName(const DeviceModel& device,
+                                        uint32_t channelWidth) const {
+  std::string name = device.Generic()
+                         ? "generic_" + std::to_string(device.Columns()) +
+                               "x" + std::to_string(device.Rows())
+                         : device.Name();
+  for (char& c : name) {
+    if (!std::isalnum((unsigned char)c) && c != '-' && c != '_') c = '_';
+  }
+  return name + "_w" + std::to_string(channelWidth) + "_v" +
+         std::to_string(RoutingGraph::kSchemaVersion) + ".rrg";
+}
+
+std::string RoutingGraphCache::LookaheadFileName(
+    const DeviceModel& device, uint32_t channelWidth) const {
+  std::string name = FileName(device, channelWidth);
+  return name.substr(0, name.size() - 4) + "_l" +
+         std::to_string(RouterLookahead::kSchemaVersion) + ".lookahead";
+}
+
+std::shared_ptr<const RoutingGraph> RoutingGraphCache::Get(
+    const DeviceModel& device, uint32_t channelWidth, std::string& error) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const std::string name = FileName(device, channelWidth);
+  auto known = m_graphs.find(name);
+  if (known != m_graphs.end()) {
+    std::shared_ptr<const RoutingGraph> graph = known->second.lock();
+    if (graph && graph->Device() == DeviceKey(device)) {
+      m_stats.m_shared++;
+      return graph;
+    }
+  }
+  // A file of another device of the same name, or of an older schema, is
+  // replaced
+  std::filesystem::path path;
+  if (!m_directory.empty()) {
+    path = std::filesystem::path(m_directory) / name;
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+      auto graph = std::make_shared<RoutingGraph>();
+      std::string loadError;
+      if (graph->Load(path.string(), loadError) &&
+          graph->Device() == DeviceKey(device) &&
+          graph->ChannelWidth() == channelWidth) {
+        m_stats.m_loaded++;
+        m_graphs[name] = graph;
+        return graph;
+      }
+    }
+  }
+  auto graph = std::make_shared<RoutingGraph>();
+  graph->Build(device, channelWidth);
+  if (graph->Empty()) {
+    error = "the device has no tile or the channels no track";
+    return nullptr;
+  }
+  m_stats.m_built++;
+  if (!path.empty()) {
+    // Saved then mapped back, the pages are then shared with the other
+    // processes routing on the device
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    std::string saveError;
+    auto mapped = std::make_shared<RoutingGraph>();
+    if (graph->Save(path.string(), saveError) &&
+        mapped->Load(path.string(), saveError)) {
+      graph = mapped;
+    }
+  }
+  m_graphs[name] = graph;
+  return graph;
+}
+
+std::shared_ptr<const RouterLookahead> RoutingGraphCache::GetLookahead(
+    const DeviceModel& device, const RoutingGraph& graph,
+    unsigned int threads) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const std::string name = LookaheadFileName(device, graph.ChannelWidth());
+  auto known = m_lookaheads.find(name);
+  if (known != m_lookaheads.end()) {
+    std::shared_ptr<const RouterLookahead> lookahead = known->second.lock();
+    if (lookahead && lookahead->Matches(graph)) return lookahead;
+  }
+  std::filesystem::path path;
+  if (!m_directory.empty()) {
+    path = std::filesystem::path(m_directory) / name;
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+      auto lookahead = std::make_shared<RouterLookahead>();
+      std::string loadError;
+      if (lookahead->Load(path.string(), loadError) &&
+          lookahead->Matches(graph)) {
+        m_stats.m_lookaheadsLoaded++;
+        m_lookaheads[name] = lookahead;
+        return lookahead;
+      }
+    }
+  }
+  auto lookahead = std::make_shared<RouterLookahead>();
+  lookahead->Compute(graph, threads);
+  m_stats.m_lookaheadsComputed++;
+  if (!path.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    std::string saveError;
+    auto mapped = std::make_shared<RouterLookahead>();
+    if (lookahead->Save(path.string(), saveError) &&
+        mapped->Load(path.string(), saveError)) {
+      lookahead = mapped;
+    }
+  }
+  m_lookaheads[name] = lookahead;
+  return lookahead;
+}
+
+RoutingGraphCache::Stats RoutingGraphCache::GetStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
@@ -0,0 +1,215 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Compiler/DeviceModel.h"
+#include "Compiler/Netlist.h"
+
+#ifndef ROUTING_GRAPH_H
+#define ROUTING_GRAPH_H
+
+namespace FOEDAG {
+
+class MappedCheckpoint;
+class RouterLookahead;
+
+// Routing resource graph of an island style fabric, expanded from the site
+// grid of a DeviceModel: one tile per site, of the type of the site. Every
+// tile has a source and a sink node for the pins of the cells on it, pads
+// reach the fabric through the outer tiles. Channels have two segment
+// types:
+// - L1 wires span one tile. They continue on their track into the
+//   neighbor tiles and turn onto the crossing channel at every tile, to
+//   the same track and the next one so that tracks mix.
+// - L4 wires span four tiles, staggered so that the same number starts
+//   in every tile. They continue into the next L4 wire of their track and
+//   connect to the L1 wires at both ends.
+// A source drives every wire starting in its tile, every wire reaches the
+// sinks of the tiles it spans.
+//
+// Nodes are dense indices and the edges of a node a CSR slice of 32-bit
+// targets; types, coordinates, capacities, costs and delays are separate
+// dense arrays, a search only streams over the ones it needs. Saved, the
+// graph is a checkpoint file whose sections Load() maps in place.
+class RoutingGraph {
+ public:
+  typedef uint32_t NodeId;
+  static constexpr NodeId kNone = UINT32_MAX;
+  static constexpr uint32_t kDefaultChannelWidth = 24;
+  // Bumped whenever the layout or the content of the graph changes, stale
+  // cache files are rebuilt
+  static constexpr uint32_t kSchemaVersion = 1;
+
+  enum NodeType : uint8_t { Source, Sink, ChanX, ChanY };
+  enum Segment : uint8_t { L1, L4, kSegmentCount, kNoSegment = 0xFF };
+  static uint32_t SegmentLength(Segment segment) {
+    return segment == L4 ? 4 : 1;
+  }
+
+  RoutingGraph() = default;
+  RoutingGraph(const RoutingGraph&) = delete;
+  RoutingGraph& operator=(const RoutingGraph&) = delete;
+
+  void Build(const DeviceModel& device, uint32_t channelWidth);
+  // Graph of a generic device
+  void Build(uint32_t columns, uint32_t rows, uint32_t channelWidth);
+  void Clear();
+
+  bool Save(const std::string& path, std::string& error) const;
+  // Zero copy view on the file, kept mapped by the graph. Fails when the
+  // file is of another schema version.
+  bool Load(const std::string& path, std::string& error);
+  bool IsView() const { return m_checkpoint != nullptr; }
+
+  bool Empty() const { return m_type.empty(); }
+  // What the graph was built from, DeviceModel::Spec() or the size of
+  // the generic device
+  const std::string& Device() const { return m_device; }
+  uint32_t Columns() const { return m_columns; }
+  uint32_t Rows() const { return m_rows; }
+  uint32_t ChannelWidth() const { return m_channelWidth; }
+  // Tracks of each segment type per channel
+  uint32_t Tracks(Segment segment) const { return m_tracks[segment]; }
+  size_t NodeCount() const { return m_type.size(); }
+  size_t EdgeCount() const { return m_edgeTargets.size(); }
+
+  // A DeviceModel site value
+  uint8_t TileType(uint32_t x, uint32_t y) const {
+    return m_tileType[(size_t)y * m_columns + x];
+  }
+
+  NodeType Type(NodeId node) const { return (NodeType)m_type[node]; }
+  bool IsWire(NodeId node) const { return m_type[node] >= ChanX; }
+  Segment NodeSegment(NodeId node) const { return (Segment)m_segment[node]; }
+  // First tile of the node
+  uint16_t X(NodeId node) const { return m_x[node]; }
+  uint16_t Y(NodeId node) const { return m_y[node]; }
+  // Nets a node can carry, pins take any number
+  uint16_t Capacity(NodeId node) const { return m_capacity[node]; }
+  float BaseCost(NodeId node) const { return m_baseCost[node]; }
+  // Delay through the node, ns
+  float Delay(NodeId node) const { return m_delay[node]; }
+  Netlist::IdSpan Edges(NodeId node) const {
+    const uint32_t* targets = m_edgeTargets.data();
+    return Netlist::IdSpan(targets + m_edgeBegin[node],
+                           targets + m_edgeBegin[node + 1]);
+  }
+
+  NodeId SourceNode(uint32_t x, uint32_t y) const {
+    return ((NodeId)y * m_columns + x) * NodesPerTile();
+  }
+  NodeId SinkNode(uint32_t x, uint32_t y) const {
+    return SourceNode(x, y) + 1;
+  }
+
+  // Lowest cost and delay of wires per tile they span, what getting one
+  // tile closer to a sink costs at least
+  float MinWireCost() const { return m_minimums[0]; }
+  float MinWireDelay() const { return m_minimums[1]; }
+
+  // Heap bytes, the arrays of a mapped graph are not counted
+  size_t MemoryBytes() const;
+
+ private:
+  // Source, sink, then per direction the L1 wires and the L4 wires
+  // starting in the tile
+  uint32_t NodesPerTile() const {
+    return 2 + 2 * (m_tracks[L1] + m_tracks[L4] / 4);
+  }
+
+  std::string m_device;
+  uint32_t m_columns = 0;
+  uint32_t m_rows = 0;
+  uint32_t m_channelWidth = 0;
+  uint32_t m_tracks[kSegmentCount] = {0, 0};
+  MappedArray<uint8_t> m_tileType;
+  MappedArray<uint8_t> m_type;
+  MappedArray<uint8_t> m_segment;
+  MappedArray<uint16_t> m_x;
+  MappedArray<uint16_t> m_y;
+  MappedArray<uint16_t> m_capacity;
+  MappedArray<float> m_baseCost;
+  MappedArray<float> m_delay;
+  MappedArray<uint32_t> m_edgeBegin;  // NodeCount() + 1 offsets
+  MappedArray<NodeId> m_edgeTargets;
+  float m_minimums[2] = {0, 0};
+  std::shared_ptr<const MappedCheckpoint> m_checkpoint;
+};
+
+// Routing graphs of the devices in use and their router lookaheads, shared
+// by all the compilers of the process, and their files in a cache
+// directory, shared with the other processes of the user: each maps the
+// same read-only pages. Files are named after the device, the channel
+// width and the graph schema version. A process building a graph writes it
+// to a temporary file of its own first, renamed over the name once
+// complete, so that none maps a file still being written.
+class RoutingGraphCache {
+ public:
+  struct Stats {
+    uint64_t m_shared = 0;  // graphs already in use
+    uint64_t m_loaded = 0;  // mapped from the directory
+    uint64_t m_built = 0;
+    uint64_t m_lookaheadsLoaded = 0;
+    uint64_t m_lookaheadsComputed = 0;
+  };
+
+  static RoutingGraphCache* Instance();
+
+  // arch in StageCache::UserDirectory() by default, an empty directory
+  // keeps the graphs in memory only
+  void SetDirectory(const std::string& directory);
+  std::string Directory();
+  std::string FileName(const DeviceModel& device,
+                       uint32_t channelWidth) const;
+  std::string LookaheadFileName(const DeviceModel& device,
+                                uint32_t channelWidth) const;
+
+  // The graph of the device, from memory, from the directory, or built
+  // and then saved there
+  std::shared_ptr<const RoutingGraph> Get(const DeviceModel& device,
+                                          uint32_t channelWidth,
+                                          std::string& error);
+  // The lookahead of a graph of the device, computed with up to threads
+  // threads when not in memory nor in the directory
+  std::shared_ptr<const RouterLookahead> GetLookahead(
+      const DeviceModel& device, const RoutingGraph& graph,
+      unsigned int threads = 0);
+  Stats GetStats();
+
+ private:
+  RoutingGraphCache();
+
+  std::mutex m_mutex;
+  std::string m_directory;
+  std::map<std::string, std::weak_ptr<const RoutingGraph>> m_graphs;
+  std::map<std::string, std::weak_ptr<const RouterLookahead>> m_lookaheads;
+  Stats m_stats;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,1050 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/SdcCommands.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#include "Compiler/DeviceModel.h"
+
+using namespace FOEDAG;
+
+namespace {
+typedef TimingConstraints::Object Object;
+typedef ObjectNames::Kind Kind;
+
+struct ObjectList {
+  const TimingConstraints* m_constraints = nullptr;
+  uint32_t m_binding = 0;
+  Kind m_kind = ObjectNames::Pin;
+  std::vector<uint32_t> m_ids;  // sorted, unique
+  // Converted from names and patterns, which its string keeps
+  bool m_fromNames = false;
+};
+
+ObjectList* GetList(Tcl_Obj* obj) {
+  return (ObjectList*)obj->internalRep.twoPtrValue.ptr1;
+}
+
+void FreeObjectList(Tcl_Obj* obj) { delete GetList(obj); }
+
+void DupObjectList(Tcl_Obj* from, Tcl_Obj* to);
+void ObjectListString(Tcl_Obj* obj);
+
+const Tcl_ObjType kObjectListType = {"sdc_objects", FreeObjectList,
+                                     DupObjectList, ObjectListString,
+                                     nullptr};
+
+void DupObjectList(Tcl_Obj* from, Tcl_Obj* to) {
+  to->internalRep.twoPtrValue.ptr1 = new ObjectList(*GetList(from));
+  to->typePtr = &kObjectListType;
+}
+
+std::string ObjectName(const TimingConstraints& constraints, Kind kind,
+                       uint32_t id) {
+  return kind == ObjectNames::Clock ? constraints.GetClock(id).m_name
+                                    : constraints.Names().Name(kind, id);
+}
+
+// The names, none for the objects of a netlist gone since
+void ObjectListString(Tcl_Obj* obj) {
+  const ObjectList* list = GetList(obj);
+  Tcl_Obj* names = Tcl_NewListObj(0, nullptr);
+  Tcl_IncrRefCount(names);
+  if (list->m_constraints->Binding() == list->m_binding) {
+    for (uint32_t id : list->m_ids) {
+      const std::string name =
+          ObjectName(*list->m_constraints, list->m_kind, id);
+      Tcl_ListObjAppendElement(nullptr, names,
+                               Tcl_NewStringObj(name.data(), (int)name.size()));
+    }
+  }
+  int length = 0;
+  const char* text = Tcl_GetStringFromObj(names, &length);
+  obj->bytes = Tcl_Alloc(length + 1);
+  std::memcpy(obj->bytes, text, length + 1);
+  obj->length = length;
+  Tcl_DecrRefCount(names);
+}
+
+typedef SdcCommands::TimingPath TimingPath;
+
+// Paths [m_begin, m_end) of a snapshot, shared by the collections of its
+// paths
+struct PathList {
+  const TimingConstraints* m_constraints = nullptr;
+  uint32_t m_binding = 0;
+  std::shared_ptr<const std::vector<TimingPath>> m_paths;
+  size_t m_begin = 0;
+  size_t m_end = 0;
+};
+
+PathList* GetPaths(Tcl_Obj* obj) {
+  return (PathList*)obj->internalRep.twoPtrValue.ptr1;
+}
+
+void FreePathList(Tcl_Obj* obj) { delete GetPaths(obj); }
+
+void DupPathList(Tcl_Obj* from, Tcl_Obj* to);
+void PathListString(Tcl_Obj* obj);
+
+const Tcl_ObjType kPathListType = {"sdc_timing_paths", FreePathList,
+                                   DupPathList, PathListString, nullptr};
+
+void DupPathList(Tcl_Obj* from, Tcl_Obj* to) {
+  to->internalRep.twoPtrValue.ptr1 = new PathList(*GetPaths(from));
+  to->typePtr = &kPathListType;
+}
+
+Tcl_Obj* NewPathList(const PathList& paths) {
+  Tcl_Obj* obj = Tcl_NewObj();
+  Tcl_InvalidateStringRep(obj);
+  obj->internalRep.twoPtrValue.ptr1 = new PathList(paths);
+  obj->typePtr = &kPathListType;
+  return obj;
+}
+
+Tcl_Obj* NewNumber(double value) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(3) << value;
+  return Tcl_NewStringObj(text.str().c_str(), -1);
+}
+
+Tcl_Obj* NewPinName(const TimingConstraints& constraints, uint32_t pin) {
+  const std::string name = constraints.Names().Name(ObjectNames::Pin, pin);
+  return Tcl_NewStringObj(name.data(), (int)name.size());
+}
+
+// The dictionaries of the paths, none for a netlist gone since
+void PathListString(Tcl_Obj* obj) {
+  const PathList* list = GetPaths(obj);
+  const TimingConstraints& constraints = *list->m_constraints;
+  Tcl_Obj* paths = Tcl_NewListObj(0, nullptr);
+  Tcl_IncrRefCount(paths);
+  for (size_t p = list->m_begin;
+       p < list->m_end && constraints.Binding() == list->m_binding; p++) {
+    const TimingPath& path = (*list->m_paths)[p];
+    Tcl_Obj* pins = Tcl_NewListObj(0, nullptr);
+    for (uint32_t pin : path.m_pins) {
+      Tcl_ListObjAppendElement(nullptr, pins, NewPinName(constraints, pin));
+    }
+    Tcl_Obj* fields[] = {
+        Tcl_NewStringObj("slack", -1),
+        NewNumber(path.m_slack),
+        Tcl_NewStringObj("startpoint", -1),
+        NewPinName(constraints, path.m_pins.front()),
+        Tcl_NewStringObj("endpoint", -1),
+        NewPinName(constraints, path.m_pins.back()),
+        Tcl_NewStringObj("arrival", -1),
+        NewNumber(path.m_arrival),
+        Tcl_NewStringObj("required", -1),
+        NewNumber(path.m_required),
+        Tcl_NewStringObj("corner", -1),
+        Tcl_NewStringObj(path.m_corner.c_str(), -1),
+        Tcl_NewStringObj("pins", -1),
+        pins};
+    Tcl_ListObjAppendElement(
+        nullptr, paths,
+        Tcl_NewListObj((int)(sizeof(fields) / sizeof(fields[0])), fields));
+  }
+  int length = 0;
+  const char* text = Tcl_GetStringFromObj(paths, &length);
+  obj->bytes = Tcl_Alloc(length + 1);
+  std::memcpy(obj->bytes, text, length + 1);
+  obj->length = length;
+  Tcl_DecrRefCount(paths);
+}
+
+// A -filter expression compiled for a kind of the objects of a binding,
+// kept in the Tcl object of the expression: a query in a loop compiles it
+// once
+struct CompiledFilter {
+  const TimingConstraints* m_constraints = nullptr;
+  uint32_t m_binding = 0;
+  // Of the clocks, whose columns change with them
+  uint64_t m_revision = 0;
+  Kind m_kind = ObjectNames::Cell;
+  ObjectFilter m_filter;
+};
+
+CompiledFilter* GetFilter(Tcl_Obj* obj) {
+  return (CompiledFilter*)obj->internalRep.twoPtrValue.ptr1;
+}
+
+void FreeCompiledFilter(Tcl_Obj* obj) { delete GetFilter(obj); }
+
+void DupCompiledFilter(Tcl_Obj* from, Tcl_Obj* to);
+
+// The string of the expression is never invalidated
+const Tcl_ObjType kFilterType = {"sdc_filter", FreeCompiledFilter,
+                                 DupCompiledFilter, nullptr, nullptr};
+
+void DupCompiledFilter(Tcl_Obj* from, Tcl_Obj* to) {
+  to->internalRep.twoPtrValue.ptr1 = new CompiledFilter(*GetFilter(from));
+  to->typePtr = &kFilterType;
+}
+
+// The filter of expression for objects of kind, compiled unless expression
+// holds it already. nullptr with the error in the result.
+const ObjectFilter* CompileFilter(Tcl_Interp* interp,
+                                  TimingConstraints& constraints, Kind kind,
+                                  Tcl_Obj* expression) {
+  const uint64_t revision =
+      kind == ObjectNames::Clock ? constraints.Revision() : 0;
+  if (expression->typePtr == &kFilterType) {
+    const CompiledFilter* compiled = GetFilter(expression);
+    if (compiled->m_constraints == &constraints &&
+        compiled->m_binding == constraints.Binding() &&
+        compiled->m_revision == revision && compiled->m_kind == kind) {
+      return &compiled->m_filter;
+    }
+  }
+  int length = 0;
+  const char* text = Tcl_GetStringFromObj(expression, &length);
+  CompiledFilter* compiled = new CompiledFilter;
+  std::string error;
+  if (!compiled->m_filter.Compile(
+          kind, std::string_view(text, length),
+          [&constraints, kind](std::string_view property) {
+            return constraints.Property(kind, property);
+          },
+          error)) {
+    delete compiled;
+    Tcl_AppendResult(interp, "-filter: ", error.c_str(), nullptr);
+    return nullptr;
+  }
+  compiled->m_constraints = &constraints;
+  compiled->m_binding = constraints.Binding();
+  compiled->m_revision = revision;
+  compiled->m_kind = kind;
+  if (expression->typePtr && expression->typePtr->freeIntRepProc) {
+    expression->typePtr->freeIntRepProc(expression);
+  }
+  expression->internalRep.twoPtrValue.ptr1 = compiled;
+  expression->typePtr = &kFilterType;
+  return &compiled->m_filter;
+}
+
+// Takes the ids, sorted and unique unless sorted is false
+ObjectList* MakeObjectList(const TimingConstraints& constraints, Kind kind,
+                           std::vector<uint32_t>& ids, bool sorted) {
+  if (!sorted) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  }
+  ObjectList* list = new ObjectList;
+  list->m_constraints = &constraints;
+  list->m_binding = constraints.Binding();
+  list->m_kind = kind;
+  list->m_ids.swap(ids);
+  return list;
+}
+
+Tcl_Obj* NewObjectList(const TimingConstraints& constraints, Kind kind,
+                       std::vector<uint32_t>& ids, bool sorted = false) {
+  Tcl_Obj* obj = Tcl_NewObj();
+  Tcl_InvalidateStringRep(obj);
+  obj->internalRep.twoPtrValue.ptr1 =
+      MakeObjectList(constraints, kind, ids, sorted);
+  obj->typePtr = &kObjectListType;
+  return obj;
+}
+
+// A list converted from names and patterns, of other constraints or of a
+// netlist gone since: the names get resolved again
+bool Renamed(Tcl_Obj* value, const TimingConstraints& constraints) {
+  if (value->typePtr != &kObjectListType) return false;
+  const ObjectList* list = GetList(value);
+  return list->m_fromNames && (list->m_constraints != &constraints ||
+                               list->m_binding != constraints.Binding());
+}
+
+void MatchObjects(TimingConstraints& constraints, Kind kind,
+                  std::string_view pattern, std::vector<uint32_t>& ids) {
+  if (kind != ObjectNames::Clock) {
+    constraints.Names().Match(kind, pattern, ids);
+    return;
+  }
+  for (uint32_t clock = 0; clock < constraints.ClockCount(); clock++) {
+    if (ObjectNames::GlobMatch(pattern, constraints.GetClock(clock).m_name)) {
+      ids.push_back(clock);
+    }
+  }
+}
+
+// Objects of value: an object list as it is, otherwise a list of names
+// and patterns, each of the first of kinds it matches
+bool Resolve(Tcl_Interp* interp, TimingConstraints& constraints,
+             Tcl_Obj* value, std::initializer_list<Kind> kinds,
+             std::vector<Object>& objects) {
+  if (value->typePtr == &kPathListType) {
+    Tcl_AppendResult(interp, "timing paths are not netlist objects",
+                     nullptr);
+    return false;
+  }
+  if (value->typePtr == &kObjectListType && !Renamed(value, constraints)) {
+    const ObjectList* list = GetList(value);
+    if (list->m_constraints != &constraints ||
+        list->m_binding != constraints.Binding()) {
+      Tcl_AppendResult(interp, "objects of another netlist", nullptr);
+      return false;
+    }
+    for (uint32_t id : list->m_ids) objects.push_back({list->m_kind, id});
+    return true;
+  }
+  int count = 0;
+  Tcl_Obj** elements = nullptr;
+  if (Tcl_ListObjGetElements(interp, value, &count, &elements) != TCL_OK) {
+    return false;
+  }
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < count; i++) {
+    if (elements[i]->typePtr == &kObjectListType) {
+      if (!Resolve(interp, constraints, elements[i], kinds, objects)) {
+        return false;
+      }
+      continue;
+    }
+    int length = 0;
+    const char* name = Tcl_GetStringFromObj(elements[i], &length);
+    bool found = false;
+    for (Kind kind : kinds) {
+      ids.clear();
+      MatchObjects(constraints, kind, std::string_view(name, length), ids);
+      for (uint32_t id : ids) objects.push_back({kind, id});
+      if ((found = !ids.empty())) break;
+    }
+    if (!found) {
+      Tcl_AppendResult(interp, "no object matches \"", name, "\"", nullptr);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GetFloat(Tcl_Interp* interp, Tcl_Obj* value, float& number) {
+  double parsed = 0;
+  if (Tcl_GetDoubleFromObj(interp, value, &parsed) != TCL_OK) return false;
+  number = (float)parsed;
+  return true;
+}
+
+int Usage(Tcl_Interp* interp, const char* usage) {
+  Tcl_ResetResult(interp);
+  Tcl_AppendResult(interp, "usage: ", usage, nullptr);
+  return TCL_ERROR;
+}
+
+// get_ports, get_cells, get_pins, get_nets, get_clocks
+// ?-hierarchical? ?-quiet? ?-filter <expression>? ?patterns?: every
+// object of the kind without patterns. Patterns matching nothing are
+// warned about, unless -quiet.
+template <Kind kind>
+int GetObjects(ClientData clientData, Tcl_Interp* interp, int objc,
+               Tcl_Obj* const objv[]) {
+  SdcCommands* sdc = (SdcCommands*)clientData;
+  TimingConstraints* constraints = sdc->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  static const char* const kOptions[] = {"-hierarchical", "-quiet",
+                                         "-filter", nullptr};
+  enum { Hierarchical, Quiet, Filter };
+  std::vector<uint32_t> ids;
+  bool patterns = false;
+  bool quiet = false;
+  std::vector<std::string> unmatched;
+  const ObjectFilter* filter = nullptr;
+  for (int i = 1; i < objc; i++) {
+    int option = 0;
+    const char* arg = Tcl_GetString(objv[i]);
+    if (arg[0] == '-' &&
+        Tcl_GetIndexFromObj(interp, objv[i], kOptions, "option", 0,
+                            &option) != TCL_OK) {
+      return TCL_ERROR;
+    }
+    if (arg[0] == '-') {
+      if (option == Quiet) quiet = true;
+      if (option != Filter) continue;
+      if (++i == objc) {
+        return Usage(interp, "get_<objects> ?-hierarchical? ?-quiet? "
+                             "?-filter <expression>? ?patterns?");
+      }
+      filter = CompileFilter(interp, *constraints, kind, objv[i]);
+      if (filter == nullptr) return TCL_ERROR;
+      continue;
+    }
+    int count = 0;
+    Tcl_Obj** elements = nullptr;
+    if (Tcl_ListObjGetElements(interp, objv[i], &count, &elements) !=
+        TCL_OK) {
+      return TCL_ERROR;
+    }
+    for (int e = 0; e < count; e++) {
+      int length = 0;
+      const char* pattern = Tcl_GetStringFromObj(elements[e], &length);
+      const size_t matched = ids.size();
+      MatchObjects(*constraints, kind, std::string_view(pattern, length),
+                   ids);
+      if (ids.size() == matched) unmatched.emplace_back(pattern, length);
+    }
+    patterns = true;
+  }
+  for (const std::string& pattern : unmatched) {
+    if (quiet) break;
+    sdc->Out() << "WARNING: " << Tcl_GetString(objv[0]) << ": no "
+               << ObjectNames::KindName(kind) << " matches \"" << pattern
+               << "\"" << std::endl;
+  }
+  if (!patterns) MatchObjects(*constraints, kind, "*", ids);
+  if (filter) filter->Apply(constraints->Names(), ids);
+  Tcl_SetObjResult(interp, NewObjectList(*constraints, kind, ids));
+  return TCL_OK;
+}
+
+enum PortFilter { Inputs, Outputs, Registers };
+
+// all_inputs, all_outputs, all_registers
+template <PortFilter filter>
+int AllObjects(ClientData clientData, Tcl_Interp* interp, int objc,
+               Tcl_Obj* const objv[]) {
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  const Netlist& netlist = *constraints->Names().GetNetlist();
+  std::vector<uint32_t> ids;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    const std::string_view type = netlist.CellType(cell);
+    const bool keep =
+        filter == Registers
+            ? DeviceModel::CellResource(type) == DeviceModel::Ff ||
+                  DeviceModel::CellResource(type) == DeviceModel::Bram
+            : type == "$inout" || type == (filter == Inputs ? "$input"
+                                                            : "$output");
+    if (keep) ids.push_back(cell);
+  }
+  Tcl_SetObjResult(
+      interp,
+      NewObjectList(*constraints,
+                    filter == Registers ? ObjectNames::Cell : ObjectNames::Port,
+                    ids));
+  return TCL_OK;
+}
+
+int AllClocks(ClientData clientData, Tcl_Interp* interp, int objc,
+              Tcl_Obj* const objv[]) {
+  return GetObjects<ObjectNames::Clock>(clientData, interp, 1, objv);
+}
+
+// create_clock -period <ns> ?-name <name>? ?-waveform {<rise> <fall>}?
+// ?-add? ?sources?
+int CreateClock(ClientData clientData, Tcl_Interp* interp, int objc,
+                Tcl_Obj* const objv[]) {
+  const char* usage =
+      "create_clock -period <ns> ?-name <name>? ?-waveform {<rise> <fall>}? "
+      "?sources?";
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  static const char* const kOptions[] = {"-period", "-name", "-waveform",
+                                         "-add", nullptr};
+  enum { Period, Name, Waveform, Add };
+  TimingConstraints::Clock clock;
+  Tcl_Obj* waveform = nullptr;
+  for (int i = 1; i < objc; i++) {
+    const char* arg = Tcl_GetString(objv[i]);
+    if (arg[0] != '-') {
+      if (!Resolve(interp, *constraints, objv[i],
+                   {ObjectNames::Port, ObjectNames::Pin, ObjectNames::Net},
+                   clock.m_sources)) {
+        return TCL_ERROR;
+      }
+      continue;
+    }
+    int option = 0;
+    if (Tcl_GetIndexFromObj(interp, objv[i], kOptions, "option", 0,
+                            &option) != TCL_OK) {
+      return TCL_ERROR;
+    }
+    if (option == Add) continue;
+    if (++i == objc) return Usage(interp, usage);
+    if (option == Period) {
+      if (Tcl_GetDoubleFromObj(interp, objv[i], &clock.m_period) != TCL_OK) {
+        return TCL_ERROR;
+      }
+    } else if (option == Name) {
+      clock.m_name = Tcl_GetString(objv[i]);
+    } else {
+      waveform = objv[i];
+    }
+  }
+  if (clock.m_period <= 0) return Usage(interp, usage);
+  clock.m_fall = clock.m_period / 2;
+  if (waveform) {
+    int count = 0;
+    Tcl_Obj** edges = nullptr;
+    if (Tcl_ListObjGetElements(interp, waveform, &count, &edges) != TCL_OK) {
+      return TCL_ERROR;
+    }
+    if (count != 2 ||
+        Tcl_GetDoubleFromObj(interp, edges[0], &clock.m_rise) != TCL_OK ||
+        Tcl_GetDoubleFromObj(interp, edges[1], &clock.m_fall) != TCL_OK) {
+      return Usage(interp, usage);
+    }
+  }
+  if (clock.m_name.empty()) {
+    if (clock.m_sources.empty()) {
+      Tcl_AppendResult(interp, "create_clock: a virtual clock needs a -name",
+                       nullptr);
+      return TCL_ERROR;
+    }
+    clock.m_name =
+        ObjectName(*constraints, clock.m_sources[0].m_kind,
+                   clock.m_sources[0].m_id);
+  }
+  std::vector<uint32_t> ids = {constraints->AddClock(clock)};
+  Tcl_SetObjResult(interp,
+                   NewObjectList(*constraints, ObjectNames::Clock, ids));
+  return TCL_OK;
+}
+
+// set_input_delay, set_output_delay ?-clock <clock>? ?-max? ?-min?
+// ?-add_delay? ?-clock_fall? <ns> <ports>
+template <bool input>
+int SetIoDelay(ClientData clientData, Tcl_Interp* interp, int objc,
+               Tcl_Obj* const objv[]) {
+  const char* usage =
+      input ? "set_input_delay ?-clock <clock>? ?-max? ?-min? ?-add_delay? "
+              "<ns> <ports>"
+            : "set_output_delay ?-clock <clock>? ?-max? ?-min? "
+              "?-add_delay? <ns> <ports>";
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  static const char* const kOptions[] = {"-clock", "-max", "-min",
+                                         "-add_delay", "-clock_fall",
+                                         nullptr};
+  enum { ClockOption, Max, Min, AddDelay, ClockFall };
+  std::vector<Object> clocks, ports;
+  bool max = false, min = false, add = false;
+  Tcl_Obj* delay = nullptr;
+  Tcl_Obj* portList = nullptr;
+  for (int i = 1; i < objc; i++) {
+    const char* arg = Tcl_GetString(objv[i]);
+    int option = 0;
+    if (arg[0] == '-' && Tcl_GetIndexFromObj(nullptr, objv[i], kOptions,
+                                             "option", 0, &option) == TCL_OK) {
+      if (option == Max) max = true;
+      if (option == Min) min = true;
+      if (option == AddDelay) add = true;
+      if (option != ClockOption) continue;
+      if (++i == objc) return Usage(interp, usage);
+      if (!Resolve(interp, *constraints, objv[i], {ObjectNames::Clock},
+                   clocks)) {
+        return TCL_ERROR;
+      }
+    } else if (delay == nullptr) {
+      delay = objv[i];
+    } else if (portList == nullptr) {
+      portList = objv[i];
+    } else {
+      return Usage(interp, usage);
+    }
+  }
+  TimingConstraints::IoDelay ioDelay;
+  ioDelay.m_input = input;
+  if (portList == nullptr || clocks.size() > 1 ||
+      !GetFloat(interp, delay, ioDelay.m_delay)) {
+    return portList ? TCL_ERROR : Usage(interp, usage);
+  }
+  if (!Resolve(interp, *constraints, portList, {ObjectNames::Port}, ports)) {
+    return TCL_ERROR;
+  }
+  if (!clocks.empty()) ioDelay.m_clock = clocks[0].m_id;
+  for (const Object& port : ports) {
+    if (port.m_kind != ObjectNames::Port) continue;
+    ioDelay.m_port = port;
+    for (bool hold : {false, true}) {
+      if ((hold && max && !min) || (!hold && min && !max)) continue;
+      ioDelay.m_min = hold;
+      constraints->AddIoDelay(ioDelay, add);
+    }
+  }
+  return TCL_OK;
+}
+
+// set_false_path, set_max_delay <ns>, set_multicycle_path <multiplier>
+// ?-setup? ?-hold? ?-from <objects>? ?-through <objects>?...
+// ?-to <objects>?
+template <TimingConstraints::ExceptionType type>
+int SetException(ClientData clientData, Tcl_Interp* interp, int objc,
+                 Tcl_Obj* const objv[]) {
+  const char* usage =
+      type == TimingConstraints::FalsePath
+          ? "set_false_path ?-setup? ?-hold? ?-from <objects>? "
+            "?-through <objects>? ?-to <objects>?"
+      : type == TimingConstraints::MaxDelay
+          ? "set_max_delay <ns> ?-from <objects>? ?-through <objects>? "
+            "?-to <objects>?"
+          : "set_multicycle_path <multiplier> ?-setup? ?-hold? "
+            "?-from <objects>? ?-through <objects>? ?-to <objects>?";
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  static const char* const kOptions[] = {"-from", "-through", "-to",
+                                         "-setup", "-hold", nullptr};
+  enum { From, Through, To, Setup, Hold };
+  // Scratch of the calling thread, reused line after line
+  thread_local std::vector<Object> from, through, to;
+  from.clear();
+  through.clear();
+  to.clear();
+  bool setup = false, hold = false;
+  Tcl_Obj* value = nullptr;
+  for (int i = 1; i < objc; i++) {
+    int option = 0;
+    if (Tcl_GetString(objv[i])[0] != '-' ||
+        Tcl_GetIndexFromObj(nullptr, objv[i], kOptions, "option", 0,
+                            &option) != TCL_OK) {
+      if (value != nullptr || type == TimingConstraints::FalsePath) {
+        return Usage(interp, usage);
+      }
+      value = objv[i];
+      continue;
+    }
+    if (option == Setup || option == Hold) {
+      (option == Setup ? setup : hold) = true;
+      continue;
+    }
+    if (++i == objc) return Usage(interp, usage);
+    const bool resolved =
+        option == Through
+            ? Resolve(interp, *constraints, objv[i],
+                      {ObjectNames::Pin, ObjectNames::Net, ObjectNames::Cell,
+                       ObjectNames::Port},
+                      through)
+            : Resolve(interp, *constraints, objv[i],
+                      {ObjectNames::Port, ObjectNames::Pin, ObjectNames::Cell,
+                       ObjectNames::Clock},
+                      option == From ? from : to);
+    if (!resolved) return TCL_ERROR;
+  }
+  float number = 0;
+  if (type != TimingConstraints::FalsePath &&
+      (value == nullptr || !GetFloat(interp, value, number))) {
+    return value ? TCL_ERROR : Usage(interp, usage);
+  }
+  // Without either flag a false path is for both, a multicycle path
+  // for setup
+  if (!setup && !hold) {
+    setup = true;
+    hold = type != TimingConstraints::MulticyclePath;
+  }
+  constraints->AddException(type, number, setup, hold, from, through, to);
+  return TCL_OK;
+}
+
+// The collection value holds: an object list, or names and patterns of
+// one kind of objects it is converted to, keeping its string, and
+// converted again once the netlist changed. An empty value is an empty
+// list of no kind in particular. nullptr with the error in the result.
+const ObjectList* GetCollection(Tcl_Interp* interp,
+                                TimingConstraints& constraints,
+                                Tcl_Obj* value, bool& empty) {
+  empty = false;
+  if (value->typePtr != &kObjectListType || Renamed(value, constraints)) {
+    std::vector<Object> objects;
+    if (!Resolve(interp, constraints, value,
+                 {ObjectNames::Port, ObjectNames::Cell, ObjectNames::Pin,
+                  ObjectNames::Net, ObjectNames::Clock},
+                 objects)) {
+      return nullptr;
+    }
+    std::vector<uint32_t> ids;
+    for (const Object& object : objects) {
+      if (object.m_kind != objects[0].m_kind) {
+        Tcl_AppendResult(interp, "objects of different kinds", nullptr);
+        return nullptr;
+      }
+      ids.push_back(object.m_id);
+    }
+    empty = objects.empty();
+    ObjectList* list = MakeObjectList(
+        constraints, empty ? ObjectNames::Cell : objects[0].m_kind, ids,
+        false);
+    list->m_fromNames = true;
+    Tcl_GetString(value);
+    if (value->typePtr && value->typePtr->freeIntRepProc) {
+      value->typePtr->freeIntRepProc(value);
+    }
+    value->internalRep.twoPtrValue.ptr1 = list;
+    value->typePtr = &kObjectListType;
+    return list;
+  }
+  const ObjectList* list = GetList(value);
+  if (list->m_constraints != &constraints ||
+      list->m_binding != constraints.Binding()) {
+    Tcl_AppendResult(interp, "objects of another netlist", nullptr);
+    return nullptr;
+  }
+  empty = list->m_ids.empty();
+  return list;
+}
+
+// sizeof_collection <collection>
+int SizeofCollection(ClientData clientData, Tcl_Interp* interp, int objc,
+                     Tcl_Obj* const objv[]) {
+  if (objc != 2) return Usage(interp, "sizeof_collection <collection>");
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  if (objv[1]->typePtr == &kPathListType) {
+    const PathList* paths = GetPaths(objv[1]);
+    const size_t size = paths->m_end - paths->m_begin;
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj((Tcl_WideInt)size));
+    return TCL_OK;
+  }
+  bool empty = false;
+  const ObjectList* list =
+      GetCollection(interp, *constraints, objv[1], empty);
+  if (list == nullptr) return TCL_ERROR;
+  Tcl_SetObjResult(interp, Tcl_NewWideIntObj((Tcl_WideInt)list->m_ids.size()));
+  return TCL_OK;
+}
+
+// The variable of foreach_in_collection, objv[1], is each path of objv[2]
+// in turn
+int ForeachPath(Tcl_Interp* interp, Tcl_Obj* const objv[]) {
+  // The body may change the collection object
+  const PathList paths = *GetPaths(objv[2]);
+  PathList element = paths;
+  for (size_t p = paths.m_begin; p < paths.m_end; p++) {
+    element.m_begin = p;
+    element.m_end = p + 1;
+    if (Tcl_ObjSetVar2(interp, objv[1], nullptr, NewPathList(element),
+                       TCL_LEAVE_ERR_MSG) == nullptr) {
+      return TCL_ERROR;
+    }
+    const int code = Tcl_EvalObjEx(interp, objv[3], 0);
+    if (code == TCL_BREAK) break;
+    if (code != TCL_OK && code != TCL_CONTINUE) return code;
+  }
+  Tcl_ResetResult(interp);
+  return TCL_OK;
+}
+
+// foreach_in_collection <variable> <collection> <body>: the variable is a
+// collection of one object, or of one path, at each iteration
+int ForeachInCollection(ClientData clientData, Tcl_Interp* interp, int objc,
+                        Tcl_Obj* const objv[]) {
+  if (objc != 4) {
+    return Usage(interp,
+                 "foreach_in_collection <variable> <collection> <body>");
+  }
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  if (objv[2]->typePtr == &kPathListType) return ForeachPath(interp, objv);
+  bool empty = false;
+  const ObjectList* list =
+      GetCollection(interp, *constraints, objv[2], empty);
+  if (list == nullptr) return TCL_ERROR;
+  // The body may change the collection object
+  const Kind kind = list->m_kind;
+  const std::vector<uint32_t> ids = list->m_ids;
+  std::vector<uint32_t> element;
+  for (uint32_t id : ids) {
+    element.assign(1, id);
+    if (Tcl_ObjSetVar2(interp, objv[1], nullptr,
+                       NewObjectList(*constraints, kind, element, true),
+                       TCL_LEAVE_ERR_MSG) == nullptr) {
+      return TCL_ERROR;
+    }
+    const int code = Tcl_EvalObjEx(interp, objv[3], 0);
+    if (code == TCL_BREAK) break;
+    if (code != TCL_OK && code != TCL_CONTINUE) return code;
+  }
+  Tcl_ResetResult(interp);
+  return TCL_OK;
+}
+
+// filter_collection <collection> <expression>
+int FilterCollection(ClientData clientData, Tcl_Interp* interp, int objc,
+                     Tcl_Obj* const objv[]) {
+  if (objc != 3) {
+    return Usage(interp, "filter_collection <collection> <expression>");
+  }
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  bool empty = false;
+  const ObjectList* list =
+      GetCollection(interp, *constraints, objv[1], empty);
+  if (list == nullptr) return TCL_ERROR;
+  const Kind kind = list->m_kind;
+  std::vector<uint32_t> ids = list->m_ids;
+  if (!empty) {
+    const ObjectFilter* filter =
+        CompileFilter(interp, *constraints, kind, objv[2]);
+    if (filter == nullptr) return TCL_ERROR;
+    filter->Apply(constraints->Names(), ids);
+  }
+  Tcl_SetObjResult(interp, NewObjectList(*constraints, kind, ids, true));
+  return TCL_OK;
+}
+
+enum SetOperation { Union, Difference, Intersection };
+
+// add_to_collection <collection> <objects> ?-unique?,
+// remove_from_collection ?-intersect? <collection> <objects>: a new
+// collection, merged from the sorted ids of both
+template <bool add>
+int EditCollection(ClientData clientData, Tcl_Interp* interp, int objc,
+                   Tcl_Obj* const objv[]) {
+  const char* usage =
+      add ? "add_to_collection <collection> <objects> ?-unique?"
+          : "remove_from_collection ?-intersect? <collection> <objects>";
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  SetOperation operation = add ? Union : Difference;
+  Tcl_Obj* operands[2] = {nullptr, nullptr};
+  int count = 0;
+  for (int i = 1; i < objc; i++) {
+    const char* arg = Tcl_GetString(objv[i]);
+    if (add && std::strcmp(arg, "-unique") == 0) continue;
+    if (!add && std::strcmp(arg, "-intersect") == 0) {
+      operation = Intersection;
+      continue;
+    }
+    if (count == 2) return Usage(interp, usage);
+    operands[count++] = objv[i];
+  }
+  if (count != 2) return Usage(interp, usage);
+  bool empty[2] = {false, false};
+  const ObjectList* lists[2] = {nullptr, nullptr};
+  for (int i = 0; i < 2; i++) {
+    lists[i] = GetCollection(interp, *constraints, operands[i], empty[i]);
+    if (lists[i] == nullptr) return TCL_ERROR;
+  }
+  if (!empty[0] && !empty[1] && lists[0]->m_kind != lists[1]->m_kind) {
+    Tcl_AppendResult(interp, "collections of ",
+                     ObjectNames::KindName(lists[0]->m_kind), "s and ",
+                     ObjectNames::KindName(lists[1]->m_kind), "s", nullptr);
+    return TCL_ERROR;
+  }
+  const std::vector<uint32_t>& first = lists[0]->m_ids;
+  const std::vector<uint32_t>& second = lists[1]->m_ids;
+  std::vector<uint32_t> ids;
+  if (operation == Union) {
+    ids.reserve(first.size() + second.size());
+    std::set_union(first.begin(), first.end(), second.begin(), second.end(),
+                   std::back_inserter(ids));
+  } else if (operation == Difference) {
+    std::set_difference(first.begin(), first.end(), second.begin(),
+                        second.end(), std::back_inserter(ids));
+  } else {
+    std::set_intersection(first.begin(), first.end(), second.begin(),
+                          second.end(), std::back_inserter(ids));
+  }
+  const Kind kind = empty[0] ? lists[1]->m_kind : lists[0]->m_kind;
+  Tcl_SetObjResult(interp, NewObjectList(*constraints, kind, ids, true));
+  return TCL_OK;
+}
+
+// get_object_name <collection>: the list of the names
+int GetObjectName(ClientData clientData, Tcl_Interp* interp, int objc,
+                  Tcl_Obj* const objv[]) {
+  if (objc != 2) return Usage(interp, "get_object_name <collection>");
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  bool empty = false;
+  const ObjectList* list =
+      GetCollection(interp, *constraints, objv[1], empty);
+  if (list == nullptr) return TCL_ERROR;
+  Tcl_Obj* names = Tcl_NewListObj(0, nullptr);
+  for (uint32_t id : list->m_ids) {
+    const std::string name = ObjectName(*constraints, list->m_kind, id);
+    Tcl_ListObjAppendElement(nullptr, names,
+                             Tcl_NewStringObj(name.data(), (int)name.size()));
+  }
+  Tcl_SetObjResult(interp, names);
+  return TCL_OK;
+}
+
+// get_path_property <paths> <property>: slack, arrival, required and
+// corner are a value for a collection of one path, a list of them for
+// more; pins is the list of the names of the pins of a path, startpoint to
+// endpoint, or a list of those lists; startpoint and endpoint are a
+// collection of the pins of the paths.
+int GetPathProperty(ClientData clientData, Tcl_Interp* interp, int objc,
+                    Tcl_Obj* const objv[]) {
+  const char* usage = "get_path_property <paths> <property>";
+  if (objc != 3) return Usage(interp, usage);
+  TimingConstraints* constraints =
+      ((SdcCommands*)clientData)->Constraints(interp);
+  if (constraints == nullptr) return TCL_ERROR;
+  if (objv[1]->typePtr != &kPathListType) {
+    Tcl_AppendResult(interp, "not a collection of timing paths", nullptr);
+    return TCL_ERROR;
+  }
+  const PathList* paths = GetPaths(objv[1]);
+  if (paths->m_constraints != constraints ||
+      paths->m_binding != constraints->Binding()) {
+    Tcl_AppendResult(interp, "paths of another netlist", nullptr);
+    return TCL_ERROR;
+  }
+  const std::string property = Tcl_GetString(objv[2]);
+  const std::vector<TimingPath>& all = *paths->m_paths;
+  if (property == "startpoint" || property == "endpoint") {
+    std::vector<uint32_t> ids;
+    for (size_t p = paths->m_begin; p < paths->m_end; p++) {
+      ids.push_back(property == "startpoint" ? all[p].m_pins.front()
+                                             : all[p].m_pins.back());
+    }
+    Tcl_SetObjResult(interp,
+                     NewObjectList(*constraints, ObjectNames::Pin, ids));
+    return TCL_OK;
+  }
+  auto value = [&](const TimingPath& path) -> Tcl_Obj* {
+    if (property == "slack") return NewNumber(path.m_slack);
+    if (property == "arrival") return NewNumber(path.m_arrival);
+    if (property == "required") return NewNumber(path.m_required);
+    if (property == "corner") {
+      return Tcl_NewStringObj(path.m_corner.c_str(), -1);
+    }
+    if (property != "pins") return nullptr;
+    Tcl_Obj* pins = Tcl_NewListObj(0, nullptr);
+    for (uint32_t pin : path.m_pins) {
+      Tcl_ListObjAppendElement(nullptr, pins, NewPinName(*constraints, pin));
+    }
+    return pins;
+  };
+  Tcl_Obj* values = Tcl_NewListObj(0, nullptr);
+  Tcl_IncrRefCount(values);
+  for (size_t p = paths->m_begin; p < paths->m_end; p++) {
+    Tcl_Obj* element = value(all[p]);
+    if (element == nullptr) {
+      Tcl_DecrRefCount(values);
+      Tcl_AppendResult(interp, "unknown path property \"", property.c_str(),
+                       "\", one of slack arrival required corner ",
+                       "startpoint endpoint pins", nullptr);
+      return TCL_ERROR;
+    }
+    Tcl_ListObjAppendElement(nullptr, values, element);
+  }
+  int count = 0;
+  Tcl_Obj** elements = nullptr;
+  Tcl_ListObjGetElements(nullptr, values, &count, &elements);
+  Tcl_SetObjResult(interp, count == 1 ? elements[0] : values);
+  Tcl_DecrRefCount(values);
+  return TCL_OK;
+}
+
+// read_sdc <file>
+int ReadSdc(ClientData clientData, Tcl_Interp* interp, int objc,
+            Tcl_Obj* const objv[]) {
+  if (objc != 2) return Usage(interp, "read_sdc <file>");
+  if (((SdcCommands*)clientData)->Constraints(interp) == nullptr) {
+    return TCL_ERROR;
+  }
+  return Tcl_EvalFile(interp, Tcl_GetString(objv[1]));
+}
+}  // namespace
+
+TimingConstraints* SdcCommands::Constraints(Tcl_Interp* interp) {
+  std::string error;
+  TimingConstraints* constraints = m_source(error);
+  if (constraints == nullptr) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, error.c_str(), nullptr);
+  }
+  return constraints;
+}
+
+void SdcCommands::Register(TclInterpreter* interp) {
+  interp->registerObjCmd("get_ports", GetObjects<ObjectNames::Port>, this,
+                         nullptr);
+  interp->registerObjCmd("get_cells", GetObjects<ObjectNames::Cell>, this,
+                         nullptr);
+  interp->registerObjCmd("get_pins", GetObjects<ObjectNames::Pin>, this,
+                         nullptr);
+  interp->registerObjCmd("get_nets", GetObjects<ObjectNames::Net>, this,
+                         nullptr);
+  interp->registerObjCmd("get_clocks", GetObjects<ObjectNames::Clock>, this,
+                         nullptr);
+  interp->registerObjCmd("all_inputs", AllObjects<Inputs>, this, nullptr);
+  interp->registerObjCmd("all_outputs", AllObjects<Outputs>, this, nullptr);
+  interp->registerObjCmd("all_registers", AllObjects<Registers>, this,
+                         nullptr);
+  interp->registerObjCmd("all_clocks", AllClocks, this, nullptr);
+  interp->registerObjCmd("create_clock", CreateClock, this, nullptr);
+  interp->registerObjCmd("set_input_delay", SetIoDelay<true>, this, nullptr);
+  interp->registerObjCmd("set_output_delay", SetIoDelay<false>, this,
+                         nullptr);
+  interp->registerObjCmd("set_false_path",
+                         SetException<TimingConstraints::FalsePath>, this,
+                         nullptr);
+  interp->registerObjCmd("set_max_delay",
+                         SetException<TimingConstraints::MaxDelay>, this,
+                         nullptr);
+  interp->registerObjCmd("set_multicycle_path",
+                         SetException<TimingConstraints::MulticyclePath>,
+                         this, nullptr);
+  interp->registerObjCmd("read_sdc", ReadSdc, this, nullptr);
+  interp->registerObjCmd("sizeof_collection", SizeofCollection, this,
+                         nullptr);
+  interp->registerObjCmd("foreach_in_collection", ForeachInCollection, this,
+                         nullptr);
+  interp->registerObjCmd("filter_collection", FilterCollection, this,
+                         nullptr);
+  interp->registerObjCmd("add_to_collection", EditCollection<true>, this,
+                         nullptr);
+  interp->registerObjCmd("remove_from_collection", EditCollection<false>,
+                         this, nullptr);
+  interp->registerObjCmd("get_object_name", GetObjectName, this, nullptr);
+  interp->registerObjCmd("get_path_property", GetPathProperty, this,
+                         nullptr);
+}
+
+Tcl_Obj* SdcCommands::NewPathCollection(const TimingConstraints& constraints,
+                                        std::vector<TimingPath> paths) {
+  PathList list;
+  list.m_constraints = &constraints;
+  list.m_binding = constraints.Binding();
+  list.m_end = paths.size();
+  list.m_paths =
+      std::make_shared<const std::vector<TimingPath>>(std::move(paths));
+  return NewPathList(list);
+}
+
+bool SdcCommands::ReadFile(const std::string& file, std::string& error) {
+  TclInterpreter interp("sdc");
+  Register(&interp);
+  if (Tcl_EvalFile(interp.getInterp(), file.c_str()) == TCL_OK) return true;
+  error = file + ": " + Tcl_GetStringResult(interp.getInterp());
+  return false;
+}
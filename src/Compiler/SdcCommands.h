@@ -0,0 +1,109 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Compiler/TimingConstraints.h"
+#include "Tcl/TclInterpreter.h"
+
+#ifndef SDC_COMMANDS_H
+#define SDC_COMMANDS_H
+
+namespace FOEDAG {
+
+// SDC commands, as Tcl object commands on the TimingConstraints of the
+// current netlist: create_clock, set_input_delay, set_output_delay,
+// set_false_path, set_max_delay, set_multicycle_path, the get_ports,
+// get_cells, get_pins, get_nets and get_clocks queries, all_inputs,
+// all_outputs, all_clocks, all_registers and read_sdc. The collection
+// commands work on object lists: sizeof_collection,
+// foreach_in_collection, filter_collection, add_to_collection,
+// remove_from_collection and get_object_name.
+//
+// A query returns an object list: a Tcl object holding the kind and the
+// sorted ids of its objects. Its string, the list of their names, is only
+// made when a script reads it, a constraint command takes the ids as they
+// are. Any other value is a list of names and glob patterns, resolved
+// through the ObjectNames, so a line like
+//   set_false_path -from [get_pins a/Q] -to [get_pins b/D]
+// costs two hash lookups and appends to a few arrays. The collection
+// commands merge the sorted ids and return object lists too: counting or
+// walking a million nets never makes their names.
+//
+// The queries take a -filter expression on the properties of their
+// objects, compiled once into the Tcl object holding it, see ObjectFilter:
+//   get_cells -filter {type == lut && fanout > 100} u_core/*
+//
+// Timing paths are collections too, of their own type: sizeof_collection
+// and foreach_in_collection walk them, get_path_property reads them.
+class SdcCommands {
+ public:
+  // A path of get_timing_paths, its pins netlist pin ids from the
+  // startpoint to the endpoint
+  struct TimingPath {
+    double m_slack = 0;
+    double m_arrival = 0;
+    double m_required = 0;
+    std::string m_corner;
+    std::vector<uint32_t> m_pins;
+  };
+
+  // The constraints of the current netlist, their files read, nullptr with
+  // error when there is no netlist
+  typedef std::function<TimingConstraints*(std::string& error)>
+      ConstraintsSource;
+
+  // The get_* queries warn on out about patterns matching nothing
+  explicit SdcCommands(ConstraintsSource source,
+                       std::ostream& out = std::cout)
+      : m_source(std::move(source)), m_out(&out) {}
+  SdcCommands(const SdcCommands&) = delete;
+  SdcCommands& operator=(const SdcCommands&) = delete;
+
+  void Register(TclInterpreter* interp);
+  // Evaluates an SDC file in an interpreter of its own, on the calling
+  // thread
+  bool ReadFile(const std::string& file, std::string& error);
+
+  // Sets the Tcl result to the error when there are none
+  TimingConstraints* Constraints(Tcl_Interp* interp);
+  std::ostream& Out() { return *m_out; }
+
+  // A collection of the paths, named in the current binding of
+  // constraints. Its string is the list of
+  //   {slack <ns> startpoint <pin> endpoint <pin> arrival <ns>
+  //    required <ns> corner <name> pins {<pin>...}}
+  static Tcl_Obj* NewPathCollection(const TimingConstraints& constraints,
+                                    std::vector<TimingPath> paths);
+
+ private:
+  ConstraintsSource m_source;
+  std::ostream* m_out = &std::cout;
+};
+
+}  // namespace FOEDAG
+
+#endif
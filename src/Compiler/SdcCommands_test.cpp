@@ -0,0 +1,410 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/SdcCommands.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Compiler/TimingAnalyzer.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// in -> u1/lut -> u1/reg -> u2/lut -> out, the register clocked from clk
+void BuildDesign(Netlist& netlist) {
+  auto net = [&](const char* name) { return netlist.AddNet(name); };
+  Netlist::NetId in = net("in"), a = net("u1/a"), q = net("u1/q"),
+                 b = net("u2/b"), clk = net("clk");
+  Netlist::CellId cell = netlist.AddCell("in", "$input");
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), in);
+  cell = netlist.AddCell("clk", "$input");
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), clk);
+  cell = netlist.AddCell("u1/lut", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), in);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), a);
+  cell = netlist.AddCell("u1/reg", "dff");
+  netlist.Connect(netlist.AddPin(cell, "D", Netlist::Input), a);
+  netlist.Connect(netlist.AddPin(cell, "C", Netlist::Input), clk);
+  netlist.Connect(netlist.AddPin(cell, "Q", Netlist::Output), q);
+  cell = netlist.AddCell("u2/lut", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), q);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), b);
+  cell = netlist.AddCell("out", "$output");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), b);
+  netlist.Finalize();
+}
+
+std::vector<std::string> Names(ObjectNames& names, ObjectNames::Kind kind,
+                               const char* pattern) {
+  std::vector<uint32_t> ids;
+  names.Match(kind, pattern, ids);
+  std::vector<std::string> result;
+  for (uint32_t id : ids) result.push_back(names.Name(kind, id));
+  return result;
+}
+
+TEST(SdcCommands, GlobMatchesLikeTcl) {
+  EXPECT_TRUE(ObjectNames::GlobMatch("*", ""));
+  EXPECT_TRUE(ObjectNames::GlobMatch("u1/*", "u1/reg/Q"));
+  EXPECT_TRUE(ObjectNames::GlobMatch("*/Q", "u1/reg/Q"));
+  EXPECT_TRUE(ObjectNames::GlobMatch("a?c", "abc"));
+  EXPECT_FALSE(ObjectNames::GlobMatch("a?c", "ac"));
+  EXPECT_TRUE(ObjectNames::GlobMatch("d[0-3]", "d2"));
+  EXPECT_FALSE(ObjectNames::GlobMatch("d[0-3]", "d4"));
+  EXPECT_TRUE(ObjectNames::GlobMatch("d\\[1\\]", "d[1]"));
+  EXPECT_TRUE(ObjectNames::GlobMatch("*a*b*", "xxaxxbxx"));
+  EXPECT_FALSE(ObjectNames::GlobMatch("*a*b", "xxaxxbxx"));
+  EXPECT_TRUE(ObjectNames::IsPattern("d[1]"));
+  EXPECT_FALSE(ObjectNames::IsPattern("u1/reg"));
+}
+
+TEST(SdcCommands, ResolvesNamesThroughTheIndex) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  ObjectNames names;
+  names.Bind(&netlist);
+  EXPECT_EQ(names.Find(ObjectNames::Port, "in"), netlist.FindCell("in"));
+  EXPECT_EQ(names.Find(ObjectNames::Cell, "in"), ObjectNames::kNone);
+  EXPECT_EQ(names.Name(ObjectNames::Pin,
+                       names.Find(ObjectNames::Pin, "u1/reg/Q")),
+            "u1/reg/Q");
+  EXPECT_EQ(names.Find(ObjectNames::Pin, "u1/reg/X"), ObjectNames::kNone);
+  EXPECT_THAT(Names(names, ObjectNames::Cell, "u*"),
+              testing::ElementsAre("u1/lut", "u1/reg", "u2/lut"));
+  EXPECT_THAT(Names(names, ObjectNames::Port, "*"),
+              testing::ElementsAre("in", "clk", "out"));
+  EXPECT_THAT(Names(names, ObjectNames::Pin, "u1/reg/*"),
+              testing::ElementsAre("u1/reg/D", "u1/reg/C", "u1/reg/Q"));
+  EXPECT_THAT(Names(names, ObjectNames::Pin, "u1/*/A"),
+              testing::ElementsAre("u1/lut/A"));
+  EXPECT_THAT(Names(names, ObjectNames::Pin, "*/[AD]"),
+              testing::ElementsAre("u1/lut/A", "u1/reg/D", "u2/lut/A"));
+  EXPECT_THAT(Names(names, ObjectNames::Net, "u?/*"),
+              testing::ElementsAre("u1/a", "u1/q", "u2/b"));
+}
+
+TEST(SdcCommands, ConstrainTheTiming) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string& error) { return &constraints; });
+  TclInterpreter interp;
+  sdc.Register(&interp);
+  auto eval = [&interp](const std::string& script) {
+    int code = TCL_OK;
+    std::string result = interp.evalCmd(script, &code);
+    EXPECT_EQ(code, TCL_OK) << script << ": " << result;
+    return result;
+  };
+  EXPECT_EQ(eval("create_clock -period 4 [get_ports clk]"), "clk");
+  EXPECT_EQ(eval("create_clock -name virtual -period 2 -waveform {0 1}"),
+            "virtual");
+  EXPECT_EQ(constraints.ClockCount(), 2u);
+  EXPECT_EQ(constraints.ClockPeriod(10), 2);
+  // A new clock of the same name replaces it
+  eval("create_clock -name virtual -period 8");
+  EXPECT_EQ(constraints.ClockPeriod(10), 4);
+  EXPECT_EQ(eval("get_pins u1/reg/*"), "u1/reg/D u1/reg/C u1/reg/Q");
+  EXPECT_EQ(eval("llength [get_cells]"), "3");
+  EXPECT_EQ(eval("all_inputs"), "in clk");
+  EXPECT_EQ(eval("all_registers"), "u1/reg");
+  EXPECT_EQ(eval("get_clocks v*"), "virtual");
+
+  eval("set_input_delay 1.5 -clock clk [get_ports in]");
+  eval("set_input_delay -clock [get_clocks clk] -max 0.5 in");
+  eval("set_output_delay 0.25 -clock clk [all_outputs]");
+  eval("set_false_path -from [get_pins u1/reg/Q]");
+  eval("set_false_path -hold -to [get_ports out]");
+  eval("set_max_delay 3 -from in -through u1/a -to u1/reg/D");
+  eval("set_multicycle_path 2 -from [get_cells u1/*] -to [get_clocks clk]");
+  EXPECT_EQ(constraints.ExceptionCount(), 4u);
+  const TimingConstraints::Exception& max = constraints.GetException(2);
+  EXPECT_EQ(max.m_type, TimingConstraints::MaxDelay);
+  EXPECT_EQ(max.m_value, 3);
+  ASSERT_EQ(max.m_to - max.m_through, 1u);
+  EXPECT_EQ(constraints.Objects(max.m_through)->m_kind, ObjectNames::Net);
+  const TimingConstraints::Exception& multicycle =
+      constraints.GetException(3);
+  EXPECT_TRUE(multicycle.m_setup);
+  EXPECT_FALSE(multicycle.m_hold);
+  EXPECT_EQ(multicycle.m_to - multicycle.m_from, 2u);
+  EXPECT_EQ(constraints.Objects(multicycle.m_to)->m_kind,
+            ObjectNames::Clock);
+
+  int code = TCL_OK;
+  interp.evalCmd("set_false_path -to [get_pins nothing/*] -from missing",
+                 &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("set_max_delay -from in", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  EXPECT_EQ(constraints.ExceptionCount(), 4u);
+
+  // Input delay of in replaced, the false path of u1/reg/Q applied, the
+  // hold one of out not
+  std::vector<std::pair<Netlist::PinId, float>> delays;
+  std::vector<Netlist::PinId> falseFrom, falseTo;
+  constraints.TimingPins(delays, falseFrom, falseTo);
+  const ObjectNames& names = constraints.Names();
+  const Netlist::PinId in = netlist.CellPins(netlist.FindCell("in"))[0];
+  const Netlist::PinId out = netlist.CellPins(netlist.FindCell("out"))[0];
+  const Netlist::PinId q = names.Find(ObjectNames::Pin, "u1/reg/Q");
+  EXPECT_THAT(delays, testing::ElementsAre(std::make_pair(in, 0.5f),
+                                           std::make_pair(out, 0.25f)));
+  EXPECT_THAT(falseFrom, testing::ElementsAre(q));
+  EXPECT_TRUE(falseTo.empty());
+
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.Constrain(delays, falseFrom, falseTo);
+  timing.SetPlacedDelays(CellPlacement());
+  TimingAnalyzer::Options options;
+  options.m_clockPeriod = constraints.ClockPeriod(10);
+  timing.Update(options);
+  // From in only: 0.5 then a LUT into the register
+  EXPECT_EQ(timing.GetSummary().m_endpoints, 1u);
+  EXPECT_FLOAT_EQ(timing.Arrival(names.Find(ObjectNames::Pin, "u1/reg/D")),
+                  0.75f);
+  EXPECT_FLOAT_EQ(timing.GetSummary().m_wns, 4 - 0.75f - 0.1f);
+
+  // set_max_delay and set_multicycle_path are stored only, a false path
+  // between two lists goes to the path searches
+  size_t ignored[TimingConstraints::MulticyclePath + 1];
+  constraints.IgnoredExceptions(ignored);
+  EXPECT_THAT(ignored, testing::ElementsAre(0u, 1u, 1u));
+  eval("set_false_path -from in -to [get_cells u1/reg]");
+  std::vector<TimingConstraints::FalsePathPins> pairs;
+  constraints.FalsePathPairs(pairs);
+  const Netlist::PinId d = names.Find(ObjectNames::Pin, "u1/reg/D");
+  const Netlist::PinId c = names.Find(ObjectNames::Pin, "u1/reg/C");
+  ASSERT_EQ(pairs.size(), 1u);
+  EXPECT_THAT(pairs[0].first, testing::ElementsAre(in));
+  EXPECT_THAT(pairs[0].second, testing::ElementsAre(d, c));
+
+  // Objects of an older binding are stale
+  eval("set old [get_ports in]");
+  constraints.Bind(netlist);
+  interp.evalCmd("set_input_delay 1 $old", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+}
+
+TEST(SdcCommands, FiltersOnProperties) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string& error) { return &constraints; });
+  TclInterpreter interp;
+  sdc.Register(&interp);
+  auto eval = [&interp](const std::string& script) {
+    int code = TCL_OK;
+    std::string result = interp.evalCmd(script, &code);
+    EXPECT_EQ(code, TCL_OK) << script << ": " << result;
+    return result;
+  };
+  EXPECT_EQ(eval("get_cells -filter {type == lut}"), "u1/lut u2/lut");
+  EXPECT_EQ(eval("get_cells -filter {type==ff || name =~ u2/*}"),
+            "u1/reg u2/lut");
+  EXPECT_EQ(eval("get_cells -filter {ref_name != LUT1 && fanin >= 2}"),
+            "u1/reg");
+  EXPECT_EQ(eval("get_cells u1/* -filter {!(fanout > 0)}"), "");
+  EXPECT_EQ(eval("get_nets -filter {pins == 2 && !(name =~ u*)}"),
+            "in clk");
+  EXPECT_EQ(eval("get_pins u1/* -filter {direction == out}"),
+            "u1/lut/Y u1/reg/Q");
+  EXPECT_EQ(eval("get_ports -filter {direction == \"in\"}"), "in clk");
+  eval("create_clock -period 4 clk");
+  eval("create_clock -period 8 -name slow");
+  EXPECT_EQ(eval("get_clocks -filter {period < 5}"), "clk");
+  // Compiled once, the same Tcl object used for another kind
+  eval("set f {name =~ *l*}");
+  EXPECT_EQ(eval("get_cells -filter $f"), "u1/lut u2/lut");
+  EXPECT_EQ(eval("get_clocks -filter $f"), "clk slow");
+  EXPECT_EQ(eval("get_cells -filter $f"), "u1/lut u2/lut");
+
+  int code = TCL_OK;
+  EXPECT_THAT(interp.evalCmd("get_cells -filter {colour == red}", &code),
+              testing::HasSubstr("unknown cell property \"colour\""));
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("get_nets -filter {fanout > many}", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("get_nets -filter {(fanout > 1}", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("get_nets -filter {fanout =~ 1}", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+}
+
+TEST(SdcCommands, CollectionsKeepTheirIds) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string& error) { return &constraints; });
+  TclInterpreter interp;
+  sdc.Register(&interp);
+  auto eval = [&interp](const std::string& script) {
+    int code = TCL_OK;
+    std::string result = interp.evalCmd(script, &code);
+    EXPECT_EQ(code, TCL_OK) << script << ": " << result;
+    return result;
+  };
+  EXPECT_EQ(eval("sizeof_collection [get_pins]"), "7");
+  EXPECT_EQ(eval("sizeof_collection {}"), "0");
+  // Names are resolved once, the value keeps its string
+  EXPECT_EQ(eval("set c {u1/* u2/lut}; sizeof_collection $c"), "3");
+  EXPECT_EQ(eval("set c"), "u1/* u2/lut");
+  EXPECT_EQ(eval("set names {}\n"
+                 "foreach_in_collection cell [get_cells] {\n"
+                 "  if {[get_object_name $cell] == \"u2/lut\"} break\n"
+                 "  lappend names [sizeof_collection $cell] $cell\n"
+                 "}\n"
+                 "set names"),
+            "1 u1/lut 1 u1/reg");
+  EXPECT_EQ(eval("filter_collection [get_cells] {type == lut}"),
+            "u1/lut u2/lut");
+  EXPECT_EQ(eval("add_to_collection [get_cells u1/*] [get_cells u2/*]"),
+            "u1/lut u1/reg u2/lut");
+  EXPECT_EQ(eval("add_to_collection {} [get_nets u1/*] -unique"),
+            "u1/a u1/q");
+  EXPECT_EQ(eval("remove_from_collection [get_cells] u1/lut"),
+            "u1/reg u2/lut");
+  EXPECT_EQ(eval("remove_from_collection -intersect [get_cells] {u*/lut}"),
+            "u1/lut u2/lut");
+  EXPECT_EQ(eval("get_object_name [get_ports]"), "in clk out");
+  // Names are resolved again for a new binding, objects are stale
+  eval("set cells [get_cells u1/*]");
+  constraints.Bind(netlist);
+  EXPECT_EQ(eval("sizeof_collection $c"), "3");
+  EXPECT_EQ(eval("remove_from_collection $c u1/lut"), "u1/reg u2/lut");
+  eval("set_false_path -from $c");
+
+  int code = TCL_OK;
+  interp.evalCmd("sizeof_collection $cells", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("add_to_collection [get_cells] [get_nets]", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("sizeof_collection {in u1/a}", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("foreach_in_collection c [get_cells] {error stop}", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+}
+
+TEST(SdcCommands, WarnsAboutPatternsMatchingNothing) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  std::ostringstream out;
+  SdcCommands sdc([&constraints](std::string& error) { return &constraints; },
+                  out);
+  TclInterpreter interp;
+  sdc.Register(&interp);
+  auto eval = [&interp](const std::string& script) {
+    int code = TCL_OK;
+    std::string result = interp.evalCmd(script, &code);
+    EXPECT_EQ(code, TCL_OK) << script << ": " << result;
+    return result;
+  };
+  EXPECT_EQ(eval("get_cells {u1/reg nope} u3/*"), "u1/reg");
+  EXPECT_EQ(out.str(),
+            "WARNING: get_cells: no cell matches \"nope\"\n"
+            "WARNING: get_cells: no cell matches \"u3/*\"\n");
+  out.str("");
+  EXPECT_EQ(eval("get_ports nope -quiet"), "");
+  EXPECT_EQ(eval("get_nets -quiet -filter {pins > 9} u*"), "");
+  EXPECT_EQ(out.str(), "");
+  // Filtered out is not unmatched
+  EXPECT_EQ(eval("get_cells u1/* -filter {type == dsp}"), "");
+  EXPECT_EQ(out.str(), "");
+}
+
+TEST(SdcCommands, PathsAreCollections) {
+  Netlist netlist;
+  BuildDesign(netlist);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string& error) { return &constraints; });
+  TclInterpreter interp;
+  sdc.Register(&interp);
+  // Port pins too, which the pin queries leave out
+  auto pin = [&netlist](const std::string& name) {
+    const size_t slash = name.rfind('/');
+    Netlist::CellId cell = netlist.FindCell(name.substr(0, slash));
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      if (netlist.PinName(pin) == name.substr(slash + 1)) return pin;
+    }
+    return Netlist::kNone;
+  };
+  std::vector<SdcCommands::TimingPath> paths(2);
+  paths[0].m_slack = -0.5;
+  paths[0].m_corner = "slow";
+  paths[0].m_pins = {pin("u1/reg/Q"), pin("u2/lut/A"), pin("u2/lut/Y"),
+                     pin("out/A")};
+  paths[1].m_slack = 1.25;
+  paths[1].m_arrival = 2;
+  paths[1].m_required = 3.25;
+  paths[1].m_corner = "fast";
+  paths[1].m_pins = {pin("in/Y"), pin("u1/lut/A"), pin("u1/lut/Y"),
+                     pin("u1/reg/D")};
+  Tcl_SetVar2Ex(interp.getInterp(), "paths", nullptr,
+                SdcCommands::NewPathCollection(constraints, paths),
+                TCL_GLOBAL_ONLY);
+  auto eval = [&interp](const std::string& script) {
+    int code = TCL_OK;
+    std::string result = interp.evalCmd(script, &code);
+    EXPECT_EQ(code, TCL_OK) << script << ": " << result;
+    return result;
+  };
+  EXPECT_EQ(eval("sizeof_collection $paths"), "2");
+  EXPECT_EQ(eval("get_path_property $paths slack"), "-0.500 1.250");
+  EXPECT_EQ(eval("set ends {}\n"
+                 "foreach_in_collection path $paths {\n"
+                 "  lappend ends [get_path_property $path corner] \\\n"
+                 "      [get_object_name [get_path_property $path endpoint]]\n"
+                 "}\n"
+                 "set ends"),
+            "slow out/A fast u1/reg/D");
+  EXPECT_EQ(eval("get_object_name [get_path_property $paths startpoint]"),
+            "in/Y u1/reg/Q");
+  EXPECT_EQ(eval("foreach_in_collection path $paths {\n"
+                 "  return [get_path_property $path pins]\n"
+                 "}"),
+            "u1/reg/Q u2/lut/A u2/lut/Y out/A");
+  EXPECT_EQ(eval("dict get [lindex $paths 1] required"), "3.250");
+  EXPECT_EQ(eval("dict get [lindex $paths 0] endpoint"), "out/A");
+
+  int code = TCL_OK;
+  interp.evalCmd("get_path_property $paths fanout", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("get_path_property [get_pins u1/reg/Q] slack", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  interp.evalCmd("set_false_path -from $paths", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+  // Named in a netlist gone since
+  constraints.Bind(netlist);
+  interp.evalCmd("get_path_property $paths slack", &code);
+  EXPECT_EQ(code, TCL_ERROR);
+}
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,303 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "Compiler/StageCache.h"
+
+using namespace FOEDAG;
+namespace fs = std::filesystem;
+
+static const char kMagic[8] = {'F', 'D', 'G', 'C', 'A', 'C', 'H', 'E'};
+static const uint32_t kVersion = 1;
+static const char* kEntryExtension = ".bin";
+static const char* kLimitFile = "size_limit";
+
+struct CacheHeader {
+  char m_magic[8];
+  uint32_t m_version;
+  uint32_t m_reserved;
+  uint64_t m_rawSize;
+  uint64_t m_compressedSize;
+};
+
+void StageCache::SetDirectory(const std::string& directory) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_directory = directory;
+  m_sizeLimit = kDefaultSizeLimit;
+  m_sizeKnown = false;
+  if (m_directory.empty()) return;
+  std::error_code ec;
+  fs::create_directories(m_directory, ec);
+  std::ifstream limit(m_directory / kLimitFile);
+  uint64_t bytes = 0;
+  if (limit >> bytes) m_sizeLimit = bytes;
+}
+
+std::string StageCache::Key(uint64_t fingerprint) {
+  static const char* digits = "0123456789abcdef";
+  std::string key(16, '0');
+  for (int i = 15; i >= 0; i--) {
+    key[i] = digits[fingerprint & 0xf];
+    fingerprint >>= 4;
+  }
+  return key;
+}
+
+bool StageCache::ValidKey(const std::string& key) {
+  if (key.size() != 16) return false;
+  for (char c : key) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+  }
+  return true;
+}
+
+fs::path StageCache::UserDirectory() {
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg) return fs::path(xdg) / "foedag";
+#ifdef _WIN32
+  const char* local = std::getenv("LOCALAPPDATA");
+  if (local && *local) return fs::path(local) / "foedag";
+#else
+  const char* home = std::getenv("HOME");
+  if (home && *home) return fs::path(home) / ".cache" / "foedag";
+#endif
+  std::error_code ec;
+  fs::path directory = fs::temp_directory_path(ec);
+  if (ec) return fs::path();
+#ifdef _WIN32
+  return directory / "foedag";
+#else
+  // The temporary directory is shared, another user may have made ours
+  directory /= "foedag_" + std::to_string(getuid());
+  fs::create_directories(directory, ec);
+  struct stat info;
+  if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) ||
+      info.st_uid != getuid()) {
+    return fs::path();
+  }
+  fs::permissions(directory, fs::perms::owner_all, ec);
+  return directory;
+#endif
+}
+
+// Entries are fanned out over 256 sub directories on the key prefix
+fs::path StageCache::EntryPath(const std::string& key) const {
+  if (!ValidKey(key)) return fs::path();
+  return m_directory / key.substr(0, 2) / (key + kEntryExtension);
+}
+
+bool StageCache::Store(const std::string& key, const std::string& payload) {
+  if (!Enabled() || !ValidKey(key)) return false;
+  uLongf compressedSize = compressBound((uLong)payload.size());
+  std::vector<Bytef> compressed(compressedSize);
+  // Stage results are large and written on the critical path, favor speed
+  if (compress2(compressed.data(), &compressedSize,
+                (const Bytef*)payload.data(), (uLong)payload.size(),
+                Z_BEST_SPEED) != Z_OK) {
+    return false;
+  }
+
+  fs::path path;
+  fs::path tmp;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    path = EntryPath(key);
+    tmp = path;
+    // Several caches of the process may share the directory
+    static std::atomic<uint64_t> counter{0};
+    tmp += ".tmp" + std::to_string(getpid()) + "_" +
+           std::to_string(counter++);
+  }
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    CacheHeader header;
+    memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_reserved = 0;
+    header.m_rawSize = payload.size();
+    header.m_compressedSize = compressedSize;
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)compressed.data(), compressedSize);
+    if (!out) {
+      out.close();
+      fs::remove(tmp, ec);
+      return false;
+    }
+  }
+  const uintmax_t replaced = fs::file_size(path, ec);
+  const bool existed = !ec;
+  // Readers either see the previous entry or the complete new one
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  bool prune = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_sizeKnown) {
+      // The scan already sees the new entry
+      m_size = 0;
+      for (const Entry& entry : ScanEntries()) m_size += entry.m_size;
+      m_sizeKnown = true;
+    } else {
+      m_size += sizeof(CacheHeader) + compressedSize;
+      if (existed) m_size -= std::min<uintmax_t>(m_size, replaced);
+    }
+    prune = m_size > m_sizeLimit;
+  }
+  if (prune) Prune(m_sizeLimit);
+  return true;
+}
+
+bool StageCache::Load(const std::string& key, std::string& payload) {
+  if (!ValidKey(key)) return false;
+  if (!Enabled()) return m_fallback && m_fallback->Load(key, payload);
+  fs::path path = EntryPath(key);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return m_fallback && m_fallback->Load(key, payload);
+  CacheHeader header;
+  if (!in.read((char*)&header, sizeof(header)) ||
+      memcmp(header.m_magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.m_version != kVersion) {
+    return false;
+  }
+  // Sizes are checked before anything is allocated for them: the data must
+  // be in the file, and deflate expands at most 1032 times
+  std::error_code ec;
+  const uintmax_t fileSize = fs::file_size(path, ec);
+  if (ec || header.m_compressedSize != fileSize - sizeof(header) ||
+      header.m_rawSize / 1032 > header.m_compressedSize) {
+    return false;
+  }
+  std::vector<Bytef> compressed(header.m_compressedSize);
+  if (!in.read((char*)compressed.data(), compressed.size())) return false;
+  payload.resize(header.m_rawSize);
+  uLongf rawSize = (uLongf)header.m_rawSize;
+  if (uncompress((Bytef*)payload.data(), &rawSize, compressed.data(),
+                 (uLong)compressed.size()) != Z_OK ||
+      rawSize != header.m_rawSize) {
+    payload.clear();
+    return false;
+  }
+  in.close();
+  // Refresh the LRU position
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+bool StageCache::Contains(const std::string& key) {
+  if (!ValidKey(key)) return false;
+  std::error_code ec;
+  if (Enabled() && fs::exists(EntryPath(key), ec)) return true;
+  return m_fallback && m_fallback->Contains(key);
+}
+
+std::vector<StageCache::Entry> StageCache::ScanEntries() {
+  std::vector<Entry> entries;
+  if (!Enabled()) return entries;
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator(m_directory, ec);
+       it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (ec) break;
+    if (!it->is_regular_file(ec)) continue;
+    const fs::path& path = it->path();
+    if (path.extension() != kEntryExtension) continue;
+    Entry entry;
+    entry.m_key = path.stem().string();
+    if (!ValidKey(entry.m_key)) continue;
+    entry.m_size = it->file_size(ec);
+    entry.m_lastUse = it->last_write_time(ec);
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+std::vector<StageCache::Entry> StageCache::Entries() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Entry> entries = ScanEntries();
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return a.m_lastUse > b.m_lastUse;
+            });
+  return entries;
+}
+
+uintmax_t StageCache::Size() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uintmax_t size = 0;
+  for (const Entry& entry : ScanEntries()) size += entry.m_size;
+  m_size = size;
+  m_sizeKnown = true;
+  return size;
+}
+
+void StageCache::SetSizeLimit(uint64_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sizeLimit = bytes;
+    if (Enabled()) {
+      std::ofstream limit(m_directory / kLimitFile, std::ios::trunc);
+      limit << bytes << std::endl;
+    }
+  }
+  Prune(bytes);
+}
+
+size_t StageCache::Prune(uint64_t maxBytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Entry> entries = ScanEntries();
+  uintmax_t size = 0;
+  for (const Entry& entry : entries) size += entry.m_size;
+  // Oldest first
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return a.m_lastUse < b.m_lastUse;
+            });
+  size_t evicted = 0;
+  std::error_code ec;
+  for (const Entry& entry : entries) {
+    if (size <= maxBytes) break;
+    if (fs::remove(EntryPath(entry.m_key), ec)) {
+      size -= entry.m_size;
+      evicted++;
+    }
+  }
+  m_size = size;
+  m_sizeKnown = true;
+  return evicted;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef STAGE_CACHE_H
+#define STAGE_CACHE_H
+
+namespace FOEDAG {
+
+// Content addressed store of stage results, keyed by the fingerprint of the
+// stage inputs. Entries are zlib compressed, written atomically (temporary
+// file + rename) and evicted least recently used first once the store grows
+// past its size limit. Loading an entry refreshes its modification time,
+// which is what the LRU order is based on, so the order survives restarts.
+// Writes keep a running total of the store size, counted once on the first
+// write and again at every prune, so that they do not walk the directory;
+// entries other processes write meanwhile only count from the next prune.
+class StageCache {
+ public:
+  struct Entry {
+    std::string m_key;
+    uintmax_t m_size = 0;
+    std::filesystem::file_time_type m_lastUse;
+  };
+
+  static const uint64_t kDefaultSizeLimit = 2ULL << 30;  // 2GB
+
+  // An empty directory disables the cache
+  void SetDirectory(const std::string& directory);
+  const std::filesystem::path& Directory() const { return m_directory; }
+  bool Enabled() const { return !m_directory.empty(); }
+
+  static std::string Key(uint64_t fingerprint);
+  // Keys are exactly what Key() makes, 16 lower case hex digits: they name
+  // files, anything else is refused
+  static bool ValidKey(const std::string& key);
+  // Root of the caches of the current user: $XDG_CACHE_HOME/foedag,
+  // ~/.cache/foedag or %LOCALAPPDATA%\foedag, otherwise foedag_<uid> in
+  // the temporary directory when the user owns it. Empty when there is
+  // none, caches then stay in memory.
+  static std::filesystem::path UserDirectory();
+
+  bool Store(const std::string& key, const std::string& payload);
+  bool Load(const std::string& key, std::string& payload);
+  bool Contains(const std::string& key);
+
+  // Read only store looked up after this one, never written to
+  void SetFallback(StageCache* fallback) { m_fallback = fallback; }
+
+  std::vector<Entry> Entries();
+  uintmax_t Size();
+
+  // Size limit in bytes, persisted in the cache directory
+  void SetSizeLimit(uint64_t bytes);
+  uint64_t SizeLimit() const { return m_sizeLimit; }
+
+  // Evicts least recently used entries until the store fits in maxBytes,
+  // returns the number of evicted entries
+  size_t Prune(uint64_t maxBytes);
+  size_t Clear() { return Prune(0); }
+
+ private:
+  // Empty for an invalid key
+  std::filesystem::path EntryPath(const std::string& key) const;
+  std::vector<Entry> ScanEntries();
+
+  std::mutex m_mutex;
+  std::filesystem::path m_directory;
+  uint64_t m_sizeLimit = kDefaultSizeLimit;
+  // Running total of the entry sizes, valid when m_sizeKnown
+  uintmax_t m_size = 0;
+  bool m_sizeKnown = false;
+  StageCache* m_fallback = nullptr;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,140 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/StageCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+class StageCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_dir = std::filesystem::temp_directory_path() / "foedag_stage_cache_test";
+    std::filesystem::remove_all(m_dir);
+    m_cache.SetDirectory(m_dir.string());
+  }
+  void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+  std::filesystem::path m_dir;
+  StageCache m_cache;
+};
+
+TEST_F(StageCacheTest, StoreAndLoad) {
+  std::string payload(100000, 'x');
+  std::string key = StageCache::Key(0x1234abcdULL);
+  EXPECT_EQ(key, "000000001234abcd");
+  EXPECT_FALSE(m_cache.Contains(key));
+  EXPECT_TRUE(m_cache.Store(key, payload));
+  EXPECT_TRUE(m_cache.Contains(key));
+  // Compressed on disk
+  EXPECT_LT(m_cache.Size(), payload.size());
+  std::string loaded;
+  EXPECT_TRUE(m_cache.Load(key, loaded));
+  EXPECT_EQ(loaded, payload);
+  EXPECT_FALSE(m_cache.Load(StageCache::Key(1), loaded));
+}
+
+TEST_F(StageCacheTest, EvictsLeastRecentlyUsed) {
+  using namespace std::chrono_literals;
+  std::string payload;
+  EXPECT_TRUE(m_cache.Store(StageCache::Key(1), "first"));
+  EXPECT_TRUE(m_cache.Store(StageCache::Key(2), "second"));
+  std::filesystem::path first =
+      m_dir / "00" / (StageCache::Key(1) + ".bin");
+  std::filesystem::last_write_time(
+      first, std::filesystem::file_time_type::clock::now() + 1h);
+  // Entry 2 is now the least recently used one
+  EXPECT_EQ(m_cache.Prune(m_cache.Size() - 1), 1u);
+  EXPECT_TRUE(m_cache.Contains(StageCache::Key(1)));
+  EXPECT_FALSE(m_cache.Contains(StageCache::Key(2)));
+  EXPECT_EQ(m_cache.Clear(), 1u);
+  EXPECT_EQ(m_cache.Size(), 0u);
+}
+
+TEST_F(StageCacheTest, SizeLimitIsPersisted) {
+  m_cache.SetSizeLimit(1 << 20);
+  StageCache other;
+  other.SetDirectory(m_dir.string());
+  EXPECT_EQ(other.SizeLimit(), 1u << 20);
+}
+
+TEST_F(StageCacheTest, WritesStayUnderTheSizeLimit) {
+  EXPECT_TRUE(m_cache.Store(StageCache::Key(1), "first"));
+  const uintmax_t entry = m_cache.Size();
+  m_cache.SetSizeLimit(3 * entry);
+  for (uint64_t key = 2; key <= 10; key++) {
+    EXPECT_TRUE(m_cache.Store(StageCache::Key(key), "entry"));
+  }
+  // Stored again, the same entry is not counted twice
+  EXPECT_TRUE(m_cache.Store(StageCache::Key(10), "entry"));
+  EXPECT_LE(m_cache.Size(), 3 * entry);
+  EXPECT_TRUE(m_cache.Contains(StageCache::Key(10)));
+}
+
+TEST_F(StageCacheTest, RefusesSizesBeyondTheFile) {
+  std::string key = StageCache::Key(1);
+  EXPECT_TRUE(m_cache.Store(key, "payload"));
+  std::filesystem::path path = m_dir / "00" / (key + ".bin");
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  // Compressed size of the header, past magic, version and raw size
+  const uint64_t huge = 1ULL << 60;
+  file.seekp(24);
+  file.write((const char*)&huge, sizeof(huge));
+  file.close();
+  std::string payload;
+  EXPECT_FALSE(m_cache.Load(key, payload));
+}
+
+TEST_F(StageCacheTest, RefusesKeysThatAreNotFingerprints) {
+  for (const char* key : {"../../escape", "0123", "0123456789ABCDEF",
+                          "0123456789abcdef0"}) {
+    EXPECT_FALSE(m_cache.Store(key, "payload")) << key;
+    std::string payload;
+    EXPECT_FALSE(m_cache.Load(key, payload)) << key;
+  }
+  EXPECT_FALSE(std::filesystem::exists(m_dir.parent_path() / "escape.bin"));
+  EXPECT_TRUE(m_cache.Entries().empty());
+}
+
+TEST_F(StageCacheTest, ReadsThroughToTheFallback) {
+  const std::string sharedDir = m_dir.string() + "_shared";
+  StageCache shared;
+  shared.SetDirectory(sharedDir);
+  EXPECT_TRUE(shared.Store(StageCache::Key(1), "shared"));
+  m_cache.SetFallback(&shared);
+  std::string payload;
+  EXPECT_TRUE(m_cache.Contains(StageCache::Key(1)));
+  EXPECT_TRUE(m_cache.Load(StageCache::Key(1), payload));
+  EXPECT_EQ(payload, "shared");
+  // Stores stay in this cache
+  EXPECT_TRUE(m_cache.Store(StageCache::Key(2), "own"));
+  EXPECT_FALSE(shared.Contains(StageCache::Key(2)));
+  m_cache.SetFallback(nullptr);
+  std::filesystem::remove_all(sharedDir);
+}
+
+}  // namespace
+}  // namespace FOEDAG
@@ -0,0 +1,302 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/StageProcess.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+using namespace FOEDAG;
+
+namespace FOEDAG {
+
+// Where the child output goes, shared with the file handlers of the
+// notifier thread, which outlive the StageProcess after a cancellation
+struct StageOutput {
+  std::mutex m_mutex;
+  std::condition_variable m_closed;
+  std::ostream* m_out = nullptr;  // dropped once null
+  int m_open = 0;
+};
+
+}  // namespace FOEDAG
+
+namespace {
+
+// The file handler only knows the descriptor, pair it with the output
+struct PipeHandler {
+  std::shared_ptr<StageOutput> m_output;
+  int m_fd;
+};
+
+// Queued to the notifier thread, only that thread registers its handlers
+struct RegisterEvent {
+  Tcl_Event m_header;
+  PipeHandler* m_handlers[2];
+};
+
+}  // namespace
+
+// Returns false at end of file
+static bool Forward(int fd, StageOutput& output) {
+#ifndef _WIN32
+  char buffer[4096];
+  for (;;) {
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (count > 0) {
+      std::lock_guard<std::mutex> lock(output.m_mutex);
+      if (output.m_out) output.m_out->write(buffer, count);
+      continue;
+    }
+    if (count < 0 && errno == EINTR) continue;
+    std::lock_guard<std::mutex> lock(output.m_mutex);
+    if (output.m_out) output.m_out->flush();
+    return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+#else
+  return false;
+#endif
+}
+
+static void OnReadable(ClientData clientData, int mask) {
+  PipeHandler* handler = (PipeHandler*)clientData;
+  StageOutput& output = *handler->m_output;
+  if (Forward(handler->m_fd, output)) return;
+#ifndef _WIN32
+  Tcl_DeleteFileHandler(handler->m_fd);
+  close(handler->m_fd);
+#endif
+  {
+    std::lock_guard<std::mutex> lock(output.m_mutex);
+    output.m_open--;
+  }
+  output.m_closed.notify_all();
+  delete handler;
+}
+
+static int OnRegister(Tcl_Event* event, int flags) {
+#ifndef _WIN32
+  for (PipeHandler* handler : ((RegisterEvent*)event)->m_handlers) {
+    Tcl_CreateFileHandler(handler->m_fd, TCL_READABLE, OnReadable, handler);
+  }
+#endif
+  return 1;
+}
+
+StageProcess::~StageProcess() {
+  Kill();
+  Wait();
+}
+
+bool StageProcess::Supported() {
+#ifdef _WIN32
+  return false;
+#else
+  return true;
+#endif
+}
+
+bool StageProcess::Start(const std::string& executable,
+                         const std::vector<std::string>& args) {
+#ifdef _WIN32
+  m_error = "out of process execution is not supported on this platform";
+  return false;
+#else
+  int outPipe[2];
+  int errPipe[2];
+  if (pipe(outPipe) != 0) {
+    m_error = std::string("pipe: ") + strerror(errno);
+    return false;
+  }
+  if (pipe(errPipe) != 0) {
+    m_error = std::string("pipe: ") + strerror(errno);
+    close(outPipe[0]);
+    close(outPipe[1]);
+    return false;
+  }
+  // Built before forking, only async-signal-safe calls in the child
+  std::vector<char*> argv;
+  argv.push_back((char*)executable.c_str());
+  for (auto& arg : args) argv.push_back((char*)arg.c_str());
+  argv.push_back(nullptr);
+
+  m_pid = fork();
+  if (m_pid < 0) {
+    m_error = std::string("fork: ") + strerror(errno);
+    for (int fd : {outPipe[0], outPipe[1], errPipe[0], errPipe[1]}) close(fd);
+    return false;
+  }
+  if (m_pid == 0) {
+    // Own process group, so that killing the worker also kills whatever it
+    // spawned and still holds the pipes
+    setpgid(0, 0);
+    if (m_limits.m_memoryMB) {
+      struct rlimit limit;
+      limit.rlim_cur = limit.rlim_max = (rlim_t)m_limits.m_memoryMB << 20;
+      setrlimit(RLIMIT_AS, &limit);
+    }
+    if (m_limits.m_cpuSeconds) {
+      struct rlimit limit;
+      limit.rlim_cur = (rlim_t)m_limits.m_cpuSeconds;
+      // SIGXCPU at the soft limit, SIGKILL one second later
+      limit.rlim_max = (rlim_t)m_limits.m_cpuSeconds + 1;
+      setrlimit(RLIMIT_CPU, &limit);
+    }
+    dup2(outPipe[1], STDOUT_FILENO);
+    dup2(errPipe[1], STDERR_FILENO);
+    for (int fd : {outPipe[0], outPipe[1], errPipe[0], errPipe[1]}) close(fd);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  // Also from the parent, the group must exist before any Kill()
+  setpgid(m_pid, m_pid);
+  close(outPipe[1]);
+  close(errPipe[1]);
+  m_stdout = outPipe[0];
+  m_stderr = errPipe[0];
+  for (int fd : {m_stdout, m_stderr}) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  return true;
+#endif
+}
+
+void StageProcess::Stream(const CancellationToken& token,
+                          Tcl_ThreadId notifierThread) {
+#ifndef _WIN32
+  if (m_pid <= 0) return;
+  if (notifierThread == nullptr) {
+    ReadPipes(token);
+    return;
+  }
+  auto output = std::make_shared<StageOutput>();
+  output->m_out = &m_out;
+  output->m_open = 2;
+  RegisterEvent* event = (RegisterEvent*)ckalloc(sizeof(RegisterEvent));
+  event->m_header.proc = OnRegister;
+  event->m_handlers[0] = new PipeHandler{output, m_stdout};
+  event->m_handlers[1] = new PipeHandler{output, m_stderr};
+  // The handlers close the pipes
+  m_stdout = -1;
+  m_stderr = -1;
+
+  if (notifierThread == Tcl_GetCurrentThread()) {
+    OnRegister(&event->m_header, TCL_FILE_EVENTS);
+    ckfree((char*)event);
+    // Only file events, so that no script runs meanwhile. A cancellation
+    // is noticed on the next output of the child.
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(output->m_mutex);
+        if (output->m_open == 0) return;
+      }
+      if (token.Cancelled()) Kill();
+      Tcl_DoOneEvent(TCL_FILE_EVENTS);
+    }
+  }
+  Tcl_ThreadQueueEvent(notifierThread, &event->m_header, TCL_QUEUE_TAIL);
+  Tcl_ThreadAlert(notifierThread);
+  // The token is a plain flag, looked at whenever the wait times out
+  std::unique_lock<std::mutex> lock(output->m_mutex);
+  while (output->m_open > 0) {
+    if (token.Cancelled()) {
+      Kill();
+      output->m_out = nullptr;
+      return;
+    }
+    output->m_closed.wait_for(lock, std::chrono::milliseconds(100));
+  }
+#endif
+}
+
+// No event loop to hand the pipes to, the calling thread reads them
+void StageProcess::ReadPipes(const CancellationToken& token) {
+#ifndef _WIN32
+  StageOutput output;
+  output.m_out = &m_out;
+  while (m_stdout >= 0 || m_stderr >= 0) {
+    struct pollfd fds[2];
+    int count = 0;
+    for (int fd : {m_stdout, m_stderr}) {
+      if (fd >= 0) fds[count++] = {fd, POLLIN, 0};
+    }
+    poll(fds, count, 100);
+    for (int i = 0; i < count; i++) {
+      if (!fds[i].revents || Forward(fds[i].fd, output)) continue;
+      close(fds[i].fd);
+      if (fds[i].fd == m_stdout) m_stdout = -1;
+      if (fds[i].fd == m_stderr) m_stderr = -1;
+    }
+    if (token.Cancelled()) Kill();
+  }
+#endif
+}
+
+void StageProcess::Kill() {
+#ifndef _WIN32
+  if (m_pid > 0) kill(-m_pid, SIGKILL);
+#endif
+}
+
+bool StageProcess::Wait() {
+#ifndef _WIN32
+  if (m_pid <= 0) return false;
+  int status = 0;
+  while (waitpid(m_pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  m_pid = -1;
+  for (int fd : {m_stdout, m_stderr}) {
+    if (fd >= 0) close(fd);
+  }
+  m_stdout = -1;
+  m_stderr = -1;
+  if (WIFEXITED(status)) {
+    if (WEXITSTATUS(status) == 0) return true;
+    m_error = "worker exited with status " +
+              std::to_string(WEXITSTATUS(status));
+    if (WEXITSTATUS(status) == 127) m_error += " (could not be started)";
+  } else if (WIFSIGNALED(status)) {
+    int sig = WTERMSIG(status);
+    m_error = "worker killed by signal " + std::to_string(sig);
+    if (sig == SIGXCPU || (sig == SIGKILL && m_limits.m_cpuSeconds)) {
+      m_error += " (CPU limit or cancellation)";
+    } else if (sig == SIGABRT || sig == SIGSEGV) {
+      m_error += m_limits.m_memoryMB ? " (crash, possibly the memory limit)"
+                                     : " (crash)";
+    }
+  }
+  return false;
+#else
+  return false;
+#endif
+}
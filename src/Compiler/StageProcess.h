@@ -0,0 +1,89 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <tcl.h>
+}
+
+#include "Compiler/EventBus.h"
+
+#ifndef STAGE_PROCESS_H
+#define STAGE_PROCESS_H
+
+namespace FOEDAG {
+
+struct StageOutput;
+
+// A stage executed in a child worker process (Unix only). The child runs
+// under memory and CPU rlimits; its stdout and stderr come back through
+// pipes, registered with Tcl_CreateFileHandler on the thread of the Tcl
+// notifier (QtTclNotifier in the GUI) and serviced by its event loop.
+class StageProcess {
+ public:
+  struct Limits {
+    uint64_t m_memoryMB = 0;    // RLIMIT_AS, 0 for unlimited
+    uint64_t m_cpuSeconds = 0;  // RLIMIT_CPU, 0 for unlimited
+  };
+
+  StageProcess(std::ostream& out, const Limits& limits)
+      : m_out(out), m_limits(limits) {}
+  ~StageProcess();
+
+  static bool Supported();
+
+  bool Start(const std::string& executable,
+             const std::vector<std::string>& args);
+  // Forwards the child output until both pipes are closed, killing the
+  // child if token gets cancelled. The pipes are handed to the event loop
+  // of notifierThread: from that thread, Stream() services its file events
+  // until they close; from any other, it waits for the loop to close them.
+  // Once cancelled, it returns without the loop and the output is dropped,
+  // so a loop blocked on the stage itself cannot stall it. Without a
+  // notifier thread, the calling thread reads the pipes.
+  void Stream(const CancellationToken& token, Tcl_ThreadId notifierThread);
+  // Reaps the child, returns true if it exited with status 0. Otherwise
+  // describes how it ended in Error().
+  bool Wait();
+  void Kill();
+
+  const std::string& Error() const { return m_error; }
+
+ private:
+  void ReadPipes(const CancellationToken& token);
+
+  std::ostream& m_out;
+  Limits m_limits;
+  int m_pid = -1;
+  // Until handed to the notifier thread
+  int m_stdout = -1;
+  int m_stderr = -1;
+  std::string m_error;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,126 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/StageProcess.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(StageProcess, StreamsOutputAndExitStatus) {
+  if (!StageProcess::Supported()) GTEST_SKIP();
+  std::ostringstream out;
+  StageProcess process(out, StageProcess::Limits());
+  ASSERT_TRUE(process.Start("/bin/sh", {"-c", "echo out; echo err >&2"}));
+  process.Stream(CancellationToken(), nullptr);
+  EXPECT_TRUE(process.Wait());
+  EXPECT_THAT(out.str(), testing::HasSubstr("out\n"));
+  EXPECT_THAT(out.str(), testing::HasSubstr("err\n"));
+
+  StageProcess failing(out, StageProcess::Limits());
+  ASSERT_TRUE(failing.Start("/bin/sh", {"-c", "exit 3"}));
+  failing.Stream(CancellationToken(), nullptr);
+  EXPECT_FALSE(failing.Wait());
+  EXPECT_THAT(failing.Error(), testing::HasSubstr("status 3"));
+}
+
+TEST(StageProcess, CancellationKillsTheChild) {
+  if (!StageProcess::Supported()) GTEST_SKIP();
+  std::ostringstream out;
+  StageProcess process(out, StageProcess::Limits());
+  ASSERT_TRUE(process.Start("/bin/sh", {"-c", "sleep 30"}));
+  CancellationToken token;
+  token.Cancel();
+  process.Stream(token, nullptr);
+  EXPECT_FALSE(process.Wait());
+  EXPECT_THAT(process.Error(), testing::HasSubstr("signal 9"));
+}
+
+// Services the events of this thread until done is set
+void RunEventLoop(const std::atomic<bool>& done) {
+  while (!done) {
+    if (!Tcl_DoOneEvent(TCL_ALL_EVENTS | TCL_DONT_WAIT)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+TEST(StageProcess, StreamsThroughTheEventLoop) {
+  if (!StageProcess::Supported()) GTEST_SKIP();
+  // Sets up the notifier, the application does it with its interpreter
+  Tcl_FindExecutable(nullptr);
+  std::ostringstream out;
+  StageProcess process(out, StageProcess::Limits());
+  ASSERT_TRUE(process.Start("/bin/sh", {"-c", "echo out; echo err >&2"}));
+  // From the notifier thread itself
+  process.Stream(CancellationToken(), Tcl_GetCurrentThread());
+  EXPECT_TRUE(process.Wait());
+  EXPECT_THAT(out.str(), testing::HasSubstr("out\n"));
+  EXPECT_THAT(out.str(), testing::HasSubstr("err\n"));
+
+  // From another thread, the pipes are serviced by the loop of this one
+  std::ostringstream threadOut;
+  StageProcess threaded(threadOut, StageProcess::Limits());
+  ASSERT_TRUE(threaded.Start("/bin/sh", {"-c", "echo out"}));
+  Tcl_ThreadId notifier = Tcl_GetCurrentThread();
+  std::atomic<bool> done{false};
+  std::thread worker([&] {
+    threaded.Stream(CancellationToken(), notifier);
+    done = true;
+  });
+  RunEventLoop(done);
+  worker.join();
+  EXPECT_TRUE(threaded.Wait());
+  EXPECT_EQ(threadOut.str(), "out\n");
+}
+
+TEST(StageProcess, CancellationDoesNotWaitForTheEventLoop) {
+  if (!StageProcess::Supported()) GTEST_SKIP();
+  Tcl_FindExecutable(nullptr);
+  std::ostringstream out;
+  StageProcess process(out, StageProcess::Limits());
+  ASSERT_TRUE(process.Start("/bin/sh", {"-c", "sleep 30"}));
+  // This thread services no event while the stage streams, as when a new
+  // compile waits for a cancelled one
+  CancellationToken token;
+  token.Cancel();
+  Tcl_ThreadId notifier = Tcl_GetCurrentThread();
+  std::thread worker([&] { process.Stream(token, notifier); });
+  worker.join();
+  EXPECT_FALSE(process.Wait());
+  EXPECT_THAT(process.Error(), testing::HasSubstr("signal 9"));
+  // The handlers close the pipes once the loop runs again
+  std::atomic<bool> done{false};
+  std::thread stopper([&done] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done = true;
+  });
+  RunEventLoop(done);
+  stopper.join();
+}
+}  // namespace
+}  // namespace FOEDAG
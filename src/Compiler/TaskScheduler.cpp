@@ -0,0 +1,263 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/TaskScheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace FOEDAG;
+
+// Identifies the scheduler and the worker index of the current thread
+static thread_local TaskScheduler* t_scheduler = nullptr;
+static thread_local int t_workerIndex = -1;
+
+TaskScheduler::TaskScheduler(unsigned int threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 2;  // Good minimum assumption
+  for (unsigned int i = 0; i < threads; i++) {
+    m_queues.emplace_back(new WorkQueue);
+  }
+  for (unsigned int i = 0; i < threads; i++) {
+    m_workers.emplace_back([this, i] { WorkerLoop((int)i); });
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stopping = true;
+  }
+  m_sleepCv.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+SpawnPool::SpawnPool(unsigned int limit) : m_limit(limit) {
+  if (m_limit == 0) m_limit = std::thread::hardware_concurrency();
+  if (m_limit == 0) m_limit = 2;
+}
+
+SpawnPool::~SpawnPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+SpawnPool* SpawnPool::Instance() {
+  // Never destroyed, for the same reason as the scheduler
+  static SpawnPool* pool = new SpawnPool;
+  return pool;
+}
+
+void SpawnPool::Run(std::function<void()> job) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_jobs.push_back(std::move(job));
+  // A new thread only when the idle ones cannot take every queued job
+  if (m_idle < m_jobs.size() && m_threads.size() < m_limit) {
+    m_threads.emplace_back([this] { ThreadLoop(); });
+  }
+  m_cv.notify_one();
+}
+
+void SpawnPool::ThreadLoop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_idle++;
+    m_cv.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+    m_idle--;
+    // Queued jobs still run, their handles are waited on
+    if (m_jobs.empty()) return;
+    std::function<void()> job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    lock.unlock();
+    job();
+    lock.lock();
+  }
+}
+
+TaskScheduler* TaskScheduler::Instance() {
+  // Never destroyed: joining the workers at exit would block on whatever
+  // stage is still running when the user quits
+  static TaskScheduler* scheduler = new TaskScheduler;
+  return scheduler;
+}
+
+bool TaskScheduler::OnWorkerThread() const { return t_scheduler == this; }
+
+void TaskScheduler::Push(Task task) {
+  TaskItem item{std::move(task), Clock::now()};
+  WorkQueue& queue = OnWorkerThread() ? *m_queues[t_workerIndex] : m_global;
+  {
+    std::lock_guard<std::mutex> lock(queue.m_mutex);
+    queue.m_tasks.push_back(std::move(item));
+  }
+  m_pending++;
+  // Taking the lock orders this notification after a sleeping worker's
+  // predicate check, so the wake up cannot be lost
+  { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+  m_sleepCv.notify_one();
+}
+
+bool TaskScheduler::Pop(int index, TaskItem& item) {
+  if (m_pending.load(std::memory_order_acquire) <= 0) return false;
+  // Own deque first, newest job (cache hot)
+  if (index >= 0) {
+    WorkQueue& own = *m_queues[index];
+    std::lock_guard<std::mutex> lock(own.m_mutex);
+    if (!own.m_tasks.empty()) {
+      item = std::move(own.m_tasks.back());
+      own.m_tasks.pop_back();
+      m_pending--;
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_global.m_mutex);
+    if (!m_global.m_tasks.empty()) {
+      item = std::move(m_global.m_tasks.front());
+      m_global.m_tasks.pop_front();
+      m_pending--;
+      return true;
+    }
+  }
+  // Steal the oldest job of another worker
+  const int count = (int)m_queues.size();
+  for (int i = 1; i <= count; i++) {
+    int victim = (index + i) % count;
+    if (victim == index) continue;
+    WorkQueue& queue = *m_queues[victim];
+    std::unique_lock<std::mutex> lock(queue.m_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || queue.m_tasks.empty()) continue;
+    item = std::move(queue.m_tasks.front());
+    queue.m_tasks.pop_front();
+    m_pending--;
+    m_steals++;
+    return true;
+  }
+  return false;
+}
+
+void TaskScheduler::Run(TaskItem& item) {
+  uint64_t wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      Clock::now() - item.m_enqueued)
+                      .count();
+  m_jobs++;
+  m_totalQueueWaitNs += wait;
+  uint64_t max = m_maxQueueWaitNs.load();
+  while (wait > max && !m_maxQueueWaitNs.compare_exchange_weak(max, wait)) {
+  }
+  item.m_task();
+}
+
+bool TaskScheduler::RunPendingTask() {
+  TaskItem item;
+  if (!Pop(OnWorkerThread() ? t_workerIndex : -1, item)) return false;
+  Run(item);
+  return true;
+}
+
+void TaskScheduler::WorkerLoop(int index) {
+  t_scheduler = this;
+  t_workerIndex = index;
+  while (true) {
+    TaskItem item;
+    if (Pop(index, item)) {
+      Run(item);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleepCv.wait(lock, [this] { return m_stopping || m_pending > 0; });
+    if (m_stopping && m_pending <= 0) break;
+  }
+  t_scheduler = nullptr;
+  t_workerIndex = -1;
+}
+
+void TaskScheduler::ParallelFor(size_t begin, size_t end, size_t grain,
+                                const std::function<void(size_t, size_t)>& body,
+                                unsigned int maxThreads) {
+  if (end <= begin) return;
+  if (grain == 0) grain = 1;
+  const size_t chunks = (end - begin + grain - 1) / grain;
+  size_t threads = (maxThreads == 0) ? Concurrency() : maxThreads;
+  threads = std::min(threads, chunks);
+  if (threads <= 1) {
+    body(begin, end);
+    return;
+  }
+
+  struct Shared {
+    std::atomic<size_t> m_next{0};
+    std::atomic<size_t> m_done{0};
+    std::mutex m_errorMutex;
+    std::exception_ptr m_error;
+  };
+  auto shared = std::make_shared<Shared>();
+  const std::function<void(size_t, size_t)>* bodyPtr = &body;
+  // Helpers may be scheduled after all chunks are gone, in which case they
+  // return without touching the body
+  auto worker = [shared, bodyPtr, begin, end, grain, chunks]() {
+    size_t chunk;
+    while ((chunk = shared->m_next.fetch_add(1)) < chunks) {
+      size_t from = begin + chunk * grain;
+      size_t to = std::min(end, from + grain);
+      try {
+        (*bodyPtr)(from, to);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(shared->m_errorMutex);
+        if (!shared->m_error) shared->m_error = std::current_exception();
+      }
+      shared->m_done++;
+    }
+  };
+  for (size_t i = 1; i < threads; i++) {
+    Push(worker);
+  }
+  worker();
+  // Remaining chunks are all held by running threads, no need to help
+  while (shared->m_done.load() < chunks) {
+    std::this_thread::yield();
+  }
+  if (shared->m_error) std::rethrow_exception(shared->m_error);
+}
+
+TaskScheduler::Stats TaskScheduler::GetStats() const {
+  Stats stats;
+  stats.m_jobs = m_jobs;
+  stats.m_steals = m_steals;
+  stats.m_totalQueueWaitNs = m_totalQueueWaitNs;
+  stats.m_maxQueueWaitNs = m_maxQueueWaitNs;
+  return stats;
+}
+
+void TaskScheduler::ResetStats() {
+  m_jobs = 0;
+  m_steals = 0;
+  m_totalQueueWaitNs = 0;
+  m_maxQueueWaitNs = 0;
+}
@@ -0,0 +1,211 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+namespace FOEDAG {
+
+class TaskScheduler;
+
+// Handle on a job submitted to the TaskScheduler. Waiting from one of the
+// scheduler's own workers on a job still queued runs it on that worker,
+// the queue then skips it: nested jobs cannot deadlock the pool, and a
+// wait never runs unrelated jobs. Any other wait blocks until the job is
+// done.
+template <typename T>
+class JobHandle {
+ public:
+  JobHandle() = default;
+  JobHandle(TaskScheduler* scheduler, std::shared_future<T> future,
+            std::function<void()> runQueued)
+      : m_scheduler(scheduler),
+        m_future(std::move(future)),
+        m_runQueued(std::move(runQueued)) {}
+
+  bool Valid() const { return m_future.valid(); }
+  bool Ready() const {
+    return m_future.valid() && m_future.wait_for(std::chrono::seconds(0)) ==
+                                   std::future_status::ready;
+  }
+  void Wait() const;
+  T Get() const {
+    Wait();
+    return m_future.get();
+  }
+
+ private:
+  TaskScheduler* m_scheduler = nullptr;
+  std::shared_future<T> m_future;
+  // Runs the job unless it started already
+  std::function<void()> m_runQueued;
+};
+
+// Threads for long-lived jobs, like whole compilations, that would hold a
+// TaskScheduler worker for as long as they run and leave their own
+// parallel loops fewer helpers. At most limit jobs run at once, the others
+// wait their turn in order. Threads are started on demand and kept, the
+// pool joins them when destroyed. A job must not wait on another job of
+// the same pool: it may be queued behind it.
+class SpawnPool {
+ public:
+  // limit == 0 sizes the pool to the machine
+  explicit SpawnPool(unsigned int limit = 0);
+  ~SpawnPool();
+  SpawnPool(const SpawnPool&) = delete;
+  SpawnPool& operator=(const SpawnPool&) = delete;
+
+  // Process wide pool of TaskScheduler::Spawn
+  static SpawnPool* Instance();
+
+  unsigned int Limit() const { return m_limit; }
+  void Run(std::function<void()> job);
+
+ private:
+  void ThreadLoop();
+
+  unsigned int m_limit = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_jobs;
+  std::vector<std::thread> m_threads;
+  unsigned int m_idle = 0;
+  bool m_stopping = false;
+};
+
+// Fixed size pool of worker threads shared by every compiler engine.
+// Each worker owns a deque: it pushes and pops its own jobs LIFO, while
+// idle workers steal FIFO from the other end. Jobs submitted from outside
+// the pool go through a global injection queue.
+class TaskScheduler {
+ public:
+  typedef std::function<void()> Task;
+  typedef std::chrono::steady_clock Clock;
+
+  struct Stats {
+    uint64_t m_jobs = 0;
+    uint64_t m_steals = 0;
+    uint64_t m_totalQueueWaitNs = 0;
+    uint64_t m_maxQueueWaitNs = 0;
+  };
+
+  // threads == 0 sizes the pool to the machine
+  explicit TaskScheduler(unsigned int threads = 0);
+  ~TaskScheduler();
+
+  // Process wide scheduler, every engine should use this one so that the
+  // whole application stays within one thread budget
+  static TaskScheduler* Instance();
+
+  unsigned int Concurrency() const { return (unsigned int)m_workers.size(); }
+
+  template <typename F>
+  auto Submit(F&& func) -> JobHandle<decltype(func())> {
+    typedef decltype(func()) R;
+    auto task =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    std::function<void()> run = [task, started]() {
+      if (!started->exchange(true)) (*task)();
+    };
+    std::shared_future<R> future = task->get_future().share();
+    Push(run);
+    return JobHandle<R>(this, future, run);
+  }
+
+  // Runs func outside of the scheduler's pool, on a thread of pool
+  template <typename F>
+  static auto Spawn(F&& func, SpawnPool* pool = SpawnPool::Instance())
+      -> JobHandle<decltype(func())> {
+    typedef decltype(func()) R;
+    auto task =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+    std::shared_future<R> future = task->get_future().share();
+    pool->Run([task]() { (*task)(); });
+    return JobHandle<R>(nullptr, future, nullptr);
+  }
+
+  // Splits [begin, end) in chunks of at most grain elements and calls
+  // body(chunkBegin, chunkEnd) on them from up to maxThreads threads,
+  // the calling thread included. maxThreads == 0 means the whole pool.
+  // Returns once every chunk has been processed.
+  void ParallelFor(size_t begin, size_t end, size_t grain,
+                   const std::function<void(size_t, size_t)>& body,
+                   unsigned int maxThreads = 0);
+
+  // Runs one pending job on the calling thread if there is one
+  bool RunPendingTask();
+
+  bool OnWorkerThread() const;
+
+  Stats GetStats() const;
+  void ResetStats();
+
+ private:
+  struct TaskItem {
+    Task m_task;
+    Clock::time_point m_enqueued;
+  };
+  struct alignas(64) WorkQueue {
+    std::mutex m_mutex;
+    std::deque<TaskItem> m_tasks;
+  };
+
+  void Push(Task task);
+  bool Pop(int index, TaskItem& item);
+  void Run(TaskItem& item);
+  void WorkerLoop(int index);
+
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;
+  WorkQueue m_global;
+  std::vector<std::thread> m_workers;
+  std::atomic<int64_t> m_pending{0};
+  std::mutex m_sleepMutex;
+  std::condition_variable m_sleepCv;
+  bool m_stopping = false;
+
+  std::atomic<uint64_t> m_jobs{0};
+  std::atomic<uint64_t> m_steals{0};
+  std::atomic<uint64_t> m_totalQueueWaitNs{0};
+  std::atomic<uint64_t> m_maxQueueWaitNs{0};
+};
+
+template <typename T>
+void JobHandle<T>::Wait() const {
+  if (!m_future.valid()) return;
+  if (m_scheduler && m_scheduler->OnWorkerThread()) m_runQueued();
+  m_future.wait();
+}
+
+}  // namespace FOEDAG
+
+#endif
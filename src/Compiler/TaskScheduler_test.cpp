@@ -0,0 +1,127 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+TEST(TaskScheduler, SubmitReturnsResult) {
+  TaskScheduler scheduler(4);
+  std::vector<JobHandle<int>> jobs;
+  for (int i = 0; i < 100; i++) {
+    jobs.push_back(scheduler.Submit([i] { return i * i; }));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(jobs[i].Get(), i * i);
+  }
+  EXPECT_EQ(scheduler.GetStats().m_jobs, 100u);
+}
+
+TEST(TaskScheduler, ParallelForCoversRange) {
+  TaskScheduler scheduler(4);
+  std::vector<int> hits(10007, 0);
+  scheduler.ParallelFor(0, hits.size(), 64, [&hits](size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) hits[i]++;
+  });
+  EXPECT_EQ(std::accumulate(hits.begin(), hits.end(), 0), (int)hits.size());
+}
+
+TEST(TaskScheduler, NestedJobsDoNotDeadlock) {
+  // A single worker waiting on its own sub-jobs must run them itself
+  TaskScheduler scheduler(1);
+  auto outer = scheduler.Submit([&scheduler] {
+    std::atomic<int> sum{0};
+    std::vector<JobHandle<void>> inner;
+    for (int i = 1; i <= 10; i++) {
+      inner.push_back(scheduler.Submit([&sum, i] { sum += i; }));
+    }
+    for (auto& job : inner) job.Wait();
+    scheduler.ParallelFor(0, 10, 1, [&sum](size_t from, size_t to) {
+      sum += (int)(to - from);
+    });
+    return sum.load();
+  });
+  EXPECT_EQ(outer.Get(), 65);
+}
+
+TEST(TaskScheduler, WaitRunsNoUnrelatedJob) {
+  TaskScheduler scheduler(1);
+  std::atomic<bool> waiting{false};
+  std::atomic<bool> ranWhileWaiting{false};
+  JobHandle<void> unrelated;
+  auto outer = scheduler.Submit([&] {
+    auto inner = scheduler.Submit([] {});
+    // Newest in the deque of the worker, popped first by a stealing wait
+    unrelated = scheduler.Submit([&] { ranWhileWaiting = waiting.load(); });
+    waiting = true;
+    inner.Wait();
+    waiting = false;
+  });
+  outer.Wait();
+  unrelated.Wait();
+  EXPECT_FALSE(ranWhileWaiting);
+}
+
+TEST(TaskScheduler, SpawnRunsOffThePool) {
+  TaskScheduler scheduler(1);
+  auto job = TaskScheduler::Spawn([&scheduler] {
+    // The single worker stays free for the jobs of the spawned one
+    auto inner = scheduler.Submit([&scheduler] {
+      return scheduler.OnWorkerThread();
+    });
+    return !scheduler.OnWorkerThread() && inner.Get();
+  });
+  EXPECT_TRUE(job.Get());
+}
+
+TEST(TaskScheduler, SpawnPoolBoundsItsThreads) {
+  SpawnPool pool(2);
+  std::atomic<int> running{0};
+  std::atomic<int> peak{0};
+  std::vector<JobHandle<int>> jobs;
+  for (int i = 0; i < 6; i++) {
+    jobs.push_back(TaskScheduler::Spawn(
+        [&running, &peak, i] {
+          int now = ++running;
+          int seen = peak;
+          while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          running--;
+          return i;
+        },
+        &pool));
+  }
+  for (int i = 0; i < 6; i++) EXPECT_EQ(jobs[i].Get(), i);
+  EXPECT_EQ(peak, 2);
+}
+
+}  // namespace
+}  // namespace FOEDAG
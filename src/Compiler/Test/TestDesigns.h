@@ -0,0 +1,134 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/Netlist.h"
+
+#ifndef TEST_DESIGNS_H
+#define TEST_DESIGNS_H
+
+namespace FOEDAG {
+
+// Netlists of the compiler unit tests and benchmarks, built in code so
+// that every run sees the same design
+
+enum class MeshPorts { None, Input, InputOutput };
+
+// side x side grid of LUT2 cells, each driving its right and lower
+// neighbors. An input port, cell 0, feeds the first row and column when
+// there is one, an output port, the last cell, takes the last cell of the
+// grid.
+inline void BuildMesh(Netlist& netlist, int side, MeshPorts ports) {
+  std::vector<Netlist::NetId> nets;
+  for (int i = 0; i < side * side; i++) {
+    nets.push_back(netlist.AddNet("n" + std::to_string(i)));
+  }
+  Netlist::NetId in = Netlist::kNone;
+  if (ports != MeshPorts::None) {
+    in = netlist.AddNet("in");
+    Netlist::CellId port = netlist.AddCell("in", "$input");
+    netlist.Connect(netlist.AddPin(port, "Y", Netlist::Output), in);
+  }
+  for (int row = 0; row < side; row++) {
+    for (int col = 0; col < side; col++) {
+      int i = row * side + col;
+      Netlist::CellId cell = netlist.AddCell("c" + std::to_string(i), "LUT2");
+      Netlist::NetId a = (col > 0) ? nets[i - 1] : in;
+      Netlist::NetId b = (row > 0) ? nets[i - side] : in;
+      if (a != Netlist::kNone) {
+        netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), a);
+      }
+      if (b != Netlist::kNone) {
+        netlist.Connect(netlist.AddPin(cell, "B", Netlist::Input), b);
+      }
+      netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), nets[i]);
+    }
+  }
+  if (ports == MeshPorts::InputOutput) {
+    Netlist::CellId port = netlist.AddCell("out", "$output");
+    netlist.Connect(netlist.AddPin(port, "A", Netlist::Input), nets.back());
+  }
+  netlist.Finalize();
+}
+
+// A mesh without ports on the sites of a side x side die, shuffled within
+// 4x4 blocks
+inline void PlaceMeshInBlocks(const Netlist& netlist,
+                              CellPlacement& placement, int side) {
+  placement.Reset(netlist.CellCount(), side, side);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    uint32_t x = cell % side, y = cell / side;
+    const uint32_t i = ((x % 4) + 4 * (y % 4)) * 7 % 16;
+    x = x / 4 * 4 + i % 4;
+    y = y / 4 * 4 + i / 4;
+    placement.Set(cell, x + 0.5f, y + 0.5f);
+  }
+}
+
+// Deterministic xorshift, test designs have to be reproducible
+struct TestRandom {
+  uint64_t m_state;
+  explicit TestRandom(uint64_t seed) : m_state(seed * 2654435761ULL + 1) {}
+  uint64_t Next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 7;
+    m_state ^= m_state << 17;
+    return m_state;
+  }
+};
+
+// LUT-like cells with `inputs` inputs and one output net each. Inputs
+// mostly connect to nearby cells, like a netlist coming out of synthesis
+// does.
+inline void BuildSyntheticNetlist(Netlist& netlist, uint32_t cells,
+                                  uint32_t inputs, uint64_t seed) {
+  static const char* kInputNames[] = {"A", "B", "C", "D", "E", "F"};
+  TestRandom random(seed);
+  netlist.Clear();
+  netlist.Reserve(cells, (size_t)cells * (inputs + 1), cells);
+  for (uint32_t i = 0; i < cells; i++) {
+    netlist.AddNet("n" + std::to_string(i));
+  }
+  for (uint32_t i = 0; i < cells; i++) {
+    Netlist::CellId cell = netlist.AddCell("c" + std::to_string(i),
+                                           "LUT" + std::to_string(inputs));
+    for (uint32_t in = 0; in < inputs; in++) {
+      Netlist::PinId pin =
+          netlist.AddPin(cell, kInputNames[in % 6], Netlist::Input);
+      uint64_t draw = random.Next();
+      int64_t source = (draw % 8 == 0)
+                           ? (int64_t)(draw / 8 % cells)
+                           : (int64_t)i - 1 - (int64_t)(draw / 8 % 64);
+      if (source < 0) source += cells;
+      netlist.Connect(pin, (Netlist::NetId)source);
+    }
+    netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), i);
+  }
+  netlist.Finalize();
+}
+
+}  // namespace FOEDAG
+
+#endif
@@ -0,0 +1,912 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/Test/compiler_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/DeviceModel.h"
+#include "Compiler/Checkpoint.h"
+#include "Compiler/DelayCalculator.h"
+#include "Compiler/GlobalPlacer.h"
+#include "Compiler/Netlist.h"
+#include "Compiler/NetlistReader.h"
+#include "Compiler/SdcCommands.h"
+#include "Compiler/TaskScheduler.h"
+#include "Compiler/Test/TestDesigns.h"
+#include "Compiler/TimingAnalyzer.h"
+
+using namespace FOEDAG;
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double ElapsedUs(BenchClock::time_point from, BenchClock::time_point to) {
+  return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+// Sets value to the integer following option in argv, if any. False with
+// the error in the result when it is not a non-negative integer.
+static bool OptionValue(Tcl_Interp* interp, int argc, const char* argv[],
+                        const std::string& option, long& value) {
+  for (int i = 1; i < argc - 1; i++) {
+    if (option != argv[i]) continue;
+    int parsed = 0;
+    if (Tcl_GetInt(interp, argv[i + 1], &parsed) != TCL_OK || parsed < 0) {
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp, "ERROR: ", option.c_str(),
+                       " expects a non-negative integer, got ", argv[i + 1],
+                       nullptr);
+      return false;
+    }
+    value = parsed;
+  }
+  return true;
+}
+
+static void ReportSamples(std::ostream& out, const std::string& title,
+                          std::vector<double>& samples) {
+  if (samples.empty()) return;
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double s : samples) sum += s;
+  auto percentile = [&samples](double p) {
+    size_t index = (size_t)(p * (samples.size() - 1));
+    return samples[index];
+  };
+  out << std::fixed << std::setprecision(2) << "  " << std::left
+      << std::setw(16) << title << " avg " << sum / samples.size()
+      << "us  p50 " << percentile(0.5) << "us  p99 " << percentile(0.99)
+      << "us  max " << samples.back() << "us" << std::endl;
+}
+
+// scheduler_benchmark ?-jobs <n>? ?-work_us <n>?
+// Measures, on the shared TaskScheduler:
+//  - start latency: time from Submit() to the job running on an idle pool
+//  - queue wait: time jobs spend queued when the pool is oversubscribed
+static int SchedulerBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                              const char* argv[]) {
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  long jobs = 1000;
+  long workUs = 200;
+  if (!OptionValue(interp, argc, argv, "-jobs", jobs) ||
+      !OptionValue(interp, argc, argv, "-work_us", workUs)) {
+    return TCL_ERROR;
+  }
+
+  std::vector<double> startLatency;
+  startLatency.reserve(jobs);
+  for (long i = 0; i < jobs; i++) {
+    BenchClock::time_point submitted = BenchClock::now();
+    auto job = scheduler->Submit([] { return BenchClock::now(); });
+    startLatency.push_back(ElapsedUs(submitted, job.Get()));
+  }
+
+  // Every job spins for workUs, the pool sees jobs * workUs of work at once
+  std::vector<double> queueWait(jobs);
+  std::vector<JobHandle<void>> handles;
+  handles.reserve(jobs);
+  scheduler->ResetStats();
+  BenchClock::time_point burstStart = BenchClock::now();
+  for (long i = 0; i < jobs; i++) {
+    BenchClock::time_point submitted = BenchClock::now();
+    handles.push_back(scheduler->Submit([&queueWait, i, submitted, workUs] {
+      BenchClock::time_point started = BenchClock::now();
+      queueWait[i] = ElapsedUs(submitted, started);
+      while (ElapsedUs(started, BenchClock::now()) < workUs) {
+      }
+    }));
+  }
+  for (auto& handle : handles) handle.Wait();
+  double burstUs = ElapsedUs(burstStart, BenchClock::now());
+  TaskScheduler::Stats stats = scheduler->GetStats();
+
+  std::ostringstream out;
+  out << "Scheduler benchmark: " << scheduler->Concurrency() << " workers, "
+      << jobs << " jobs" << std::endl;
+  ReportSamples(out, "start latency", startLatency);
+  ReportSamples(out, "queue wait", queueWait);
+  out << std::fixed << std::setprecision(2) << "  burst of " << jobs << " x "
+      << workUs << "us jobs completed in " << burstUs / 1000.0
+      << "ms, efficiency "
+      << 100.0 * (double)(jobs * workUs) /
+             (burstUs * scheduler->Concurrency())
+      << "%, steals " << stats.m_steals << std::endl;
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// The same design as a classic pointer graph, the baseline of the benchmark
+struct PtrCell;
+struct PtrNet;
+struct PtrPin {
+  std::string m_name;
+  PtrCell* m_cell = nullptr;
+  PtrNet* m_net = nullptr;
+  bool m_output = false;
+};
+struct PtrCell {
+  std::string m_name;
+  std::string m_type;
+  std::vector<PtrPin*> m_pins;
+};
+struct PtrNet {
+  std::string m_name;
+  std::vector<PtrPin*> m_pins;
+};
+struct PtrGraph {
+  std::vector<std::unique_ptr<PtrCell>> m_cells;
+  std::vector<std::unique_ptr<PtrPin>> m_pins;
+  std::vector<std::unique_ptr<PtrNet>> m_nets;
+};
+
+static size_t StringHeap(const std::string& str) {
+  return str.capacity() > 15 ? str.capacity() + 1 : 0;
+}
+
+static size_t BuildPtrGraph(const Netlist& netlist, PtrGraph& graph) {
+  size_t bytes = 0;
+  for (Netlist::NetId net : netlist.Nets()) {
+    graph.m_nets.emplace_back(new PtrNet);
+    graph.m_nets.back()->m_name = std::string(netlist.NetName(net));
+  }
+  for (Netlist::CellId id : netlist.Cells()) {
+    PtrCell* cell = new PtrCell;
+    graph.m_cells.emplace_back(cell);
+    cell->m_name = std::string(netlist.CellName(id));
+    cell->m_type = std::string(netlist.CellType(id));
+    for (Netlist::PinId id : netlist.CellPins(id)) {
+      PtrPin* pin = new PtrPin;
+      graph.m_pins.emplace_back(pin);
+      pin->m_name = std::string(netlist.PinName(id));
+      pin->m_cell = cell;
+      pin->m_output = netlist.PinDirection(id) != Netlist::Input;
+      pin->m_net = graph.m_nets[netlist.PinNet(id)].get();
+      cell->m_pins.push_back(pin);
+      pin->m_net->m_pins.push_back(pin);
+      bytes += sizeof(PtrPin) + StringHeap(pin->m_name);
+    }
+    bytes += sizeof(PtrCell) + StringHeap(cell->m_name) +
+             StringHeap(cell->m_type) +
+             cell->m_pins.capacity() * sizeof(PtrPin*);
+  }
+  for (auto& net : graph.m_nets) {
+    bytes += sizeof(PtrNet) + StringHeap(net->m_name) +
+             net->m_pins.capacity() * sizeof(PtrPin*);
+  }
+  bytes += (graph.m_cells.capacity() + graph.m_pins.capacity() +
+            graph.m_nets.capacity()) *
+           sizeof(void*);
+  return bytes;
+}
+
+// netlist_benchmark ?-cells <n>? ?-inputs <n>? ?-seed <n>?
+// Builds a synthetic netlist and compares the flat Netlist with a pointer
+// graph of the same design:
+//  - memory per pin
+//  - net traversal: every pin of every net, and the cell it belongs to
+//  - fanout traversal: cell -> output pin -> net -> sink pins -> sink cell
+static int NetlistBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                            const char* argv[]) {
+  long cells = 1000000;
+  long inputs = 4;
+  long seed = 1;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-inputs", inputs) ||
+      !OptionValue(interp, argc, argv, "-seed", seed)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || inputs <= 0 || inputs > 6) {
+    Tcl_AppendResult(interp,
+                     "usage: netlist_benchmark ?-cells <n>? ?-inputs 1..6? "
+                     "?-seed <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+
+  Netlist netlist;
+  BenchClock::time_point start = BenchClock::now();
+  BuildSyntheticNetlist(netlist, (uint32_t)cells, (uint32_t)inputs, seed);
+  double buildUs = ElapsedUs(start, BenchClock::now());
+  PtrGraph graph;
+  start = BenchClock::now();
+  size_t ptrBytes = BuildPtrGraph(netlist, graph);
+  double ptrBuildUs = ElapsedUs(start, BenchClock::now());
+  const double pins = (double)netlist.PinCount();
+
+  // Sums keep the loops from being optimized away
+  uint64_t flatSum = 0;
+  start = BenchClock::now();
+  for (Netlist::NetId net : netlist.Nets()) {
+    for (Netlist::PinId pin : netlist.NetPins(net)) {
+      flatSum += netlist.CellTypeId(netlist.PinCell(pin)) + pin;
+    }
+  }
+  double flatNetUs = ElapsedUs(start, BenchClock::now());
+  uint64_t ptrSum = 0;
+  start = BenchClock::now();
+  for (auto& net : graph.m_nets) {
+    for (PtrPin* pin : net->m_pins) ptrSum += pin->m_cell->m_type.size();
+  }
+  double ptrNetUs = ElapsedUs(start, BenchClock::now());
+
+  uint64_t flatFanout = 0;
+  start = BenchClock::now();
+  for (Netlist::CellId cell : netlist.Cells()) {
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      if (netlist.PinDirection(pin) == Netlist::Input) continue;
+      for (Netlist::PinId sink : netlist.NetPins(netlist.PinNet(pin))) {
+        flatFanout += netlist.PinCell(sink) != cell;
+      }
+    }
+  }
+  double flatFanoutUs = ElapsedUs(start, BenchClock::now());
+  uint64_t ptrFanout = 0;
+  start = BenchClock::now();
+  for (auto& cell : graph.m_cells) {
+    for (PtrPin* pin : cell->m_pins) {
+      if (!pin->m_output) continue;
+      for (PtrPin* sink : pin->m_net->m_pins) {
+        ptrFanout += sink->m_cell != cell.get();
+      }
+    }
+  }
+  double ptrFanoutUs = ElapsedUs(start, BenchClock::now());
+
+  std::ostringstream out;
+  out << "Netlist benchmark: " << netlist.CellCount() << " cells, "
+      << netlist.PinCount() << " pins, " << netlist.NetCount() << " nets"
+      << std::endl;
+  out << std::fixed << std::setprecision(2);
+  out << "  " << std::left << std::setw(16) << "" << std::right
+      << std::setw(12) << "flat" << std::setw(12) << "pointers" << std::endl;
+  auto row = [&out](const std::string& title, double flat, double ptr,
+                    const std::string& unit) {
+    out << "  " << std::left << std::setw(16) << title << std::right
+        << std::setw(10) << flat << unit << std::setw(10) << ptr << unit
+        << std::endl;
+  };
+  row("build", buildUs / 1000.0, ptrBuildUs / 1000.0, "ms");
+  row("bytes per pin", netlist.MemoryBytes() / pins, ptrBytes / pins, " B");
+  row("net traversal", flatNetUs * 1000.0 / pins, ptrNetUs * 1000.0 / pins,
+      "ns");
+  row("fanout", flatFanoutUs * 1000.0 / pins, ptrFanoutUs * 1000.0 / pins,
+      "ns");
+
+  // Checkpoint round trip, the load maps the file and copies nothing
+  std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_bench.ckpt").string();
+  start = BenchClock::now();
+  CheckpointWriter writer;
+  bool saved = writer.Open(path) && netlist.Save(writer) && writer.Close();
+  double saveUs = ElapsedUs(start, BenchClock::now());
+  start = BenchClock::now();
+  std::string error;
+  Netlist loaded;
+  bool restored =
+      saved && loaded.Load(MappedCheckpoint::Open(path, error), error);
+  double loadUs = ElapsedUs(start, BenchClock::now());
+  if (restored) {
+    out << "  checkpoint       write " << saveUs / 1000.0 << "ms, map "
+        << loadUs / 1000.0 << "ms, "
+        << std::filesystem::file_size(path) / pins << " B per pin"
+        << std::endl;
+  }
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  out << "  (checksums " << flatSum % 1000 << " " << ptrSum % 1000 << " "
+      << flatFanout << " " << ptrFanout << ")" << std::endl;
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// Writes a synthetic netlist as BLIF or as structural Verilog
+static void WriteSyntheticNetlist(const Netlist& netlist,
+                                  NetlistReader::Format format,
+                                  const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  const bool blif = format == NetlistReader::Blif;
+  out << (blif ? ".model bench\n" : "module bench ();\n");
+  for (Netlist::CellId cell : netlist.Cells()) {
+    out << (blif ? ".subckt " : "  ") << netlist.CellType(cell);
+    if (!blif) out << " " << netlist.CellName(cell) << " (";
+    bool first = true;
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      const std::string_view net = netlist.NetName(netlist.PinNet(pin));
+      if (blif) {
+        out << " " << netlist.PinName(pin) << "=" << net;
+      } else {
+        out << (first ? "" : ", ") << "." << netlist.PinName(pin) << "("
+            << net << ")";
+      }
+      first = false;
+    }
+    out << (blif ? "\n.cname " : ");\n");
+    if (blif) out << netlist.CellName(cell) << "\n";
+  }
+  out << (blif ? ".end\n" : "endmodule\n");
+}
+
+// netlist_reader_benchmark ?-cells <n>? ?-chunk_kb <n>?
+// Writes a synthetic netlist as BLIF and as Verilog and reads each back with
+// one thread and with the whole TaskScheduler
+static int NetlistReaderBenchmark(void* clientData, Tcl_Interp* interp,
+                                  int argc, const char* argv[]) {
+  long cells = 1000000;
+  long chunkKB = 4096;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-chunk_kb", chunkKB)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || chunkKB <= 0) {
+    Tcl_AppendResult(interp,
+                     "usage: netlist_reader_benchmark ?-cells <n>? "
+                     "?-chunk_kb <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist synthetic;
+  BuildSyntheticNetlist(synthetic, (uint32_t)cells, 4, 1);
+  const unsigned int threads = TaskScheduler::Instance()->Concurrency();
+
+  std::ostringstream out;
+  out << "Netlist reader benchmark: " << cells << " cells, " << threads
+      << " threads, " << chunkKB << "KB chunks" << std::endl;
+  out << std::fixed << std::setprecision(2);
+  for (auto format : {NetlistReader::Blif, NetlistReader::Verilog}) {
+    const bool blif = format == NetlistReader::Blif;
+    std::string path = (std::filesystem::temp_directory_path() /
+                        (blif ? "foedag_bench.blif" : "foedag_bench.v"))
+                           .string();
+    WriteSyntheticNetlist(synthetic, format, path);
+    const double megabytes = std::filesystem::file_size(path) / 1e6;
+    double seconds[2] = {0, 0};
+    for (int run = 0; run < 2; run++) {
+      NetlistReader::Options options;
+      options.m_chunkSize = (size_t)chunkKB << 10;
+      options.m_threads = (run == 0) ? 1 : threads;
+      NetlistReader reader(options);
+      reader.AddFile(path, format);
+      Netlist netlist;
+      BenchClock::time_point start = BenchClock::now();
+      if (!reader.Read(netlist)) {
+        Tcl_AppendResult(interp, reader.Error().c_str(), nullptr);
+        return TCL_ERROR;
+      }
+      seconds[run] = ElapsedUs(start, BenchClock::now()) / 1e6;
+      const NetlistReader::Stats& stats = reader.GetStats();
+      out << "  " << std::left << std::setw(8) << (blif ? "BLIF" : "Verilog")
+          << std::right << std::setw(3) << options.m_threads << " threads "
+          << std::setw(9) << seconds[run] * 1000 << "ms  " << std::setw(8)
+          << megabytes / seconds[run] << "MB/s  (parse "
+          << stats.m_parseSeconds * 1000 << "ms, elaborate "
+          << stats.m_elaborateSeconds * 1000 << "ms, " << stats.m_chunks
+          << " chunks)" << std::endl;
+    }
+    out << "  " << std::left << std::setw(8) << "" << " speedup "
+        << seconds[0] / seconds[1] << "x on " << megabytes << "MB"
+        << std::endl;
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// global_placement_benchmark ?-cells <n>? ?-max_threads <n>?
+// Places a synthetic netlist with 1, 4, 16 and 64 threads (up to
+// max_threads) and reports the runtime, the wirelength and the speedup.
+// The results must not depend on the number of threads.
+static int GlobalPlacementBenchmark(void* clientData, Tcl_Interp* interp,
+                                    int argc, const char* argv[]) {
+  long cells = 100000;
+  long maxThreads = 64;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-max_threads", maxThreads)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || maxThreads <= 0) {
+    Tcl_AppendResult(interp,
+                     "usage: global_placement_benchmark ?-cells <n>? "
+                     "?-max_threads <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist netlist;
+  BuildSyntheticNetlist(netlist, (uint32_t)cells, 4, 1);
+
+  std::ostringstream out;
+  out << "Global placement benchmark: " << cells << " cells, "
+      << netlist.NetCount() << " nets, "
+      << TaskScheduler::Instance()->Concurrency() << " scheduler threads"
+      << std::endl;
+  out << std::fixed << std::setprecision(2);
+  double baseline = 0;
+  double baselineHpwl = 0;
+  for (unsigned int threads : {1u, 4u, 16u, 64u}) {
+    if (threads > (unsigned long)maxThreads) break;
+    GlobalPlacer::Options options;
+    options.m_threads = threads;
+    GlobalPlacer placer(options);
+    CellPlacement placement;
+    placer.Place(netlist, placement);
+    const GlobalPlacer::Stats& stats = placer.GetStats();
+    if (threads == 1) {
+      baseline = stats.m_seconds;
+      baselineHpwl = stats.m_hpwl;
+    }
+    out << "  " << std::setw(2) << threads << " threads " << std::setw(9)
+        << stats.m_seconds * 1000 << "ms  HPWL " << std::setprecision(0)
+        << stats.m_hpwl << std::setprecision(2) << "  overflow "
+        << stats.m_overflow << "  " << stats.m_iterations << " iterations ("
+        << stats.m_solverIterations << " CG), speedup "
+        << baseline / stats.m_seconds << "x"
+        << (stats.m_hpwl == baselineHpwl ? "" : "  HPWL DIFFERS")
+        << std::endl;
+  }
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// Layers of 1024 cells, every depth-th layer flip-flops and LUT4s in
+// between, each input from a nearby cell of the layer above: pipelined
+// logic, no path longer than depth - 1 LUTs
+static void BuildPipelinedNetlist(Netlist& netlist, uint32_t cells,
+                                  uint32_t depth, uint64_t seed) {
+  static const char* kInputNames[] = {"A", "B", "C", "D"};
+  const uint32_t width = 1024;
+  const uint32_t layers = (cells + width - 1) / width;
+  TestRandom random(seed);
+  netlist.Clear();
+  netlist.Reserve(cells, (size_t)cells * 5, cells);
+  for (uint32_t i = 0; i < cells; i++) {
+    netlist.AddNet("n" + std::to_string(i));
+  }
+  for (uint32_t i = 0; i < cells; i++) {
+    const uint32_t layer = i / width;
+    const bool reg = layer % depth == 0;
+    Netlist::CellId cell =
+        netlist.AddCell("c" + std::to_string(i), reg ? "DFF" : "LUT4");
+    const uint32_t above = (layer + layers - 1) % layers;
+    for (uint32_t in = 0; in < (reg ? 1u : 4u); in++) {
+      Netlist::PinId pin =
+          netlist.AddPin(cell, reg ? "D" : kInputNames[in], Netlist::Input);
+      const uint32_t index = (i % width + width - 64 +
+                              (uint32_t)(random.Next() % 129)) % width;
+      netlist.Connect(pin, std::min(above * width + index, cells - 1));
+    }
+    netlist.Connect(netlist.AddPin(cell, reg ? "Q" : "Y", Netlist::Output),
+                    i);
+  }
+  netlist.Finalize();
+}
+
+// sta_benchmark ?-cells <n>? ?-depth <n>? ?-moves <n>?
+// Times a pipelined synthetic netlist placed row by row, then moves
+// single cells and compares the latency of a full update with the one of
+// an incremental update of the moved nets. Both have to end on the same
+// worst and total slack.
+static int StaBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) {
+  long cells = 1000000;
+  long depth = 8;
+  long moves = 20;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-depth", depth) ||
+      !OptionValue(interp, argc, argv, "-moves", moves)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || depth <= 0 || moves <= 0) {
+    Tcl_AppendResult(interp,
+                     "usage: sta_benchmark ?-cells <n>? ?-depth <n>? "
+                     "?-moves <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist netlist;
+  BuildPipelinedNetlist(netlist, (uint32_t)cells, (uint32_t)depth, 1);
+  const uint32_t side = (uint32_t)std::ceil(std::sqrt((double)cells));
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), side, side);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, 0.5f + cell % side, 0.5f + cell / side);
+  }
+
+  TimingAnalyzer::Options options;
+  options.m_clockPeriod = 5;
+  TimingAnalyzer full;
+  TimingAnalyzer incremental;
+  auto start = BenchClock::now();
+  full.Build(netlist);
+  const double buildUs = ElapsedUs(start, BenchClock::now());
+  incremental.Build(netlist);
+  full.SetPlacedDelays(placement);
+  incremental.SetPlacedDelays(placement);
+  incremental.Update(options);
+
+  TestRandom random(2);
+  std::vector<double> fullUs, incrementalUs;
+  size_t updatedPins = 0;
+  bool same = true;
+  std::vector<Netlist::NetId> nets;
+  for (long move = 0; move < moves; move++) {
+    const Netlist::CellId cell =
+        (Netlist::CellId)(random.Next() % netlist.CellCount());
+    placement.Set(cell, 0.5f + random.Next() % side,
+                  0.5f + random.Next() % side);
+    start = BenchClock::now();
+    full.SetPlacedDelays(placement);
+    full.Update(options);
+    fullUs.push_back(ElapsedUs(start, BenchClock::now()));
+
+    start = BenchClock::now();
+    nets.clear();
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      nets.push_back(netlist.PinNet(pin));
+    }
+    incremental.SetNetDelays(nets, placement);
+    incremental.UpdateIncremental(options);
+    incrementalUs.push_back(ElapsedUs(start, BenchClock::now()));
+    updatedPins += incremental.GetSummary().m_updatedPins;
+    same = same &&
+           full.GetSummary().m_wns == incremental.GetSummary().m_wns &&
+           full.GetSummary().m_tns == incremental.GetSummary().m_tns;
+  }
+
+  std::ostringstream out;
+  out << "STA benchmark: " << cells << " cells, " << netlist.PinCount()
+      << " pins, " << full.ArcCount() << " arcs, " << full.LevelCount()
+      << " levels, built in " << std::fixed << std::setprecision(2)
+      << buildUs / 1000 << "ms" << std::endl;
+  out << "  WNS " << full.GetSummary().m_wns << "ns, TNS "
+      << full.GetSummary().m_tns << "ns, "
+      << full.GetSummary().m_endpoints << " endpoints" << std::endl;
+  ReportSamples(out, "full update", fullUs);
+  ReportSamples(out, "incremental", incrementalUs);
+  out << "  " << updatedPins / moves << " pin times per incremental update"
+      << (same ? "" : ", SLACKS DIFFER") << std::endl;
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// delay_calc_benchmark ?-arcs <n>? ?-repeat <n>?
+// Interpolates an 8x8 NLDM table for random slews and loads with each
+// instruction set the CPU has and reports the arcs per second, best of
+// the repeats, on one thread. The vector results have to be the ones of
+// the scalar reference, bit for bit.
+static int DelayCalcBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                              const char* argv[]) {
+  long arcs = 1000000;
+  long repeat = 20;
+  if (!OptionValue(interp, argc, argv, "-arcs", arcs) ||
+      !OptionValue(interp, argc, argv, "-repeat", repeat)) {
+    return TCL_ERROR;
+  }
+  if (arcs <= 0 || repeat <= 0) {
+    Tcl_AppendResult(interp,
+                     "usage: delay_calc_benchmark ?-arcs <n>? ?-repeat <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  TestRandom random(5);
+  auto uniform = [&random](float from, float to) {
+    return from + (to - from) * (float)(random.Next() % 65536) / 65536;
+  };
+  std::vector<float> slews, loads, values;
+  for (size_t i = 0; i < DelayCalculator::kMaxPoints; i++) {
+    slews.push_back(0.01f * (1 << i));
+    loads.push_back((float)(1 << i));
+  }
+  for (size_t i = 0; i < slews.size() * loads.size(); i++) {
+    values.push_back(uniform(0.1f, 2));
+  }
+  DelayCalculator calculator;
+  DelayCalculator::TableId table = 0;
+  std::string error;
+  calculator.AddTable(slews, loads, values, table, error);
+  std::vector<float> inSlew(arcs), inLoad(arcs), reference(arcs),
+      evaluated(arcs);
+  for (long i = 0; i < arcs; i++) {
+    inSlew[i] = uniform(0, 1.5f);
+    inLoad[i] = uniform(0, 150);
+  }
+
+  std::ostringstream out;
+  out << "Delay calculation benchmark: " << arcs << " arcs, "
+      << slews.size() << "x" << loads.size() << " table" << std::endl;
+  double scalarRate = 0;
+  for (DelayCalculator::Isa isa :
+       {DelayCalculator::Scalar, DelayCalculator::Sse2,
+        DelayCalculator::Avx2}) {
+    if (!DelayCalculator::Supported(isa)) continue;
+    std::vector<float>& result =
+        isa == DelayCalculator::Scalar ? reference : evaluated;
+    double bestUs = 0;
+    for (long r = 0; r < repeat; r++) {
+      auto start = BenchClock::now();
+      calculator.Evaluate(table, inSlew.data(), inLoad.data(), result.data(),
+                          arcs, isa);
+      const double us = ElapsedUs(start, BenchClock::now());
+      if (r == 0 || us < bestUs) bestUs = us;
+    }
+    const double rate = arcs / std::max(bestUs, 1e-3) * 1e6;
+    if (isa == DelayCalculator::Scalar) scalarRate = rate;
+    const bool same = isa == DelayCalculator::Scalar ||
+                      std::equal(reference.begin(), reference.end(),
+                                 evaluated.begin(), [](float a, float b) {
+                                   return std::memcmp(&a, &b, sizeof(a)) == 0;
+                                 });
+    out << "  " << std::left << std::setw(8)
+        << DelayCalculator::IsaName(isa) << std::fixed << std::setprecision(1)
+        << rate / 1e6 << "M arcs/s, " << std::setprecision(2)
+        << rate / scalarRate << "x" << (same ? "" : ", RESULTS DIFFER")
+        << std::endl;
+  }
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// sdc_benchmark ?-cells <n>? ?-paths <n>?
+// Writes an SDC file of paths set_false_path lines between random pins of
+// a synthetic netlist, a tenth of them through a net pattern, and reads it
+// back in a fresh interpreter
+static int SdcBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                        const char* argv[]) {
+  long cells = 100000;
+  long paths = 300000;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-paths", paths)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || paths <= 0) {
+    Tcl_AppendResult(interp, "usage: sdc_benchmark ?-cells <n>? ?-paths <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist netlist;
+  BuildSyntheticNetlist(netlist, (uint32_t)cells, 4, 1);
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "foedag_bench.sdc").string();
+  {
+    std::ofstream sdc(path);
+    TestRandom random(3);
+    sdc << "create_clock -period 5 -name clk" << std::endl;
+    for (long i = 0; i < paths; i++) {
+      sdc << "set_false_path -from [get_pins c" << random.Next() % cells
+          << "/Y]";
+      if (i % 10 == 0) {
+        sdc << " -through [get_nets n" << random.Next() % cells << "*]";
+      }
+      sdc << " -to [get_pins c" << random.Next() % cells << "/A]"
+          << std::endl;
+    }
+  }
+  const double megabytes = std::filesystem::file_size(path) / 1e6;
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string&) { return &constraints; });
+  std::string error;
+  BenchClock::time_point start = BenchClock::now();
+  const bool read = sdc.ReadFile(path, error);
+  const double seconds = ElapsedUs(start, BenchClock::now()) / 1e6;
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  if (!read) {
+    Tcl_AppendResult(interp, error.c_str(), nullptr);
+    return TCL_ERROR;
+  }
+  std::ostringstream out;
+  out << "SDC benchmark: " << cells << " cells, " << paths
+      << " set_false_path lines, " << std::fixed << std::setprecision(2)
+      << megabytes << "MB" << std::endl;
+  out << "  read in " << seconds * 1000 << "ms, " << std::setprecision(0)
+      << paths / seconds << " lines/s, " << constraints.ExceptionCount()
+      << " exceptions" << std::endl;
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// query_benchmark ?-cells <n>? ?-repeat <n>?
+// get_cells with a pattern and with a -filter on a synthetic netlist,
+// against a linear scan matching every name and computing the
+// properties of every cell
+static int QueryBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                          const char* argv[]) {
+  long cells = 1000000;
+  long repeat = 10;
+  if (!OptionValue(interp, argc, argv, "-cells", cells) ||
+      !OptionValue(interp, argc, argv, "-repeat", repeat)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0 || repeat <= 0) {
+    Tcl_AppendResult(interp,
+                     "usage: query_benchmark ?-cells <n>? ?-repeat <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist netlist;
+  BuildSyntheticNetlist(netlist, (uint32_t)cells, 4, 1);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string&) { return &constraints; });
+  TclInterpreter queries("query");
+  sdc.Register(&queries);
+  Tcl_Interp* tcl = queries.getInterp();
+  const std::string pattern = "c" + std::to_string(cells / 3) + "*";
+  const char* filter = "type == lut && fanout > 3";
+
+  // Linear scans
+  BenchClock::time_point start = BenchClock::now();
+  size_t linearPattern = 0, linearFilter = 0;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    if (ObjectNames::GlobMatch(pattern, netlist.CellName(cell))) {
+      linearPattern++;
+    }
+  }
+  const double linearPatternUs = ElapsedUs(start, BenchClock::now());
+  start = BenchClock::now();
+  for (Netlist::CellId cell : netlist.Cells()) {
+    uint32_t fanout = 0;
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      const Netlist::NetId net = netlist.PinNet(pin);
+      if (netlist.PinDirection(pin) != Netlist::Input &&
+          net != Netlist::kNone) {
+        fanout += netlist.NetPins(net).size() - 1;
+      }
+    }
+    const std::string type(DeviceModel::ResourceName(
+        DeviceModel::CellResource(netlist.CellType(cell))));
+    if (type == "lut" && fanout > 3) linearFilter++;
+  }
+  const double linearFilterUs = ElapsedUs(start, BenchClock::now());
+
+  // Evaluated as a script object, its literals keep their compiled filter
+  auto time = [&](const std::string& command, double& firstUs,
+                  double& meanUs, std::string& count) {
+    Tcl_Obj* script = Tcl_NewStringObj(command.c_str(), -1);
+    Tcl_IncrRefCount(script);
+    BenchClock::time_point start = BenchClock::now();
+    int code = Tcl_EvalObjEx(tcl, script, 0);
+    firstUs = ElapsedUs(start, BenchClock::now());
+    start = BenchClock::now();
+    for (long i = 0; i < repeat && code == TCL_OK; i++) {
+      code = Tcl_EvalObjEx(tcl, script, 0);
+    }
+    meanUs = ElapsedUs(start, BenchClock::now()) / repeat;
+    Tcl_DecrRefCount(script);
+    if (code == TCL_OK) {
+      code = Tcl_Eval(tcl, ("llength [" + command + "]").c_str());
+    }
+    count = Tcl_GetStringResult(tcl);
+    return code == TCL_OK;
+  };
+  double patternFirstUs = 0, patternUs = 0, filterFirstUs = 0,
+         filterUs = 0;
+  std::string patternCount, filterCount;
+  if (!time("get_cells " + pattern, patternFirstUs, patternUs,
+            patternCount) ||
+      !time(std::string("get_cells -filter {") + filter + "}", filterFirstUs,
+            filterUs, filterCount)) {
+    Tcl_AppendResult(interp, Tcl_GetStringResult(tcl), nullptr);
+    return TCL_ERROR;
+  }
+  std::ostringstream out;
+  out << "Query benchmark: " << cells << " cells, "
+      << TaskScheduler::Instance()->Concurrency() << " threads" << std::endl;
+  out << std::fixed << std::setprecision(3);
+  out << "  get_cells " << pattern << ": " << patternCount
+      << " cells, first " << patternFirstUs / 1000 << "ms (name index), then "
+      << patternUs / 1000 << "ms; linear scan " << linearPatternUs / 1000
+      << "ms, " << linearPattern << " cells" << std::endl;
+  out << "  get_cells -filter {" << filter << "}: " << filterCount
+      << " cells, first " << filterFirstUs / 1000
+      << "ms (property columns), then " << filterUs / 1000
+      << "ms; linear scan " << linearFilterUs / 1000 << "ms, "
+      << linearFilter << " cells" << std::endl;
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+// collection_benchmark ?-cells <n>?
+// Counts, walks and merges the nets of a synthetic netlist as
+// collections, and as the Tcl lists of their names
+static int CollectionBenchmark(void* clientData, Tcl_Interp* interp, int argc,
+                               const char* argv[]) {
+  long cells = 1000000;
+  if (!OptionValue(interp, argc, argv, "-cells", cells)) {
+    return TCL_ERROR;
+  }
+  if (cells <= 0) {
+    Tcl_AppendResult(interp, "usage: collection_benchmark ?-cells <n>?",
+                     nullptr);
+    return TCL_ERROR;
+  }
+  Netlist netlist;
+  BuildSyntheticNetlist(netlist, (uint32_t)cells, 4, 1);
+  TimingConstraints constraints;
+  constraints.Bind(netlist);
+  SdcCommands sdc([&constraints](std::string&) { return &constraints; });
+  TclInterpreter collections("collections");
+  sdc.Register(&collections);
+  Tcl_Interp* tcl = collections.getInterp();
+  static const char* kScripts[][2] = {
+      {"count", "sizeof_collection [get_nets]"},
+      {"count as list", "llength [get_nets]"},
+      {"walk",
+       "set n 0; foreach_in_collection net [get_nets] { incr n }; set n"},
+      {"walk as list", "set n 0; foreach net [get_nets] { incr n }; set n"},
+      {"merge",
+       "sizeof_collection [add_to_collection [get_nets n1*] "
+       "[get_nets n2*]]"},
+      {"merge as lists",
+       "llength [lsort -unique [concat [get_nets n1*] [get_nets n2*]]]"}};
+  // Sorts the net names of the pattern index once, out of the timings
+  Tcl_Eval(tcl, "get_nets n0*");
+  std::ostringstream out;
+  out << "Collection benchmark: " << netlist.NetCount() << " nets"
+      << std::endl;
+  out << std::fixed << std::setprecision(2);
+  for (const auto& script : kScripts) {
+    BenchClock::time_point start = BenchClock::now();
+    if (Tcl_Eval(tcl, script[1]) != TCL_OK) {
+      Tcl_AppendResult(interp, Tcl_GetStringResult(tcl), nullptr);
+      return TCL_ERROR;
+    }
+    const double us = ElapsedUs(start, BenchClock::now());
+    out << "  " << std::setw(14) << std::left << script[0] << std::right
+        << std::setw(10) << us / 1000 << "ms, " << Tcl_GetStringResult(tcl)
+        << std::endl;
+  }
+  if (Tcl_Eval(tcl, "string length [get_nets]") == TCL_OK) {
+    out << "  names of the nets: "
+        << std::atof(Tcl_GetStringResult(tcl)) / 1e6 << "MB of string"
+        << std::endl;
+  }
+  std::cout << out.str();
+  return TCL_OK;
+}
+
+void FOEDAG::registerBenchmarkCommands(TclInterpreter* interp) {
+  interp->registerCmd("scheduler_benchmark", SchedulerBenchmark, nullptr, 0);
+  interp->registerCmd("netlist_benchmark", NetlistBenchmark, nullptr, 0);
+  interp->registerCmd("netlist_reader_benchmark", NetlistReaderBenchmark,
+                      nullptr, 0);
+  interp->registerCmd("global_placement_benchmark", GlobalPlacementBenchmark,
+                      nullptr, 0);
+  interp->registerCmd("sta_benchmark", StaBenchmark, nullptr, 0);
+  interp->registerCmd("delay_calc_benchmark", DelayCalcBenchmark, nullptr,
+                      0);
+  interp->registerCmd("sdc_benchmark", SdcBenchmark, nullptr, 0);
+  interp->registerCmd("query_benchmark", QueryBenchmark, nullptr, 0);
+  interp->registerCmd("collection_benchmark", CollectionBenchmark, nullptr,
+                      0);
+}
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Compiler/Compiler.h"
 #include "Compiler/Design.h"
+#include "Compiler/Test/compiler_bench.h"
 #include "Compiler/WorkerThread.h"
 #include "Main/CommandLine.h"
 #include "Main/Foedag.h"
@@ -41,12 +42,17 @@ void registerExampleCommands(FOEDAG::Session* session) {
   FOEDAG::Compiler* compiler =
       new FOEDAG::Compiler(GlobalSession->TclInterp(), design, std::cout);
   compiler->RegisterCommands(GlobalSession->TclInterp(), false);
+  FOEDAG::registerBenchmarkCommands(GlobalSession->TclInterp());
 }
 
 int main(int argc, char** argv) {
   FOEDAG::CommandLine* cmd = new FOEDAG::CommandLine(argc, argv);
   cmd->processArgs();
 
+  if (!cmd->WorkerAddress().empty()) {
+    FOEDAG::Foedag* foedag = new FOEDAG::Foedag(cmd, nullptr, nullptr);
+    return foedag->initWorker();
+  }
   if (!cmd->WithQt()) {
     // Batch mode
     FOEDAG::Foedag* foedag =
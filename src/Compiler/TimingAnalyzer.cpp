@@ -0,0 +1,748 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/TimingAnalyzer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "Compiler/DeviceModel.h"
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+typedef Netlist::PinId PinId;
+
+constexpr float kInfinity = std::numeric_limits<float>::infinity();
+// NLDM tables of the generic combinational cell, by input slew (ns) then
+// output load (sinks): input to output delay and output slew, ns. 0.25ns
+// of delay and a 0.05ns slew at the nominal slew and a load of 1.
+const std::vector<float> kSlewAxis = {0.01f, 0.05f, 0.1f, 0.2f, 0.4f, 0.8f};
+const std::vector<float> kLoadAxis = {1, 2, 4, 8, 16, 32, 64};
+const std::vector<float> kCellDelayTable = {
+    0.230f, 0.256f, 0.307f, 0.408f, 0.609f, 1.010f, 1.811f,
+    0.250f, 0.280f, 0.335f, 0.440f, 0.645f, 1.050f, 1.855f,
+    0.275f, 0.310f, 0.370f, 0.480f, 0.690f, 1.100f, 1.910f,
+    0.325f, 0.370f, 0.440f, 0.560f, 0.780f, 1.200f, 2.020f,
+    0.425f, 0.490f, 0.580f, 0.720f, 0.960f, 1.400f, 2.240f,
+    0.625f, 0.730f, 0.860f, 1.040f, 1.320f, 1.800f, 2.680f};
+const std::vector<float> kCellSlewTable = {
+    0.042f, 0.053f, 0.073f, 0.114f, 0.194f, 0.354f, 0.675f,
+    0.050f, 0.062f, 0.085f, 0.128f, 0.210f, 0.372f, 0.695f,
+    0.060f, 0.075f, 0.100f, 0.145f, 0.230f, 0.395f, 0.720f,
+    0.080f, 0.100f, 0.130f, 0.180f, 0.270f, 0.440f, 0.770f,
+    0.120f, 0.150f, 0.190f, 0.250f, 0.350f, 0.530f, 0.870f,
+    0.200f, 0.250f, 0.310f, 0.390f, 0.510f, 0.710f, 1.070f};
+// Into a sink from the channels, like the sink nodes of the RoutingGraph
+constexpr float kPinDelay = 0.05f;
+constexpr size_t kGrain = 1024;
+
+bool IsClockPin(std::string_view name) {
+  std::string lower(name);
+  for (char& c : lower) c = (char)std::tolower((unsigned char)c);
+  return lower == "c" || lower == "ck" || lower == "clock" ||
+         lower.compare(0, 3, "clk") == 0;
+}
+
+// Counting sort of the arcs by key, offsets has keys + 1 entries
+void Bucket(const std::vector<PinId>& keys, size_t count,
+            std::vector<uint32_t>& offsets, std::vector<uint32_t>& order) {
+  offsets.assign(count + 1, 0);
+  for (PinId key : keys) offsets[key + 1]++;
+  for (size_t i = 0; i < count; i++) offsets[i + 1] += offsets[i];
+  order.resize(keys.size());
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (uint32_t arc = 0; arc < keys.size(); arc++) {
+    order[next[keys[arc]]++] = arc;
+  }
+}
+}  // namespace
+
+TimingAnalyzer::TimingAnalyzer() {
+  std::string error;
+  m_library.AddTable(kSlewAxis, kLoadAxis, kCellDelayTable, m_cellDelay,
+                     error);
+  m_library.AddTable(kSlewAxis, kLoadAxis, kCellSlewTable, m_cellSlew, error);
+}
+
+void TimingAnalyzer::Clear() {
+  m_netlist = nullptr;
+  m_kind.clear();
+  m_offset.clear();
+  m_order.clear();
+  m_levelBegin.assign(1, 0);
+  m_level.clear();
+  m_faninBegin.clear();
+  m_arcFrom.clear();
+  m_arcDelay.clear();
+  m_fanoutBegin.clear();
+  m_fanoutArcs.clear();
+  m_fanoutTo.clear();
+  m_captures.clear();
+  m_loopArcs = 0;
+  m_times.assign(m_corners.size(), CornerTimes());
+  m_forwardQueue.clear();
+  m_backwardQueue.clear();
+  m_queued.clear();
+  m_timed = false;
+  m_summary = Summary();
+}
+
+void TimingAnalyzer::Build(const Netlist& netlist) {
+  Clear();
+  m_netlist = &netlist;
+  const size_t pins = netlist.PinCount();
+  m_kind.assign(pins, Internal);
+  m_offset.assign(pins, 0);
+  // Load on each net and the slew its driver puts out
+  const size_t nets = netlist.NetCount();
+  std::vector<float> netLoad(nets, 0);
+  for (Netlist::NetId net : netlist.Nets()) {
+    const PinId driver = netlist.NetDriver(net);
+    for (PinId pin : netlist.NetPins(net)) {
+      if (pin != driver && netlist.PinDirection(pin) != Netlist::Output) {
+        netLoad[net]++;
+      }
+    }
+  }
+  std::vector<float> netSlew(nets, kNominalSlew);
+  m_library.Evaluate(m_cellSlew, netSlew.data(), netLoad.data(),
+                     netSlew.data(), nets);
+  std::vector<PinId> from, to;
+  std::vector<float> delay, slew, load;
+  for (Netlist::CellId cell : netlist.Cells()) {
+    const std::string_view type = netlist.CellType(cell);
+    if (CellPlacement::IsConstant(type)) {
+      for (PinId pin : netlist.CellPins(cell)) m_kind[pin] = Untimed;
+      continue;
+    }
+    if (CellPlacement::IsPort(type)) {
+      for (PinId pin : netlist.CellPins(cell)) {
+        m_kind[pin] =
+            netlist.PinDirection(pin) == Netlist::Input ? Capture : Launch;
+      }
+      continue;
+    }
+    const DeviceModel::Resource resource = DeviceModel::CellResource(type);
+    if (resource == DeviceModel::Ff || resource == DeviceModel::Bram) {
+      for (PinId pin : netlist.CellPins(cell)) {
+        if (netlist.PinDirection(pin) != Netlist::Input) {
+          m_kind[pin] = Launch;
+          m_offset[pin] = kRegisterClockToOutput;
+        } else if (IsClockPin(netlist.PinName(pin))) {
+          m_kind[pin] = Clock;
+        } else {
+          m_kind[pin] = Capture;
+          m_offset[pin] = kRegisterSetup;
+        }
+      }
+      continue;
+    }
+    for (PinId input : netlist.CellPins(cell)) {
+      if (netlist.PinDirection(input) != Netlist::Input) continue;
+      for (PinId output : netlist.CellPins(cell)) {
+        if (netlist.PinDirection(output) != Netlist::Output) continue;
+        const Netlist::NetId in = netlist.PinNet(input);
+        const Netlist::NetId out = netlist.PinNet(output);
+        from.push_back(input);
+        to.push_back(output);
+        slew.push_back(in == Netlist::kNone ? kNominalSlew : netSlew[in]);
+        load.push_back(out == Netlist::kNone ? 0 : netLoad[out]);
+      }
+    }
+  }
+  delay.resize(from.size());
+  TaskScheduler::Instance()->ParallelFor(
+      0, delay.size(), kGrain, [&](size_t begin, size_t end) {
+        m_library.Evaluate(m_cellDelay, slew.data() + begin,
+                           load.data() + begin, delay.data() + begin,
+                           end - begin);
+      });
+  for (Netlist::NetId net : netlist.Nets()) {
+    const PinId driver = netlist.NetDriver(net);
+    if (driver == Netlist::kNone) continue;
+    for (PinId pin : netlist.NetPins(net)) {
+      if (pin == driver || netlist.PinDirection(pin) == Netlist::Output) {
+        continue;
+      }
+      from.push_back(driver);
+      to.push_back(pin);
+      delay.push_back(0);
+    }
+  }
+  for (PinId pin = 0; pin < pins; pin++) {
+    if (m_kind[pin] == Capture) m_captures.push_back(pin);
+  }
+  Levelize(from, to, delay);
+  m_forwardQueue.resize(LevelCount());
+  m_backwardQueue.resize(LevelCount());
+  m_queued.assign(pins, 0);
+  ResetTimes();
+}
+
+void TimingAnalyzer::Constrain(
+    const std::vector<std::pair<PinId, float>>& delays,
+    const std::vector<PinId>& falseFrom, const std::vector<PinId>& falseTo) {
+  for (const auto& delay : delays) {
+    const uint8_t kind = m_kind[delay.first];
+    if (kind == Launch || kind == Capture) m_offset[delay.first] = delay.second;
+  }
+  for (PinId pin : falseFrom) {
+    if (m_kind[pin] == Launch) m_kind[pin] = Untimed;
+  }
+  for (PinId pin : falseTo) {
+    if (m_kind[pin] == Capture) m_kind[pin] = Untimed;
+  }
+  m_captures.erase(std::remove_if(m_captures.begin(), m_captures.end(),
+                                  [this](PinId pin) {
+                                    return m_kind[pin] != Capture;
+                                  }),
+                   m_captures.end());
+  m_timed = false;
+}
+
+void TimingAnalyzer::SetCorners(const std::vector<Corner>& corners) {
+  std::vector<Corner> next = corners;
+  if (next.empty()) next.push_back(Corner());
+  bool same = next.size() == m_corners.size();
+  for (size_t c = 0; same && c < next.size(); c++) {
+    same = next[c].m_name == m_corners[c].m_name &&
+           next[c].m_cellDerate == m_corners[c].m_cellDerate &&
+           next[c].m_wireDerate == m_corners[c].m_wireDerate &&
+           next[c].m_clockPeriod == m_corners[c].m_clockPeriod;
+  }
+  if (same) return;
+  m_corners = std::move(next);
+  ResetTimes();
+}
+
+// Derated delays of every arc, no times yet
+void TimingAnalyzer::ResetTimes() {
+  const size_t pins = m_kind.size();
+  m_times.assign(m_corners.size(), CornerTimes());
+  for (CornerTimes& times : m_times) {
+    times.m_arcDelay.resize(m_arcDelay.size());
+    times.m_arrival.assign(pins, -kInfinity);
+    times.m_required.assign(pins, kInfinity);
+  }
+  for (PinId pin = 0; pin < pins; pin++) {
+    for (uint32_t arc = m_faninBegin[pin]; arc < m_faninBegin[pin + 1];
+         arc++) {
+      DerateArc(arc, pin);
+    }
+  }
+  m_timed = false;
+  const bool routed = m_summary.m_routedDelays;
+  m_summary = Summary();
+  m_summary.m_routedDelays = routed;
+}
+
+void TimingAnalyzer::DerateArc(uint32_t arc, PinId pin) {
+  const bool cell = m_netlist->PinDirection(pin) == Netlist::Output;
+  for (size_t c = 0; c < m_corners.size(); c++) {
+    m_times[c].m_arcDelay[arc] =
+        m_arcDelay[arc] * (cell ? m_corners[c].m_cellDerate
+                                : m_corners[c].m_wireDerate);
+  }
+}
+
+// Kahn's algorithm, a pin one level after the latest of its fanin. When
+// only loops are left, the lowest pin still waiting is taken anyway and
+// the arcs into it from the loop are cut.
+void TimingAnalyzer::Levelize(std::vector<PinId>& from,
+                              std::vector<PinId>& to,
+                              std::vector<float>& delay) {
+  const size_t pins = m_kind.size();
+  std::vector<uint32_t> outBegin, outArcs;
+  Bucket(from, pins, outBegin, outArcs);
+  std::vector<uint32_t> waiting(pins, 0);
+  for (PinId pin : to) waiting[pin]++;
+  std::vector<uint32_t> level(pins, 0);
+  std::vector<uint8_t> done(pins, 0);
+  std::vector<uint8_t> cut(from.size(), 0);
+  std::vector<PinId> queue;
+  queue.reserve(pins);
+  for (PinId pin = 0; pin < pins; pin++) {
+    if (waiting[pin] == 0) queue.push_back(pin);
+  }
+  size_t head = 0;
+  PinId lowest = 0;
+  while (queue.size() < pins || head < queue.size()) {
+    if (head == queue.size()) {
+      while (done[lowest] || waiting[lowest] == 0) lowest++;
+      waiting[lowest] = 0;
+      queue.push_back(lowest);
+    }
+    const PinId pin = queue[head++];
+    done[pin] = 1;
+    for (uint32_t i = outBegin[pin]; i < outBegin[pin + 1]; i++) {
+      const uint32_t arc = outArcs[i];
+      const PinId next = to[arc];
+      if (done[next] || waiting[next] == 0) {
+        cut[arc] = 1;
+        continue;
+      }
+      level[next] = std::max(level[next], level[pin] + 1);
+      if (--waiting[next] == 0) queue.push_back(next);
+    }
+  }
+
+  // Pins by level
+  uint32_t levels = 0;
+  for (uint32_t value : level) levels = std::max(levels, value + 1);
+  if (pins == 0) levels = 0;
+  std::vector<PinId> levelKeys(level.begin(), level.end());
+  std::vector<uint32_t> order;
+  Bucket(levelKeys, levels, m_levelBegin, order);
+  m_order.assign(order.begin(), order.end());
+  m_level = std::move(level);
+
+  // Fanin and fanout slices of the arcs kept
+  std::vector<PinId> keptFrom, keptTo;
+  std::vector<float> keptDelay;
+  for (size_t arc = 0; arc < from.size(); arc++) {
+    if (cut[arc]) {
+      m_loopArcs++;
+      continue;
+    }
+    keptFrom.push_back(from[arc]);
+    keptTo.push_back(to[arc]);
+    keptDelay.push_back(delay[arc]);
+  }
+  std::vector<uint32_t> byTo;
+  Bucket(keptTo, pins, m_faninBegin, byTo);
+  m_arcFrom.resize(byTo.size());
+  m_arcDelay.resize(byTo.size());
+  for (size_t i = 0; i < byTo.size(); i++) {
+    m_arcFrom[i] = keptFrom[byTo[i]];
+    m_arcDelay[i] = keptDelay[byTo[i]];
+  }
+  Bucket(m_arcFrom, pins, m_fanoutBegin, m_fanoutArcs);
+  m_fanoutTo.resize(m_fanoutArcs.size());
+  for (size_t i = 0; i < m_fanoutArcs.size(); i++) {
+    m_fanoutTo[i] = keptTo[byTo[m_fanoutArcs[i]]];
+  }
+}
+
+float TimingAnalyzer::NetDelay(PinId pin, size_t corner) const {
+  if (m_netlist->PinDirection(pin) == Netlist::Output ||
+      m_faninBegin[pin] == m_faninBegin[pin + 1]) {
+    return 0;
+  }
+  return m_times[corner].m_arcDelay[m_faninBegin[pin]];
+}
+
+float TimingAnalyzer::Slack(PinId pin) const {
+  float slack = Slack(pin, 0);
+  for (size_t c = 1; c < m_corners.size(); c++) {
+    slack = std::min(slack, Slack(pin, c));
+  }
+  return slack;
+}
+
+void TimingAnalyzer::NetDelays(Netlist::NetId net,
+                               const CellPlacement& placement,
+                               const RoutingGraph* graph,
+                               const Routing* routing, NetScratch& scratch,
+                               std::vector<float>& delays) const {
+  const Netlist& netlist = *m_netlist;
+  Netlist::IdSpan pins = netlist.NetPins(net);
+  delays.assign(pins.size(), 0);
+  const PinId driver = netlist.NetDriver(net);
+  if (driver == Netlist::kNone || placement.Size() != netlist.CellCount()) {
+    return;
+  }
+  const Netlist::CellId source = netlist.PinCell(driver);
+  for (size_t i = 0; i < pins.size(); i++) {
+    const Netlist::CellId cell = netlist.PinCell(pins[i]);
+    const float distance = std::abs(std::floor(placement.X(source)) -
+                                    std::floor(placement.X(cell))) +
+                           std::abs(std::floor(placement.Y(source)) -
+                                    std::floor(placement.Y(cell)));
+    delays[i] = distance > 0 ? distance * kWireDelayPerTile + kPinDelay : 0;
+  }
+  if (graph == nullptr || routing == nullptr ||
+      routing->NetCount() != netlist.NetCount()) {
+    return;
+  }
+  Netlist::IdSpan nodes = routing->Nodes(net);
+  Netlist::IdSpan parents = routing->Parents(net);
+  auto tile = [&](Netlist::CellId cell) {
+    const int64_t column = (int64_t)std::floor(placement.X(cell));
+    const int64_t row = (int64_t)std::floor(placement.Y(cell));
+    return std::make_pair(
+        (uint32_t)std::clamp<int64_t>(column, 0, graph->Columns() - 1),
+        (uint32_t)std::clamp<int64_t>(row, 0, graph->Rows() - 1));
+  };
+  const std::pair<uint32_t, uint32_t> from = tile(source);
+  if (nodes.empty() || nodes[0] != graph->SourceNode(from.first, from.second)) {
+    return;
+  }
+  std::vector<float>& treeDelay = scratch.m_treeDelay;
+  std::vector<std::pair<RoutingGraph::NodeId, float>>& sinks = scratch.m_sinks;
+  treeDelay.resize(nodes.size());
+  sinks.clear();
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    treeDelay[i] =
+        (i == 0) ? 0 : treeDelay[parents[i]] + graph->Delay(nodes[i]);
+    if (graph->Type(nodes[i]) == RoutingGraph::Sink) {
+      sinks.push_back({nodes[i], treeDelay[i]});
+    }
+  }
+  std::sort(sinks.begin(), sinks.end());
+  for (size_t i = 0; i < pins.size(); i++) {
+    if (pins[i] == driver ||
+        netlist.PinDirection(pins[i]) == Netlist::Output) {
+      continue;
+    }
+    const std::pair<uint32_t, uint32_t> to = tile(netlist.PinCell(pins[i]));
+    if (to == from) {
+      delays[i] = 0;
+      continue;
+    }
+    const RoutingGraph::NodeId sink = graph->SinkNode(to.first, to.second);
+    auto found = std::lower_bound(sinks.begin(), sinks.end(),
+                                  std::make_pair(sink, -kInfinity));
+    if (found != sinks.end() && found->first == sink) {
+      delays[i] = found->second;
+    }
+  }
+}
+
+void TimingAnalyzer::SetDelays(const CellPlacement& placement,
+                               const RoutingGraph* graph,
+                               const Routing* routing) {
+  const Netlist& netlist = *m_netlist;
+  TaskScheduler::Instance()->ParallelFor(
+      0, netlist.NetCount(), kGrain, [&](size_t begin, size_t end) {
+        NetScratch scratch;
+        std::vector<float> delays;
+        for (size_t net = begin; net < end; net++) {
+          NetDelays((Netlist::NetId)net, placement, graph, routing, scratch,
+                    delays);
+          Netlist::IdSpan pins = netlist.NetPins((Netlist::NetId)net);
+          for (size_t i = 0; i < pins.size(); i++) {
+            const PinId pin = pins[i];
+            const uint32_t arc = m_faninBegin[pin];
+            if (arc == m_faninBegin[pin + 1] ||
+                netlist.PinDirection(pin) == Netlist::Output) {
+              continue;
+            }
+            m_arcDelay[arc] = delays[i];
+            DerateArc(arc, pin);
+          }
+        }
+      });
+  // Any delay may have changed, the next update is a full one
+  m_timed = false;
+}
+
+void TimingAnalyzer::SetPlacedDelays(const CellPlacement& placement) {
+  SetDelays(placement, nullptr, nullptr);
+  m_summary.m_routedDelays = false;
+}
+
+// Delay of a sink along the route tree of its net: the delays of the
+// nodes from the source down to the sink node of its tile
+void TimingAnalyzer::SetRoutedDelays(const CellPlacement& placement,
+                                     const RoutingGraph& graph,
+                                     const Routing& routing) {
+  SetDelays(placement, &graph, &routing);
+  m_summary.m_routedDelays =
+      routing.NetCount() == m_netlist->NetCount() &&
+      placement.Size() == m_netlist->CellCount();
+}
+
+void TimingAnalyzer::SetNetDelays(const std::vector<Netlist::NetId>& nets,
+                                  const CellPlacement& placement,
+                                  const RoutingGraph* graph,
+                                  const Routing* routing) {
+  const Netlist& netlist = *m_netlist;
+  NetScratch scratch;
+  std::vector<float> delays;
+  for (Netlist::NetId net : nets) {
+    NetDelays(net, placement, graph, routing, scratch, delays);
+    Netlist::IdSpan pins = netlist.NetPins(net);
+    for (size_t i = 0; i < pins.size(); i++) {
+      const PinId pin = pins[i];
+      const uint32_t arc = m_faninBegin[pin];
+      if (arc == m_faninBegin[pin + 1] ||
+          netlist.PinDirection(pin) == Netlist::Output ||
+          m_arcDelay[arc] == delays[i]) {
+        continue;
+      }
+      m_arcDelay[arc] = delays[i];
+      DerateArc(arc, pin);
+      Enqueue(m_forwardQueue, pin, kForward);
+      Enqueue(m_backwardQueue, m_arcFrom[arc], kBackward);
+    }
+  }
+}
+
+void TimingAnalyzer::Enqueue(std::vector<std::vector<PinId>>& queues,
+                             PinId pin, uint8_t flag) {
+  if (m_queued[pin] & flag) return;
+  m_queued[pin] |= flag;
+  queues[m_level[pin]].push_back(pin);
+}
+
+float TimingAnalyzer::LaunchArrival(PinId pin, size_t corner) const {
+  return (m_kind[pin] == Launch)
+             ? m_offset[pin] * m_corners[corner].m_cellDerate
+             : -kInfinity;
+}
+
+float TimingAnalyzer::ArrivalFromFanin(PinId pin, size_t corner) const {
+  const CornerTimes& times = m_times[corner];
+  float arrival = LaunchArrival(pin, corner);
+  for (uint32_t arc = m_faninBegin[pin]; arc < m_faninBegin[pin + 1];
+       arc++) {
+    arrival = std::max(arrival, times.m_arrival[m_arcFrom[arc]] +
+                                    times.m_arcDelay[arc]);
+  }
+  return arrival;
+}
+
+float TimingAnalyzer::RequiredFromFanout(PinId pin, size_t corner,
+                                         float period) const {
+  const CornerTimes& times = m_times[corner];
+  float required =
+      (m_kind[pin] == Capture)
+          ? period - m_offset[pin] * m_corners[corner].m_cellDerate
+          : kInfinity;
+  for (uint32_t j = m_fanoutBegin[pin]; j < m_fanoutBegin[pin + 1]; j++) {
+    required = std::min(required, times.m_required[m_fanoutTo[j]] -
+                                      times.m_arcDelay[m_fanoutArcs[j]]);
+  }
+  return required;
+}
+
+bool TimingAnalyzer::TimeArrival(PinId pin) {
+  bool changed = false;
+  for (size_t c = 0; c < m_times.size(); c++) {
+    const float arrival = ArrivalFromFanin(pin, c);
+    if (arrival == m_times[c].m_arrival[pin]) continue;
+    m_times[c].m_arrival[pin] = arrival;
+    changed = true;
+  }
+  return changed;
+}
+
+bool TimingAnalyzer::TimeRequired(PinId pin,
+                                  const std::vector<float>& periods) {
+  bool changed = false;
+  for (size_t c = 0; c < m_times.size(); c++) {
+    const float required = RequiredFromFanout(pin, c, periods[c]);
+    if (required == m_times[c].m_required[pin]) continue;
+    m_times[c].m_required[pin] = required;
+    changed = true;
+  }
+  return changed;
+}
+
+void TimingAnalyzer::Update(const Options& options) {
+  auto start = std::chrono::steady_clock::now();
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  std::vector<float> periods;
+  for (size_t c = 0; c < m_corners.size(); c++) {
+    periods.push_back((float)Period(c, options));
+  }
+  // Fewer pins per task with more corners to time each
+  const size_t grain = std::max<size_t>(kGrain / m_corners.size(), 1);
+  const size_t levels = LevelCount();
+  for (size_t level = 0; level < levels; level++) {
+    scheduler->ParallelFor(
+        m_levelBegin[level], m_levelBegin[level + 1], grain,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) TimeArrival(m_order[i]);
+        },
+        options.m_threads);
+  }
+  for (size_t level = levels; level-- > 0;) {
+    scheduler->ParallelFor(
+        m_levelBegin[level], m_levelBegin[level + 1], grain,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            TimeRequired(m_order[i], periods);
+          }
+        },
+        options.m_threads);
+  }
+  // Whatever was queued is timed now
+  for (size_t level = 0; level < levels; level++) {
+    for (PinId pin : m_forwardQueue[level]) m_queued[pin] = 0;
+    for (PinId pin : m_backwardQueue[level]) m_queued[pin] = 0;
+    m_forwardQueue[level].clear();
+    m_backwardQueue[level].clear();
+  }
+  m_timed = true;
+  m_clockPeriod = options.m_clockPeriod;
+
+  Summarize(options, 2 * m_order.size());
+  m_summary.m_seconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+}
+
+// The arcs of the kept graph go to higher levels only: the fanout of a
+// pin whose arrival time changed is queued on a level still ahead, the
+// fanin of a pin whose required time changed on a level already behind
+void TimingAnalyzer::UpdateIncremental(const Options& options) {
+  if (!m_timed || options.m_clockPeriod != m_clockPeriod) {
+    Update(options);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  std::vector<float> periods;
+  for (size_t c = 0; c < m_corners.size(); c++) {
+    periods.push_back((float)Period(c, options));
+  }
+  const size_t grain = std::max<size_t>(kGrain / m_corners.size(), 1);
+  const size_t levels = LevelCount();
+  size_t updated = 0;
+  std::vector<uint8_t> changed;
+  for (size_t level = 0; level < levels; level++) {
+    std::vector<PinId>& queue = m_forwardQueue[level];
+    if (queue.empty()) continue;
+    changed.assign(queue.size(), 0);
+    scheduler->ParallelFor(
+        0, queue.size(), grain,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            changed[i] = TimeArrival(queue[i]);
+          }
+        },
+        options.m_threads);
+    updated += queue.size();
+    for (size_t i = 0; i < queue.size(); i++) {
+      const PinId pin = queue[i];
+      m_queued[pin] &= ~kForward;
+      if (!changed[i]) continue;
+      for (uint32_t j = m_fanoutBegin[pin]; j < m_fanoutBegin[pin + 1]; j++) {
+        Enqueue(m_forwardQueue, m_fanoutTo[j], kForward);
+      }
+    }
+    queue.clear();
+  }
+  for (size_t level = levels; level-- > 0;) {
+    std::vector<PinId>& queue = m_backwardQueue[level];
+    if (queue.empty()) continue;
+    changed.assign(queue.size(), 0);
+    scheduler->ParallelFor(
+        0, queue.size(), grain,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            changed[i] = TimeRequired(queue[i], periods);
+          }
+        },
+        options.m_threads);
+    updated += queue.size();
+    for (size_t i = 0; i < queue.size(); i++) {
+      const PinId pin = queue[i];
+      m_queued[pin] &= ~kBackward;
+      if (!changed[i]) continue;
+      for (uint32_t arc = m_faninBegin[pin]; arc < m_faninBegin[pin + 1];
+           arc++) {
+        Enqueue(m_backwardQueue, m_arcFrom[arc], kBackward);
+      }
+    }
+    queue.clear();
+  }
+
+  Summarize(options, updated);
+  m_summary.m_incremental = true;
+  m_summary.m_seconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+}
+
+void TimingAnalyzer::Summarize(const Options& options, size_t updated) {
+  const bool routed = m_summary.m_routedDelays;
+  m_summary = Summary();
+  m_summary.m_routedDelays = routed;
+  m_summary.m_clockPeriod = options.m_clockPeriod;
+  m_summary.m_updatedPins = updated;
+  for (size_t c = 0; c < m_corners.size(); c++) {
+    Summary& summary = m_times[c].m_summary;
+    summary = m_summary;
+    summary.m_clockPeriod = Period(c, options);
+  }
+  for (PinId pin : m_captures) {
+    bool timed = false;
+    double worst = 0;
+    for (size_t c = 0; c < m_corners.size(); c++) {
+      if (std::isinf(Arrival(pin, c))) continue;
+      const double slack = Slack(pin, c);
+      Summary& summary = m_times[c].m_summary;
+      summary.m_wns =
+          summary.m_endpoints ? std::min(summary.m_wns, slack) : slack;
+      summary.m_endpoints++;
+      if (slack < 0) {
+        summary.m_tns += slack;
+        summary.m_failingEndpoints++;
+      }
+      worst = timed ? std::min(worst, slack) : slack;
+      timed = true;
+    }
+    if (!timed) continue;
+    m_summary.m_wns =
+        m_summary.m_endpoints ? std::min(m_summary.m_wns, worst) : worst;
+    m_summary.m_endpoints++;
+    if (worst < 0) {
+      m_summary.m_tns += worst;
+      m_summary.m_failingEndpoints++;
+    }
+  }
+  for (size_t c = 0; c < m_corners.size(); c++) {
+    Summary& summary = m_times[c].m_summary;
+    if (summary.m_endpoints) {
+      summary.m_criticalPath = summary.m_clockPeriod - summary.m_wns;
+    }
+    m_summary.m_criticalPath =
+        std::max(m_summary.m_criticalPath, summary.m_criticalPath);
+  }
+}
+
+std::vector<float> TimingAnalyzer::Criticalities() const {
+  std::vector<float> criticality(m_kind.size(), 0);
+  const float longest = (float)m_summary.m_criticalPath;
+  if (longest <= 0) return criticality;
+  // Slacks shifted by a negative worst slack, or every pin of a failing
+  // design would be as critical as the worst one
+  const float worst = std::min(0.0f, (float)m_summary.m_wns);
+  for (PinId pin = 0; pin < m_kind.size(); pin++) {
+    if (m_faninBegin[pin] == m_faninBegin[pin + 1] ||
+        m_netlist->PinDirection(pin) == Netlist::Output) {
+      continue;
+    }
+    const float slack = Slack(pin);
+    if (std::isnan(slack) || std::isinf(slack)) continue;
+    criticality[pin] = std::clamp(1 - (slack - worst) / longest, 0.0f, 1.0f);
+  }
+  return criticality;
+}
@@ -0,0 +1,283 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Compiler/CellPlacement.h"
+#include "Compiler/DelayCalculator.h"
+#include "Compiler/Netlist.h"
+#include "Compiler/Routing.h"
+#include "Compiler/RoutingGraph.h"
+
+#ifndef TIMING_ANALYZER_H
+#define TIMING_ANALYZER_H
+
+namespace FOEDAG {
+
+// Static timing analysis on the pins of a netlist. The timing graph has an
+// arc from the driver of every net to each of its sinks, and from every
+// input to every output of the combinational cells. Registers (flip-flop,
+// latch and RAM cells) cut it: their outputs launch paths at their clock
+// to output delay, their data inputs capture them one clock period later
+// minus their setup time. Primary inputs launch and primary outputs
+// capture paths too. All the registers share one ideal clock.
+//
+// The combinational cells share a generic NLDM library: the delay of a
+// cell arc comes from the slew into its input and the load on its output,
+// a unit per sink of the net. The slew into a sink is the one its driver
+// puts out under the load of the net at the nominal input slew. Both only
+// depend on the netlist, Build() evaluates them in batches.
+//
+// Build() levelizes the graph once per netlist, a pin comes after every
+// pin it has an arc from; a combinational loop is cut at its lowest pin.
+// Arcs are CSR slices of flat arrays, the fanin of each pin with the arc
+// delays beside it. Update() propagates the arrival times forward and the
+// required times backward one level at a time, the pins of a level in
+// parallel: a pin only reads the levels before it and writes its own
+// slot, the result does not depend on the number of threads.
+//
+// After a cell moves or a net is rerouted, SetNetDelays() re-times the
+// arcs of its nets and queues the pins of the arcs whose delay changed
+// by level. UpdateIncremental() then only walks the fan-out cone of those
+// arcs for the arrival times and their fan-in cone for the required
+// times, level by level, and stops where a time does not change.
+//
+// Several corners can be analyzed at once. The graph, its levels and the
+// nominal arc delays are shared, each corner has its delays, arrival and
+// required times. A level is timed for every corner in the same parallel
+// sweep, and a pin is queued once whichever corners its delays changed
+// in. The summary takes the worst slack of each endpoint over the corners.
+class TimingAnalyzer {
+ public:
+  typedef Netlist::PinId PinId;
+  enum PinKind : uint8_t {
+    Internal,
+    Launch,   // primary input, register output
+    Capture,  // primary output, register data input
+    Clock,    // register clock input, not timed
+    Untimed   // constants, ends of false paths
+  };
+
+  struct Options {
+    double m_clockPeriod = 10;  // ns
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+  };
+  // Process corner, with the clock of its mode
+  struct Corner {
+    std::string m_name = "nominal";
+    // Factors of the nominal delays: cell arcs, clock to output and setup
+    // of the registers; net arcs
+    float m_cellDerate = 1;
+    float m_wireDerate = 1;
+    double m_clockPeriod = 0;  // ns, 0 for the one of the Options
+  };
+  // Over the capture pins a path reaches, in ns
+  struct Summary {
+    double m_clockPeriod = 0;
+    double m_wns = 0;  // worst slack
+    double m_tns = 0;  // sum of the negative slacks
+    size_t m_failingEndpoints = 0;
+    size_t m_endpoints = 0;
+    // Longest path, setup included
+    double m_criticalPath = 0;
+    bool m_routedDelays = false;
+    double m_seconds = 0;  // of the last update
+    bool m_incremental = false;
+    // Arrival and required times computed by the last update
+    size_t m_updatedPins = 0;
+  };
+
+  // Setup of an ideal register
+  static constexpr float kRegisterSetup = 0.1f;
+  static constexpr float kRegisterClockToOutput = 0.3f;
+  // Net delay per tile of distance before routing, an L1 wire each
+  static constexpr float kWireDelayPerTile = 0.1f;
+
+  // Into the sinks of a net of fanout 1, ns
+  static constexpr float kNominalSlew = 0.05f;
+
+  TimingAnalyzer();
+  TimingAnalyzer(const TimingAnalyzer&) = delete;
+  TimingAnalyzer& operator=(const TimingAnalyzer&) = delete;
+
+  void Build(const Netlist& netlist);
+  // SDC constraints, once built: offsets of the primary inputs and outputs
+  // (input and output delays), launch pins of falseFrom and capture pins
+  // of falseTo that no longer start or end paths. The next update is a
+  // full one.
+  void Constrain(const std::vector<std::pair<PinId, float>>& delays,
+                 const std::vector<PinId>& falseFrom,
+                 const std::vector<PinId>& falseTo);
+  // Keeps the corners
+  void Clear();
+  // Corners to analyze, a single nominal one by default, none for that
+  // one. The times are lost when they change.
+  void SetCorners(const std::vector<Corner>& corners);
+  size_t CornerCount() const { return m_corners.size(); }
+  const Corner& GetCorner(size_t corner) const { return m_corners[corner]; }
+  // Built for netlist, which must not have changed since
+  bool Built(const Netlist& netlist) const {
+    return m_netlist == &netlist && m_kind.size() == netlist.PinCount();
+  }
+
+  // Delays of the net arcs: from the distance between the cells, or along
+  // the routes. Sinks of unrouted nets keep the distance estimate.
+  void SetPlacedDelays(const CellPlacement& placement);
+  void SetRoutedDelays(const CellPlacement& placement,
+                       const RoutingGraph& graph, const Routing& routing);
+  // Delays of the net arcs of nets only, along their routes when graph
+  // and routing are given, queued for UpdateIncremental() when changed
+  void SetNetDelays(const std::vector<Netlist::NetId>& nets,
+                    const CellPlacement& placement,
+                    const RoutingGraph* graph = nullptr,
+                    const Routing* routing = nullptr);
+
+  void Update(const Options& options);
+  // Same times as Update(), re-timing the cones of the arcs queued since
+  // the last update only. A full Update() when the graph was not timed
+  // yet, the clock period changed or all the delays were set again.
+  void UpdateIncremental(const Options& options);
+
+  size_t LevelCount() const { return m_levelBegin.size() - 1; }
+  size_t ArcCount() const { return m_arcFrom.size(); }
+  // Arcs cut to break combinational loops
+  size_t LoopArcs() const { return m_loopArcs; }
+  size_t PinCount() const { return m_kind.size(); }
+  PinKind Kind(PinId pin) const { return (PinKind)m_kind[pin]; }
+  // -infinity when no path reaches the pin
+  float Arrival(PinId pin, size_t corner = 0) const {
+    return m_times[corner].m_arrival[pin];
+  }
+  // Arrival of the paths starting at pin, -infinity unless it launches
+  float LaunchArrival(PinId pin, size_t corner = 0) const;
+  // +infinity when the pin reaches no capture pin
+  float Required(PinId pin, size_t corner = 0) const {
+    return m_times[corner].m_required[pin];
+  }
+  float Slack(PinId pin, size_t corner) const {
+    return Required(pin, corner) - Arrival(pin, corner);
+  }
+  // Worst over the corners
+  float Slack(PinId pin) const;
+  // Delay of the net arc into an input pin, 0 when it has none
+  float NetDelay(PinId pin, size_t corner = 0) const;
+  // The arcs into pin are FaninBegin(pin) to FaninBegin(pin + 1) - 1
+  uint32_t FaninBegin(PinId pin) const { return m_faninBegin[pin]; }
+  PinId ArcFrom(uint32_t arc) const { return m_arcFrom[arc]; }
+  float ArcDelay(uint32_t arc, size_t corner = 0) const {
+    return m_times[corner].m_arcDelay[arc];
+  }
+  // In PinId order
+  const std::vector<PinId>& Captures() const { return m_captures; }
+
+  // Indexed by PinId, for the sinks of the nets: 1 - slack / critical
+  // path, within [0, 1], slacks shifted by the worst one when negative;
+  // 0 for the other pins
+  std::vector<float> Criticalities() const;
+  // Merged over the corners: the worst slack of each endpoint, the longest
+  // critical path
+  const Summary& GetSummary() const { return m_summary; }
+  const Summary& CornerSummary(size_t corner) const {
+    return m_times[corner].m_summary;
+  }
+
+ private:
+  struct CornerTimes {
+    std::vector<float> m_arcDelay;
+    std::vector<float> m_arrival;
+    std::vector<float> m_required;
+    Summary m_summary;
+  };
+  struct NetScratch {
+    std::vector<float> m_treeDelay;
+    std::vector<std::pair<RoutingGraph::NodeId, float>> m_sinks;
+  };
+
+  void Levelize(std::vector<PinId>& from, std::vector<PinId>& to,
+                std::vector<float>& delay);
+  // Delay of the arc into each sink of net, by position in NetPins(net).
+  // A route counts when it starts from the tile of the driver, the
+  // sinks it does not reach keep the distance estimate.
+  void NetDelays(Netlist::NetId net, const CellPlacement& placement,
+                 const RoutingGraph* graph, const Routing* routing,
+                 NetScratch& scratch, std::vector<float>& delays) const;
+  void SetDelays(const CellPlacement& placement, const RoutingGraph* graph,
+                 const Routing* routing);
+  void ResetTimes();
+  // Derated nominal delay of the arc into pin, for each corner
+  void DerateArc(uint32_t arc, PinId pin);
+  double Period(size_t corner, const Options& options) const {
+    return m_corners[corner].m_clockPeriod > 0 ? m_corners[corner].m_clockPeriod
+                                               : options.m_clockPeriod;
+  }
+  float ArrivalFromFanin(PinId pin, size_t corner) const;
+  float RequiredFromFanout(PinId pin, size_t corner, float period) const;
+  // Of every corner, true when one of them changed
+  bool TimeArrival(PinId pin);
+  bool TimeRequired(PinId pin, const std::vector<float>& periods);
+  void Enqueue(std::vector<std::vector<PinId>>& queues, PinId pin,
+               uint8_t flag);
+  void Summarize(const Options& options, size_t updated);
+
+  DelayCalculator m_library;
+  DelayCalculator::TableId m_cellDelay = 0;
+  DelayCalculator::TableId m_cellSlew = 0;
+  const Netlist* m_netlist = nullptr;
+  std::vector<uint8_t> m_kind;
+  // Clock to output of the launch pins, setup of the capture pins
+  std::vector<float> m_offset;
+  // Pins by level, m_levelBegin the LevelCount() + 1 offsets
+  std::vector<PinId> m_order;
+  std::vector<uint32_t> m_levelBegin{0};
+  std::vector<uint32_t> m_level;
+  // Arcs sorted by destination: m_faninBegin the PinCount() + 1 offsets
+  std::vector<uint32_t> m_faninBegin;
+  std::vector<PinId> m_arcFrom;
+  // Nominal delays, derated in m_times
+  std::vector<float> m_arcDelay;
+  // Arc ids sorted by source
+  std::vector<uint32_t> m_fanoutBegin;
+  std::vector<uint32_t> m_fanoutArcs;
+  std::vector<PinId> m_fanoutTo;
+  std::vector<PinId> m_captures;
+  size_t m_loopArcs = 0;
+  std::vector<Corner> m_corners{Corner()};
+  std::vector<CornerTimes> m_times{CornerTimes()};
+  // Pins to re-time by level, flagged in m_queued: kForward for the
+  // arrival time, kBackward for the required time
+  static constexpr uint8_t kForward = 1;
+  static constexpr uint8_t kBackward = 2;
+  std::vector<std::vector<PinId>> m_forwardQueue;
+  std::vector<std::vector<PinId>> m_backwardQueue;
+  std::vector<uint8_t> m_queued;
+  // The times match the delays but for the queued arcs
+  bool m_timed = false;
+  double m_clockPeriod = 0;  // of the Options of the last update
+  Summary m_summary;
+};
+
+}  // namespace FOEDAG
+
+#endif
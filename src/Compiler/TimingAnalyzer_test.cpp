@@ -0,0 +1,524 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Compiler/TimingAnalyzer.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "Compiler/Router.h"
+#include "Compiler/TimingPaths.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace FOEDAG {
+namespace {
+// in -> LUT -> register -> LUT -> out, the register clocked from clk
+void BuildPipeline(Netlist& netlist) {
+  auto net = [&](const char* name) { return netlist.AddNet(name); };
+  Netlist::NetId in = net("in"), a = net("a"), q = net("q"), b = net("b"),
+                 clk = net("clk");
+  Netlist::CellId cell = netlist.AddCell("in", "$input");
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), in);
+  cell = netlist.AddCell("clk", "$input");
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), clk);
+  cell = netlist.AddCell("lut1", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), in);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), a);
+  cell = netlist.AddCell("reg", "dff");
+  netlist.Connect(netlist.AddPin(cell, "D", Netlist::Input), a);
+  netlist.Connect(netlist.AddPin(cell, "C", Netlist::Input), clk);
+  netlist.Connect(netlist.AddPin(cell, "Q", Netlist::Output), q);
+  cell = netlist.AddCell("lut2", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), q);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), b);
+  cell = netlist.AddCell("out", "$output");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), b);
+  netlist.Finalize();
+}
+
+Netlist::PinId Pin(const Netlist& netlist, const char* cell,
+                   const char* name) {
+  for (Netlist::PinId pin : netlist.CellPins(netlist.FindCell(cell))) {
+    if (netlist.PinName(pin) == name) return pin;
+  }
+  return Netlist::kNone;
+}
+
+// Layers of LUT4s, each input from a random cell of the layers above
+void BuildRandomLogic(Netlist& netlist, int layers, int width) {
+  std::mt19937 random(7);
+  std::vector<Netlist::NetId> nets;
+  for (int i = 0; i < width; i++) {
+    nets.push_back(netlist.AddNet("i" + std::to_string(i)));
+    Netlist::CellId cell =
+        netlist.AddCell("i" + std::to_string(i), "$input");
+    netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), nets.back());
+  }
+  for (int layer = 0; layer < layers; layer++) {
+    const size_t available = nets.size();
+    for (int i = 0; i < width; i++) {
+      const std::string name =
+          "c" + std::to_string(layer) + "_" + std::to_string(i);
+      Netlist::CellId cell = netlist.AddCell(name, "LUT4");
+      for (const char* input : {"A", "B", "C", "D"}) {
+        netlist.Connect(netlist.AddPin(cell, input, Netlist::Input),
+                        nets[random() % available]);
+      }
+      nets.push_back(netlist.AddNet(name));
+      netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output),
+                      nets.back());
+    }
+  }
+  for (int i = 0; i < width; i++) {
+    Netlist::CellId cell =
+        netlist.AddCell("o" + std::to_string(i), "$output");
+    netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input),
+                    nets[nets.size() - 1 - i]);
+  }
+  netlist.Finalize();
+}
+
+TEST(TimingAnalyzer, RegistersCutThePaths) {
+  Netlist netlist;
+  BuildPipeline(netlist);
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  EXPECT_TRUE(timing.Built(netlist));
+  EXPECT_EQ(timing.Kind(Pin(netlist, "reg", "C")), TimingAnalyzer::Clock);
+  EXPECT_EQ(timing.Kind(Pin(netlist, "reg", "D")), TimingAnalyzer::Capture);
+  EXPECT_EQ(timing.Kind(Pin(netlist, "reg", "Q")), TimingAnalyzer::Launch);
+  timing.SetPlacedDelays(CellPlacement());
+  TimingAnalyzer::Options options;
+  options.m_clockPeriod = 1;
+  timing.Update(options);
+  // Zero net delays: a LUT then the setup before the register, the clock
+  // to output and a LUT after it
+  EXPECT_FLOAT_EQ(timing.Arrival(Pin(netlist, "reg", "D")), 0.25f);
+  EXPECT_FLOAT_EQ(timing.Slack(Pin(netlist, "reg", "D")), 0.65f);
+  EXPECT_FLOAT_EQ(timing.Arrival(Pin(netlist, "out", "A")), 0.55f);
+  EXPECT_FLOAT_EQ(timing.Required(Pin(netlist, "lut2", "A")), 0.75f);
+  const TimingAnalyzer::Summary& summary = timing.GetSummary();
+  EXPECT_EQ(summary.m_endpoints, 2u);
+  EXPECT_NEAR(summary.m_wns, 0.45, 1e-6);
+  EXPECT_EQ(summary.m_failingEndpoints, 0u);
+  EXPECT_NEAR(summary.m_criticalPath, 0.55, 1e-6);
+
+  options.m_clockPeriod = 0.5;
+  timing.Update(options);
+  EXPECT_NEAR(timing.GetSummary().m_wns, -0.05, 1e-6);
+  EXPECT_NEAR(timing.GetSummary().m_tns, -0.05, 1e-6);
+  EXPECT_EQ(timing.GetSummary().m_failingEndpoints, 1u);
+  std::vector<float> criticality = timing.Criticalities();
+  EXPECT_FLOAT_EQ(criticality[Pin(netlist, "out", "A")], 1);
+  EXPECT_GT(criticality[Pin(netlist, "reg", "D")], 0);
+  EXPECT_LT(criticality[Pin(netlist, "reg", "D")], 1);
+  EXPECT_EQ(criticality[Pin(netlist, "lut2", "Y")], 0);
+}
+
+TEST(TimingAnalyzer, EstimatesNetDelaysFromThePlacement) {
+  Netlist netlist;
+  BuildPipeline(netlist);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 10, 10);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, 0.5f + cell, 0.5f);
+  }
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetPlacedDelays(placement);
+  // in is cell 0, lut1 cell 2
+  EXPECT_FLOAT_EQ(timing.NetDelay(Pin(netlist, "lut1", "A")),
+                  2 * TimingAnalyzer::kWireDelayPerTile + 0.05f);
+  EXPECT_EQ(timing.NetDelay(Pin(netlist, "lut1", "Y")), 0);
+}
+
+TEST(TimingAnalyzer, TakesTheDelaysOfTheRoutes) {
+  Netlist netlist;
+  BuildPipeline(netlist);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 8, 8);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, 0.5f + 3 * (cell % 2), 0.5f + cell);
+  }
+  // in on (0, 0), lut1 on (0, 2): two L1 wires down then the sink
+  RoutingGraph graph;
+  graph.Build(8, 8, 4);
+  Router router;
+  Routing routing;
+  ASSERT_TRUE(router.Route(netlist, placement, graph, routing));
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetRoutedDelays(placement, graph, routing);
+  EXPECT_FLOAT_EQ(timing.NetDelay(Pin(netlist, "lut1", "A")), 0.35f);
+  for (Netlist::PinId pin : netlist.Pins()) {
+    if (netlist.PinDirection(pin) == Netlist::Output) continue;
+    EXPECT_GE(timing.NetDelay(pin), 0.05f) << netlist.PinName(pin);
+  }
+
+  // Moved off its route, lut1 is back to the distance estimate
+  const Netlist::CellId lut1 = netlist.FindCell("lut1");
+  placement.Set(lut1, 5.5f, 2.5f);
+  timing.SetNetDelays({netlist.PinNet(Pin(netlist, "lut1", "A"))}, placement,
+                      &graph, &routing);
+  EXPECT_FLOAT_EQ(timing.NetDelay(Pin(netlist, "lut1", "A")),
+                  7 * TimingAnalyzer::kWireDelayPerTile + 0.05f);
+}
+
+TEST(TimingAnalyzer, CutsCombinationalLoops) {
+  Netlist netlist;
+  Netlist::NetId a = netlist.AddNet("a"), b = netlist.AddNet("b");
+  Netlist::CellId cell = netlist.AddCell("x", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), b);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), a);
+  cell = netlist.AddCell("y", "LUT1");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), a);
+  netlist.Connect(netlist.AddPin(cell, "Y", Netlist::Output), b);
+  cell = netlist.AddCell("out", "$output");
+  netlist.Connect(netlist.AddPin(cell, "A", Netlist::Input), b);
+  netlist.Finalize();
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  EXPECT_EQ(timing.LoopArcs(), 1u);
+  EXPECT_EQ(timing.ArcCount(), 4u);
+  timing.SetPlacedDelays(CellPlacement());
+  timing.Update(TimingAnalyzer::Options());
+  // Nothing launches a path into the loop
+  EXPECT_EQ(timing.GetSummary().m_endpoints, 0u);
+}
+
+TEST(TimingAnalyzer, SameResultWithAnyThreadCount) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 40, 500);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 50, 50);
+  std::mt19937 random(3);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 5000) / 100,
+                  (float)(random() % 5000) / 100);
+  }
+  TimingAnalyzer timing[2];
+  for (int run = 0; run < 2; run++) {
+    timing[run].Build(netlist);
+    timing[run].SetPlacedDelays(placement);
+    TimingAnalyzer::Options options;
+    options.m_threads = (run == 0) ? 1 : 4;
+    timing[run].Update(options);
+  }
+  EXPECT_GT(timing[0].LevelCount(), 40u);
+  EXPECT_EQ(timing[0].GetSummary().m_endpoints, 500u);
+  EXPECT_EQ(timing[0].GetSummary().m_tns, timing[1].GetSummary().m_tns);
+  for (Netlist::PinId pin : netlist.Pins()) {
+    ASSERT_EQ(timing[0].Arrival(pin), timing[1].Arrival(pin));
+    ASSERT_EQ(timing[0].Required(pin), timing[1].Required(pin));
+  }
+}
+
+TEST(TimingAnalyzer, IncrementalUpdateMatchesAFullOne) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 40, 500);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 50, 50);
+  std::mt19937 random(5);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 5000) / 100,
+                  (float)(random() % 5000) / 100);
+  }
+  TimingAnalyzer incremental;
+  incremental.Build(netlist);
+  incremental.SetPlacedDelays(placement);
+  TimingAnalyzer::Options options;
+  incremental.Update(options);
+  EXPECT_FALSE(incremental.GetSummary().m_incremental);
+
+  for (int move = 0; move < 20; move++) {
+    const Netlist::CellId cell =
+        (Netlist::CellId)(random() % netlist.CellCount());
+    placement.Set(cell, (float)(random() % 5000) / 100,
+                  (float)(random() % 5000) / 100);
+    std::vector<Netlist::NetId> nets;
+    for (Netlist::PinId pin : netlist.CellPins(cell)) {
+      nets.push_back(netlist.PinNet(pin));
+    }
+    incremental.SetNetDelays(nets, placement);
+    options.m_clockPeriod = (move == 10) ? 8 : options.m_clockPeriod;
+    incremental.UpdateIncremental(options);
+    // A new clock period times everything again
+    EXPECT_EQ(incremental.GetSummary().m_incremental, move != 10);
+    if (move != 10) {
+      EXPECT_LT(incremental.GetSummary().m_updatedPins, netlist.PinCount());
+    }
+
+    TimingAnalyzer full;
+    full.Build(netlist);
+    full.SetPlacedDelays(placement);
+    full.Update(options);
+    EXPECT_EQ(incremental.GetSummary().m_tns, full.GetSummary().m_tns);
+    EXPECT_EQ(incremental.GetSummary().m_wns, full.GetSummary().m_wns);
+    for (Netlist::PinId pin : netlist.Pins()) {
+      ASSERT_EQ(incremental.Arrival(pin), full.Arrival(pin));
+      ASSERT_EQ(incremental.Required(pin), full.Required(pin));
+    }
+  }
+}
+
+TEST(TimingAnalyzer, CornersMatchSeparateAnalyses) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 30, 200);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 40, 40);
+  std::mt19937 random(9);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 4000) / 100,
+                  (float)(random() % 4000) / 100);
+  }
+  std::vector<TimingAnalyzer::Corner> corners(3);
+  corners[1].m_name = "slow";
+  corners[1].m_cellDerate = 1.3f;
+  corners[1].m_wireDerate = 1.2f;
+  corners[1].m_clockPeriod = 12;
+  corners[2].m_name = "fast";
+  corners[2].m_cellDerate = 0.8f;
+  corners[2].m_wireDerate = 0.9f;
+  TimingAnalyzer::Options options;
+  options.m_clockPeriod = 8;
+
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetCorners(corners);
+  timing.SetPlacedDelays(placement);
+  timing.Update(options);
+  ASSERT_EQ(timing.CornerCount(), 3u);
+  double wns = 0;
+  for (size_t c = 0; c < corners.size(); c++) {
+    TimingAnalyzer single;
+    single.Build(netlist);
+    single.SetCorners({corners[c]});
+    single.SetPlacedDelays(placement);
+    single.Update(options);
+    for (Netlist::PinId pin : netlist.Pins()) {
+      ASSERT_EQ(timing.Arrival(pin, c), single.Arrival(pin));
+      ASSERT_EQ(timing.Required(pin, c), single.Required(pin));
+    }
+    EXPECT_EQ(timing.CornerSummary(c).m_tns, single.GetSummary().m_tns);
+    wns = c ? std::min(wns, single.GetSummary().m_wns)
+            : single.GetSummary().m_wns;
+  }
+  EXPECT_EQ(timing.CornerSummary(1).m_clockPeriod, 12);
+  EXPECT_EQ(timing.GetSummary().m_wns, wns);
+  // The worst corner of each endpoint
+  double tns = 0;
+  for (Netlist::PinId pin : timing.Captures()) {
+    tns += std::min(0.0f, timing.Slack(pin));
+  }
+  EXPECT_NEAR(timing.GetSummary().m_tns, tns, 1e-3);
+
+  // Incrementally too, every corner
+  TimingAnalyzer incremental;
+  incremental.Build(netlist);
+  incremental.SetCorners(corners);
+  incremental.SetPlacedDelays(placement);
+  incremental.Update(options);
+  const Netlist::CellId cell = netlist.FindCell("c10_20");
+  placement.Set(cell, 0.5f, 39.5f);
+  std::vector<Netlist::NetId> nets;
+  for (Netlist::PinId pin : netlist.CellPins(cell)) {
+    nets.push_back(netlist.PinNet(pin));
+  }
+  incremental.SetNetDelays(nets, placement);
+  incremental.UpdateIncremental(options);
+  EXPECT_TRUE(incremental.GetSummary().m_incremental);
+  timing.SetPlacedDelays(placement);
+  timing.Update(options);
+  for (size_t c = 0; c < corners.size(); c++) {
+    for (Netlist::PinId pin : netlist.Pins()) {
+      ASSERT_EQ(timing.Arrival(pin, c), incremental.Arrival(pin, c));
+      ASSERT_EQ(timing.Required(pin, c), incremental.Required(pin, c));
+    }
+  }
+
+  // The worst path, in whichever corner, has the merged worst slack
+  TimingPaths paths;
+  TimingPaths::Options pathOptions;
+  pathOptions.m_maxPaths = 10;
+  paths.Enumerate(timing, pathOptions);
+  ASSERT_EQ(paths.Size(), 10u);
+  EXPECT_EQ(paths.GetPath(0).m_slack, timing.GetSummary().m_wns);
+}
+
+// Slack of every path into endpoint, by exhaustive search
+void AllPathSlacks(const TimingAnalyzer& timing, Netlist::PinId pin,
+                   double delay, double required,
+                   std::vector<double>& slacks) {
+  const uint32_t begin = timing.FaninBegin(pin);
+  const uint32_t end = timing.FaninBegin(pin + 1);
+  if (begin == end) {
+    if (timing.Kind(pin) == TimingAnalyzer::Launch) {
+      slacks.push_back(required - (timing.Arrival(pin) + delay));
+    }
+    return;
+  }
+  for (uint32_t arc = begin; arc < end; arc++) {
+    AllPathSlacks(timing, timing.ArcFrom(arc), delay + timing.ArcDelay(arc),
+                  required, slacks);
+  }
+}
+
+TEST(TimingPaths, FindsTheWorstPathsInOrder) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 6, 8);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 20, 20);
+  std::mt19937 random(11);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 2000) / 100,
+                  (float)(random() % 2000) / 100);
+  }
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetPlacedDelays(placement);
+  timing.Update(TimingAnalyzer::Options());
+
+  std::vector<std::vector<double>> byEndpoint;
+  for (Netlist::PinId endpoint : timing.Captures()) {
+    byEndpoint.emplace_back();
+    AllPathSlacks(timing, endpoint, 0, timing.Required(endpoint),
+                  byEndpoint.back());
+    std::sort(byEndpoint.back().begin(), byEndpoint.back().end());
+  }
+  for (size_t perEndpoint : {1, 3, 1000000}) {
+    std::vector<double> expected;
+    for (auto& slacks : byEndpoint) {
+      expected.insert(expected.end(), slacks.begin(),
+                      slacks.begin() + std::min(perEndpoint, slacks.size()));
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.resize(std::min<size_t>(expected.size(), 500));
+
+    TimingPaths paths;
+    TimingPaths::Options options;
+    options.m_maxPaths = 500;
+    options.m_pathsPerEndpoint = perEndpoint;
+    paths.Enumerate(timing, options);
+    ASSERT_EQ(paths.Size(), expected.size()) << perEndpoint;
+    for (size_t p = 0; p < paths.Size(); p++) {
+      const TimingPaths::Path& path = paths.GetPath(p);
+      EXPECT_NEAR(path.m_slack, expected[p], 1e-4) << p;
+      EXPECT_NEAR(path.m_slack, path.m_required - path.m_arrival, 1e-4);
+      Netlist::IdSpan pins = paths.Pins(p);
+      EXPECT_EQ(timing.Kind(pins[0]), TimingAnalyzer::Launch);
+      EXPECT_EQ(timing.Kind(pins[pins.size() - 1]), TimingAnalyzer::Capture);
+      EXPECT_FLOAT_EQ(paths.Times(p)[pins.size() - 1], path.m_arrival);
+    }
+    // The worst path into an endpoint is the one of its arrival time
+    EXPECT_FLOAT_EQ(paths.Times(0)[paths.Pins(0).size() - 1],
+                    timing.Arrival(paths.Pins(0)[paths.Pins(0).size() - 1]));
+  }
+}
+
+TEST(TimingPaths, SkipsFalsePathPairs) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 6, 8);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 20, 20);
+  std::mt19937 random(11);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 2000) / 100,
+                  (float)(random() % 2000) / 100);
+  }
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetPlacedDelays(placement);
+  timing.Update(TimingAnalyzer::Options());
+
+  TimingPaths all;
+  TimingPaths::Options options;
+  options.m_maxPaths = 1000000;
+  options.m_pathsPerEndpoint = 1000000;
+  all.Enumerate(timing, options);
+  ASSERT_GT(all.Size(), 10u);
+  // Every path of the worst launch and capture pins is false
+  auto ends = [](const TimingPaths& paths, size_t p) {
+    Netlist::IdSpan pins = paths.Pins(p);
+    return std::make_pair(pins[0], pins[pins.size() - 1]);
+  };
+  const auto worst = ends(all, 0);
+  std::vector<TimingPaths::PinSets> falsePaths{
+      {{worst.first}, {worst.second}}};
+  // The 5 worst others, at most 2 per endpoint
+  std::vector<double> expected;
+  std::map<Netlist::PinId, size_t> perEndpoint;
+  for (size_t p = 0; p < all.Size() && expected.size() < 5; p++) {
+    if (ends(all, p) == worst) continue;
+    if (perEndpoint[ends(all, p).second]++ < 2) {
+      expected.push_back(all.GetPath(p).m_slack);
+    }
+  }
+
+  TimingPaths paths;
+  options.m_maxPaths = 5;
+  options.m_pathsPerEndpoint = 2;
+  options.m_falsePaths = &falsePaths;
+  paths.Enumerate(timing, options);
+  ASSERT_EQ(paths.Size(), expected.size());
+  for (size_t p = 0; p < paths.Size(); p++) {
+    EXPECT_NE(ends(paths, p), worst) << p;
+    EXPECT_NEAR(paths.GetPath(p).m_slack, expected[p], 1e-4) << p;
+  }
+}
+
+TEST(TimingPaths, ManyPathsQuicklyAndThreadIndependent) {
+  Netlist netlist;
+  BuildRandomLogic(netlist, 40, 500);
+  CellPlacement placement;
+  placement.Reset(netlist.CellCount(), 50, 50);
+  std::mt19937 random(3);
+  for (Netlist::CellId cell : netlist.Cells()) {
+    placement.Set(cell, (float)(random() % 5000) / 100,
+                  (float)(random() % 5000) / 100);
+  }
+  TimingAnalyzer timing;
+  timing.Build(netlist);
+  timing.SetPlacedDelays(placement);
+  timing.Update(TimingAnalyzer::Options());
+  // Far more paths than 10000 into each endpoint
+  TimingPaths paths[2];
+  for (int run = 0; run < 2; run++) {
+    TimingPaths::Options options;
+    options.m_maxPaths = 10000;
+    options.m_pathsPerEndpoint = 100;
+    options.m_threads = (run == 0) ? 1 : 4;
+    paths[run].Enumerate(timing, options);
+  }
+  ASSERT_EQ(paths[0].Size(), 10000u);
+  ASSERT_EQ(paths[1].Size(), 10000u);
+  EXPECT_LE(paths[0].Expanded(), 500u * 100);
+  for (size_t p = 0; p < paths[0].Size(); p++) {
+    ASSERT_EQ(paths[0].GetPath(p).m_slack, paths[1].GetPath(p).m_slack);
+    ASSERT_EQ(paths[0].Pins(p).size(), paths[1].Pins(p).size());
+    if (p) {
+      ASSERT_LE(paths[0].GetPath(p - 1).m_slack, paths[0].GetPath(p).m_slack);
+    }
+  }
+}
+}  // namespace
+}  // namespace FOEDAG
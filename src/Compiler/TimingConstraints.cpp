@@ -0,0 +1,265 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/TimingConstraints.h"
+
+#include <algorithm>
+
+using namespace FOEDAG;
+
+void TimingConstraints::Bind(const Netlist& netlist) { Reset(&netlist); }
+
+void TimingConstraints::Unbind() { Reset(nullptr); }
+
+void TimingConstraints::Reset(const Netlist* netlist) {
+  m_names.Bind(netlist);
+  m_properties.Bind(&m_names);
+  m_clockColumns.clear();
+  m_boundPins = netlist ? netlist->PinCount() : 0;
+  m_binding++;
+  m_revision++;
+  m_clocks.clear();
+  m_ioDelays.clear();
+  m_ioDelayIndex.clear();
+  m_exceptions.clear();
+  m_objects.clear();
+}
+
+const ObjectProperties::Column* TimingConstraints::Property(
+    Kind kind, std::string_view property) {
+  if (kind != ObjectNames::Clock) return m_properties.Get(kind, property);
+  auto found = m_clockColumns.find(property);
+  if (found != m_clockColumns.end()) return &found->second;
+  ObjectProperties::Column column;
+  if (property == "name") {
+    column.m_type = ObjectProperties::Symbol;
+    for (uint32_t clock = 0; clock < m_clocks.size(); clock++) {
+      column.m_symbols.push_back(clock);
+      column.m_symbolNames.push_back(m_clocks[clock].m_name);
+    }
+  } else if (property == "period") {
+    for (const Clock& clock : m_clocks) {
+      column.m_numbers.push_back(clock.m_period);
+    }
+  } else {
+    return nullptr;
+  }
+  return &m_clockColumns.emplace(property, std::move(column)).first->second;
+}
+
+uint32_t TimingConstraints::AddClock(const Clock& clock) {
+  m_revision++;
+  m_clockColumns.clear();
+  uint32_t id = FindClock(clock.m_name);
+  if (id != ObjectNames::kNone) {
+    m_clocks[id] = clock;
+    return id;
+  }
+  m_clocks.push_back(clock);
+  return (uint32_t)m_clocks.size() - 1;
+}
+
+uint32_t TimingConstraints::FindClock(const std::string& name) const {
+  for (uint32_t clock = 0; clock < m_clocks.size(); clock++) {
+    if (m_clocks[clock].m_name == name) return clock;
+  }
+  return ObjectNames::kNone;
+}
+
+double TimingConstraints::ClockPeriod(double defaultPeriod) const {
+  if (m_clocks.empty()) return defaultPeriod;
+  double period = m_clocks.front().m_period;
+  for (const Clock& clock : m_clocks) period = std::min(period, clock.m_period);
+  return period;
+}
+
+void TimingConstraints::AddIoDelay(const IoDelay& delay, bool add) {
+  m_revision++;
+  auto key = std::make_tuple(delay.m_port.m_id, delay.m_clock, delay.m_input,
+                             delay.m_min);
+  auto found = m_ioDelayIndex.find(key);
+  if (found != m_ioDelayIndex.end() && !add) {
+    m_ioDelays[found->second] = delay;
+    return;
+  }
+  m_ioDelayIndex[key] = (uint32_t)m_ioDelays.size();
+  m_ioDelays.push_back(delay);
+}
+
+void TimingConstraints::AddException(ExceptionType type, float value,
+                                     bool setup, bool hold,
+                                     const std::vector<Object>& from,
+                                     const std::vector<Object>& through,
+                                     const std::vector<Object>& to) {
+  m_revision++;
+  Exception exception;
+  exception.m_type = type;
+  exception.m_value = value;
+  exception.m_setup = setup;
+  exception.m_hold = hold;
+  exception.m_from = (uint32_t)m_objects.size();
+  m_objects.insert(m_objects.end(), from.begin(), from.end());
+  exception.m_through = (uint32_t)m_objects.size();
+  m_objects.insert(m_objects.end(), through.begin(), through.end());
+  exception.m_to = (uint32_t)m_objects.size();
+  m_objects.insert(m_objects.end(), to.begin(), to.end());
+  exception.m_end = (uint32_t)m_objects.size();
+  m_exceptions.push_back(exception);
+}
+
+// A port cell has a single pin
+static Netlist::PinId PortPin(const Netlist& netlist, uint32_t cell) {
+  const Netlist::IdRange pins = netlist.CellPins(cell);
+  return pins.empty() ? Netlist::kNone : pins[0];
+}
+
+void TimingConstraints::ObjectPins(const Object& object, bool start,
+                                   std::vector<Netlist::PinId>& pins) const {
+  const Netlist* netlist = m_names.GetNetlist();
+  switch (object.m_kind) {
+    case ObjectNames::Port:
+      pins.push_back(PortPin(*netlist, object.m_id));
+      break;
+    case ObjectNames::Cell:
+      for (Netlist::PinId pin : netlist->CellPins(object.m_id)) {
+        if ((netlist->PinDirection(pin) == Netlist::Input) != start) {
+          pins.push_back(pin);
+        }
+      }
+      break;
+    case ObjectNames::Pin:
+      pins.push_back(object.m_id);
+      break;
+    case ObjectNames::Net: {
+      const Netlist::PinId driver = netlist->NetDriver(object.m_id);
+      for (Netlist::PinId pin : netlist->NetPins(object.m_id)) {
+        if ((pin == driver) == start) pins.push_back(pin);
+      }
+      break;
+    }
+    case ObjectNames::Clock:
+      break;
+  }
+}
+
+// Sorted, without duplicates nor kNone
+static void SortPins(std::vector<Netlist::PinId>& pins) {
+  pins.erase(std::remove(pins.begin(), pins.end(), Netlist::kNone),
+             pins.end());
+  std::sort(pins.begin(), pins.end());
+  pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+}
+
+TimingConstraints::FalsePathShape TimingConstraints::Shape(
+    const Exception& exception) const {
+  if (exception.m_type != FalsePath || !exception.m_setup) return Other;
+  if (exception.m_through != exception.m_to) return Other;
+  // All or nothing: a clock is beyond the single clock analysis
+  if (std::any_of(m_objects.begin() + exception.m_from,
+                  m_objects.begin() + exception.m_end,
+                  [](const Object& object) {
+                    return object.m_kind == ObjectNames::Clock;
+                  })) {
+    return Other;
+  }
+  const bool from = exception.m_from != exception.m_through;
+  const bool to = exception.m_to != exception.m_end;
+  if (from && to) return FromTo;
+  if (from) return FromOnly;
+  if (to) return ToOnly;
+  return Other;
+}
+
+void TimingConstraints::TimingPins(
+    std::vector<std::pair<Netlist::PinId, float>>& delays,
+    std::vector<Netlist::PinId>& falseFrom,
+    std::vector<Netlist::PinId>& falseTo) const {
+  delays.clear();
+  falseFrom.clear();
+  falseTo.clear();
+  const Netlist* netlist = m_names.GetNetlist();
+  if (netlist == nullptr) return;
+  for (const IoDelay& delay : m_ioDelays) {
+    if (delay.m_min) continue;
+    const Netlist::PinId pin = PortPin(*netlist, delay.m_port.m_id);
+    if (pin != Netlist::kNone) delays.emplace_back(pin, delay.m_delay);
+  }
+  // The largest delay of a port over its clocks
+  std::sort(delays.begin(), delays.end(),
+            [](const auto& a, const auto& b) {
+              return a.first < b.first ||
+                     (a.first == b.first && a.second > b.second);
+            });
+  delays.erase(std::unique(delays.begin(), delays.end(),
+                           [](const auto& a, const auto& b) {
+                             return a.first == b.first;
+                           }),
+               delays.end());
+
+  for (const Exception& exception : m_exceptions) {
+    const FalsePathShape shape = Shape(exception);
+    if (shape == FromOnly) {
+      for (uint32_t i = exception.m_from; i < exception.m_through; i++) {
+        ObjectPins(m_objects[i], true, falseFrom);
+      }
+    } else if (shape == ToOnly) {
+      for (uint32_t i = exception.m_to; i < exception.m_end; i++) {
+        ObjectPins(m_objects[i], false, falseTo);
+      }
+    }
+  }
+  SortPins(falseFrom);
+  SortPins(falseTo);
+}
+
+void TimingConstraints::FalsePathPairs(
+    std::vector<FalsePathPins>& pairs) const {
+  pairs.clear();
+  if (m_names.GetNetlist() == nullptr) return;
+  for (const Exception& exception : m_exceptions) {
+    if (Shape(exception) != FromTo) continue;
+    FalsePathPins pair;
+    for (uint32_t i = exception.m_from; i < exception.m_through; i++) {
+      ObjectPins(m_objects[i], true, pair.first);
+    }
+    for (uint32_t i = exception.m_to; i < exception.m_end; i++) {
+      ObjectPins(m_objects[i], false, pair.second);
+    }
+    SortPins(pair.first);
+    SortPins(pair.second);
+    if (!pair.first.empty() && !pair.second.empty()) {
+      pairs.push_back(std::move(pair));
+    }
+  }
+}
+
+void TimingConstraints::IgnoredExceptions(
+    size_t counts[MulticyclePath + 1]) const {
+  for (int type = FalsePath; type <= MulticyclePath; type++) {
+    counts[type] = 0;
+  }
+  for (const Exception& exception : m_exceptions) {
+    // Hold false paths have no analysis to apply to
+    if (exception.m_type == FalsePath && !exception.m_setup) continue;
+    if (Shape(exception) == Other) counts[exception.m_type]++;
+  }
+}
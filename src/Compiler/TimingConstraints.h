@@ -0,0 +1,170 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Compiler/Netlist.h"
+#include "Compiler/ObjectFilter.h"
+#include "Compiler/ObjectNames.h"
+
+#ifndef TIMING_CONSTRAINTS_H
+#define TIMING_CONSTRAINTS_H
+
+namespace FOEDAG {
+
+// The SDC constraints of a netlist: clocks, input and output delays and
+// timing exceptions, on objects of its ObjectNames. Exceptions keep their
+// -from, -through and -to objects back to back in one flat array, a file
+// of a few hundred thousand set_false_path is a few arrays, not that many
+// allocations.
+class TimingConstraints {
+ public:
+  typedef ObjectNames::Kind Kind;
+  struct Object {
+    Kind m_kind = ObjectNames::Pin;
+    uint32_t m_id = ObjectNames::kNone;
+    bool operator==(const Object& other) const {
+      return m_kind == other.m_kind && m_id == other.m_id;
+    }
+  };
+  struct Clock {
+    std::string m_name;
+    double m_period = 0;  // ns
+    // Rising and falling edges within the period
+    double m_rise = 0;
+    double m_fall = 0;
+    std::vector<Object> m_sources;  // none for a virtual clock
+  };
+  struct IoDelay {
+    Object m_port;
+    uint32_t m_clock = ObjectNames::kNone;
+    float m_delay = 0;  // ns
+    bool m_input = true;
+    bool m_min = false;  // hold, not used by setup analysis
+  };
+  enum ExceptionType : uint8_t { FalsePath, MaxDelay, MulticyclePath };
+  struct Exception {
+    ExceptionType m_type = FalsePath;
+    // Delay of set_max_delay, ns, or multiplier of set_multicycle_path
+    float m_value = 0;
+    // Applies to setup (max delay) and to hold (min delay) analysis
+    bool m_setup = true;
+    bool m_hold = true;
+    // m_objects[m_from, m_through) are the -from objects, then the
+    // -through ones up to m_to, the -to ones up to m_end
+    uint32_t m_from = 0;
+    uint32_t m_through = 0;
+    uint32_t m_to = 0;
+    uint32_t m_end = 0;
+  };
+
+  // Forgets the constraints, objects are named in netlist from now on
+  void Bind(const Netlist& netlist);
+  // Forgets the constraints and the netlist
+  void Unbind();
+  bool Bound(const Netlist& netlist) const {
+    return m_names.GetNetlist() == &netlist &&
+           m_boundPins == netlist.PinCount();
+  }
+  ObjectNames& Names() { return m_names; }
+  const ObjectNames& Names() const { return m_names; }
+  // Column of a property of the objects of kind, clocks included, nullptr
+  // when they have none. Clock columns are rebuilt after AddClock().
+  const ObjectProperties::Column* Property(Kind kind,
+                                           std::string_view property);
+  // Changes on each Bind(), objects of an older binding are stale
+  uint32_t Binding() const { return m_binding; }
+  // Changes with every constraint added
+  uint64_t Revision() const { return m_revision; }
+
+  // Replaces the clock of the same name, returns its id
+  uint32_t AddClock(const Clock& clock);
+  uint32_t FindClock(const std::string& name) const;
+  size_t ClockCount() const { return m_clocks.size(); }
+  const Clock& GetClock(uint32_t clock) const { return m_clocks[clock]; }
+  // Of the fastest clock, defaultPeriod without clocks
+  double ClockPeriod(double defaultPeriod) const;
+
+  // Replaces the delay of the same port, clock and kind unless add
+  void AddIoDelay(const IoDelay& delay, bool add);
+  const std::vector<IoDelay>& IoDelays() const { return m_ioDelays; }
+
+  void AddException(ExceptionType type, float value, bool setup, bool hold,
+                    const std::vector<Object>& from,
+                    const std::vector<Object>& through,
+                    const std::vector<Object>& to);
+  size_t ExceptionCount() const { return m_exceptions.size(); }
+  const Exception& GetException(size_t exception) const {
+    return m_exceptions[exception];
+  }
+  const Object* Objects(uint32_t begin) const {
+    return m_objects.data() + begin;
+  }
+
+  // What the TimingAnalyzer can take: the input and output delays as pin
+  // offsets, and the pins of the false paths with only a -from or only a
+  // -to list, sorted
+  void TimingPins(std::vector<std::pair<Netlist::PinId, float>>& delays,
+                  std::vector<Netlist::PinId>& falseFrom,
+                  std::vector<Netlist::PinId>& falseTo) const;
+  // The false paths with both a -from and a -to list, for TimingPaths: the
+  // launch pins and the capture pins of each, sorted
+  typedef std::pair<std::vector<Netlist::PinId>, std::vector<Netlist::PinId>>
+      FalsePathPins;
+  void FalsePathPairs(std::vector<FalsePathPins>& pairs) const;
+  // Exceptions of each type that neither of the above takes: the timing
+  // analysis stores but does not apply them
+  void IgnoredExceptions(size_t counts[MulticyclePath + 1]) const;
+
+ private:
+  enum FalsePathShape { FromOnly, ToOnly, FromTo, Other };
+  FalsePathShape Shape(const Exception& exception) const;
+  // Pins an object starts paths from, or ends them on
+  void ObjectPins(const Object& object, bool start,
+                  std::vector<Netlist::PinId>& pins) const;
+  void Reset(const Netlist* netlist);
+
+  ObjectNames m_names;
+  ObjectProperties m_properties;
+  std::map<std::string, ObjectProperties::Column, std::less<>>
+      m_clockColumns;
+  size_t m_boundPins = 0;
+  uint32_t m_binding = 0;
+  uint64_t m_revision = 0;
+  std::vector<Clock> m_clocks;
+  std::vector<IoDelay> m_ioDelays;
+  // By port, clock, input and min
+  std::map<std::tuple<uint32_t, uint32_t, bool, bool>, uint32_t>
+      m_ioDelayIndex;
+  std::vector<Exception> m_exceptions;
+  std::vector<Object> m_objects;
+};
+
+}  // namespace FOEDAG
+
+#endif
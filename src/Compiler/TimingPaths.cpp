@@ -0,0 +1,538 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Compiler/TimingPaths.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+
+#include "Compiler/TaskScheduler.h"
+
+using namespace FOEDAG;
+
+namespace {
+typedef Netlist::PinId PinId;
+
+constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+
+// Node of a persistent leftist heap of sidetracks: the arc into m_to,
+// m_cost ns earlier than the worst arc into it
+struct HeapNode {
+  float m_cost;
+  uint32_t m_arc;
+  PinId m_to;
+  uint32_t m_left;
+  uint32_t m_right;
+  uint32_t m_rank;
+};
+
+// A path found into an endpoint: the path m_parent, then the sidetrack
+// m_arc into m_to. The worst path has no parent.
+struct Record {
+  double m_slack;
+  uint32_t m_parent;
+  uint32_t m_arc;
+  PinId m_to;
+};
+
+// The capture pins of the false path pin sets, to the index of their sets
+class FalsePathIndex {
+ public:
+  explicit FalsePathIndex(const std::vector<TimingPaths::PinSets>& sets)
+      : m_sets(sets) {
+    for (uint32_t set = 0; set < sets.size(); set++) {
+      for (PinId pin : sets[set].second) m_captures.emplace_back(pin, set);
+    }
+    std::sort(m_captures.begin(), m_captures.end());
+  }
+  // Sorted launch pins whose paths into capture are false
+  void Launches(PinId capture, std::vector<PinId>& launches) const {
+    launches.clear();
+    for (auto it = std::lower_bound(m_captures.begin(), m_captures.end(),
+                                    std::make_pair(capture, (uint32_t)0));
+         it != m_captures.end() && it->first == capture; ++it) {
+      const std::vector<PinId>& set = m_sets[it->second].first;
+      launches.insert(launches.end(), set.begin(), set.end());
+    }
+    std::sort(launches.begin(), launches.end());
+    launches.erase(std::unique(launches.begin(), launches.end()),
+                   launches.end());
+  }
+
+ private:
+  const std::vector<TimingPaths::PinSets>& m_sets;
+  std::vector<std::pair<PinId, uint32_t>> m_captures;
+};
+
+struct Candidate {
+  double m_slack;
+  double m_parentSlack;
+  uint32_t m_parent;
+  uint32_t m_node;
+  uint64_t m_sequence;
+};
+
+// Lowest slack on top, first pushed first among equals
+struct LaterCandidate {
+  bool operator()(const Candidate& a, const Candidate& b) const {
+    if (a.m_slack != b.m_slack) return a.m_slack > b.m_slack;
+    return a.m_sequence > b.m_sequence;
+  }
+};
+
+// The arc the arrival time of pin comes from, the first one of the
+// fanin when several do; kNil at the start of a path. Arrivals are the
+// ones of the analysis unless given, indexed by pin.
+uint32_t WorstArc(const TimingAnalyzer& timing, PinId pin, size_t corner,
+                  const float* arrivals = nullptr) {
+  auto arrivalOf = [&](PinId at) {
+    return arrivals ? arrivals[at] : timing.Arrival(at, corner);
+  };
+  const float arrival = arrivalOf(pin);
+  for (uint32_t arc = timing.FaninBegin(pin);
+       arc < timing.FaninBegin(pin + 1); arc++) {
+    if (arrivalOf(timing.ArcFrom(arc)) + timing.ArcDelay(arc, corner) ==
+        arrival) {
+      return arc;
+    }
+  }
+  return kNil;
+}
+
+// Pins of a path from its endpoint back to its start, with the arcs
+// between them
+void Trace(const TimingAnalyzer& timing, size_t corner, PinId endpoint,
+           const std::vector<Record>& records, uint32_t record,
+           std::vector<PinId>& pins, std::vector<uint32_t>& arcs,
+           const float* arrivals = nullptr) {
+  std::vector<const Record*> sidetracks;
+  for (uint32_t r = record; records[r].m_parent != kNil;
+       r = records[r].m_parent) {
+    sidetracks.push_back(&records[r]);
+  }
+  // Nearest to the endpoint last
+  pins.clear();
+  arcs.clear();
+  for (PinId at = endpoint;;) {
+    pins.push_back(at);
+    uint32_t arc = kNil;
+    if (!sidetracks.empty() && sidetracks.back()->m_to == at) {
+      arc = sidetracks.back()->m_arc;
+      sidetracks.pop_back();
+    } else {
+      arc = WorstArc(timing, at, corner, arrivals);
+    }
+    if (arc == kNil) break;
+    arcs.push_back(arc);
+    at = timing.ArcFrom(arc);
+  }
+}
+
+// Best-first search of the paths into endpoints in one corner, one
+// instance per thread: the heaps of the pins it visits are kept for the
+// next endpoints
+class Search {
+ public:
+  Search(const TimingAnalyzer& timing, size_t corner,
+         const FalsePathIndex* falsePaths)
+      : m_timing(timing), m_corner(corner), m_falsePaths(falsePaths) {}
+
+  // Paths into endpoint in order of slack, at most count of them and none
+  // above bound. When some of its paths are false, the others are found
+  // over arrivals of their own and traced right away: arcs gets the arcs
+  // of each record back from endpoint, it is left empty otherwise.
+  void Run(PinId endpoint, size_t count, double bound,
+           std::vector<Record>& records,
+           std::vector<std::vector<uint32_t>>& arcs);
+  size_t Expanded() const { return m_expanded; }
+
+ private:
+  bool Less(uint32_t a, uint32_t b) const {
+    const HeapNode& x = m_nodes[a];
+    const HeapNode& y = m_nodes[b];
+    if (x.m_cost != y.m_cost) return x.m_cost < y.m_cost;
+    return x.m_arc < y.m_arc;
+  }
+  uint32_t Rank(uint32_t node) const {
+    return node == kNil ? 0 : m_nodes[node].m_rank;
+  }
+  float Arrival(PinId pin) const {
+    return m_masked ? m_arrivals[pin] : m_timing.Arrival(pin, m_corner);
+  }
+  const float* Arrivals() const {
+    return m_masked ? m_arrivals.data() : nullptr;
+  }
+  uint32_t Merge(uint32_t a, uint32_t b);
+  // Sidetracks along the worst path from pin back to its start
+  uint32_t Heap(PinId pin);
+  // Arrivals over the fanin cone of endpoint without the paths starting
+  // at launches
+  void Mask(PinId endpoint, const std::vector<PinId>& launches);
+  void Expand(PinId endpoint, size_t count, double bound,
+              std::vector<Record>& records);
+
+  const TimingAnalyzer& m_timing;
+  const size_t m_corner;
+  const FalsePathIndex* m_falsePaths;
+  std::vector<HeapNode> m_nodes;
+  std::unordered_map<PinId, uint32_t> m_heaps;
+  std::vector<PinId> m_chain;
+  size_t m_expanded = 0;
+  // Masked arrivals, valid over the cone of the endpoint being searched
+  bool m_masked = false;
+  std::vector<float> m_arrivals;
+  std::vector<uint32_t> m_visited;
+  uint32_t m_visit = 0;
+  std::vector<PinId> m_launches;
+};
+
+// Copies the nodes along the right spine only, a and b stay valid heaps
+uint32_t Search::Merge(uint32_t a, uint32_t b) {
+  if (a == kNil) return b;
+  if (b == kNil) return a;
+  if (Less(b, a)) std::swap(a, b);
+  const uint32_t right = Merge(m_nodes[a].m_right, b);
+  HeapNode node = m_nodes[a];
+  node.m_right = right;
+  if (Rank(node.m_left) < Rank(node.m_right)) {
+    std::swap(node.m_left, node.m_right);
+  }
+  node.m_rank = Rank(node.m_right) + 1;
+  m_nodes.push_back(node);
+  return (uint32_t)m_nodes.size() - 1;
+}
+
+uint32_t Search::Heap(PinId pin) {
+  // Pins of the worst path up to the first one with a heap already
+  m_chain.clear();
+  uint32_t heap = kNil;
+  for (PinId at = pin;;) {
+    auto found = m_heaps.find(at);
+    if (found != m_heaps.end()) {
+      heap = found->second;
+      break;
+    }
+    m_chain.push_back(at);
+    const uint32_t worst = WorstArc(m_timing, at, m_corner, Arrivals());
+    if (worst == kNil) break;
+    at = m_timing.ArcFrom(worst);
+  }
+  for (size_t i = m_chain.size(); i-- > 0;) {
+    const PinId at = m_chain[i];
+    const uint32_t worst = WorstArc(m_timing, at, m_corner, Arrivals());
+    const float arrival = Arrival(at);
+    for (uint32_t arc = m_timing.FaninBegin(at);
+         arc < m_timing.FaninBegin(at + 1); arc++) {
+      const float from = Arrival(m_timing.ArcFrom(arc));
+      if (arc == worst || std::isinf(from)) continue;
+      const float delay = m_timing.ArcDelay(arc, m_corner);
+      m_nodes.push_back(
+          HeapNode{arrival - (from + delay), arc, at, kNil, kNil, 1});
+      heap = Merge(heap, (uint32_t)m_nodes.size() - 1);
+    }
+    m_heaps[at] = heap;
+  }
+  return heap;
+}
+
+void Search::Mask(PinId endpoint, const std::vector<PinId>& launches) {
+  if (m_arrivals.empty()) {
+    m_arrivals.resize(m_timing.PinCount());
+    m_visited.assign(m_timing.PinCount(), 0);
+  }
+  m_visit++;
+  // Depth first over the fanin, a pin is timed once its fanin is
+  std::vector<std::pair<PinId, uint32_t>> stack;
+  stack.emplace_back(endpoint, m_timing.FaninBegin(endpoint));
+  m_visited[endpoint] = m_visit;
+  while (!stack.empty()) {
+    const PinId pin = stack.back().first;
+    uint32_t& arc = stack.back().second;
+    if (arc < m_timing.FaninBegin(pin + 1)) {
+      const PinId from = m_timing.ArcFrom(arc++);
+      if (m_visited[from] != m_visit) {
+        m_visited[from] = m_visit;
+        stack.emplace_back(from, m_timing.FaninBegin(from));
+      }
+      continue;
+    }
+    float arrival =
+        std::binary_search(launches.begin(), launches.end(), pin)
+            ? -std::numeric_limits<float>::infinity()
+            : m_timing.LaunchArrival(pin, m_corner);
+    for (uint32_t in = m_timing.FaninBegin(pin);
+         in < m_timing.FaninBegin(pin + 1); in++) {
+      arrival = std::max(arrival, m_arrivals[m_timing.ArcFrom(in)] +
+                                      m_timing.ArcDelay(in, m_corner));
+    }
+    m_arrivals[pin] = arrival;
+    stack.pop_back();
+  }
+}
+
+void Search::Run(PinId endpoint, size_t count, double bound,
+                 std::vector<Record>& records,
+                 std::vector<std::vector<uint32_t>>& arcs) {
+  arcs.clear();
+  if (m_falsePaths) m_falsePaths->Launches(endpoint, m_launches);
+  if (!m_falsePaths || m_launches.empty()) {
+    Expand(endpoint, count, bound, records);
+    return;
+  }
+  // The heaps kept are over the arrivals of the analysis, the ones built
+  // over the masked arrivals are dropped after the search
+  Mask(endpoint, m_launches);
+  std::unordered_map<PinId, uint32_t> heaps;
+  heaps.swap(m_heaps);
+  const size_t nodes = m_nodes.size();
+  m_masked = true;
+  Expand(endpoint, count, bound, records);
+  std::vector<PinId> pins;
+  arcs.resize(records.size());
+  for (uint32_t r = 0; r < records.size(); r++) {
+    Trace(m_timing, m_corner, endpoint, records, r, pins, arcs[r],
+          Arrivals());
+  }
+  m_masked = false;
+  m_heaps.swap(heaps);
+  m_nodes.resize(nodes);
+}
+
+// A popped path pushes the next sidetracks of the heap it took its last
+// one from, in place of that one, and the best sidetrack further along
+// its own worst path back to the start
+void Search::Expand(PinId endpoint, size_t count, double bound,
+                    std::vector<Record>& records) {
+  records.clear();
+  const double slack = m_timing.Required(endpoint, m_corner) -
+                       Arrival(endpoint);
+  // Every path into the endpoint is false
+  if (std::isinf(slack)) return;
+  records.push_back(Record{slack, kNil, kNil, kNil});
+  std::priority_queue<Candidate, std::vector<Candidate>, LaterCandidate>
+      queue;
+  uint64_t sequence = 0;
+  auto push = [&](double parentSlack, uint32_t parent, uint32_t node) {
+    if (node == kNil) return;
+    queue.push(Candidate{parentSlack + m_nodes[node].m_cost, parentSlack,
+                         parent, node, sequence++});
+  };
+  push(slack, 0, Heap(endpoint));
+  while (records.size() < count && !queue.empty() &&
+         queue.top().m_slack <= bound) {
+    const Candidate candidate = queue.top();
+    queue.pop();
+    m_expanded++;
+    const HeapNode node = m_nodes[candidate.m_node];
+    records.push_back(
+        Record{candidate.m_slack, candidate.m_parent, node.m_arc, node.m_to});
+    push(candidate.m_parentSlack, candidate.m_parent, node.m_left);
+    push(candidate.m_parentSlack, candidate.m_parent, node.m_right);
+    push(candidate.m_slack, (uint32_t)records.size() - 1,
+         Heap(m_timing.ArcFrom(node.m_arc)));
+  }
+}
+}  // namespace
+
+void TimingPaths::Clear() {
+  m_paths.clear();
+  m_pathBegin.assign(1, 0);
+  m_pins.clear();
+  m_times.clear();
+  m_expanded = 0;
+  m_seconds = 0;
+}
+
+void TimingPaths::Enumerate(const TimingAnalyzer& timing,
+                            const Options& options) {
+  auto start = std::chrono::steady_clock::now();
+  Clear();
+  if (options.m_maxPaths == 0 || options.m_pathsPerEndpoint == 0) return;
+  // Endpoints timed in each corner, worst first; the others cannot make
+  // the K worst
+  struct Endpoint {
+    double m_slack;
+    uint32_t m_corner;
+    PinId m_pin;
+    bool operator<(const Endpoint& other) const {
+      if (m_slack != other.m_slack) return m_slack < other.m_slack;
+      if (m_corner != other.m_corner) return m_corner < other.m_corner;
+      return m_pin < other.m_pin;
+    }
+  };
+  std::vector<Endpoint> endpoints;
+  for (uint32_t corner = 0; corner < timing.CornerCount(); corner++) {
+    for (PinId pin : timing.Captures()) {
+      if (!std::isinf(timing.Arrival(pin, corner))) {
+        endpoints.push_back(Endpoint{timing.Slack(pin, corner), corner, pin});
+      }
+    }
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  std::unique_ptr<FalsePathIndex> falsePaths;
+  if (options.m_falsePaths && !options.m_falsePaths->empty()) {
+    falsePaths.reset(new FalsePathIndex(*options.m_falsePaths));
+  }
+  double bound = std::numeric_limits<double>::infinity();
+  if (!falsePaths && endpoints.size() > options.m_maxPaths) {
+    endpoints.resize(options.m_maxPaths);
+    bound = endpoints.back().m_slack;
+  }
+  const size_t count =
+      std::min(options.m_pathsPerEndpoint, options.m_maxPaths);
+  std::vector<std::vector<Record>> found(endpoints.size());
+  std::vector<std::vector<std::vector<uint32_t>>> traced(endpoints.size());
+  std::atomic<size_t> expanded{0};
+  TaskScheduler* scheduler = TaskScheduler::Instance();
+  scheduler->ParallelFor(
+      0, endpoints.size(), 16,
+      [&](size_t begin, size_t end) {
+        std::vector<std::unique_ptr<Search>> searches(timing.CornerCount());
+        for (size_t i = begin; i < end; i++) {
+          const uint32_t corner = endpoints[i].m_corner;
+          if (!searches[corner]) {
+            searches[corner].reset(
+                new Search(timing, corner, falsePaths.get()));
+          }
+          searches[corner]->Run(endpoints[i].m_pin, count, bound, found[i],
+                                traced[i]);
+        }
+        for (auto& search : searches) {
+          if (search) expanded += search->Expanded();
+        }
+      },
+      options.m_threads);
+  m_expanded = expanded;
+
+  // The K worst over all the endpoints, ties in endpoint order
+  struct Chosen {
+    double m_slack;
+    uint32_t m_endpoint;
+    uint32_t m_record;
+    bool operator<(const Chosen& other) const {
+      if (m_slack != other.m_slack) return m_slack < other.m_slack;
+      if (m_endpoint != other.m_endpoint) {
+        return m_endpoint < other.m_endpoint;
+      }
+      return m_record < other.m_record;
+    }
+  };
+  std::vector<Chosen> chosen;
+  for (uint32_t e = 0; e < found.size(); e++) {
+    for (uint32_t r = 0; r < found[e].size(); r++) {
+      chosen.push_back(Chosen{found[e][r].m_slack, e, r});
+    }
+  }
+  const size_t paths = std::min(chosen.size(), options.m_maxPaths);
+  std::partial_sort(chosen.begin(), chosen.begin() + paths, chosen.end());
+  chosen.resize(paths);
+
+  std::vector<std::vector<PinId>> pins(paths);
+  std::vector<std::vector<float>> times(paths);
+  m_paths.resize(paths);
+  scheduler->ParallelFor(
+      0, paths, 64,
+      [&](size_t begin, size_t end) {
+        std::vector<uint32_t> arcs;
+        for (size_t p = begin; p < end; p++) {
+          const uint32_t e = chosen[p].m_endpoint;
+          const Endpoint& endpoint = endpoints[e];
+          const size_t corner = endpoint.m_corner;
+          if (traced[e].empty()) {
+            Trace(timing, corner, endpoint.m_pin, found[e],
+                  chosen[p].m_record, pins[p], arcs);
+          } else {
+            arcs = traced[e][chosen[p].m_record];
+            pins[p].assign(1, endpoint.m_pin);
+            for (uint32_t arc : arcs) pins[p].push_back(timing.ArcFrom(arc));
+          }
+          std::reverse(pins[p].begin(), pins[p].end());
+          std::reverse(arcs.begin(), arcs.end());
+          times[p].resize(pins[p].size());
+          times[p][0] = timing.LaunchArrival(pins[p][0], corner);
+          for (size_t i = 1; i < pins[p].size(); i++) {
+            times[p][i] =
+                times[p][i - 1] + timing.ArcDelay(arcs[i - 1], corner);
+          }
+          m_paths[p].m_slack = chosen[p].m_slack;
+          m_paths[p].m_arrival = times[p].back();
+          m_paths[p].m_required = timing.Required(endpoint.m_pin, corner);
+          m_paths[p].m_corner = corner;
+        }
+      },
+      options.m_threads);
+  for (size_t p = 0; p < paths; p++) {
+    m_pins.insert(m_pins.end(), pins[p].begin(), pins[p].end());
+    m_times.insert(m_times.end(), times[p].begin(), times[p].end());
+    m_pathBegin.push_back((uint32_t)m_pins.size());
+  }
+  m_seconds = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+}
+
+void TimingPaths::Report(std::ostream& out, const Netlist& netlist,
+                         const TimingAnalyzer& timing) const {
+  auto name = [&](PinId pin) {
+    const Netlist::CellId cell = netlist.PinCell(pin);
+    return std::string(netlist.CellName(cell)) + "/" +
+           std::string(netlist.PinName(pin)) + " (" +
+           std::string(netlist.CellType(cell)) + ")";
+  };
+  for (size_t p = 0; p < Size(); p++) {
+    const Path& path = m_paths[p];
+    Netlist::IdSpan pins = Pins(p);
+    const float* times = Times(p);
+    // One path at a time, the report can be as long as the paths asked
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3);
+    text << "Path " << p + 1 << ": slack " << path.m_slack << "ns ("
+         << (path.m_slack < 0 ? "VIOLATED" : "MET") << ")";
+    if (timing.CornerCount() > 1) {
+      text << ", corner " << timing.GetCorner(path.m_corner).m_name;
+    }
+    text << "\n";
+    text << "  Startpoint: " << name(pins[0]) << "\n";
+    text << "  Endpoint:   " << name(pins[pins.size() - 1]) << "\n";
+    text << "     Delay      Time  Pin\n";
+    for (uint32_t i = 0; i < pins.size(); i++) {
+      const float delay = (i == 0) ? times[0] : times[i] - times[i - 1];
+      text << std::setw(10) << delay << std::setw(10) << times[i] << "  "
+           << name(pins[i]) << "\n";
+    }
+    text << "  Data arrival time  " << std::setw(10) << path.m_arrival
+         << "\n";
+    text << "  Data required time " << std::setw(10) << path.m_required
+         << "\n";
+    text << "  Slack              " << std::setw(10) << path.m_slack
+         << "\n\n";
+    out << text.str();
+  }
+}
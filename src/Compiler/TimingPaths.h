@@ -0,0 +1,117 @@
+/*
+Copyright 2021 The Foedag team
+
+GPL License
+
+Copyright (c) 2021 The Open-Source FPGA Foundation
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "Compiler/Netlist.h"
+#include "Compiler/TimingAnalyzer.h"
+
+#ifndef TIMING_PATHS_H
+#define TIMING_PATHS_H
+
+namespace FOEDAG {
+
+// The worst paths of a timed TimingAnalyzer: the K worst over the whole
+// design and its corners, at most N of them ending on the same capture
+// pin in the same corner.
+//
+// The worst path into a pin follows the fanin arc its arrival time comes
+// from, back to a launch pin. Any other path leaves that chain somewhere
+// for another fanin arc, a sidetrack, and loses the difference of arrival
+// times on the way. The sidetracks along the chain from each pin are kept
+// in a persistent heap, built from the one of the pin before it and
+// shared by every path through the pin. Paths into an endpoint come out
+// of a lazy best-first search over these heaps in order of slack, each
+// popped path pushing at most three candidates: never more work than the
+// paths asked for times the heap depth, however many paths the design
+// has. Only the K worst endpoints can have a path among the K worst, they
+// are searched in parallel, and a search stops at the slack of the K-th
+// worst endpoint. Each corner has its own heaps, over its delays.
+//
+// False paths between a -from and a -to list are left out by searching
+// their capture pins over arrivals of their own, timed over the fanin cone
+// without the false launch pins, and heaps dropped afterwards. The
+// endpoint slacks of the analysis still count those paths, so with any
+// such pair every endpoint is searched.
+class TimingPaths {
+ public:
+  typedef Netlist::PinId PinId;
+  // Sorted launch pins and capture pins
+  typedef std::pair<std::vector<PinId>, std::vector<PinId>> PinSets;
+  struct Options {
+    size_t m_maxPaths = 1;
+    size_t m_pathsPerEndpoint = 1;
+    // 0 for the TaskScheduler concurrency
+    unsigned int m_threads = 0;
+    // Paths from a launch pin to a capture pin of the same sets are false,
+    // not reported
+    const std::vector<PinSets>* m_falsePaths = nullptr;
+  };
+  struct Path {
+    double m_slack = 0;
+    // Data arrival and required times at the endpoint, ns
+    double m_arrival = 0;
+    double m_required = 0;
+    size_t m_corner = 0;
+  };
+
+  TimingPaths() = default;
+  TimingPaths(const TimingPaths&) = delete;
+  TimingPaths& operator=(const TimingPaths&) = delete;
+
+  // Worst first, same paths and order with any number of threads
+  void Enumerate(const TimingAnalyzer& timing, const Options& options);
+  void Clear();
+
+  size_t Size() const { return m_paths.size(); }
+  const Path& GetPath(size_t path) const { return m_paths[path]; }
+  // From the launch pin to the capture pin
+  Netlist::IdSpan Pins(size_t path) const {
+    return Netlist::IdSpan(m_pins.data() + m_pathBegin[path],
+                           m_pins.data() + m_pathBegin[path + 1]);
+  }
+  // Arrival time along the path at each of its pins
+  const float* Times(size_t path) const {
+    return m_times.data() + m_pathBegin[path];
+  }
+  // Candidates taken off the search heaps by the last Enumerate()
+  size_t Expanded() const { return m_expanded; }
+  double Seconds() const { return m_seconds; }
+
+  // report_timing text of the paths, one after the other
+  void Report(std::ostream& out, const Netlist& netlist,
+              const TimingAnalyzer& timing) const;
+
+ private:
+  std::vector<Path> m_paths;
+  std::vector<uint32_t> m_pathBegin{0};
+  std::vector<PinId> m_pins;
+  std::vector<float> m_times;
+  size_t m_expanded = 0;
+  double m_seconds = 0;
+};
+
+}  // namespace FOEDAG
+
+#endif
@@ -21,9 +21,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Compiler/WorkerThread.h"
 
-#include <mutex>
-#include <thread>
-
 using namespace FOEDAG;
 
 std::set<WorkerThread*> ThreadPool::threads;
@@ -38,14 +35,25 @@ WorkerThread::~WorkerThread() {}
 
 bool WorkerThread::start() {
   bool result = true;
-  m_thread = new std::thread([=] { m_compiler->Compile(m_action); });
+  Compiler* compiler = m_compiler;
+  Compiler::Action action = m_action;
+  // A cancelled action may still be winding down, it must not be revived by
+  // the reset of the token below
+  JobHandle<bool>& previous = compiler->BackgroundJob();
+  if (compiler->Cancellation().Cancelled() && previous.Valid()) {
+    previous.Wait();
+  }
+  // A stop issued before this action must not cancel it
+  compiler->Cancellation().Reset();
+  // On a thread of its own: the stages keep the whole pool for their
+  // parallel loops
+  m_job = TaskScheduler::Spawn(
+      [compiler, action] { return compiler->Compile(action); });
+  previous = m_job;
   return result;
 }
 
 bool WorkerThread::stop() {
   m_compiler->Stop();
-  m_thread->join();
-  delete m_thread;
-  m_thread = nullptr;
   return true;
 }
\ No newline at end of file
@@ -23,12 +23,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <set>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "Command/Command.h"
 #include "Command/CommandStack.h"
 #include "Compiler/Compiler.h"
+#include "Compiler/TaskScheduler.h"
 #include "Main/CommandLine.h"
 #include "Tcl/TclInterpreter.h"
 
@@ -51,7 +51,7 @@ class WorkerThread {
  private:
   std::string m_threadName;
   Compiler::Action m_action = Compiler::Action::NoAction;
-  std::thread* m_thread = nullptr;
+  JobHandle<bool> m_job;
   Compiler* m_compiler = nullptr;
 };
 
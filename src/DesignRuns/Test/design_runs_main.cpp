@@ -22,6 +22,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QApplication>
 
 #include "DesignRuns/runs_form.h"
+#include "DesignRuns/runs_farm.h"
+#include "DesignRuns/runs_sweep.h"
 #include "Main/Foedag.h"
 #include "Main/qttclnotifier.hpp"
 #include "Tcl/TclInterpreter.h"
@@ -62,6 +64,9 @@ void registerDesignRunsCommands(FOEDAG::Session* session) {
   };
   session->TclInterp()->registerCmd("design_runs_hide", design_runs_hide,
                                     GlobalSession->MainWindow(), 0);
+
+  FOEDAG::registerRunsSweepCommands(session->TclInterp());
+  FOEDAG::registerRunsFarmCommands(session->TclInterp());
 }
 
 int main(int argc, char** argv) {
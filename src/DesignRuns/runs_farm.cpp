@@ -0,0 +1,139 @@
+#include "runs_farm.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "Compiler/JobServer.h"
+#include "Tcl/TclInterpreter.h"
+#include "runs_launcher.h"
+
+using namespace FOEDAG;
+
+static int Usage(Tcl_Interp *interp, const std::string &message) {
+  std::string error = "ERROR: " + message +
+                      "\nUsage: farm_runs -workers <addresses> "
+                      "?-jobs_per_worker <n>? ?<run> ...?";
+  Tcl_AppendResult(interp, error.c_str(), (char *)NULL);
+  return TCL_ERROR;
+}
+
+// Runs specs on the workers, jobsPerWorker at a time on each. Every slot
+// pulls the next run, so faster workers naturally take more of them.
+static void RunOnWorkers(std::vector<RunSpec> &specs,
+                         std::vector<bool> &results,
+                         const std::vector<std::string> &workers,
+                         unsigned int jobsPerWorker) {
+  std::atomic<size_t> next{0};
+  std::mutex outMutex;
+  std::vector<std::thread> slots;
+  for (auto &worker : workers) {
+    for (unsigned int job = 0; job < jobsPerWorker; job++) {
+      slots.emplace_back([&, worker]() {
+        for (size_t i = next++; i < specs.size(); i = next++) {
+          specs[i].m_worker = worker;
+          RunsLauncher::RunControl control;
+          results[i] = RunsLauncher::Execute(specs[i], control);
+          std::lock_guard<std::mutex> lock(outMutex);
+          std::cout << specs[i].m_name.toStdString() << ": "
+                    << (results[i] ? "completed" : "failed") << " on "
+                    << worker << std::endl;
+        }
+      });
+    }
+  }
+  for (auto &slot : slots) slot.join();
+}
+
+// farm_runs -workers <addresses> ?-jobs_per_worker <n>? ?<run> ...?
+// Ships the given runs (all the runs of the project by default) to the
+// workers and waits for them. Synthesis runs go first; implementation runs
+// then send their synthesis result along instead of redoing it. Statuses are
+// written back to the project, logs stay in the local run folders.
+static int FarmRuns(void *clientData, Tcl_Interp *interp, int argc,
+                    const char *argv[]) {
+  // Runs are parented to the manager, it has to outlive them
+  ProjectManager *projManager = (ProjectManager *)clientData;
+  if ("" == Project::Instance()->projectPath()) {
+    return Usage(interp, "no project opened");
+  }
+  if (!JobChannel::Supported()) {
+    return Usage(interp, "remote workers are not supported on this platform");
+  }
+
+  std::vector<std::string> workers;
+  unsigned int jobsPerWorker = 1;
+  QStringList listRuns;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "-workers" && i + 1 < argc) {
+      std::istringstream addresses(argv[++i]);
+      std::string address;
+      while (addresses >> address) workers.push_back(address);
+    } else if (option == "-jobs_per_worker" && i + 1 < argc) {
+      int jobs = 0;
+      if (Tcl_GetInt(interp, argv[++i], &jobs) != TCL_OK || jobs <= 0) {
+        Tcl_ResetResult(interp);
+        return Usage(interp, "invalid -jobs_per_worker " +
+                                 std::string(argv[i]));
+      }
+      jobsPerWorker = (unsigned int)jobs;
+    } else if (option.compare(0, 1, "-") != 0) {
+      listRuns.append(QString::fromStdString(option));
+    } else {
+      return Usage(interp, "unknown option " + option);
+    }
+  }
+  if (workers.empty() || 0 == jobsPerWorker) {
+    return Usage(interp, "no -workers given");
+  }
+
+  if (listRuns.isEmpty()) {
+    listRuns = projManager->getSynthRunsNames() +
+               projManager->getImpleRunsNames();
+  }
+  RunsLauncher launcher(projManager);
+  std::vector<RunSpec> specs[2];
+  foreach (auto strRunName, listRuns) {
+    RunSpec spec;
+    if (!launcher.CollectSpec(strRunName, spec)) {
+      return Usage(interp, "no run " + strRunName.toStdString());
+    }
+    specs[spec.m_synth ? 0 : 1].push_back(spec);
+    projManager->setRunStatus(strRunName, RUN_STATUS_RUNNING);
+  }
+  projManager->FinishedProject();
+
+  std::ostringstream result;
+  QStringList listFailedSynth;
+  for (int pass = 0; pass < 2; pass++) {
+    std::vector<RunSpec> runnable;
+    for (auto &spec : specs[pass]) {
+      if (pass == 1 && listFailedSynth.contains(spec.m_synthRun)) {
+        projManager->setRunStatus(spec.m_name, RUN_STATUS_CANCELLED);
+        result << "{" << spec.m_name.toStdString() << " cancelled} ";
+      } else {
+        runnable.push_back(spec);
+      }
+    }
+    std::vector<bool> results(runnable.size(), false);
+    RunOnWorkers(runnable, results, workers, jobsPerWorker);
+    for (size_t i = 0; i < runnable.size(); i++) {
+      if (!results[i]) listFailedSynth.append(runnable[i].m_name);
+      projManager->setRunStatus(runnable[i].m_name, results[i]
+                                                        ? RUN_STATUS_COMPLETED
+                                                        : RUN_STATUS_FAILED);
+      result << "{" << runnable[i].m_name.toStdString() << " "
+             << (results[i] ? "completed" : "failed") << "} ";
+    }
+  }
+  projManager->FinishedProject();
+  Tcl_AppendResult(interp, result.str().c_str(), (char *)NULL);
+  return TCL_OK;
+}
+
+void FOEDAG::registerRunsFarmCommands(TclInterpreter *interp) {
+  interp->registerCmd("farm_runs", FarmRuns, new ProjectManager(), 0);
+}
@@ -0,0 +1,13 @@
+#ifndef RUNS_FARM_H
+#define RUNS_FARM_H
+
+namespace FOEDAG {
+
+class TclInterpreter;
+
+// Registers farm_runs, which spreads the runs of the opened project over
+// remote workers started with --worker
+void registerRunsFarmCommands(TclInterpreter *interp);
+
+}  // namespace FOEDAG
+#endif  // RUNS_FARM_H
@@ -11,7 +11,7 @@ using namespace FOEDAG;
 RunsForm::RunsForm(QString strProPath, QWidget *parent) : QWidget(parent) {
   m_treeRuns = new QTreeWidget(this);
   m_treeRuns->setSelectionMode(
-      QAbstractItemView::SelectionMode::SingleSelection);
+      QAbstractItemView::SelectionMode::ExtendedSelection);
 
   QVBoxLayout *vbox = new QVBoxLayout();
   vbox->addWidget(m_treeRuns);
@@ -24,6 +24,14 @@ RunsForm::RunsForm(QString strProPath, QWidget *parent) : QWidget(parent) {
   m_projManager = new ProjectManager(this);
   m_projManager->StartProject(strProPath);
 
+  m_launcher = new RunsLauncher(m_projManager, this);
+  connect(m_launcher,
+          SIGNAL(runStatusChanged(const QString &, const QString &)), this,
+          SLOT(SlotRunStatusChanged(const QString &, const QString &)));
+  connect(m_launcher,
+          SIGNAL(runProgressChanged(const QString &, const QString &)), this,
+          SLOT(SlotRunStatusChanged(const QString &, const QString &)));
+
   UpdateDesignRunsTree();
 
   connect(m_treeRuns, SIGNAL(itemPressed(QTreeWidgetItem *, int)), this,
@@ -94,9 +102,44 @@ void RunsForm::SlotMakeActive() {
   }
 }
 
-void RunsForm::SlotLaunchRuns() {}
+void RunsForm::SlotLaunchRuns() {
+  QStringList listRuns = SelectedRuns();
+  if (listRuns.isEmpty()) {
+    return;
+  }
+  m_launcher->launch(listRuns);
+}
+
+void RunsForm::SlotReSetRuns() {
+  QStringList listRuns = SelectedRuns();
+  if (listRuns.isEmpty()) {
+    return;
+  }
+  m_launcher->reset(listRuns);
+}
+
+void RunsForm::SlotRunStatusChanged(const QString &strRunName,
+                                    const QString &strStatus) {
+  QList<QTreeWidgetItem *> listItems = m_treeRuns->findItems(
+      strRunName, Qt::MatchStartsWith | Qt::MatchRecursive, 0);
+  foreach (auto item, listItems) {
+    QString strName = item->text(0);
+    strName.remove(RUNS_TREE_ACTIVE);
+    if (strName == strRunName) {
+      item->setText(3, strStatus);
+    }
+  }
+}
 
-void RunsForm::SlotReSetRuns() {}
+QStringList RunsForm::SelectedRuns() const {
+  QStringList listRuns;
+  foreach (auto item, m_treeRuns->selectedItems()) {
+    QString strName = item->text(0);
+    strName.remove(RUNS_TREE_ACTIVE);
+    listRuns.append(strName);
+  }
+  return listRuns;
+}
 
 void RunsForm::SlotCreateSynthRuns() { CreateRuns(RT_SYNTH); }
 
@@ -174,7 +217,7 @@ void RunsForm::UpdateDesignRunsTree() {
     } else {
       itemSynth->setText(0, strSynthName);
     }
-    itemSynth->setText(3, RUNS_TREE_STATUS);
+    itemSynth->setText(3, m_projManager->getRunStatus(strSynthName));
 
     // Start creating the implementation view
     QStringList listImpleName = m_projManager->ImpleUsedSynth(strSynthName);
@@ -201,7 +244,7 @@ void RunsForm::UpdateDesignRunsTree() {
         itemImple->setText(0, strImpleName);
       }
 
-      itemImple->setText(3, RUNS_TREE_STATUS);
+      itemImple->setText(3, m_projManager->getRunStatus(strImpleName));
     }
   }
   m_treeRuns->expandAll();
@@ -8,6 +8,7 @@
 #include <QWidget>
 
 #include "NewProject/ProjectManager/project_manager.h"
+#include "runs_launcher.h"
 
 #define RUNS_TREE_STATUS "Not Started"
 #define RUNS_TREE_ACTIVE "(Active)"
@@ -28,6 +29,8 @@ class RunsForm : public QWidget {
   void SlotReSetRuns();
   void SlotCreateSynthRuns();
   void SlotCreateImpleRuns();
+  void SlotRunStatusChanged(const QString& strRunName,
+                            const QString& strStatus);
 
  signals:
 
@@ -42,8 +45,10 @@ class RunsForm : public QWidget {
   QAction* m_actCreateImpleRuns;
 
   ProjectManager* m_projManager;
+  RunsLauncher* m_launcher;
 
   void CreateActions();
+  QStringList SelectedRuns() const;
   void UpdateDesignRunsTree();
   void CreateRuns(int type);
 };
@@ -0,0 +1,379 @@
+#include "runs_launcher.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <fstream>
+
+#include "Compiler/Compiler.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace FOEDAG;
+
+RunsLauncher::RunsLauncher(ProjectManager *projManager, QObject *parent)
+    : QObject(parent), m_projManager(projManager) {
+#if !defined(_WIN32) && defined(_SC_PHYS_PAGES)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGE_SIZE);
+  if (pages > 0 && pageSize > 0) {
+    m_memoryCeilingMB = (quint64)pages * (quint64)pageSize / (1024 * 1024);
+  }
+#endif
+  // Called on the dispatching thread of the bus, the runs are looked up on
+  // the GUI thread
+  m_progressSubscriber =
+      EventBus::Instance()->Subscribe([this](const CompilerEvent &event) {
+        if (event.m_type != CompilerEvent::Phase &&
+            event.m_type != CompilerEvent::Progress) {
+          return;
+        }
+        QMetaObject::invokeMethod(this, "SlotStageProgress",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(uint, event.m_source),
+                                  Q_ARG(QString, QString(event.m_name)),
+                                  Q_ARG(double, event.m_value));
+      });
+}
+
+RunsLauncher::~RunsLauncher() {
+  EventBus::Instance()->Unsubscribe(m_progressSubscriber);
+  for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+    Cancel(iter.value());
+  }
+  // Workers post their completion to this object, wait for them to be done
+  for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+    if (iter.value().m_handle.Valid()) iter.value().m_handle.Wait();
+  }
+}
+
+int RunsLauncher::maxJobs() const {
+  if (m_maxJobs > 0) return m_maxJobs;
+  return (int)TaskScheduler::Instance()->Concurrency();
+}
+
+void RunsLauncher::setMemoryEstimateMB(bool synth, quint64 estimate) {
+  if (synth) {
+    m_synthEstimateMB = estimate;
+  } else {
+    m_impleEstimateMB = estimate;
+  }
+}
+
+bool RunsLauncher::CollectSpec(const QString &strRunName,
+                               RunSpec &spec) const {
+  ProjectRun *proRun = Project::Instance()->getProjectRun(strRunName);
+  if (nullptr == proRun) {
+    return false;
+  }
+  spec.m_name = strRunName;
+  spec.m_synth = (proRun->runType() == RUN_TYPE_SYNTHESIS);
+  spec.m_synthRun = proRun->synthRun();
+
+  // Implementation runs synthesize exactly like their synthesis run, so that
+  // they pick its result from the stage cache instead of recomputing it
+  ProjectRun *synthRun = proRun;
+  if (!spec.m_synth) {
+    synthRun = Project::Instance()->getProjectRun(spec.m_synthRun);
+    if (nullptr == synthRun) {
+      return false;
+    }
+  }
+
+  spec.m_top = m_projManager->getDesignTopModule(synthRun->srcSet())
+                   .toStdString();
+  foreach (auto strFile, m_projManager->getDesignFiles(synthRun->srcSet())) {
+    spec.m_designFiles.push_back(strFile.toStdString());
+  }
+  foreach (auto strFile, m_projManager->getConstrFiles(proRun->constrsSet())) {
+    spec.m_constrFiles.push_back(strFile.toStdString());
+  }
+  QMap<QString, QString> mapOption = proRun->getMapOption();
+  for (auto iter = mapOption.begin(); iter != mapOption.end(); ++iter) {
+    spec.m_options[iter.key().toStdString()] = iter.value().toStdString();
+  }
+  if (!spec.m_synth) {
+    QMap<QString, QString> mapSynthOption = synthRun->getMapOption();
+    for (auto iter = mapSynthOption.begin(); iter != mapSynthOption.end();
+         ++iter) {
+      spec.m_options["synth." + iter.key().toStdString()] =
+          iter.value().toStdString();
+    }
+  }
+
+  QString strRunDir = m_projManager->getRunsFolder(strRunName);
+  QDir().mkpath(strRunDir);
+  spec.m_runDir = strRunDir.toStdString();
+  spec.m_cacheDir =
+      m_projManager->getRunsFolder(DEFAULT_FOLDER_CACHE).toStdString();
+
+  bool ok = false;
+  spec.m_memoryMB = proRun->getOption(PROJECT_RUN_MEMORY).toULongLong(&ok);
+  if (!ok || 0 == spec.m_memoryMB) {
+    spec.m_memoryMB = spec.m_synth ? m_synthEstimateMB : m_impleEstimateMB;
+  }
+  return true;
+}
+
+bool RunsLauncher::launch(const QStringList &listRunNames) {
+  QStringList listQueue;
+  foreach (auto strRunName, listRunNames) {
+    ProjectRun *proRun = Project::Instance()->getProjectRun(strRunName);
+    if (nullptr == proRun) {
+      continue;
+    }
+    if (proRun->runType() == RUN_TYPE_IMPLEMENT) {
+      QString strSynthRun = proRun->synthRun();
+      if (m_projManager->getRunStatus(strSynthRun) != RUN_STATUS_COMPLETED &&
+          !listQueue.contains(strSynthRun)) {
+        listQueue.append(strSynthRun);
+      }
+    }
+    if (!listQueue.contains(strRunName)) {
+      listQueue.append(strRunName);
+    }
+  }
+
+  bool queued = false;
+  foreach (auto strRunName, listQueue) {
+    if (m_jobs.contains(strRunName)) {
+      continue;
+    }
+    Job job;
+    if (!CollectSpec(strRunName, job.m_spec)) {
+      continue;
+    }
+    job.m_control = std::make_shared<RunControl>();
+    m_jobs.insert(strRunName, job);
+    m_projManager->setRunStatus(strRunName, RUN_STATUS_QUEUED);
+    emit runStatusChanged(strRunName, RUN_STATUS_QUEUED);
+    queued = true;
+  }
+  if (queued) {
+    m_projManager->FinishedProject();
+    Schedule();
+  }
+  return queued;
+}
+
+void RunsLauncher::reset(const QStringList &listRunNames) {
+  foreach (auto strRunName, listRunNames) {
+    auto iter = m_jobs.find(strRunName);
+    if (iter != m_jobs.end()) {
+      Cancel(iter.value());
+      // Running jobs are reset once their worker returns, their run folder
+      // only removed once they stopped writing to it
+      if (iter.value().m_running) {
+        iter.value().m_resetting = true;
+        continue;
+      }
+      m_jobs.erase(iter);
+    }
+    ResetRun(strRunName);
+  }
+  m_projManager->FinishedProject();
+  if (m_jobs.isEmpty()) {
+    emit allRunsFinished();
+  }
+}
+
+void RunsLauncher::ResetRun(const QString &strRunName) {
+  QDir(m_projManager->getRunsFolder(strRunName)).removeRecursively();
+  m_projManager->setRunStatus(strRunName, RUN_STATUS_NOT_STARTED);
+  emit runStatusChanged(strRunName, RUN_STATUS_NOT_STARTED);
+}
+
+void RunsLauncher::Schedule() {
+  int running = 0;
+  quint64 usedMB = 0;
+  for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+    if (iter.value().m_running) {
+      running++;
+      usedMB += iter.value().m_spec.m_memoryMB;
+    }
+  }
+
+  // Synthesis runs first, they unblock the implementation runs
+  for (int pass = 0; pass < 2; pass++) {
+    for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+      Job &job = iter.value();
+      if (job.m_running || job.m_spec.m_synth != (pass == 0)) {
+        continue;
+      }
+      if (!job.m_spec.m_synth && m_jobs.contains(job.m_spec.m_synthRun)) {
+        continue;
+      }
+      if (running >= maxJobs()) {
+        return;
+      }
+      // A run larger than the ceiling still runs, alone
+      if (m_memoryCeilingMB && running &&
+          usedMB + job.m_spec.m_memoryMB > m_memoryCeilingMB) {
+        continue;
+      }
+      job.m_running = true;
+      running++;
+      usedMB += job.m_spec.m_memoryMB;
+      SetStatus(iter.key(), RUN_STATUS_RUNNING);
+
+      RunSpec spec = job.m_spec;
+      std::shared_ptr<RunControl> control = job.m_control;
+      // Runs stay off the pool, which their stages share for their
+      // parallel loops
+      job.m_handle = TaskScheduler::Spawn([this, spec, control]() {
+        bool success = Execute(spec, *control);
+        QMetaObject::invokeMethod(this, "SlotJobFinished",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(QString, spec.m_name),
+                                  Q_ARG(bool, success));
+        return success;
+      });
+    }
+  }
+}
+
+void RunsLauncher::SlotJobFinished(const QString &strRunName, bool success) {
+  auto iter = m_jobs.find(strRunName);
+  if (iter == m_jobs.end()) {
+    return;
+  }
+  bool resetting = iter.value().m_resetting;
+  m_jobs.erase(iter);
+  if (resetting) {
+    ResetRun(strRunName);
+    m_projManager->FinishedProject();
+  } else {
+    SetStatus(strRunName, success ? RUN_STATUS_COMPLETED : RUN_STATUS_FAILED);
+    if (!success) {
+      CancelDependents(strRunName);
+    }
+  }
+  Schedule();
+  if (m_jobs.isEmpty()) {
+    emit allRunsFinished();
+  }
+}
+
+void RunsLauncher::SlotStageProgress(uint source, const QString &strPhase,
+                                     double percent) {
+  for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+    if (iter.value().m_running &&
+        iter.value().m_control->m_eventSource == source) {
+      emit runProgressChanged(iter.key(),
+                              QString("%1 - %2 %3%")
+                                  .arg(RUN_STATUS_RUNNING, strPhase)
+                                  .arg((int)percent));
+      return;
+    }
+  }
+}
+
+void RunsLauncher::CancelDependents(const QString &strRunName) {
+  QStringList listDependents;
+  for (auto iter = m_jobs.begin(); iter != m_jobs.end(); ++iter) {
+    if (!iter.value().m_spec.m_synth &&
+        iter.value().m_spec.m_synthRun == strRunName &&
+        !iter.value().m_running) {
+      listDependents.append(iter.key());
+    }
+  }
+  foreach (auto strDependent, listDependents) {
+    m_jobs.remove(strDependent);
+    SetStatus(strDependent, RUN_STATUS_CANCELLED);
+  }
+}
+
+void RunsLauncher::SetStatus(const QString &strRunName,
+                             const QString &strStatus) {
+  m_projManager->setRunStatus(strRunName, strStatus);
+  m_projManager->FinishedProject();
+  emit runStatusChanged(strRunName, strStatus);
+}
+
+static Design::Language FileLanguage(const std::string &fileName) {
+  QString strSuffix = QFileInfo(QString::fromStdString(fileName)).suffix();
+  if (strSuffix == "sv" || strSuffix == "svh") {
+    return Design::SYSTEMVERILOG_2017;
+  } else if (strSuffix == "vhd" || strSuffix == "vhdl") {
+    return Design::VHDL_2008;
+  } else if (strSuffix == "blif") {
+    return Design::BLIF;
+  } else if (strSuffix == "eblif") {
+    return Design::EBLIF;
+  } else if (strSuffix == "vg" || strSuffix == "vm") {
+    return Design::VERILOG_NETLIST;
+  }
+  return Design::VERILOG_2001;
+}
+
+// Options prefixed with a stage name ("routing.timing_driven", "synth." for
+// synthesis) go to that stage. The others go to synthesis in a synthesis
+// run, to every stage after it in an implementation run.
+static void SetRunOption(Compiler &compiler, bool synth,
+                         const std::string &name, const std::string &value) {
+  size_t dot = name.find('.');
+  if (dot != std::string::npos) {
+    std::string prefix = name.substr(0, dot);
+    Compiler::Action stage = (prefix == "synth")
+                                 ? Compiler::Synthesis
+                                 : Compiler::StageFromName(prefix);
+    if (stage != Compiler::NoAction) {
+      compiler.SetStageOption(stage, name.substr(dot + 1), value);
+      return;
+    }
+  }
+  if (synth) {
+    compiler.SetStageOption(Compiler::Synthesis, name, value);
+    return;
+  }
+  for (int stage = Compiler::Global; stage <= Compiler::Bitream; stage++) {
+    compiler.SetStageOption((Compiler::Action)stage, name, value);
+  }
+}
+
+// Runs on a TaskScheduler worker, every run owns its design, compiler and log
+bool RunsLauncher::Execute(const RunSpec &spec, RunControl &control) {
+  std::string designName = spec.m_top;
+  Design design(designName);
+  design.TopLevel(spec.m_top);
+  for (auto &file : spec.m_designFiles) {
+    design.AddFile(FileLanguage(file), file);
+  }
+  for (auto &file : spec.m_constrFiles) {
+    design.AddConstraintFile(file);
+  }
+
+  std::ofstream log(spec.m_runDir + "/run.log", std::ios::trunc);
+  Compiler compiler(nullptr, &design, log);
+  control.m_eventSource = compiler.EventSource();
+  compiler.Cache().SetDirectory(spec.m_cacheDir);
+  if (control.m_metricHandler) {
+    compiler.SetMetricHandler([&control](Compiler::Action stage,
+                                         const std::string &metric,
+                                         double value) {
+      control.m_metricHandler(stage, metric, value);
+    });
+  }
+  compiler.SetRemoteWorker(spec.m_worker);
+  for (auto &option : spec.m_options) {
+    SetRunOption(compiler, spec.m_synth, option.first, option.second);
+  }
+
+  // Stages poll the run's token, cancelling it stops the compiler
+  compiler.SetCancellationToken(control.m_token);
+  bool success = false;
+  if (spec.m_synth) {
+    success = compiler.Compile(spec.m_lastStage
+                                   ? (Compiler::Action)spec.m_lastStage
+                                   : Compiler::Synthesis);
+  } else {
+    success = compiler.Compile(Compiler::STA) &&
+              !control.m_token.Cancelled() &&
+              compiler.Compile(Compiler::Bitream);
+  }
+  if (control.m_token.Cancelled()) success = false;
+  log << spec.m_name.toStdString() << (success ? " completed." : " failed.")
+      << std::endl;
+  return success;
+}
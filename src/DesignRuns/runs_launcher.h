@@ -0,0 +1,120 @@
+#ifndef RUNS_LAUNCHER_H
+#define RUNS_LAUNCHER_H
+
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Compiler/EventBus.h"
+#include "Compiler/TaskScheduler.h"
+#include "NewProject/ProjectManager/project_manager.h"
+
+namespace FOEDAG {
+
+// Everything a run needs to execute, gathered on the GUI thread so that the
+// worker never touches the project model
+struct RunSpec {
+  QString m_name;
+  bool m_synth = true;
+  // Compiler::Action a synthesis run goes on to, synthesis only when 0
+  int m_lastStage = 0;
+  QString m_synthRun;
+  std::string m_top;
+  std::vector<std::string> m_designFiles;
+  std::vector<std::string> m_constrFiles;
+  std::map<std::string, std::string> m_options;
+  std::string m_runDir;
+  std::string m_cacheDir;
+  quint64 m_memoryMB = 0;
+  // JobServer address the run is shipped to, empty to run locally
+  std::string m_worker;
+};
+
+// Launches synthesis and implementation runs on the TaskScheduler.
+// Implementation runs wait on their synthesis run, independent runs execute
+// concurrently as long as the job limit and the memory ceiling allow it.
+// Every status change is written back to the project file.
+class RunsLauncher : public QObject {
+  Q_OBJECT
+ public:
+  explicit RunsLauncher(ProjectManager *projManager,
+                        QObject *parent = nullptr);
+  ~RunsLauncher();
+
+  // 0 means one job per scheduler thread
+  void setMaxJobs(int maxJobs) { m_maxJobs = maxJobs; }
+  int maxJobs() const;
+  // 0 disables the memory admission check
+  void setMemoryCeilingMB(quint64 ceiling) { m_memoryCeilingMB = ceiling; }
+  quint64 memoryCeilingMB() const { return m_memoryCeilingMB; }
+  // Memory budgeted per run when the run does not set PROJECT_RUN_MEMORY
+  void setMemoryEstimateMB(bool synth, quint64 estimate);
+
+  // Queues the given runs, plus the synthesis runs they depend on that are
+  // not completed yet. Returns false if nothing could be queued.
+  bool launch(const QStringList &listRunNames);
+  // Cancels queued and running runs among the given ones and marks them
+  // not started, a running one once its worker returned
+  void reset(const QStringList &listRunNames);
+  bool isBusy() const { return !m_jobs.isEmpty(); }
+
+  // Shared between the GUI thread and the worker executing the run
+  struct RunControl {
+    CancellationToken m_token;
+    // Receives the metrics of the run with the Compiler::Action of the
+    // stage reporting them, called on the worker
+    std::function<void(int, const std::string &, double)> m_metricHandler;
+    // EventBus source of the compiler of the run, 0 until it is created
+    std::atomic<uint32_t> m_eventSource{0};
+  };
+  bool CollectSpec(const QString &strRunName, RunSpec &spec) const;
+  static void Stop(RunControl &control) { control.m_token.Cancel(); }
+  static bool Execute(const RunSpec &spec, RunControl &control);
+
+ signals:
+  void runStatusChanged(const QString &strRunName, const QString &strStatus);
+  // Status of a running run with the phase and the progress of its stage,
+  // for display only, the project keeps RUN_STATUS_RUNNING
+  void runProgressChanged(const QString &strRunName,
+                          const QString &strProgress);
+  void allRunsFinished();
+
+ private slots:
+  void SlotJobFinished(const QString &strRunName, bool success);
+  void SlotStageProgress(uint source, const QString &strPhase,
+                         double percent);
+
+ private:
+  struct Job {
+    RunSpec m_spec;
+    bool m_running = false;
+    // Reset while running, reset again once the worker returns
+    bool m_resetting = false;
+    JobHandle<bool> m_handle;
+    std::shared_ptr<RunControl> m_control;
+  };
+
+  void Schedule();
+  void SetStatus(const QString &strRunName, const QString &strStatus);
+  // Removes the run folder and marks the run not started
+  void ResetRun(const QString &strRunName);
+  void CancelDependents(const QString &strRunName);
+  static void Cancel(Job &job) { Stop(*job.m_control); }
+
+  ProjectManager *m_projManager;
+  QMap<QString, Job> m_jobs;
+  int m_maxJobs = 0;
+  quint64 m_memoryCeilingMB = 0;
+  quint64 m_synthEstimateMB = 2048;
+  quint64 m_impleEstimateMB = 4096;
+  int m_progressSubscriber = 0;
+};
+
+}  // namespace FOEDAG
+#endif  // RUNS_LAUNCHER_H
@@ -0,0 +1,283 @@
+#include "runs_sweep.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "Compiler/Compiler.h"
+#include "Compiler/DesignSweep.h"
+#include "Tcl/TclInterpreter.h"
+#include "runs_launcher.h"
+
+using namespace FOEDAG;
+
+static int Usage(Tcl_Interp *interp, const std::string &message) {
+  std::string error = "ERROR: " + message +
+                      "\nUsage: sweep_runs -param <option> <values> "
+                      "?-param ...? ?-run <synth run>? ?-jobs <n>? "
+                      "?-prune_margin <percent>? ?-minimize <metric>? "
+                      "?-maximize <metric>?";
+  Tcl_AppendResult(interp, error.c_str(), (char *)NULL);
+  return TCL_ERROR;
+}
+
+// The metrics the stages report, with the last stage reporting each
+static const std::pair<const char *, Compiler::Action> kObjectiveStages[] = {
+    {"overflow", Compiler::Global},
+    {"hpwl", Compiler::Detailed},
+    {"average_displacement", Compiler::Detailed},
+    {"max_displacement", Compiler::Detailed},
+    {"wirelength", Compiler::Routing},
+    {"route_iterations", Compiler::Routing},
+    {"wns", Compiler::STA},
+    {"tns", Compiler::STA}};
+
+static Compiler::Action ObjectiveStage(const std::string &metric) {
+  for (auto &objective : kObjectiveStages) {
+    if (metric == objective.first) return objective.second;
+  }
+  return Compiler::NoAction;
+}
+
+namespace {
+
+// Handed to the command as its client data
+struct SweepCommand {
+  // Runs are parented to the manager, it has to outlive them
+  ProjectManager *m_projManager = nullptr;
+  bool m_running = false;
+};
+
+// A started sweep, owned by the worker running it until it is handed back
+// to the interpreter thread
+struct SweepJob {
+  explicit SweepJob(const std::vector<DesignSweep::Parameter> &grid)
+      : m_sweep(grid) {}
+  DesignSweep m_sweep;
+  std::vector<RunSpec> m_specs;
+  unsigned int m_jobs = 0;
+  SweepCommand *m_command = nullptr;
+  Tcl_Interp *m_interp = nullptr;
+};
+
+struct SweepDoneEvent {
+  Tcl_Event m_header;
+  SweepJob *m_job;
+};
+
+// Runs on the interpreter thread once every point is done: writes the
+// statuses back to the project and sets ::sweep_runs_result to the points
+// with their status and metrics
+int OnSweepDone(Tcl_Event *header, int flags) {
+  if (!(flags & TCL_ALL_EVENTS)) return 0;
+  std::unique_ptr<SweepJob> job(((SweepDoneEvent *)header)->m_job);
+  ProjectManager *projManager = job->m_command->m_projManager;
+  std::ostringstream result;
+  for (auto &point : job->m_sweep.Points()) {
+    QString strStatus = RUN_STATUS_FAILED;
+    if (point.m_status == DesignSweep::Completed) {
+      strStatus = RUN_STATUS_COMPLETED;
+    } else if (point.m_status == DesignSweep::Pruned) {
+      strStatus = RUN_STATUS_CANCELLED;
+    }
+    projManager->setRunStatus(QString::fromStdString(point.m_name),
+                              strStatus);
+    result << "{" << point.m_name << " "
+           << DesignSweep::StatusName(point.m_status) << " {";
+    for (auto &metric : point.m_metrics) {
+      result << " " << metric.first << " " << metric.second;
+    }
+    result << " }} ";
+  }
+  projManager->FinishedProject();
+  job->m_command->m_running = false;
+  Tcl_SetVar(job->m_interp, "::sweep_runs_result", result.str().c_str(),
+             TCL_GLOBAL_ONLY);
+  return 1;
+}
+
+}  // namespace
+
+// sweep_runs -param <option> <values> ?-param ...? ?-run <synth run>?
+//            ?-jobs <n>? ?-prune_margin <percent>? ?-minimize <metric>?
+//            ?-maximize <metric>?
+// Creates one synthesis run per point of the option grid, derived from the
+// given (or active) synthesis run, starts them in parallel and returns
+// their names. The runs stream their metrics, points dominated by a
+// completed one on every objective reported so far are stopped. Once every
+// point is done, ::sweep_runs_result is set to the points with their status
+// and metrics. Objectives default to minimum hpwl and maximum wns, the runs
+// go through the last stage reporting one of them. Options prefixed with a
+// stage name, like routing.timing_driven, go to that stage.
+static int SweepRuns(void *clientData, Tcl_Interp *interp, int argc,
+                     const char *argv[]) {
+  SweepCommand *command = (SweepCommand *)clientData;
+  if ("" == Project::Instance()->projectPath()) {
+    return Usage(interp, "no project opened");
+  }
+  if (command->m_running) {
+    return Usage(interp, "a sweep is already running");
+  }
+
+  std::vector<DesignSweep::Parameter> grid;
+  std::vector<std::pair<std::string, bool>> objectives;
+  QString strBaseRun;
+  unsigned int jobs = 0;
+  double margin = 0.0;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "-param" && i + 2 < argc) {
+      DesignSweep::Parameter param;
+      param.m_name = argv[i + 1];
+      int count = 0;
+      const char **values = nullptr;
+      if (Tcl_SplitList(interp, argv[i + 2], &count, &values) != TCL_OK) {
+        Tcl_ResetResult(interp);
+        return Usage(interp, "-param " + param.m_name +
+                                 " expects a list, got " + argv[i + 2]);
+      }
+      param.m_values.assign(values, values + count);
+      Tcl_Free((char *)values);
+      if (param.m_values.empty()) {
+        return Usage(interp, "no value for -param " + param.m_name);
+      }
+      grid.push_back(param);
+      i += 2;
+    } else if (option == "-run" && i + 1 < argc) {
+      strBaseRun = argv[++i];
+    } else if (option == "-jobs" && i + 1 < argc) {
+      int value = 0;
+      if (Tcl_GetInt(interp, argv[++i], &value) != TCL_OK || value < 0) {
+        Tcl_ResetResult(interp);
+        return Usage(interp, "-jobs expects a count, got " +
+                                 std::string(argv[i]));
+      }
+      jobs = (unsigned int)value;
+    } else if (option == "-prune_margin" && i + 1 < argc) {
+      if (Tcl_GetDouble(interp, argv[++i], &margin) != TCL_OK ||
+          margin < 0) {
+        Tcl_ResetResult(interp);
+        return Usage(interp, "-prune_margin expects a percentage, got " +
+                                 std::string(argv[i]));
+      }
+      margin /= 100.0;
+    } else if ((option == "-minimize" || option == "-maximize") &&
+               i + 1 < argc) {
+      std::string metric = argv[++i];
+      if (ObjectiveStage(metric) == Compiler::NoAction) {
+        std::string metrics;
+        for (auto &objective : kObjectiveStages) {
+          metrics += std::string(" ") + objective.first;
+        }
+        return Usage(interp, "no stage reports " + metric + ", one of" +
+                                 metrics);
+      }
+      objectives.push_back(std::make_pair(metric, option == "-minimize"));
+    } else {
+      return Usage(interp, "unknown option " + option);
+    }
+  }
+  if (grid.empty()) {
+    return Usage(interp, "no -param given");
+  }
+  if (objectives.empty()) {
+    objectives.push_back(std::make_pair("hpwl", true));
+    objectives.push_back(std::make_pair("wns", false));
+  }
+  int lastStage = Compiler::Synthesis;
+  for (auto &objective : objectives) {
+    lastStage = std::max(lastStage, (int)ObjectiveStage(objective.first));
+  }
+
+  ProjectManager *projManager = command->m_projManager;
+  if ("" == strBaseRun) {
+    strBaseRun = projManager->getActiveSynthRunName();
+  }
+  ProjectRun *baseRun = Project::Instance()->getProjectRun(strBaseRun);
+  if (nullptr == baseRun || baseRun->runType() != RUN_TYPE_SYNTHESIS) {
+    return Usage(interp, "no synthesis run " + strBaseRun.toStdString());
+  }
+
+  SweepJob *job = new SweepJob(grid);
+  DesignSweep &sweep = job->m_sweep;
+  sweep.SetPruneMargin(margin);
+  for (auto &objective : objectives) {
+    sweep.AddObjective(objective.first, objective.second);
+  }
+
+  // Every point becomes a synthesis run of the project
+  RunsLauncher launcher(projManager);
+  std::ostringstream result;
+  QMap<QString, QString> mapBaseOption = baseRun->getMapOption();
+  for (auto &point : sweep.Points()) {
+    point.m_name = strBaseRun.toStdString() + "_" + point.m_name;
+    QString strRunName = QString::fromStdString(point.m_name);
+    if (nullptr == Project::Instance()->getProjectRun(strRunName)) {
+      projManager->setSynthRun(strRunName);
+    } else {
+      projManager->setCurrentRun(strRunName);
+    }
+    QList<QPair<QString, QString>> listParam;
+    for (auto iter = mapBaseOption.begin(); iter != mapBaseOption.end();
+         ++iter) {
+      listParam.append(qMakePair(iter.key(), iter.value()));
+    }
+    for (auto &option : point.m_options) {
+      listParam.append(qMakePair(QString::fromStdString(option.first),
+                                 QString::fromStdString(option.second)));
+    }
+    projManager->setSynthesisOption(listParam);
+    projManager->setRunSrcSet(baseRun->srcSet());
+    projManager->setRunConstrSet(baseRun->constrsSet());
+    projManager->setRunStatus(strRunName, RUN_STATUS_RUNNING);
+
+    RunSpec spec;
+    launcher.CollectSpec(strRunName, spec);
+    spec.m_lastStage = lastStage;
+    job->m_specs.push_back(spec);
+    result << point.m_name << " ";
+  }
+  projManager->FinishedProject();
+
+  job->m_jobs = jobs;
+  job->m_command = command;
+  job->m_interp = interp;
+  command->m_running = true;
+  Tcl_ThreadId thread = Tcl_GetCurrentThread();
+  // The sweep stays off the pool, which the stages of its points share for
+  // their parallel loops
+  TaskScheduler::Spawn([job, thread]() {
+    job->m_sweep.Run(
+        [job](size_t index, DesignSweep &s) {
+          RunsLauncher::RunControl control;
+          control.m_metricHandler = [&s, index](int stage,
+                                                const std::string &metric,
+                                                double value) {
+            s.Report(index, metric, value, stage);
+          };
+          s.SetStopHandler(index,
+                           [&control]() { RunsLauncher::Stop(control); });
+          bool success = RunsLauncher::Execute(job->m_specs[index], control);
+          s.SetStopHandler(index, nullptr);
+          return success;
+        },
+        std::cout, job->m_jobs);
+    SweepDoneEvent *event =
+        (SweepDoneEvent *)ckalloc(sizeof(SweepDoneEvent));
+    event->m_header.proc = OnSweepDone;
+    event->m_job = job;
+    Tcl_ThreadQueueEvent(thread, &event->m_header, TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(thread);
+    return true;
+  });
+
+  Tcl_AppendResult(interp, result.str().c_str(), (char *)NULL);
+  return TCL_OK;
+}
+
+void FOEDAG::registerRunsSweepCommands(TclInterpreter *interp) {
+  SweepCommand *command = new SweepCommand;
+  command->m_projManager = new ProjectManager();
+  interp->registerCmd("sweep_runs", SweepRuns, command, 0);
+}
@@ -0,0 +1,13 @@
+#ifndef RUNS_SWEEP_H
+#define RUNS_SWEEP_H
+
+namespace FOEDAG {
+
+class TclInterpreter;
+
+// Registers sweep_runs, the design space exploration over the synthesis
+// options of the opened project
+void registerRunsSweepCommands(TclInterpreter *interp);
+
+}  // namespace FOEDAG
+#endif  // RUNS_SWEEP_H
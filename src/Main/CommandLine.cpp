@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "CommandLine.h"
 
+#include <cstdlib>
+
 using namespace FOEDAG;
 
 void CommandLine::printHelp() {
@@ -32,6 +34,11 @@ void CommandLine::printHelp() {
   std::cout << "   --noqt:  Tcl only, no GUI" << std::endl;
   std::cout << "   --replay <script>: Replay GUI test" << std::endl;
   std::cout << "   --script <script>: Execute a Tcl script" << std::endl;
+  std::cout << "   --worker <host>:<port> | unix:<path>: Run compilation "
+               "jobs sent by remote sessions, \":<port>\" for local ones "
+               "only, \"*:<port>\" for any host"
+            << std::endl;
+  std::cout << "   --jobs <n>: Jobs run at once by the worker" << std::endl;
   std::cout << "Tcl commands:" << std::endl;
   std::cout << "   help" << std::endl;
   std::cout << "   gui_start" << std::endl;
@@ -57,6 +64,12 @@ void CommandLine::processArgs() {
     } else if (token == "--cmd") {
       i++;
       m_runTclCmd = m_argv[i];
+    } else if (token == "--worker") {
+      i++;
+      m_workerAddress = m_argv[i];
+    } else if (token == "--jobs") {
+      i++;
+      m_workerJobs = (unsigned int)std::strtoul(m_argv[i], nullptr, 10);
     } else if (token == "--help") {
       printHelp();
       exit(0);
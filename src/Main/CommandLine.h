@@ -48,6 +48,11 @@ class CommandLine {
 
   const std::string& TclCmd() const { return m_runTclCmd; }
 
+  // --worker <address>: serve compilation jobs instead of starting a session
+  const std::string& WorkerAddress() const { return m_workerAddress; }
+
+  unsigned int WorkerJobs() const { return m_workerJobs; }
+
   virtual void printHelp();
   virtual void processArgs();
 
@@ -63,6 +68,8 @@ class CommandLine {
   std::string m_runScript;
   std::string m_runGuiTest;
   std::string m_runTclCmd;
+  std::string m_workerAddress;
+  unsigned int m_workerJobs = 0;
 };
 
 }  // namespace FOEDAG
@@ -45,6 +45,7 @@ extern "C" {
 
 #include "Command/CommandStack.h"
 #include "CommandLine.h"
+#include "Compiler/JobServer.h"
 #include "Main/Foedag.h"
 #include "MainWindow/Session.h"
 #include "MainWindow/main_window.h"
@@ -181,6 +182,7 @@ bool Foedag::initQmlGui() {
 }
 
 bool Foedag::init(GUI_TYPE guiType) {
+  if (!m_cmdLine->WorkerAddress().empty()) return initWorker();
   bool result;
   switch (guiType) {
     case GUI_TYPE::GT_NONE:
@@ -244,3 +246,15 @@ bool Foedag::initBatch() {
   delete GlobalSession;
   return 0;
 }
+
+bool Foedag::initWorker() {
+  FOEDAG::JobServer server(std::cout);
+  if (!server.Listen(m_cmdLine->WorkerAddress())) {
+    std::cerr << "ERROR: " << server.Error() << std::endl;
+    return 1;
+  }
+  std::cout << "Worker listening on " << m_cmdLine->WorkerAddress()
+            << std::endl;
+  server.Serve(m_cmdLine->WorkerJobs());
+  return 0;
+}
@@ -53,6 +53,9 @@ class Foedag {
  public:
   bool initGui();
   bool initBatch();
+  // --worker mode, no interpreter. Like the other init functions, the
+  // result ends up as the exit code.
+  bool initWorker();
 
  protected:
   FOEDAG::CommandLine* m_cmdLine = nullptr;
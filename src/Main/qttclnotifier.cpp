@@ -166,7 +166,12 @@ QtTclNotifier::QtTclNotifier() {
 // This could be helpful for multi-thread support, though. TBD
 void* QtTclNotifier::InitNotifier() { return 0; }
 void QtTclNotifier::FinalizeNotifier(ClientData) {}
-void QtTclNotifier::AlertNotifier(ClientData) {}
+// Called from other threads after they queued an event to this one, for
+// instance StageProcess handing over its pipes: service it from the loop
+void QtTclNotifier::AlertNotifier(ClientData) {
+  QMetaObject::invokeMethod(getInstance(), "handle_timer",
+                            Qt::QueuedConnection);
+}
 
 // Can't find any examples of how this should work.  Unix implementation is
 // empty
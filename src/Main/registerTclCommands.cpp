@@ -42,12 +42,20 @@ extern "C" {
 
 #include "Command/CommandStack.h"
 #include "CommandLine.h"
+#include "DesignRuns/runs_farm.h"
+#include "DesignRuns/runs_sweep.h"
 #include "Foedag.h"
 #include "MainWindow/Session.h"
 #include "MainWindow/main_window.h"
 #include "Tcl/TclInterpreter.h"
 #include "qttclnotifier.hpp"
 
+// Run commands that need no window, available in every mode
+static void registerRunsCommands(FOEDAG::Session* session) {
+  FOEDAG::registerRunsSweepCommands(session->TclInterp());
+  FOEDAG::registerRunsFarmCommands(session->TclInterp());
+}
+
 void registerBasicGuiCommands(FOEDAG::Session* session) {
   auto gui_start = [](void* clientData, Tcl_Interp* interp, int argc,
                       const char* argv[]) -> int {
@@ -101,6 +109,8 @@ void registerBasicGuiCommands(FOEDAG::Session* session) {
   };
   session->TclInterp()->registerCmd("process_qt_events", process_qt_events, 0,
                                     0);
+
+  registerRunsCommands(session);
 }
 
 void registerBasicBatchCommands(FOEDAG::Session* session) {
@@ -121,4 +131,6 @@ void registerBasicBatchCommands(FOEDAG::Session* session) {
     return 0;
   };
   session->TclInterp()->registerCmd("help", help, 0, 0);
+
+  registerRunsCommands(session);
 }
@@ -795,6 +795,9 @@ QList<QPair<QString, QString>> ProjectManager::getRunsProperties(
     pair.first = PROJECT_RUN_SYNTHRUN;
     pair.second = proRun->synthRun();
     listProperties.append(pair);
+    pair.first = PROJECT_RUN_STATUS;
+    pair.second = proRun->runStatus();
+    listProperties.append(pair);
     pair.first = PROJECT_PART_DEVICE;
     pair.second = proRun->getOption(PROJECT_PART_DEVICE);
     listProperties.append(pair);
@@ -905,6 +908,29 @@ int ProjectManager::setRunActive(const QString& strRunName) {
   return ret;
 }
 
+int ProjectManager::setRunStatus(const QString& strRunName,
+                                 const QString& strStatus) {
+  ProjectRun* proRun = Project::Instance()->getProjectRun(strRunName);
+  if (nullptr == proRun) {
+    return -2;
+  }
+  proRun->setRunStatus(strStatus);
+  return 0;
+}
+
+QString ProjectManager::getRunStatus(const QString& strRunName) const {
+  ProjectRun* proRun = Project::Instance()->getProjectRun(strRunName);
+  if (nullptr == proRun || "" == proRun->runStatus()) {
+    return RUN_STATUS_NOT_STARTED;
+  }
+  return proRun->runStatus();
+}
+
+QString ProjectManager::getRunsFolder(const QString& strRunName) const {
+  return Project::Instance()->projectPath() + "/" +
+         Project::Instance()->projectName() + ".runs/" + strRunName;
+}
+
 QString ProjectManager::getActiveRunDevice() const {
   QString strActive = "";
 
@@ -1115,6 +1141,7 @@ int ProjectManager::ImportProjectData(QString strOspro) {
         QString strConstrs;
         QString strRunState;
         QString strSynthRun;
+        QString strRunStatus;
         QMap<QString, QString> mapOption;
         while (true) {
           type = reader.readNext();
@@ -1142,6 +1169,17 @@ int ProjectManager::ImportProjectData(QString strOspro) {
               strSynthRun =
                   reader.attributes().value(PROJECT_RUN_SYNTHRUN).toString();
             }
+            if (reader.attributes().hasAttribute(PROJECT_RUN_STATUS)) {
+              strRunStatus =
+                  reader.attributes().value(PROJECT_RUN_STATUS).toString();
+            }
+            // Whatever launched the run is gone: a queued run never
+            // started, a running one was interrupted
+            if (RUN_STATUS_QUEUED == strRunStatus) {
+              strRunStatus = RUN_STATUS_NOT_STARTED;
+            } else if (RUN_STATUS_RUNNING == strRunStatus) {
+              strRunStatus = RUN_STATUS_FAILED;
+            }
           } else if (type == QXmlStreamReader::StartElement &&
                      reader.attributes().hasAttribute(PROJECT_NAME) &&
                      reader.attributes().hasAttribute(PROJECT_VAL)) {
@@ -1156,6 +1194,7 @@ int ProjectManager::ImportProjectData(QString strOspro) {
             proRun->setConstrsSet(strConstrs);
             proRun->setRunState(strRunState);
             proRun->setSynthRun(strSynthRun);
+            proRun->setRunStatus(strRunStatus);
 
             for (auto iter = mapOption.begin(); iter != mapOption.end();
                  ++iter) {
@@ -1169,6 +1208,7 @@ int ProjectManager::ImportProjectData(QString strOspro) {
             strConstrs = "";
             strRunState = "";
             strSynthRun = "";
+            strRunStatus = "";
             mapOption.clear();
           }
         }
@@ -1279,6 +1319,7 @@ int ProjectManager::ExportProjectData() {
     stream.writeAttribute(PROJECT_RUN_CONSTRSSET, tmpRun->constrsSet());
     stream.writeAttribute(PROJECT_RUN_STATE, tmpRun->runState());
     stream.writeAttribute(PROJECT_RUN_SYNTHRUN, tmpRun->synthRun());
+    stream.writeAttribute(PROJECT_RUN_STATUS, tmpRun->runStatus());
 
     QMap<QString, QString> tmpOptionF = tmpRun->getMapOption();
     for (auto iterOption = tmpOptionF.begin(); iterOption != tmpOptionF.end();
@@ -1336,6 +1377,12 @@ int ProjectManager::CreateProjectDir() {
       ret = -2;
       break;
     }
+
+    // Stage results store, see Compiler/StageCache.h
+    if (!dir.mkdir(tmpPath + "/" + tmpName + ".runs/" + DEFAULT_FOLDER_CACHE)) {
+      ret = -2;
+      break;
+    }
   } while (false);
 
   return ret;
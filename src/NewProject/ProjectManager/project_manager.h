@@ -55,6 +55,8 @@ project object is singleton mode.
 #define PROJECT_RUN_CONSTRSSET "ConstrsSet"
 #define PROJECT_RUN_STATE "State"
 #define PROJECT_RUN_SYNTHRUN "SynthRun"
+#define PROJECT_RUN_STATUS "Status"
+#define PROJECT_RUN_MEMORY "MaxMemory"
 
 #define PROJECT_PART_SERIES "Series"
 #define PROJECT_PART_FAMILY "Family"
@@ -70,6 +72,13 @@ project object is singleton mode.
 
 #define RUN_STATE_CURRENT "current"
 
+#define RUN_STATUS_NOT_STARTED "Not Started"
+#define RUN_STATUS_QUEUED "Queued"
+#define RUN_STATUS_RUNNING "Running"
+#define RUN_STATUS_COMPLETED "Completed"
+#define RUN_STATUS_FAILED "Failed"
+#define RUN_STATUS_CANCELLED "Cancelled"
+
 #define RUN_TYPE_SYNTHESIS "Synthesis"
 #define RUN_TYPE_IMPLEMENT "Implementation"
 
@@ -78,6 +87,7 @@ project object is singleton mode.
 #define DEFAULT_FOLDER_SOURCE "sources_1"
 #define DEFAULT_FOLDER_IMPLE "imple_1"
 #define DEFAULT_FOLDER_SYNTH "synth_1"
+#define DEFAULT_FOLDER_CACHE ".cache"
 
 #define PROJECT_FILE_FORMAT ".ospr"
 
@@ -134,6 +144,7 @@ class ProjectManager : public QObject {
   int setSimulationActive(const QString &strSetName);
   QStringList getSimulationFiles(const QString &strFileSet) const;
   QString getSimulationTopModule(const QString &strFileSet) const;
+  QString getRunsFolder(const QString &strRunName) const;
 
   QStringList getSynthRunsNames() const;
   QStringList getImpleRunsNames() const;
@@ -158,6 +169,8 @@ class ProjectManager : public QObject {
   int setSynthesisOption(const QList<QPair<QString, QString>> &listParam);
 
   int setRunActive(const QString &strRunName);
+  int setRunStatus(const QString &strRunName, const QString &strStatus);
+  QString getRunStatus(const QString &strRunName) const;
 
   QString getActiveRunDevice() const;
   QString getActiveSynthRunName() const;
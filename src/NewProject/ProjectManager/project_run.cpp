@@ -9,6 +9,7 @@ ProjectRun::ProjectRun(QObject *parent) : ProjectOption(parent) {
   m_constrsSet = "";
   m_runState = "";
   m_synthRun = "";
+  m_runStatus = "";
 }
 
 ProjectRun &ProjectRun::operator=(const ProjectRun &other) {
@@ -21,6 +22,7 @@ ProjectRun &ProjectRun::operator=(const ProjectRun &other) {
   this->m_srcSet = other.m_srcSet;
   this->m_synthRun = other.m_synthRun;
   this->m_constrsSet = other.m_constrsSet;
+  this->m_runStatus = other.m_runStatus;
   ProjectOption::operator=(other);
 
   return *this;
@@ -51,3 +53,9 @@ void ProjectRun::setRunState(const QString &runState) { m_runState = runState; }
 QString ProjectRun::synthRun() const { return m_synthRun; }
 
 void ProjectRun::setSynthRun(const QString &synthRun) { m_synthRun = synthRun; }
+
+QString ProjectRun::runStatus() const { return m_runStatus; }
+
+void ProjectRun::setRunStatus(const QString &runStatus) {
+  m_runStatus = runStatus;
+}
@@ -31,6 +31,9 @@ class ProjectRun : public ProjectOption {
   QString synthRun() const;
   void setSynthRun(const QString &synthRun);
 
+  QString runStatus() const;
+  void setRunStatus(const QString &runStatus);
+
  private:
   QString m_runName;
   QString m_runType;
@@ -38,6 +41,7 @@ class ProjectRun : public ProjectOption {
   QString m_constrsSet;
   QString m_runState;
   QString m_synthRun;
+  QString m_runStatus;
 };
 }  // namespace FOEDAG
 #endif  // PROJECTRUN_H
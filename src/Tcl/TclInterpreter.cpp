@@ -69,6 +69,13 @@ void TclInterpreter::registerCmd(const std::string &cmdName, Tcl_CmdProc proc,
   Tcl_CreateCommand(interp, cmdName.c_str(), proc, clientData, deleteProc);
 }
 
+void TclInterpreter::registerObjCmd(const std::string &cmdName,
+                                    Tcl_ObjCmdProc proc,
+                                    ClientData clientData,
+                                    Tcl_CmdDeleteProc *deleteProc) {
+  Tcl_CreateObjCommand(interp, cmdName.c_str(), proc, clientData, deleteProc);
+}
+
 std::string TclInterpreter::evalGuiTestFile(const std::string &filename) {
   std::string testHarness = R"(
   proc test_harness { gui_script } {
@@ -70,6 +70,10 @@ class TclInterpreter {
   void registerCmd(const std::string& cmdName, Tcl_CmdProc proc,
                    ClientData clientData, Tcl_CmdDeleteProc* deleteProc);
 
+  // Object command: arguments and result as Tcl_Obj, no string conversion
+  void registerObjCmd(const std::string& cmdName, Tcl_ObjCmdProc proc,
+                      ClientData clientData, Tcl_CmdDeleteProc* deleteProc);
+
   Tcl_Interp* getInterp() { return interp; }
 
  private: